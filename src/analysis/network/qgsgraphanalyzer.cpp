@@ -15,12 +15,11 @@
 
 #include <limits>
 
-#include <QMap>
 #include <QVector>
-#include <QPair>
 
 #include "qgsgraph.h"
 #include "qgsgraphanalyzer.h"
+#include "qgsgraphheap_p.h"
 
 void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int criterionNum, QVector<int> *resultTree, QVector<double> *resultCost )
 {
@@ -50,19 +49,13 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
     resultTree->insert( resultTree->begin(), source->vertexCount(), -1 );
   }
 
-  // QMultiMap< cost, vertexIdx > not_begin
-  // I use it and don't create any struct or class
-  QMultiMap< double, int > not_begin;
-  QMultiMap< double, int >::iterator it;
+  QgsGraphHeap not_begin( source->vertexCount() );
+  not_begin.push( startPointIdx, 0.0 );
 
-  not_begin.insert( 0.0, startPointIdx );
-
-  while ( !not_begin.empty() )
+  while ( !not_begin.isEmpty() )
   {
-    it = not_begin.begin();
-    double curCost = it.key();
-    int curVertex = it.value();
-    not_begin.erase( it );
+    double curCost = not_begin.topCost();
+    int curVertex = not_begin.pop();
 
     // edge index list
     const QgsGraphEdgeIds &outgoingEdges = source->vertex( curVertex ).outgoingEdges();
@@ -78,7 +71,7 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
         {
           ( *resultTree )[ arc.toVertex()] = edgeId;
         }
-        not_begin.insert( cost, arc.toVertex() );
+        not_begin.push( arc.toVertex(), cost );
       }
     }
   }
@@ -0,0 +1,173 @@
+/***************************************************************************
+  qgsgraphheap_p.h
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSGRAPHHEAP_P_H
+#define QGSGRAPHHEAP_P_H
+
+#define SIP_NO_FILE
+
+///@cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * \ingroup analysis
+ * Indexed 4-ary min heap of graph vertices keyed by cost.
+ *
+ * Each vertex is stored at most once, and its position in the heap is
+ * tracked so that its cost can be decreased in place, which keeps the heap
+ * as small as the search frontier.
+ * \since QGIS 3.2
+ */
+class QgsGraphHeap
+{
+  public:
+
+    /**
+     * Constructor for a heap able to hold vertices with indices up to \a vertexCount - 1.
+     */
+    explicit QgsGraphHeap( int vertexCount )
+      : mPositions( static_cast< size_t >( vertexCount ), -1 )
+    {}
+
+    //! Returns true if the heap is empty
+    bool isEmpty() const { return mEntries.empty(); }
+
+    //! Returns true if \a vertex is in the heap
+    bool contains( int vertex ) const { return mPositions[ vertex ] >= 0; }
+
+    //! Returns the vertex with the lowest cost. The heap must not be empty.
+    int topVertex() const { return mEntries.front().vertex; }
+
+    //! Returns the lowest cost in the heap. The heap must not be empty.
+    double topCost() const { return mEntries.front().cost; }
+
+    /**
+     * Inserts \a vertex with a \a cost, or decreases its cost if it is already in
+     * the heap. Nothing happens if the vertex is already in the heap with a lower cost.
+     */
+    void push( int vertex, double cost )
+    {
+      int pos = mPositions[ vertex ];
+      if ( pos < 0 )
+      {
+        pos = static_cast< int >( mEntries.size() );
+        mEntries.push_back( Entry{ cost, vertex } );
+      }
+      else if ( cost < mEntries[ pos ].cost )
+      {
+        mEntries[ pos ].cost = cost;
+      }
+      else
+      {
+        return;
+      }
+      siftUp( pos );
+    }
+
+    //! Removes and returns the vertex with the lowest cost. The heap must not be empty.
+    int pop()
+    {
+      const int vertex = mEntries.front().vertex;
+      mPositions[ vertex ] = -1;
+      const Entry last = mEntries.back();
+      mEntries.pop_back();
+      if ( !mEntries.empty() )
+      {
+        mEntries[ 0 ] = last;
+        mPositions[ last.vertex ] = 0;
+        siftDown( 0 );
+      }
+      return vertex;
+    }
+
+    //! Removes all vertices from the heap, in a time proportional to the heap size
+    void clear()
+    {
+      for ( const Entry &entry : mEntries )
+        mPositions[ entry.vertex ] = -1;
+      mEntries.clear();
+    }
+
+  private:
+
+    static const int ARITY = 4;
+
+    struct Entry
+    {
+      double cost;
+      int vertex;
+    };
+
+    void siftUp( int pos )
+    {
+      const Entry entry = mEntries[ pos ];
+      while ( pos > 0 )
+      {
+        const int parent = ( pos - 1 ) / ARITY;
+        if ( mEntries[ parent ].cost <= entry.cost )
+          break;
+        mEntries[ pos ] = mEntries[ parent ];
+        mPositions[ mEntries[ pos ].vertex ] = pos;
+        pos = parent;
+      }
+      mEntries[ pos ] = entry;
+      mPositions[ entry.vertex ] = pos;
+    }
+
+    void siftDown( int pos )
+    {
+      const int size = static_cast< int >( mEntries.size() );
+      const Entry entry = mEntries[ pos ];
+      while ( true )
+      {
+        const int firstChild = pos * ARITY + 1;
+        if ( firstChild >= size )
+          break;
+
+        int best = firstChild;
+        const int lastChild = std::min( firstChild + ARITY, size );
+        for ( int child = firstChild + 1; child < lastChild; ++child )
+        {
+          if ( mEntries[ child ].cost < mEntries[ best ].cost )
+            best = child;
+        }
+        if ( entry.cost <= mEntries[ best ].cost )
+          break;
+
+        mEntries[ pos ] = mEntries[ best ];
+        mPositions[ mEntries[ pos ].vertex ] = pos;
+        pos = best;
+      }
+      mEntries[ pos ] = entry;
+      mPositions[ entry.vertex ] = pos;
+    }
+
+    std::vector< Entry > mEntries;
+    std::vector< int > mPositions;
+};
+
+///@endcond
+
+#endif // QGSGRAPHHEAP_P_H
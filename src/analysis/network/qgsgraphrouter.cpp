@@ -0,0 +1,759 @@
+/***************************************************************************
+  qgsgraphrouter.cpp
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgsgraphrouter.h"
+#include "qgsgraph.h"
+#include "qgsgraphheap_p.h"
+#include "qgsfeedback.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+//! Identifies hierarchy files written by QgsGraphRouter
+static const quint32 HIERARCHY_MAGIC = 0x51474348;
+static const quint32 HIERARCHY_VERSION = 1;
+
+//! Maximum number of vertices settled by a witness search while contracting the graph
+static const int WITNESS_SEARCH_LIMIT = 500;
+
+static const double INFINITE_COST = std::numeric_limits<double>::infinity();
+
+/**
+ * Labels of the vertices for the forward (0) and backward (1) directions of a search.
+ *
+ * A label is only valid if its stamp is the current generation, so the buffers do not
+ * need to be cleared between queries: starting a search only increments the generation.
+ */
+struct QgsGraphRouter::SearchBuffers
+{
+  explicit SearchBuffers( int vertexCount )
+    : heaps { QgsGraphHeap( vertexCount ), QgsGraphHeap( vertexCount ) }
+  {
+    for ( int direction = 0; direction < 2; ++direction )
+    {
+      costs[ direction ].resize( static_cast< size_t >( vertexCount ) );
+      arcs[ direction ].resize( static_cast< size_t >( vertexCount ) );
+      stamps[ direction ].assign( static_cast< size_t >( vertexCount ), 0 );
+    }
+  }
+
+  //! Invalidates all the labels and empties the heaps
+  void reset()
+  {
+    if ( ++generation == 0 )
+    {
+      // the stamps wrapped around, older labels could be taken for current ones
+      for ( std::vector< unsigned int > &directionStamps : stamps )
+        std::fill( directionStamps.begin(), directionStamps.end(), 0 );
+      generation = 1;
+    }
+    heaps[0].clear();
+    heaps[1].clear();
+  }
+
+  //! Returns the cost of a vertex in a direction, infinite if it was not reached
+  double cost( int direction, int vertex ) const
+  {
+    return stamps[ direction ][ vertex ] == generation ? costs[ direction ][ vertex ] : INFINITE_COST;
+  }
+
+  //! Sets the cost of a vertex in a direction, and the arc through which it is reached
+  void setLabel( int direction, int vertex, double cost, int arc )
+  {
+    stamps[ direction ][ vertex ] = generation;
+    costs[ direction ][ vertex ] = cost;
+    arcs[ direction ][ vertex ] = arc;
+  }
+
+  unsigned int generation = 0;
+  std::vector< double > costs[2];
+  std::vector< int > arcs[2];
+  std::vector< unsigned int > stamps[2];
+  QgsGraphHeap heaps[2];
+};
+
+QgsGraphRouter::QgsGraphRouter( const QgsGraph *graph, int strategyIndex )
+  : mGraph( graph )
+  , mStrategyIndex( strategyIndex )
+  , mVertexCount( graph->vertexCount() )
+  , mEdgeCount( graph->edgeCount() )
+{
+  mArcs.reserve( static_cast< size_t >( mEdgeCount ) );
+  mOutOffsets.assign( static_cast< size_t >( mVertexCount ) + 1, 0 );
+  mInOffsets.assign( static_cast< size_t >( mVertexCount ) + 1, 0 );
+
+  // read the costs once, converting from QVariant is too slow for the search loops
+  for ( int i = 0; i < mEdgeCount; ++i )
+  {
+    const QgsGraphEdge &edge = graph->edge( i );
+    mArcs.push_back( Arc{ edge.fromVertex(), edge.toVertex(), edge.cost( strategyIndex ).toDouble(), i, -1, -1 } );
+    mOutOffsets[ edge.fromVertex() + 1 ]++;
+    mInOffsets[ edge.toVertex() + 1 ]++;
+  }
+
+  for ( int i = 0; i < mVertexCount; ++i )
+  {
+    mOutOffsets[ i + 1 ] += mOutOffsets[ i ];
+    mInOffsets[ i + 1 ] += mInOffsets[ i ];
+  }
+
+  mOutArcs.resize( static_cast< size_t >( mEdgeCount ) );
+  mInArcs.resize( static_cast< size_t >( mEdgeCount ) );
+  std::vector< int > outFill( mOutOffsets.begin(), mOutOffsets.end() - 1 );
+  std::vector< int > inFill( mInOffsets.begin(), mInOffsets.end() - 1 );
+  for ( int i = 0; i < mEdgeCount; ++i )
+  {
+    mOutArcs[ outFill[ mArcs[i].from ]++ ] = i;
+    mInArcs[ inFill[ mArcs[i].to ]++ ] = i;
+  }
+}
+
+QgsGraphRouter::~QgsGraphRouter() = default;
+
+std::unique_ptr< QgsGraphRouter::SearchBuffers > QgsGraphRouter::takeSearchBuffers() const
+{
+  std::unique_ptr< SearchBuffers > buffers;
+  {
+    QMutexLocker locker( &mSearchBuffersMutex );
+    if ( !mSearchBuffers.empty() )
+    {
+      buffers = std::move( mSearchBuffers.back() );
+      mSearchBuffers.pop_back();
+    }
+  }
+
+  if ( !buffers )
+    buffers.reset( new SearchBuffers( mVertexCount ) );
+  buffers->reset();
+  return buffers;
+}
+
+void QgsGraphRouter::releaseSearchBuffers( std::unique_ptr< SearchBuffers > buffers ) const
+{
+  QMutexLocker locker( &mSearchBuffersMutex );
+  mSearchBuffers.push_back( std::move( buffers ) );
+}
+
+double QgsGraphRouter::shortestPath( int fromVertexIdx, int toVertexIdx, QVector<int> *edges ) const
+{
+  if ( edges )
+    edges->clear();
+
+  if ( fromVertexIdx < 0 || fromVertexIdx >= mVertexCount || toVertexIdx < 0 || toVertexIdx >= mVertexCount )
+    return INFINITE_COST;
+
+  if ( fromVertexIdx == toVertexIdx )
+    return 0.0;
+
+  if ( mPrepared )
+    return hierarchySearch( fromVertexIdx, toVertexIdx, edges );
+  else
+    return bidirectionalSearch( fromVertexIdx, toVertexIdx, edges );
+}
+
+double QgsGraphRouter::bidirectionalSearch( int fromVertexIdx, int toVertexIdx, QVector<int> *edges ) const
+{
+  // the buffers are reused, allocating and clearing arrays sized to the graph would cost more than short searches
+  std::unique_ptr< SearchBuffers > buffers = takeSearchBuffers();
+  QgsGraphHeap &forwardHeap = buffers->heaps[0];
+  QgsGraphHeap &backwardHeap = buffers->heaps[1];
+
+  buffers->setLabel( 0, fromVertexIdx, 0.0, -1 );
+  buffers->setLabel( 1, toVertexIdx, 0.0, -1 );
+  forwardHeap.push( fromVertexIdx, 0.0 );
+  backwardHeap.push( toVertexIdx, 0.0 );
+
+  double best = INFINITE_COST;
+  int meetingVertex = -1;
+
+  while ( true )
+  {
+    const double forwardTop = forwardHeap.isEmpty() ? INFINITE_COST : forwardHeap.topCost();
+    const double backwardTop = backwardHeap.isEmpty() ? INFINITE_COST : backwardHeap.topCost();
+
+    // no path through an unsettled vertex can be shorter than the best one found
+    if ( forwardTop + backwardTop >= best || ( forwardHeap.isEmpty() && backwardHeap.isEmpty() ) )
+      break;
+
+    if ( forwardTop <= backwardTop )
+    {
+      const int vertex = forwardHeap.pop();
+      for ( int i = mOutOffsets[ vertex ]; i < mOutOffsets[ vertex + 1 ]; ++i )
+      {
+        const Arc &arc = mArcs[ mOutArcs[ i ] ];
+        const double cost = forwardTop + arc.cost;
+        if ( cost < buffers->cost( 0, arc.to ) )
+        {
+          buffers->setLabel( 0, arc.to, cost, mOutArcs[ i ] );
+          forwardHeap.push( arc.to, cost );
+          if ( cost + buffers->cost( 1, arc.to ) < best )
+          {
+            best = cost + buffers->cost( 1, arc.to );
+            meetingVertex = arc.to;
+          }
+        }
+      }
+    }
+    else
+    {
+      const int vertex = backwardHeap.pop();
+      for ( int i = mInOffsets[ vertex ]; i < mInOffsets[ vertex + 1 ]; ++i )
+      {
+        const Arc &arc = mArcs[ mInArcs[ i ] ];
+        const double cost = backwardTop + arc.cost;
+        if ( cost < buffers->cost( 1, arc.from ) )
+        {
+          buffers->setLabel( 1, arc.from, cost, mInArcs[ i ] );
+          backwardHeap.push( arc.from, cost );
+          if ( cost + buffers->cost( 0, arc.from ) < best )
+          {
+            best = cost + buffers->cost( 0, arc.from );
+            meetingVertex = arc.from;
+          }
+        }
+      }
+    }
+  }
+
+  if ( edges && meetingVertex >= 0 )
+  {
+    const std::vector< int > &forwardArcs = buffers->arcs[0];
+    const std::vector< int > &backwardArcs = buffers->arcs[1];
+    for ( int vertex = meetingVertex; vertex != fromVertexIdx; vertex = mArcs[ forwardArcs[ vertex ] ].from )
+      edges->prepend( forwardArcs[ vertex ] );
+    for ( int vertex = meetingVertex; vertex != toVertexIdx; vertex = mArcs[ backwardArcs[ vertex ] ].to )
+      edges->append( backwardArcs[ vertex ] );
+  }
+
+  releaseSearchBuffers( std::move( buffers ) );
+  return best;
+}
+
+double QgsGraphRouter::hierarchySearch( int fromVertexIdx, int toVertexIdx, QVector<int> *edges ) const
+{
+  // both searches only climb the hierarchy, so they settle few vertices and
+  // hash based labels are cheaper than arrays sized to the whole graph
+  struct Label
+  {
+    double cost;
+    int arc;
+  };
+  typedef std::pair< double, int > QueueEntry;
+  typedef std::priority_queue< QueueEntry, std::vector< QueueEntry >, std::greater< QueueEntry > > Queue;
+
+  std::unordered_map< int, Label > labels[2];
+  Queue queues[2];
+  labels[0][ fromVertexIdx ] = Label{ 0.0, -1 };
+  labels[1][ toVertexIdx ] = Label{ 0.0, -1 };
+  queues[0].push( QueueEntry( 0.0, fromVertexIdx ) );
+  queues[1].push( QueueEntry( 0.0, toVertexIdx ) );
+
+  double best = INFINITE_COST;
+  int meetingVertex = -1;
+
+  while ( true )
+  {
+    // a direction is finished once its queue minimum cannot improve the best path
+    for ( Queue &queue : queues )
+    {
+      if ( !queue.empty() && queue.top().first >= best )
+        queue = Queue();
+    }
+    if ( queues[0].empty() && queues[1].empty() )
+      break;
+
+    const int direction = queues[1].empty() || ( !queues[0].empty() && queues[0].top().first <= queues[1].top().first ) ? 0 : 1;
+    const QueueEntry entry = queues[ direction ].top();
+    queues[ direction ].pop();
+    const int vertex = entry.second;
+    if ( entry.first > labels[ direction ][ vertex ].cost )
+      continue; // stale entry
+
+    const auto opposite = labels[ 1 - direction ].find( vertex );
+    if ( opposite != labels[ 1 - direction ].end() && entry.first + opposite->second.cost < best )
+    {
+      best = entry.first + opposite->second.cost;
+      meetingVertex = vertex;
+    }
+
+    const std::vector< int > &offsets = direction == 0 ? mUpOffsets : mDownOffsets;
+    const std::vector< int > &arcs = direction == 0 ? mUpArcs : mDownArcs;
+    for ( int i = offsets[ vertex ]; i < offsets[ vertex + 1 ]; ++i )
+    {
+      const Arc &arc = mArcs[ arcs[ i ] ];
+      const int next = direction == 0 ? arc.to : arc.from;
+      const double cost = entry.first + arc.cost;
+      const auto label = labels[ direction ].find( next );
+      if ( label == labels[ direction ].end() || cost < label->second.cost )
+      {
+        labels[ direction ][ next ] = Label{ cost, arcs[ i ] };
+        queues[ direction ].push( QueueEntry( cost, next ) );
+      }
+    }
+  }
+
+  if ( edges && meetingVertex >= 0 )
+  {
+    QVector< int > forwardArcs;
+    for ( int vertex = meetingVertex; vertex != fromVertexIdx; )
+    {
+      const int arc = labels[0][ vertex ].arc;
+      forwardArcs.prepend( arc );
+      vertex = mArcs[ arc ].from;
+    }
+    for ( int arc : qgis::as_const( forwardArcs ) )
+      unpackArc( arc, *edges );
+
+    for ( int vertex = meetingVertex; vertex != toVertexIdx; )
+    {
+      const int arc = labels[1][ vertex ].arc;
+      unpackArc( arc, *edges );
+      vertex = mArcs[ arc ].to;
+    }
+  }
+
+  return best;
+}
+
+void QgsGraphRouter::unpackArc( int arc, QVector<int> &edges ) const
+{
+  std::vector< int > stack;
+  stack.push_back( arc );
+  while ( !stack.empty() )
+  {
+    const Arc &current = mArcs[ stack.back() ];
+    stack.pop_back();
+    if ( current.edge >= 0 )
+    {
+      edges.append( current.edge );
+    }
+    else
+    {
+      stack.push_back( current.secondChild );
+      stack.push_back( current.firstChild );
+    }
+  }
+}
+
+void QgsGraphRouter::prepare( QgsFeedback *feedback )
+{
+  clearHierarchy();
+
+  const size_t count = static_cast< size_t >( mVertexCount );
+
+  // arcs between the vertices which are not contracted yet
+  std::vector< std::vector< int > > outgoing( count );
+  std::vector< std::vector< int > > incoming( count );
+  for ( int i = 0; i < mEdgeCount; ++i )
+  {
+    if ( mArcs[i].from == mArcs[i].to )
+      continue;
+    outgoing[ mArcs[i].from ].push_back( i );
+    incoming[ mArcs[i].to ].push_back( i );
+  }
+
+  std::vector< bool > contracted( count, false );
+  std::vector< int > contractedNeighbors( count, 0 );
+
+  // scratch space for the witness searches
+  std::vector< double > witnessCosts( count, INFINITE_COST );
+  std::vector< int > touched;
+  QgsGraphHeap witnessHeap( mVertexCount );
+
+  // cheapest arc for each neighbor, parallel edges are common in real networks
+  auto cheapestArcs = [this]( const std::vector< int > &arcs, bool byTarget )
+  {
+    QHash< int, int > result;
+    for ( int arc : arcs )
+    {
+      const int neighbor = byTarget ? mArcs[ arc ].to : mArcs[ arc ].from;
+      auto it = result.find( neighbor );
+      if ( it == result.end() )
+        result.insert( neighbor, arc );
+      else if ( mArcs[ arc ].cost < mArcs[ it.value() ].cost )
+        it.value() = arc;
+    }
+    return result;
+  };
+
+  // returns the shortcuts needed to contract a vertex, as pairs of incoming and outgoing arcs
+  auto requiredShortcuts = [&]( int vertex )
+  {
+    std::vector< std::pair< int, int > > shortcuts;
+    const QHash< int, int > inArcs = cheapestArcs( incoming[ vertex ], false );
+    const QHash< int, int > outArcs = cheapestArcs( outgoing[ vertex ], true );
+    if ( outArcs.isEmpty() )
+      return shortcuts;
+
+    double maxOutCost = 0;
+    for ( int arc : outArcs )
+      maxOutCost = std::max( maxOutCost, mArcs[ arc ].cost );
+
+    for ( auto in = inArcs.constBegin(); in != inArcs.constEnd(); ++in )
+    {
+      const int source = in.key();
+      const double inCost = mArcs[ in.value() ].cost;
+      const double limit = inCost + maxOutCost;
+
+      // witness search: is there a path avoiding the vertex which is not longer than the path through it?
+      witnessCosts[ source ] = 0.0;
+      touched.push_back( source );
+      witnessHeap.push( source, 0.0 );
+      int settled = 0;
+      while ( !witnessHeap.isEmpty() && settled < WITNESS_SEARCH_LIMIT )
+      {
+        const double cost = witnessHeap.topCost();
+        if ( cost > limit )
+          break;
+        const int current = witnessHeap.pop();
+        settled++;
+        for ( int arc : outgoing[ current ] )
+        {
+          const int next = mArcs[ arc ].to;
+          if ( next == vertex )
+            continue;
+          const double nextCost = cost + mArcs[ arc ].cost;
+          if ( nextCost < witnessCosts[ next ] )
+          {
+            if ( witnessCosts[ next ] == INFINITE_COST )
+              touched.push_back( next );
+            witnessCosts[ next ] = nextCost;
+            witnessHeap.push( next, nextCost );
+          }
+        }
+      }
+
+      for ( auto out = outArcs.constBegin(); out != outArcs.constEnd(); ++out )
+      {
+        if ( out.key() == source )
+          continue;
+        if ( witnessCosts[ out.key() ] > inCost + mArcs[ out.value() ].cost )
+          shortcuts.push_back( std::make_pair( in.value(), out.value() ) );
+      }
+
+      witnessHeap.clear();
+      for ( int v : touched )
+        witnessCosts[ v ] = INFINITE_COST;
+      touched.clear();
+    }
+    return shortcuts;
+  };
+
+  // edge difference heuristic, preferring vertices whose neighbors were not contracted yet
+  auto priority = [&]( int vertex )
+  {
+    const double shortcuts = static_cast< double >( requiredShortcuts( vertex ).size() );
+    return shortcuts - static_cast< double >( incoming[ vertex ].size() + outgoing[ vertex ].size() ) + contractedNeighbors[ vertex ];
+  };
+
+  QgsGraphHeap queue( mVertexCount );
+  for ( int i = 0; i < mVertexCount; ++i )
+  {
+    if ( feedback && feedback->isCanceled() )
+    {
+      clearHierarchy();
+      return;
+    }
+    queue.push( i, priority( i ) );
+  }
+
+  mRanks.assign( count, 0 );
+  int rank = 0;
+  while ( !queue.isEmpty() )
+  {
+    const int vertex = queue.pop();
+
+    // priorities are updated lazily, only contract the vertex if it is still the best candidate
+    const double current = priority( vertex );
+    if ( !queue.isEmpty() && current > queue.topCost() )
+    {
+      queue.push( vertex, current );
+      continue;
+    }
+
+    if ( feedback )
+    {
+      if ( feedback->isCanceled() )
+      {
+        clearHierarchy();
+        return;
+      }
+      if ( rank % 1000 == 0 )
+        feedback->setProgress( 100.0 * rank / mVertexCount );
+    }
+
+    for ( const std::pair< int, int > &shortcut : requiredShortcuts( vertex ) )
+    {
+      // copies, as adding the shortcut may reallocate the arcs
+      const Arc first = mArcs[ shortcut.first ];
+      const Arc second = mArcs[ shortcut.second ];
+      const int arc = static_cast< int >( mArcs.size() );
+      mArcs.push_back( Arc{ first.from, second.to, first.cost + second.cost, -1, shortcut.first, shortcut.second } );
+      outgoing[ first.from ].push_back( arc );
+      incoming[ second.to ].push_back( arc );
+    }
+
+    contracted[ vertex ] = true;
+    mRanks[ vertex ] = rank++;
+
+    // detach the vertex from the remaining graph
+    auto removeArcsTo = [this, vertex]( std::vector< int > &arcs, bool byTarget )
+    {
+      arcs.erase( std::remove_if( arcs.begin(), arcs.end(), [this, vertex, byTarget]( int arc )
+      {
+        return ( byTarget ? mArcs[ arc ].to : mArcs[ arc ].from ) == vertex;
+      } ), arcs.end() );
+    };
+    for ( int arc : incoming[ vertex ] )
+    {
+      removeArcsTo( outgoing[ mArcs[ arc ].from ], true );
+      contractedNeighbors[ mArcs[ arc ].from ]++;
+    }
+    for ( int arc : outgoing[ vertex ] )
+    {
+      removeArcsTo( incoming[ mArcs[ arc ].to ], false );
+      contractedNeighbors[ mArcs[ arc ].to ]++;
+    }
+    std::vector< int >().swap( incoming[ vertex ] );
+    std::vector< int >().swap( outgoing[ vertex ] );
+  }
+
+  buildUpwardGraphs();
+  mPrepared = true;
+
+  if ( feedback )
+    feedback->setProgress( 100.0 );
+}
+
+int QgsGraphRouter::shortcutCount() const
+{
+  return static_cast< int >( mArcs.size() ) - mEdgeCount;
+}
+
+void QgsGraphRouter::buildUpwardGraphs()
+{
+  const size_t count = static_cast< size_t >( mVertexCount );
+  mUpOffsets.assign( count + 1, 0 );
+  mDownOffsets.assign( count + 1, 0 );
+
+  for ( const Arc &arc : mArcs )
+  {
+    if ( arc.from == arc.to )
+      continue;
+    if ( mRanks[ arc.to ] > mRanks[ arc.from ] )
+      mUpOffsets[ arc.from + 1 ]++;
+    else
+      mDownOffsets[ arc.to + 1 ]++;
+  }
+  for ( size_t i = 0; i < count; ++i )
+  {
+    mUpOffsets[ i + 1 ] += mUpOffsets[ i ];
+    mDownOffsets[ i + 1 ] += mDownOffsets[ i ];
+  }
+
+  mUpArcs.resize( static_cast< size_t >( mUpOffsets.back() ) );
+  mDownArcs.resize( static_cast< size_t >( mDownOffsets.back() ) );
+  std::vector< int > upFill( mUpOffsets.begin(), mUpOffsets.end() - 1 );
+  std::vector< int > downFill( mDownOffsets.begin(), mDownOffsets.end() - 1 );
+  for ( int i = 0; i < static_cast< int >( mArcs.size() ); ++i )
+  {
+    const Arc &arc = mArcs[ i ];
+    if ( arc.from == arc.to )
+      continue;
+    if ( mRanks[ arc.to ] > mRanks[ arc.from ] )
+      mUpArcs[ upFill[ arc.from ]++ ] = i;
+    else
+      mDownArcs[ downFill[ arc.to ]++ ] = i;
+  }
+}
+
+void QgsGraphRouter::clearHierarchy()
+{
+  mPrepared = false;
+  mArcs.resize( static_cast< size_t >( mEdgeCount ) );
+  mRanks.clear();
+  mUpOffsets.clear();
+  mUpArcs.clear();
+  mDownOffsets.clear();
+  mDownArcs.clear();
+}
+
+bool QgsGraphRouter::writeHierarchy( const QString &path ) const
+{
+  if ( !mPrepared )
+    return false;
+
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_0 );
+  stream << HIERARCHY_MAGIC << HIERARCHY_VERSION
+         << static_cast< qint32 >( mVertexCount ) << static_cast< qint32 >( mEdgeCount ) << static_cast< qint32 >( mStrategyIndex );
+
+  for ( int rank : mRanks )
+    stream << static_cast< qint32 >( rank );
+
+  stream << static_cast< qint32 >( shortcutCount() );
+  for ( size_t i = static_cast< size_t >( mEdgeCount ); i < mArcs.size(); ++i )
+  {
+    const Arc &arc = mArcs[ i ];
+    stream << static_cast< qint32 >( arc.firstChild ) << static_cast< qint32 >( arc.secondChild );
+  }
+
+  return stream.status() == QDataStream::Ok;
+}
+
+bool QgsGraphRouter::readHierarchy( const QString &path )
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_0 );
+
+  quint32 magic = 0;
+  quint32 version = 0;
+  qint32 vertexCount = 0;
+  qint32 edgeCount = 0;
+  qint32 strategyIndex = 0;
+  stream >> magic >> version >> vertexCount >> edgeCount >> strategyIndex;
+  if ( stream.status() != QDataStream::Ok || magic != HIERARCHY_MAGIC || version != HIERARCHY_VERSION
+       || vertexCount != mVertexCount || edgeCount != mEdgeCount || strategyIndex != mStrategyIndex )
+    return false;
+
+  clearHierarchy();
+
+  mRanks.resize( static_cast< size_t >( mVertexCount ) );
+  for ( int &rank : mRanks )
+  {
+    qint32 value = 0;
+    stream >> value;
+    rank = value;
+  }
+
+  qint32 shortcuts = 0;
+  stream >> shortcuts;
+  if ( stream.status() != QDataStream::Ok || shortcuts < 0 )
+  {
+    clearHierarchy();
+    return false;
+  }
+
+  // shortcuts only reference arcs created before them, so their costs and ends can be rebuilt in order
+  mArcs.reserve( static_cast< size_t >( mEdgeCount ) + static_cast< size_t >( shortcuts ) );
+  for ( qint32 i = 0; i < shortcuts; ++i )
+  {
+    qint32 firstChild = 0;
+    qint32 secondChild = 0;
+    stream >> firstChild >> secondChild;
+    const int arcCount = static_cast< int >( mArcs.size() );
+    if ( stream.status() != QDataStream::Ok || firstChild < 0 || firstChild >= arcCount || secondChild < 0 || secondChild >= arcCount
+         || mArcs[ firstChild ].to != mArcs[ secondChild ].from )
+    {
+      clearHierarchy();
+      return false;
+    }
+    const Arc first = mArcs[ firstChild ];
+    const Arc second = mArcs[ secondChild ];
+    mArcs.push_back( Arc{ first.from, second.to, first.cost + second.cost, -1, firstChild, secondChild } );
+  }
+
+  buildUpwardGraphs();
+  mPrepared = true;
+  return true;
+}
+
+QVector< QVector< double > > QgsGraphRouter::costMatrix( const QVector<int> &sources, const QVector<int> &targets, QgsFeedback *feedback ) const
+{
+  struct Row
+  {
+    int source;
+    QVector< double > costs;
+  };
+
+  std::vector< Row > rows;
+  rows.reserve( static_cast< size_t >( sources.size() ) );
+  for ( int source : sources )
+    rows.push_back( Row{ source, QVector< double >( targets.size(), INFINITE_COST ) } );
+
+  // each row is a one to many search which stops once all the targets are settled
+  std::vector< bool > isTarget( static_cast< size_t >( mVertexCount ), false );
+  int targetCount = 0;
+  for ( int target : targets )
+  {
+    if ( target >= 0 && target < mVertexCount && !isTarget[ target ] )
+    {
+      isTarget[ target ] = true;
+      targetCount++;
+    }
+  }
+
+  auto solveRow = [this, &targets, &isTarget, targetCount, feedback]( Row & row )
+  {
+    if ( row.source < 0 || row.source >= mVertexCount || ( feedback && feedback->isCanceled() ) )
+      return;
+
+    std::unique_ptr< SearchBuffers > buffers = takeSearchBuffers();
+    QgsGraphHeap &heap = buffers->heaps[0];
+    buffers->setLabel( 0, row.source, 0.0, -1 );
+    heap.push( row.source, 0.0 );
+
+    int remaining = targetCount;
+    while ( !heap.isEmpty() && remaining > 0 )
+    {
+      const double cost = heap.topCost();
+      const int vertex = heap.pop();
+      if ( isTarget[ vertex ] )
+        remaining--;
+
+      for ( int i = mOutOffsets[ vertex ]; i < mOutOffsets[ vertex + 1 ]; ++i )
+      {
+        const Arc &arc = mArcs[ mOutArcs[ i ] ];
+        const double nextCost = cost + arc.cost;
+        if ( nextCost < buffers->cost( 0, arc.to ) )
+        {
+          buffers->setLabel( 0, arc.to, nextCost, mOutArcs[ i ] );
+          heap.push( arc.to, nextCost );
+        }
+      }
+    }
+
+    for ( int i = 0; i < targets.size(); ++i )
+    {
+      if ( targets.at( i ) >= 0 && targets.at( i ) < mVertexCount )
+        row.costs[ i ] = buffers->cost( 0, targets.at( i ) );
+    }
+
+    releaseSearchBuffers( std::move( buffers ) );
+  };
+
+  QtConcurrent::blockingMap( rows, solveRow );
+
+  QVector< QVector< double > > result;
+  result.reserve( sources.size() );
+  for ( Row &row : rows )
+    result << row.costs;
+  return result;
+}
@@ -0,0 +1,210 @@
+/***************************************************************************
+  qgsgraphrouter.h
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSGRAPHROUTER_H
+#define QGSGRAPHROUTER_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+#include "qgis.h"
+#include "qgis_analysis.h"
+
+class QgsGraph;
+class QgsFeedback;
+
+/**
+ * \ingroup analysis
+ * Routing engine answering repeated shortest path queries on a QgsGraph.
+ *
+ * The costs of the graph edges for the chosen strategy are read once when the
+ * router is created, so the graph must not be modified while the router is in use.
+ *
+ * Point to point queries use a bidirectional Dijkstra search which stops as soon
+ * as the shortest path between the two vertices is known. The graph can optionally be
+ * preprocessed with prepare(), which builds a contraction hierarchy: queries on a
+ * prepared router only explore a tiny part of the graph. As preprocessing large graphs
+ * takes time, the hierarchy can be saved with writeHierarchy() and reused with readHierarchy().
+ *
+ * Queries do not modify the router, and may be run concurrently from several threads. The
+ * buffers sized to the graph which they need are kept by the router and reused by later queries,
+ * so a router holds one set of buffers per query which ran at the same time.
+ *
+ * \since QGIS 3.2
+ */
+class ANALYSIS_EXPORT QgsGraphRouter
+{
+  public:
+
+    /**
+     * Constructor for QgsGraphRouter, for routing on a \a graph using the
+     * costs of the strategy with index \a strategyIndex. Costs must not be negative.
+     */
+    QgsGraphRouter( const QgsGraph *graph, int strategyIndex );
+
+    ~QgsGraphRouter();
+
+    //! QgsGraphRouter cannot be copied
+    QgsGraphRouter( const QgsGraphRouter &rh ) = delete;
+    //! QgsGraphRouter cannot be copied
+    QgsGraphRouter &operator=( const QgsGraphRouter &rh ) = delete;
+
+    /**
+     * Returns the graph used by the router.
+     */
+    const QgsGraph *graph() const { return mGraph; }
+
+    /**
+     * Returns the index of the strategy used for edge costs.
+     */
+    int strategyIndex() const { return mStrategyIndex; }
+
+    /**
+     * Returns the cost of the shortest path from the vertex with index \a fromVertexIdx to the
+     * vertex with index \a toVertexIdx, or infinity if the target cannot be reached.
+     *
+     * If \a edges is set, it will be filled with the indices of the graph edges along the path,
+     * in travel order.
+     */
+    double shortestPath( int fromVertexIdx, int toVertexIdx, QVector< int > *edges SIP_OUT = nullptr ) const;
+
+    /**
+     * Builds the contraction hierarchy used to speed up point to point queries.
+     *
+     * An optional \a feedback can be used to report progress and to cancel
+     * the preprocessing, in which case the router is left unprepared.
+     *
+     * \see isPrepared()
+     * \see writeHierarchy()
+     */
+    void prepare( QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns true if the router has a contraction hierarchy, either built with
+     * prepare() or loaded with readHierarchy().
+     */
+    bool isPrepared() const { return mPrepared; }
+
+    /**
+     * Returns the number of shortcut edges added by the contraction hierarchy.
+     */
+    int shortcutCount() const;
+
+    /**
+     * Saves the contraction hierarchy to the file at \a path.
+     * \returns false if the router is not prepared or the file cannot be written
+     * \see readHierarchy()
+     */
+    bool writeHierarchy( const QString &path ) const;
+
+    /**
+     * Loads a contraction hierarchy previously saved by writeHierarchy() from the file at \a path.
+     *
+     * The hierarchy must have been built for an identical graph and strategy. Only the vertex and
+     * edge counts and the strategy index can be checked, so it is the caller's responsibility
+     * to discard saved hierarchies when the network changes.
+     *
+     * \returns false if the file cannot be read or does not match the graph
+     * \see writeHierarchy()
+     */
+    bool readHierarchy( const QString &path );
+
+    /**
+     * Calculates the costs of the shortest paths between all \a sources and all \a targets
+     * vertex indices. The result contains one row per source and one column per target,
+     * unreachable targets having an infinite cost.
+     *
+     * Rows are calculated in parallel using the global thread pool. An optional
+     * \a feedback can be used to cancel the calculation, in which case the remaining
+     * costs are left to infinity.
+     */
+    QVector< QVector< double > > costMatrix( const QVector< int > &sources, const QVector< int > &targets, QgsFeedback *feedback = nullptr ) const;
+
+  private:
+
+#ifdef SIP_RUN
+    QgsGraphRouter( const QgsGraphRouter &rh );
+#endif
+
+    //! Directed arc between two graph vertices, either an original graph edge or a shortcut
+    struct Arc
+    {
+      int from;
+      int to;
+      double cost;
+      //! Index of the graph edge, or -1 for shortcuts
+      int edge;
+      //! Arcs replaced by a shortcut
+      int firstChild;
+      int secondChild;
+    };
+
+    struct SearchBuffers;
+
+    //! Returns buffers for a search, reused from a previous query if possible
+    std::unique_ptr< SearchBuffers > takeSearchBuffers() const;
+
+    //! Gives back the buffers of a finished search, for use by the next queries
+    void releaseSearchBuffers( std::unique_ptr< SearchBuffers > buffers ) const;
+
+    //! Bidirectional Dijkstra search on the original graph
+    double bidirectionalSearch( int fromVertexIdx, int toVertexIdx, QVector< int > *edges ) const;
+
+    //! Bidirectional search on the upward graphs of the contraction hierarchy
+    double hierarchySearch( int fromVertexIdx, int toVertexIdx, QVector< int > *edges ) const;
+
+    //! Appends the graph edges represented by an arc to \a edges
+    void unpackArc( int arc, QVector< int > &edges ) const;
+
+    //! Builds the upward graphs from the vertex ranks and the arcs
+    void buildUpwardGraphs();
+
+    //! Drops the contraction hierarchy
+    void clearHierarchy();
+
+    const QgsGraph *mGraph = nullptr;
+    int mStrategyIndex = 0;
+    int mVertexCount = 0;
+    int mEdgeCount = 0;
+
+    //! Original edges followed by the shortcuts of the hierarchy
+    std::vector< Arc > mArcs;
+
+    //! Outgoing and incoming arcs of the original graph in compressed row form
+    std::vector< int > mOutOffsets;
+    std::vector< int > mOutArcs;
+    std::vector< int > mInOffsets;
+    std::vector< int > mInArcs;
+
+    bool mPrepared = false;
+    //! Contraction order of the vertices
+    std::vector< int > mRanks;
+    //! Arcs leading to a higher ranked vertex, by source vertex
+    std::vector< int > mUpOffsets;
+    std::vector< int > mUpArcs;
+    //! Arcs coming from a higher ranked vertex, by target vertex
+    std::vector< int > mDownOffsets;
+    std::vector< int > mDownArcs;
+
+    //! Search buffers not used by a running query
+    mutable std::vector< std::unique_ptr< SearchBuffers > > mSearchBuffers;
+    //! Mutex to protect the search buffers
+    mutable QMutex mSearchBuffersMutex;
+};
+
+#endif // QGSGRAPHROUTER_H
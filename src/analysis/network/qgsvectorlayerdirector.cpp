@@ -31,6 +31,10 @@
 
 #include <QString>
 #include <QtAlgorithms>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
 
 #include "SpatialIndex.h"
 
@@ -116,54 +120,143 @@ QgsVectorLayerDirector::Direction QgsVectorLayerDirector::directionForFeature( c
 class QgsNetworkVisitor : public SpatialIndex::IVisitor
 {
   public:
-    explicit QgsNetworkVisitor( QVector< int > &pointIndexes )
-      : mPoints( pointIndexes ) {}
+    explicit QgsNetworkVisitor( QList< QgsFeatureId > &ids )
+      : mIds( ids ) {}
 
     void visitNode( const INode &n ) override
     { Q_UNUSED( n ); }
 
     void visitData( const IData &d ) override
     {
-      mPoints.append( d.getIdentifier() );
+      mIds.append( d.getIdentifier() );
     }
 
     void visitData( std::vector<const IData *> &v ) override
     { Q_UNUSED( v ); }
 
   private:
-    QVector< int > &mPoints;
+    QList< QgsFeatureId > &mIds;
 };
 
-///@endcond
+/**
+ * Bulk loading stream for an R-tree of network feature extents.
+ */
+class QgsNetworkExtentStream : public SpatialIndex::IDataStream
+{
+  public:
+    explicit QgsNetworkExtentStream( const QVector< QPair< QgsFeatureId, QgsRectangle > > &extents )
+      : mExtents( extents ) {}
+
+    IData *getNext() override
+    {
+      const QPair< QgsFeatureId, QgsRectangle > &extent = mExtents.at( mIndex++ );
+      double low[] = { extent.second.xMinimum(), extent.second.yMinimum() };
+      double high[] = { extent.second.xMaximum(), extent.second.yMaximum() };
+      return new RTree::Data( 0, nullptr, SpatialIndex::Region( low, high, 2 ), extent.first );
+    }
 
-std::unique_ptr< SpatialIndex::ISpatialIndex > createVertexSpatialIndex( SpatialIndex::IStorageManager &storageManager )
+    bool hasNext() override { return mIndex < mExtents.size(); }
+
+    uint32_t size() override { return static_cast< uint32_t >( mExtents.size() ); }
+
+    void rewind() override { mIndex = 0; }
+
+  private:
+    const QVector< QPair< QgsFeatureId, QgsRectangle > > &mExtents;
+    int mIndex = 0;
+};
+
+/**
+ * Hash grid of the graph vertices. Cells are at least as large as the topology
+ * tolerance, so looking for a vertex within tolerance of a point only has to
+ * check the cells around it.
+ */
+class QgsNetworkVertexGrid
 {
-  // R-Tree parameters
-  double fillFactor = 0.7;
-  unsigned long indexCapacity = 10;
-  unsigned long leafCapacity = 10;
-  unsigned long dimension = 2;
-  RTree::RTreeVariant variant = RTree::RV_RSTAR;
-
-  // create R-tree
-  SpatialIndex::id_type indexId;
-  std::unique_ptr< SpatialIndex::ISpatialIndex > iRTree( RTree::createNewRTree( storageManager, fillFactor, indexCapacity,
-      leafCapacity, dimension, variant, indexId ) );
-  return iRTree;
-}
+  public:
+    explicit QgsNetworkVertexGrid( double tolerance )
+      : mTolerance( tolerance )
+      , mCellSize( std::max( tolerance, 1e-6 ) )
+    {}
+
+    /**
+     * Returns the index of the first added vertex within tolerance of \a point, or -1
+     * if there is none.
+     */
+    int findVertex( const QgsPointXY &point ) const
+    {
+      int result = -1;
+      const qint64 maxX = cell( point.x() + mTolerance );
+      const qint64 maxY = cell( point.y() + mTolerance );
+      for ( qint64 x = cell( point.x() - mTolerance ); x <= maxX; ++x )
+      {
+        for ( qint64 y = cell( point.y() - mTolerance ); y <= maxY; ++y )
+        {
+          const QPair< qint64, qint64 > key( x, y );
+          for ( auto it = mCells.constFind( key ); it != mCells.constEnd() && it.key() == key; ++it )
+          {
+            const QgsPointXY &vertex = mVertices.at( it.value() );
+            if ( std::fabs( vertex.x() - point.x() ) <= mTolerance && std::fabs( vertex.y() - point.y() ) <= mTolerance
+                 && ( result < 0 || it.value() < result ) )
+              result = it.value();
+          }
+        }
+      }
+      return result;
+    }
+
+    //! Adds a vertex and returns its index
+    int addVertex( const QgsPointXY &point )
+    {
+      const int index = mVertices.count();
+      mVertices.append( point );
+      mCells.insert( qMakePair( cell( point.x() ), cell( point.y() ) ), index );
+      return index;
+    }
+
+    //! Returns the vertex at \a index
+    const QgsPointXY &vertex( int index ) const { return mVertices.at( index ); }
+
+    //! Returns all the vertices, in the order they were added
+    const QVector< QgsPointXY > &vertices() const { return mVertices; }
+
+  private:
+    qint64 cell( double value ) const { return static_cast< qint64 >( std::floor( value / mCellSize ) ); }
 
-int findClosestVertex( const QgsPointXY &point, SpatialIndex::ISpatialIndex *index, double tolerance )
+    double mTolerance;
+    double mCellSize;
+    QVector< QgsPointXY > mVertices;
+    QMultiHash< QPair< qint64, qint64 >, int > mCells;
+};
+
+//! Segment of a network feature, between two graph vertices
+struct NetworkSegment
 {
-  QVector< int > matching;
-  QgsNetworkVisitor visitor( matching );
+  int fromVertex;
+  int toVertex;
+  double distance;
+};
 
-  double pt1[2] = { point.x() - tolerance, point.y() - tolerance },
-                  pt2[2] = { point.x() + tolerance, point.y() + tolerance };
-  SpatialIndex::Region searchRegion( pt1, pt2, 2 );
+//! Network feature and its segments, once split at the tie points
+struct NetworkFeatureSegments
+{
+  QgsFeature feature;
+  QVector< NetworkSegment > segments;
+};
+
+//! Number of network features for which segments are computed in parallel at once
+static const int SEGMENT_BATCH_SIZE = 1000;
 
-  index->intersectsWithQuery( searchRegion, visitor );
+///@endcond
 
-  return matching.empty() ? -1 : matching.at( 0 );
+static QgsMultiPolylineXY networkLines( const QgsFeature &feature )
+{
+  QgsMultiPolylineXY mpl;
+  if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::MultiLineString )
+    mpl = feature.geometry().asMultiPolyline();
+  else if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::LineString )
+    mpl.push_back( feature.geometry().asPolyline() );
+  return mpl;
 }
 
 void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const QVector< QgsPointXY > &additionalPoints,
@@ -185,24 +278,14 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
   QVector< TiePointInfo > additionalTiePoints( additionalPoints.size() );
 
   // graph's vertices = all vertices in graph, with vertices within builder's tolerance collapsed together
-  QVector< QgsPointXY > graphVertices;
+  QgsNetworkVertexGrid graphVertices( std::max( builder->topologyTolerance(), 1e-10 ) );
 
-  // spatial index for graph vertices
-  std::unique_ptr< SpatialIndex::IStorageManager > iStorage( StorageManager::createNewMemoryStorageManager() );
-  std::unique_ptr< SpatialIndex::ISpatialIndex > iRTree = createVertexSpatialIndex( *iStorage );
+  // extents of the network features, used to find the lines closest to the additional points
+  QVector< QPair< QgsFeatureId, QgsRectangle > > featureExtents;
+  // position of the network features in the source, to resolve ties between segments as when checking every feature
+  QHash< QgsFeatureId, int > sourcePositions;
 
-  double tolerance = std::max( builder->topologyTolerance(), 1e-10 );
-  auto findPointWithinTolerance = [&iRTree, tolerance]( const QgsPointXY & point )->int
-  {
-    return findClosestVertex( point, iRTree.get(), tolerance );
-  };
-  auto addPointToIndex = [&iRTree]( const QgsPointXY & point, int index )
-  {
-    double coords[] = {point.x(), point.y()};
-    iRTree->insertData( 0, nullptr, SpatialIndex::Point( coords, 2 ), index );
-  };
-
-  // first iteration - get all nodes from network, and snap additional points to network
+  // first iteration - get all nodes from network
   QgsFeatureIterator fit = mSource->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
   QgsFeature feature;
   while ( fit.nextFeature( feature ) )
@@ -210,40 +293,102 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
     if ( feedback && feedback->isCanceled() )
       return;
 
-    QgsMultiPolylineXY mpl;
-    if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::MultiLineString )
-      mpl = feature.geometry().asMultiPolyline();
-    else if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::LineString )
-      mpl.push_back( feature.geometry().asPolyline() );
-
-    for ( const QgsPolylineXY &line : qgis::as_const( mpl ) )
+    QgsRectangle extent;
+    extent.setMinimal();
+    bool hasVertices = false;
+    const QgsMultiPolylineXY mpl = networkLines( feature );
+    for ( const QgsPolylineXY &line : mpl )
     {
-      QgsPointXY pt1, pt2;
-      bool isFirstPoint = true;
       for ( const QgsPointXY &point : line )
       {
-        pt2 = ct.transform( point );
+        QgsPointXY pt = ct.transform( point );
 
-        int pt2Idx = findPointWithinTolerance( pt2 ) ;
-        if ( pt2Idx == -1 )
+        int ptIdx = graphVertices.findVertex( pt );
+        if ( ptIdx == -1 )
         {
           // no vertex already exists within tolerance - add to points, and index
-          addPointToIndex( pt2, graphVertices.count() );
-          graphVertices.push_back( pt2 );
+          graphVertices.addVertex( pt );
         }
         else
         {
           // vertex already exists within tolerance - use that
-          pt2 = graphVertices.at( pt2Idx );
+          pt = graphVertices.vertex( ptIdx );
         }
+        extent.combineExtentWith( pt.x(), pt.y() );
+        hasVertices = true;
+      }
+    }
 
-        if ( !isFirstPoint )
+    if ( !additionalPoints.isEmpty() && hasVertices )
+    {
+      sourcePositions.insert( feature.id(), featureExtents.size() );
+      featureExtents << qMakePair( feature.id(), extent );
+    }
+
+    if ( feedback )
+      feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
+  }
+
+  // snap additional points to the closest network segment
+  if ( !additionalPoints.isEmpty() && !featureExtents.isEmpty() )
+  {
+    QgsNetworkExtentStream stream( featureExtents );
+    std::unique_ptr< SpatialIndex::IStorageManager > storage( StorageManager::createNewMemoryStorageManager() );
+    SpatialIndex::id_type indexId;
+    std::unique_ptr< SpatialIndex::ISpatialIndex > extentIndex( RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, stream, *storage, 0.7, 10, 10, 2, RTree::RV_RSTAR, indexId ) );
+
+    // lines of the network features near the additional points, with their vertices snapped to the graph vertices
+    QHash< QgsFeatureId, QgsMultiPolylineXY > candidateLines;
+
+    // reads the lines of the features which were not read yet, with a single request for all the additional points
+    auto fetchLines = [&]( const QgsFeatureIds &ids )
+    {
+      QgsFeatureIds missing;
+      for ( QgsFeatureId id : ids )
+      {
+        if ( !candidateLines.contains( id ) )
+          missing << id;
+      }
+      if ( missing.isEmpty() )
+        return;
+
+      QgsFeatureIterator it = mSource->getFeatures( QgsFeatureRequest().setFilterFids( missing ).setSubsetOfAttributes( QgsAttributeList() ) );
+      QgsFeature f;
+      while ( it.nextFeature( f ) )
+      {
+        QgsMultiPolylineXY mpl = networkLines( f );
+        for ( QgsPolylineXY &line : mpl )
         {
-          // check if this line segment is a candidate for being closest to each additional point
-          int i = 0;
-          for ( const QgsPointXY &additionalPoint : additionalPoints )
-          {
+          for ( QgsPointXY &point : line )
+            point = graphVertices.vertex( graphVertices.findVertex( ct.transform( point ) ) );
+        }
+        candidateLines.insert( f.id(), mpl );
+      }
+    };
+
+    // checks the segments of network features as candidates for being closest to an additional point
+    auto checkFeatures = [&]( QList< QgsFeatureId > ids, int i )
+    {
+      const QgsPointXY &additionalPoint = additionalPoints.at( i );
+
+      // the spatial index returns the features in any order, resolve ties in source order
+      std::sort( ids.begin(), ids.end(), [&sourcePositions]( QgsFeatureId a, QgsFeatureId b )
+      {
+        return sourcePositions.value( a ) < sourcePositions.value( b );
+      } );
 
+      for ( QgsFeatureId id : qgis::as_const( ids ) )
+      {
+        const auto lines = candidateLines.constFind( id );
+        if ( lines == candidateLines.constEnd() )
+          continue;
+
+        for ( const QgsPolylineXY &line : lines.value() )
+        {
+          for ( int j = 1; j < line.size(); ++j )
+          {
+            const QgsPointXY &pt1 = line.at( j - 1 );
+            const QgsPointXY &pt2 = line.at( j );
             QgsPointXY snappedPoint;
             double thisSegmentClosestDist = DBL_MAX;
             if ( pt1 == pt2 )
@@ -260,22 +405,66 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
             if ( thisSegmentClosestDist < additionalTiePoints[ i ].mLength )
             {
               // found a closer segment for this additional point
-              TiePointInfo info( i, feature.id(), pt1, pt2 );
+              TiePointInfo info( i, id, pt1, pt2 );
               info.mLength = thisSegmentClosestDist;
               info.mTiedPoint = snappedPoint;
 
               additionalTiePoints[ i ] = info;
               snappedPoints[ i ] = info.mTiedPoint;
             }
-            i++;
           }
         }
-        pt1 = pt2;
-        isFirstPoint = false;
       }
+    };
+
+    // the feature with the closest extent gives an upper bound for the distance of each point to the network...
+    QVector< QList< QgsFeatureId > > nearest( additionalPoints.size() );
+    QgsFeatureIds ids;
+    for ( int i = 0; i < additionalPoints.size(); ++i )
+    {
+      double coords[] = { additionalPoints.at( i ).x(), additionalPoints.at( i ).y() };
+      QgsNetworkVisitor nearestVisitor( nearest[ i ] );
+      extentIndex->nearestNeighborQuery( 1, SpatialIndex::Point( coords, 2 ), nearestVisitor );
+      for ( QgsFeatureId id : qgis::as_const( nearest[ i ] ) )
+        ids << id;
+    }
+
+    if ( feedback && feedback->isCanceled() )
+      return;
+    fetchLines( ids );
+
+    // ...and the closest segment belongs to one of the features with an extent within that distance
+    QVector< QList< QgsFeatureId > > candidates( additionalPoints.size() );
+    ids.clear();
+    for ( int i = 0; i < additionalPoints.size(); ++i )
+    {
+      checkFeatures( nearest.at( i ), i );
+      if ( additionalTiePoints.at( i ).mLength == DBL_MAX )
+        continue;
+
+      const QgsPointXY &additionalPoint = additionalPoints.at( i );
+      const double distance = std::sqrt( additionalTiePoints.at( i ).mLength );
+      double low[] = { additionalPoint.x() - distance, additionalPoint.y() - distance };
+      double high[] = { additionalPoint.x() + distance, additionalPoint.y() + distance };
+      QgsNetworkVisitor candidatesVisitor( candidates[ i ] );
+      extentIndex->intersectsWithQuery( SpatialIndex::Region( low, high, 2 ), candidatesVisitor );
+      for ( QgsFeatureId id : qgis::as_const( candidates[ i ] ) )
+        ids << id;
+    }
+
+    if ( feedback && feedback->isCanceled() )
+      return;
+    fetchLines( ids );
+
+    // these are all checked again in source order, so that ties are resolved as when checking every feature of the network
+    for ( int i = 0; i < additionalPoints.size(); ++i )
+    {
+      if ( candidates.at( i ).isEmpty() || candidates.at( i ) == nearest.at( i ) )
+        continue;
+
+      additionalTiePoints[ i ] = TiePointInfo();
+      checkFeatures( candidates.at( i ), i );
     }
-    if ( feedback )
-      feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
   }
 
   // build a hash of feature ids to tie points which depend on this feature
@@ -292,17 +481,16 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
   {
     // check index to see if vertex exists within tolerance of tie point
     const QgsPointXY point = snappedPoints.at( i );
-    int ptIdx = findPointWithinTolerance( point );
+    int ptIdx = graphVertices.findVertex( point );
     if ( ptIdx == -1 )
     {
       // no vertex already within tolerance, add to index and network vertices
-      addPointToIndex( point, graphVertices.count() );
-      graphVertices.push_back( point );
+      graphVertices.addVertex( point );
     }
     else
     {
       // otherwise snap tie point to vertex
-      snappedPoints[ i ] = graphVertices.at( ptIdx );
+      snappedPoints[ i ] = graphVertices.vertex( ptIdx );
     }
   }
   // also need to update tie points - they need to be matched for snapped points
@@ -317,29 +505,20 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
   // add vertices to graph
   {
     int i = 0;
-    for ( const QgsPointXY &point : graphVertices )
+    for ( const QgsPointXY &point : graphVertices.vertices() )
     {
       builder->addVertex( i, point );
       i++;
     }
   }
 
-  fit = mSource->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( requiredAttributes() ) );
-  while ( fit.nextFeature( feature ) )
+  // splits a network feature into segments between graph vertices. This only reads shared
+  // state, so that features can be processed in parallel
+  const QgsDistanceArea *distanceArea = builder->distanceArea();
+  auto splitFeature = [&]( NetworkFeatureSegments & networkFeature )
   {
-    if ( feedback && feedback->isCanceled() )
-      return;
-
-    Direction direction = directionForFeature( feature );
-
-    // begin features segments and add arc to the Graph;
-    QgsMultiPolylineXY mpl;
-    if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::MultiLineString )
-      mpl = feature.geometry().asMultiPolyline();
-    else if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::LineString )
-      mpl.push_back( feature.geometry().asPolyline() );
-
-    for ( const QgsPolylineXY &line : qgis::as_const( mpl ) )
+    const QgsMultiPolylineXY mpl = networkLines( networkFeature.feature );
+    for ( const QgsPolylineXY &line : mpl )
     {
       QgsPointXY pt1, pt2;
 
@@ -347,9 +526,9 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
       for ( const QgsPointXY &point : line )
       {
         pt2 = ct.transform( point );
-        int pPt2idx = findPointWithinTolerance( pt2 );
+        int pPt2idx = graphVertices.findVertex( pt2 );
         Q_ASSERT_X( pPt2idx >= 0, "QgsVectorLayerDirectory::makeGraph", "encountered a vertex which was not present in graph" );
-        pt2 = graphVertices.at( pPt2idx );
+        pt2 = graphVertices.vertex( pPt2idx );
 
         if ( !isFirstPoint )
         {
@@ -357,7 +536,7 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
           pointsOnArc[ 0.0 ] = pt1;
           pointsOnArc[ pt1.sqrDist( pt2 )] = pt2;
 
-          const QList< int > tiePointsForCurrentFeature = tiePointNetworkFeatures.value( feature.id() );
+          const QList< int > tiePointsForCurrentFeature = tiePointNetworkFeatures.value( networkFeature.feature.id() );
           for ( int tiePointIdx : tiePointsForCurrentFeature )
           {
             const TiePointInfo &t = additionalTiePoints.at( tiePointIdx );
@@ -376,29 +555,13 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
           {
             arcPt2 = arcPointIt.value();
 
-            pt2idx = findPointWithinTolerance( arcPt2 );
+            pt2idx = graphVertices.findVertex( arcPt2 );
             Q_ASSERT_X( pt2idx >= 0, "QgsVectorLayerDirectory::makeGraph", "encountered a vertex which was not present in graph" );
-            arcPt2 = graphVertices.at( pt2idx );
+            arcPt2 = graphVertices.vertex( pt2idx );
 
             if ( !isFirstPoint && arcPt1 != arcPt2 )
             {
-              double distance = builder->distanceArea()->measureLine( arcPt1, arcPt2 );
-              QVector< QVariant > prop;
-              for ( QgsNetworkStrategy *strategy : mStrategies )
-              {
-                prop.push_back( strategy->cost( distance, feature ) );
-              }
-
-              if ( direction == Direction::DirectionForward ||
-                   direction == Direction::DirectionBoth )
-              {
-                builder->addEdge( pt1idx, arcPt1, pt2idx, arcPt2, prop );
-              }
-              if ( direction == Direction::DirectionBackward ||
-                   direction == Direction::DirectionBoth )
-              {
-                builder->addEdge( pt2idx, arcPt2, pt1idx, arcPt1, prop );
-              }
+              networkFeature.segments.append( NetworkSegment{ pt1idx, pt2idx, distanceArea->measureLine( arcPt1, arcPt2 ) } );
             }
             pt1idx = pt2idx;
             arcPt1 = arcPt2;
@@ -409,10 +572,65 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
         isFirstPoint = false;
       }
     }
-    if ( feedback )
+  };
+
+  // second iteration - split features into segments in parallel batches, then add
+  // the edges to the graph in feature order. Strategies and the builder are only
+  // used from this thread, as they may not be thread safe
+  fit = mSource->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( requiredAttributes() ) );
+  QVector< NetworkFeatureSegments > batch;
+  bool finished = false;
+  while ( !finished )
+  {
+    batch.clear();
+    while ( batch.size() < SEGMENT_BATCH_SIZE )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
+      if ( !fit.nextFeature( feature ) )
+      {
+        finished = true;
+        break;
+      }
+      batch.append( NetworkFeatureSegments{ feature, QVector< NetworkSegment >() } );
     }
 
+    if ( feedback && feedback->isCanceled() )
+      return;
+
+    QtConcurrent::blockingMap( batch, splitFeature );
+
+    for ( const NetworkFeatureSegments &networkFeature : qgis::as_const( batch ) )
+    {
+      if ( feedback && feedback->isCanceled() )
+        return;
+
+      Direction direction = directionForFeature( networkFeature.feature );
+
+      for ( const NetworkSegment &segment : networkFeature.segments )
+      {
+        QVector< QVariant > prop;
+        for ( QgsNetworkStrategy *strategy : mStrategies )
+        {
+          prop.push_back( strategy->cost( segment.distance, networkFeature.feature ) );
+        }
+
+        const QgsPointXY &arcPt1 = graphVertices.vertex( segment.fromVertex );
+        const QgsPointXY &arcPt2 = graphVertices.vertex( segment.toVertex );
+        if ( direction == Direction::DirectionForward ||
+             direction == Direction::DirectionBoth )
+        {
+          builder->addEdge( segment.fromVertex, arcPt1, segment.toVertex, arcPt2, prop );
+        }
+        if ( direction == Direction::DirectionBackward ||
+             direction == Direction::DirectionBoth )
+        {
+          builder->addEdge( segment.toVertex, arcPt2, segment.fromVertex, arcPt1, prop );
+        }
+      }
+
+      if ( feedback )
+      {
+        feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
+      }
+    }
   }
 }
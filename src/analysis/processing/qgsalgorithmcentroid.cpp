@@ -61,6 +61,11 @@ QgsCentroidAlgorithm *QgsCentroidAlgorithm::createInstance() const
   return new QgsCentroidAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsCentroidAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 void QgsCentroidAlgorithm::initParameters( const QVariantMap & )
 {
   std::unique_ptr< QgsProcessingParameterBoolean> allParts = qgis::make_unique< QgsProcessingParameterBoolean >(
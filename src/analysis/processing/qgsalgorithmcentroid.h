@@ -41,6 +41,7 @@ class QgsCentroidAlgorithm : public QgsProcessingFeatureBasedAlgorithm
     QString groupId() const override;
     QString shortHelpString() const override;
     QgsCentroidAlgorithm *createInstance() const override SIP_FACTORY;
+    Flags flags() const override;
     void initParameters( const QVariantMap &configuration = QVariantMap() ) override;
 
   protected:
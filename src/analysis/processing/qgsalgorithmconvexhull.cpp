@@ -61,6 +61,11 @@ QgsConvexHullAlgorithm *QgsConvexHullAlgorithm::createInstance() const
   return new QgsConvexHullAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsConvexHullAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 QgsFields QgsConvexHullAlgorithm::outputFields( const QgsFields &inputFields ) const
 {
   QgsFields fields = inputFields;
@@ -42,6 +42,7 @@ class QgsConvexHullAlgorithm : public QgsProcessingFeatureBasedAlgorithm
     QString groupId() const override;
     QString shortHelpString() const override;
     QgsConvexHullAlgorithm *createInstance() const override SIP_FACTORY;
+    Flags flags() const override;
 
   protected:
     QString outputName() const override;
@@ -127,27 +127,42 @@ QVariantMap QgsExtractByExpressionAlgorithm::processAlgorithm( const QVariantMap
     expressionContext.setFields( source->fields() );
     expression.prepare( &expressionContext );
 
+    // features are evaluated by blocks, which is much faster than one by one
+    const int blockSize = 1024;
+    QgsFeatureList features;
+    features.reserve( blockSize );
+
     QgsFeatureIterator it = source->getFeatures();
     QgsFeature f;
-    while ( it.nextFeature( f ) )
+    bool hasFeature = it.nextFeature( f );
+    while ( hasFeature )
     {
       if ( feedback->isCanceled() )
       {
         break;
       }
 
-      expressionContext.setFeature( f );
-      if ( expression.evaluate( &expressionContext ).toBool() )
-      {
-        matchingSink->addFeature( f, QgsFeatureSink::FastInsert );
-      }
-      else
+      features << f;
+      hasFeature = it.nextFeature( f );
+      if ( features.size() < blockSize && hasFeature )
+        continue;
+
+      const QBitArray matching = expression.filterFeatures( features, &expressionContext );
+      for ( int i = 0; i < features.size(); ++i )
       {
-        nonMatchingSink->addFeature( f, QgsFeatureSink::FastInsert );
+        if ( matching.testBit( i ) )
+        {
+          matchingSink->addFeature( features[i], QgsFeatureSink::FastInsert );
+        }
+        else
+        {
+          nonMatchingSink->addFeature( features[i], QgsFeatureSink::FastInsert );
+        }
+
+        feedback->setProgress( current * step );
+        current++;
       }
-
-      feedback->setProgress( current * step );
-      current++;
+      features.clear();
     }
   }
 
@@ -72,6 +72,11 @@ QgsFixGeometriesAlgorithm *QgsFixGeometriesAlgorithm::createInstance() const
   return new QgsFixGeometriesAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsFixGeometriesAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 QgsFeatureList QgsFixGeometriesAlgorithm::processFeature( const QgsFeature &feature, QgsProcessingContext &, QgsProcessingFeedback *feedback )
 {
   if ( !feature.hasGeometry() )
@@ -17,6 +17,7 @@
 
 #include "qgsalgorithmlineintersection.h"
 #include "qgsgeometryengine.h"
+#include "qgspackedspatialindex.h"
 
 ///@cond PRIVATE
 
@@ -144,7 +145,7 @@ QVariantMap QgsLineIntersectionAlgorithm::processAlgorithm( const QVariantMap &p
   if ( !sink )
     return QVariantMap();
 
-  QgsSpatialIndex spatialIndex( sourceB->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ).setDestinationCrs( sourceA->sourceCrs(), context.transformContext() ) ), feedback );
+  QgsPackedSpatialIndex spatialIndex( sourceB->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ).setDestinationCrs( sourceA->sourceCrs(), context.transformContext() ) ), feedback );
   QgsFeature outFeature;
   QgsFeatureIterator features = sourceA->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( fieldsAIndices ) );
   double step = sourceA->featureCount() > 0 ? 100.0 / sourceA->featureCount() : 1;
@@ -59,6 +59,11 @@ QgsMultiRingConstantBufferAlgorithm *QgsMultiRingConstantBufferAlgorithm::create
   return new QgsMultiRingConstantBufferAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsMultiRingConstantBufferAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 void QgsMultiRingConstantBufferAlgorithm::initParameters( const QVariantMap & )
 {
   std::unique_ptr< QgsProcessingParameterNumber> rings = qgis::make_unique< QgsProcessingParameterNumber >( QStringLiteral( "RINGS" ),
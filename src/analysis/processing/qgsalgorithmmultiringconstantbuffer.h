@@ -41,6 +41,7 @@ class QgsMultiRingConstantBufferAlgorithm : public QgsProcessingFeatureBasedAlgo
     QString groupId() const override;
     QString shortHelpString() const override;
     QgsMultiRingConstantBufferAlgorithm *createInstance() const override SIP_FACTORY;
+    Flags flags() const override;
     void initParameters( const QVariantMap &configuration = QVariantMap() ) override;
 
   protected:
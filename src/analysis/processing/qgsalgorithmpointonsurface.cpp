@@ -60,6 +60,11 @@ QgsPointOnSurfaceAlgorithm *QgsPointOnSurfaceAlgorithm::createInstance() const
   return new QgsPointOnSurfaceAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsPointOnSurfaceAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 void QgsPointOnSurfaceAlgorithm::initParameters( const QVariantMap & )
 {
   std::unique_ptr< QgsProcessingParameterBoolean> allParts = qgis::make_unique< QgsProcessingParameterBoolean >(
@@ -62,6 +62,11 @@ QgsSegmentizeByMaximumDistanceAlgorithm *QgsSegmentizeByMaximumDistanceAlgorithm
   return new QgsSegmentizeByMaximumDistanceAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsSegmentizeByMaximumDistanceAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 QList<int> QgsSegmentizeByMaximumDistanceAlgorithm::inputLayerTypes() const
 {
   return QList<int>() << QgsProcessing::TypeVectorLine << QgsProcessing::TypeVectorPolygon;
@@ -151,6 +156,11 @@ QgsSegmentizeByMaximumAngleAlgorithm *QgsSegmentizeByMaximumAngleAlgorithm::crea
   return new QgsSegmentizeByMaximumAngleAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsSegmentizeByMaximumAngleAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 QList<int> QgsSegmentizeByMaximumAngleAlgorithm::inputLayerTypes() const
 {
   return QList<int>() << QgsProcessing::TypeVectorLine << QgsProcessing::TypeVectorPolygon;
@@ -42,6 +42,7 @@ class QgsSegmentizeByMaximumDistanceAlgorithm : public QgsProcessingFeatureBased
     QString groupId() const override;
     QString shortHelpString() const override;
     QgsSegmentizeByMaximumDistanceAlgorithm *createInstance() const override SIP_FACTORY;
+    Flags flags() const override;
     QList<int> inputLayerTypes() const override;
     void initParameters( const QVariantMap &configuration = QVariantMap() ) override;
 
@@ -75,6 +76,7 @@ class QgsSegmentizeByMaximumAngleAlgorithm : public QgsProcessingFeatureBasedAlg
     QString groupId() const override;
     QString shortHelpString() const override;
     QgsSegmentizeByMaximumAngleAlgorithm *createInstance() const override SIP_FACTORY;
+    Flags flags() const override;
     QList<int> inputLayerTypes() const override;
     void initParameters( const QVariantMap &configuration = QVariantMap() ) override;
 
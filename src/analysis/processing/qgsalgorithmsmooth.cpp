@@ -77,6 +77,11 @@ QgsSmoothAlgorithm *QgsSmoothAlgorithm::createInstance() const
   return new QgsSmoothAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsSmoothAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 QList<int> QgsSmoothAlgorithm::inputLayerTypes() const
 {
   return QList<int>() << QgsProcessing::TypeVectorLine << QgsProcessing::TypeVectorPolygon;
@@ -65,6 +65,11 @@ QgsSnapToGridAlgorithm *QgsSnapToGridAlgorithm::createInstance() const
   return new QgsSnapToGridAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsSnapToGridAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 void QgsSnapToGridAlgorithm::initParameters( const QVariantMap & )
 {
   std::unique_ptr< QgsProcessingParameterNumber> hSpacing = qgis::make_unique< QgsProcessingParameterNumber >( QStringLiteral( "HSPACING" ),
@@ -17,6 +17,7 @@
 
 #include "qgsalgorithmsplitwithlines.h"
 #include "qgsgeometryengine.h"
+#include "qgspackedspatialindex.h"
 
 ///@cond PRIVATE
 
@@ -83,8 +84,9 @@ QVariantMap QgsSplitWithLinesAlgorithm::processAlgorithm( const QVariantMap &par
   if ( !sink )
     return QVariantMap();
 
-  QgsSpatialIndex spatialIndex;
   QMap< QgsFeatureId, QgsGeometry > splitGeoms;
+  QList< QgsFeatureId > splitIds;
+  QList< QgsRectangle > splitBounds;
   QgsFeatureRequest request;
   request.setSubsetOfAttributes( QgsAttributeList() );
   request.setDestinationCrs( source->sourceCrs(), context.transformContext() );
@@ -99,9 +101,16 @@ QVariantMap QgsSplitWithLinesAlgorithm::processAlgorithm( const QVariantMap &par
     }
 
     splitGeoms.insert( aSplitFeature.id(), aSplitFeature.geometry() );
-    spatialIndex.insertFeature( aSplitFeature );
+    if ( aSplitFeature.hasGeometry() )
+    {
+      splitIds << aSplitFeature.id();
+      splitBounds << aSplitFeature.geometry().boundingBox();
+    }
   }
 
+  // the index is only queried once built
+  const QgsPackedSpatialIndex spatialIndex( splitIds, splitBounds );
+
   QgsFeature outFeat;
   QgsFeatureIterator features = source->getFeatures();
 
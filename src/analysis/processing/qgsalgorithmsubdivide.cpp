@@ -70,6 +70,11 @@ QgsSubdivideAlgorithm *QgsSubdivideAlgorithm::createInstance() const
   return new QgsSubdivideAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsSubdivideAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 QString QgsSubdivideAlgorithm::outputName() const
 {
   return QObject::tr( "Subdivided" );
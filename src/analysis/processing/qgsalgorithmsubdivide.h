@@ -42,6 +42,7 @@ class QgsSubdivideAlgorithm : public QgsProcessingFeatureBasedAlgorithm
     QString groupId() const override;
     QString shortHelpString() const override;
     QgsSubdivideAlgorithm *createInstance() const override SIP_FACTORY;
+    Flags flags() const override;
 
   protected:
     QString outputName() const override;
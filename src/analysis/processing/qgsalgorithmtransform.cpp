@@ -72,6 +72,11 @@ QgsTransformAlgorithm *QgsTransformAlgorithm::createInstance() const
   return new QgsTransformAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsTransformAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 bool QgsTransformAlgorithm::prepareAlgorithm( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback * )
 {
   mDestCrs = parameterAsCrs( parameters, QStringLiteral( "TARGET_CRS" ), context );
@@ -61,6 +61,11 @@ QgsTranslateAlgorithm *QgsTranslateAlgorithm::createInstance() const
   return new QgsTranslateAlgorithm();
 }
 
+QgsProcessingAlgorithm::Flags QgsTranslateAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing;
+}
+
 void QgsTranslateAlgorithm::initParameters( const QVariantMap & )
 {
   std::unique_ptr< QgsProcessingParameterNumber > xOffset = qgis::make_unique< QgsProcessingParameterNumber >( QStringLiteral( "DELTA_X" ),
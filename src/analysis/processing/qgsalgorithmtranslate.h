@@ -41,6 +41,7 @@ class QgsTranslateAlgorithm : public QgsProcessingFeatureBasedAlgorithm
     QString groupId() const override;
     QString shortHelpString() const override;
     QgsTranslateAlgorithm *createInstance() const override SIP_FACTORY;
+    Flags flags() const override;
     void initParameters( const QVariantMap &configuration = QVariantMap() ) override;
 
   protected:
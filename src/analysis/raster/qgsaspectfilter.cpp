@@ -17,6 +17,21 @@
 
 #include "qgsaspectfilter.h"
 #include <cmath>
+#include <vector>
+
+static inline float aspectFromDerivatives( float derX, float derY, float outputNodataValue )
+{
+  if ( derX == outputNodataValue ||
+       derY == outputNodataValue ||
+       ( derX == 0.0 && derY == 0.0 ) )
+  {
+    return outputNodataValue;
+  }
+  else
+  {
+    return 180.0 + std::atan2( derX, derY ) * 180.0 / M_PI;
+  }
+}
 
 QgsAspectFilter::QgsAspectFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
@@ -31,16 +46,19 @@ float QgsAspectFilter::processNineCellWindow(
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return aspectFromDerivatives( derX, derY, mOutputNodataValue );
+}
 
-  if ( derX == mOutputNodataValue ||
-       derY == mOutputNodataValue ||
-       ( derX == 0.0 && derY == 0.0 ) )
-  {
-    return mOutputNodataValue;
-  }
-  else
+void QgsAspectFilter::processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count )
+{
+  std::vector< float > derX( count );
+  std::vector< float > derY( count );
+  calcFirstDerivatives( rowAbove, row, rowBelow, derX.data(), derY.data(), count );
+
+  const float outputNodataValue = mOutputNodataValue;
+  for ( int j = 0; j < count; ++j )
   {
-    return 180.0 + std::atan2( derX, derY ) * 180.0 / M_PI;
+    outputRow[j] = aspectFromDerivatives( derX[j], derY[j], outputNodataValue );
   }
 }
 
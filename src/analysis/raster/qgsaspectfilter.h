@@ -36,6 +36,8 @@ class ANALYSIS_EXPORT QgsAspectFilter: public QgsDerivativeFilter
                                  float *x12, float *x22, float *x32,
                                  float *x13, float *x23, float *x33 ) override;
 
+    void processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count ) override SIP_SKIP;
+
 };
 
 #endif // QGSASPECTFILTER_H
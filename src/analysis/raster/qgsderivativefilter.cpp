@@ -157,7 +157,48 @@ float QgsDerivativeFilter::calcFirstDerY( float *x11, float *x21, float *x31, fl
   return sum / ( weight * mCellSizeY ) * mZFactor;
 }
 
-
-
-
-
+void QgsDerivativeFilter::calcFirstDerivatives( const float *rowAbove, const float *row, const float *rowBelow, float *derX, float *derY, int count )
+{
+  const float nodata = mInputNodataValue;
+  const double denominatorX = 8 * mCellSizeX;
+  const double denominatorY = 8 * mCellSizeY;
+
+  // slide the 3x3 window along the row, each value is read once
+  float x11 = rowAbove[-1], x21 = rowAbove[0];
+  float x12 = row[-1], x22 = row[0];
+  float x13 = rowBelow[-1], x23 = rowBelow[0];
+  for ( int j = 0; j < count; ++j )
+  {
+    float x31 = rowAbove[j + 1];
+    float x32 = row[j + 1];
+    float x33 = rowBelow[j + 1];
+
+    if ( x11 != nodata && x21 != nodata && x31 != nodata && x12 != nodata
+         && x32 != nodata && x13 != nodata && x23 != nodata && x33 != nodata )
+    {
+      // all the neighbours are valid: Horn's formula, with the terms summed as in calcFirstDerX/Y()
+      double sumX = x31 - x11;
+      sumX += 2 * ( x32 - x12 );
+      sumX += x33 - x13;
+      derX[j] = sumX / denominatorX * mZFactor;
+
+      double sumY = x11 - x13;
+      sumY += 2 * ( x21 - x23 );
+      sumY += x31 - x33;
+      derY[j] = sumY / denominatorY * mZFactor;
+    }
+    else
+    {
+      // border or nodata neighbours, use the weighted formulas
+      derX[j] = calcFirstDerX( &x11, &x21, &x31, &x12, &x22, &x32, &x13, &x23, &x33 );
+      derY[j] = calcFirstDerY( &x11, &x21, &x31, &x12, &x22, &x32, &x13, &x23, &x33 );
+    }
+
+    x11 = x21;
+    x21 = x31;
+    x12 = x22;
+    x22 = x32;
+    x13 = x23;
+    x23 = x33;
+  }
+}
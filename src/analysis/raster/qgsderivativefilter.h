@@ -39,6 +39,13 @@ class ANALYSIS_EXPORT QgsDerivativeFilter : public QgsNineCellFilter
     float calcFirstDerX( float *x11, float *x21, float *x31, float *x12, float *x22, float *x32, float *x13, float *x23, float *x33 );
     //! Calculates the first order derivative in y-direction according to Horn (1981)
     float calcFirstDerY( float *x11, float *x21, float *x31, float *x12, float *x22, float *x32, float *x13, float *x23, float *x33 );
+
+    /**
+     * Calculates the first order derivatives in x- and y-direction of \a count consecutive cells of a row,
+     * with the same arguments as processNineCellWindows(). The derivatives are written to \a derX and \a derY.
+     * \since QGIS 3.2
+     */
+    void calcFirstDerivatives( const float *rowAbove, const float *row, const float *rowBelow, float *derX, float *derY, int count ) SIP_SKIP;
 };
 
 #endif // QGSDERIVATIVEFILTER_H
@@ -17,6 +17,27 @@
 
 #include "qgshillshadefilter.h"
 #include <cmath>
+#include <vector>
+
+static inline float hillshadeFromDerivatives( float derX, float derY, float zenith_rad, float azimuth_rad, float outputNodataValue )
+{
+  if ( derX == outputNodataValue || derY == outputNodataValue )
+  {
+    return outputNodataValue;
+  }
+
+  float slope_rad = std::atan( std::sqrt( derX * derX + derY * derY ) );
+  float aspect_rad = 0;
+  if ( derX == 0 && derY == 0 ) //aspect undefined, take a neutral value. Better solutions?
+  {
+    aspect_rad = azimuth_rad / 2.0;
+  }
+  else
+  {
+    aspect_rad = M_PI + std::atan2( derX, derY );
+  }
+  return std::max( 0.0, 255.0 * ( ( std::cos( zenith_rad ) * std::cos( slope_rad ) ) + ( std::sin( zenith_rad ) * std::sin( slope_rad ) * std::cos( azimuth_rad - aspect_rad ) ) ) );
+}
 
 QgsHillshadeFilter::QgsHillshadeFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat, double lightAzimuth,
                                         double lightAngle )
@@ -33,22 +54,22 @@ float QgsHillshadeFilter::processNineCellWindow( float *x11, float *x21, float *
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
 
-  if ( derX == mOutputNodataValue || derY == mOutputNodataValue )
-  {
-    return mOutputNodataValue;
-  }
-
   float zenith_rad = mLightAngle * M_PI / 180.0;
-  float slope_rad = std::atan( std::sqrt( derX * derX + derY * derY ) );
   float azimuth_rad = mLightAzimuth * M_PI / 180.0;
-  float aspect_rad = 0;
-  if ( derX == 0 && derY == 0 ) //aspect undefined, take a neutral value. Better solutions?
-  {
-    aspect_rad = azimuth_rad / 2.0;
-  }
-  else
+  return hillshadeFromDerivatives( derX, derY, zenith_rad, azimuth_rad, mOutputNodataValue );
+}
+
+void QgsHillshadeFilter::processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count )
+{
+  std::vector< float > derX( count );
+  std::vector< float > derY( count );
+  calcFirstDerivatives( rowAbove, row, rowBelow, derX.data(), derY.data(), count );
+
+  const float zenith_rad = mLightAngle * M_PI / 180.0;
+  const float azimuth_rad = mLightAzimuth * M_PI / 180.0;
+  const float outputNodataValue = mOutputNodataValue;
+  for ( int j = 0; j < count; ++j )
   {
-    aspect_rad = M_PI + std::atan2( derX, derY );
+    outputRow[j] = hillshadeFromDerivatives( derX[j], derY[j], zenith_rad, azimuth_rad, outputNodataValue );
   }
-  return std::max( 0.0, 255.0 * ( ( std::cos( zenith_rad ) * std::cos( slope_rad ) ) + ( std::sin( zenith_rad ) * std::sin( slope_rad ) * std::cos( azimuth_rad - aspect_rad ) ) ) );
 }
@@ -38,6 +38,8 @@ class ANALYSIS_EXPORT QgsHillshadeFilter: public QgsDerivativeFilter
                                  float *x12, float *x22, float *x32,
                                  float *x13, float *x23, float *x33 ) override;
 
+    void processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count ) override SIP_SKIP;
+
     float lightAzimuth() const { return mLightAzimuth; }
     void setLightAzimuth( float azimuth ) { mLightAzimuth = azimuth; }
     float lightAngle() const { return mLightAngle; }
@@ -21,6 +21,28 @@
 #include "qgsfeedback.h"
 #include "qgsogrutils.h"
 #include <QFile>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+
+///@cond PRIVATE
+
+//! Approximate number of cells processed at once by a thread
+static const int TILE_CELL_COUNT = 1024 * 1024;
+
+//! Rows of the raster processed at once
+struct QgsNineCellFilterTile
+{
+  int yOffset;
+  int height;
+  //! Input values of the rows and of their neighbours, with one halo cell on each side of each row
+  QVector< float > input;
+  QVector< float > output;
+};
+
+///@endcond
 
 QgsNineCellFilter::QgsNineCellFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : mInputFile( inputFile )
@@ -77,15 +99,25 @@ int QgsNineCellFilter::processRaster( QgsFeedback *feedback )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time
-  float *scanLine1 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float *scanLine2 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float *scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  float *resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int i = 0; i < ySize; ++i )
+  // the raster is processed by tiles of full rows, aligned on the input blocks if they are smaller
+  // than a tile (rasters stored as a single strip would otherwise be a single tile). Tiles are read and
+  // written on this thread, and processed in parallel. Each tile is read with one halo row above and
+  // below, and one halo column on each side. Values outside the layer extent (if the 3x3 window is
+  // on the border) are sent to the processing method as (input) nodata values
+  int blockXSize = 0;
+  int blockYSize = 0;
+  GDALGetBlockSize( rasterBand, &blockXSize, &blockYSize );
+  blockYSize = std::max( blockYSize, 1 );
+  int tileHeight = std::max( 1, TILE_CELL_COUNT / xSize );
+  if ( blockYSize < tileHeight )
+    tileHeight = ( tileHeight + blockYSize - 1 ) / blockYSize * blockYSize;
+  tileHeight = std::min( ySize, tileHeight );
+  const int tileCount = ( ySize + tileHeight - 1 ) / tileHeight;
+  const int inputLineSize = xSize + 2;
+
+  const int batchSize = std::max( 1, QThreadPool::globalInstance()->maxThreadCount() ) * 2;
+  QVector< QgsNineCellFilterTile > batch;
+  for ( int firstTile = 0; firstTile < tileCount; firstTile += batchSize )
   {
     if ( feedback && feedback->isCanceled() )
     {
@@ -94,75 +126,66 @@ int QgsNineCellFilter::processRaster( QgsFeedback *feedback )
 
     if ( feedback )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( i ) / ySize );
+      feedback->setProgress( 100.0 * static_cast< double >( firstTile ) / tileCount );
     }
 
-    if ( i == 0 )
+    batch.clear();
+    for ( int tileIndex = firstTile; tileIndex < std::min( firstTile + batchSize, tileCount ); ++tileIndex )
     {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, scanLine2, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+      QgsNineCellFilterTile tile;
+      tile.yOffset = tileIndex * tileHeight;
+      tile.height = std::min( tileHeight, ySize - tile.yOffset );
+      tile.input.fill( mInputNodataValue, inputLineSize * ( tile.height + 2 ) );
+
+      const int firstRow = std::max( 0, tile.yOffset - 1 );
+      const int lastRow = std::min( ySize - 1, tile.yOffset + tile.height );
+      float *firstLine = tile.input.data() + ( firstRow - tile.yOffset + 1 ) * inputLineSize + 1;
+      if ( GDALRasterIO( rasterBand, GF_Read, 0, firstRow, xSize, lastRow - firstRow + 1, firstLine, xSize, lastRow - firstRow + 1,
+                         GDT_Float32, 0, sizeof( float ) * inputLineSize ) != CE_None )
       {
         QgsDebugMsg( "Raster IO Error" );
       }
-    }
-    else
-    {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+      batch << tile;
     }
 
-    if ( i == ySize - 1 ) //fill the row below the bottom with nodata values
+    if ( mSequentialProcessing )
     {
-      for ( int a = 0; a < xSize; ++a )
+      for ( QgsNineCellFilterTile &tile : batch )
       {
-        scanLine3[a] = mInputNodataValue;
+        tile.output.resize( xSize * tile.height );
+        const float *input = tile.input.constData() + 1;
+        for ( int i = 0; i < tile.height; ++i )
+        {
+          QgsNineCellFilter::processNineCellWindows( input + i * inputLineSize, input + ( i + 1 ) * inputLineSize, input + ( i + 2 ) * inputLineSize,
+              tile.output.data() + i * xSize, xSize );
+        }
+        tile.input.clear();
       }
     }
     else
     {
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, i + 1, xSize, 1, scanLine3, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+      QtConcurrent::blockingMap( batch, [this, xSize, inputLineSize]( QgsNineCellFilterTile & tile )
       {
-        QgsDebugMsg( "Raster IO Error" );
-      }
+        tile.output.resize( xSize * tile.height );
+        const float *input = tile.input.constData() + 1;
+        for ( int i = 0; i < tile.height; ++i )
+        {
+          processNineCellWindows( input + i * inputLineSize, input + ( i + 1 ) * inputLineSize, input + ( i + 2 ) * inputLineSize,
+                                  tile.output.data() + i * xSize, xSize );
+        }
+        tile.input.clear();
+      } );
     }
 
-    for ( int j = 0; j < xSize; ++j )
+    for ( QgsNineCellFilterTile &tile : batch )
     {
-      if ( j == 0 )
+      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, tile.yOffset, xSize, tile.height, tile.output.data(), xSize, tile.height, GDT_Float32, 0, 0 ) != CE_None )
       {
-        resultLine[j] = processNineCellWindow( &mInputNodataValue, &scanLine1[j], &scanLine1[j + 1], &mInputNodataValue, &scanLine2[j],
-                                               &scanLine2[j + 1], &mInputNodataValue, &scanLine3[j], &scanLine3[j + 1] );
-      }
-      else if ( j == xSize - 1 )
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j - 1], &scanLine1[j], &mInputNodataValue, &scanLine2[j - 1], &scanLine2[j],
-                                               &mInputNodataValue, &scanLine3[j - 1], &scanLine3[j], &mInputNodataValue );
-      }
-      else
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j - 1], &scanLine1[j], &scanLine1[j + 1], &scanLine2[j - 1], &scanLine2[j],
-                                               &scanLine2[j + 1], &scanLine3[j - 1], &scanLine3[j], &scanLine3[j + 1] );
+        QgsDebugMsg( "Raster IO Error" );
       }
     }
-
-    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-    {
-      QgsDebugMsg( "Raster IO Error" );
-    }
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
-
   if ( feedback && feedback->isCanceled() )
   {
     //delete the dataset without closing (because it is faster)
@@ -172,6 +195,17 @@ int QgsNineCellFilter::processRaster( QgsFeedback *feedback )
   return 0;
 }
 
+void QgsNineCellFilter::processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count )
+{
+  float *x1 = const_cast< float * >( rowAbove );
+  float *x2 = const_cast< float * >( row );
+  float *x3 = const_cast< float * >( rowBelow );
+  for ( int j = 0; j < count; ++j )
+  {
+    outputRow[j] = processNineCellWindow( &x1[j - 1], &x1[j], &x1[j + 1], &x2[j - 1], &x2[j], &x2[j + 1], &x3[j - 1], &x3[j], &x3[j + 1] );
+  }
+}
+
 gdal::dataset_unique_ptr QgsNineCellFilter::openInputFile( int &nCellsX, int &nCellsY )
 {
   gdal::dataset_unique_ptr inputDataset( GDALOpen( mInputFile.toUtf8().constData(), GA_ReadOnly ) );
@@ -21,6 +21,7 @@
 #include <QString>
 #include "gdal.h"
 #include "qgis_analysis.h"
+#include "qgis_sip.h"
 #include "qgsogrutils.h"
 class QgsFeedback;
 
@@ -42,6 +43,28 @@ class ANALYSIS_EXPORT QgsNineCellFilter
       \param feedback feedback object that receives update and that is checked for cancelation.
       \returns 0 in case of success*/
     int processRaster( QgsFeedback *feedback = nullptr );
+#ifdef SIP_RUN
+    % MethodCode
+    // tiles are processed in parallel with the GIL released, unless a Python subclass reimplements
+    // processNineCellWindow(): it is then called cell by cell on this thread
+    PyObject *method = PyObject_GetAttrString( reinterpret_cast< PyObject * >( Py_TYPE( sipSelf ) ), "processNineCellWindow" );
+    const bool reimplemented = method && PyFunction_Check( method );
+    Py_XDECREF( method );
+    PyErr_Clear();
+
+    sipCpp->setSequentialProcessing( reimplemented );
+    if ( reimplemented )
+    {
+      sipRes = sipCpp->processRaster( a0 );
+    }
+    else
+    {
+      Py_BEGIN_ALLOW_THREADS
+      sipRes = sipCpp->processRaster( a0 );
+      Py_END_ALLOW_THREADS
+    }
+    % End
+#endif
 
     double cellSizeX() const { return mCellSizeX; }
     void setCellSizeX( double size ) { mCellSizeX = size; }
@@ -58,15 +81,53 @@ class ANALYSIS_EXPORT QgsNineCellFilter
 
     /**
      * Calculates output value from nine input values. The input values and the output value can be equal to the
-      nodata value if not present or outside of the border. Must be implemented by subclasses*/
+      nodata value if not present or outside of the border. Must be implemented by subclasses.
+      \note Unless sequentialProcessing() is set, the raster is processed by tiles in parallel, so this method may be called from several threads at once and must not modify the filter.
+     */
     virtual float processNineCellWindow( float *x11, float *x21, float *x31,
                                          float *x12, float *x22, float *x32,
                                          float *x13, float *x23, float *x33 ) = 0;
 
+    /**
+     * Calculates the output values of \a count consecutive cells of a row.
+     *
+     * \a rowAbove, \a row and \a rowBelow point to the input values of the first cell of the row and
+     * of its neighbours above and below. Each of them can be read from index -1 to index \a count, values
+     * outside of the raster being set to the input nodata value. The results are written to \a outputRow.
+     *
+     * The default implementation calls processNineCellWindow() for each cell. Subclasses can override it
+     * with a kernel working directly on the three rows.
+     * \note Like processNineCellWindow(), this method may be called from several threads at once.
+     * \note not available in Python bindings
+     * \since QGIS 3.2
+     */
+    virtual void processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count ) SIP_SKIP;
+
+    /**
+     * Sets whether the raster is processed cell by cell on the calling thread with processNineCellWindow(),
+     * instead of by tiles processed in parallel with processNineCellWindows(). This is required if
+     * processNineCellWindow() is not thread safe, or if it is reimplemented in a subclass of a filter
+     * which reimplements processNineCellWindows().
+     * \note not available in Python bindings, this is set automatically for Python subclasses reimplementing processNineCellWindow()
+     * \see sequentialProcessing()
+     * \since QGIS 3.2
+     */
+    void setSequentialProcessing( bool sequential ) SIP_SKIP { mSequentialProcessing = sequential; }
+
+    /**
+     * Returns whether the raster is processed cell by cell on the calling thread.
+     * \note not available in Python bindings
+     * \see setSequentialProcessing()
+     * \since QGIS 3.2
+     */
+    bool sequentialProcessing() const SIP_SKIP { return mSequentialProcessing; }
+
   private:
     //default constructor forbidden. We need input file, output file and format obligatory
     QgsNineCellFilter() = delete;
 
+    bool mSequentialProcessing = false;
+
     //! Opens the input file and returns the dataset handle and the number of pixels in x-/y- direction
     gdal::dataset_unique_ptr openInputFile( int &nCellsX, int &nCellsY );
 
@@ -0,0 +1,354 @@
+/***************************************************************************
+                          qgsrastercalcprogram.cpp
+                          ------------------------
+    begin                : April 2018
+    copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrastercalcprogram_p.h"
+
+#include <QObject>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+///@cond PRIVATE
+
+// the operators below match the ones of QgsRasterMatrix
+
+static bool isUnaryOperator( QgsRasterCalcNode::Operator op )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opSQRT:
+    case QgsRasterCalcNode::opSIN:
+    case QgsRasterCalcNode::opCOS:
+    case QgsRasterCalcNode::opTAN:
+    case QgsRasterCalcNode::opASIN:
+    case QgsRasterCalcNode::opACOS:
+    case QgsRasterCalcNode::opATAN:
+    case QgsRasterCalcNode::opSIGN:
+    case QgsRasterCalcNode::opLOG:
+    case QgsRasterCalcNode::opLOG10:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool isPowerValid( double base, double power )
+{
+  return !( ( base == 0 && power < 0 ) || ( base < 0 && ( power - std::floor( power ) ) > 0 ) );
+}
+
+// Applies f to the values of a buffer which are not nodata
+template <typename F>
+static void unaryLoop( const double *values, double *result, int count, double nodataValue, F f )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    const double value = values[i];
+    result[i] = value == nodataValue ? nodataValue : f( value );
+  }
+}
+
+// Applies f to the values of two buffers, or of a buffer and a constant, which are not nodata
+template <typename F>
+static void binaryLoop( const double *left, const double *right, double *result, int count, double nodataValue, F f )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    const double a = left[i];
+    const double b = right[i];
+    result[i] = a == nodataValue || b == nodataValue ? nodataValue : f( a, b );
+  }
+}
+
+template <typename F>
+static void binaryLoop( double left, const double *right, double *result, int count, double nodataValue, F f )
+{
+  if ( left == nodataValue )
+  {
+    std::fill( result, result + count, nodataValue );
+    return;
+  }
+  for ( int i = 0; i < count; ++i )
+  {
+    const double b = right[i];
+    result[i] = b == nodataValue ? nodataValue : f( left, b );
+  }
+}
+
+template <typename F>
+static void binaryLoop( const double *left, double right, double *result, int count, double nodataValue, F f )
+{
+  if ( right == nodataValue )
+  {
+    std::fill( result, result + count, nodataValue );
+    return;
+  }
+  for ( int i = 0; i < count; ++i )
+  {
+    const double a = left[i];
+    result[i] = a == nodataValue ? nodataValue : f( a, right );
+  }
+}
+
+template <typename F>
+static void binaryLoop( double left, double right, double *result, int count, double nodataValue, F f )
+{
+  std::fill( result, result + count, left == nodataValue || right == nodataValue ? nodataValue : f( left, right ) );
+}
+
+// Runs a unary loop for the operator function passed to operator()
+struct UnaryLoopRunner
+{
+  const double *values;
+  double *result;
+  int count;
+  double nodataValue;
+
+  template <typename F>
+  void operator()( F f ) const { unaryLoop( values, result, count, nodataValue, f ); }
+};
+
+// Runs a binary loop for the operator function passed to operator(), L and R being buffers or constants
+template <typename L, typename R>
+struct BinaryLoopRunner
+{
+  L left;
+  R right;
+  double *result;
+  int count;
+  double nodataValue;
+
+  template <typename F>
+  void operator()( F f ) const { binaryLoop( left, right, result, count, nodataValue, f ); }
+};
+
+template <typename L, typename R>
+static BinaryLoopRunner< L, R > binaryLoopRunner( L left, R right, double *result, int count, double nodataValue )
+{
+  return BinaryLoopRunner< L, R > { left, right, result, count, nodataValue };
+}
+
+// Calls the loop runner for a unary operator
+template <typename Loop>
+static void dispatchUnary( QgsRasterCalcNode::Operator op, double nodataValue, Loop loop )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opSQRT:
+      loop( [nodataValue]( double v ) { return v < 0 ? nodataValue : std::sqrt( v ); } );
+      break;
+    case QgsRasterCalcNode::opSIN:
+      loop( []( double v ) { return std::sin( v ); } );
+      break;
+    case QgsRasterCalcNode::opCOS:
+      loop( []( double v ) { return std::cos( v ); } );
+      break;
+    case QgsRasterCalcNode::opTAN:
+      loop( []( double v ) { return std::tan( v ); } );
+      break;
+    case QgsRasterCalcNode::opASIN:
+      loop( []( double v ) { return std::asin( v ); } );
+      break;
+    case QgsRasterCalcNode::opACOS:
+      loop( []( double v ) { return std::acos( v ); } );
+      break;
+    case QgsRasterCalcNode::opATAN:
+      loop( []( double v ) { return std::atan( v ); } );
+      break;
+    case QgsRasterCalcNode::opSIGN:
+      loop( []( double v ) { return -v; } );
+      break;
+    case QgsRasterCalcNode::opLOG:
+      loop( [nodataValue]( double v ) { return v <= 0 ? nodataValue : std::log( v ); } );
+      break;
+    case QgsRasterCalcNode::opLOG10:
+      loop( [nodataValue]( double v ) { return v <= 0 ? nodataValue : std::log10( v ); } );
+      break;
+    default:
+      break;
+  }
+}
+
+// Calls the loop runner for a binary operator
+template <typename Loop>
+static void dispatchBinary( QgsRasterCalcNode::Operator op, double nodataValue, Loop loop )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opPLUS:
+      loop( []( double a, double b ) { return a + b; } );
+      break;
+    case QgsRasterCalcNode::opMINUS:
+      loop( []( double a, double b ) { return a - b; } );
+      break;
+    case QgsRasterCalcNode::opMUL:
+      loop( []( double a, double b ) { return a * b; } );
+      break;
+    case QgsRasterCalcNode::opDIV:
+      loop( [nodataValue]( double a, double b ) { return b == 0 ? nodataValue : a / b; } );
+      break;
+    case QgsRasterCalcNode::opPOW:
+      loop( [nodataValue]( double a, double b ) { return isPowerValid( a, b ) ? std::pow( a, b ) : nodataValue; } );
+      break;
+    case QgsRasterCalcNode::opEQ:
+      loop( []( double a, double b ) { return a == b ? 1.0 : 0.0; } );
+      break;
+    case QgsRasterCalcNode::opNE:
+      loop( []( double a, double b ) { return a == b ? 0.0 : 1.0; } );
+      break;
+    case QgsRasterCalcNode::opGT:
+      loop( []( double a, double b ) { return a > b ? 1.0 : 0.0; } );
+      break;
+    case QgsRasterCalcNode::opLT:
+      loop( []( double a, double b ) { return a < b ? 1.0 : 0.0; } );
+      break;
+    case QgsRasterCalcNode::opGE:
+      loop( []( double a, double b ) { return a >= b ? 1.0 : 0.0; } );
+      break;
+    case QgsRasterCalcNode::opLE:
+      loop( []( double a, double b ) { return a <= b ? 1.0 : 0.0; } );
+      break;
+    case QgsRasterCalcNode::opAND:
+      loop( []( double a, double b ) { return a && b ? 1.0 : 0.0; } );
+      break;
+    case QgsRasterCalcNode::opOR:
+      loop( []( double a, double b ) { return a || b ? 1.0 : 0.0; } );
+      break;
+    default:
+      break;
+  }
+}
+
+std::unique_ptr< QgsRasterCalcProgram > QgsRasterCalcProgram::compile( const QgsRasterCalcNode *node, const QStringList &rasterRefs, double nodataValue, QString &error )
+{
+  std::unique_ptr< QgsRasterCalcProgram > program( new QgsRasterCalcProgram() );
+  program->mNodataValue = nodataValue;
+  if ( !node || !program->compileNode( node, rasterRefs, 0, program->mResult, error ) )
+  {
+    if ( error.isEmpty() )
+      error = QObject::tr( "Invalid expression" );
+    return nullptr;
+  }
+  return program;
+}
+
+bool QgsRasterCalcProgram::compileNode( const QgsRasterCalcNode *node, const QStringList &rasterRefs, int dest, Operand &result, QString &error )
+{
+  switch ( node->mType )
+  {
+    case QgsRasterCalcNode::tNumber:
+      result = Operand{ Operand::Number, -1, node->mNumber };
+      return true;
+
+    case QgsRasterCalcNode::tRasterRef:
+    {
+      const int index = rasterRefs.indexOf( node->mRasterName );
+      if ( index < 0 )
+      {
+        error = QObject::tr( "Unknown raster reference %1" ).arg( node->mRasterName );
+        return false;
+      }
+      result = Operand{ Operand::Input, index, 0 };
+      return true;
+    }
+
+    case QgsRasterCalcNode::tMatrix:
+      error = QObject::tr( "Matrix constants are not supported" );
+      return false;
+
+    case QgsRasterCalcNode::tOperator:
+      break;
+  }
+
+  const bool unary = isUnaryOperator( node->mOperator );
+  if ( node->mOperator == QgsRasterCalcNode::opNONE || !node->mLeft || ( !unary && !node->mRight ) )
+    return false;
+
+  Instruction instruction{ node->mOperator, dest, Operand{ Operand::Number, -1, 0 }, Operand{ Operand::Number, -1, 0 } };
+  if ( !compileNode( node->mLeft, rasterRefs, dest, instruction.left, error ) )
+    return false;
+  if ( !unary )
+  {
+    // the left operand may be held by the destination register, so the right one needs the next
+    if ( !compileNode( node->mRight, rasterRefs, dest + 1, instruction.right, error ) )
+      return false;
+  }
+
+  if ( instruction.left.kind == Operand::Number && ( unary || instruction.right.kind == Operand::Number ) )
+  {
+    // fold constant expressions
+    double value = mNodataValue;
+    if ( unary )
+      dispatchUnary( node->mOperator, mNodataValue, UnaryLoopRunner{ &instruction.left.number, &value, 1, mNodataValue } );
+    else
+      dispatchBinary( node->mOperator, mNodataValue, binaryLoopRunner( instruction.left.number, instruction.right.number, &value, 1, mNodataValue ) );
+    result = Operand{ Operand::Number, -1, value };
+    return true;
+  }
+
+  mInstructions.append( instruction );
+  mRegisterCount = std::max( mRegisterCount, dest + 1 );
+  result = Operand{ Operand::Register, dest, 0 };
+  return true;
+}
+
+void QgsRasterCalcProgram::evaluate( const QVector< const double * > &inputs, int count, float *output ) const
+{
+  const double nodataValue = mNodataValue;
+  std::vector< double > registers( static_cast< size_t >( mRegisterCount ) * static_cast< size_t >( count ) );
+
+  auto buffer = [&]( const Operand & operand ) -> const double *
+  {
+    if ( operand.kind == Operand::Input )
+      return inputs.at( operand.index );
+    return registers.data() + static_cast< size_t >( operand.index ) * count;
+  };
+
+  for ( const Instruction &instruction : mInstructions )
+  {
+    double *result = registers.data() + static_cast< size_t >( instruction.dest ) * count;
+    if ( isUnaryOperator( instruction.op ) )
+    {
+      dispatchUnary( instruction.op, nodataValue, UnaryLoopRunner{ buffer( instruction.left ), result, count, nodataValue } );
+    }
+    else if ( instruction.left.kind == Operand::Number )
+    {
+      dispatchBinary( instruction.op, nodataValue, binaryLoopRunner( instruction.left.number, buffer( instruction.right ), result, count, nodataValue ) );
+    }
+    else if ( instruction.right.kind == Operand::Number )
+    {
+      dispatchBinary( instruction.op, nodataValue, binaryLoopRunner( buffer( instruction.left ), instruction.right.number, result, count, nodataValue ) );
+    }
+    else
+    {
+      dispatchBinary( instruction.op, nodataValue, binaryLoopRunner( buffer( instruction.left ), buffer( instruction.right ), result, count, nodataValue ) );
+    }
+  }
+
+  if ( mResult.kind == Operand::Number )
+  {
+    std::fill( output, output + count, static_cast< float >( mResult.number ) );
+  }
+  else
+  {
+    const double *values = buffer( mResult );
+    for ( int i = 0; i < count; ++i )
+      output[i] = static_cast< float >( values[i] );
+  }
+}
+
+///@endcond
@@ -0,0 +1,120 @@
+/***************************************************************************
+                          qgsrastercalcprogram_p.h
+                          ------------------------
+    begin                : April 2018
+    copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERCALCPROGRAM_P_H
+#define QGSRASTERCALCPROGRAM_P_H
+
+#define SIP_NO_FILE
+
+///@cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgsrastercalcnode.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+/**
+ * \ingroup analysis
+ * Raster calculator expression compiled to a flat list of instructions.
+ *
+ * Each instruction applies one operator to whole buffers of pixels, so that
+ * the calculation does not allocate memory per node and its loops can be
+ * vectorized by the compiler. Values and nodata handling are identical to
+ * QgsRasterMatrix.
+ *
+ * Programs are immutable once compiled, and may be evaluated from several
+ * threads at once.
+ * \since QGIS 3.2
+ */
+class QgsRasterCalcProgram
+{
+  public:
+
+    /**
+     * Compiles the expression tree starting at \a node. Raster references are
+     * resolved against the \a rasterRefs list, whose order gives the order of the
+     * inputs passed to evaluate(). Pixels equal to \a nodataValue are treated as
+     * nodata, in the inputs and in the output.
+     * \returns the compiled program, or nullptr if the expression cannot be compiled,
+     * in which case \a error is set
+     */
+    static std::unique_ptr< QgsRasterCalcProgram > compile( const QgsRasterCalcNode *node, const QStringList &rasterRefs, double nodataValue, QString &error );
+
+    /**
+     * Evaluates the program on \a count pixels.
+     * \param inputs one buffer of \a count values per raster reference
+     * \param count number of pixels
+     * \param output destination buffer for \a count values
+     */
+    void evaluate( const QVector< const double * > &inputs, int count, float *output ) const;
+
+  private:
+
+    //! Operand of an instruction
+    struct Operand
+    {
+      enum Kind
+      {
+        Register, //!< Buffer holding the result of a previous instruction
+        Input, //!< Input buffer
+        Number, //!< Constant
+      };
+
+      Kind kind;
+      int index;
+      double number;
+    };
+
+    //! Instruction applying an operator and storing the result in the register dest
+    struct Instruction
+    {
+      QgsRasterCalcNode::Operator op;
+      int dest;
+      Operand left;
+      //! Unused for operators taking a single argument
+      Operand right;
+    };
+
+    QgsRasterCalcProgram() = default;
+
+    /**
+     * Appends the instructions calculating \a node, using the register \a dest and the following ones.
+     * \a result is set to the operand holding the value of the node.
+     * \returns false if the node cannot be compiled, in which case \a error is set
+     */
+    bool compileNode( const QgsRasterCalcNode *node, const QStringList &rasterRefs, int dest, Operand &result, QString &error );
+
+    QVector< Instruction > mInstructions;
+    Operand mResult;
+    int mRegisterCount = 0;
+    double mNodataValue = 0;
+};
+
+///@endcond
+
+#endif // QGSRASTERCALCPROGRAM_P_H
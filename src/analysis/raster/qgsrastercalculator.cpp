@@ -17,15 +17,21 @@
 
 #include "qgsrastercalculator.h"
 #include "qgsrastercalcnode.h"
+#include "qgsrastercalcprogram_p.h"
+#include "qgsrasterblock.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterinterface.h"
 #include "qgsrasterlayer.h"
-#include "qgsrastermatrix.h"
 #include "qgsrasterprojector.h"
 #include "qgsfeedback.h"
 #include "qgsogrutils.h"
 
 #include <QFile>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
 
 #include <cpl_string.h>
 #include <gdalwarper.h>
@@ -57,60 +63,54 @@ QgsRasterCalculator::QgsRasterCalculator( const QString &formulaString, const QS
 {
 }
 
+///@cond PRIVATE
+
+//! Approximate number of pixels calculated at once by a thread
+static const int TILE_PIXEL_COUNT = 512 * 512;
+
+//! Part of the output raster, with the input values it is calculated from
+struct QgsRasterCalculatorTile
+{
+  int xOffset;
+  int yOffset;
+  int width;
+  int height;
+  //! Values of each raster entry, nodata pixels being set to the output nodata value
+  QVector< QVector< double > > inputs;
+  QVector< float > output;
+};
+
+///@endcond
+
 int QgsRasterCalculator::processCalculation( QgsFeedback *feedback )
 {
   //prepare search string / tree
   QString errorString;
-  QgsRasterCalcNode *calcNode = QgsRasterCalcNode::parseRasterCalcString( mFormulaString, errorString );
+  std::unique_ptr< QgsRasterCalcNode > calcNode( QgsRasterCalcNode::parseRasterCalcString( mFormulaString, errorString ) );
   if ( !calcNode )
   {
     //error
     return static_cast<int>( ParserError );
   }
 
-  QMap< QString, QgsRasterBlock * > inputBlocks;
-  QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
-  for ( ; it != mRasterEntries.constEnd(); ++it )
+  QStringList rasterRefs;
+  for ( const QgsRasterCalculatorEntry &entry : qgis::as_const( mRasterEntries ) )
   {
-    if ( !it->raster ) // no raster layer in entry
+    if ( !entry.raster ) // no raster layer in entry
     {
-      delete calcNode;
-      qDeleteAll( inputBlocks );
       return static_cast< int >( InputLayerError );
     }
+    rasterRefs << entry.ref;
+  }
 
-    QgsRasterBlock *block = nullptr;
-    // if crs transform needed
-    if ( it->raster->crs() != mOutputCrs )
-    {
-      QgsRasterProjector proj;
-      proj.setCrs( it->raster->crs(), mOutputCrs );
-      proj.setInput( it->raster->dataProvider() );
-      proj.setPrecision( QgsRasterProjector::Exact );
-
-      QgsRasterBlockFeedback *rasterBlockFeedback = new QgsRasterBlockFeedback();
-      QObject::connect( feedback, &QgsFeedback::canceled, rasterBlockFeedback, &QgsRasterBlockFeedback::cancel );
-      block = proj.block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows, rasterBlockFeedback );
-      if ( rasterBlockFeedback->isCanceled() )
-      {
-        delete block;
-        delete calcNode;
-        qDeleteAll( inputBlocks );
-        return static_cast< int >( Canceled );
-      }
-    }
-    else
-    {
-      block = it->raster->dataProvider()->block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
-    }
-    if ( block->isEmpty() )
-    {
-      delete block;
-      delete calcNode;
-      qDeleteAll( inputBlocks );
-      return static_cast<int>( MemoryError );
-    }
-    inputBlocks.insert( it->ref, block );
+  const float outputNodataValue = -FLT_MAX;
+
+  // compile the formula, so that it is not interpreted again for each pixel
+  std::unique_ptr< QgsRasterCalcProgram > program = QgsRasterCalcProgram::compile( calcNode.get(), rasterRefs, outputNodataValue, errorString );
+  if ( !program )
+  {
+    QgsDebugMsg( QStringLiteral( "Cannot compile raster calculator formula: %1" ).arg( errorString ) );
+    return static_cast<int>( ParserError );
   }
 
   //open output dataset for writing
@@ -129,18 +129,53 @@ int QgsRasterCalculator::processCalculation( QgsFeedback *feedback )
   GDALSetProjection( outputDataset.get(), mOutputCrs.toWkt().toLocal8Bit().data() );
   GDALRasterBandH outputRasterBand = GDALGetRasterBand( outputDataset.get(), 1 );
 
-  float outputNodataValue = -FLT_MAX;
   GDALSetRasterNoDataValue( outputRasterBand, outputNodataValue );
 
-  QgsRasterMatrix resultMatrix;
-  resultMatrix.setNodataValue( outputNodataValue );
+  // input layers which need to be reprojected
+  QgsRasterBlockFeedback rasterBlockFeedback;
+  if ( feedback )
+  {
+    QObject::connect( feedback, &QgsFeedback::canceled, &rasterBlockFeedback, &QgsRasterBlockFeedback::cancel );
+  }
+  std::vector< std::unique_ptr< QgsRasterProjector > > projectors;
+  for ( const QgsRasterCalculatorEntry &entry : qgis::as_const( mRasterEntries ) )
+  {
+    std::unique_ptr< QgsRasterProjector > projector;
+    if ( entry.raster->crs() != mOutputCrs )
+    {
+      projector = qgis::make_unique< QgsRasterProjector >();
+      projector->setCrs( entry.raster->crs(), mOutputCrs );
+      projector->setInput( entry.raster->dataProvider() );
+      projector->setPrecision( QgsRasterProjector::Exact );
+    }
+    projectors.push_back( std::move( projector ) );
+  }
 
-  //read / write line by line
-  for ( int i = 0; i < mNumOutputRows; ++i )
+  // the output is calculated by tiles aligned on the blocks of the output band, so that
+  // they can be written without reading back partially written blocks
+  int blockXSize = 0;
+  int blockYSize = 0;
+  GDALGetBlockSize( outputRasterBand, &blockXSize, &blockYSize );
+  blockXSize = std::max( blockXSize, 1 );
+  blockYSize = std::max( blockYSize, 1 );
+  int tileWidth = std::min( mNumOutputColumns, ( static_cast< int >( std::sqrt( TILE_PIXEL_COUNT ) ) + blockXSize - 1 ) / blockXSize * blockXSize );
+  int tileHeight = std::max( 1, TILE_PIXEL_COUNT / tileWidth );
+  tileHeight = std::min( mNumOutputRows, ( tileHeight + blockYSize - 1 ) / blockYSize * blockYSize );
+
+  const int tileColumns = ( mNumOutputColumns + tileWidth - 1 ) / tileWidth;
+  const int tileRows = ( mNumOutputRows + tileHeight - 1 ) / tileHeight;
+  const int tileCount = tileColumns * tileRows;
+  const double pixelWidth = mOutputRectangle.width() / mNumOutputColumns;
+  const double pixelHeight = mOutputRectangle.height() / mNumOutputRows;
+
+  // tiles are read from the inputs and written to the output on this thread, and calculated in parallel
+  const int batchSize = std::max( 1, QThreadPool::globalInstance()->maxThreadCount() ) * 2;
+  QVector< QgsRasterCalculatorTile > batch;
+  for ( int firstTile = 0; firstTile < tileCount; firstTile += batchSize )
   {
     if ( feedback )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( i ) / mNumOutputRows );
+      feedback->setProgress( 100.0 * static_cast< double >( firstTile ) / tileCount );
     }
 
     if ( feedback && feedback->isCanceled() )
@@ -148,25 +183,73 @@ int QgsRasterCalculator::processCalculation( QgsFeedback *feedback )
       break;
     }
 
-    if ( calcNode->calculate( inputBlocks, resultMatrix, i ) )
+    batch.clear();
+    for ( int tileIndex = firstTile; tileIndex < std::min( firstTile + batchSize, tileCount ); ++tileIndex )
     {
-      bool resultIsNumber = resultMatrix.isNumber();
-      float *calcData = new float[mNumOutputColumns];
-
-      for ( int j = 0; j < mNumOutputColumns; ++j )
+      QgsRasterCalculatorTile tile;
+      tile.xOffset = ( tileIndex % tileColumns ) * tileWidth;
+      tile.yOffset = ( tileIndex / tileColumns ) * tileHeight;
+      tile.width = std::min( tileWidth, mNumOutputColumns - tile.xOffset );
+      tile.height = std::min( tileHeight, mNumOutputRows - tile.yOffset );
+      const QgsRectangle tileExtent( mOutputRectangle.xMinimum() + tile.xOffset * pixelWidth,
+                                     mOutputRectangle.yMaximum() - ( tile.yOffset + tile.height ) * pixelHeight,
+                                     mOutputRectangle.xMinimum() + ( tile.xOffset + tile.width ) * pixelWidth,
+                                     mOutputRectangle.yMaximum() - tile.yOffset * pixelHeight );
+      const qgssize pixelCount = static_cast< qgssize >( tile.width ) * tile.height;
+
+      for ( int entryIndex = 0; entryIndex < mRasterEntries.size(); ++entryIndex )
       {
-        calcData[j] = ( float )( resultIsNumber ? resultMatrix.number() : resultMatrix.data()[j] );
+        const QgsRasterCalculatorEntry &entry = mRasterEntries.at( entryIndex );
+        std::unique_ptr< QgsRasterBlock > block;
+        if ( projectors.at( entryIndex ) )
+        {
+          block.reset( projectors.at( entryIndex )->block( entry.bandNumber, tileExtent, tile.width, tile.height, &rasterBlockFeedback ) );
+          if ( rasterBlockFeedback.isCanceled() )
+          {
+            gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+            return static_cast< int >( Canceled );
+          }
+        }
+        else
+        {
+          block.reset( entry.raster->dataProvider()->block( entry.bandNumber, tileExtent, tile.width, tile.height ) );
+        }
+        if ( !block || block->isEmpty() )
+        {
+          gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+          return static_cast<int>( MemoryError );
+        }
+
+        //convert input raster values to double, also convert input no data to result no data
+        QVector< double > values( static_cast< int >( pixelCount ) );
+        for ( qgssize i = 0; i < pixelCount; ++i )
+        {
+          values[ static_cast< int >( i ) ] = block->isNoData( i ) ? outputNodataValue : block->value( i );
+        }
+        tile.inputs << values;
       }
+      batch << tile;
+    }
+
+    QtConcurrent::blockingMap( batch, [&program]( QgsRasterCalculatorTile & tile )
+    {
+      QVector< const double * > inputs;
+      inputs.reserve( tile.inputs.size() );
+      for ( const QVector< double > &values : qgis::as_const( tile.inputs ) )
+        inputs << values.constData();
+
+      tile.output.resize( tile.width * tile.height );
+      program->evaluate( inputs, tile.output.size(), tile.output.data() );
+      tile.inputs.clear();
+    } );
 
-      //write scanline to the dataset
-      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, mNumOutputColumns, 1, calcData, mNumOutputColumns, 1, GDT_Float32, 0, 0 ) != CE_None )
+    for ( QgsRasterCalculatorTile &tile : batch )
+    {
+      if ( GDALRasterIO( outputRasterBand, GF_Write, tile.xOffset, tile.yOffset, tile.width, tile.height, tile.output.data(), tile.width, tile.height, GDT_Float32, 0, 0 ) != CE_None )
       {
         QgsDebugMsg( "RasterIO error!" );
       }
-
-      delete[] calcData;
     }
-
   }
 
   if ( feedback )
@@ -174,11 +257,6 @@ int QgsRasterCalculator::processCalculation( QgsFeedback *feedback )
     feedback->setProgress( 100.0 );
   }
 
-  //close datasets and release memory
-  delete calcNode;
-  qDeleteAll( inputBlocks );
-  inputBlocks.clear();
-
   if ( feedback && feedback->isCanceled() )
   {
     //delete the dataset without closing (because it is faster)
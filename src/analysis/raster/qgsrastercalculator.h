@@ -92,6 +92,9 @@ class ANALYSIS_EXPORT QgsRasterCalculator
     /**
      * Starts the calculation and writes a new raster.
      *
+     * The raster is calculated by tiles, which are processed in parallel using
+     * the global thread pool.
+     *
      * The optional \a feedback argument can be used for progress reporting and cancelation support.
      * \returns 0 in case of success
     */
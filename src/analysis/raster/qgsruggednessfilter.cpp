@@ -89,3 +89,47 @@ float QgsRuggednessFilter::processNineCellWindow( float *x11, float *x21, float
   return std::sqrt( sum );
 }
 
+void QgsRuggednessFilter::processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count )
+{
+  const float nodata = mInputNodataValue;
+  const float outputNodata = mOutputNodataValue;
+
+  // slide the 3x3 window along the row, each value is read once
+  float x11 = rowAbove[-1], x21 = rowAbove[0];
+  float x12 = row[-1], x22 = row[0];
+  float x13 = rowBelow[-1], x23 = rowBelow[0];
+  for ( int j = 0; j < count; ++j )
+  {
+    const float x31 = rowAbove[j + 1];
+    const float x32 = row[j + 1];
+    const float x33 = rowBelow[j + 1];
+
+    if ( x22 == nodata )
+    {
+      outputRow[j] = outputNodata;
+    }
+    else
+    {
+      // same terms and order of summation as processNineCellWindow()
+      const float d11 = x11 - x22, d21 = x21 - x22, d31 = x31 - x22, d12 = x12 - x22;
+      const float d32 = x32 - x22, d13 = x13 - x22, d23 = x23 - x22, d33 = x33 - x22;
+      double sum = 0;
+      sum += x11 != nodata ? d11 * d11 : 0.0f;
+      sum += x21 != nodata ? d21 * d21 : 0.0f;
+      sum += x31 != nodata ? d31 * d31 : 0.0f;
+      sum += x12 != nodata ? d12 * d12 : 0.0f;
+      sum += x32 != nodata ? d32 * d32 : 0.0f;
+      sum += x13 != nodata ? d13 * d13 : 0.0f;
+      sum += x23 != nodata ? d23 * d23 : 0.0f;
+      sum += x33 != nodata ? d33 * d33 : 0.0f;
+      outputRow[j] = std::sqrt( sum );
+    }
+
+    x11 = x21;
+    x21 = x31;
+    x12 = x22;
+    x22 = x32;
+    x13 = x23;
+    x23 = x33;
+  }
+}
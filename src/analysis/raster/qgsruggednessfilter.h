@@ -39,6 +39,8 @@ class ANALYSIS_EXPORT QgsRuggednessFilter: public QgsNineCellFilter
                                  float *x12, float *x22, float *x32,
                                  float *x13, float *x23, float *x33 ) override;
 
+    void processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count ) override SIP_SKIP;
+
   private:
     QgsRuggednessFilter();
 };
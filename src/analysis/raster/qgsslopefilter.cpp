@@ -17,6 +17,17 @@
 
 #include "qgsslopefilter.h"
 #include <cmath>
+#include <vector>
+
+static inline float slopeFromDerivatives( float derX, float derY, float outputNodataValue )
+{
+  if ( derX == outputNodataValue || derY == outputNodataValue )
+  {
+    return outputNodataValue;
+  }
+
+  return std::atan( std::sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
+}
 
 QgsSlopeFilter::QgsSlopeFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
@@ -29,12 +40,19 @@ float QgsSlopeFilter::processNineCellWindow( float *x11, float *x21, float *x31,
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return slopeFromDerivatives( derX, derY, mOutputNodataValue );
+}
+
+void QgsSlopeFilter::processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count )
+{
+  std::vector< float > derX( count );
+  std::vector< float > derY( count );
+  calcFirstDerivatives( rowAbove, row, rowBelow, derX.data(), derY.data(), count );
 
-  if ( derX == mOutputNodataValue || derY == mOutputNodataValue )
+  const float outputNodataValue = mOutputNodataValue;
+  for ( int j = 0; j < count; ++j )
   {
-    return mOutputNodataValue;
+    outputRow[j] = slopeFromDerivatives( derX[j], derY[j], outputNodataValue );
   }
-
-  return std::atan( std::sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
 }
 
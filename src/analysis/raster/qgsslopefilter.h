@@ -35,6 +35,8 @@ class ANALYSIS_EXPORT QgsSlopeFilter: public QgsDerivativeFilter
     float processNineCellWindow( float *x11, float *x21, float *x31,
                                  float *x12, float *x22, float *x32,
                                  float *x13, float *x23, float *x33 ) override;
+
+    void processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count ) override SIP_SKIP;
 };
 
 #endif // QGSSLOPEFILTER_H
@@ -41,3 +41,44 @@ float QgsTotalCurvatureFilter::processNineCellWindow( float *x11, float *x21, fl
 
   return dxx * dxx + 2 * dxy * dxy + dyy * dyy;
 }
+
+void QgsTotalCurvatureFilter::processNineCellWindows( const float *rowAbove, const float *row, const float *rowBelow, float *outputRow, int count )
+{
+  const float nodata = mInputNodataValue;
+  const float outputNodata = mOutputNodataValue;
+  const double cellSizeAvg = ( mCellSizeX + mCellSizeY ) / 2.0;
+  const double dxxDenominator = mCellSizeX * mCellSizeX;
+  const double dxyDenominator = 4 * cellSizeAvg * cellSizeAvg;
+  const double dyyDenominator = mCellSizeY * mCellSizeY;
+
+  // slide the 3x3 window along the row, each value is read once
+  float x11 = rowAbove[-1], x21 = rowAbove[0];
+  float x12 = row[-1], x22 = row[0];
+  float x13 = rowBelow[-1], x23 = rowBelow[0];
+  for ( int j = 0; j < count; ++j )
+  {
+    const float x31 = rowAbove[j + 1];
+    const float x32 = row[j + 1];
+    const float x33 = rowBelow[j + 1];
+
+    if ( x11 == nodata || x21 == nodata || x31 == nodata || x12 == nodata || x22 == nodata
+         || x32 == nodata || x13 == nodata || x23 == nodata || x33 == nodata )
+    {
+      outputRow[j] = outputNodata;
+    }
+    else
+    {
+      const double dxx = ( x32 - 2 * x22 + x12 ) / dxxDenominator;
+      const double dxy = ( -x11 + x31 + x13 - x33 ) / dxyDenominator;
+      const double dyy = ( x21 - 2 * x22 + x23 ) / dyyDenominator;
+      outputRow[j] = dxx * dxx + 2 * dxy * dxy + dyy * dyy;
+    }
+
+    x11 = x21;
+    x21 = x31;
+    x12 = x22;
+    x22 = x32;
+    x13 = x23;
+    x23 = x33;
+  }
+}
@@ -458,7 +458,7 @@ QgsGeometrySnapper::QgsGeometrySnapper( QgsFeatureSource *referenceSource )
   : mReferenceSource( referenceSource )
 {
   // Build spatial index
-  mIndex = QgsSpatialIndex( *mReferenceSource );
+  mIndex = QgsPackedSpatialIndex( *mReferenceSource );
 }
 
 QgsFeatureList QgsGeometrySnapper::snapFeatures( const QgsFeatureList &features, double snapTolerance, SnapMode mode )
@@ -479,11 +479,10 @@ QgsGeometry QgsGeometrySnapper::snapGeometry( const QgsGeometry &geometry, doubl
 {
   // Get potential reference features and construct snap index
   QList<QgsGeometry> refGeometries;
-  mIndexMutex.lock();
   QgsRectangle searchBounds = geometry.boundingBox();
   searchBounds.grow( snapTolerance );
+  // the index is never modified, no need to lock it
   QgsFeatureIds refFeatureIds = mIndex.intersects( searchBounds ).toSet();
-  mIndexMutex.unlock();
 
   QgsFeatureRequest refFeatureRequest = QgsFeatureRequest().setFilterFids( refFeatureIds ).setSubsetOfAttributes( QgsAttributeList() );
   mReferenceLayerMutex.lock();
@@ -21,6 +21,7 @@
 #include <QFuture>
 #include <QStringList>
 #include "qgsspatialindex.h"
+#include "qgspackedspatialindex.h"
 #include "qgsabstractgeometry.h"
 #include "qgspoint.h"
 #include "qgsgeometry.h"
@@ -104,8 +105,7 @@ class ANALYSIS_EXPORT QgsGeometrySnapper : public QObject
     QgsFeatureSource *mReferenceSource = nullptr;
     QgsFeatureList mInputFeatures;
 
-    QgsSpatialIndex mIndex;
-    mutable QMutex mIndexMutex;
+    QgsPackedSpatialIndex mIndex;
     mutable QMutex mReferenceLayerMutex;
 
     void processFeature( QgsFeature &feature, double snapTolerance, SnapMode mode );
@@ -25,9 +25,17 @@
 #include "qgsrasterlayer.h"
 #include "qgsrasterblock.h"
 #include "qgslogger.h"
-#include "qgsgeos.h"
+#include "qgscurvepolygon.h"
+#include "qgsgeometrycollection.h"
+#include "qgslinestring.h"
 
 #include <QFile>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+
+//! Approximate number of raster cells read at once
+static const int STRIP_CELL_COUNT = 4 * 1024 * 1024;
 
 QgsZonalStatistics::QgsZonalStatistics( QgsVectorLayer *polygonLayer, QgsRasterLayer *rasterLayer, const QString &attributePrefix, int rasterBand, QgsZonalStatistics::Statistics stats )
   : mRasterLayer( rasterLayer )
@@ -164,6 +172,17 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
     QgsField varianceField( varianceFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
     newFieldList.push_back( varianceField );
   }
+  QStringList percentileFieldNames;
+  if ( mStatistics & QgsZonalStatistics::Percentiles )
+  {
+    for ( double percentile : qgis::as_const( mPercentiles ) )
+    {
+      const QString percentileFieldName = getUniqueFieldName( mAttributePrefix + 'p' + QString::number( percentile ), newFieldList );
+      QgsField percentileField( percentileFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
+      newFieldList.push_back( percentileField );
+      percentileFieldNames << percentileFieldName;
+    }
+  }
   vectorProvider->addAttributes( newFieldList );
 
   //index of the new fields
@@ -179,6 +198,9 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
   int majorityIndex = mStatistics & QgsZonalStatistics::Majority ? vectorProvider->fieldNameIndex( majorityFieldName ) : -1;
   int varietyIndex = mStatistics & QgsZonalStatistics::Variety ? vectorProvider->fieldNameIndex( varietyFieldName ) : -1;
   int varianceIndex = mStatistics & QgsZonalStatistics::Variance ? vectorProvider->fieldNameIndex( varianceFieldName ) : -1;
+  QList< int > percentileIndexes;
+  for ( const QString &percentileFieldName : qgis::as_const( percentileFieldNames ) )
+    percentileIndexes << vectorProvider->fieldNameIndex( percentileFieldName );
 
   if ( ( mStatistics & QgsZonalStatistics::Count && countIndex == -1 )
        || ( mStatistics & QgsZonalStatistics::Sum && sumIndex == -1 )
@@ -192,31 +214,31 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
        || ( mStatistics & QgsZonalStatistics::Majority && majorityIndex == -1 )
        || ( mStatistics & QgsZonalStatistics::Variety && varietyIndex == -1 )
        || ( mStatistics & QgsZonalStatistics::Variance && varianceIndex == -1 )
+       || percentileIndexes.contains( -1 )
      )
   {
     //failed to create a required field
     return 8;
   }
 
+  bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
+                          ( mStatistics & QgsZonalStatistics::StDev ) ||
+                          ( mStatistics & QgsZonalStatistics::Variance ) ||
+                          ( mStatistics & QgsZonalStatistics::Percentiles );
+  bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
+                              ( mStatistics & QgsZonalStatistics::Majority );
+
   //progress dialog
   long featureCount = vectorProvider->featureCount();
 
-  //iterate over each polygon
+  // first pass - collect the zones and the cells they cover
+  std::vector< std::unique_ptr< Zone > > zones;
+
   QgsFeatureRequest request;
   request.setSubsetOfAttributes( QgsAttributeList() );
   QgsFeatureIterator fi = vectorProvider->getFeatures( request );
   QgsFeature f;
-
-  bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
-                          ( mStatistics & QgsZonalStatistics::StDev ) ||
-                          ( mStatistics & QgsZonalStatistics::Variance );
-  bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
-                              ( mStatistics & QgsZonalStatistics::Majority );
-
-  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
   int featureCounter = 0;
-
-  QgsChangedAttributesMap changeMap;
   while ( fi.nextFeature( f ) )
   {
     if ( feedback && feedback->isCanceled() )
@@ -226,12 +248,12 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
 
     if ( feedback )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( featureCounter ) / featureCount );
+      feedback->setProgress( 10.0 * static_cast< double >( featureCounter ) / featureCount );
     }
+    ++featureCounter;
 
     if ( !f.hasGeometry() )
     {
-      ++featureCounter;
       continue;
     }
     QgsGeometry featureGeometry = f.geometry();
@@ -239,14 +261,12 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
     QgsRectangle featureRect = featureGeometry.boundingBox().intersect( &rasterBBox );
     if ( featureRect.isEmpty() )
     {
-      ++featureCounter;
       continue;
     }
 
     int offsetX, offsetY, nCellsX, nCellsY;
     if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
     {
-      ++featureCounter;
       continue;
     }
 
@@ -260,13 +280,30 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
       nCellsY = nCellsYProvider - offsetY;
     }
 
-    statisticsFromMiddlePointTest( featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                   rasterBBox, featureStats );
+    std::unique_ptr< Zone > zone = qgis::make_unique< Zone >( statsStoreValues, statsStoreValueCount );
+    zone->id = f.id();
+    zone->geometry = featureGeometry;
+    zone->offsetX = offsetX;
+    zone->offsetY = offsetY;
+    zone->nCellsX = nCellsX;
+    zone->nCellsY = nCellsY;
+    zones.push_back( std::move( zone ) );
+  }
+
+  // zones are sorted by their first row, so that the raster can be read in a single pass from top to bottom
+  std::stable_sort( zones.begin(), zones.end(), []( const std::unique_ptr< Zone > &a, const std::unique_ptr< Zone > &b )
+  {
+    return a->offsetY < b->offsetY;
+  } );
 
+  QgsChangedAttributesMap changeMap;
+  auto finishZone = [&]( Zone & zone )
+  {
+    FeatureStats &featureStats = zone.stats;
     if ( featureStats.count <= 1 )
     {
       //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
-      statisticsFromPreciseIntersection( featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
+      statisticsFromPreciseIntersection( zone.geometry, zone.offsetX, zone.offsetY, zone.nCellsX, zone.nCellsY, cellsizeX, cellsizeY,
                                          rasterBBox, featureStats );
     }
 
@@ -281,9 +318,10 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
       double mean = featureStats.sum / featureStats.count;
       if ( mStatistics & QgsZonalStatistics::Mean )
         changeAttributeMap.insert( meanIndex, QVariant( mean ) );
+      if ( mStatistics & QgsZonalStatistics::Median || mStatistics & QgsZonalStatistics::Percentiles )
+        std::sort( featureStats.values.begin(), featureStats.values.end() );
       if ( mStatistics & QgsZonalStatistics::Median )
       {
-        std::sort( featureStats.values.begin(), featureStats.values.end() );
         int size = featureStats.values.count();
         bool even = ( size % 2 ) < 1;
         double medianValue;
@@ -297,6 +335,20 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
         }
         changeAttributeMap.insert( medianIndex, QVariant( medianValue ) );
       }
+      if ( mStatistics & QgsZonalStatistics::Percentiles && !featureStats.values.isEmpty() )
+      {
+        // linear interpolation between the closest ranks
+        const int size = featureStats.values.count();
+        for ( int i = 0; i < percentileIndexes.count(); ++i )
+        {
+          const double rank = qBound( 0.0, mPercentiles.at( i ) / 100.0, 1.0 ) * ( size - 1 );
+          const int lowerRank = static_cast< int >( std::floor( rank ) );
+          const int upperRank = std::min( lowerRank + 1, size - 1 );
+          const double fraction = rank - lowerRank;
+          const double percentileValue = featureStats.values.at( lowerRank ) + fraction * ( static_cast< double >( featureStats.values.at( upperRank ) ) - featureStats.values.at( lowerRank ) );
+          changeAttributeMap.insert( percentileIndexes.at( i ), QVariant( percentileValue ) );
+        }
+      }
       if ( mStatistics & QgsZonalStatistics::StDev || mStatistics & QgsZonalStatistics::Variance )
       {
         double sumSquared = 0;
@@ -339,8 +391,84 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
         changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
     }
 
-    changeMap.insert( f.id(), changeAttributeMap );
-    ++featureCounter;
+    changeMap.insert( zone.id, changeAttributeMap );
+
+    // release the memory used by the zone
+    zone.geometry = QgsGeometry();
+    zone.edges.clear();
+    zone.activeEdges.clear();
+    featureStats.reset();
+  };
+
+  // second pass - read the raster once by strips of rows, and add the values of the cells whose
+  // center is within each zone intersecting the strip. Zones are processed in parallel, each zone
+  // receiving its values in the same order as when reading the raster zone by zone
+  const int stripHeight = std::max( 1, std::min( nCellsYProvider, STRIP_CELL_COUNT / std::max( nCellsXProvider, 1 ) ) );
+  const int stripCount = ( nCellsYProvider + stripHeight - 1 ) / stripHeight;
+  size_t nextZone = 0;
+  QList< Zone * > activeZones;
+  for ( int strip = 0; strip < stripCount && ( nextZone < zones.size() || !activeZones.isEmpty() ); ++strip )
+  {
+    if ( feedback && feedback->isCanceled() )
+    {
+      break;
+    }
+
+    if ( feedback )
+    {
+      feedback->setProgress( 10.0 + 90.0 * static_cast< double >( strip ) / stripCount );
+    }
+
+    const int firstRow = strip * stripHeight;
+    const int lastRow = std::min( firstRow + stripHeight, nCellsYProvider ) - 1;
+    while ( nextZone < zones.size() && zones[ nextZone ]->offsetY <= lastRow )
+    {
+      Zone *zone = zones[ nextZone++ ].get();
+      if ( zone->nCellsX <= 0 || zone->nCellsY <= 0 )
+        finishZone( *zone );
+      else
+        activeZones << zone;
+    }
+    if ( activeZones.isEmpty() )
+      continue;
+
+    const QgsRectangle stripExtent( rasterBBox.xMinimum(), rasterBBox.yMaximum() - ( lastRow + 1 ) * cellsizeY,
+                                    rasterBBox.xMaximum(), rasterBBox.yMaximum() - firstRow * cellsizeY );
+    std::unique_ptr< QgsRasterBlock > block( mRasterProvider->block( mRasterBand, stripExtent, nCellsXProvider, lastRow - firstRow + 1 ) );
+    if ( !block || block->isEmpty() )
+    {
+      QgsDebugMsg( QStringLiteral( "Could not read raster rows %1 to %2" ).arg( firstRow ).arg( lastRow ) );
+      continue;
+    }
+
+    const QgsRasterBlock *stripBlock = block.get();
+    QtConcurrent::blockingMap( activeZones, [&]( Zone * zone )
+    {
+      addZoneValues( *zone, stripBlock, firstRow, lastRow, rasterBBox, cellsizeX, cellsizeY );
+    } );
+
+    for ( auto it = activeZones.begin(); it != activeZones.end(); )
+    {
+      Zone *zone = *it;
+      if ( zone->offsetY + zone->nCellsY - 1 <= lastRow )
+      {
+        finishZone( *zone );
+        it = activeZones.erase( it );
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  if ( !feedback || !feedback->isCanceled() )
+  {
+    // zones which are not covered by the raster rows read above
+    for ( Zone *zone : qgis::as_const( activeZones ) )
+      finishZone( *zone );
+    for ( ; nextZone < zones.size(); ++nextZone )
+      finishZone( *zones[ nextZone ] );
   }
 
   vectorProvider->changeAttributeValues( changeMap );
@@ -387,53 +515,121 @@ int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle &rasterBBox, const Q
   return 0;
 }
 
-void QgsZonalStatistics::statisticsFromMiddlePointTest( const QgsGeometry &poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats )
+void QgsZonalStatistics::addZoneValues( Zone &zone, const QgsRasterBlock *block, int firstRow, int lastRow, const QgsRectangle &rasterBBox,
+    double cellSizeX, double cellSizeY ) const
 {
-  double cellCenterX, cellCenterY;
+  if ( !zone.edgesCollected )
+  {
+    zone.edgesCollected = true;
+    // first strip covering the zone - collect the polygon edges, sorted from top to bottom
+    const QgsAbstractGeometry *geometry = zone.geometry.constGet();
+    const QgsGeometryCollection *collection = qgsgeometry_cast< const QgsGeometryCollection * >( geometry );
+    const int partCount = collection ? collection->numGeometries() : 1;
+    for ( int part = 0; part < partCount; ++part )
+    {
+      const QgsCurvePolygon *polygon = qgsgeometry_cast< const QgsCurvePolygon * >( collection ? collection->geometryN( part ) : geometry );
+      if ( !polygon )
+        continue;
 
-  cellCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  stats.reset();
+      for ( int ringIndex = -1; ringIndex < polygon->numInteriorRings(); ++ringIndex )
+      {
+        const QgsCurve *ring = ringIndex < 0 ? polygon->exteriorRing() : polygon->interiorRing( ringIndex );
+        if ( !ring )
+          continue;
 
-  geos::unique_ptr polyGeos( poly.exportToGeos() );
-  if ( !polyGeos )
-  {
-    return;
+        std::unique_ptr< QgsLineString > line( ring->curveToLine() );
+        const int pointCount = line->numPoints();
+        for ( int i = 0; i < pointCount - 1; ++i )
+        {
+          const double y1 = line->yAt( i );
+          const double y2 = line->yAt( i + 1 );
+          if ( y1 == y2 )
+          {
+            // horizontal edges never cross a row center line, but may contain cell centers
+            zone.horizontalEdges.append( ZoneEdge{ std::min( line->xAt( i ), line->xAt( i + 1 ) ), y1, std::max( line->xAt( i ), line->xAt( i + 1 ) ), y2, y1, y1 } );
+            continue;
+          }
+
+          zone.edges.append( ZoneEdge{ line->xAt( i ), y1, line->xAt( i + 1 ), y2, std::max( y1, y2 ), std::min( y1, y2 ) } );
+        }
+      }
+    }
+    std::sort( zone.edges.begin(), zone.edges.end(), []( const ZoneEdge & a, const ZoneEdge & b )
+    {
+      return a.top > b.top;
+    } );
+    std::sort( zone.horizontalEdges.begin(), zone.horizontalEdges.end(), []( const ZoneEdge & a, const ZoneEdge & b )
+    {
+      return a.top > b.top;
+    } );
   }
 
-  GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
-  geos::prepared_unique_ptr polyGeosPrepared( GEOSPrepare_r( geosctxt, polyGeos.get() ) );
-  if ( !polyGeosPrepared )
+  // scanline rasterization: the cells whose center lies strictly between two successive crossings
+  // of the center line of their row with the polygon edges are inside the polygon, unless the center
+  // lies on a horizontal edge. Like a prepared GEOS contains test, centers on the boundary are excluded.
+  const int zoneFirstRow = std::max( firstRow, zone.offsetY );
+  const int zoneLastRow = std::min( lastRow, zone.offsetY + zone.nCellsY - 1 );
+  const int firstColumn = zone.offsetX;
+  const int lastColumn = zone.offsetX + zone.nCellsX - 1;
+  QVector< double > crossings;
+  QVector< const ZoneEdge * > rowHorizontalEdges;
+  for ( int row = zoneFirstRow; row <= zoneLastRow; ++row )
   {
-    return;
-  }
+    const double cellCenterY = rasterBBox.yMaximum() - row * cellSizeY - cellSizeY / 2;
 
-  GEOSCoordSequence *cellCenterCoords = nullptr;
-  geos::unique_ptr currentCellCenter;
+    // horizontal edges containing the centers of the cells of the row
+    while ( zone.nextHorizontalEdge < zone.horizontalEdges.size() && zone.horizontalEdges.at( zone.nextHorizontalEdge ).top > cellCenterY )
+      zone.nextHorizontalEdge++;
+    rowHorizontalEdges.clear();
+    for ( int i = zone.nextHorizontalEdge; i < zone.horizontalEdges.size() && zone.horizontalEdges.at( i ).top == cellCenterY; ++i )
+      rowHorizontalEdges << &zone.horizontalEdges.at( i );
 
-  QgsRectangle featureBBox = poly.boundingBox().intersect( &rasterBBox );
-  QgsRectangle intersectBBox = rasterBBox.intersect( &featureBBox );
+    while ( zone.nextEdge < zone.edges.size() && zone.edges.at( zone.nextEdge ).top > cellCenterY )
+      zone.activeEdges << zone.nextEdge++;
 
-  std::unique_ptr< QgsRasterBlock > block( mRasterProvider->block( mRasterBand, intersectBBox, nCellsX, nCellsY ) );
-  for ( int i = 0; i < nCellsY; ++i )
-  {
-    cellCenterX = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2;
-    for ( int j = 0; j < nCellsX; ++j )
+    crossings.clear();
+    for ( auto it = zone.activeEdges.begin(); it != zone.activeEdges.end(); )
     {
-      if ( validPixel( block->value( i, j ) ) )
+      const ZoneEdge &edge = zone.edges.at( *it );
+      if ( edge.bottom > cellCenterY )
+      {
+        // edge is above the remaining rows
+        it = zone.activeEdges.erase( it );
+        continue;
+      }
+      if ( ( edge.y1 <= cellCenterY && cellCenterY < edge.y2 ) || ( edge.y2 <= cellCenterY && cellCenterY < edge.y1 ) )
       {
-        cellCenterCoords = GEOSCoordSeq_create_r( geosctxt, 1, 2 );
-        GEOSCoordSeq_setX_r( geosctxt, cellCenterCoords, 0, cellCenterX );
-        GEOSCoordSeq_setY_r( geosctxt, cellCenterCoords, 0, cellCenterY );
-        currentCellCenter.reset( GEOSGeom_createPoint_r( geosctxt, cellCenterCoords ) );
-        if ( GEOSPreparedContains_r( geosctxt, polyGeosPrepared.get(), currentCellCenter.get() ) )
+        crossings << edge.x1 + ( cellCenterY - edge.y1 ) * ( edge.x2 - edge.x1 ) / ( edge.y2 - edge.y1 );
+      }
+      ++it;
+    }
+    std::sort( crossings.begin(), crossings.end() );
+
+    for ( int i = 0; i + 1 < crossings.size(); i += 2 )
+    {
+      const double spanStart = crossings.at( i );
+      const double spanEnd = crossings.at( i + 1 );
+      int column = std::max( firstColumn, static_cast< int >( std::floor( ( spanStart - rasterBBox.xMinimum() ) / cellSizeX ) ) );
+      for ( ; column <= lastColumn; ++column )
+      {
+        const double cellCenterX = rasterBBox.xMinimum() + column * cellSizeX + cellSizeX / 2;
+        if ( cellCenterX >= spanEnd )
+          break;
+        if ( cellCenterX <= spanStart )
+          continue;
+        if ( std::any_of( rowHorizontalEdges.constBegin(), rowHorizontalEdges.constEnd(), [cellCenterX]( const ZoneEdge * edge )
+      {
+        return edge->x1 <= cellCenterX && cellCenterX <= edge->x2;
+      } ) )
+          continue;
+
+        const double value = block->value( row - firstRow, column );
+        if ( validPixel( value ) )
         {
-          stats.addValue( block->value( i, j ) );
+          zone.stats.addValue( value );
         }
       }
-      cellCenterX += cellSizeX;
     }
-    cellCenterY -= cellSizeY;
   }
 }
 
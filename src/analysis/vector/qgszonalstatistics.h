@@ -20,14 +20,18 @@
 
 #include <QString>
 #include <QMap>
+#include <QList>
+#include <QVector>
 
 #include <limits>
 #include <cfloat>
 
 #include "qgis_analysis.h"
 #include "qgsfeedback.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
 
-class QgsGeometry;
+class QgsRasterBlock;
 class QgsVectorLayer;
 class QgsRasterLayer;
 class QgsRasterDataProvider;
@@ -36,7 +40,13 @@ class QgsField;
 
 /**
  * \ingroup analysis
- *  A class that calculates raster statistics (count, sum, mean) for a polygon or multipolygon layer and appends the results as attributes*/
+ *  A class that calculates raster statistics (count, sum, mean) for a polygon or multipolygon layer and appends the results as attributes.
+ *
+ *  The raster is read once from top to bottom, and the polygons intersecting each block of rows
+ *  are processed in parallel. The cells whose center lies within a polygon are used for its
+ *  statistics, or the cells partially covered by the polygon, weighted by the covered area,
+ *  if the polygon is too small to contain more than one cell center.
+ */
 class ANALYSIS_EXPORT QgsZonalStatistics
 {
   public:
@@ -56,6 +66,7 @@ class ANALYSIS_EXPORT QgsZonalStatistics
       Majority = 512, //!< Majority of pixel values
       Variety = 1024, //!< Variety (count of distinct) pixel values
       Variance = 2048, //!< Variance of pixel values
+      Percentiles = 4096, //!< Percentiles of pixel values, see setPercentiles() (since QGIS 3.2)
       All = Count | Sum | Mean | Median | StDev | Max | Min | Range | Minority | Majority | Variety | Variance
     };
     Q_DECLARE_FLAGS( Statistics, Statistic )
@@ -74,6 +85,24 @@ class ANALYSIS_EXPORT QgsZonalStatistics
       \returns 0 in case of success*/
     int calculateStatistics( QgsFeedback *feedback );
 
+    /**
+     * Sets the list of \a percentiles, between 0 and 100, calculated with the Percentiles statistic.
+     * A field named with the attribute prefix, "p" and the percentile is added for each of them.
+     * Percentiles are interpolated linearly between the closest ranks, so that the 50th percentile
+     * matches the median.
+     * \see percentiles()
+     * \since QGIS 3.2
+     */
+    void setPercentiles( const QList< double > &percentiles ) { mPercentiles = percentiles; }
+
+    /**
+     * Returns the list of percentiles calculated with the Percentiles statistic.
+     * Defaults to the 25th and 75th percentiles.
+     * \see setPercentiles()
+     * \since QGIS 3.2
+     */
+    QList< double > percentiles() const { return mPercentiles; }
+
   private:
     QgsZonalStatistics() = default;
 
@@ -118,16 +147,61 @@ class ANALYSIS_EXPORT QgsZonalStatistics
         bool mStoreValueCounts;
     };
 
+#ifndef SIP_RUN
+
+    //! Polygon edge, in map units
+    struct ZoneEdge
+    {
+      double x1;
+      double y1;
+      double x2;
+      double y2;
+      double top;
+      double bottom;
+    };
+
+    //! Polygon feature and the state of its statistics while the raster is read
+    struct Zone
+    {
+      Zone( bool storeValues, bool storeValueCounts )
+        : stats( storeValues, storeValueCounts )
+      {}
+
+      QgsFeatureId id = 0;
+      QgsGeometry geometry;
+      //! Window of raster cells covering the polygon
+      int offsetX = 0;
+      int offsetY = 0;
+      int nCellsX = 0;
+      int nCellsY = 0;
+      //! Edges of all the polygon rings, sorted from top to bottom
+      QVector< ZoneEdge > edges;
+      bool edgesCollected = false;
+      //! Index of the first edge below the rows processed so far
+      int nextEdge = 0;
+      //! Edges crossing the rows processed so far
+      QList< int > activeEdges;
+      //! Horizontal edges of all the polygon rings, sorted from top to bottom
+      QVector< ZoneEdge > horizontalEdges;
+      //! Index of the first horizontal edge below the rows processed so far
+      int nextHorizontalEdge = 0;
+      FeatureStats stats;
+    };
+
+    /**
+     * Adds the values of the cells of the rows \a firstRow to \a lastRow of the raster, stored in \a block,
+     * whose center is within the \a zone polygon. Rows must be passed from top to bottom.
+     */
+    void addZoneValues( Zone &zone, const QgsRasterBlock *block, int firstRow, int lastRow, const QgsRectangle &rasterBBox,
+                        double cellSizeX, double cellSizeY ) const;
+#endif
+
     /**
      * Analysis what cells need to be considered to cover the bounding box of a feature
       \returns 0 in case of success*/
     int cellInfoForBBox( const QgsRectangle &rasterBBox, const QgsRectangle &featureBBox, double cellSizeX, double cellSizeY,
                          int &offsetX, int &offsetY, int &nCellsX, int &nCellsY ) const;
 
-    //! Returns statistics by considering the pixels where the center point is within the polygon (fast)
-    void statisticsFromMiddlePointTest( const QgsGeometry &poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                        double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats );
-
     //! Returns statistics with precise pixel - polygon intersection test (slow)
     void statisticsFromPreciseIntersection( const QgsGeometry &poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
                                             double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats );
@@ -146,6 +220,7 @@ class ANALYSIS_EXPORT QgsZonalStatistics
     //! The nodata value of the input layer
     float mInputNodataValue = -1;
     Statistics mStatistics = QgsZonalStatistics::All;
+    QList< double > mPercentiles = QList< double >() << 25 << 75;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( QgsZonalStatistics::Statistics )
@@ -24,10 +24,15 @@
 #include "qgsgeometry.h"
 #include "qgsproject.h"
 
+#include <atomic>
+
 
 // from parser
 extern QgsExpressionNode *parseExpression( const QString &str, QString &parserErrorMsg );
 
+// whether prepared expressions are evaluated from bytecode
+static std::atomic< bool > sBytecodeEnabled( true );
+
 ///////////////////////////////////////////////
 // QVariant checks and conversions
 
@@ -99,6 +104,7 @@ bool QgsExpression::checkExpression( const QString &text, const QgsExpressionCon
 void QgsExpression::setExpression( const QString &expression )
 {
   detach();
+  d->mProgram.reset();
   d->mRootNode = ::parseExpression( expression, d->mParserErrorString );
   d->mEvalErrorString = QString();
   d->mExp = expression;
@@ -347,7 +353,9 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
     return false;
   }
 
-  return d->mRootNode->prepare( this, context );
+  bool result = d->mRootNode->prepare( this, context );
+  d->mProgram = sBytecodeEnabled ? QgsExpressionProgram::compile( d->mRootNode ) : nullptr;
+  return result;
 }
 
 QVariant QgsExpression::evaluate()
@@ -359,6 +367,9 @@ QVariant QgsExpression::evaluate()
     return QVariant();
   }
 
+  if ( d->mProgram )
+    return d->mProgram->evaluate( this, nullptr );
+
   return d->mRootNode->eval( this, static_cast<const QgsExpressionContext *>( nullptr ) );
 }
 
@@ -371,9 +382,73 @@ QVariant QgsExpression::evaluate( const QgsExpressionContext *context )
     return QVariant();
   }
 
+  if ( d->mProgram )
+    return d->mProgram->evaluate( this, context );
+
   return d->mRootNode->eval( this, context );
 }
 
+QVariantList QgsExpression::evaluateFeatures( const QgsFeatureList &features, QgsExpressionContext *context )
+{
+  QgsExpressionContext fallbackContext;
+  if ( !context )
+    context = &fallbackContext;
+
+  if ( d->mRootNode && d->mProgram )
+  {
+    d->mEvalErrorString = QString();
+    return d->mProgram->evaluateFeatures( features, this, context );
+  }
+
+  QVariantList results;
+  results.reserve( features.size() );
+  QString error;
+  for ( const QgsFeature &feature : features )
+  {
+    context->setFeature( feature );
+    results << evaluate( context );
+    if ( error.isNull() )
+      error = d->mEvalErrorString;
+  }
+  d->mEvalErrorString = error;
+  return results;
+}
+
+QBitArray QgsExpression::filterFeatures( const QgsFeatureList &features, QgsExpressionContext *context )
+{
+  QgsExpressionContext fallbackContext;
+  if ( !context )
+    context = &fallbackContext;
+
+  if ( d->mRootNode && d->mProgram )
+  {
+    d->mEvalErrorString = QString();
+    return d->mProgram->filterFeatures( features, this, context );
+  }
+
+  QBitArray selection( features.size() );
+  QString error;
+  for ( int i = 0; i < features.size(); ++i )
+  {
+    context->setFeature( features.at( i ) );
+    selection.setBit( i, evaluate( context ).toBool() );
+    if ( error.isNull() )
+      error = d->mEvalErrorString;
+  }
+  d->mEvalErrorString = error;
+  return selection;
+}
+
+void QgsExpression::setBytecodeEnabled( bool enabled )
+{
+  sBytecodeEnabled = enabled;
+}
+
+bool QgsExpression::isBytecodeEnabled()
+{
+  return sBytecodeEnabled;
+}
+
 bool QgsExpression::hasEvalError() const
 {
   return !d->mEvalErrorString.isNull();
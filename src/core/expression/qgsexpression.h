@@ -24,11 +24,13 @@
 #include <QDomDocument>
 #include <QCoreApplication>
 #include <QSet>
+#include <QBitArray>
 #include <functional>
 
 #include "qgis.h"
 #include "qgsunittypes.h"
 #include "qgsinterval.h"
+#include "qgsfeature.h"
 
 class QgsFeature;
 class QgsGeometry;
@@ -231,6 +233,55 @@ class CORE_EXPORT QgsExpression
      */
     QVariant evaluate( const QgsExpressionContext *context );
 
+    /**
+     * Evaluates the expression for each of a block of \a features, and returns the list of results.
+     * Features are set in turn as the feature of the \a context when needed.
+     *
+     * This is much faster than evaluating features one by one: prepared expressions apply each of
+     * their operations to the whole block at once, reading attributes as columns of typed values.
+     * Blocks of a few hundreds to a few thousands features work best.
+     *
+     * Results are NULL for features which could not be evaluated, and hasEvalError() and evalErrorString()
+     * report the first evaluation error.
+     *
+     * \param features features to evaluate the expression for
+     * \param context context for evaluating expression. The feature of the context is changed by this method.
+     * \note prepare() should be called before calling this method.
+     * \see filterFeatures()
+     * \since QGIS 3.2
+     */
+    QVariantList evaluateFeatures( const QgsFeatureList &features, QgsExpressionContext *context );
+
+    /**
+     * Evaluates the expression for each of a block of \a features like evaluateFeatures(), and returns
+     * an array with the bits set for the features for which the result converts to true, i.e. the features
+     * matching the expression used as a filter.
+     *
+     * \param features features to evaluate the expression for
+     * \param context context for evaluating expression. The feature of the context is changed by this method.
+     * \note prepare() should be called before calling this method.
+     * \see evaluateFeatures()
+     * \since QGIS 3.2
+     */
+    QBitArray filterFeatures( const QgsFeatureList &features, QgsExpressionContext *context );
+
+    /**
+     * Sets whether prepared expressions are evaluated from a compact bytecode built
+     * by prepare(), instead of walking the expression tree. Results are identical in
+     * both cases. Bytecode evaluation is enabled by default, disabling it is mostly
+     * useful for testing and benchmarking.
+     * \see isBytecodeEnabled()
+     * \since QGIS 3.2
+     */
+    static void setBytecodeEnabled( bool enabled );
+
+    /**
+     * Returns true if prepared expressions are evaluated from bytecode.
+     * \see setBytecodeEnabled()
+     * \since QGIS 3.2
+     */
+    static bool isBytecodeEnabled();
+
     //! Returns true if an error occurred when evaluating last input
     bool hasEvalError() const;
     //! Returns evaluation error
@@ -252,6 +252,22 @@ class CORE_EXPORT QgsExpressionNode SIP_ABSTRACT
      */
     bool prepare( QgsExpression *parent, const QgsExpressionContext *context );
 
+    /**
+     * Returns true if the node was found to be static during the prepare() step,
+     * in which case its value is cached and available from cachedStaticValue().
+     *
+     * \since QGIS 3.2
+     */
+    bool hasCachedStaticValue() const { return mHasCachedValue; }
+
+    /**
+     * Returns the value of the node cached during the prepare() step. Only valid
+     * if hasCachedStaticValue() returns true.
+     *
+     * \since QGIS 3.2
+     */
+    QVariant cachedStaticValue() const { return mCachedStaticValue; }
+
 
   protected:
 
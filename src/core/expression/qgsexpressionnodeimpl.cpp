@@ -90,6 +90,11 @@ QVariant QgsExpressionNodeUnaryOperator::evalNode( QgsExpression *parent, const
   QVariant val = mOperand->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalOperator( val, parent );
+}
+
+QVariant QgsExpressionNodeUnaryOperator::evalOperator( const QVariant &val, QgsExpression *parent )
+{
   switch ( mOp )
   {
     case uoNot:
@@ -168,6 +173,11 @@ QVariant QgsExpressionNodeBinaryOperator::evalNode( QgsExpression *parent, const
   QVariant vR = mOpRight->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalOperator( vL, vR, parent, context );
+}
+
+QVariant QgsExpressionNodeBinaryOperator::evalOperator( const QVariant &vL, const QVariant &vR, QgsExpression *parent, const QgsExpressionContext *context )
+{
   switch ( mOp )
   {
     case boPlus:
@@ -443,51 +453,7 @@ QVariant QgsExpressionNodeBinaryOperator::evalNode( QgsExpression *parent, const
         ENSURE_NO_EVAL_ERROR;
         QString regexp = QgsExpressionUtils::getStringValue( vR, parent );
         ENSURE_NO_EVAL_ERROR;
-        // TODO: cache QRegExp in case that regexp is a literal string (i.e. it will stay constant)
-        bool matches;
-        if ( mOp == boLike || mOp == boILike || mOp == boNotLike || mOp == boNotILike ) // change from LIKE syntax to regexp
-        {
-          QString esc_regexp = QRegExp::escape( regexp );
-          // manage escape % and _
-          if ( esc_regexp.startsWith( '%' ) )
-          {
-            esc_regexp.replace( 0, 1, QStringLiteral( ".*" ) );
-          }
-          QRegExp rx( "[^\\\\](%)" );
-          int pos = 0;
-          while ( ( pos = rx.indexIn( esc_regexp, pos ) ) != -1 )
-          {
-            esc_regexp.replace( pos + 1, 1, QStringLiteral( ".*" ) );
-            pos += 1;
-          }
-          rx.setPattern( QStringLiteral( "\\\\%" ) );
-          esc_regexp.replace( rx, QStringLiteral( "%" ) );
-          if ( esc_regexp.startsWith( '_' ) )
-          {
-            esc_regexp.replace( 0, 1, QStringLiteral( "." ) );
-          }
-          rx.setPattern( QStringLiteral( "[^\\\\](_)" ) );
-          pos = 0;
-          while ( ( pos = rx.indexIn( esc_regexp, pos ) ) != -1 )
-          {
-            esc_regexp.replace( pos + 1, 1, '.' );
-            pos += 1;
-          }
-          rx.setPattern( QStringLiteral( "\\\\_" ) );
-          esc_regexp.replace( rx, QStringLiteral( "_" ) );
-          matches = QRegExp( esc_regexp, mOp == boLike || mOp == boNotLike ? Qt::CaseSensitive : Qt::CaseInsensitive ).exactMatch( str );
-        }
-        else
-        {
-          matches = QRegExp( regexp ).indexIn( str ) != -1;
-        }
-
-        if ( mOp == boNotLike || mOp == boNotILike )
-        {
-          matches = !matches;
-        }
-
-        return matches ? TVL_True : TVL_False;
+        return matchesPattern( patternRegExp( regexp ), str ) ? TVL_True : TVL_False;
       }
 
     case boConcat:
@@ -509,6 +475,61 @@ QVariant QgsExpressionNodeBinaryOperator::evalNode( QgsExpression *parent, const
   return QVariant();
 }
 
+QRegExp QgsExpressionNodeBinaryOperator::patternRegExp( const QString &pattern ) const
+{
+  if ( mOp == boLike || mOp == boILike || mOp == boNotLike || mOp == boNotILike ) // change from LIKE syntax to regexp
+  {
+    QString esc_regexp = QRegExp::escape( pattern );
+    // manage escape % and _
+    if ( esc_regexp.startsWith( '%' ) )
+    {
+      esc_regexp.replace( 0, 1, QStringLiteral( ".*" ) );
+    }
+    QRegExp rx( "[^\\\\](%)" );
+    int pos = 0;
+    while ( ( pos = rx.indexIn( esc_regexp, pos ) ) != -1 )
+    {
+      esc_regexp.replace( pos + 1, 1, QStringLiteral( ".*" ) );
+      pos += 1;
+    }
+    rx.setPattern( QStringLiteral( "\\\\%" ) );
+    esc_regexp.replace( rx, QStringLiteral( "%" ) );
+    if ( esc_regexp.startsWith( '_' ) )
+    {
+      esc_regexp.replace( 0, 1, QStringLiteral( "." ) );
+    }
+    rx.setPattern( QStringLiteral( "[^\\\\](_)" ) );
+    pos = 0;
+    while ( ( pos = rx.indexIn( esc_regexp, pos ) ) != -1 )
+    {
+      esc_regexp.replace( pos + 1, 1, '.' );
+      pos += 1;
+    }
+    rx.setPattern( QStringLiteral( "\\\\_" ) );
+    esc_regexp.replace( rx, QStringLiteral( "_" ) );
+    return QRegExp( esc_regexp, mOp == boLike || mOp == boNotLike ? Qt::CaseSensitive : Qt::CaseInsensitive );
+  }
+  else
+  {
+    return QRegExp( pattern );
+  }
+}
+
+bool QgsExpressionNodeBinaryOperator::matchesPattern( const QRegExp &regExp, const QString &string ) const
+{
+  bool matches;
+  if ( mOp == boRegexp )
+    matches = regExp.indexIn( string ) != -1;
+  else
+    matches = regExp.exactMatch( string );
+
+  if ( mOp == boNotLike || mOp == boNotILike )
+  {
+    matches = !matches;
+  }
+  return matches;
+}
+
 bool QgsExpressionNodeBinaryOperator::compare( double diff )
 {
   switch ( mOp )
@@ -748,6 +769,11 @@ QVariant QgsExpressionNodeInOperator::evalNode( QgsExpression *parent, const Qgs
   if ( QgsExpressionUtils::isNull( v1 ) )
     return TVL_Unknown;
 
+  return evalOperator( v1, parent, context );
+}
+
+QVariant QgsExpressionNodeInOperator::evalOperator( const QVariant &v1, QgsExpression *parent, const QgsExpressionContext *context )
+{
   bool listHasNull = false;
 
   const QList< QgsExpressionNode * > nodeList = mList->list();
@@ -20,6 +20,8 @@
 #include "qgsexpressionnode.h"
 #include "qgsinterval.h"
 
+#include <QRegExp>
+
 /**
  * \ingroup core
  * A unary node is either negative as in boolean (not) or as in numbers (minus).
@@ -76,10 +78,18 @@ class CORE_EXPORT QgsExpressionNodeUnaryOperator : public QgsExpressionNode
     QString text() const;
 
   private:
+
+    /**
+     * Applies the operator to the value \a val of the operand.
+     */
+    QVariant evalOperator( const QVariant &val, QgsExpression *parent );
+
     UnaryOperator mOp;
     QgsExpressionNode *mOperand = nullptr;
 
     static const char *UNARY_OPERATOR_TEXT[];
+
+    friend class QgsExpressionProgram;
 };
 
 /**
@@ -183,6 +193,23 @@ class CORE_EXPORT QgsExpressionNodeBinaryOperator : public QgsExpressionNode
     QString text() const;
 
   private:
+
+    /**
+     * Applies the operator to the values \a vL and \a vR of the left and right operands.
+     */
+    QVariant evalOperator( const QVariant &vL, const QVariant &vR, QgsExpression *parent, const QgsExpressionContext *context );
+
+    /**
+     * Returns the regular expression matching strings for the \a pattern of a LIKE, ILIKE or ~ operator.
+     */
+    QRegExp patternRegExp( const QString &pattern ) const;
+
+    /**
+     * Returns true if \a string matches \a regExp, built by patternRegExp(). The result is inverted
+     * for the NOT LIKE and NOT ILIKE operators.
+     */
+    bool matchesPattern( const QRegExp &regExp, const QString &string ) const;
+
     bool compare( double diff );
     qlonglong computeInt( qlonglong x, qlonglong y );
     double computeDouble( double x, double y );
@@ -199,6 +226,8 @@ class CORE_EXPORT QgsExpressionNodeBinaryOperator : public QgsExpressionNode
     QgsExpressionNode *mOpRight = nullptr;
 
     static const char *BINARY_OPERATOR_TEXT[];
+
+    friend class QgsExpressionProgram;
 };
 
 /**
@@ -246,9 +275,17 @@ class CORE_EXPORT QgsExpressionNodeInOperator : public QgsExpressionNode
     bool isStatic( QgsExpression *parent, const QgsExpressionContext *context ) const override;
 
   private:
+
+    /**
+     * Tests whether the non null value \a v1 of the node is in the list.
+     */
+    QVariant evalOperator( const QVariant &v1, QgsExpression *parent, const QgsExpressionContext *context );
+
     QgsExpressionNode *mNode = nullptr;
     QgsExpressionNodeInOperator::NodeList *mList = nullptr;
     bool mNotIn;
+
+    friend class QgsExpressionProgram;
 };
 
 /**
@@ -364,6 +401,8 @@ class CORE_EXPORT QgsExpressionNodeColumnRef : public QgsExpressionNode
   private:
     QString mName;
     int mIndex;
+
+    friend class QgsExpressionProgram;
 };
 
 /**
@@ -406,6 +445,7 @@ class CORE_EXPORT QgsExpressionNodeCondition : public QgsExpressionNode
         QgsExpressionNode *mThenExp = nullptr;
 
         friend class QgsExpressionNodeCondition;
+        friend class QgsExpressionProgram;
     };
     typedef QList<QgsExpressionNodeCondition::WhenThen *> WhenThenList;
 
@@ -438,6 +478,8 @@ class CORE_EXPORT QgsExpressionNodeCondition : public QgsExpressionNode
   private:
     WhenThenList mConditions;
     QgsExpressionNode *mElseExp = nullptr;
+
+    friend class QgsExpressionProgram;
 };
 
 
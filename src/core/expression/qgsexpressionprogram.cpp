@@ -0,0 +1,982 @@
+/***************************************************************************
+                          qgsexpressionprogram.cpp
+                          ------------------------
+    begin                : April 2018
+    copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionprogram_p.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsexpressionfunction.h"
+#include "qgsexpressionutils.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <cmath>
+
+///@cond PRIVATE
+
+// names of the functions of QgsExpressionProgram::MathFunction
+const char *QgsExpressionProgram::MATH_FUNCTION_NAMES[] =
+{
+  "sqrt", "abs", "radians", "degrees", "sin", "cos", "tan", "asin", "acos", "atan", "exp", "ln", "log10", "floor", "ceil"
+};
+
+void QgsExpressionProgram::Value::setVariant( const QVariant &value )
+{
+  switch ( value.type() )
+  {
+    case QVariant::Invalid:
+      kind = Null;
+      return;
+
+    case QVariant::Int:
+      if ( value.isNull() )
+        break;
+      kind = Int;
+      integer = value.toInt();
+      return;
+
+    case QVariant::LongLong:
+      if ( value.isNull() )
+        break;
+      kind = LongLong;
+      integer = value.toLongLong();
+      return;
+
+    case QVariant::Double:
+      if ( value.isNull() )
+        break;
+      kind = Double;
+      number = value.toDouble();
+      return;
+
+    default:
+      break;
+  }
+
+  kind = Variant;
+  variant = value;
+}
+
+QVariant QgsExpressionProgram::Value::toVariant() const
+{
+  switch ( kind )
+  {
+    case Null:
+      return QVariant();
+    case Int:
+      return QVariant( static_cast< int >( integer ) );
+    case LongLong:
+      return QVariant( integer );
+    case Double:
+      return QVariant( number );
+    case Variant:
+      break;
+  }
+  return variant;
+}
+
+bool QgsExpressionProgram::Value::isNull() const
+{
+  return kind == Null || ( kind == Variant && QgsExpressionUtils::isNull( variant ) );
+}
+
+bool QgsExpressionProgram::Value::isInteger() const
+{
+  return kind == Int || kind == LongLong;
+}
+
+bool QgsExpressionProgram::Value::isFiniteNumber() const
+{
+  // non finite doubles cannot be converted by QgsExpressionUtils::getDoubleValue()
+  return kind == Int || kind == LongLong || ( kind == Double && std::isfinite( number ) );
+}
+
+double QgsExpressionProgram::Value::toDouble() const
+{
+  return kind == Double ? number : static_cast< double >( integer );
+}
+
+std::unique_ptr< QgsExpressionProgram > QgsExpressionProgram::compile( QgsExpressionNode *root )
+{
+  if ( !root || root->hasCachedStaticValue() )
+    return nullptr;
+
+  std::unique_ptr< QgsExpressionProgram > program( new QgsExpressionProgram() );
+  program->mRoot = root;
+  program->compileNode( root, 0 );
+
+  // the tree is evaluated anyway
+  if ( program->mInstructions.size() == 1 && program->mInstructions.at( 0 ).opcode == EvalNode )
+    return nullptr;
+
+  return program;
+}
+
+bool QgsExpressionProgram::constantValue( QgsExpressionNode *node, QVariant &value )
+{
+  if ( node->hasCachedStaticValue() )
+    value = node->cachedStaticValue();
+  else if ( node->nodeType() == QgsExpressionNode::ntLiteral )
+    value = static_cast< QgsExpressionNodeLiteral * >( node )->value();
+  else
+    return false;
+  return true;
+}
+
+int QgsExpressionProgram::append( Opcode opcode, int dest, int left, int right, int index, QgsExpressionNode *node )
+{
+  mInstructions.append( Instruction{ opcode, dest, left, right, index, node } );
+  return mInstructions.size() - 1;
+}
+
+void QgsExpressionProgram::compileNode( QgsExpressionNode *node, int dest )
+{
+  mRegisterCount = std::max( mRegisterCount, dest + 1 );
+
+  if ( node->hasCachedStaticValue() )
+  {
+    Value constant;
+    constant.setVariant( node->cachedStaticValue() );
+    mConstants.append( constant );
+    append( LoadConstant, dest, -1, -1, mConstants.size() - 1, node );
+    return;
+  }
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+    {
+      Value constant;
+      constant.setVariant( static_cast< QgsExpressionNodeLiteral * >( node )->value() );
+      mConstants.append( constant );
+      append( LoadConstant, dest, -1, -1, mConstants.size() - 1, node );
+      return;
+    }
+
+    case QgsExpressionNode::ntColumnRef:
+    {
+      QgsExpressionNodeColumnRef *columnRef = static_cast< QgsExpressionNodeColumnRef * >( node );
+      if ( columnRef->mIndex < 0 )
+        break;
+
+      append( LoadColumn, dest, -1, -1, columnRef->mIndex, node );
+      return;
+    }
+
+    case QgsExpressionNode::ntUnaryOperator:
+    {
+      QgsExpressionNodeUnaryOperator *unary = static_cast< QgsExpressionNodeUnaryOperator * >( node );
+      compileNode( unary->mOperand, dest );
+      append( Unary, dest, dest, -1, -1, node );
+      return;
+    }
+
+    case QgsExpressionNode::ntBinaryOperator:
+    {
+      QgsExpressionNodeBinaryOperator *binary = static_cast< QgsExpressionNodeBinaryOperator * >( node );
+      QVariant pattern;
+      switch ( binary->mOp )
+      {
+        case QgsExpressionNodeBinaryOperator::boRegexp:
+        case QgsExpressionNodeBinaryOperator::boLike:
+        case QgsExpressionNodeBinaryOperator::boNotLike:
+        case QgsExpressionNodeBinaryOperator::boILike:
+        case QgsExpressionNodeBinaryOperator::boNotILike:
+          // a constant pattern is only turned into a regular expression once per block of features
+          if ( constantValue( binary->mOpRight, pattern ) && !QgsExpressionUtils::isNull( pattern ) )
+          {
+            compileNode( binary->mOpLeft, dest );
+            mPatterns << pattern.toString();
+            append( Like, dest, dest, -1, mPatterns.size() - 1, node );
+            return;
+          }
+          break;
+
+        default:
+          break;
+      }
+
+      // the left operand is held by the destination register, so the right one needs the next
+      compileNode( binary->mOpLeft, dest );
+      compileNode( binary->mOpRight, dest + 1 );
+      append( Binary, dest, dest, dest + 1, -1, node );
+      return;
+    }
+
+    case QgsExpressionNode::ntCondition:
+    {
+      QgsExpressionNodeCondition *condition = static_cast< QgsExpressionNodeCondition * >( node );
+      QVector< int > jumpsToEnd;
+      for ( QgsExpressionNodeCondition::WhenThen *whenThen : qgis::as_const( condition->mConditions ) )
+      {
+        compileNode( whenThen->mWhenExp, dest );
+        int jumpToNext = append( JumpIfNotTrue, dest, dest, -1, -1, whenThen->mWhenExp );
+        compileNode( whenThen->mThenExp, dest );
+        jumpsToEnd << append( Jump, dest, -1, -1, -1, node );
+        mInstructions[jumpToNext].index = mInstructions.size();
+      }
+
+      if ( condition->mElseExp )
+      {
+        compileNode( condition->mElseExp, dest );
+      }
+      else
+      {
+        // NULL if no condition is matching
+        mConstants.append( Value() );
+        append( LoadConstant, dest, -1, -1, mConstants.size() - 1, node );
+      }
+
+      for ( int jump : qgis::as_const( jumpsToEnd ) )
+        mInstructions[jump].index = mInstructions.size();
+      return;
+    }
+
+    case QgsExpressionNode::ntInOperator:
+      if ( compileIn( static_cast< QgsExpressionNodeInOperator * >( node ), dest ) )
+        return;
+      break;
+
+    case QgsExpressionNode::ntFunction:
+    {
+      QgsExpressionNodeFunction *function = static_cast< QgsExpressionNodeFunction * >( node );
+      if ( !function->args() || function->args()->count() != 1 )
+        break;
+
+      const QString name = QgsExpression::Functions().at( function->fnIndex() )->name();
+      int mathFunction = -1;
+      for ( int i = 0; i <= Ceil; ++i )
+      {
+        if ( name == QLatin1String( MATH_FUNCTION_NAMES[i] ) )
+          mathFunction = i;
+      }
+      if ( mathFunction < 0 )
+        break;
+
+      compileNode( function->args()->at( 0 ), dest );
+      append( Function, dest, dest, -1, mathFunction, node );
+      if ( !mFunctionNames.contains( name ) )
+        mFunctionNames << name;
+      return;
+    }
+  }
+
+  append( EvalNode, dest, -1, -1, -1, node );
+}
+
+bool QgsExpressionProgram::compileIn( QgsExpressionNodeInOperator *node, int dest )
+{
+  const QList< QgsExpressionNode * > items = node->mList->list();
+  if ( items.isEmpty() )
+    return false;
+
+  // classify the items as QgsExpressionNodeInOperator::evalOperator() compares them
+  InList list;
+  for ( QgsExpressionNode *item : items )
+  {
+    QVariant value;
+    if ( !constantValue( item, value ) )
+      return false;
+
+    if ( QgsExpressionUtils::isNull( value ) )
+    {
+      list.hasNull = true;
+    }
+    else if ( QgsExpressionUtils::isDoubleSafe( value ) )
+    {
+      list.textual = false;
+      bool ok = false;
+      double number = value.toDouble( &ok );
+      if ( ok && std::isfinite( number ) )
+        list.numbers << number;
+      else
+        list.numeric = false;
+    }
+    else
+    {
+      list.numeric = false;
+      list.strings.insert( value.toString() );
+    }
+  }
+
+  mInLists.append( list );
+  compileNode( node->mNode, dest );
+  append( In, dest, dest, -1, mInLists.size() - 1, node );
+  return true;
+}
+
+int QgsExpressionProgram::tvlValue( const Value &value, QgsExpression *parent )
+{
+  // same as QgsExpressionUtils::getTVLValue()
+  switch ( value.kind )
+  {
+    case Value::Null:
+      return QgsExpressionUtils::Unknown;
+    case Value::Int:
+      return value.integer != 0 ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    case Value::LongLong:
+    case Value::Double:
+      return !qgsDoubleNear( value.toDouble(), 0.0 ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    case Value::Variant:
+      break;
+  }
+  return QgsExpressionUtils::getTVLValue( value.variant, parent );
+}
+
+void QgsExpressionProgram::setTvlValue( Value &result, int tvl )
+{
+  // same as QgsExpressionUtils::tvl2variant()
+  switch ( tvl )
+  {
+    case QgsExpressionUtils::False:
+      result.kind = Value::Int;
+      result.integer = 0;
+      break;
+    case QgsExpressionUtils::True:
+      result.kind = Value::Int;
+      result.integer = 1;
+      break;
+    default:
+      result.kind = Value::Null;
+      break;
+  }
+}
+
+bool QgsExpressionProgram::evalColumn( QgsExpressionNode *node, int index, const QgsFeature *feature, Value &result,
+                                       QgsExpression *parent, const QgsExpressionContext *context )
+{
+  if ( feature )
+  {
+    result.setVariant( feature->attribute( index ) );
+    return true;
+  }
+
+  result.setVariant( node->eval( parent, context ) );
+  return !parent->hasEvalError();
+}
+
+bool QgsExpressionProgram::evalUnary( QgsExpressionNodeUnaryOperator *node, const Value &operand, Value &result, QgsExpression *parent )
+{
+  // operations on numbers and nulls are done here, the others by the node
+  switch ( node->mOp )
+  {
+    case QgsExpressionNodeUnaryOperator::uoNot:
+      if ( operand.kind == Value::Variant )
+        break;
+      setTvlValue( result, QgsExpressionUtils::NOT[tvlValue( operand, parent )] );
+      return true;
+
+    case QgsExpressionNodeUnaryOperator::uoMinus:
+      if ( operand.isInteger() )
+      {
+        result.kind = Value::LongLong;
+        result.integer = -operand.integer;
+        return true;
+      }
+      else if ( operand.isFiniteNumber() )
+      {
+        result.kind = Value::Double;
+        result.number = -operand.number;
+        return true;
+      }
+      break;
+  }
+
+  result.setVariant( node->evalOperator( operand.toVariant(), parent ) );
+  return !parent->hasEvalError();
+}
+
+bool QgsExpressionProgram::evalBinary( QgsExpressionNodeBinaryOperator *node, const Value &left, const Value &right, Value &result,
+                                       QgsExpression *parent, const QgsExpressionContext *context )
+{
+  // operations on numbers and nulls, and comparisons of strings, are done here, following
+  // QgsExpressionNodeBinaryOperator::evalOperator(), the others by the node
+  const bool numbers = left.isFiniteNumber() && right.isFiniteNumber();
+  const bool hasNull = left.kind == Value::Null || right.kind == Value::Null;
+  // two strings are always compared as strings, even if they hold numbers
+  const bool strings = left.kind == Value::Variant && right.kind == Value::Variant
+                       && left.variant.type() == QVariant::String && right.variant.type() == QVariant::String
+                       && !left.variant.isNull() && !right.variant.isNull();
+
+  switch ( node->mOp )
+  {
+    case QgsExpressionNodeBinaryOperator::boPlus:
+    case QgsExpressionNodeBinaryOperator::boMinus:
+    case QgsExpressionNodeBinaryOperator::boMul:
+    case QgsExpressionNodeBinaryOperator::boDiv:
+    case QgsExpressionNodeBinaryOperator::boMod:
+      if ( hasNull )
+      {
+        result.kind = Value::Null;
+        return true;
+      }
+      else if ( !numbers )
+      {
+        break;
+      }
+      else if ( node->mOp != QgsExpressionNodeBinaryOperator::boDiv && left.isInteger() && right.isInteger() )
+      {
+        if ( node->mOp == QgsExpressionNodeBinaryOperator::boMod && right.integer == 0 )
+        {
+          result.kind = Value::Null;
+          return true;
+        }
+        result.integer = node->computeInt( left.integer, right.integer );
+        result.kind = Value::LongLong;
+        return true;
+      }
+      else
+      {
+        double fL = left.toDouble();
+        double fR = right.toDouble();
+        if ( ( node->mOp == QgsExpressionNodeBinaryOperator::boDiv || node->mOp == QgsExpressionNodeBinaryOperator::boMod ) && fR == 0. )
+        {
+          result.kind = Value::Null;
+          return true;
+        }
+        result.number = node->computeDouble( fL, fR );
+        result.kind = Value::Double;
+        return true;
+      }
+
+    case QgsExpressionNodeBinaryOperator::boIntDiv:
+      if ( !numbers )
+        break;
+      if ( right.toDouble() == 0. )
+      {
+        result.kind = Value::Null;
+        return true;
+      }
+      result.integer = qlonglong( std::floor( left.toDouble() / right.toDouble() ) );
+      result.kind = Value::LongLong;
+      return true;
+
+    case QgsExpressionNodeBinaryOperator::boPow:
+      if ( hasNull )
+      {
+        result.kind = Value::Null;
+        return true;
+      }
+      else if ( !numbers )
+      {
+        break;
+      }
+      result.number = std::pow( left.toDouble(), right.toDouble() );
+      result.kind = Value::Double;
+      return true;
+
+    case QgsExpressionNodeBinaryOperator::boAnd:
+    case QgsExpressionNodeBinaryOperator::boOr:
+    {
+      if ( left.kind == Value::Variant || right.kind == Value::Variant )
+        break;
+      int tvlL = tvlValue( left, parent );
+      int tvlR = tvlValue( right, parent );
+      setTvlValue( result, node->mOp == QgsExpressionNodeBinaryOperator::boAnd ? QgsExpressionUtils::AND[tvlL][tvlR] : QgsExpressionUtils::OR[tvlL][tvlR] );
+      return true;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boEQ:
+    case QgsExpressionNodeBinaryOperator::boNE:
+    case QgsExpressionNodeBinaryOperator::boLT:
+    case QgsExpressionNodeBinaryOperator::boGT:
+    case QgsExpressionNodeBinaryOperator::boLE:
+    case QgsExpressionNodeBinaryOperator::boGE:
+      if ( hasNull )
+      {
+        result.kind = Value::Null;
+        return true;
+      }
+      else if ( strings )
+      {
+        setTvlValue( result, node->compare( QString::compare( left.variant.toString(), right.variant.toString() ) ) ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        return true;
+      }
+      else if ( !numbers )
+      {
+        break;
+      }
+      setTvlValue( result, node->compare( left.toDouble() - right.toDouble() ) ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+      return true;
+
+    case QgsExpressionNodeBinaryOperator::boIs:
+    case QgsExpressionNodeBinaryOperator::boIsNot:
+    {
+      // variants may hold null values too
+      if ( ( left.kind == Value::Variant || right.kind == Value::Variant ) && !strings )
+        break;
+
+      bool equal = false;
+      if ( strings )
+        equal = QString::compare( left.variant.toString(), right.variant.toString() ) == 0;
+      else if ( left.kind == Value::Null || right.kind == Value::Null )
+        equal = left.kind == right.kind;
+      else if ( numbers )
+        equal = qgsDoubleNear( left.toDouble(), right.toDouble() );
+      else
+        break;
+
+      setTvlValue( result, equal == ( node->mOp == QgsExpressionNodeBinaryOperator::boIs ) ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+      return true;
+    }
+
+    default:
+      break;
+  }
+
+  QVariant vL = left.toVariant();
+  QVariant vR = right.toVariant();
+  result.setVariant( node->evalOperator( vL, vR, parent, context ) );
+  return !parent->hasEvalError();
+}
+
+bool QgsExpressionProgram::evalIn( QgsExpressionNodeInOperator *node, const InList &list, const Value &operand, Value &result,
+                                   QgsExpression *parent, const QgsExpressionContext *context )
+{
+  if ( operand.isNull() )
+  {
+    setTvlValue( result, QgsExpressionUtils::Unknown );
+    return true;
+  }
+
+  bool found = false;
+  if ( list.numeric && operand.isFiniteNumber() )
+  {
+    const double value = operand.toDouble();
+    found = std::any_of( list.numbers.constBegin(), list.numbers.constEnd(), [value]( double number ) { return qgsDoubleNear( value, number ); } );
+  }
+  else if ( list.textual )
+  {
+    found = list.strings.contains( operand.toVariant().toString() );
+  }
+  else
+  {
+    result.setVariant( node->evalOperator( operand.toVariant(), parent, context ) );
+    return !parent->hasEvalError();
+  }
+
+  // same as QgsExpressionNodeInOperator::evalOperator()
+  if ( found )
+    setTvlValue( result, node->mNotIn ? QgsExpressionUtils::False : QgsExpressionUtils::True );
+  else if ( list.hasNull )
+    setTvlValue( result, QgsExpressionUtils::Unknown );
+  else
+    setTvlValue( result, node->mNotIn ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+  return true;
+}
+
+void QgsExpressionProgram::evalLike( QgsExpressionNodeBinaryOperator *node, const QRegExp &regExp, const Value &operand, Value &result )
+{
+  if ( operand.isNull() )
+  {
+    setTvlValue( result, QgsExpressionUtils::Unknown );
+    return;
+  }
+
+  const QString string = operand.toVariant().toString();
+  setTvlValue( result, node->matchesPattern( regExp, string ) ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+}
+
+bool QgsExpressionProgram::evalFunction( QgsExpressionNodeFunction *node, int function, const Value &operand, Value &result,
+    QgsExpression *parent, const QgsExpressionContext *context )
+{
+  // functions return NULL for NULL arguments, see QgsExpressionFunction::run()
+  if ( operand.isNull() )
+  {
+    result.kind = Value::Null;
+    return true;
+  }
+
+  if ( !operand.isFiniteNumber() )
+  {
+    // conversions and their errors are left to the function
+    QgsExpressionFunction *fd = QgsExpression::Functions().at( node->fnIndex() );
+    result.setVariant( fd->func( QVariantList() << operand.toVariant(), context, parent, node ) );
+    return !parent->hasEvalError();
+  }
+
+  // same as the static functions of qgsexpressionfunction.cpp
+  const double x = operand.toDouble();
+  double value = 0;
+  switch ( static_cast< MathFunction >( function ) )
+  {
+    case Sqrt:
+      value = std::sqrt( x );
+      break;
+    case Abs:
+      value = std::fabs( x );
+      break;
+    case Radians:
+      value = ( x * M_PI ) / 180;
+      break;
+    case Degrees:
+      value = ( 180 * x ) / M_PI;
+      break;
+    case Sin:
+      value = std::sin( x );
+      break;
+    case Cos:
+      value = std::cos( x );
+      break;
+    case Tan:
+      value = std::tan( x );
+      break;
+    case Asin:
+      value = std::asin( x );
+      break;
+    case Acos:
+      value = std::acos( x );
+      break;
+    case Atan:
+      value = std::atan( x );
+      break;
+    case Exp:
+      value = std::exp( x );
+      break;
+    case Ln:
+    case Log10:
+      if ( x <= 0 )
+      {
+        result.kind = Value::Null;
+        return true;
+      }
+      value = function == Ln ? std::log( x ) : std::log10( x );
+      break;
+    case Floor:
+      value = std::floor( x );
+      break;
+    case Ceil:
+      value = std::ceil( x );
+      break;
+  }
+
+  result.kind = Value::Double;
+  result.number = value;
+  return true;
+}
+
+bool QgsExpressionProgram::overridesFunctions( const QgsExpressionContext *context ) const
+{
+  if ( !context )
+    return false;
+
+  for ( const QString &name : mFunctionNames )
+  {
+    if ( context->hasFunction( name ) )
+      return true;
+  }
+  return false;
+}
+
+QVariant QgsExpressionProgram::evaluate( QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  // functions of the context take precedence over the compiled ones
+  if ( overridesFunctions( context ) )
+    return mRoot->eval( parent, context );
+
+  // registers are not members, so that a program shared by copies of an expression can be evaluated from several threads
+  QVarLengthArray< Value, 16 > registers( mRegisterCount );
+
+  const Instruction *instructions = mInstructions.constData();
+  const int count = mInstructions.size();
+  int i = 0;
+  while ( i < count )
+  {
+    const Instruction &instruction = instructions[i++];
+    switch ( instruction.opcode )
+    {
+      case LoadConstant:
+        registers[instruction.dest] = mConstants.at( instruction.index );
+        break;
+
+      case LoadColumn:
+        if ( context && context->hasFeature() )
+        {
+          const QgsFeature feature = context->feature();
+          evalColumn( instruction.node, instruction.index, &feature, registers[instruction.dest], parent, context );
+        }
+        else if ( !evalColumn( instruction.node, instruction.index, nullptr, registers[instruction.dest], parent, context ) )
+        {
+          return QVariant();
+        }
+        break;
+
+      case EvalNode:
+        registers[instruction.dest].setVariant( instruction.node->eval( parent, context ) );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        break;
+
+      case Unary:
+        if ( !evalUnary( static_cast< QgsExpressionNodeUnaryOperator * >( instruction.node ), registers[instruction.left], registers[instruction.dest], parent ) )
+          return QVariant();
+        break;
+
+      case Binary:
+        if ( !evalBinary( static_cast< QgsExpressionNodeBinaryOperator * >( instruction.node ), registers[instruction.left], registers[instruction.right],
+                          registers[instruction.dest], parent, context ) )
+          return QVariant();
+        break;
+
+      case Jump:
+        i = instruction.index;
+        break;
+
+      case JumpIfNotTrue:
+      {
+        int tvl = tvlValue( registers[instruction.left], parent );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        if ( tvl != QgsExpressionUtils::True )
+          i = instruction.index;
+        break;
+      }
+
+      case In:
+        if ( !evalIn( static_cast< QgsExpressionNodeInOperator * >( instruction.node ), mInLists.at( instruction.index ), registers[instruction.left],
+                      registers[instruction.dest], parent, context ) )
+          return QVariant();
+        break;
+
+      case Like:
+      {
+        QgsExpressionNodeBinaryOperator *node = static_cast< QgsExpressionNodeBinaryOperator * >( instruction.node );
+        evalLike( node, node->patternRegExp( mPatterns.at( instruction.index ) ), registers[instruction.left], registers[instruction.dest] );
+        break;
+      }
+
+      case Function:
+        if ( !evalFunction( static_cast< QgsExpressionNodeFunction * >( instruction.node ), instruction.index, registers[instruction.left],
+                            registers[instruction.dest], parent, context ) )
+          return QVariant();
+        break;
+    }
+  }
+
+  return registers[0].toVariant();
+}
+
+QVector< QgsExpressionProgram::Value > QgsExpressionProgram::evaluateBlock( const QgsFeatureList &features, QgsExpression *parent, QgsExpressionContext *context ) const
+{
+  const int rowCount = features.size();
+  QString error;
+
+  if ( overridesFunctions( context ) )
+  {
+    // functions of the context take precedence over the compiled ones
+    QVector< Value > results( rowCount );
+    for ( int row = 0; row < rowCount; ++row )
+    {
+      context->setFeature( features.at( row ) );
+      results[row].setVariant( mRoot->eval( parent, context ) );
+      if ( parent->hasEvalError() )
+      {
+        if ( error.isNull() )
+          error = parent->evalErrorString();
+        parent->setEvalErrorString( QString() );
+        results[row] = Value();
+      }
+    }
+    parent->setEvalErrorString( error );
+    return results;
+  }
+
+  // register r of row i is at r * rowCount + i, so that the results are the first column
+  QVector< Value > registers( mRegisterCount * rowCount );
+  Value *columns = registers.data();
+
+  // index of the next instruction of each row. Jumps only go forward, so applying each instruction
+  // in order to the rows waiting for it follows the path of every row.
+  const Instruction *instructions = mInstructions.constData();
+  const int count = mInstructions.size();
+  QVector< int > next( rowCount, 0 );
+  QVector< int > rows;
+  rows.reserve( rowCount );
+
+  // stops evaluating a row with an error, and keeps the first error
+  auto fail = [&]( int row )
+  {
+    if ( error.isNull() )
+      error = parent->evalErrorString();
+    parent->setEvalErrorString( QString() );
+    next[row] = count;
+    columns[row] = Value();
+  };
+
+  for ( int i = 0; i < count; ++i )
+  {
+    rows.clear();
+    for ( int row = 0; row < rowCount; ++row )
+    {
+      if ( next[row] == i )
+      {
+        next[row] = i + 1;
+        rows << row;
+      }
+    }
+    if ( rows.isEmpty() )
+      continue;
+
+    const Instruction &instruction = instructions[i];
+    Value *dest = columns + instruction.dest * rowCount;
+    const Value *left = instruction.left >= 0 ? columns + instruction.left * rowCount : nullptr;
+    const Value *right = instruction.right >= 0 ? columns + instruction.right * rowCount : nullptr;
+
+    switch ( instruction.opcode )
+    {
+      case LoadConstant:
+      {
+        const Value &constant = mConstants.at( instruction.index );
+        for ( int row : qgis::as_const( rows ) )
+          dest[row] = constant;
+        break;
+      }
+
+      case LoadColumn:
+        for ( int row : qgis::as_const( rows ) )
+        {
+          if ( !evalColumn( instruction.node, instruction.index, &features.at( row ), dest[row], parent, context ) )
+            fail( row );
+        }
+        break;
+
+      case EvalNode:
+        for ( int row : qgis::as_const( rows ) )
+        {
+          context->setFeature( features.at( row ) );
+          dest[row].setVariant( instruction.node->eval( parent, context ) );
+          if ( parent->hasEvalError() )
+            fail( row );
+        }
+        break;
+
+      case Unary:
+      {
+        QgsExpressionNodeUnaryOperator *node = static_cast< QgsExpressionNodeUnaryOperator * >( instruction.node );
+        for ( int row : qgis::as_const( rows ) )
+        {
+          if ( !evalUnary( node, left[row], dest[row], parent ) )
+            fail( row );
+        }
+        break;
+      }
+
+      case Binary:
+      {
+        QgsExpressionNodeBinaryOperator *node = static_cast< QgsExpressionNodeBinaryOperator * >( instruction.node );
+        for ( int row : qgis::as_const( rows ) )
+        {
+          if ( !evalBinary( node, left[row], right[row], dest[row], parent, context ) )
+            fail( row );
+        }
+        break;
+      }
+
+      case Jump:
+        for ( int row : qgis::as_const( rows ) )
+          next[row] = instruction.index;
+        break;
+
+      case JumpIfNotTrue:
+        for ( int row : qgis::as_const( rows ) )
+        {
+          int tvl = tvlValue( left[row], parent );
+          if ( parent->hasEvalError() )
+            fail( row );
+          else if ( tvl != QgsExpressionUtils::True )
+            next[row] = instruction.index;
+        }
+        break;
+
+      case In:
+      {
+        QgsExpressionNodeInOperator *node = static_cast< QgsExpressionNodeInOperator * >( instruction.node );
+        const InList &list = mInLists.at( instruction.index );
+        for ( int row : qgis::as_const( rows ) )
+        {
+          if ( !evalIn( node, list, left[row], dest[row], parent, context ) )
+            fail( row );
+        }
+        break;
+      }
+
+      case Like:
+      {
+        QgsExpressionNodeBinaryOperator *node = static_cast< QgsExpressionNodeBinaryOperator * >( instruction.node );
+        const QRegExp regExp = node->patternRegExp( mPatterns.at( instruction.index ) );
+        for ( int row : qgis::as_const( rows ) )
+          evalLike( node, regExp, left[row], dest[row] );
+        break;
+      }
+
+      case Function:
+      {
+        QgsExpressionNodeFunction *node = static_cast< QgsExpressionNodeFunction * >( instruction.node );
+        for ( int row : qgis::as_const( rows ) )
+        {
+          if ( !evalFunction( node, instruction.index, left[row], dest[row], parent, context ) )
+            fail( row );
+        }
+        break;
+      }
+    }
+  }
+
+  parent->setEvalErrorString( error );
+  registers.resize( rowCount );
+  return registers;
+}
+
+QVariantList QgsExpressionProgram::evaluateFeatures( const QgsFeatureList &features, QgsExpression *parent, QgsExpressionContext *context ) const
+{
+  const QVector< Value > values = evaluateBlock( features, parent, context );
+
+  QVariantList results;
+  results.reserve( values.size() );
+  for ( const Value &value : values )
+    results << value.toVariant();
+  return results;
+}
+
+QBitArray QgsExpressionProgram::filterFeatures( const QgsFeatureList &features, QgsExpression *parent, QgsExpressionContext *context ) const
+{
+  const QVector< Value > values = evaluateBlock( features, parent, context );
+
+  // same as QVariant::toBool()
+  QBitArray selection( values.size() );
+  for ( int row = 0; row < values.size(); ++row )
+  {
+    const Value &value = values.at( row );
+    switch ( value.kind )
+    {
+      case Value::Null:
+        break;
+      case Value::Int:
+      case Value::LongLong:
+        selection.setBit( row, value.integer != 0 );
+        break;
+      case Value::Double:
+        selection.setBit( row, value.number != 0.0 );
+        break;
+      case Value::Variant:
+        selection.setBit( row, value.variant.toBool() );
+        break;
+    }
+  }
+  return selection;
+}
+
+///@endcond
@@ -0,0 +1,262 @@
+/***************************************************************************
+                          qgsexpressionprogram_p.h
+                          ------------------------
+    begin                : April 2018
+    copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONPROGRAM_P_H
+#define QGSEXPRESSIONPROGRAM_P_H
+
+#define SIP_NO_FILE
+
+///@cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgsexpressionnodeimpl.h"
+#include "qgsfeature.h"
+
+#include <QBitArray>
+#include <QSet>
+#include <QVariant>
+#include <QVector>
+
+#include <memory>
+
+class QgsExpression;
+class QgsExpressionContext;
+
+/**
+ * \ingroup core
+ * Expression tree of a prepared QgsExpression compiled to a flat list of instructions.
+ *
+ * Instructions read and write registers holding either plain numbers or variants,
+ * so that arithmetic, comparisons and logical operators on numbers, which make up
+ * most of rendering rules and data defined properties, are evaluated without
+ * virtual calls nor boxing values into QVariant. Nodes found to be static by
+ * prepare() are loaded as constants. Comparisons of two strings are evaluated
+ * directly too, without trying to convert them to numbers first.
+ *
+ * IN operators with a constant list, LIKE operators with a constant pattern and the
+ * common math functions are compiled too.
+ *
+ * Operators on other values use the operator implementation of their node, and nodes
+ * which cannot be compiled (other functions, variables...) are evaluated from the tree,
+ * so that the results and evaluation errors are always the same as tree evaluation.
+ *
+ * A program can also be evaluated over a block of features at once. Registers then
+ * hold a column of values, one per feature, and each instruction is applied to the
+ * whole column before the next one, which keeps per feature overhead to a minimum.
+ *
+ * The program references the nodes of the expression tree, it must not outlive it.
+ * \since QGIS 3.2
+ */
+class QgsExpressionProgram
+{
+  public:
+
+    /**
+     * Compiles the expression tree starting at \a root, which must have been prepared.
+     * \returns the compiled program, or nullptr if the tree would not be evaluated
+     * faster by a program
+     */
+    static std::unique_ptr< QgsExpressionProgram > compile( QgsExpressionNode *root );
+
+    /**
+     * Evaluates the program with the given \a context. Errors are reported to the \a parent
+     * expression.
+     */
+    QVariant evaluate( QgsExpression *parent, const QgsExpressionContext *context ) const;
+
+    /**
+     * Evaluates the program for each of the \a features, setting them as the feature of the \a context,
+     * which must not be null, when tree evaluation needs it. Results for features with evaluation errors are NULL, and the first
+     * error is reported to the \a parent expression.
+     */
+    QVariantList evaluateFeatures( const QgsFeatureList &features, QgsExpression *parent, QgsExpressionContext *context ) const;
+
+    /**
+     * Evaluates the program for each of the \a features like evaluateFeatures(), and returns a bit
+     * set for each result which converts to true.
+     */
+    QBitArray filterFeatures( const QgsFeatureList &features, QgsExpression *parent, QgsExpressionContext *context ) const;
+
+  private:
+
+    //! Content of a register
+    struct Value
+    {
+      enum Kind
+      {
+        Null, //!< Invalid variant
+        Int, //!< Non null variant of type int
+        LongLong, //!< Non null variant of type qlonglong
+        Double, //!< Non null variant of type double
+        Variant, //!< Any other variant
+      };
+
+      Kind kind = Null;
+      //! Value for the Int and LongLong kinds
+      qlonglong integer = 0;
+      //! Value for the Double kind
+      double number = 0;
+      //! Value for the Variant kind
+      QVariant variant;
+
+      void setVariant( const QVariant &value );
+      QVariant toVariant() const;
+
+      //! Returns true for the Null kind, and null values of the Variant kind
+      bool isNull() const;
+
+      //! Returns true for the Int and LongLong kinds
+      bool isInteger() const;
+      //! Returns true for the Int and LongLong kinds, and finite values of the Double kind
+      bool isFiniteNumber() const;
+      //! Returns the value of the Int, LongLong and Double kinds as a double
+      double toDouble() const;
+    };
+
+    enum Opcode
+    {
+      LoadConstant, //!< Copies the constant index to dest
+      LoadColumn, //!< Loads the feature attribute index to dest
+      EvalNode, //!< Evaluates the tree of the node to dest
+      Unary, //!< Applies the unary operator of the node to left
+      Binary, //!< Applies the binary operator of the node to left and right
+      Jump, //!< Continues at instruction index
+      JumpIfNotTrue, //!< Continues at instruction index if left is not true
+      In, //!< Applies the IN operator of the node with the constant list index to left
+      Like, //!< Applies the LIKE operator of the node with the constant pattern index to left
+      Function, //!< Applies the math function index of the node to left
+    };
+
+    //! Math functions applied by the Function instruction
+    enum MathFunction
+    {
+      Sqrt,
+      Abs,
+      Radians,
+      Degrees,
+      Sin,
+      Cos,
+      Tan,
+      Asin,
+      Acos,
+      Atan,
+      Exp,
+      Ln,
+      Log10,
+      Floor,
+      Ceil,
+    };
+
+    static const char *MATH_FUNCTION_NAMES[];
+
+    //! Constant list of an IN operator
+    struct InList
+    {
+      //! True if all the non null items are finite numbers
+      bool numeric = true;
+      //! True if none of the non null items can be converted to a number, so that they are compared as strings
+      bool textual = true;
+      bool hasNull = false;
+      //! Non null items, if numeric
+      QVector< double > numbers;
+      //! Non null items, if textual
+      QSet< QString > strings;
+    };
+
+    struct Instruction
+    {
+      Opcode opcode;
+      int dest;
+      int left;
+      int right;
+      int index;
+      QgsExpressionNode *node;
+    };
+
+    QgsExpressionProgram() = default;
+
+    /**
+     * Appends the instructions evaluating \a node to the register \a dest, using the following
+     * registers for intermediate values.
+     */
+    void compileNode( QgsExpressionNode *node, int dest );
+
+    //! Returns in \a value the value of \a node if it is constant
+    static bool constantValue( QgsExpressionNode *node, QVariant &value );
+
+    //! Appends the instructions evaluating the IN operator \a node to \a dest, returns false if its list is not constant
+    bool compileIn( QgsExpressionNodeInOperator *node, int dest );
+
+    //! Appends an instruction and returns its index
+    int append( Opcode opcode, int dest, int left, int right, int index, QgsExpressionNode *node );
+
+    //! Returns the three-valued logic value (QgsExpressionUtils::TVL) of a register
+    static int tvlValue( const Value &value, QgsExpression *parent );
+
+    //! Stores a three-valued logic value (QgsExpressionUtils::TVL) to a register
+    static void setTvlValue( Value &result, int tvl );
+
+    /**
+     * Loads the attribute of a column reference from \a feature, or evaluates its \a node
+     * if there is no feature. Returns false if an evaluation error occurred.
+     */
+    static bool evalColumn( QgsExpressionNode *node, int index, const QgsFeature *feature, Value &result,
+                            QgsExpression *parent, const QgsExpressionContext *context );
+
+    //! Applies a unary operator, returns false if an evaluation error occurred
+    static bool evalUnary( QgsExpressionNodeUnaryOperator *node, const Value &operand, Value &result, QgsExpression *parent );
+
+    //! Applies a binary operator, returns false if an evaluation error occurred
+    static bool evalBinary( QgsExpressionNodeBinaryOperator *node, const Value &left, const Value &right, Value &result,
+                            QgsExpression *parent, const QgsExpressionContext *context );
+
+    //! Applies an IN operator, returns false if an evaluation error occurred
+    static bool evalIn( QgsExpressionNodeInOperator *node, const InList &list, const Value &operand, Value &result,
+                        QgsExpression *parent, const QgsExpressionContext *context );
+
+    //! Applies a LIKE operator, built by QgsExpressionNodeBinaryOperator::patternRegExp()
+    static void evalLike( QgsExpressionNodeBinaryOperator *node, const QRegExp &regExp, const Value &operand, Value &result );
+
+    //! Applies a math function, returns false if an evaluation error occurred
+    static bool evalFunction( QgsExpressionNodeFunction *node, int function, const Value &operand, Value &result,
+                              QgsExpression *parent, const QgsExpressionContext *context );
+
+    //! Returns true if the \a context overrides some of the functions compiled in the program
+    bool overridesFunctions( const QgsExpressionContext *context ) const;
+
+    //! Evaluates the program for each of the \a features, returns the column of results
+    QVector< Value > evaluateBlock( const QgsFeatureList &features, QgsExpression *parent, QgsExpressionContext *context ) const;
+
+    QgsExpressionNode *mRoot = nullptr;
+    QVector< Instruction > mInstructions;
+    QVector< Value > mConstants;
+    QVector< InList > mInLists;
+    QStringList mPatterns;
+    QStringList mFunctionNames;
+    int mRegisterCount = 0;
+};
+
+///@endcond
+
+#endif // QGSEXPRESSIONPROGRAM_P_H
@@ -132,7 +132,7 @@ namespace pal
        * \param lPos pointer to an array of candidates, will be filled by generated candidates
        * \param mapBoundary map boundary geometry
        * \param mapShape generate candidates for this spatial entity
-       * \param candidates index for candidates
+       * \param candidates index for candidates, or nullptr if the candidates should not be indexed
        * \returns the number of candidates generated in lPos
        */
       int createCandidates( QList<LabelPosition *> &lPos, const GEOSPreparedGeometry *mapBoundary, PointSet *mapShape, RTree<LabelPosition *, double, 2, double> *candidates );
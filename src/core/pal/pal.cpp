@@ -42,6 +42,12 @@
 #include "internalexception.h"
 #include "util.h"
 #include <cfloat>
+#include <numeric>
+#include <vector>
+
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtConcurrentMap>
 
 using namespace pal;
 
@@ -86,6 +92,9 @@ void Pal::removeLayer( Layer *layer )
   mMutex.lock();
   if ( QgsAbstractLabelProvider *key = mLayers.key( layer, nullptr ) )
   {
+    if ( std::shared_ptr< ExtractionJob > job = mExtractionJobs.take( layer ) )
+      discardExtraction( job );
+
     mLayers.remove( key );
     delete layer;
   }
@@ -97,6 +106,12 @@ Pal::~Pal()
 
   mMutex.lock();
 
+  // candidates generated in the background are not needed anymore
+  mStopExtractions.store( 1 );
+  for ( const std::shared_ptr< ExtractionJob > &job : qgis::as_const( mExtractionJobs ) )
+    discardExtraction( job );
+  mExtractionJobs.clear();
+
   qDeleteAll( mLayers );
   mLayers.clear();
   mMutex.unlock();
@@ -120,11 +135,10 @@ Layer *Pal::addLayer( QgsAbstractLabelProvider *provider, const QString &layerNa
 
 typedef struct _featCbackCtx
 {
-  Layer *layer = nullptr;
-  QLinkedList<Feats *> *fFeats;
-  RTree<FeaturePart *, double, 2, double> *obstacles;
-  RTree<LabelPosition *, double, 2, double> *candidates;
+  QList<Feats *> *features = nullptr;
+  QList<FeaturePart *> *obstacles = nullptr;
   const GEOSPreparedGeometry *mapBoundary = nullptr;
+  const QAtomicInt *stop = nullptr;
 } FeatCallBackCtx;
 
 
@@ -136,14 +150,15 @@ typedef struct _featCbackCtx
  */
 bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
 {
-  double amin[2], amax[2];
   FeatCallBackCtx *context = reinterpret_cast< FeatCallBackCtx * >( ctx );
 
+  if ( context->stop->load() )
+    return false; // the candidates are not needed anymore
+
   // Holes of the feature are obstacles
   for ( int i = 0; i < ft_ptr->getNumSelfObstacles(); i++ )
   {
-    ft_ptr->getSelfObstacle( i )->getBoundingBox( amin, amax );
-    context->obstacles->Insert( amin, amax, ft_ptr->getSelfObstacle( i ) );
+    context->obstacles->append( ft_ptr->getSelfObstacle( i ) );
 
     if ( !ft_ptr->getSelfObstacle( i )->getHoleOf() )
     {
@@ -151,9 +166,9 @@ bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
     }
   }
 
-  // generate candidates for the feature part
+  // generate candidates for the feature part, they are indexed once all layers are extracted
   QList< LabelPosition * > lPos;
-  if ( ft_ptr->createCandidates( lPos, context->mapBoundary, ft_ptr, context->candidates ) )
+  if ( ft_ptr->createCandidates( lPos, context->mapBoundary, ft_ptr, nullptr ) )
   {
     // valid features are added to fFeats
     Feats *ft = new Feats();
@@ -161,7 +176,7 @@ bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
     ft->shape = nullptr;
     ft->lPos = lPos;
     ft->priority = ft_ptr->calculatePriority();
-    context->fFeats->append( ft );
+    context->features->append( ft );
   }
   else
   {
@@ -172,12 +187,6 @@ bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
   return true;
 }
 
-typedef struct _obstaclebackCtx
-{
-  RTree<FeaturePart *, double, 2, double> *obstacles;
-  int obstacleCount;
-} ObstacleCallBackCtx;
-
 /*
  * Callback function
  *
@@ -185,16 +194,167 @@ typedef struct _obstaclebackCtx
  */
 bool extractObstaclesCallback( FeaturePart *ft_ptr, void *ctx )
 {
-  double amin[2], amax[2];
-  ObstacleCallBackCtx *context = reinterpret_cast< ObstacleCallBackCtx * >( ctx );
-
-  // insert into obstacles
-  ft_ptr->getBoundingBox( amin, amax );
-  context->obstacles->Insert( amin, amax, ft_ptr );
-  context->obstacleCount++;
+  QList<FeaturePart *> *obstacles = reinterpret_cast< QList<FeaturePart *> * >( ctx );
+  obstacles->append( ft_ptr );
   return true;
 }
 
+/*
+ * Features with their candidates and obstacles extracted from a layer,
+ * in the order they have to be inserted into the problem indexes
+ */
+struct Pal::LayerExtraction
+{
+  Layer *layer = nullptr;
+  QList<Feats *> features;
+  QList<FeaturePart *> obstacles;
+};
+
+/*
+ * Extraction of a layer started before the problem is extracted. It is run by a thread of the
+ * global pool, or by the thread extracting the problem if no thread of the pool started it yet,
+ * so that extracting the problem never waits for jobs queued behind other work.
+ */
+class Pal::ExtractionJob
+{
+  public:
+    ExtractionJob( Pal *pal, Layer *layer, const QgsRectangle &extent, const QgsGeometry &mapBoundary )
+      : mPal( pal )
+      , mExtent( extent )
+      , mMapBoundary( mapBoundary )
+    {
+      extraction.layer = layer;
+    }
+
+    //! Queues the job on the global thread pool
+    static void start( const std::shared_ptr< ExtractionJob > &job )
+    {
+      QThreadPool::globalInstance()->start( new Task( job ) );
+    }
+
+    /**
+     * Makes sure the job is done: runs it unless a thread of the pool already started it,
+     * in which case it waits for that thread. If \a run is false, the job is not run anymore
+     * if it was not started yet.
+     */
+    void finish( bool run = true )
+    {
+      if ( mState.testAndSetOrdered( Pending, Running ) )
+      {
+        if ( run )
+          mPal->extractLayer( extraction, mExtent, mMapBoundary );
+        mState.store( Finished );
+        return;
+      }
+
+      QMutexLocker locker( &mMutex );
+      while ( mState.load() != Finished )
+        mFinished.wait( &mMutex );
+    }
+
+    LayerExtraction extraction;
+
+  private:
+    enum State
+    {
+      Pending,
+      Running,
+      Finished
+    };
+
+    //! Runnable of the pool, which may outlive the job when another thread took it over
+    class Task : public QRunnable
+    {
+      public:
+        explicit Task( const std::shared_ptr< ExtractionJob > &job )
+          : mJob( job )
+        {}
+
+        void run() override
+        {
+          if ( !mJob->mState.testAndSetOrdered( Pending, Running ) )
+            return;
+
+          mJob->mPal->extractLayer( mJob->extraction, mJob->mExtent, mJob->mMapBoundary );
+
+          QMutexLocker locker( &mJob->mMutex );
+          mJob->mState.store( Finished );
+          mJob->mFinished.wakeAll();
+        }
+
+      private:
+        std::shared_ptr< ExtractionJob > mJob;
+    };
+
+    Pal *mPal = nullptr;
+    QgsRectangle mExtent;
+    QgsGeometry mMapBoundary;
+
+    QAtomicInt mState;
+    QMutex mMutex;
+    QWaitCondition mFinished;
+};
+
+void Pal::startExtraction( Layer *layer, const QgsRectangle &extent, const QgsGeometry &mapBoundary )
+{
+  std::shared_ptr< ExtractionJob > job = std::make_shared< ExtractionJob >( this, layer, extent, mapBoundary );
+
+  mMutex.lock();
+  if ( mLayers.key( layer, nullptr ) && !mExtractionJobs.contains( layer ) )
+  {
+    mExtractionJobs.insert( layer, job );
+    ExtractionJob::start( job );
+  }
+  mMutex.unlock();
+}
+
+void Pal::discardExtraction( const std::shared_ptr< ExtractionJob > &job )
+{
+  job->finish( false );
+  for ( Feats *ft : qgis::as_const( job->extraction.features ) )
+  {
+    qDeleteAll( ft->lPos );
+    delete ft;
+  }
+  job->extraction.features.clear();
+}
+
+void Pal::extractLayer( LayerExtraction &extraction, const QgsRectangle &extent, const QgsGeometry &mapBoundary )
+{
+  double amin[2] = { extent.xMinimum(), extent.yMinimum() };
+  double amax[2] = { extent.xMaximum(), extent.yMaximum() };
+
+  Layer *layer = extraction.layer;
+
+  // check for connected features with the same label text and join them
+  if ( layer->mergeConnectedLines() )
+    layer->joinConnectedFeatures();
+
+  layer->chopFeaturesAtRepeatDistance();
+
+  // Prepared geometries are not thread safe, each layer prepares its own map boundary.
+  // All the layers share the GEOS context handle of QGIS, as the threads rendering layers do:
+  // the GEOS functions used here only keep error messages in the handle, which may then get
+  // mixed up between threads.
+  geos::unique_ptr mapBoundaryGeos( mapBoundary.exportToGeos() );
+  geos::prepared_unique_ptr mapBoundaryPrepared( GEOSPrepare_r( geosContext(), mapBoundaryGeos.get() ) );
+
+  FeatCallBackCtx context;
+  context.features = &extraction.features;
+  context.obstacles = &extraction.obstacles;
+  context.mapBoundary = mapBoundaryPrepared.get();
+  context.stop = &mStopExtractions;
+
+  layer->mMutex.lock();
+
+  // find features within bounding box and generate candidates list
+  layer->mFeatureIndex->Search( amin, amax, extractFeatCallback, static_cast< void * >( &context ) );
+  // find obstacles within bounding box
+  layer->mObstacleIndex->Search( amin, amax, extractObstaclesCallback, static_cast< void * >( &extraction.obstacles ) );
+
+  layer->mMutex.unlock();
+}
+
 typedef struct _filterContext
 {
   RTree<LabelPosition *, double, 2, double> *cdtsIndex;
@@ -249,63 +409,79 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
 
   QLinkedList<Feats *> *fFeats = new QLinkedList<Feats *>;
 
-  FeatCallBackCtx context;
-
-  // prepare map boundary
-  geos::unique_ptr mapBoundaryGeos( mapBoundary.exportToGeos() );
-  geos::prepared_unique_ptr mapBoundaryPrepared( GEOSPrepare_r( geosContext(), mapBoundaryGeos.get() ) );
-
-  context.fFeats = fFeats;
-  context.obstacles = obstacles;
-  context.candidates = prob->candidates;
-  context.mapBoundary = mapBoundaryPrepared.get();
-
-  ObstacleCallBackCtx obstacleContext;
-  obstacleContext.obstacles = obstacles;
-  obstacleContext.obstacleCount = 0;
-
   // first step : extract features from layers
 
-  int previousFeatureCount = 0;
-  int previousObstacleCount = 0;
-
   QStringList layersWithFeaturesInBBox;
 
   mMutex.lock();
+
+  std::vector< LayerExtraction > extractions;
+  std::vector< std::shared_ptr< ExtractionJob > > jobs;
   Q_FOREACH ( Layer *layer, mLayers )
   {
-    if ( !layer )
+    std::shared_ptr< ExtractionJob > job = mExtractionJobs.take( layer );
+
+    // only select those who are active
+    if ( !layer || !layer->active() )
     {
-      // invalid layer name
+      if ( job )
+        discardExtraction( job );
       continue;
     }
 
-    // only select those who are active
-    if ( !layer->active() )
-      continue;
+    LayerExtraction extraction;
+    extraction.layer = layer;
+    extractions.push_back( extraction );
+    jobs.push_back( job );
+  }
 
-    // check for connected features with the same label text and join them
-    if ( layer->mergeConnectedLines() )
-      layer->joinConnectedFeatures();
+  // layers are independent from each other, so their candidates are generated concurrently. Candidates
+  // of the layers started with startExtraction() were generated in the background, while other layers
+  // were being rendered, or are generated here if no thread of the pool took their job yet
+  std::vector< int > indexes( extractions.size() );
+  std::iota( indexes.begin(), indexes.end(), 0 );
+  QtConcurrent::blockingMap( indexes, [this, &extractions, &jobs, &extent, &mapBoundary]( int index )
+  {
+    const std::shared_ptr< ExtractionJob > &job = jobs.at( index );
+    if ( job )
+    {
+      job->finish( !isCanceled() );
+      return;
+    }
 
-    layer->chopFeaturesAtRepeatDistance();
+    if ( isCanceled() )
+      return;
+
+    extractLayer( extractions[ index ], extent, mapBoundary );
+  } );
 
-    layer->mMutex.lock();
+  for ( size_t index = 0; index < jobs.size(); ++index )
+  {
+    if ( jobs.at( index ) )
+      extractions[ index ] = jobs.at( index )->extraction;
+  }
 
-    // find features within bounding box and generate candidates list
-    context.layer = layer;
-    layer->mFeatureIndex->Search( amin, amax, extractFeatCallback, static_cast< void * >( &context ) );
-    // find obstacles within bounding box
-    layer->mObstacleIndex->Search( amin, amax, extractObstaclesCallback, static_cast< void * >( &obstacleContext ) );
+  // index the extracted obstacles and candidates, in layer order
+  for ( const LayerExtraction &extraction : qgis::as_const( extractions ) )
+  {
+    for ( FeaturePart *obstacle : extraction.obstacles )
+    {
+      double omin[2], omax[2];
+      obstacle->getBoundingBox( omin, omax );
+      obstacles->Insert( omin, omax, obstacle );
+    }
 
-    layer->mMutex.unlock();
+    for ( Feats *ft : extraction.features )
+    {
+      for ( LabelPosition *candidate : qgis::as_const( ft->lPos ) )
+        candidate->insertIntoIndex( prob->candidates );
+      fFeats->append( ft );
+    }
 
-    if ( context.fFeats->size() - previousFeatureCount > 0 || obstacleContext.obstacleCount > previousObstacleCount )
+    if ( !extraction.features.isEmpty() || !extraction.obstacles.isEmpty() )
     {
-      layersWithFeaturesInBBox << layer->name();
+      layersWithFeaturesInBBox << extraction.layer->name();
     }
-    previousFeatureCount = context.fFeats->size();
-    previousObstacleCount = obstacleContext.obstacleCount;
   }
   mMutex.unlock();
 
@@ -466,12 +642,7 @@ QList<LabelPosition *> Pal::solveProblem( Problem *prob, bool displayAll )
 
   try
   {
-    if ( searchMethod == FALP )
-      prob->init_sol_falp();
-    else if ( searchMethod == CHAIN )
-      prob->chain_search();
-    else
-      prob->popmusic();
+    prob->solve();
   }
   catch ( InternalException::Empty )
   {
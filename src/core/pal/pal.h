@@ -39,6 +39,9 @@
 #include <QList>
 #include <iostream>
 #include <ctime>
+#include <memory>
+#include <QAtomicInt>
+#include <QHash>
 #include <QMutex>
 #include <QStringList>
 
@@ -145,6 +148,18 @@ namespace pal
        */
       std::unique_ptr< Problem > extractProblem( const QgsRectangle &extent, const QgsGeometry &mapBoundary );
 
+      /**
+       * Starts generating the candidates of a \a layer in the background, on the global thread pool,
+       * so that this overlaps with other work such as the rendering of other layers. No more features
+       * may be registered in the layer afterwards.
+       *
+       * The \a extent and \a mapBoundary must be the ones which will be passed to extractProblem(),
+       * which then uses the candidates generated in the background (or generates them itself if no
+       * thread of the pool started the job yet).
+       * \since QGIS 3.2
+       */
+      void startExtraction( Layer *layer, const QgsRectangle &extent, const QgsGeometry &mapBoundary );
+
       QList<LabelPosition *> solveProblem( Problem *prob, bool displayAll );
 
       /**
@@ -161,6 +176,22 @@ namespace pal
        */
       bool getShowPartial();
 
+      /**
+       * Sets whether independent parts of the labeling problem are solved concurrently.
+       * The placement does not depend on the number of threads, but it differs from the placement
+       * found when the whole problem is solved sequentially.
+       * \see solveConcurrently()
+       * \since QGIS 3.2
+       */
+      void setSolveConcurrently( bool concurrently ) { mSolveConcurrently = concurrently; }
+
+      /**
+       * Returns whether independent parts of the labeling problem are solved concurrently.
+       * \see setSolveConcurrently()
+       * \since QGIS 3.2
+       */
+      bool solveConcurrently() const { return mSolveConcurrently; }
+
       /**
        * \brief set # candidates to generate for points features
        * Higher the value is, longer Pal::labeller will spend time
@@ -223,6 +254,24 @@ namespace pal
 
       QMutex mMutex;
 
+      struct LayerExtraction;
+      class ExtractionJob;
+
+      //! Candidate generations started by startExtraction(), by layer
+      QHash< Layer *, std::shared_ptr< ExtractionJob > > mExtractionJobs;
+
+      //! Set when the jobs started by startExtraction() are not needed anymore
+      QAtomicInt mStopExtractions;
+
+      /**
+       * Generates the candidates of the features of a layer within \a extent, and collects its obstacles.
+       * Only the layer is modified, so that layers can be extracted concurrently.
+       */
+      void extractLayer( LayerExtraction &extraction, const QgsRectangle &extent, const QgsGeometry &mapBoundary );
+
+      //! Drops the extraction \a job of a layer: waits for it if a thread of the pool runs it, and deletes the candidates it generated
+      static void discardExtraction( const std::shared_ptr< ExtractionJob > &job );
+
       /**
        * \brief maximum # candidates for a point
        */
@@ -257,6 +306,9 @@ namespace pal
        */
       bool showPartial;
 
+      //! Whether independent parts of the problem are solved concurrently
+      bool mSolveConcurrently = false;
+
       //! Callback that may be called from PAL to check whether the job has not been canceled in meanwhile
       FnIsCanceled fnIsCanceled;
       //! Application-specific context for the cancelation check function
@@ -266,6 +318,11 @@ namespace pal
        * Creates a Problem, by extracting labels and generating candidates from the given \a extent.
        * The \a mapBoundary geometry specifies the actual visible region of the map, and is used
        * for pruning candidates which fall outside the visible region.
+       *
+       * Candidates of the layers passed to startExtraction() are generated in the background
+       * while other layers are still being rendered, the candidates of the other layers are
+       * generated concurrently for each layer here. They are indexed in the order of the layers,
+       * so the problem does not depend on how the layers were scheduled.
        */
       std::unique_ptr< Problem > extract( const QgsRectangle &extent, const QgsGeometry &mapBoundary );
 
@@ -38,9 +38,18 @@
 #include "util.h"
 #include "priorityqueue.h"
 #include "internalexception.h"
+#include <algorithm>
 #include <cfloat>
+#include <exception>
 #include <limits> //for INT_MAX
+#include <numeric>
+#include <vector>
 
+#include <QAtomicInt>
+#include <QMutex>
+#include <QtConcurrentMap>
+
+#include "qgis.h"
 #include "qgslabelingengine.h"
 
 using namespace pal;
@@ -176,6 +185,227 @@ void Problem::reduce()
   delete[] ok;
 }
 
+// Minimum number of features of a sub problem, smaller components are grouped
+// together so that solving tiny problems does not cost more than it saves
+static const int MIN_SUB_PROBLEM_FEATURES = 64;
+
+typedef struct
+{
+  LabelPosition *lp = nullptr;
+  std::vector< int > *parents = nullptr;
+} ComponentContext;
+
+static int componentRoot( std::vector< int > &parents, int feature )
+{
+  while ( parents[feature] != feature )
+  {
+    parents[feature] = parents[parents[feature]];
+    feature = parents[feature];
+  }
+  return feature;
+}
+
+bool componentCallback( LabelPosition *lp, void *ctx )
+{
+  ComponentContext *context = reinterpret_cast< ComponentContext * >( ctx );
+  std::vector< int > &parents = *context->parents;
+
+  int root1 = componentRoot( parents, context->lp->getProblemFeatureId() );
+  int root2 = componentRoot( parents, lp->getProblemFeatureId() );
+  if ( root1 != root2 && context->lp->isInConflict( lp ) )
+  {
+    // the smallest feature stays the root, so that components are ordered by their first feature
+    parents[std::max( root1, root2 )] = std::min( root1, root2 );
+  }
+  return true;
+}
+
+QVector< QVector< int > > Problem::conflictComponents()
+{
+  std::vector< int > parents( nbft );
+  std::iota( parents.begin(), parents.end(), 0 );
+
+  ComponentContext context;
+  context.parents = &parents;
+
+  double amin[2];
+  double amax[2];
+  for ( int i = 0; i < nbft; i++ )
+  {
+    for ( int j = 0; j < featNbLp[i]; j++ )
+    {
+      context.lp = mLabelPositions.at( featStartId[i] + j );
+      context.lp->getBoundingBox( amin, amax );
+      candidates->Search( amin, amax, componentCallback, reinterpret_cast< void * >( &context ) );
+    }
+  }
+
+  QVector< QVector< int > > components;
+  std::vector< int > componentIndex( nbft, -1 );
+  for ( int i = 0; i < nbft; i++ )
+  {
+    int root = componentRoot( parents, i );
+    if ( root == i )
+    {
+      componentIndex[i] = components.size();
+      components.append( QVector< int >() );
+    }
+    components[componentIndex[root]].append( i );
+  }
+  return components;
+}
+
+std::unique_ptr< Problem > Problem::subProblem( const QVector< int > &features )
+{
+  std::unique_ptr< Problem > sub = qgis::make_unique< Problem >();
+  sub->pal = pal;
+  sub->displayAll = displayAll;
+  std::copy( bbox, bbox + 4, sub->bbox );
+
+  sub->nbft = features.size();
+  sub->featStartId = new int[sub->nbft];
+  sub->featNbLp = new int[sub->nbft];
+  sub->inactiveCost = new double[sub->nbft];
+
+  try
+  {
+    for ( int i = 0; i < sub->nbft; i++ )
+    {
+      int feature = features.at( i );
+      sub->featStartId[i] = sub->nblp;
+      sub->featNbLp[i] = featNbLp[feature];
+      sub->inactiveCost[i] = inactiveCost[feature];
+
+      for ( int j = 0; j < featNbLp[feature]; j++ )
+      {
+        LabelPosition *lp = mLabelPositions.at( featStartId[feature] + j );
+        lp->setProblemIds( i, sub->nblp );
+        lp->insertIntoIndex( sub->candidates );
+        sub->mLabelPositions.append( lp );
+        sub->nbOverlap += lp->getNumOverlaps();
+        sub->nblp++;
+      }
+    }
+  }
+  catch ( ... )
+  {
+    // the candidates belong to this problem, they must not be deleted with the sub problem
+    sub->mLabelPositions.clear();
+    throw;
+  }
+  sub->all_nblp = sub->nblp;
+
+  return sub;
+}
+
+void Problem::solveWhole()
+{
+  if ( pal->searchMethod == FALP )
+    init_sol_falp();
+  else if ( pal->searchMethod == CHAIN )
+    chain_search();
+  else
+    popmusic();
+}
+
+void Problem::solve()
+{
+  // heuristics do not visit the features of sub problems in the same order as in the whole
+  // problem, so the whole problem is solved unless the solution is allowed to differ
+  if ( !pal->solveConcurrently() || nbft < 2 * MIN_SUB_PROBLEM_FEATURES )
+  {
+    solveWhole();
+    return;
+  }
+
+  // candidates of different components never conflict, so each group of components
+  // can be solved on its own
+  QVector< QVector< int > > groups;
+  const QVector< QVector< int > > components = conflictComponents();
+  for ( const QVector< int > &component : components )
+  {
+    if ( groups.isEmpty() || groups.last().size() >= MIN_SUB_PROBLEM_FEATURES )
+      groups.append( component );
+    else
+      groups.last() += component;
+  }
+
+  if ( groups.size() < 2 )
+  {
+    solveWhole();
+    return;
+  }
+
+  for ( QVector< int > &group : groups )
+    std::sort( group.begin(), group.end() );
+
+  // largest problems first, so that they do not end up being solved alone at the end
+  std::vector< int > order( groups.size() );
+  std::iota( order.begin(), order.end(), 0 );
+  std::stable_sort( order.begin(), order.end(), [&groups]( int a, int b ) { return groups.at( a ).size() > groups.at( b ).size(); } );
+
+  std::vector< std::unique_ptr< Problem > > subProblems( groups.size() );
+  QAtomicInt emptyQueue( 0 );
+  QMutex failureMutex;
+  std::exception_ptr failure;
+  QtConcurrent::blockingMap( order, [this, &groups, &subProblems, &emptyQueue, &failureMutex, &failure]( int group )
+  {
+    // exceptions must not escape the workers: the sub problems would then be deleted with candidates of this problem
+    try
+    {
+      subProblems[group] = subProblem( groups.at( group ) );
+      subProblems[group]->solveWhole();
+    }
+    catch ( InternalException::Empty )
+    {
+      emptyQueue.store( 1 );
+    }
+    catch ( ... )
+    {
+      QMutexLocker locker( &failureMutex );
+      if ( !failure )
+        failure = std::current_exception();
+    }
+  } );
+
+  // give the candidates their ids back and merge the sub solutions
+  if ( !failure )
+  {
+    init_sol_empty();
+    sol->cost = 0;
+    nbActive = 0;
+  }
+  for ( int group = 0; group < groups.size(); group++ )
+  {
+    const QVector< int > &features = groups.at( group );
+    Problem *sub = subProblems[group].get();
+    for ( int i = 0; i < features.size(); i++ )
+    {
+      int feature = features.at( i );
+      for ( int j = 0; j < featNbLp[feature]; j++ )
+        mLabelPositions.at( featStartId[feature] + j )->setProblemIds( feature, featStartId[feature] + j );
+
+      if ( !failure && sub && sub->sol && sub->sol->s[i] != -1 )
+        sol->s[feature] = featStartId[feature] + sub->sol->s[i] - sub->featStartId[i];
+    }
+    if ( !failure )
+    {
+      sol->cost += sub->sol ? sub->sol->cost : features.size();
+      nbActive += sub->nbActive;
+    }
+
+    // the candidates belong to this problem
+    if ( sub )
+      sub->mLabelPositions.clear();
+  }
+
+  if ( failure )
+    std::rethrow_exception( failure );
+
+  if ( emptyQueue.load() )
+    throw InternalException::Empty();
+}
+
 void Problem::init_sol_empty()
 {
   int i;
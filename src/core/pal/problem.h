@@ -35,7 +35,9 @@
 
 #include "qgis_core.h"
 #include <list>
+#include <memory>
 #include <QList>
+#include <QVector>
 #include "rtree.hpp"
 
 namespace pal
@@ -140,6 +142,18 @@ namespace pal
 
       void reduce();
 
+      /**
+       * Solves the problem with the search method of the Pal instance.
+       *
+       * If the Pal instance allows it, features whose candidates cannot conflict with each
+       * other, directly or through other features, are split into independent sub problems
+       * which are solved concurrently. The solution then does not depend on the number of
+       * threads used, but it differs from the solution of the whole problem: the search
+       * heuristics do not visit the features in the same order.
+       * \since QGIS 3.2
+       */
+      void solve();
+
       /**
        * \brief popmusic framework
        */
@@ -253,6 +267,21 @@ namespace pal
 
       void solution_cost();
       void check_solution();
+
+      //! Solves the whole problem with the search method of the Pal instance
+      void solveWhole();
+
+      /**
+       * Returns the groups of features whose active candidates conflict with each other,
+       * directly or through other features. Groups are ordered by their first feature.
+       */
+      QVector< QVector< int > > conflictComponents();
+
+      /**
+       * Creates a problem made of the active candidates of \a features. The candidates
+       * are renumbered for the new problem, and remain owned by this problem.
+       */
+      std::unique_ptr< Problem > subProblem( const QVector< int > &features );
   };
 
 } // namespace
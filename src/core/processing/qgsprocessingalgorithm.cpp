@@ -26,6 +26,10 @@
 #include "qgsexception.h"
 #include "qgsmessagelog.h"
 #include "qgsprocessingfeedback.h"
+#include "qgsfeatureiterator.h"
+
+#include <QThreadPool>
+#include <QtConcurrentMap>
 
 QgsProcessingAlgorithm::~QgsProcessingAlgorithm()
 {
@@ -661,6 +665,88 @@ bool QgsProcessingAlgorithm::createAutoOutputForParameter( QgsProcessingParamete
 // QgsProcessingFeatureBasedAlgorithm
 //
 
+///@cond PRIVATE
+
+//! Number of features handed to each worker at once when processing features in parallel
+static const int PARALLEL_BATCH_SIZE = 250;
+
+/**
+ * Processing feedback storing the messages pushed from a worker thread, so that
+ * they can later be forwarded to the algorithm feedback from the calling thread.
+ */
+class QgsBufferedProcessingFeedback : public QgsProcessingFeedback
+{
+  public:
+
+    void reportError( const QString &error, bool fatalError = false ) override
+    {
+      mMessages << Message( fatalError ? FatalError : Error, error );
+    }
+
+    void pushInfo( const QString &info ) override { mMessages << Message( Info, info ); }
+    void pushCommandInfo( const QString &info ) override { mMessages << Message( CommandInfo, info ); }
+    void pushDebugInfo( const QString &info ) override { mMessages << Message( DebugInfo, info ); }
+    void pushConsoleInfo( const QString &info ) override { mMessages << Message( ConsoleInfo, info ); }
+
+    //! Forwards the stored messages to \a feedback and clears them
+    void pushMessages( QgsProcessingFeedback *feedback )
+    {
+      for ( const Message &message : qgis::as_const( mMessages ) )
+      {
+        switch ( message.first )
+        {
+          case Error:
+            feedback->reportError( message.second );
+            break;
+          case FatalError:
+            feedback->reportError( message.second, true );
+            break;
+          case Info:
+            feedback->pushInfo( message.second );
+            break;
+          case CommandInfo:
+            feedback->pushCommandInfo( message.second );
+            break;
+          case DebugInfo:
+            feedback->pushDebugInfo( message.second );
+            break;
+          case ConsoleInfo:
+            feedback->pushConsoleInfo( message.second );
+            break;
+        }
+      }
+      mMessages.clear();
+    }
+
+  private:
+
+    enum MessageType
+    {
+      Error,
+      FatalError,
+      Info,
+      CommandInfo,
+      DebugInfo,
+      ConsoleInfo,
+    };
+    typedef QPair< MessageType, QString > Message;
+
+    QList< Message > mMessages;
+};
+
+//! State of a worker thread used when processing features in parallel
+struct ParallelFeatureWorker
+{
+  std::unique_ptr< QgsProcessingFeatureBasedAlgorithm > algorithm;
+  std::unique_ptr< QgsProcessingContext > context;
+  std::unique_ptr< QgsBufferedProcessingFeedback > feedback;
+  QgsFeatureList input;
+  QgsFeatureList output;
+  QString error;
+};
+
+///@endcond
+
 void QgsProcessingFeatureBasedAlgorithm::initAlgorithm( const QVariantMap &config )
 {
   addParameter( new QgsProcessingParameterFeatureSource( QStringLiteral( "INPUT" ), QObject::tr( "Input layer" ), inputLayerTypes() ) );
@@ -704,10 +790,7 @@ void QgsProcessingFeatureBasedAlgorithm::initParameters( const QVariantMap & )
 
 QgsCoordinateReferenceSystem QgsProcessingFeatureBasedAlgorithm::sourceCrs() const
 {
-  if ( mSource )
-    return mSource->sourceCrs();
-  else
-    return QgsCoordinateReferenceSystem();
+  return mSourceCrs;
 }
 
 QVariantMap QgsProcessingFeatureBasedAlgorithm::processAlgorithm( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
@@ -731,30 +814,51 @@ QVariantMap QgsProcessingFeatureBasedAlgorithm::processAlgorithm( const QVariant
   algContext.appendScopes( createExpressionContext( parameters, context, dynamic_cast< QgsProcessingFeatureSource * >( mSource.get() ) ).takeScopes() );
   context.setExpressionContext( algContext );
 
+  mSourceCrs = mSource->sourceCrs();
   long count = mSource->featureCount();
 
-  QgsFeature f;
   QgsFeatureIterator it = mSource->getFeatures( QgsFeatureRequest(), sourceFlags() );
 
-  double step = count > 0 ? 100.0 / count : 1;
-  int current = 0;
-  while ( it.nextFeature( f ) )
+  const int threadCount = QThreadPool::globalInstance()->maxThreadCount();
+  if ( ( flags() & FlagSupportsParallelFeatureProcessing ) && threadCount > 1
+       && ( count < 0 || count > PARALLEL_BATCH_SIZE ) )
   {
-    if ( feedback->isCanceled() )
+    try
+    {
+      processFeaturesInParallel( it, sink.get(), count, threadCount, parameters, context, feedback );
+    }
+    catch ( QgsProcessingException & )
     {
-      break;
+      mSource.reset();
+      mSourceCrs = QgsCoordinateReferenceSystem();
+      context.setExpressionContext( prevContext );
+      throw;
     }
+  }
+  else
+  {
+    QgsFeature f;
+    double step = count > 0 ? 100.0 / count : 1;
+    int current = 0;
+    while ( it.nextFeature( f ) )
+    {
+      if ( feedback->isCanceled() )
+      {
+        break;
+      }
 
-    context.expressionContext().setFeature( f );
-    const QgsFeatureList transformed = processFeature( f, context, feedback );
-    for ( QgsFeature transformedFeature : transformed )
-      sink->addFeature( transformedFeature, QgsFeatureSink::FastInsert );
+      context.expressionContext().setFeature( f );
+      const QgsFeatureList transformed = processFeature( f, context, feedback );
+      for ( QgsFeature transformedFeature : transformed )
+        sink->addFeature( transformedFeature, QgsFeatureSink::FastInsert );
 
-    feedback->setProgress( current * step );
-    current++;
+      feedback->setProgress( current * step );
+      current++;
+    }
   }
 
   mSource.reset();
+  mSourceCrs = QgsCoordinateReferenceSystem();
 
   // probably not necessary - context's aren't usually recycled, but can't hurt
   context.setExpressionContext( prevContext );
@@ -764,6 +868,83 @@ QVariantMap QgsProcessingFeatureBasedAlgorithm::processAlgorithm( const QVariant
   return outputs;
 }
 
+void QgsProcessingFeatureBasedAlgorithm::processFeaturesInParallel( QgsFeatureIterator &iterator, QgsFeatureSink *sink, long count, int threadCount,
+    const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
+{
+  // each worker gets its own prepared copy of the algorithm, so that state kept by
+  // processFeature() implementations (data defined properties, lazily created
+  // transforms, ...) is never shared between threads
+  std::vector< ParallelFeatureWorker > workers( static_cast< size_t >( threadCount ) );
+  for ( ParallelFeatureWorker &worker : workers )
+  {
+    worker.context = qgis::make_unique< QgsProcessingContext >();
+    worker.context->copyThreadSafeSettings( context );
+    worker.feedback = qgis::make_unique< QgsBufferedProcessingFeedback >();
+
+    worker.algorithm.reset( static_cast< QgsProcessingFeatureBasedAlgorithm * >( create() ) );
+    worker.algorithm->mSourceCrs = mSourceCrs;
+    if ( !worker.algorithm->prepare( parameters, *worker.context, feedback ) )
+      throw QgsProcessingException( QObject::tr( "Could not prepare algorithm for parallel feature processing" ) );
+  }
+
+  auto processBatch = [feedback]( ParallelFeatureWorker & worker )
+  {
+    for ( const QgsFeature &feature : qgis::as_const( worker.input ) )
+    {
+      if ( feedback->isCanceled() )
+        break;
+
+      worker.context->expressionContext().setFeature( feature );
+      try
+      {
+        worker.output.append( worker.algorithm->processFeature( feature, *worker.context, worker.feedback.get() ) );
+      }
+      catch ( QgsProcessingException &e )
+      {
+        worker.error = e.what();
+        break;
+      }
+    }
+  };
+
+  double step = count > 0 ? 100.0 / count : 1;
+  long current = 0;
+  bool finished = false;
+  QgsFeature f;
+  while ( !finished && !feedback->isCanceled() )
+  {
+    // fill one batch per worker, in iteration order
+    for ( ParallelFeatureWorker &worker : workers )
+    {
+      worker.input.clear();
+      worker.output.clear();
+      while ( !finished && worker.input.size() < PARALLEL_BATCH_SIZE )
+      {
+        if ( iterator.nextFeature( f ) )
+          worker.input << f;
+        else
+          finished = true;
+      }
+    }
+
+    QtConcurrent::blockingMap( workers, processBatch );
+
+    // collect results in worker order, which keeps the output in the input order
+    for ( ParallelFeatureWorker &worker : workers )
+    {
+      worker.feedback->pushMessages( feedback );
+      for ( QgsFeature &feature : worker.output )
+        sink->addFeature( feature, QgsFeatureSink::FastInsert );
+
+      if ( !worker.error.isEmpty() )
+        throw QgsProcessingException( worker.error );
+
+      current += worker.input.size();
+    }
+    feedback->setProgress( current * step );
+  }
+}
+
 QgsFeatureRequest QgsProcessingFeatureBasedAlgorithm::request() const
 {
   return QgsFeatureRequest();
@@ -73,6 +73,7 @@ class CORE_EXPORT QgsProcessingAlgorithm
       FlagCanCancel = 1 << 4, //!< Algorithm can be canceled
       FlagRequiresMatchingCrs = 1 << 5, //!< Algorithm requires that all input layers have matching coordinate reference systems
       FlagNoThreading = 1 << 6, //!< Algorithm is not thread safe and cannot be run in a background thread, e.g. for algorithms which manipulate the current project, layer selections, or with external dependencies which are not thread-safe.
+      FlagSupportsParallelFeatureProcessing = 1 << 7, //!< Feature based algorithm whose processFeature() method can safely run on several copies of the algorithm at once, allowing features to be processed in parallel (since QGIS 3.2)
       FlagDeprecated = FlagHideFromToolbox | FlagHideFromModeler, //!< Algorithm is deprecated
     };
     Q_DECLARE_FLAGS( Flags, Flag )
@@ -896,6 +897,14 @@ class CORE_EXPORT QgsProcessingFeatureBasedAlgorithm : public QgsProcessingAlgor
      * prevent the algorithm execution from continuing. This can be annoying for users though as it
      * can break valid model execution - so use with extreme caution, and consider using
      * \a feedback to instead report non-fatal processing failures for features instead.
+     *
+     * If the algorithm's flags() include QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing,
+     * features are processed in batches by a pool of worker threads. Each worker uses its own
+     * prepared copy of the algorithm (created with create() and prepared with the same parameters),
+     * along with its own copy of the processing context and expression context, so this method
+     * must not rely on state shared between algorithm instances. Messages pushed to \a feedback
+     * are reported once the batch is complete, and output features are added to the sink in
+     * the same order as for a sequential execution.
      */
     virtual QgsFeatureList processFeature( const QgsFeature &feature, QgsProcessingContext &context, QgsProcessingFeedback *feedback ) = 0 SIP_VIRTUALERRORHANDLER( processing_exception_handler );
 
@@ -910,7 +919,14 @@ class CORE_EXPORT QgsProcessingFeatureBasedAlgorithm : public QgsProcessingAlgor
 
   private:
 
+    /**
+     * Processes the features from \a iterator in parallel, adding the results to \a sink.
+     */
+    void processFeaturesInParallel( QgsFeatureIterator &iterator, QgsFeatureSink *sink, long count, int threadCount,
+                                    const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback );
+
     std::unique_ptr< QgsProcessingFeatureSource > mSource;
+    QgsCoordinateReferenceSystem mSourceCrs;
 
 };
 
@@ -415,6 +415,7 @@ QgsFeatureSink *QgsProcessingUtils::createFeatureSink( QString &destination, Qgs
       {
         throw QgsProcessingException( QObject::tr( "Could not create layer %1: %2" ).arg( destination, writer->errorMessage() ) );
       }
+      writer->setFeatureBufferSize( 1000 );
       destination = finalFileName;
       return new QgsProcessingFeatureSink( writer.release(), destination, context, true );
     }
@@ -766,7 +767,12 @@ QgsProcessingFeatureSink::QgsProcessingFeatureSink( QgsFeatureSink *originalSink
 QgsProcessingFeatureSink::~QgsProcessingFeatureSink()
 {
   if ( mOwnsSink )
+  {
+    // errors of buffered features would be lost when the sink is deleted
+    if ( !destinationSink()->flushBuffer() && mContext.feedback() )
+      mContext.feedback()->reportError( QObject::tr( "Some features could not be written to %1" ).arg( mSinkName ) );
     delete destinationSink();
+  }
 }
 
 bool QgsProcessingFeatureSink::addFeature( QgsFeature &feature, QgsFeatureSink::Flags flags )
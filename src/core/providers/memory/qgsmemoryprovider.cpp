@@ -589,7 +589,7 @@ QgsVectorDataProvider::Capabilities QgsMemoryProvider::capabilities() const
 {
   return AddFeatures | DeleteFeatures | ChangeGeometries |
          ChangeAttributeValues | AddAttributes | DeleteAttributes | RenameAttributes | CreateSpatialIndex |
-         SelectAtId | CircularGeometries;
+         SelectAtId | CircularGeometries | ThreadAgnosticFeatureIterators;
 }
 
 
@@ -22,7 +22,34 @@
 #include "qgsgeometry.h"
 #include "qgsvectorlayer.h"
 
+// number of features for which aggregated expressions are evaluated at once
+static const int EVALUATION_BLOCK_SIZE = 1024;
+
+/**
+ * Evaluates \a expression for all the features of \a fit by blocks, calling \a addValue with each result.
+ */
+template <typename AddValue>
+static void evaluateFeatures( QgsFeatureIterator &fit, QgsExpression *expression, QgsExpressionContext *context, AddValue addValue )
+{
+  Q_ASSERT( context );
 
+  QgsFeatureList features;
+  features.reserve( EVALUATION_BLOCK_SIZE );
+  QgsFeature f;
+  bool hasFeature = fit.nextFeature( f );
+  while ( hasFeature )
+  {
+    features << f;
+    hasFeature = fit.nextFeature( f );
+    if ( features.size() == EVALUATION_BLOCK_SIZE || !hasFeature )
+    {
+      const QVariantList values = expression->evaluateFeatures( features, context );
+      for ( const QVariant &v : values )
+        addValue( v );
+      features.clear();
+    }
+  }
+}
 
 QgsAggregateCalculator::QgsAggregateCalculator( const QgsVectorLayer *layer )
   : mLayer( layer )
@@ -646,16 +673,13 @@ QVariant QgsAggregateCalculator::calculateNumericAggregate( QgsFeatureIterator &
   QgsStatisticalSummary s( stat );
   QgsFeature f;
 
-  while ( fit.nextFeature( f ) )
+  if ( expression )
   {
-    if ( expression )
-    {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      s.addVariant( v );
-    }
-    else
+    evaluateFeatures( fit, expression, context, [&s]( const QVariant & v ) { s.addVariant( v ); } );
+  }
+  else
+  {
+    while ( fit.nextFeature( f ) )
     {
       s.addVariant( f.attribute( attr ) );
     }
@@ -673,16 +697,13 @@ QVariant QgsAggregateCalculator::calculateStringAggregate( QgsFeatureIterator &f
   QgsStringStatisticalSummary s( stat );
   QgsFeature f;
 
-  while ( fit.nextFeature( f ) )
+  if ( expression )
   {
-    if ( expression )
-    {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      s.addValue( v );
-    }
-    else
+    evaluateFeatures( fit, expression, context, [&s]( const QVariant & v ) { s.addValue( v ); } );
+  }
+  else
+  {
+    while ( fit.nextFeature( f ) )
     {
       s.addValue( f.attribute( attr ) );
     }
@@ -785,16 +806,13 @@ QVariant QgsAggregateCalculator::calculateDateTimeAggregate( QgsFeatureIterator
   QgsDateTimeStatisticalSummary s( stat );
   QgsFeature f;
 
-  while ( fit.nextFeature( f ) )
+  if ( expression )
   {
-    if ( expression )
-    {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      s.addValue( v );
-    }
-    else
+    evaluateFeatures( fit, expression, context, [&s]( const QVariant & v ) { s.addValue( v ); } );
+  }
+  else
+  {
+    while ( fit.nextFeature( f ) )
     {
       s.addValue( f.attribute( attr ) );
     }
@@ -812,16 +830,13 @@ QVariant QgsAggregateCalculator::calculateArrayAggregate( QgsFeatureIterator &fi
 
   QVariantList array;
 
-  while ( fit.nextFeature( f ) )
+  if ( expression )
   {
-    if ( expression )
-    {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      array.append( v );
-    }
-    else
+    evaluateFeatures( fit, expression, context, [&array]( const QVariant & v ) { array.append( v ); } );
+  }
+  else
+  {
+    while ( fit.nextFeature( f ) )
     {
       array.append( f.attribute( attr ) );
     }
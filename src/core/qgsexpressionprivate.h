@@ -24,6 +24,7 @@
 #include "qgsdistancearea.h"
 #include "qgsunittypes.h"
 #include "qgsexpressionnode.h"
+#include "qgsexpressionprogram_p.h"
 
 ///@cond
 
@@ -67,6 +68,9 @@ class QgsExpressionPrivate
     std::shared_ptr<QgsDistanceArea> mCalc;
     QgsUnitTypes::DistanceUnit mDistanceUnit = QgsUnitTypes::DistanceUnknownUnit;
     QgsUnitTypes::AreaUnit mAreaUnit = QgsUnitTypes::AreaUnknownUnit;
+
+    //! Bytecode of the prepared expression, not copied as it references the nodes of the tree
+    std::unique_ptr< QgsExpressionProgram > mProgram;
 };
 ///@endcond
 
@@ -72,7 +72,8 @@ class CORE_EXPORT QgsFeatureRequest
       NoFlags            = 0,
       NoGeometry         = 1,  //!< Geometry is not required. It may still be returned if e.g. required for a filter condition.
       SubsetOfAttributes = 2,  //!< Fetch only a subset of attributes (setSubsetOfAttributes sets this flag)
-      ExactIntersect     = 4   //!< Use exact geometry intersection (slower) instead of bounding boxes
+      ExactIntersect     = 4,  //!< Use exact geometry intersection (slower) instead of bounding boxes
+      PrefetchFeatures   = 8   //!< Fetch the features of vector layers on a background thread while the previous ones are processed, if their provider has the QgsVectorDataProvider::ThreadAgnosticFeatureIterators capability (since QGIS 3.2)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
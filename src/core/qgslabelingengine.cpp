@@ -77,6 +77,8 @@ QgsLabelingEngine::QgsLabelingEngine()
 
 QgsLabelingEngine::~QgsLabelingEngine()
 {
+  // the pal layers refer to the providers
+  mPal.reset();
   qDeleteAll( mProviders );
   qDeleteAll( mSubProviders );
 }
@@ -112,7 +114,7 @@ void QgsLabelingEngine::removeProvider( QgsAbstractLabelProvider *provider )
   }
 }
 
-void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context, pal::Pal &p )
+void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context, pal::Pal &p, QList< pal::Layer * > *layers )
 {
   QgsAbstractLabelProvider::Flags flags = provider->flags();
 
@@ -128,6 +130,9 @@ void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, Qgs
   // extra flags for placement of labels for linestrings
   l->setArrangementFlags( static_cast< pal::LineArrangementFlags >( provider->linePlacementFlags() ) );
 
+  if ( layers )
+    *layers << l;
+
   // set label mode (label per feature is the default)
   l->setLabelMode( flags.testFlag( QgsAbstractLabelProvider::LabelPerFeaturePart ) ? pal::Layer::LabelPerFeaturePart : pal::Layer::LabelPerFeature );
 
@@ -179,17 +184,18 @@ void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, Qgs
   // any sub-providers?
   Q_FOREACH ( QgsAbstractLabelProvider *subProvider, provider->subProviders() )
   {
+    mMutex.lock();
     mSubProviders << subProvider;
-    processProvider( subProvider, context, p );
+    mMutex.unlock();
+    processProvider( subProvider, context, p, layers );
   }
 }
 
-
-void QgsLabelingEngine::run( QgsRenderContext &context )
+std::unique_ptr< pal::Pal > QgsLabelingEngine::createPal() const
 {
   const QgsLabelingEngineSettings &settings = mMapSettings.labelingEngineSettings();
 
-  pal::Pal p;
+  std::unique_ptr< pal::Pal > p = qgis::make_unique< pal::Pal >();
   pal::SearchMethod s;
   switch ( settings.searchMethod() )
   {
@@ -210,28 +216,85 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
       s = pal::FALP;
       break;
   }
-  p.setSearch( s );
+  p->setSearch( s );
 
   // set number of candidates generated per feature
   int candPoint, candLine, candPolygon;
   settings.numCandidatePositions( candPoint, candLine, candPolygon );
-  p.setPointP( candPoint );
-  p.setLineP( candLine );
-  p.setPolyP( candPolygon );
+  p->setPointP( candPoint );
+  p->setLineP( candLine );
+  p->setPolyP( candPolygon );
 
-  p.setShowPartial( settings.testFlag( QgsLabelingEngineSettings::UsePartialCandidates ) );
+  p->setShowPartial( settings.testFlag( QgsLabelingEngineSettings::UsePartialCandidates ) );
+  p->setSolveConcurrently( settings.testFlag( QgsLabelingEngineSettings::SolveConcurrently ) );
+  return p;
+}
+
+void QgsLabelingEngine::problemExtent( QgsRectangle &extent, QgsGeometry &mapBoundary ) const
+{
+  QgsGeometry extentGeom = QgsGeometry::fromRect( mMapSettings.visibleExtent() );
+  QPolygonF visiblePoly = mMapSettings.visiblePolygon();
+  visiblePoly.append( visiblePoly.at( 0 ) ); //close polygon
+  mapBoundary = QgsGeometry::fromQPolygonF( visiblePoly );
 
+  if ( !qgsDoubleNear( mMapSettings.rotation(), 0.0 ) )
+  {
+    //PAL features are prerotated, so extent also needs to be unrotated
+    extentGeom.rotate( -mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
+    // yes - this is rotated in the opposite direction... phew, this is confusing!
+    mapBoundary.rotate( mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
+  }
+
+  extent = extentGeom.boundingBox();
+}
+
+void QgsLabelingEngine::prepareProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context )
+{
+  pal::Pal *p = nullptr;
+  {
+    QMutexLocker locker( &mMutex );
+    if ( !mProviders.contains( provider ) || mPreparedProviders.contains( provider ) )
+      return;
+
+    if ( !mPal )
+      mPal = createPal();
+    p = mPal.get();
+    mPreparedProviders << provider;
+  }
+
+  // the labels of each layer only depend on its own features, so their candidates can
+  // be generated as soon as the layer is rendered
+  QList< pal::Layer * > layers;
+  processProvider( provider, context, *p, &layers );
+
+  QgsRectangle extent;
+  QgsGeometry mapBoundary;
+  problemExtent( extent, mapBoundary );
+  for ( pal::Layer *layer : qgis::as_const( layers ) )
+    p->startExtraction( layer, extent, mapBoundary );
+}
+
+
+void QgsLabelingEngine::run( QgsRenderContext &context )
+{
+  const QgsLabelingEngineSettings &settings = mMapSettings.labelingEngineSettings();
+
+  // layers are not rendered anymore, the pal object of the prepared providers can be taken over
+  std::unique_ptr< pal::Pal > p = mPal ? std::move( mPal ) : createPal();
 
   // for each provider: get labels and register them in PAL
   Q_FOREACH ( QgsAbstractLabelProvider *provider, mProviders )
   {
+    if ( mPreparedProviders.contains( provider ) )
+      continue;
+
     bool appendedLayerScope = false;
     if ( QgsMapLayer *ml = provider->layer() )
     {
       appendedLayerScope = true;
       context.expressionContext().appendScope( QgsExpressionContextUtils::layerScope( ml ) );
     }
-    processProvider( provider, context, p );
+    processProvider( provider, context, *p );
     if ( appendedLayerScope )
       delete context.expressionContext().popScope();
   }
@@ -241,23 +304,12 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
 
   QPainter *painter = context.painter();
 
-  QgsGeometry extentGeom = QgsGeometry::fromRect( mMapSettings.visibleExtent() );
-  QPolygonF visiblePoly = mMapSettings.visiblePolygon();
-  visiblePoly.append( visiblePoly.at( 0 ) ); //close polygon
-  QgsGeometry mapBoundaryGeom = QgsGeometry::fromQPolygonF( visiblePoly );
-
-  if ( !qgsDoubleNear( mMapSettings.rotation(), 0.0 ) )
-  {
-    //PAL features are prerotated, so extent also needs to be unrotated
-    extentGeom.rotate( -mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
-    // yes - this is rotated in the opposite direction... phew, this is confusing!
-    mapBoundaryGeom.rotate( mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
-  }
-
-  QgsRectangle extent = extentGeom.boundingBox();
+  QgsRectangle extent;
+  QgsGeometry mapBoundaryGeom;
+  problemExtent( extent, mapBoundaryGeom );
 
 
-  p.registerCancelationCallback( &_palIsCanceled, reinterpret_cast< void * >( &context ) );
+  p->registerCancelationCallback( &_palIsCanceled, reinterpret_cast< void * >( &context ) );
 
   QTime t;
   t.start();
@@ -266,7 +318,7 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
   std::unique_ptr< pal::Problem > problem;
   try
   {
-    problem = p.extractProblem( extent, mapBoundaryGeom );
+    problem = p->extractProblem( extent, mapBoundaryGeom );
   }
   catch ( std::exception &e )
   {
@@ -310,7 +362,7 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
   }
 
   // find the solution
-  QList<pal::LabelPosition *> labels = p.solveProblem( problem.get(), settings.testFlag( QgsLabelingEngineSettings::UseAllLabels ) );
+  QList<pal::LabelPosition *> labels = p->solveProblem( problem.get(), settings.testFlag( QgsLabelingEngineSettings::UseAllLabels ) );
 
   QgsDebugMsgLevel( QString( "LABELING work:  %1 ms ... labels# %2" ).arg( t.elapsed() ).arg( labels.size() ), 4 );
   t.restart();
@@ -24,6 +24,9 @@
 #include "qgspallabeling.h"
 #include "qgslabelingenginesettings.h"
 
+#include <QMutex>
+#include <QSet>
+
 
 class QgsLabelingEngine;
 
@@ -200,6 +203,15 @@ class CORE_EXPORT QgsLabelingEngine
     //! Remove provider if the provider's initialization failed. Provider instance is deleted.
     void removeProvider( QgsAbstractLabelProvider *provider );
 
+    /**
+     * Registers the labels of a \a provider and starts generating their candidates in the background,
+     * so that this overlaps with the rendering of the other layers. This must be called once the
+     * provider has registered all its features, and may be called from the thread rendering its layer.
+     * run() then only waits for the candidates of the providers which were prepared this way.
+     * \since QGIS 3.2
+     */
+    void prepareProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context );
+
     //! compute the labeling with given map settings and providers
     void run( QgsRenderContext &context );
 
@@ -210,7 +222,12 @@ class CORE_EXPORT QgsLabelingEngine
     QgsLabelingResults *results() const { return mResults.get(); }
 
   protected:
-    void processProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context, pal::Pal &p );
+
+    /**
+     * Registers the labels of a \a provider and its sub providers in \a p. The created pal
+     * layers are appended to \a layers if it is not nullptr.
+     */
+    void processProvider( QgsAbstractLabelProvider *provider, QgsRenderContext &context, pal::Pal &p, QList< pal::Layer * > *layers = nullptr );
 
   protected:
     //! Associated map settings instance
@@ -223,6 +240,23 @@ class CORE_EXPORT QgsLabelingEngine
     //! Resulting labeling layout
     std::unique_ptr< QgsLabelingResults > mResults;
 
+  private:
+
+    //! Creates the pal object with the labeling engine settings
+    std::unique_ptr< pal::Pal > createPal() const;
+
+    //! Returns the \a extent in which labels are placed and the actual \a mapBoundary of the map
+    void problemExtent( QgsRectangle &extent, QgsGeometry &mapBoundary ) const;
+
+    //! Pal object in which the providers passed to prepareProvider() are registered until run() takes it
+    std::unique_ptr< pal::Pal > mPal;
+
+    //! Providers registered by prepareProvider()
+    QSet< QgsAbstractLabelProvider * > mPreparedProviders;
+
+    //! Protects the pal object and the lists of providers, as layers may be rendered concurrently
+    QMutex mMutex;
+
 };
 
 
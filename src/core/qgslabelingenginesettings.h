@@ -37,6 +37,7 @@ class CORE_EXPORT QgsLabelingEngineSettings
       RenderOutlineLabels   = 1 << 3,  //!< Whether to render labels as text or outlines
       DrawLabelRectOnly     = 1 << 4,  //!< Whether to only draw the label rect and not the actual label text (used for unit tests)
       DrawCandidates        = 1 << 5,  //!< Whether to draw rectangles of generated candidates (good for debugging)
+      SolveConcurrently     = 1 << 6,  //!< Whether independent groups of conflicting labels are solved concurrently. This is faster on multi-core machines. The placement is the same from one run to the next, but differs from the placement found when the whole problem is solved sequentially (since QGIS 3.2)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
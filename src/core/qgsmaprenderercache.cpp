@@ -17,16 +17,25 @@
 
 #include "qgsmaplayer.h"
 #include "qgsmaplayerlistutils.h"
+#include "qgsmaprenderertilestore_p.h"
 
 QgsMapRendererCache::QgsMapRendererCache()
+  : mTiles( new QgsMapRendererTileStore() )
 {
   clear();
 }
 
+QgsMapRendererCache::~QgsMapRendererCache() = default;
+
 void QgsMapRendererCache::clear()
 {
-  QMutexLocker lock( &mMutex );
-  clearInternal();
+  {
+    QMutexLocker lock( &mMutex );
+    mTileDependentLayers.clear();
+    invalidateTiles();
+    clearInternal();
+  }
+  mTiles->clear();
 }
 
 void QgsMapRendererCache::clearInternal()
@@ -34,17 +43,9 @@ void QgsMapRendererCache::clearInternal()
   mExtent.setMinimal();
   mScale = 0;
 
-  // make sure we are disconnected from all layers
-  Q_FOREACH ( const QgsWeakMapLayerPointer &layer, mConnectedLayers )
-  {
-    if ( layer.data() )
-    {
-      disconnect( layer.data(), &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedRepaint );
-      disconnect( layer.data(), &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerRequestedRepaint );
-    }
-  }
+  // tiles are not bound to the extent, so they are kept together with the connections to the layers they depend on
   mCachedImages.clear();
-  mConnectedLayers.clear();
+  dropUnusedConnections();
 }
 
 void QgsMapRendererCache::dropUnusedConnections()
@@ -75,6 +76,35 @@ QSet<QgsWeakMapLayerPointer > QgsMapRendererCache::dependentLayers() const
         result << l;
     }
   }
+  for ( auto tileIt = mTileDependentLayers.constBegin(); tileIt != mTileDependentLayers.constEnd(); ++tileIt )
+  {
+    for ( const QgsWeakMapLayerPointer &l : tileIt.value() )
+    {
+      if ( l.data() )
+        result << l;
+    }
+  }
+  return result;
+}
+
+QgsWeakMapLayerPointerList QgsMapRendererCache::connectToLayers( const QList<QgsMapLayer *> &layers )
+{
+  QgsWeakMapLayerPointerList result;
+
+  // connect to the layer to listen to layer's repaintRequested() signals
+  Q_FOREACH ( QgsMapLayer *layer, layers )
+  {
+    if ( layer )
+    {
+      result << layer;
+      if ( !mConnectedLayers.contains( QgsWeakMapLayerPointer( layer ) ) )
+      {
+        connect( layer, &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedRepaint );
+        connect( layer, &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerRequestedRepaint );
+        mConnectedLayers << layer;
+      }
+    }
+  }
   return result;
 }
 
@@ -102,21 +132,7 @@ void QgsMapRendererCache::setCacheImage( const QString &cacheKey, const QImage &
 
   CacheParameters params;
   params.cachedImage = image;
-
-  // connect to the layer to listen to layer's repaintRequested() signals
-  Q_FOREACH ( QgsMapLayer *layer, dependentLayers )
-  {
-    if ( layer )
-    {
-      params.dependentLayers << layer;
-      if ( !mConnectedLayers.contains( QgsWeakMapLayerPointer( layer ) ) )
-      {
-        connect( layer, &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedRepaint );
-        connect( layer, &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerRequestedRepaint );
-        mConnectedLayers << layer;
-      }
-    }
-  }
+  params.dependentLayers = connectToLayers( dependentLayers );
 
   mCachedImages[cacheKey] = params;
 }
@@ -161,7 +177,27 @@ void QgsMapRendererCache::layerRequestedRepaint()
 
     it = mCachedImages.erase( it );
   }
+
+  // and all tiles
+  QStringList tileKeys;
+  for ( auto tileIt = mTileDependentLayers.begin(); tileIt != mTileDependentLayers.end(); )
+  {
+    if ( !tileIt.value().contains( layer ) )
+    {
+      ++tileIt;
+      continue;
+    }
+
+    tileKeys << tileIt.key();
+    invalidateTiles( tileIt.key() );
+    tileIt = mTileDependentLayers.erase( tileIt );
+  }
   dropUnusedConnections();
+  lock.unlock();
+
+  // the tile store has its own locks, spilled tiles are removed without holding the cache lock
+  for ( const QString &key : qgis::as_const( tileKeys ) )
+    mTiles->removeTiles( key );
 }
 
 void QgsMapRendererCache::clearCacheImage( const QString &cacheKey )
@@ -171,3 +207,121 @@ void QgsMapRendererCache::clearCacheImage( const QString &cacheKey )
   mCachedImages.remove( cacheKey );
   dropUnusedConnections();
 }
+
+void QgsMapRendererCache::setTiledCachingEnabled( bool enabled )
+{
+  QMutexLocker lock( &mMutex );
+  if ( enabled == mTiledCachingEnabled )
+    return;
+
+  mTiledCachingEnabled = enabled;
+  if ( !enabled )
+  {
+    mTileDependentLayers.clear();
+    invalidateTiles();
+    dropUnusedConnections();
+    lock.unlock();
+    mTiles->clear();
+  }
+}
+
+bool QgsMapRendererCache::tiledCachingEnabled() const
+{
+  QMutexLocker lock( &mMutex );
+  return mTiledCachingEnabled;
+}
+
+void QgsMapRendererCache::setTileSize( int size )
+{
+  mTiles->setTileSize( size );
+}
+
+int QgsMapRendererCache::tileSize() const
+{
+  return mTiles->tileSize();
+}
+
+void QgsMapRendererCache::setMemoryBudget( qint64 bytes )
+{
+  mTiles->setMemoryBudget( bytes );
+}
+
+qint64 QgsMapRendererCache::memoryBudget() const
+{
+  return mTiles->memoryBudget();
+}
+
+qint64 QgsMapRendererCache::tileMemoryUsage() const
+{
+  return mTiles->memoryUsage();
+}
+
+bool QgsMapRendererCache::setSpillDirectory( const QString &path )
+{
+  return mTiles->setSpillDirectory( path );
+}
+
+QString QgsMapRendererCache::spillDirectory() const
+{
+  return mTiles->spillDirectory();
+}
+
+void QgsMapRendererCache::setCacheTiles( const QString &cacheKey, const QgsMapSettings &settings, const QImage &image, const QList<QgsMapLayer *> &dependentLayers, int margin )
+{
+  quint64 generation = 0;
+  {
+    QMutexLocker lock( &mMutex );
+    if ( !mTiledCachingEnabled )
+      return;
+
+    mTileDependentLayers[cacheKey] = connectToLayers( dependentLayers );
+    generation = mTileGeneration;
+    mTileStores++;
+  }
+
+  // tiles are stored (and older ones possibly spilled to disk) without holding the cache lock
+  mTiles->storeImage( cacheKey, settings, image, margin );
+
+  QMutexLocker lock( &mMutex );
+  // the tiles may have been invalidated meanwhile, after they were rendered but before they were stored
+  const bool invalidated = mAllTilesInvalidation > generation || mTileInvalidations.value( cacheKey ) > generation;
+  if ( --mTileStores == 0 )
+    mTileInvalidations.clear();
+  lock.unlock();
+
+  if ( invalidated )
+    mTiles->removeTiles( cacheKey );
+}
+
+QImage QgsMapRendererCache::cacheTilesImage( const QString &cacheKey, const QgsMapSettings &settings ) const
+{
+  if ( !tiledCachingEnabled() )
+    return QImage();
+
+  return mTiles->image( cacheKey, settings );
+}
+
+bool QgsMapRendererCache::hasCacheTiles( const QString &cacheKey ) const
+{
+  return tiledCachingEnabled() && mTiles->hasTiles( cacheKey );
+}
+
+void QgsMapRendererCache::clearCacheTiles( const QString &cacheKey )
+{
+  {
+    QMutexLocker lock( &mMutex );
+    mTileDependentLayers.remove( cacheKey );
+    invalidateTiles( cacheKey );
+    dropUnusedConnections();
+  }
+  mTiles->removeTiles( cacheKey );
+}
+
+void QgsMapRendererCache::invalidateTiles( const QString &cacheKey )
+{
+  mTileGeneration++;
+  if ( cacheKey.isEmpty() )
+    mAllTilesInvalidation = mTileGeneration;
+  else if ( mTileStores > 0 )
+    mTileInvalidations[cacheKey] = mTileGeneration;
+}
@@ -17,6 +17,7 @@
 #define QGSMAPRENDERERCACHE_H
 
 #include "qgis_core.h"
+#include <QHash>
 #include <QMap>
 #include <QImage>
 #include <QMutex>
@@ -24,6 +25,13 @@
 #include "qgsrectangle.h"
 #include "qgsmaplayer.h"
 
+#include <memory>
+
+class QgsMapSettings;
+#ifndef SIP_RUN
+class QgsMapRendererTileStore;
+#endif
+
 
 /**
  * \ingroup core
@@ -35,6 +43,10 @@
  * If triggered, the cache removes the rendered image (and disconnects from the
  * layers).
  *
+ * Since QGIS 3.2, the cache can also keep the rendered images as tiles, see setTiledCachingEnabled().
+ * Unlike cached images, tiles are not cleared when the map extent changes, so that views panned or
+ * zoomed back to a previously rendered view can be assembled from them without rendering again.
+ *
  * The class is thread-safe (multiple classes can access the same instance safely).
  *
  * \since QGIS 2.4
@@ -45,6 +57,7 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
   public:
 
     QgsMapRendererCache();
+    ~QgsMapRendererCache() override;
 
     /**
      * Invalidates the cache contents, clearing all cached images.
@@ -97,6 +110,119 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
      */
     void clearCacheImage( const QString &cacheKey );
 
+    /**
+     * Sets whether rendered images are also cached as tiles. Disabling tiled caching
+     * clears the cached tiles. Tiled caching is disabled by default.
+     * \see tiledCachingEnabled()
+     * \see setCacheTiles()
+     * \since QGIS 3.2
+     */
+    void setTiledCachingEnabled( bool enabled );
+
+    /**
+     * Returns true if rendered images are also cached as tiles.
+     * \see setTiledCachingEnabled()
+     * \since QGIS 3.2
+     */
+    bool tiledCachingEnabled() const;
+
+    /**
+     * Sets the width and height of cached tiles, in pixels. Changing the size clears the cached tiles.
+     * \see tileSize()
+     * \since QGIS 3.2
+     */
+    void setTileSize( int size );
+
+    /**
+     * Returns the width and height of cached tiles, in pixels.
+     * \see setTileSize()
+     * \since QGIS 3.2
+     */
+    int tileSize() const;
+
+    /**
+     * Sets the maximum size in \a bytes of the tiles kept in memory. When it is
+     * exceeded, the least recently used tiles are moved to the spill directory, or
+     * discarded if there is none.
+     * \see memoryBudget()
+     * \see setSpillDirectory()
+     * \since QGIS 3.2
+     */
+    void setMemoryBudget( qint64 bytes );
+
+    /**
+     * Returns the maximum size in bytes of the tiles kept in memory.
+     * \see setMemoryBudget()
+     * \since QGIS 3.2
+     */
+    qint64 memoryBudget() const;
+
+    /**
+     * Returns the size in bytes of the tiles currently kept in memory.
+     * \since QGIS 3.2
+     */
+    qint64 tileMemoryUsage() const;
+
+    /**
+     * Sets the directory where tiles exceeding the memory budget are written. A private
+     * subdirectory, removed with the cache, is created within \a path. An empty path
+     * disables writing tiles to disk.
+     * \returns false if the directory cannot be created
+     * \see spillDirectory()
+     * \since QGIS 3.2
+     */
+    bool setSpillDirectory( const QString &path );
+
+    /**
+     * Returns the private directory where tiles exceeding the memory budget are written,
+     * or an empty string if tiles are not written to disk.
+     * \see setSpillDirectory()
+     * \since QGIS 3.2
+     */
+    QString spillDirectory() const;
+
+    /**
+     * Caches the rendered \a image of the map view defined by \a settings as tiles, for
+     * a particular \a cacheKey. The tiles of each map scale are aligned on a grid, so only
+     * unrotated views panned by whole pixels from the first view cached at the same scale
+     * can reuse them.
+     *
+     * A list of \a dependentLayers should be passed containing all layer
+     * on which the tiles are dependent. If any of these layers triggers a
+     * repaint then the tiles will be cleared.
+     *
+     * Tiles closer than \a margin pixels to the image edges are not cached, as they may lack
+     * parts of the symbols of features outside of the view. The margin should therefore be
+     * at least as large as the symbols.
+     *
+     * This has no effect if tiled caching is disabled.
+     * \see cacheTilesImage()
+     * \since QGIS 3.2
+     */
+    void setCacheTiles( const QString &cacheKey, const QgsMapSettings &settings, const QImage &image, const QList< QgsMapLayer * > &dependentLayers = QList< QgsMapLayer * >(), int margin = 32 );
+
+    /**
+     * Returns the image of the map view defined by \a settings for the specified \a cacheKey,
+     * assembled from cached tiles, or a null image if some of the tiles covering the view are not cached.
+     * \see setCacheTiles()
+     * \since QGIS 3.2
+     */
+    QImage cacheTilesImage( const QString &cacheKey, const QgsMapSettings &settings ) const;
+
+    /**
+     * Returns true if the cache contains tiles for the specified \a cacheKey.
+     * \see setCacheTiles()
+     * \since QGIS 3.2
+     */
+    bool hasCacheTiles( const QString &cacheKey ) const;
+
+    /**
+     * Removes the tiles with matching \a cacheKey from the cache.
+     * \see clear()
+     * \since QGIS 3.2
+     */
+    void clearCacheTiles( const QString &cacheKey );
+
   private slots:
     //! Remove layer (that emitted the signal) from the cache
     void layerRequestedRepaint();
@@ -117,12 +243,36 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
 
     QSet< QgsWeakMapLayerPointer > dependentLayers() const;
 
+    //! Connects to the repaint signals of \a layers (without locking), and returns them as weak pointers
+    QgsWeakMapLayerPointerList connectToLayers( const QList< QgsMapLayer * > &layers );
+
+    //! Records that the tiles of \a cacheKey are invalid, or all the tiles if \a cacheKey is empty (without locking)
+    void invalidateTiles( const QString &cacheKey = QString() );
+
     mutable QMutex mMutex;
     QgsRectangle mExtent;
     double mScale = 0;
+    bool mTiledCachingEnabled = false;
 
     //! Map of cache key to cache parameters
     QMap<QString, CacheParameters> mCachedImages;
+    //! Map of cache key to the layers on which its tiles depend
+    QMap<QString, QgsWeakMapLayerPointerList> mTileDependentLayers;
+
+    /**
+     * The tiles are stored without holding the mutex, so invalidations are numbered to find out
+     * whether the tiles of a key were invalidated while they were being stored.
+     */
+    quint64 mTileGeneration = 0;
+    //! Generation of the last invalidation of all the tiles
+    quint64 mAllTilesInvalidation = 0;
+    //! Generation of the last invalidation of each cache key, only kept while tiles are being stored
+    QHash<QString, quint64> mTileInvalidations;
+    //! Number of setCacheTiles() calls storing tiles
+    int mTileStores = 0;
+
+    //! Thread safe on its own, accessed without holding the mutex
+    std::unique_ptr< QgsMapRendererTileStore > mTiles;
     //! List of all layers on which this cache is currently connected
     QSet< QgsWeakMapLayerPointer > mConnectedLayers;
 };
@@ -36,6 +36,16 @@
 #include "qgsmaplayerlistutils.h"
 #include "qgsvectorlayerlabeling.h"
 #include "qgssettings.h"
+#include "qgsrasterlayer.h"
+#include "qgsrasterrenderer.h"
+#include "qgsrasterresamplefilter.h"
+#include "qgsrenderer.h"
+#include "qgssymbol.h"
+#include "qgssymbollayer.h"
+#include "qgssymbollayerutils.h"
+#include "qgsfillsymbollayer.h"
+#include "qgslinesymbollayer.h"
+#include "qgspainteffect.h"
 
 ///@cond PRIVATE
 
@@ -114,6 +124,145 @@ bool QgsMapRendererJob::prepareLabelCache() const
 }
 
 
+/**
+ * Returns true if the output of \a layer, and of the layers of its sub symbol, does not depend on the view extent.
+ */
+static bool symbolLayerCanBeTiled( const QgsSymbolLayer *layer )
+{
+  if ( layer->paintEffect() && layer->paintEffect()->enabled() )
+    return false;
+
+  // the brush patterns of other fills are aligned to the image origin or computed from the polygons
+  // clipped to the view, and the dash or marker phase of lines and strokes clipped to the view
+  // changes with it
+  const QString type = layer->layerType();
+  if ( type == QLatin1String( "SimpleFill" ) )
+  {
+    const QgsSimpleFillSymbolLayer *fill = static_cast< const QgsSimpleFillSymbolLayer * >( layer );
+    if ( ( fill->brushStyle() != Qt::SolidPattern && fill->brushStyle() != Qt::NoBrush )
+         || ( fill->strokeStyle() != Qt::SolidLine && fill->strokeStyle() != Qt::NoPen ) )
+      return false;
+  }
+  else if ( type == QLatin1String( "SimpleLine" ) )
+  {
+    const QgsSimpleLineSymbolLayer *line = static_cast< const QgsSimpleLineSymbolLayer * >( layer );
+    if ( line->useCustomDashPattern() || ( line->penStyle() != Qt::SolidLine && line->penStyle() != Qt::NoPen ) )
+      return false;
+  }
+  else
+  {
+    // markers are never clipped to the view
+    static const QStringList sTiledMarkers = QStringList() << QStringLiteral( "SimpleMarker" ) << QStringLiteral( "SvgMarker" )
+        << QStringLiteral( "FontMarker" ) << QStringLiteral( "EllipseMarker" ) << QStringLiteral( "FilledMarker" );
+    if ( !sTiledMarkers.contains( type ) )
+      return false;
+  }
+
+  if ( QgsSymbol *subSymbol = const_cast< QgsSymbolLayer * >( layer )->subSymbol() )
+  {
+    for ( int i = 0; i < subSymbol->symbolLayerCount(); ++i )
+    {
+      if ( !symbolLayerCanBeTiled( subSymbol->symbolLayer( i ) ) )
+        return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Returns the maximum distance in pixels by which the symbols of the features of \a layer may extend beyond
+ * their geometries, or -1 if it cannot be bounded or if the rendering of the layer depends on the view extent.
+ */
+static double maxSymbolBleed( const QgsVectorLayer *layer, QgsRenderContext &context )
+{
+  QgsFeatureRenderer *renderer = layer->renderer();
+  if ( !renderer )
+    return 0;
+
+  // the output of other renderers, such as heatmaps, clusters or inverted polygons, depends on the
+  // features of the whole view
+  static const QStringList sTiledRenderers = QStringList() << QStringLiteral( "singleSymbol" ) << QStringLiteral( "categorizedSymbol" )
+      << QStringLiteral( "graduatedSymbol" ) << QStringLiteral( "RuleRenderer" ) << QStringLiteral( "nullSymbol" );
+  if ( !sTiledRenderers.contains( renderer->type() ) )
+    return -1;
+
+  if ( renderer->paintEffect() && renderer->paintEffect()->enabled() )
+    return -1;
+
+  double bleed = 0;
+  const QgsSymbolList symbols = renderer->symbols( context );
+  for ( QgsSymbol *symbol : symbols )
+  {
+    if ( symbol->hasDataDefinedProperties() )
+      return -1;
+
+    for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+    {
+      if ( !symbolLayerCanBeTiled( symbol->symbolLayer( i ) ) )
+        return -1;
+    }
+
+    if ( symbol->type() == QgsSymbol::Marker )
+    {
+      std::unique_ptr< QgsSymbol > marker( symbol->clone() );
+      marker->startRender( context );
+      const QRectF bounds = static_cast< QgsMarkerSymbol * >( marker.get() )->bounds( QPointF( 0, 0 ), context );
+      marker->stopRender( context );
+      bleed = std::max( bleed, std::max( std::max( -bounds.left(), bounds.right() ), std::max( -bounds.top(), bounds.bottom() ) ) );
+    }
+    else
+    {
+      bleed = std::max( bleed, QgsSymbolLayerUtils::estimateMaxSymbolBleed( symbol, context ) );
+    }
+  }
+  return bleed;
+}
+
+bool QgsMapRendererJob::canCacheTiles( const QgsMapLayer *layer, int &margin ) const
+{
+  if ( !mCache || !mCache->tiledCachingEnabled() )
+    return false;
+
+  // filtered or restyled renders are specific to this job
+  if ( mFeatureFilterProvider || mSettings.layerStyleOverrides().contains( layer->id() ) )
+    return false;
+
+  // a couple of pixels are kept for antialiasing
+  margin = 2;
+
+  if ( const QgsVectorLayer *vl = qobject_cast< const QgsVectorLayer * >( layer ) )
+  {
+    // edits are not tracked by the cache
+    if ( vl->isEditable() )
+      return false;
+
+    // the tiles near the edges of the view lack the symbols of the features outside of it
+    QImage image( 1, 1, QImage::Format_ARGB32_Premultiplied );
+    QPainter painter( &image );
+    QgsRenderContext context = QgsRenderContext::fromMapSettings( mSettings );
+    context.setPainter( &painter );
+    const double bleed = maxSymbolBleed( vl, context );
+    if ( bleed < 0 )
+      return false;
+
+    margin += static_cast< int >( std::ceil( bleed ) );
+    return true;
+  }
+  else if ( const QgsRasterLayer *rl = qobject_cast< const QgsRasterLayer * >( layer ) )
+  {
+    // contrast stretched to the view extent
+    if ( rl->renderer() && rl->renderer()->minMaxOrigin().extent() == QgsRasterMinMaxOrigin::UpdatedCanvas )
+      return false;
+
+    // resampled pixels near the edges of the view differ from those rendered within it
+    const QgsRasterResampleFilter *resampleFilter = rl->resampleFilter();
+    return !resampleFilter || ( !resampleFilter->zoomedInResampler() && !resampleFilter->zoomedOutResampler() );
+  }
+
+  // the rendering of other layers is unknown
+  return false;
+}
+
 bool QgsMapRendererJob::reprojectToLayerExtent( const QgsMapLayer *ml, const QgsCoordinateTransform &ct, QgsRectangle &extent, QgsRectangle &r2 )
 {
   bool split = false;
@@ -270,6 +419,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
 
     // Force render of layers that are being edited
     // or if there's a labeling engine that needs the layer to register features
+    bool forceRender = false;
     if ( mCache && ml->type() == QgsMapLayer::VectorLayer )
     {
       QgsVectorLayer *vl = qobject_cast<QgsVectorLayer *>( ml );
@@ -278,6 +428,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
       if ( vl->isEditable() || requiresLabeling )
       {
         mCache->clearCacheImage( ml->id() );
+        forceRender = true;
       }
     }
 
@@ -315,6 +466,24 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
       continue;
     }
 
+    // otherwise the image may be assembled from the tiles of views previously rendered at the same scale
+    int tileMargin = 0;
+    if ( mCache && !forceRender && canCacheTiles( ml, tileMargin ) )
+    {
+      QImage tilesImage = mCache->cacheTilesImage( ml->id(), mSettings );
+      if ( !tilesImage.isNull() )
+      {
+        // also keep it as the image of the current view
+        mCache->setCacheImage( ml->id(), tilesImage, QList< QgsMapLayer * >() << ml );
+        job.cached = true;
+        job.imageInitialized = true;
+        job.img = new QImage( tilesImage );
+        job.renderer = nullptr;
+        job.context.setPainter( nullptr );
+        continue;
+      }
+    }
+
     // If we are drawing with an alternative blending mode then we need to render to a separate image
     // before compositing this on the map. This effectively flattens the layer and prevents
     // blending occurring between objects on the layer
@@ -412,6 +581,9 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs &jobs )
       {
         QgsDebugMsg( "caching image for " + ( job.layer ? job.layer->id() : QString() ) );
         mCache->setCacheImage( job.layer->id(), *job.img, QList< QgsMapLayer * >() << job.layer );
+        int tileMargin = 0;
+        if ( canCacheTiles( job.layer, tileMargin ) )
+          mCache->setCacheTiles( job.layer->id(), mSettings, *job.img, QList< QgsMapLayer * >() << job.layer, tileMargin );
       }
 
       delete job.img;
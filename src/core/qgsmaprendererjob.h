@@ -302,6 +302,13 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     bool needTemporaryImage( QgsMapLayer *ml );
 
+    /**
+     * Returns true if the rendered image of \a layer can be cached as tiles, and reused from tiles.
+     * \a margin is set to the distance in pixels from the edges of the rendered image within which
+     * tiles may lack parts of the symbols of features outside of the view.
+     */
+    bool canCacheTiles( const QgsMapLayer *layer, int &margin ) const;
+
     const QgsFeatureFilterProvider *mFeatureFilterProvider = nullptr;
 };
 
@@ -0,0 +1,518 @@
+/***************************************************************************
+  qgsmaprenderertilestore_p.cpp
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmaprenderertilestore_p.h"
+
+#include "qgsmapsettings.h"
+
+#include <QDir>
+#include <QFile>
+#include <QPainter>
+#include <QSet>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/// @cond PRIVATE
+
+//! Maximum offset in pixels between a view and its grid for the view to be considered aligned on the grid
+static const double PIXEL_TOLERANCE = 0.01;
+
+static qint64 floorDiv( qint64 value, qint64 divisor )
+{
+  return value >= 0 ? value / divisor : -( ( -value + divisor - 1 ) / divisor );
+}
+
+static qint64 ceilDiv( qint64 value, qint64 divisor )
+{
+  return -floorDiv( -value, divisor );
+}
+
+QgsMapRendererTileStore::QgsMapRendererTileStore()
+  : mMemoryUsage( 0 )
+{
+}
+
+QgsMapRendererTileStore::~QgsMapRendererTileStore()
+{
+  clear();
+}
+
+template <typename Predicate>
+void QgsMapRendererTileStore::removeTilesIf( Predicate predicate )
+{
+  QStringList spillPaths;
+  for ( Shard &tileShard : mShards )
+  {
+    QWriteLocker locker( &tileShard.lock );
+    for ( auto it = tileShard.tiles.begin(); it != tileShard.tiles.end(); )
+    {
+      const Tile &tile = *it.value();
+      if ( !predicate( it.key(), tile ) )
+      {
+        ++it;
+        continue;
+      }
+
+      if ( !tile.image.isNull() )
+        mMemoryUsage -= tile.bytes;
+      if ( !tile.spillPath.isEmpty() )
+        spillPaths << tile.spillPath;
+      it = tileShard.tiles.erase( it );
+    }
+  }
+
+  for ( const QString &path : qgis::as_const( spillPaths ) )
+    QFile::remove( path );
+}
+
+void QgsMapRendererTileStore::pruneLevels()
+{
+  // the write lock waits for tiles being inserted, their levels are then found below
+  QWriteLocker levelsLocker( &mLevelsLock );
+  QSet< int > usedLevels;
+  for ( const Shard &tileShard : mShards )
+  {
+    QReadLocker locker( &tileShard.lock );
+    for ( auto it = tileShard.tiles.constBegin(); it != tileShard.tiles.constEnd(); ++it )
+      usedLevels << it.key().level;
+  }
+
+  for ( auto it = mLevels.begin(); it != mLevels.end(); )
+  {
+    if ( usedLevels.contains( it.key() ) )
+      ++it;
+    else
+      it = mLevels.erase( it );
+  }
+}
+
+void QgsMapRendererTileStore::setTileSize( int size )
+{
+  size = std::max( size, 16 );
+  if ( size == mTileSize )
+    return;
+
+  clear();
+  mTileSize = size;
+}
+
+void QgsMapRendererTileStore::setMemoryBudget( qint64 bytes )
+{
+  mMemoryBudget = std::max< qint64 >( bytes, 0 );
+  enforceMemoryBudget();
+}
+
+bool QgsMapRendererTileStore::setSpillDirectory( const QString &path )
+{
+  QMutexLocker locker( &mSpillMutex );
+
+  // tiles only available on disk are lost with the previous directory
+  removeTilesIf( []( const TileKey &, const Tile & tile ) { return tile.image.isNull(); } );
+  mSpillDir.reset();
+
+  if ( path.isEmpty() )
+    return true;
+
+  if ( !QDir().mkpath( path ) )
+    return false;
+
+  std::unique_ptr< QTemporaryDir > spillDir( new QTemporaryDir( path + QStringLiteral( "/qgis-render-cache-XXXXXX" ) ) );
+  if ( !spillDir->isValid() )
+    return false;
+
+  mSpillDir = std::move( spillDir );
+  return true;
+}
+
+QString QgsMapRendererTileStore::spillDirectory() const
+{
+  QMutexLocker locker( &mSpillMutex );
+  return mSpillDir ? mSpillDir->path() : QString();
+}
+
+bool QgsMapRendererTileStore::viewPosition( const QgsMapSettings &settings, bool create, ViewPosition &position )
+{
+  if ( !qgsDoubleNear( settings.rotation(), 0.0 ) )
+    return false;
+
+  const double mapUnitsPerPixel = settings.mapUnitsPerPixel();
+  if ( mapUnitsPerPixel <= 0 )
+    return false;
+
+  const QgsCoordinateReferenceSystem crs = settings.destinationCrs();
+  const QString levelKey = QStringLiteral( "%1|%2|%3|%4|%5|%6" ).arg( QString::number( mapUnitsPerPixel, 'g', 10 ),
+                           crs.authid().isEmpty() ? crs.toWkt() : crs.authid(),
+                           QString::number( settings.outputDpi(), 'g', 17 ),
+                           QString::number( static_cast< int >( settings.outputImageFormat() ) ),
+                           QString::number( static_cast< int >( settings.flags() ) ),
+                           settings.selectionColor().name( QColor::HexArgb ) );
+
+  const QgsRectangle extent = settings.visibleExtent();
+  int level = -1;
+  double originX = 0;
+  double originY = 0;
+  {
+    QReadLocker locker( &mLevelsLock );
+    for ( auto it = mLevels.constBegin(); it != mLevels.constEnd(); ++it )
+    {
+      if ( it.value().key == levelKey )
+      {
+        level = it.key();
+        originX = it.value().originX;
+        originY = it.value().originY;
+        break;
+      }
+    }
+  }
+
+  if ( level < 0 )
+  {
+    if ( !create )
+      return false;
+
+    // anchor the grid at this view
+    QWriteLocker locker( &mLevelsLock );
+    for ( auto it = mLevels.constBegin(); it != mLevels.constEnd(); ++it )
+    {
+      if ( it.value().key == levelKey )
+      {
+        level = it.key();
+        originX = it.value().originX;
+        originY = it.value().originY;
+        break;
+      }
+    }
+    if ( level < 0 )
+    {
+      level = mNextLevel++;
+      originX = extent.xMinimum();
+      originY = extent.yMaximum();
+      mLevels.insert( level, Level{ levelKey, originX, originY } );
+    }
+  }
+
+  const double x = ( extent.xMinimum() - originX ) / mapUnitsPerPixel;
+  const double y = ( originY - extent.yMaximum() ) / mapUnitsPerPixel;
+  const double roundedX = std::round( x );
+  const double roundedY = std::round( y );
+  if ( std::fabs( x - roundedX ) > PIXEL_TOLERANCE || std::fabs( y - roundedY ) > PIXEL_TOLERANCE
+       || std::fabs( roundedX ) > 1e15 || std::fabs( roundedY ) > 1e15 )
+    return false;
+
+  position.level = level;
+  position.x = static_cast< qint64 >( roundedX );
+  position.y = static_cast< qint64 >( roundedY );
+  return true;
+}
+
+void QgsMapRendererTileStore::storeImage( const QString &cacheKey, const QgsMapSettings &settings, const QImage &image, int margin )
+{
+  if ( image.isNull() || image.size() != settings.outputSize() )
+    return;
+
+  ViewPosition position;
+  if ( !viewPosition( settings, true, position ) )
+    return;
+
+  const int tileSize = mTileSize;
+  const qint64 firstColumn = ceilDiv( position.x + margin, tileSize );
+  const qint64 lastColumn = floorDiv( position.x + image.width() - margin, tileSize ) - 1;
+  const qint64 firstRow = ceilDiv( position.y + margin, tileSize );
+  const qint64 lastRow = floorDiv( position.y + image.height() - margin, tileSize ) - 1;
+  {
+    // the level may have been pruned since the position was found, tiles on its grid could not be found anymore
+    QReadLocker levelsLocker( &mLevelsLock );
+    if ( !mLevels.contains( position.level ) )
+      return;
+
+    bool copied = true;
+    for ( qint64 row = firstRow; copied && row <= lastRow; ++row )
+    {
+      for ( qint64 column = firstColumn; column <= lastColumn; ++column )
+      {
+        const QImage tileImage = image.copy( static_cast< int >( column * tileSize - position.x ), static_cast< int >( row * tileSize - position.y ), tileSize, tileSize );
+        copied = !tileImage.isNull();
+        if ( !copied )
+          break;
+
+        insertTile( TileKey{ cacheKey, position.level, column, row }, tileImage );
+      }
+    }
+  }
+
+  enforceMemoryBudget();
+}
+
+QImage QgsMapRendererTileStore::image( const QString &cacheKey, const QgsMapSettings &settings )
+{
+  ViewPosition position;
+  if ( !viewPosition( settings, false, position ) )
+    return QImage();
+
+  const QSize size = settings.outputSize();
+  if ( size.isEmpty() )
+    return QImage();
+
+  const int tileSize = mTileSize;
+  const qint64 firstColumn = floorDiv( position.x, tileSize );
+  const qint64 lastColumn = floorDiv( position.x + size.width() - 1, tileSize );
+  const qint64 firstRow = floorDiv( position.y, tileSize );
+  const qint64 lastRow = floorDiv( position.y + size.height() - 1, tileSize );
+
+  QList< QImage > tiles;
+  bool readFromDisk = false;
+  for ( qint64 row = firstRow; row <= lastRow; ++row )
+  {
+    for ( qint64 column = firstColumn; column <= lastColumn; ++column )
+    {
+      const TileKey key{ cacheKey, position.level, column, row };
+      Shard &tileShard = shard( key );
+      std::shared_ptr< Tile > tile;
+      QString spillPath;
+      {
+        QReadLocker locker( &tileShard.lock );
+        auto it = tileShard.tiles.constFind( key );
+        if ( it == tileShard.tiles.constEnd() )
+          return QImage();
+
+        tile = it.value();
+        tile->lastUsed.store( mAccessCounter.fetchAndAddRelaxed( 1 ) + 1 );
+        if ( !tile->image.isNull() )
+        {
+          tiles << tile->image;
+          continue;
+        }
+        spillPath = tile->spillPath;
+      }
+
+      // the tile was spilled - bring it back to memory
+      const QImage tileImage = readTile( spillPath );
+      if ( tileImage.isNull() )
+        return QImage();
+
+      {
+        QWriteLocker locker( &tileShard.lock );
+        auto it = tileShard.tiles.find( key );
+        if ( it != tileShard.tiles.end() && it.value() == tile && tile->image.isNull() )
+        {
+          tile->image = tileImage;
+          tile->spillPath.clear();
+          mMemoryUsage += tile->bytes;
+          QFile::remove( spillPath );
+        }
+      }
+      tiles << tileImage;
+      readFromDisk = true;
+    }
+  }
+
+  QImage result( size, settings.outputImageFormat() );
+  if ( result.isNull() )
+    return QImage();
+
+  QPainter painter( &result );
+  painter.setCompositionMode( QPainter::CompositionMode_Source );
+  int tileIndex = 0;
+  for ( qint64 row = firstRow; row <= lastRow; ++row )
+  {
+    for ( qint64 column = firstColumn; column <= lastColumn; ++column )
+    {
+      painter.drawImage( QPoint( static_cast< int >( column * tileSize - position.x ), static_cast< int >( row * tileSize - position.y ) ), tiles.at( tileIndex++ ) );
+    }
+  }
+  painter.end();
+
+  if ( readFromDisk )
+    enforceMemoryBudget();
+
+  return result;
+}
+
+bool QgsMapRendererTileStore::hasTiles( const QString &cacheKey ) const
+{
+  for ( const Shard &tileShard : mShards )
+  {
+    QReadLocker locker( &tileShard.lock );
+    for ( auto it = tileShard.tiles.constBegin(); it != tileShard.tiles.constEnd(); ++it )
+    {
+      if ( it.key().cacheKey == cacheKey )
+        return true;
+    }
+  }
+  return false;
+}
+
+void QgsMapRendererTileStore::removeTiles( const QString &cacheKey )
+{
+  removeTilesIf( [&cacheKey]( const TileKey & key, const Tile & ) { return key.cacheKey == cacheKey; } );
+  pruneLevels();
+}
+
+void QgsMapRendererTileStore::clear()
+{
+  removeTilesIf( []( const TileKey &, const Tile & ) { return true; } );
+  pruneLevels();
+}
+
+void QgsMapRendererTileStore::insertTile( const TileKey &key, const QImage &image )
+{
+  std::shared_ptr< Tile > tile = std::make_shared< Tile >();
+  tile->image = image;
+  tile->bytes = image.byteCount();
+  tile->lastUsed.store( mAccessCounter.fetchAndAddRelaxed( 1 ) + 1 );
+
+  QString oldSpillPath;
+  {
+    Shard &tileShard = shard( key );
+    QWriteLocker locker( &tileShard.lock );
+    auto it = tileShard.tiles.find( key );
+    if ( it != tileShard.tiles.end() )
+    {
+      const Tile &oldTile = *it.value();
+      if ( !oldTile.image.isNull() )
+        mMemoryUsage -= oldTile.bytes;
+      oldSpillPath = oldTile.spillPath;
+      it.value() = tile;
+    }
+    else
+    {
+      tileShard.tiles.insert( key, tile );
+    }
+    mMemoryUsage += tile->bytes;
+  }
+
+  if ( !oldSpillPath.isEmpty() )
+    QFile::remove( oldSpillPath );
+}
+
+void QgsMapRendererTileStore::enforceMemoryBudget()
+{
+  if ( mMemoryUsage <= mMemoryBudget )
+    return;
+
+  // a single thread evicts tiles at a time, others just go on
+  if ( !mSpillMutex.tryLock() )
+    return;
+
+  struct Candidate
+  {
+    int lastUsed;
+    int shard;
+    TileKey key;
+    std::shared_ptr< Tile > tile;
+  };
+
+  std::vector< Candidate > candidates;
+  for ( int i = 0; i < SHARD_COUNT; ++i )
+  {
+    QReadLocker locker( &mShards[i].lock );
+    for ( auto it = mShards[i].tiles.constBegin(); it != mShards[i].tiles.constEnd(); ++it )
+    {
+      if ( !it.value()->image.isNull() )
+        candidates.push_back( Candidate{ it.value()->lastUsed.load(), i, it.key(), it.value() } );
+    }
+  }
+  std::sort( candidates.begin(), candidates.end(), []( const Candidate & a, const Candidate & b )
+  {
+    return a.lastUsed < b.lastUsed;
+  } );
+
+  // free a bit more than needed, so that evictions do not happen for every stored view
+  const qint64 targetUsage = mMemoryBudget / 4 * 3;
+  for ( const Candidate &candidate : candidates )
+  {
+    if ( mMemoryUsage <= targetUsage )
+      break;
+
+    Shard &tileShard = mShards[ candidate.shard ];
+    QString spillPath;
+    if ( mSpillDir )
+    {
+      QImage image;
+      {
+        QReadLocker locker( &tileShard.lock );
+        image = candidate.tile->image;
+      }
+      spillPath = QStringLiteral( "%1/%2.tile" ).arg( mSpillDir->path() ).arg( mSpillFileCounter.fetchAndAddRelaxed( 1 ) );
+      if ( image.isNull() || !writeTile( spillPath, image ) )
+      {
+        QFile::remove( spillPath );
+        spillPath.clear();
+      }
+    }
+
+    {
+      QWriteLocker locker( &tileShard.lock );
+      auto it = tileShard.tiles.find( candidate.key );
+      if ( it != tileShard.tiles.end() && it.value() == candidate.tile && !candidate.tile->image.isNull() )
+      {
+        mMemoryUsage -= candidate.tile->bytes;
+        if ( !spillPath.isEmpty() )
+        {
+          candidate.tile->image = QImage();
+          candidate.tile->spillPath = spillPath;
+          spillPath.clear();
+        }
+        else
+        {
+          tileShard.tiles.erase( it );
+        }
+      }
+    }
+
+    // tile was removed or replaced meanwhile
+    if ( !spillPath.isEmpty() )
+      QFile::remove( spillPath );
+  }
+
+  mSpillMutex.unlock();
+}
+
+QImage QgsMapRendererTileStore::readTile( const QString &path )
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return QImage();
+
+  qint32 header[4];
+  if ( file.read( reinterpret_cast< char * >( header ), sizeof( header ) ) != static_cast< qint64 >( sizeof( header ) ) )
+    return QImage();
+
+  QImage image( header[0], header[1], static_cast< QImage::Format >( header[2] ) );
+  if ( image.isNull() || image.bytesPerLine() != header[3] )
+    return QImage();
+
+  if ( file.read( reinterpret_cast< char * >( image.bits() ), image.byteCount() ) != image.byteCount() )
+    return QImage();
+
+  return image;
+}
+
+bool QgsMapRendererTileStore::writeTile( const QString &path, const QImage &image )
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return false;
+
+  // raw pixels are much faster to write and read than any compressed format
+  const qint32 header[4] = { image.width(), image.height(), static_cast< qint32 >( image.format() ), image.bytesPerLine() };
+  if ( file.write( reinterpret_cast< const char * >( header ), sizeof( header ) ) != static_cast< qint64 >( sizeof( header ) ) )
+    return false;
+
+  return file.write( reinterpret_cast< const char * >( image.constBits() ), image.byteCount() ) == image.byteCount();
+}
+
+/// @endcond
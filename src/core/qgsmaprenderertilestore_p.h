@@ -0,0 +1,226 @@
+/***************************************************************************
+  qgsmaprenderertilestore_p.h
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMAPRENDERERTILESTORE_P_H
+#define QGSMAPRENDERERTILESTORE_P_H
+
+#define SIP_NO_FILE
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QString>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+class QgsMapSettings;
+
+/**
+ * \ingroup core
+ * Thread safe store of rendered map tiles, used by QgsMapRendererCache.
+ *
+ * Images are cut into square tiles aligned on a pixel grid. Each map
+ * scale (or more precisely each combination of map units per pixel, CRS and
+ * rendering settings) has its own grid, anchored at the first view stored for it,
+ * so that any view panned by whole pixels from it can be assembled again from tiles.
+ *
+ * Tiles are spread over several shards, each with its own read-write lock, so that
+ * readers never wait for each other and writers only block a fraction of the store.
+ * When the tiles held in memory exceed the memory budget, the least recently used
+ * ones are written to the spill directory (if any) and read back when needed,
+ * or discarded.
+ *
+ * \since QGIS 3.2
+ */
+class QgsMapRendererTileStore
+{
+  public:
+
+    QgsMapRendererTileStore();
+    ~QgsMapRendererTileStore();
+
+    //! QgsMapRendererTileStore cannot be copied
+    QgsMapRendererTileStore( const QgsMapRendererTileStore &rh ) = delete;
+    //! QgsMapRendererTileStore cannot be copied
+    QgsMapRendererTileStore &operator=( const QgsMapRendererTileStore &rh ) = delete;
+
+    /**
+     * Sets the width and height of tiles, in pixels. Changing the tile size clears the store.
+     */
+    void setTileSize( int size );
+
+    //! Returns the width and height of tiles, in pixels
+    int tileSize() const { return mTileSize; }
+
+    //! Sets the maximum size in bytes of the tiles kept in memory
+    void setMemoryBudget( qint64 bytes );
+
+    //! Returns the maximum size in bytes of the tiles kept in memory
+    qint64 memoryBudget() const { return mMemoryBudget; }
+
+    /**
+     * Sets the directory below which tiles exceeding the memory budget are written.
+     * An empty \a path disables spilling, tiles exceeding the budget are then discarded.
+     * \returns false if the spill directory cannot be created
+     */
+    bool setSpillDirectory( const QString &path );
+
+    //! Returns the directory below which tiles exceeding the memory budget are written
+    QString spillDirectory() const;
+
+    //! Returns the size in bytes of the tiles held in memory
+    qint64 memoryUsage() const { return mMemoryUsage; }
+
+    /**
+     * Stores the tiles of the rendered \a image of the view defined by \a settings for \a cacheKey.
+     * Only tiles which are entirely within the image, and at least \a margin pixels away from its edges, are stored.
+     */
+    void storeImage( const QString &cacheKey, const QgsMapSettings &settings, const QImage &image, int margin );
+
+    /**
+     * Returns the image for \a cacheKey of the view defined by \a settings, assembled from tiles,
+     * or a null image if some tiles are missing.
+     */
+    QImage image( const QString &cacheKey, const QgsMapSettings &settings );
+
+    //! Returns true if some tiles are stored for \a cacheKey
+    bool hasTiles( const QString &cacheKey ) const;
+
+    //! Removes the tiles stored for \a cacheKey, and the grids which have no tiles left
+    void removeTiles( const QString &cacheKey );
+
+    //! Removes all the tiles and grids
+    void clear();
+
+  private:
+
+    static const int SHARD_COUNT = 16;
+
+    struct TileKey
+    {
+      QString cacheKey;
+      int level;
+      qint64 column;
+      qint64 row;
+
+      bool operator==( const TileKey &other ) const
+      {
+        return level == other.level && column == other.column && row == other.row && cacheKey == other.cacheKey;
+      }
+    };
+
+    friend uint qHash( const TileKey &key )
+    {
+      return qHash( key.cacheKey ) ^ ( static_cast< uint >( key.level ) * 31 ) ^ qHash( key.column * 73856093 ^ key.row * 19349663 );
+    }
+
+    struct Tile
+    {
+      //! Null when the tile is only on disk
+      QImage image;
+      QString spillPath;
+      qint64 bytes = 0;
+      //! Value of the access counter when the tile was last used
+      QAtomicInt lastUsed;
+    };
+
+    struct Shard
+    {
+      mutable QReadWriteLock lock;
+      QHash< TileKey, std::shared_ptr< Tile > > tiles;
+    };
+
+    //! Grid of a map scale and rendering settings
+    struct Level
+    {
+      QString key;
+      double originX;
+      double originY;
+    };
+
+    //! Position of a view on the grid of its level
+    struct ViewPosition
+    {
+      //! Identifier of the level
+      int level;
+      //! Pixel of the grid at the top left of the view
+      qint64 x;
+      qint64 y;
+    };
+
+    /**
+     * Finds the position of the view defined by \a settings on its grid. If \a create is true,
+     * a grid anchored at the view is added when there is none for its level.
+     * \returns false if the view is not aligned on the grid pixels, or cannot be tiled
+     */
+    bool viewPosition( const QgsMapSettings &settings, bool create, ViewPosition &position );
+
+    Shard &shard( const TileKey &key ) { return mShards[ qHash( key ) % SHARD_COUNT ]; }
+
+    //! Adds a tile, replacing any tile with the same key
+    void insertTile( const TileKey &key, const QImage &image );
+
+    //! Moves the least recently used tiles out of memory until the memory budget is met
+    void enforceMemoryBudget();
+
+    //! Reads the image of a tile written by writeTile()
+    static QImage readTile( const QString &path );
+
+    //! Writes the image of a tile to \a path
+    static bool writeTile( const QString &path, const QImage &image );
+
+    //! Removes the tiles for which \a predicate returns true
+    template <typename Predicate>
+    void removeTilesIf( Predicate predicate );
+
+    //! Removes the levels which have no tiles
+    void pruneLevels();
+
+    Shard mShards[SHARD_COUNT];
+
+    //! Protects the levels. Tiles are inserted with a read lock, so that their level cannot be pruned meanwhile
+    mutable QReadWriteLock mLevelsLock;
+    QHash< int, Level > mLevels;
+    int mNextLevel = 0;
+
+    int mTileSize = 256;
+    qint64 mMemoryBudget = 256 * 1024 * 1024;
+    std::atomic< qint64 > mMemoryUsage;
+    QAtomicInt mAccessCounter;
+    QAtomicInt mSpillFileCounter;
+
+    //! Serializes evictions and spill directory changes
+    mutable QMutex mSpillMutex;
+    std::unique_ptr< QTemporaryDir > mSpillDir;
+};
+
+/// @endcond
+
+#endif // QGSMAPRENDERERTILESTORE_P_H
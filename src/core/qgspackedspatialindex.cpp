@@ -0,0 +1,376 @@
+/***************************************************************************
+  qgspackedspatialindex.cpp
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgspackedspatialindex.h"
+
+#include "qgsfeatureiterator.h"
+#include "qgsfeaturesource.h"
+#include "qgsfeedback.h"
+#include "qgsgeometry.h"
+
+#include <QPair>
+#include <QThread>
+#include <QVarLengthArray>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <vector>
+
+///@cond PRIVATE
+namespace
+{
+  //! Minimum number of items handled by each thread of parallelFor()
+  const int MIN_PARALLEL_CHUNK = 4096;
+
+  //! Splits [0, count) in ranges of at least \a minChunk items, one per thread
+  QVector< QPair< int, int > > chunkRanges( int count, int minChunk )
+  {
+    const int chunks = qMax( 1, qMin( QThread::idealThreadCount(), count / minChunk ) );
+    QVector< QPair< int, int > > ranges;
+    ranges.reserve( chunks );
+    for ( int i = 0; i < chunks; ++i )
+      ranges << qMakePair( static_cast< int >( static_cast< qint64 >( count ) * i / chunks ),
+                           static_cast< int >( static_cast< qint64 >( count ) * ( i + 1 ) / chunks ) );
+    return ranges;
+  }
+
+  //! Calls \a function for each index of [0, count), spreading the indices over the available threads
+  template <typename Function>
+  void parallelFor( int count, Function function )
+  {
+    QVector< QPair< int, int > > ranges = chunkRanges( count, MIN_PARALLEL_CHUNK );
+    if ( ranges.size() == 1 )
+    {
+      for ( int i = 0; i < count; ++i )
+        function( i );
+      return;
+    }
+
+    QtConcurrent::blockingMap( ranges, [&function]( const QPair< int, int > &range )
+    {
+      for ( int i = range.first; i < range.second; ++i )
+        function( i );
+    } );
+  }
+
+  /**
+   * Returns the distance along a Hilbert curve of order 16 of the cell (\a x, \a y).
+   * Adapted from the public domain implementation at https://github.com/rawrunprotected/hilbert_curves
+   */
+  quint32 hilbert( quint32 x, quint32 y )
+  {
+    quint32 a = x ^ y;
+    quint32 b = 0xFFFF ^ a;
+    quint32 c = 0xFFFF ^ ( x | y );
+    quint32 d = x & ( y ^ 0xFFFF );
+
+    quint32 A = a | ( b >> 1 );
+    quint32 B = ( a >> 1 ) ^ a;
+    quint32 C = ( ( c >> 1 ) ^ ( b & ( d >> 1 ) ) ) ^ c;
+    quint32 D = ( ( a & ( c >> 1 ) ) ^ ( d >> 1 ) ) ^ d;
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    A = ( ( a & ( a >> 2 ) ) ^ ( b & ( b >> 2 ) ) );
+    B = ( ( a & ( b >> 2 ) ) ^ ( b & ( ( a ^ b ) >> 2 ) ) );
+    C ^= ( ( a & ( c >> 2 ) ) ^ ( b & ( d >> 2 ) ) );
+    D ^= ( ( b & ( c >> 2 ) ) ^ ( ( a ^ b ) & ( d >> 2 ) ) );
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    A = ( ( a & ( a >> 4 ) ) ^ ( b & ( b >> 4 ) ) );
+    B = ( ( a & ( b >> 4 ) ) ^ ( b & ( ( a ^ b ) >> 4 ) ) );
+    C ^= ( ( a & ( c >> 4 ) ) ^ ( b & ( d >> 4 ) ) );
+    D ^= ( ( b & ( c >> 4 ) ) ^ ( ( a ^ b ) & ( d >> 4 ) ) );
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    C ^= ( ( a & ( c >> 8 ) ) ^ ( b & ( d >> 8 ) ) );
+    D ^= ( ( b & ( c >> 8 ) ) ^ ( ( a ^ b ) & ( d >> 8 ) ) );
+
+    a = C ^ ( C >> 1 );
+    b = D ^ ( D >> 1 );
+
+    quint32 i0 = x ^ y;
+    quint32 i1 = b | ( 0xFFFF ^ ( i0 | a ) );
+
+    i0 = ( i0 | ( i0 << 8 ) ) & 0x00FF00FF;
+    i0 = ( i0 | ( i0 << 4 ) ) & 0x0F0F0F0F;
+    i0 = ( i0 | ( i0 << 2 ) ) & 0x33333333;
+    i0 = ( i0 | ( i0 << 1 ) ) & 0x55555555;
+
+    i1 = ( i1 | ( i1 << 8 ) ) & 0x00FF00FF;
+    i1 = ( i1 | ( i1 << 4 ) ) & 0x0F0F0F0F;
+    i1 = ( i1 | ( i1 << 2 ) ) & 0x33333333;
+    i1 = ( i1 | ( i1 << 1 ) ) & 0x55555555;
+
+    return ( i1 << 1 ) | i0;
+  }
+}
+///@endcond
+
+QgsPackedSpatialIndex::QgsPackedSpatialIndex( const QgsFeatureIterator &fi, QgsFeedback *feedback )
+{
+  QVector< QgsFeatureId > ids;
+  QVector< Box > boxes;
+  readFeatures( fi, feedback, ids, boxes );
+  build( ids, boxes );
+}
+
+QgsPackedSpatialIndex::QgsPackedSpatialIndex( const QgsFeatureSource &source, QgsFeedback *feedback )
+{
+  QVector< QgsFeatureId > ids;
+  QVector< Box > boxes;
+  const long featureCount = source.featureCount();
+  if ( featureCount > 0 )
+  {
+    ids.reserve( featureCount );
+    boxes.reserve( featureCount );
+  }
+  readFeatures( source.getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) ), feedback, ids, boxes );
+  build( ids, boxes );
+}
+
+QgsPackedSpatialIndex::QgsPackedSpatialIndex( const QList< QgsFeatureId > &ids, const QList< QgsRectangle > &bounds )
+{
+  Q_ASSERT( ids.size() == bounds.size() );
+  const int count = qMin( ids.size(), bounds.size() );
+
+  QVector< QgsFeatureId > idVector;
+  QVector< Box > boxes;
+  idVector.reserve( count );
+  boxes.reserve( count );
+  for ( int i = 0; i < count; ++i )
+  {
+    const QgsRectangle &rect = bounds.at( i );
+    idVector << ids.at( i );
+    boxes << Box { rect.xMinimum(), rect.yMinimum(), rect.xMaximum(), rect.yMaximum() };
+  }
+  build( idVector, boxes );
+}
+
+QgsRectangle QgsPackedSpatialIndex::extent() const
+{
+  if ( mBoxes.isEmpty() )
+    return QgsRectangle();
+
+  const Box &root = mBoxes.constLast();
+  return QgsRectangle( root.xMin, root.yMin, root.xMax, root.yMax );
+}
+
+QList< QgsFeatureId > QgsPackedSpatialIndex::intersects( const QgsRectangle &rectangle ) const
+{
+  QVector< QgsFeatureId > results;
+  intersects( rectangle, results );
+  return results.toList();
+}
+
+int QgsPackedSpatialIndex::intersects( const QgsRectangle &rectangle, QVector< QgsFeatureId > &results ) const
+{
+  if ( mBoxes.isEmpty() )
+    return 0;
+
+  const double xMin = rectangle.xMinimum();
+  const double yMin = rectangle.yMinimum();
+  const double xMax = rectangle.xMaximum();
+  const double yMax = rectangle.yMaximum();
+  auto boxIntersects = [ = ]( const Box & box )
+  {
+    return box.xMin <= xMax && box.xMax >= xMin && box.yMin <= yMax && box.yMax >= yMin;
+  };
+
+  const Box *boxes = mBoxes.constData();
+  const int *levelOffsets = mLevelOffsets.constData();
+  const int initialSize = results.size();
+
+  const int rootLevel = mLevelOffsets.size() - 2;
+  const int root = levelOffsets[ rootLevel ];
+  if ( !boxIntersects( boxes[ root ] ) )
+    return 0;
+  if ( rootLevel == 0 )
+  {
+    results << mIds.at( root );
+    return 1;
+  }
+
+  // nodes to visit, with their level
+  QVarLengthArray< QPair< int, int >, 128 > stack;
+  stack.append( qMakePair( root, rootLevel ) );
+  while ( !stack.isEmpty() )
+  {
+    const QPair< int, int > node = stack.last();
+    stack.removeLast();
+
+    const int level = node.second;
+    const int childLevel = level - 1;
+    const int firstChild = levelOffsets[ childLevel ] + ( node.first - levelOffsets[ level ] ) * NODE_SIZE;
+    const int endChild = qMin( firstChild + NODE_SIZE, levelOffsets[ level ] );
+    for ( int child = firstChild; child < endChild; ++child )
+    {
+      if ( !boxIntersects( boxes[ child ] ) )
+        continue;
+
+      if ( childLevel == 0 )
+        results << mIds.at( child );
+      else
+        stack.append( qMakePair( child, childLevel ) );
+    }
+  }
+
+  return results.size() - initialSize;
+}
+
+void QgsPackedSpatialIndex::readFeatures( const QgsFeatureIterator &fi, QgsFeedback *feedback, QVector< QgsFeatureId > &ids, QVector< Box > &boxes )
+{
+  QgsFeatureIterator it = fi;
+  QVector< QgsGeometry > geometries;
+  geometries.reserve( BATCH_SIZE );
+
+  // bounding boxes of complex geometries are expensive, compute them in parallel for each batch
+  auto flushBatch = [&]
+  {
+    const int offset = boxes.size();
+    boxes.resize( offset + geometries.size() );
+    Box *batchBoxes = boxes.data() + offset;
+    const QgsGeometry *batchGeometries = geometries.constData();
+    parallelFor( geometries.size(), [batchBoxes, batchGeometries]( int i )
+    {
+      const QgsRectangle rect = batchGeometries[i].boundingBox();
+      batchBoxes[i] = Box { rect.xMinimum(), rect.yMinimum(), rect.xMaximum(), rect.yMaximum() };
+    } );
+    geometries.clear();
+  };
+
+  QgsFeature f;
+  while ( it.nextFeature( f ) )
+  {
+    if ( feedback && feedback->isCanceled() )
+      break;
+
+    if ( !f.hasGeometry() )
+      continue;
+
+    ids << f.id();
+    geometries << f.geometry();
+    if ( geometries.size() == BATCH_SIZE )
+      flushBatch();
+  }
+  flushBatch();
+}
+
+void QgsPackedSpatialIndex::build( QVector< QgsFeatureId > &ids, QVector< Box > &boxes )
+{
+  mIds.clear();
+  mBoxes.clear();
+  mLevelOffsets.clear();
+
+  const int count = ids.size();
+  if ( count == 0 )
+    return;
+
+  Box extent = boxes.at( 0 );
+  for ( const Box &box : qgis::as_const( boxes ) )
+  {
+    extent.xMin = qMin( extent.xMin, box.xMin );
+    extent.yMin = qMin( extent.yMin, box.yMin );
+    extent.xMax = qMax( extent.xMax, box.xMax );
+    extent.yMax = qMax( extent.yMax, box.yMax );
+  }
+
+  // sort keys hold the Hilbert value of the box center in the high bits and the box index in the low bits
+  const double width = extent.xMax - extent.xMin;
+  const double height = extent.yMax - extent.yMin;
+  std::vector< quint64 > keys( count );
+  quint64 *keysData = keys.data();
+  const Box *boxesData = boxes.constData();
+  parallelFor( count, [ = ]( int i )
+  {
+    const Box &box = boxesData[i];
+    const double cx = width > 0 ? ( ( box.xMin + box.xMax ) / 2 - extent.xMin ) / width : 0;
+    const double cy = height > 0 ? ( ( box.yMin + box.yMax ) / 2 - extent.yMin ) / height : 0;
+    const quint32 hx = static_cast< quint32 >( qBound( 0.0, cx, 1.0 ) * 0xFFFF );
+    const quint32 hy = static_cast< quint32 >( qBound( 0.0, cy, 1.0 ) * 0xFFFF );
+    keysData[i] = ( static_cast< quint64 >( hilbert( hx, hy ) ) << 32 ) | static_cast< quint32 >( i );
+  } );
+
+  // sort chunks in parallel, then merge them
+  QVector< QPair< int, int > > ranges = chunkRanges( count, MIN_PARALLEL_CHUNK );
+  QtConcurrent::blockingMap( ranges, [keysData]( const QPair< int, int > &range )
+  {
+    std::sort( keysData + range.first, keysData + range.second );
+  } );
+  for ( int step = 1; step < ranges.size(); step *= 2 )
+  {
+    for ( int i = 0; i + step < ranges.size(); i += 2 * step )
+    {
+      const int last = qMin( i + 2 * step, ranges.size() ) - 1;
+      std::inplace_merge( keysData + ranges.at( i ).first, keysData + ranges.at( i + step ).first, keysData + ranges.at( last ).second );
+    }
+  }
+
+  // total number of boxes over all levels
+  int total = count;
+  for ( int levelCount = count; levelCount > 1; )
+  {
+    levelCount = ( levelCount + NODE_SIZE - 1 ) / NODE_SIZE;
+    total += levelCount;
+  }
+
+  mIds.resize( count );
+  mBoxes.resize( total );
+  Box *nodes = mBoxes.data();
+  QgsFeatureId *sortedIds = mIds.data();
+  const QgsFeatureId *idsData = ids.constData();
+  parallelFor( count, [ = ]( int i )
+  {
+    const int index = static_cast< int >( keysData[i] & 0xFFFFFFFF );
+    sortedIds[i] = idsData[index];
+    nodes[i] = boxesData[index];
+  } );
+  ids.clear();
+  boxes.clear();
+
+  // each level groups the nodes of the level below in full nodes
+  mLevelOffsets << 0;
+  int levelStart = 0;
+  int levelEnd = count;
+  while ( levelEnd - levelStart > 1 )
+  {
+    mLevelOffsets << levelEnd;
+    int parent = levelEnd;
+    for ( int first = levelStart; first < levelEnd; first += NODE_SIZE, ++parent )
+    {
+      Box box = nodes[first];
+      const int last = qMin( first + NODE_SIZE, levelEnd );
+      for ( int child = first + 1; child < last; ++child )
+      {
+        box.xMin = qMin( box.xMin, nodes[child].xMin );
+        box.yMin = qMin( box.yMin, nodes[child].yMin );
+        box.xMax = qMax( box.xMax, nodes[child].xMax );
+        box.yMax = qMax( box.yMax, nodes[child].yMax );
+      }
+      nodes[parent] = box;
+    }
+    levelStart = levelEnd;
+    levelEnd = parent;
+  }
+  mLevelOffsets << levelEnd;
+  Q_ASSERT( levelEnd == total );
+}
@@ -0,0 +1,145 @@
+/***************************************************************************
+  qgspackedspatialindex.h
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPACKEDSPATIALINDEX_H
+#define QGSPACKEDSPATIALINDEX_H
+
+#include "qgis_core.h"
+#include "qgis_sip.h"
+#include "qgsfeature.h"
+#include "qgsrectangle.h"
+
+#include <QList>
+#include <QVector>
+
+class QgsFeedback;
+class QgsFeatureIterator;
+class QgsFeatureSource;
+
+/**
+ * \ingroup core
+ * \class QgsPackedSpatialIndex
+ *
+ * A read-only spatial index for QgsFeature objects, built at once from all the features.
+ *
+ * The index is a packed R-tree: the bounding boxes of features are sorted along a Hilbert curve
+ * and grouped in full nodes, which are stored level by level in flat arrays. Compared to
+ * QgsSpatialIndex, it is faster to build and to query and uses much less memory, but features
+ * cannot be added nor removed once it is built.
+ *
+ * QgsPackedSpatialIndex objects are implicitly shared and can be inexpensively copied. Since they
+ * are never modified, a single index can be queried from multiple threads at once without locking.
+ *
+ * \since QGIS 3.2
+ */
+class CORE_EXPORT QgsPackedSpatialIndex
+{
+  public:
+
+    /**
+     * Constructor for QgsPackedSpatialIndex. Creates an empty index.
+     */
+    QgsPackedSpatialIndex() = default;
+
+    /**
+     * Constructor - builds the index from the features of the iterator. Features without geometry are skipped.
+     *
+     * The optional \a feedback object can be used to allow cancelation of the construction, in which case the
+     * index only contains the features read so far. Ownership of \a feedback is not transferred, and callers
+     * must take care that the lifetime of feedback exceeds that of the spatial index construction.
+     */
+    explicit QgsPackedSpatialIndex( const QgsFeatureIterator &fi, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Constructor - builds the index from the features of the source. Features without geometry are skipped.
+     *
+     * The optional \a feedback object can be used to allow cancelation of the construction, in which case the
+     * index only contains the features read so far. Ownership of \a feedback is not transferred, and callers
+     * must take care that the lifetime of feedback exceeds that of the spatial index construction.
+     */
+    explicit QgsPackedSpatialIndex( const QgsFeatureSource &source, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Constructor - builds the index from the feature \a ids and their matching \a bounds.
+     * Both lists must have the same size.
+     */
+    QgsPackedSpatialIndex( const QList< QgsFeatureId > &ids, const QList< QgsRectangle > &bounds );
+
+    /**
+     * Returns the number of features in the index.
+     */
+    int count() const { return mIds.size(); }
+
+    /**
+     * Returns true if the index does not contain any feature.
+     */
+    bool isEmpty() const { return mIds.isEmpty(); }
+
+    /**
+     * Returns the extent of the bounding boxes of all the features in the index.
+     */
+    QgsRectangle extent() const;
+
+    /**
+     * Returns a list of features with a bounding box which intersects the specified \a rectangle.
+     *
+     * \note The intersection test is performed based on the feature bounding boxes only, so for non-point
+     * geometry features it is necessary to manually test the returned features for exact geometry intersection
+     * when required.
+     */
+    QList< QgsFeatureId > intersects( const QgsRectangle &rectangle ) const;
+
+    /**
+     * Appends the features with a bounding box which intersects the specified \a rectangle to \a results,
+     * which can be reused across queries to avoid allocations.
+     *
+     * \returns the number of features appended
+     * \note not available in Python bindings
+     */
+    int intersects( const QgsRectangle &rectangle, QVector< QgsFeatureId > &results ) const SIP_SKIP;
+
+  private:
+
+    //! Number of children of each node
+    static const int NODE_SIZE = 16;
+
+    //! Number of features whose bounding boxes are computed at once when reading features
+    static const int BATCH_SIZE = 4096;
+
+    //! Bounding box of a feature or node
+    struct Box
+    {
+      double xMin;
+      double yMin;
+      double xMax;
+      double yMax;
+    };
+
+    //! Reads the features of \a fi, computing bounding boxes in parallel
+    void readFeatures( const QgsFeatureIterator &fi, QgsFeedback *feedback, QVector< QgsFeatureId > &ids, QVector< Box > &boxes );
+
+    //! Sorts the features and builds the tree levels
+    void build( QVector< QgsFeatureId > &ids, QVector< Box > &boxes );
+
+    //! Feature ids, in the order of the leaf boxes
+    QVector< QgsFeatureId > mIds;
+
+    //! Boxes of all the nodes, starting with the features, level by level up to the root
+    QVector< Box > mBoxes;
+
+    //! Offset in mBoxes of the first node of each level, followed by the total number of boxes
+    QVector< int > mLevelOffsets;
+};
+
+#endif // QGSPACKEDSPATIALINDEX_H
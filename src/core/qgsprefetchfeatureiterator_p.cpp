@@ -0,0 +1,244 @@
+/***************************************************************************
+  qgsprefetchfeatureiterator_p.cpp
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsprefetchfeatureiterator_p.h"
+#include "qgsfeedback.h"
+
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <memory>
+
+///@cond PRIVATE
+
+class QgsPrefetchFeatureIterator::FetchTask : public QRunnable
+{
+  public:
+
+    explicit FetchTask( QgsPrefetchFeatureIterator *iterator )
+      : mIterator( iterator )
+    {}
+
+    void run() override
+    {
+      mIterator->fetchBatches();
+    }
+
+  private:
+
+    QgsPrefetchFeatureIterator *mIterator = nullptr;
+};
+
+QgsPrefetchFeatureIterator::QgsPrefetchFeatureIterator( const QgsFeatureIterator &iterator )
+  : QgsAbstractFeatureIterator( QgsFeatureRequest() )
+  , mIterator( iterator )
+  , mStopRequested( false )
+{
+  mValid = mIterator.isValid();
+  if ( mValid )
+    mCompileStatus = mIterator.compileStatus();
+}
+
+QgsPrefetchFeatureIterator::~QgsPrefetchFeatureIterator()
+{
+  close();
+}
+
+bool QgsPrefetchFeatureIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  stopFetching();
+
+  mQueue.clear();
+  mFetchedAll = false;
+  mCurrentBatch.clear();
+  mCurrentIndex = 0;
+
+  return mIterator.rewind();
+}
+
+bool QgsPrefetchFeatureIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  stopFetching();
+
+  mQueue.clear();
+  mCurrentBatch.clear();
+  mCurrentIndex = 0;
+
+  mIterator.close();
+
+  mClosed = true;
+  return true;
+}
+
+void QgsPrefetchFeatureIterator::setInterruptionChecker( QgsFeedback *interruptionChecker )
+{
+  // fetching is started again by the next call to fetchFeature()
+  stopFetching();
+  mIterator.setInterruptionChecker( interruptionChecker );
+  mInterruptionChecker = interruptionChecker;
+}
+
+bool QgsPrefetchFeatureIterator::fetchFeature( QgsFeature &f )
+{
+  f.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  if ( mCurrentIndex >= mCurrentBatch.size() )
+  {
+    mCurrentBatch.clear();
+    mCurrentIndex = 0;
+
+    if ( isCanceled() )
+      return false;
+
+    QMutexLocker locker( &mMutex );
+    if ( !mFetchedAll && !mFetching )
+      startFetching();
+
+    if ( mQueue.isEmpty() && !mFetchedAll && !mFetching )
+    {
+      // all the threads of the pool are busy, so the next batch is fetched here
+      locker.unlock();
+      const bool fetchedAll = !fetchBatch( mCurrentBatch );
+      locker.relock();
+      if ( fetchedAll )
+      {
+        mFetchedAll = true;
+        mIteratorValid = mIterator.isValid();
+      }
+    }
+    else
+    {
+      // the rendering thread may be canceled while the provider waits for data
+      while ( mQueue.isEmpty() && !mFetchedAll )
+      {
+        if ( isCanceled() )
+          return false;
+        mBatchQueued.wait( &mMutex, WAIT_INTERVAL );
+      }
+
+      if ( !mQueue.isEmpty() )
+      {
+        mCurrentBatch = mQueue.takeFirst();
+        mBatchTaken.wakeAll();
+      }
+    }
+
+    if ( mCurrentBatch.isEmpty() )
+    {
+      mValid = mIteratorValid;
+      locker.unlock();
+      close();
+      return false;
+    }
+  }
+
+  f = mCurrentBatch.at( mCurrentIndex++ );
+  return true;
+}
+
+bool QgsPrefetchFeatureIterator::startFetching()
+{
+  std::unique_ptr< FetchTask > task( new FetchTask( this ) );
+  mStopRequested = false;
+  // the task is not queued when the pool is busy, as the consumer may itself run on a thread of the
+  // pool and wait for the task forever
+  mFetching = QThreadPool::globalInstance()->tryStart( task.get() );
+  if ( mFetching )
+    task.release();
+  return mFetching;
+}
+
+void QgsPrefetchFeatureIterator::fetchBatches()
+{
+  QgsFeatureList batch;
+  bool fetchedAll = false;
+
+  while ( !fetchedAll )
+  {
+    {
+      QMutexLocker locker( &mMutex );
+      while ( mQueue.size() >= MAX_QUEUED_BATCHES && !mStopRequested )
+        mBatchTaken.wait( &mMutex );
+
+      if ( mStopRequested )
+      {
+        mFetching = false;
+        mBatchQueued.wakeAll();
+        return;
+      }
+    }
+
+    fetchedAll = !fetchBatch( batch );
+
+    QMutexLocker locker( &mMutex );
+    // a partial batch is queued when stopping, so that no feature is lost
+    if ( !batch.isEmpty() )
+    {
+      mQueue << batch;
+      batch.clear();
+    }
+    if ( fetchedAll )
+    {
+      mFetchedAll = true;
+      mIteratorValid = mIterator.isValid();
+    }
+    if ( fetchedAll || mStopRequested )
+    {
+      // nothing may access this iterator after the mutex is released
+      mFetching = false;
+      mBatchQueued.wakeAll();
+      return;
+    }
+    mBatchQueued.wakeAll();
+  }
+}
+
+bool QgsPrefetchFeatureIterator::fetchBatch( QgsFeatureList &batch )
+{
+  QgsFeature f;
+  batch.reserve( BATCH_SIZE );
+  while ( batch.size() < BATCH_SIZE && !mStopRequested )
+  {
+    if ( !mIterator.nextFeature( f ) )
+      return false;
+    batch << f;
+  }
+  return true;
+}
+
+void QgsPrefetchFeatureIterator::stopFetching()
+{
+  QMutexLocker locker( &mMutex );
+  mStopRequested = true;
+  mBatchTaken.wakeAll();
+  while ( mFetching )
+    mBatchQueued.wait( &mMutex );
+  mStopRequested = false;
+}
+
+bool QgsPrefetchFeatureIterator::isCanceled() const
+{
+  return mInterruptionChecker && mInterruptionChecker->isCanceled();
+}
+
+///@endcond
@@ -0,0 +1,124 @@
+/***************************************************************************
+  qgsprefetchfeatureiterator_p.h
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPREFETCHFEATUREITERATOR_P_H
+#define QGSPREFETCHFEATUREITERATOR_P_H
+
+#define SIP_NO_FILE
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgsfeatureiterator.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <atomic>
+
+/**
+ * \ingroup core
+ * Feature iterator fetching the features of another iterator on a thread of the global
+ * thread pool, used for requests with the QgsFeatureRequest::PrefetchFeatures flag.
+ *
+ * Features are fetched in batches into a bounded queue, so that the provider can wait for
+ * the network or the disk and decode the next features while the consumer processes the
+ * previous ones. The wrapped iterator must not depend on the thread which created it, and is
+ * only ever used by one thread at a time: fetching is started by the first call to nextFeature(),
+ * and waited for before the wrapped iterator is rewound, closed or given an interruption checker.
+ * When no thread of the pool is available, the consumer fetches the features itself.
+ *
+ * \since QGIS 3.2
+ */
+class QgsPrefetchFeatureIterator : public QgsAbstractFeatureIterator
+{
+  public:
+
+    /**
+     * Constructor for QgsPrefetchFeatureIterator, fetching the features of \a iterator.
+     * The filters, order and limit of the request are applied by \a iterator.
+     */
+    explicit QgsPrefetchFeatureIterator( const QgsFeatureIterator &iterator );
+    ~QgsPrefetchFeatureIterator() override;
+
+    bool rewind() override;
+    bool close() override;
+    void setInterruptionChecker( QgsFeedback *interruptionChecker ) override;
+
+  protected:
+
+    bool fetchFeature( QgsFeature &f ) override;
+
+  private:
+
+    class FetchTask;
+    friend class FetchTask;
+
+    //! Number of features fetched at once
+    static const int BATCH_SIZE = 512;
+
+    //! Maximum number of batches waiting in the queue
+    static const int MAX_QUEUED_BATCHES = 4;
+
+    //! Interval in milliseconds at which the consumer checks the interruption checker while waiting
+    static const int WAIT_INTERVAL = 100;
+
+    //! Starts fetching on a thread of the global pool, must be called with the mutex locked
+    bool startFetching();
+
+    //! Body of the fetching task
+    void fetchBatches();
+
+    //! Fetches the next features of the wrapped iterator into \a batch, returns false once it has no more features
+    bool fetchBatch( QgsFeatureList &batch );
+
+    //! Stops the fetching task and waits for it, keeping the features fetched so far
+    void stopFetching();
+
+    //! Returns true if the interruption checker was canceled
+    bool isCanceled() const;
+
+    QgsFeatureIterator mIterator;
+    QgsFeedback *mInterruptionChecker = nullptr;
+
+    QMutex mMutex;
+    //! Signaled when a batch is queued or fetching stopped
+    QWaitCondition mBatchQueued;
+    //! Signaled when a batch is taken from the queue or fetching should stop
+    QWaitCondition mBatchTaken;
+    QList< QgsFeatureList > mQueue;
+    //! True while a fetching task is queued or running
+    bool mFetching = false;
+    //! True once the wrapped iterator has no more features
+    bool mFetchedAll = false;
+    //! Validity of the wrapped iterator when the last feature was fetched
+    bool mIteratorValid = true;
+    std::atomic< bool > mStopRequested;
+
+    //! Batch being returned by fetchFeature(), only used by the consumer thread
+    QgsFeatureList mCurrentBatch;
+    int mCurrentIndex = 0;
+};
+
+/// @endcond
+
+#endif // QGSPREFETCHFEATUREITERATOR_P_H
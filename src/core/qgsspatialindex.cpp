@@ -24,9 +24,14 @@
 #include "qgsfeedback.h"
 
 #include "SpatialIndex.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
 #include <QMutex>
 #include <QMutexLocker>
 
+#include <memory>
+
 using namespace SpatialIndex;
 
 
@@ -154,6 +159,68 @@ class QgsFeatureIteratorDataStream : public IDataStream
 };
 
 
+/**
+ * \ingroup core
+ * \class QgsSpatialIndexEntriesDataStream
+ * \brief Utility class for bulk loading R-trees with the entries of another R-tree. Not a part of public API.
+ * \note not available in Python bindings
+*/
+class QgsSpatialIndexEntriesDataStream : public IDataStream, private IVisitor
+{
+  public:
+    //! constructor - reads all the entries of \a index
+    explicit QgsSpatialIndexEntriesDataStream( SpatialIndex::ISpatialIndex *index )
+    {
+      double low[]  = { std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest() };
+      double high[] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+      SpatialIndex::Region query( low, high, 2 );
+      index->intersectsWithQuery( query, *this );
+    }
+
+    IData *getNext() override
+    {
+      if ( mNext >= mEntries.size() )
+        return nullptr;
+
+      const Entry &entry = mEntries.at( mNext++ );
+      return new RTree::Data( 0, nullptr, entry.region, entry.id );
+    }
+
+    bool hasNext() override { return mNext < mEntries.size(); }
+
+    uint32_t size() override { return static_cast< uint32_t >( mEntries.size() ); }
+
+    void rewind() override { mNext = 0; }
+
+  private:
+    void visitNode( const INode &n ) override
+    { Q_UNUSED( n ); }
+
+    void visitData( const IData &d ) override
+    {
+      SpatialIndex::IShape *shape = nullptr;
+      d.getShape( &shape );
+      Entry entry;
+      entry.id = d.getIdentifier();
+      shape->getMBR( entry.region );
+      delete shape;
+      mEntries.push_back( entry );
+    }
+
+    void visitData( std::vector<const IData *> &v ) override
+    { Q_UNUSED( v ); }
+
+    struct Entry
+    {
+      SpatialIndex::id_type id;
+      SpatialIndex::Region region;
+    };
+
+    std::vector< Entry > mEntries;
+    std::size_t mNext = 0;
+};
+
+
 /**
  * \ingroup core
  *  \class QgsSpatialIndexData
@@ -182,6 +249,38 @@ class QgsSpatialIndexData : public QSharedData
       initTree( &fids );
     }
 
+    /**
+     * Constructor for QgsSpatialIndexData which bulk loads features from the specified feature iterator
+     * \a fi into the files at \a path, falling back to memory if the files cannot be created.
+     */
+    QgsSpatialIndexData( const QgsFeatureIterator &fi, const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount, QgsFeedback *feedback )
+    {
+      QgsFeatureIteratorDataStream fids( fi, feedback );
+      if ( !openDiskStorage( path ) )
+      {
+        initTree( &fids );
+        return;
+      }
+
+      mRTree = createTree( *mStorage, &fids );
+      // the files of a partial index must not be loaded again
+      writeHeader( !feedback || !feedback->isCanceled(), sourceTimestamp, sourceFeatureCount );
+    }
+
+    /**
+     * Constructor for QgsSpatialIndexData which bulk loads the entries of \a other into the files at \a path.
+     * Throws a Tools::Exception if the files cannot be written.
+     */
+    QgsSpatialIndexData( const QgsSpatialIndexData &other, const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount )
+    {
+      QgsSpatialIndexEntriesDataStream entries( other.mRTree );
+      if ( !openDiskStorage( path ) )
+        throw Tools::IllegalStateException( "Cannot create spatial index files" );
+
+      mRTree = createTree( *mStorage, &entries );
+      writeHeader( true, sourceTimestamp, sourceFeatureCount );
+    }
+
     QgsSpatialIndexData( const QgsSpatialIndexData &other )
       : QSharedData( other )
     {
@@ -201,41 +300,198 @@ class QgsSpatialIndexData : public QSharedData
     {
       delete mRTree;
       delete mStorage;
+      delete mDiskStorage;
     }
 
     QgsSpatialIndexData &operator=( const QgsSpatialIndexData &rh ) = delete;
 
     void initTree( IDataStream *inputStream = nullptr )
     {
-      // for now only memory manager
       mStorage = StorageManager::createNewMemoryStorageManager();
+      mRTree = createTree( *mStorage, inputStream );
+    }
 
-      // R-Tree parameters
-      double fillFactor = 0.7;
-      unsigned long indexCapacity = 10;
-      unsigned long leafCapacity = 10;
-      unsigned long dimension = 2;
-      RTree::RTreeVariant variant = RTree::RV_RSTAR;
+    /**
+     * Creates new files at \a path for a disk tree, and writes its header with an invalid format,
+     * writeHeader() must be called once the tree is complete.
+     * \returns false if the files cannot be created
+     */
+    bool openDiskStorage( const QString &path )
+    {
+      try
+      {
+        std::string baseName = path.toLocal8Bit().constData();
+        mDiskStorage = StorageManager::createNewDiskStorageManager( baseName, PAGE_SIZE );
+        mStorage = StorageManager::createNewRandomEvictionsBuffer( *mDiskStorage, BUFFER_CAPACITY, false );
+
+        // the header is always the first page of new files
+        id_type headerPage = StorageManager::NewPage;
+        storeHeader( headerPage, false, QDateTime(), 0 );
+        Q_ASSERT( headerPage == HEADER_PAGE );
+        return true;
+      }
+      catch ( Tools::Exception &e )
+      {
+        Q_UNUSED( e );
+        QgsDebugMsg( QString( "Cannot create spatial index files %1: %2" ).arg( path, QString::fromStdString( e.what() ) ) );
+      }
+      catch ( const std::exception &e )
+      {
+        Q_UNUSED( e );
+        QgsDebugMsg( QString( "Cannot create spatial index files %1: %2" ).arg( path, e.what() ) );
+      }
 
-      // create R-tree
-      SpatialIndex::id_type indexId;
+      delete mStorage;
+      mStorage = nullptr;
+      delete mDiskStorage;
+      mDiskStorage = nullptr;
+      return false;
+    }
 
-      if ( inputStream )
-        mRTree = RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, *inputStream, *mStorage, fillFactor, indexCapacity,
-                 leafCapacity, dimension, variant, indexId );
-      else
-        mRTree = RTree::createNewRTree( *mStorage, fillFactor, indexCapacity,
-                                        leafCapacity, dimension, variant, indexId );
+    /**
+     * Opens the R-tree stored in the files at \a path, if they were written for the given source state.
+     * \returns nullptr if the files cannot be read or are stale
+     */
+    static QgsSpatialIndexData *loadDiskTree( const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount )
+    {
+      if ( !QFileInfo::exists( path + QStringLiteral( ".idx" ) ) || !QFileInfo::exists( path + QStringLiteral( ".dat" ) ) )
+        return nullptr;
+
+      std::unique_ptr< QgsSpatialIndexData > data( new QgsSpatialIndexData( NoTree ) );
+      try
+      {
+        std::string baseName = path.toLocal8Bit().constData();
+        data->mDiskStorage = StorageManager::loadDiskStorageManager( baseName );
+        data->mStorage = StorageManager::createNewRandomEvictionsBuffer( *data->mDiskStorage, BUFFER_CAPACITY, false );
+
+        uint32_t length = 0;
+        uint8_t *buffer = nullptr;
+        data->mStorage->loadByteArray( HEADER_PAGE, length, &buffer );
+        QByteArray header( reinterpret_cast< const char * >( buffer ), static_cast< int >( length ) );
+        delete [] buffer;
+
+        QDataStream stream( header );
+        stream.setVersion( QDataStream::Qt_5_0 );
+        quint32 magic = 0, format = 0;
+        qint64 indexId = 0, featureCount = 0;
+        QDateTime timestamp;
+        stream >> magic >> format >> indexId >> timestamp >> featureCount;
+        if ( stream.status() != QDataStream::Ok || magic != HEADER_MAGIC || format != HEADER_FORMAT )
+          return nullptr;
+
+        if ( timestamp != sourceTimestamp || featureCount != sourceFeatureCount )
+        {
+          QgsDebugMsg( QString( "Spatial index %1 is stale" ).arg( path ) );
+          return nullptr;
+        }
+
+        data->mRTree = RTree::loadRTree( *data->mStorage, indexId );
+        return data.release();
+      }
+      catch ( Tools::Exception &e )
+      {
+        Q_UNUSED( e );
+        QgsDebugMsg( QString( "Cannot read spatial index from %1: %2" ).arg( path, QString::fromStdString( e.what() ) ) );
+      }
+      catch ( const std::exception &e )
+      {
+        Q_UNUSED( e );
+        QgsDebugMsg( QString( "Cannot read spatial index from %1: %2" ).arg( path, e.what() ) );
+      }
+      return nullptr;
+    }
+
+    /**
+     * Writes the header of a disk tree and flushes it to the files. If \a valid is true, the
+     * tree can then be loaded again for the given source state.
+     */
+    void writeHeader( bool valid, const QDateTime &sourceTimestamp, long sourceFeatureCount )
+    {
+      id_type headerPage = HEADER_PAGE;
+      storeHeader( headerPage, valid, sourceTimestamp, sourceFeatureCount );
+      mRTree->flush();
+      mStorage->flush();
+      mDiskStorage->flush();
+    }
+
+    /**
+     * Must be called before the R-tree is modified. The header of a disk tree is invalidated,
+     * since the index does not match the state of its source anymore.
+     */
+    void prepareChange()
+    {
+      if ( !mDiskStorage || mChanged )
+        return;
+
+      mChanged = true;
+      writeHeader( false, QDateTime(), 0 );
     }
 
-    //! Storage manager
+    //! Storage manager of disk trees, nullptr for memory trees
+    SpatialIndex::IStorageManager *mDiskStorage = nullptr;
+
+    //! Storage manager, a buffer over mDiskStorage for disk trees
     SpatialIndex::IStorageManager *mStorage = nullptr;
 
     //! R-tree containing spatial index
     SpatialIndex::ISpatialIndex *mRTree = nullptr;
 
+    //! Identifier of the R-tree header in the storage
+    SpatialIndex::id_type mIndexId = 0;
+
+    //! True once a disk tree was modified
+    bool mChanged = false;
+
     mutable QMutex mMutex;
 
+  private:
+
+    //! Page size of disk trees
+    static const uint32_t PAGE_SIZE = 4096;
+
+    //! Number of pages cached in memory for disk trees
+    static const uint32_t BUFFER_CAPACITY = 1024;
+
+    //! Page of disk trees storing the index identifier and source state
+    static const id_type HEADER_PAGE = 0;
+
+    static const quint32 HEADER_MAGIC = 0x51475349; // "QGSI"
+    static const quint32 HEADER_FORMAT = 1;
+
+    enum NoTreeTag { NoTree };
+
+    //! Constructs data without storage nor tree
+    explicit QgsSpatialIndexData( NoTreeTag )
+    {}
+
+    ISpatialIndex *createTree( IStorageManager &storage, IDataStream *inputStream )
+    {
+      // R-Tree parameters
+      double fillFactor = 0.7;
+      unsigned long indexCapacity = 10;
+      unsigned long leafCapacity = 10;
+      unsigned long dimension = 2;
+      RTree::RTreeVariant variant = RTree::RV_RSTAR;
+
+      // bulk loading needs at least one entry
+      if ( inputStream && inputStream->hasNext() )
+        return RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, *inputStream, storage, fillFactor, indexCapacity,
+               leafCapacity, dimension, variant, mIndexId );
+      else
+        return RTree::createNewRTree( storage, fillFactor, indexCapacity,
+                                      leafCapacity, dimension, variant, mIndexId );
+    }
+
+    //! Stores the header of a disk tree to \a page, with an invalid format if \a valid is false
+    void storeHeader( id_type &page, bool valid, const QDateTime &sourceTimestamp, long sourceFeatureCount )
+    {
+      quint32 format = valid ? HEADER_FORMAT : 0;
+      QByteArray header;
+      QDataStream stream( &header, QIODevice::WriteOnly );
+      stream.setVersion( QDataStream::Qt_5_0 );
+      stream << HEADER_MAGIC << format << static_cast< qint64 >( mIndexId ) << sourceTimestamp << static_cast< qint64 >( sourceFeatureCount );
+      mStorage->storeByteArray( page, static_cast< uint32_t >( header.size() ), reinterpret_cast< const uint8_t * >( header.constData() ) );
+    }
 };
 
 // -------------------------------------------------------------------------
@@ -256,6 +512,11 @@ QgsSpatialIndex::QgsSpatialIndex( const QgsFeatureSource &source, QgsFeedback *f
   d = new QgsSpatialIndexData( source.getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) ), feedback );
 }
 
+QgsSpatialIndex::QgsSpatialIndex( const QgsFeatureIterator &fi, const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount, QgsFeedback *feedback )
+{
+  d = new QgsSpatialIndexData( fi, path, sourceTimestamp, sourceFeatureCount, feedback );
+}
+
 QgsSpatialIndex::QgsSpatialIndex( const QgsSpatialIndex &other ) //NOLINT
   : d( other.d )
 {
@@ -272,6 +533,39 @@ QgsSpatialIndex &QgsSpatialIndex::operator=( const QgsSpatialIndex &other )
   return *this;
 }
 
+bool QgsSpatialIndex::save( const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount ) const
+{
+  QMutexLocker locker( &d->mMutex );
+
+  try
+  {
+    QgsSpatialIndexData data( *d, path, sourceTimestamp, sourceFeatureCount );
+    return true;
+  }
+  catch ( Tools::Exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "Tools::Exception caught: %1" ).arg( QString::fromStdString( e.what() ) ) );
+  }
+  catch ( const std::exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "std::exception caught: %1" ).arg( e.what() ) );
+  }
+
+  return false;
+}
+
+bool QgsSpatialIndex::load( const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount )
+{
+  QgsSpatialIndexData *data = QgsSpatialIndexData::loadDiskTree( path, sourceTimestamp, sourceFeatureCount );
+  if ( !data )
+    return false;
+
+  d = data;
+  return true;
+}
+
 SpatialIndex::Region QgsSpatialIndex::rectToRegion( const QgsRectangle &rect )
 {
   double pt1[2] = { rect.xMinimum(), rect.yMinimum() },
@@ -318,6 +612,7 @@ bool QgsSpatialIndex::insertFeature( QgsFeatureId id, const QgsRectangle &rect )
   // TODO: handle possible exceptions correctly
   try
   {
+    d->prepareChange();
     d->mRTree->insertData( 0, nullptr, r, FID_TO_NUMBER( id ) );
     return true;
   }
@@ -348,6 +643,7 @@ bool QgsSpatialIndex::deleteFeature( const QgsFeature &f )
 
   QMutexLocker locker( &d->mMutex );
   // TODO: handle exceptions
+  d->prepareChange();
   return d->mRTree->deleteData( r, FID_TO_NUMBER( id ) );
 }
 
@@ -37,6 +37,7 @@ class QgsFeedback;
 class QgsFeature;
 class QgsRectangle;
 class QgsPointXY;
+class QDateTime;
 
 #include "qgis_core.h"
 #include "qgis_sip.h"
@@ -57,6 +58,9 @@ class QgsFeatureSource;
  *
  * QgsSpatialIndex objects are implicitly shared and can be inexpensively copied.
  *
+ * Indexes can be stored in files, see save() and load(), so that they do not need to be
+ * built again from the features of a source which did not change.
+ *
  * \note While the underlying libspatialindex is not thread safe on some platforms, the QgsSpatialIndex
  * class implements its own locks and accordingly, a single QgsSpatialIndex object can safely
  * be used across multiple threads.
@@ -98,6 +102,23 @@ class CORE_EXPORT QgsSpatialIndex
      */
     explicit QgsSpatialIndex( const QgsFeatureSource &source, QgsFeedback *feedback = nullptr );
 
+    /**
+     * Constructor - creates R-tree and bulk loads it with features from the iterator, like
+     * QgsSpatialIndex( const QgsFeatureIterator &, QgsFeedback * ), but stores the index in files
+     * at \a path instead of memory, so that it can be loaded again by load().
+     *
+     * The index is written to \a path with the ".idx" and ".dat" extensions appended, replacing
+     * any existing files. The \a sourceTimestamp and \a sourceFeatureCount describe the state
+     * of the source of the features (e.g. the modification time of its file and its feature count),
+     * they are checked by load() to detect stale indexes.
+     *
+     * If the files cannot be written, the index is kept in memory. If loading is canceled through
+     * \a feedback, the files are written but cannot be loaded again.
+     *
+     * \since QGIS 3.2
+     */
+    QgsSpatialIndex( const QgsFeatureIterator &fi, const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount, QgsFeedback *feedback = nullptr );
+
     //! Copy constructor
     QgsSpatialIndex( const QgsSpatialIndex &other );
 
@@ -107,6 +128,37 @@ class CORE_EXPORT QgsSpatialIndex
     //! Implement assignment operator
     QgsSpatialIndex &operator=( const QgsSpatialIndex &other );
 
+    /**
+     * Writes the index to files at \a path, with the ".idx" and ".dat" extensions appended,
+     * replacing any existing files. These must not be the files of a loaded index.
+     *
+     * The \a sourceTimestamp and \a sourceFeatureCount describe the state of the source of the
+     * indexed features, they are checked by load() to detect stale indexes.
+     *
+     * \returns true if the index was successfully written
+     * \see load()
+     * \since QGIS 3.2
+     */
+    bool save( const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount ) const;
+
+    /**
+     * Replaces the index with the index stored in files at \a path by save() or the constructor
+     * writing to files.
+     *
+     * The index is only loaded if it was written for the same \a sourceTimestamp and \a sourceFeatureCount,
+     * otherwise it is considered stale and should be built again from the features.
+     *
+     * The loaded index reads its nodes from the files when needed instead of holding them in memory,
+     * and the files must not be modified while it is used. Changes made to the loaded index are
+     * written to the files, which are then considered stale by later calls to load().
+     *
+     * \returns true if the index was loaded, false if the files do not exist, cannot be read or are stale,
+     * in which case the index is left unchanged
+     * \see save()
+     * \since QGIS 3.2
+     */
+    bool load( const QString &path, const QDateTime &sourceTimestamp, long sourceFeatureCount );
+
     /* operations */
 
     /**
@@ -93,6 +93,7 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider, public QgsFeat
       WriteLayerMetadata = 1 << 22, //!< Provider can write layer metadata to the data store. Since QGIS 3.0. See QgsDataProvider::writeLayerMetadata()
       CancelSupport = 1 << 23, //!< Supports interruption of pending queries from a separated thread. Since QGIS 3.2
       CreateRenderer = 1 << 24, //!< Provider can create feature renderers using backend-specific formatting information. Since QGIS 3.2. See QgsVectorDataProvider::createRenderer().
+      ThreadAgnosticFeatureIterators = 1 << 25, //!< Feature iterators of the provider can be used by another thread than the one which created them, so that features can be prefetched. Since QGIS 3.2. See QgsFeatureRequest::PrefetchFeatures
     };
 
     Q_DECLARE_FLAGS( Capabilities, Capability )
@@ -41,10 +41,14 @@
 #include <QTextStream>
 #include <QSet>
 #include <QMetaType>
+#include <QElapsedTimer>
+#include <QtConcurrentMap>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib> // size_t
 #include <limits> // std::numeric_limits
+#include <vector>
 
 #include <ogr_srs_api.h>
 #include <cpl_error.h>
@@ -367,6 +371,26 @@ void QgsVectorFileWriter::init( QString vectorFileName,
   // datasource created, now create the output layer
   OGRwkbGeometryType wkbType = ogrTypeFromWkbType( geometryType );
 
+  // The spatial index of new GeoPackage and SpatiaLite layers is created once all the features
+  // are written, which is much faster than updating it for each inserted feature
+  if ( ( action == CreateOrOverwriteFile || action == CreateOrOverwriteLayer ) && geometryType != QgsWkbTypes::NoGeometry &&
+       ( mOgrDriverName == QLatin1String( "GPKG" ) ||
+         ( mOgrDriverName == QLatin1String( "SQLite" ) && datasourceOptions.contains( QStringLiteral( "SPATIALITE=YES" ), Qt::CaseInsensitive ) ) ) )
+  {
+    bool spatialIndex = true;
+    for ( int i = layerOptions.size() - 1; i >= 0; --i )
+    {
+      const QString option = layerOptions.at( i );
+      if ( option.startsWith( QLatin1String( "SPATIAL_INDEX=" ), Qt::CaseInsensitive ) )
+      {
+        spatialIndex = CPLTestBool( option.mid( option.indexOf( '=' ) + 1 ).toUtf8().constData() );
+        layerOptions.removeAt( i );
+      }
+    }
+    layerOptions.append( QStringLiteral( "SPATIAL_INDEX=NO" ) );
+    mDeferredSpatialIndex = spatialIndex;
+  }
+
   // Remove FEATURE_DATASET layer option (used for ESRI File GDB driver) if its value is not set
   int optIndex = layerOptions.indexOf( QStringLiteral( "FEATURE_DATASET=" ) );
   if ( optIndex != -1 )
@@ -1962,21 +1986,40 @@ bool QgsVectorFileWriter::addFeature( QgsFeature &feature, QgsFeatureSink::Flags
 
 bool QgsVectorFileWriter::addFeatures( QgsFeatureList &features, QgsFeatureSink::Flags )
 {
-  QgsFeatureList::iterator fIt = features.begin();
   bool result = true;
-  for ( ; fIt != features.end(); ++fIt )
+  for ( const QgsFeature &feature : qgis::as_const( features ) )
   {
-    result = result && addFeatureWithStyle( *fIt, nullptr, QgsUnitTypes::DistanceMeters );
+    mFeatureBuffer.append( feature );
+    if ( mFeatureBuffer.count() >= mFeatureBufferSize )
+      result = flushBuffer() && result;
   }
   return result;
 }
 
 bool QgsVectorFileWriter::addFeatureWithStyle( QgsFeature &feature, QgsFeatureRenderer *renderer, QgsUnitTypes::DistanceUnit outputUnit )
 {
+  if ( mSymbologyExport == NoSymbology || !renderer )
+  {
+    mFeatureBuffer.append( feature );
+    if ( mFeatureBuffer.count() >= mFeatureBufferSize )
+      return flushBuffer();
+    return true;
+  }
+
+  // keep features in the order they were added
+  if ( !flushBuffer() )
+    return false;
+
+  QElapsedTimer timer;
+  timer.start();
+
   // create the feature
   gdal::ogr_feature_unique_ptr poFeature = createFeature( feature );
   if ( !poFeature )
+  {
+    ++mFailedFeatureCount;
     return false;
+  }
 
   //add OGR feature style type
   if ( mSymbologyExport != NoSymbology && renderer )
@@ -2018,6 +2061,8 @@ bool QgsVectorFileWriter::addFeatureWithStyle( QgsFeature &feature, QgsFeatureRe
           OGR_F_SetStyleString( poFeature.get(), currentStyle.toLocal8Bit().constData() );
           if ( !writeFeature( mLayer, poFeature.get() ) )
           {
+            ++mFailedFeatureCount;
+            mWriteTime += timer.elapsed();
             return false;
           }
         }
@@ -2026,15 +2071,78 @@ bool QgsVectorFileWriter::addFeatureWithStyle( QgsFeature &feature, QgsFeatureRe
     OGR_F_SetStyleString( poFeature.get(), styleString.toLocal8Bit().constData() );
   }
 
+  bool result = true;
   if ( mSymbologyExport == NoSymbology || mSymbologyExport == FeatureSymbology )
   {
     if ( !writeFeature( mLayer, poFeature.get() ) )
     {
-      return false;
+      ++mFailedFeatureCount;
+      result = false;
     }
   }
 
-  return true;
+  mWriteTime += timer.elapsed();
+  return result;
+}
+
+bool QgsVectorFileWriter::flushBuffer()
+{
+  if ( mFeatureBuffer.isEmpty() )
+    return true;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  QgsLocaleNumC l; // Make sure the decimal delimiter is a dot
+  Q_UNUSED( l );
+
+  struct ConvertedFeature
+  {
+    const QgsFeature *feature;
+    gdal::ogr_feature_unique_ptr ogrFeature;
+    QString errorMessage;
+  };
+
+  std::vector< ConvertedFeature > converted( mFeatureBuffer.size() );
+  for ( int i = 0; i < mFeatureBuffer.size(); ++i )
+    converted[i].feature = &mFeatureBuffer.at( i );
+
+  auto convert = [this]( ConvertedFeature & f )
+  {
+    f.ogrFeature = convertFeature( *f.feature, f.errorMessage );
+  };
+
+  // make sure the layer definition is complete before it is used from several threads
+  OGR_L_GetLayerDefn( mLayer );
+
+  // field value converters are not required to be thread safe, and
+  // a single feature is not worth dispatching to the thread pool
+  if ( mFieldValueConverter || converted.size() == 1 )
+    std::for_each( converted.begin(), converted.end(), convert );
+  else
+    QtConcurrent::blockingMap( converted, convert );
+
+  bool result = true;
+  for ( ConvertedFeature &f : converted )
+  {
+    if ( !f.ogrFeature )
+    {
+      mErrorMessage = f.errorMessage;
+      mError = ErrFeatureWriteFailed;
+      QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+      ++mFailedFeatureCount;
+      result = false;
+    }
+    else if ( !writeFeature( mLayer, f.ogrFeature.get() ) )
+    {
+      ++mFailedFeatureCount;
+      result = false;
+    }
+  }
+
+  mFeatureBuffer.clear();
+  mWriteTime += timer.elapsed();
+  return result;
 }
 
 gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeature &feature )
@@ -2042,6 +2150,19 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
   QgsLocaleNumC l; // Make sure the decimal delimiter is a dot
   Q_UNUSED( l );
 
+  QString errorMessage;
+  gdal::ogr_feature_unique_ptr poFeature = convertFeature( feature, errorMessage );
+  if ( !poFeature )
+  {
+    mErrorMessage = errorMessage;
+    mError = ErrFeatureWriteFailed;
+    QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+  }
+  return poFeature;
+}
+
+gdal::ogr_feature_unique_ptr QgsVectorFileWriter::convertFeature( const QgsFeature &feature, QString &errorMessage )
+{
   gdal::ogr_feature_unique_ptr poFeature( OGR_F_Create( OGR_L_GetLayerDefn( mLayer ) ) );
 
   qint64 fid = FID_TO_NUMBER( feature.id() );
@@ -2147,13 +2268,11 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
       case QVariant::Invalid:
         break;
       default:
-        mErrorMessage = QObject::tr( "Invalid variant type for field %1[%2]: received %3 with type %4" )
-                        .arg( mFields.at( fldIdx ).name() )
-                        .arg( ogrField )
-                        .arg( attrValue.typeName(),
-                              attrValue.toString() );
-        QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
-        mError = ErrFeatureWriteFailed;
+        errorMessage = QObject::tr( "Invalid variant type for field %1[%2]: received %3 with type %4" )
+                       .arg( mFields.at( fldIdx ).name() )
+                       .arg( ogrField )
+                       .arg( attrValue.typeName(),
+                             attrValue.toString() );
         return nullptr;
     }
   }
@@ -2207,10 +2326,8 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
 
         if ( !mGeom2 )
         {
-          mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                          .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-          mError = ErrFeatureWriteFailed;
-          QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+          errorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
+                         .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
           return nullptr;
         }
 
@@ -2218,10 +2335,8 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
         OGRErr err = OGR_G_ImportFromWkb( mGeom2, reinterpret_cast<unsigned char *>( const_cast<char *>( wkb.constData() ) ), wkb.length() );
         if ( err != OGRERR_NONE )
         {
-          mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                          .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-          mError = ErrFeatureWriteFailed;
-          QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+          errorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
+                         .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
           return nullptr;
         }
 
@@ -2235,10 +2350,8 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
         OGRErr err = OGR_G_ImportFromWkb( ogrGeom, reinterpret_cast<unsigned char *>( const_cast<char *>( wkb.constData() ) ), wkb.length() );
         if ( err != OGRERR_NONE )
         {
-          mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                          .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-          mError = ErrFeatureWriteFailed;
-          QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+          errorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
+                         .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
           return nullptr;
         }
 
@@ -2274,11 +2387,51 @@ bool QgsVectorFileWriter::writeFeature( OGRLayerH layer, OGRFeatureH feature )
     QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
     return false;
   }
+
+  ++mWrittenFeatureCount;
+
+  // start a new transaction every mTransactionSize features
+  if ( mUsingTransaction && mTransactionSize > 0 && ++mFeaturesInTransaction >= mTransactionSize )
+  {
+    mFeaturesInTransaction = 0;
+    if ( OGRERR_NONE != OGR_L_CommitTransaction( mLayer ) )
+    {
+      QgsDebugMsg( "Error while committing transaction on OGRLayer." );
+    }
+    if ( OGRERR_NONE != OGR_L_StartTransaction( mLayer ) )
+    {
+      mUsingTransaction = false;
+    }
+  }
   return true;
 }
 
+void QgsVectorFileWriter::createDeferredSpatialIndex()
+{
+  auto quoted = []( QString value )
+  {
+    return QStringLiteral( "'%1'" ).arg( value.replace( '\'', QLatin1String( "''" ) ) );
+  };
+
+  const QString sql = QStringLiteral( "SELECT CreateSpatialIndex(%1, %2)" )
+                      .arg( quoted( QString::fromUtf8( OGR_L_GetName( mLayer ) ) ),
+                            quoted( QString::fromUtf8( OGR_L_GetGeometryColumn( mLayer ) ) ) );
+  CPLErrorReset();
+  OGRLayerH result = OGR_DS_ExecuteSQL( mDS.get(), sql.toUtf8().constData(), nullptr, nullptr );
+  if ( result )
+    OGR_DS_ReleaseResultSet( mDS.get(), result );
+
+  if ( CPLGetLastErrorType() >= CE_Failure )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Spatial index creation failed (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) ), QObject::tr( "OGR" ) );
+  }
+}
+
 QgsVectorFileWriter::~QgsVectorFileWriter()
 {
+  if ( mLayer )
+    flushBuffer();
+
   if ( mUsingTransaction )
   {
     if ( OGRERR_NONE != OGR_L_CommitTransaction( mLayer ) )
@@ -2287,6 +2440,20 @@ QgsVectorFileWriter::~QgsVectorFileWriter()
     }
   }
 
+  if ( mLayer && mDeferredSpatialIndex )
+  {
+    QElapsedTimer timer;
+    timer.start();
+    createDeferredSpatialIndex();
+    QgsDebugMsgLevel( QString( "Spatial index created in %1 ms" ).arg( timer.elapsed() ), 2 );
+  }
+
+  if ( mWriteTime > 0 )
+  {
+    QgsDebugMsgLevel( QString( "Wrote %1 features in %2 ms (%3 features/s)" )
+                      .arg( mWrittenFeatureCount ).arg( mWriteTime ).arg( mWrittenFeatureCount * 1000 / mWriteTime ), 2 );
+  }
+
   mDS.reset();
 
   if ( mOgrRef )
@@ -2584,6 +2751,8 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( Prepa
         options.layerName,
         options.actionOnExistingFile );
   writer->setSymbologyScale( options.symbologyScale );
+  // errors are collected by the final flushBuffer() call below
+  writer->setFeatureBufferSize( 1000 );
 
   if ( newFilename )
   {
@@ -2702,7 +2871,7 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( Prepa
         }
         *errorMessage += '\n' + writer->errorMessage();
       }
-      errors++;
+      errors = static_cast< int >( writer->mFailedFeatureCount );
 
       if ( errors > 1000 )
       {
@@ -2718,6 +2887,20 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( Prepa
     n++;
   }
 
+  // write the features still buffered
+  if ( n >= 0 && !writer->flushBuffer() )
+  {
+    if ( errorMessage )
+    {
+      if ( errorMessage->isEmpty() )
+      {
+        *errorMessage = QObject::tr( "Feature write errors:" );
+      }
+      *errorMessage += '\n' + writer->errorMessage();
+    }
+    errors = static_cast< int >( writer->mFailedFeatureCount );
+  }
+
   writer->stopRender();
 
   if ( errors > 0 && errorMessage && n > 0 )
@@ -612,6 +612,76 @@ class CORE_EXPORT QgsVectorFileWriter : public QgsFeatureSink
      */
     bool addFeatureWithStyle( QgsFeature &feature, QgsFeatureRenderer *renderer, QgsUnitTypes::DistanceUnit outputUnit = QgsUnitTypes::DistanceMeters );
 
+    /**
+     * Writes the features buffered by addFeature() and addFeatures() to the data source.
+     *
+     * Features are only buffered if a buffer size was set with setFeatureBufferSize(). They
+     * are then converted to OGR features in parallel and written in the order they were added.
+     * The buffer is flushed when it is full, when a feature is added with style, and when the
+     * writer is destroyed.
+     *
+     * Errors of buffered features are deferred: addFeature() and addFeatures() return true for
+     * features which are only buffered, and a failure is reported by the call which writes the
+     * feature, through its return value, hasError() and errorMessage(). Errors raised when the
+     * destructor flushes the buffer cannot be reported, so call flushBuffer() once all the
+     * features are added.
+     *
+     * \returns false if some of the buffered features could not be written
+     */
+    bool flushBuffer() override;
+
+    /**
+     * Sets the number of features buffered by addFeature() and addFeatures() before they are
+     * converted and written at once. Buffering speeds up writing many features, but defers
+     * write errors to flushBuffer(). A \a size of 0, the default, writes every feature
+     * as soon as it is added.
+     * \see featureBufferSize()
+     * \since QGIS 3.2
+     */
+    void setFeatureBufferSize( int size ) { mFeatureBufferSize = size; }
+
+    /**
+     * Returns the number of features buffered before they are written, or 0 if features
+     * are written as soon as they are added.
+     * \see setFeatureBufferSize()
+     * \since QGIS 3.2
+     */
+    int featureBufferSize() const { return mFeatureBufferSize; }
+
+    /**
+     * Sets the number of features written in each transaction, for formats supporting
+     * transactions (e.g. GeoPackage or SpatiaLite). Committing every \a size features keeps
+     * the transaction journal bounded when writing many features. A \a size of 0 writes all
+     * the features in a single transaction. Defaults to 100000 features.
+     * \see transactionSize()
+     * \since QGIS 3.2
+     */
+    void setTransactionSize( int size ) { mTransactionSize = size; }
+
+    /**
+     * Returns the number of features written in each transaction, or 0 if all the features are
+     * written in a single transaction.
+     * \see setTransactionSize()
+     * \since QGIS 3.2
+     */
+    int transactionSize() const { return mTransactionSize; }
+
+    /**
+     * Returns the number of features successfully written to the data source so far.
+     * Buffered features are only counted once flushed.
+     * \see writeTime()
+     * \since QGIS 3.2
+     */
+    qint64 writtenFeatureCount() const { return mWrittenFeatureCount; }
+
+    /**
+     * Returns the time spent converting and writing features so far, in milliseconds.
+     * Together with writtenFeatureCount(), it gives the write throughput.
+     * \see writtenFeatureCount()
+     * \since QGIS 3.2
+     */
+    qint64 writeTime() const { return mWriteTime; }
+
     //! \note not available in Python bindings
     QMap<int, int> attrIdxToOgrIdx() { return mAttrIdxToOgrIdx; } SIP_SKIP
 
@@ -788,8 +858,31 @@ class CORE_EXPORT QgsVectorFileWriter : public QgsFeatureSink
 
     bool mUsingTransaction = false;
 
+    QgsFeatureList mFeatureBuffer;
+    int mFeatureBufferSize = 0;
+    int mTransactionSize = 100000;
+    int mFeaturesInTransaction = 0;
+    qint64 mWrittenFeatureCount = 0;
+    qint64 mFailedFeatureCount = 0;
+    qint64 mWriteTime = 0;
+
+    //! True if the spatial index of the new layer is created once all the features are written
+    bool mDeferredSpatialIndex = false;
+
     void createSymbolLayerTable( QgsVectorLayer *vl, const QgsCoordinateTransform &ct, OGRDataSourceH ds );
     gdal::ogr_feature_unique_ptr createFeature( const QgsFeature &feature );
+
+    /**
+     * Converts \a feature to an OGR feature. Unlike createFeature(), this does not change the
+     * state of the writer and can be called from several threads at once, as long as no field
+     * value converter is set and the numeric locale is already set to C.
+     * \returns nullptr and sets \a errorMessage if the feature cannot be converted
+     */
+    gdal::ogr_feature_unique_ptr convertFeature( const QgsFeature &feature, QString &errorMessage );
+
+    //! Creates the spatial index of the layer, once all the features were written
+    void createDeferredSpatialIndex();
+
     bool writeFeature( OGRLayerH layer, OGRFeatureH feature );
 
     //! Writes features considering symbol level order
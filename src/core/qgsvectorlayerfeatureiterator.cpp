@@ -26,11 +26,13 @@
 #include "qgsproject.h"
 #include "qgsmessagelog.h"
 #include "qgsexception.h"
+#include "qgsprefetchfeatureiterator_p.h"
 
 QgsVectorLayerFeatureSource::QgsVectorLayerFeatureSource( const QgsVectorLayer *layer )
 {
   QMutexLocker locker( &layer->mFeatureSourceConstructorMutex );
   mProviderFeatureSource = layer->dataProvider()->featureSource();
+  mCanPrefetchProviderFeatures = layer->dataProvider()->capabilities() & QgsVectorDataProvider::ThreadAgnosticFeatureIterators;
   mFields = layer->fields();
 
   // update layer's join caches if necessary
@@ -255,7 +257,7 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeat
     }
     else
     {
-      mProviderIterator = mSource->mProviderFeatureSource->getFeatures( mProviderRequest );
+      mProviderIterator = providerFeatures();
     }
 
     rewindEditBuffer();
@@ -323,7 +325,7 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature &f )
   if ( mProviderIterator.isClosed() )
   {
     mChangedFeaturesIterator.close();
-    mProviderIterator = mSource->mProviderFeatureSource->getFeatures( mProviderRequest );
+    mProviderIterator = providerFeatures();
     mProviderIterator.setInterruptionChecker( mInterruptionChecker );
   }
 
@@ -788,6 +790,14 @@ bool QgsVectorLayerFeatureIterator::checkGeometryValidity( const QgsFeature &fea
   return true;
 }
 
+QgsFeatureIterator QgsVectorLayerFeatureIterator::providerFeatures()
+{
+  QgsFeatureIterator iterator = mSource->mProviderFeatureSource->getFeatures( mProviderRequest );
+  if ( ( mRequest.flags() & QgsFeatureRequest::PrefetchFeatures ) && mSource->mCanPrefetchProviderFeatures )
+    return QgsFeatureIterator( new QgsPrefetchFeatureIterator( iterator ) );
+  return iterator;
+}
+
 void QgsVectorLayerFeatureIterator::prepareField( int fieldIdx )
 {
   switch ( mSource->mFields.fieldOrigin( fieldIdx ) )
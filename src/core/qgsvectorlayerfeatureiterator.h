@@ -103,6 +103,9 @@ class CORE_EXPORT QgsVectorLayerFeatureSource : public QgsAbstractFeatureSource
     QgsAttributeList mDeletedAttributeIds;
 
     QgsCoordinateReferenceSystem mCrs;
+
+    //! Whether the provider features can be prefetched on a background thread
+    bool mCanPrefetchProviderFeatures = false;
 };
 
 /**
@@ -277,6 +280,12 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
      * Checks a feature's geometry for validity, if requested in feature request.
      */
     bool checkGeometryValidity( const QgsFeature &feature );
+
+    /**
+     * Returns a new iterator over the provider features, prefetching them on a background
+     * thread if requested and supported by the provider.
+     */
+    QgsFeatureIterator providerFeatures();
 };
 
 
@@ -144,6 +144,8 @@ bool QgsVectorLayerRenderer::render()
                                      .setFilterRect( requestExtent )
                                      .setSubsetOfAttributes( mAttrNames, mFields )
                                      .setExpressionContext( mContext.expressionContext() );
+  // overlap fetching features from the provider with drawing them, for providers which support it
+  featureRequest.setFlags( featureRequest.flags() | QgsFeatureRequest::PrefetchFeatures );
   if ( mRenderer->orderByEnabled() )
   {
     featureRequest.setOrderBy( mRenderer->orderBy() );
@@ -251,6 +253,18 @@ bool QgsVectorLayerRenderer::render()
     mRenderer->paintEffect()->end( mContext );
   }
 
+  // all the labels of the layer are registered, their candidates are generated while other layers are rendered
+  if ( QgsLabelingEngine *engine2 = mContext.labelingEngine() )
+  {
+    if ( !mContext.renderingStopped() )
+    {
+      if ( mLabelProvider )
+        engine2->prepareProvider( mLabelProvider, mContext );
+      if ( mDiagramProvider )
+        engine2->prepareProvider( mDiagramProvider, mContext );
+    }
+  }
+
   return true;
 }
 
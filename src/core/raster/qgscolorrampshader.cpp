@@ -28,8 +28,36 @@ originally part of the larger QgsRasterLayer class
 #include "qgscolorrampshader.h"
 #include "qgsrasterinterface.h"
 #include "qgsrasterminmaxorigin.h"
+#include "qgsrasterblock.h"
 
 #include <cmath>
+#include <algorithm>
+#include <limits>
+
+///@cond PRIVATE
+namespace
+{
+  //! Minimum number of values shaded at once to build the colors of all the values of 16 bit data types
+  const qgssize MIN_VALUE_COLORS_COUNT = 65536;
+
+  //! Sets the colors of a span of values of type T from \a block, returned by \a shadeValue, or transparent for no data
+  template <typename T, typename ShadeFunction>
+  void shadeValues( QgsRasterBlock *block, qgssize offset, qgssize count, QRgb *output, ShadeFunction shadeValue )
+  {
+    const T *values = reinterpret_cast< const T * >( block->bits( offset ) );
+    if ( !block->hasNoData() )
+    {
+      for ( qgssize i = 0; i < count; ++i )
+        output[i] = shadeValue( values[i] );
+      return;
+    }
+
+    for ( qgssize i = 0; i < count; ++i )
+      output[i] = block->isNoData( offset + i ) ? qRgba( 0, 0, 0, 0 ) : shadeValue( values[i] );
+  }
+}
+///@endcond
+
 QgsColorRampShader::QgsColorRampShader( double minimumValue, double maximumValue, QgsColorRamp *colorRamp, Type type, ClassificationMode classificationMode )
   : QgsRasterShaderFunction( minimumValue, maximumValue )
   , mColorRampType( type )
@@ -48,6 +76,7 @@ QgsColorRampShader::QgsColorRampShader( const QgsColorRampShader &other )
   , mLUTOffset( other.mLUTOffset )
   , mLUTFactor( other.mLUTFactor )
   , mLUTInitialized( other.mLUTInitialized )
+  , mItemColors( other.mItemColors )
   , mClip( other.mClip )
 {
   mSourceColorRamp.reset( other.sourceColorRamp()->clone() );
@@ -62,7 +91,9 @@ QgsColorRampShader &QgsColorRampShader::operator=( const QgsColorRampShader &oth
   mLUTOffset = other.mLUTOffset;
   mLUTFactor = other.mLUTFactor;
   mLUTInitialized = other.mLUTInitialized;
+  mItemColors = other.mItemColors;
   mClip = other.mClip;
+  resetValueColors();
   return *this;
 }
 
@@ -86,11 +117,13 @@ void QgsColorRampShader::setColorRampItemList( const QList<QgsColorRampShader::C
   // Reset the look up table when the color ramp is changed
   mLUTInitialized = false;
   mLUT.clear();
+  resetValueColors();
 }
 
 void QgsColorRampShader::setColorRampType( QgsColorRampShader::Type colorRampType )
 {
   mColorRampType = colorRampType;
+  resetValueColors();
 }
 
 void QgsColorRampShader::setColorRampType( const QString &type )
@@ -107,6 +140,7 @@ void QgsColorRampShader::setColorRampType( const QString &type )
   {
     mColorRampType = Exact;
   }
+  resetValueColors();
 }
 
 QgsColorRamp *QgsColorRampShader::sourceColorRamp() const
@@ -303,52 +337,61 @@ void QgsColorRampShader::classifyColorRamp( const int band, const QgsRectangle &
   classifyColorRamp( colorRampItemList().count(), band, extent, input );
 }
 
-bool QgsColorRampShader::shade( double value, int *returnRedValue, int *returnGreenValue, int *returnBlueValue, int *returnAlphaValue )
+void QgsColorRampShader::initLUT()
 {
-  if ( mColorRampItemList.isEmpty() )
-  {
-    return false;
-  }
-  if ( std::isnan( value ) || std::isinf( value ) )
-    return false;
-
   int colorRampItemListCount = mColorRampItemList.count();
   int idx;
-  if ( !mLUTInitialized )
+
+  // calculate LUT for faster index recovery
+  mLUTFactor = 1.0;
+  double minimumValue = mColorRampItemList.first().value;
+  mLUTOffset = minimumValue + DOUBLE_DIFF_THRESHOLD;
+  // Only make lut if at least 3 items, with 2 items the low and high cases handle both
+  if ( colorRampItemListCount >= 3 )
   {
-    // calculate LUT for faster index recovery
-    mLUTFactor = 1.0;
-    double minimumValue = mColorRampItemList.first().value;
-    mLUTOffset = minimumValue + DOUBLE_DIFF_THRESHOLD;
-    // Only make lut if at least 3 items, with 2 items the low and high cases handle both
-    if ( colorRampItemListCount >= 3 )
+    double rangeValue = mColorRampItemList.at( colorRampItemListCount - 2 ).value - minimumValue;
+    if ( rangeValue > 0 )
     {
-      double rangeValue = mColorRampItemList.at( colorRampItemListCount - 2 ).value - minimumValue;
-      if ( rangeValue > 0 )
+      int lutSize = 256; // TODO: test if speed can be increased with a different LUT size
+      mLUTFactor = ( lutSize - 0.0000001 ) / rangeValue; // decrease slightly to make sure last LUT category is correct
+      idx = 0;
+      double val;
+      mLUT.reserve( lutSize );
+      for ( int i = 0; i < lutSize; i++ )
       {
-        int lutSize = 256; // TODO: test if speed can be increased with a different LUT size
-        mLUTFactor = ( lutSize - 0.0000001 ) / rangeValue; // decrease slightly to make sure last LUT category is correct
-        idx = 0;
-        double val;
-        mLUT.reserve( lutSize );
-        for ( int i = 0; i < lutSize; i++ )
+        val = ( i / mLUTFactor ) + mLUTOffset;
+        while ( idx < colorRampItemListCount
+                && mColorRampItemList.at( idx ).value - DOUBLE_DIFF_THRESHOLD < val )
         {
-          val = ( i / mLUTFactor ) + mLUTOffset;
-          while ( idx < colorRampItemListCount
-                  && mColorRampItemList.at( idx ).value - DOUBLE_DIFF_THRESHOLD < val )
-          {
-            idx++;
-          }
-          mLUT.push_back( idx );
+          idx++;
         }
+        mLUT.push_back( idx );
       }
     }
-    mLUTInitialized = true;
   }
 
+  mItemColors.clear();
+  mItemColors.reserve( colorRampItemListCount );
+  for ( const QgsColorRampShader::ColorRampItem &item : qgis::as_const( mColorRampItemList ) )
+  {
+    const int red = item.color.red();
+    const int green = item.color.green();
+    const int blue = item.color.blue();
+    const int alpha = item.color.alpha();
+    mItemColors << ItemColor { red, green, blue, alpha, premultipliedColor( red, green, blue, alpha ) };
+  }
+
+  mLUTInitialized = true;
+}
+
+int QgsColorRampShader::colorRampItemIndex( double value, bool &overflow ) const
+{
+  int colorRampItemListCount = mColorRampItemList.count();
+  int idx;
+
   // overflow indicates that value > maximum value + DOUBLE_DIFF_THRESHOLD
   // that way idx can point to the last valid item
-  bool overflow = false;
+  overflow = false;
 
   // find index of the first ColorRampItem that is equal or higher to theValue
   int lutIndex = ( value - mLUTOffset ) * mLUTFactor;
@@ -382,6 +425,26 @@ bool QgsColorRampShader::shade( double value, int *returnRedValue, int *returnGr
     }
   }
 
+  return idx;
+}
+
+bool QgsColorRampShader::shade( double value, int *returnRedValue, int *returnGreenValue, int *returnBlueValue, int *returnAlphaValue )
+{
+  if ( mColorRampItemList.isEmpty() )
+  {
+    return false;
+  }
+  if ( std::isnan( value ) || std::isinf( value ) )
+    return false;
+
+  if ( !mLUTInitialized )
+  {
+    initLUT();
+  }
+
+  bool overflow = false;
+  const int idx = colorRampItemIndex( value, overflow );
+
   const QgsColorRampShader::ColorRampItem &currentColorRampItem = mColorRampItemList.at( idx );
 
   if ( colorRampType() == Interpolated )
@@ -446,6 +509,133 @@ bool QgsColorRampShader::shade( double value, int *returnRedValue, int *returnGr
   }
 }
 
+void QgsColorRampShader::shadeBlock( QgsRasterBlock *block, qgssize offset, qgssize count, QRgb *output )
+{
+  if ( mColorRampItemList.isEmpty() )
+  {
+    std::fill( output, output + count, qRgba( 0, 0, 0, 0 ) );
+    return;
+  }
+
+  if ( !mLUTInitialized )
+  {
+    initLUT();
+  }
+
+  switch ( block->dataType() )
+  {
+    case Qgis::Byte:
+    {
+      const QRgb *colors = valueColors( Qgis::Byte, std::numeric_limits< quint8 >::min(), std::numeric_limits< quint8 >::max() );
+      shadeValues< quint8 >( block, offset, count, output, [colors]( quint8 value ) { return colors[value]; } );
+      return;
+    }
+    case Qgis::UInt16:
+      if ( count >= MIN_VALUE_COLORS_COUNT || mValueColorsDataType == Qgis::UInt16 )
+      {
+        const QRgb *colors = valueColors( Qgis::UInt16, std::numeric_limits< quint16 >::min(), std::numeric_limits< quint16 >::max() );
+        shadeValues< quint16 >( block, offset, count, output, [colors]( quint16 value ) { return colors[value]; } );
+      }
+      else
+      {
+        shadeValues< quint16 >( block, offset, count, output, [this]( quint16 value ) { return shadeColor( value ); } );
+      }
+      return;
+    case Qgis::Int16:
+      if ( count >= MIN_VALUE_COLORS_COUNT || mValueColorsDataType == Qgis::Int16 )
+      {
+        const QRgb *colors = valueColors( Qgis::Int16, std::numeric_limits< qint16 >::min(), std::numeric_limits< qint16 >::max() );
+        shadeValues< qint16 >( block, offset, count, output, [colors]( qint16 value ) { return colors[value - std::numeric_limits< qint16 >::min()]; } );
+      }
+      else
+      {
+        shadeValues< qint16 >( block, offset, count, output, [this]( qint16 value ) { return shadeColor( value ); } );
+      }
+      return;
+    case Qgis::UInt32:
+      shadeValues< quint32 >( block, offset, count, output, [this]( quint32 value ) { return shadeColor( value ); } );
+      return;
+    case Qgis::Int32:
+      shadeValues< qint32 >( block, offset, count, output, [this]( qint32 value ) { return shadeColor( value ); } );
+      return;
+    case Qgis::Float32:
+      shadeValues< float >( block, offset, count, output, [this]( float value ) { return shadeColor( value ); } );
+      return;
+    case Qgis::Float64:
+      shadeValues< double >( block, offset, count, output, [this]( double value ) { return shadeColor( value ); } );
+      return;
+    default:
+      break;
+  }
+
+  QgsRasterShaderFunction::shadeBlock( block, offset, count, output );
+}
+
+QRgb QgsColorRampShader::shadeColor( double value ) const
+{
+  if ( std::isnan( value ) || std::isinf( value ) )
+    return qRgba( 0, 0, 0, 0 );
+
+  bool overflow = false;
+  const int idx = colorRampItemIndex( value, overflow );
+  const double currentValue = mColorRampItemList.at( idx ).value;
+  const ItemColor &currentColor = mItemColors.at( idx );
+
+  // same rules as shade()
+  switch ( mColorRampType )
+  {
+    case Interpolated:
+    {
+      if ( idx < 1 || overflow || currentValue - DOUBLE_DIFF_THRESHOLD <= value )
+      {
+        if ( mClip && ( overflow || currentValue - DOUBLE_DIFF_THRESHOLD > value ) )
+          return qRgba( 0, 0, 0, 0 );
+        return currentColor.color;
+      }
+
+      const double previousValue = mColorRampItemList.at( idx - 1 ).value;
+      const ItemColor &previousColor = mItemColors.at( idx - 1 );
+      const double scale = ( value - previousValue ) / ( currentValue - previousValue );
+      return premultipliedColor( static_cast< int >( previousColor.red + ( currentColor.red - previousColor.red ) * scale ),
+                                 static_cast< int >( previousColor.green + ( currentColor.green - previousColor.green ) * scale ),
+                                 static_cast< int >( previousColor.blue + ( currentColor.blue - previousColor.blue ) * scale ),
+                                 static_cast< int >( previousColor.alpha + ( currentColor.alpha - previousColor.alpha ) * scale ) );
+    }
+    case Discrete:
+      return overflow ? qRgba( 0, 0, 0, 0 ) : currentColor.color;
+    case Exact:
+      return !overflow && currentValue - DOUBLE_DIFF_THRESHOLD <= value ? currentColor.color : qRgba( 0, 0, 0, 0 );
+  }
+  return qRgba( 0, 0, 0, 0 );
+}
+
+const QRgb *QgsColorRampShader::valueColors( Qgis::DataType dataType, int minimum, int maximum )
+{
+  if ( mValueColorsDataType != dataType )
+  {
+    mValueColors.resize( maximum - minimum + 1 );
+    QRgb *colors = mValueColors.data();
+    for ( int value = minimum; value <= maximum; ++value )
+    {
+      colors[value - minimum] = shadeColor( value );
+    }
+    mValueColorsDataType = dataType;
+  }
+  return mValueColors.constData();
+}
+
+void QgsColorRampShader::resetValueColors()
+{
+  mValueColors.clear();
+  mValueColorsDataType = Qgis::UnknownDataType;
+}
+
+void QgsColorRampShader::setClip( bool clip )
+{
+  mClip = clip;
+  resetValueColors();
+}
+
 bool QgsColorRampShader::shade( double redValue, double greenValue,
                                 double blueValue, double alphaValue,
                                 int *returnRedValue, int *returnGreenValue,
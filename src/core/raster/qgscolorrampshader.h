@@ -159,6 +159,15 @@ class CORE_EXPORT QgsColorRampShader : public QgsRasterShaderFunction
                 int *returnRedValue SIP_OUT, int *returnGreenValue SIP_OUT,
                 int *returnBlueValue SIP_OUT, int *returnAlphaValue SIP_OUT ) override;
 
+    /**
+     * Shades a span of values of a raster \a block. Colors of Byte blocks, and of Int16 and UInt16 blocks
+     * with enough values, are looked up in a table of the colors of all the values of the data type, built
+     * when first needed. Other values are shaded without the overhead of per value virtual calls.
+     * \note not available in Python bindings
+     * \since QGIS 3.2
+     */
+    void shadeBlock( QgsRasterBlock *block, qgssize offset, qgssize count, QRgb *output ) override SIP_SKIP;
+
     //! \brief Get symbology items if provided by renderer
     void legendSymbologyItems( QList< QPair< QString, QColor > > &symbolItems SIP_OUT ) const override;
 
@@ -173,7 +182,7 @@ class CORE_EXPORT QgsColorRampShader : public QgsRasterShaderFunction
      * \param clip set to true to clip values which are out of range.
      * \see clip()
      */
-    void setClip( bool clip ) { mClip = clip; }
+    void setClip( bool clip );
 
     /**
      * Returns whether the shader will clip values which are out of range.
@@ -207,8 +216,46 @@ class CORE_EXPORT QgsColorRampShader : public QgsRasterShaderFunction
     double mLUTFactor = 1.0;
     bool mLUTInitialized = false;
 
+    //! Color ramp item colors, cached with the look up table
+    struct ItemColor
+    {
+      int red;
+      int green;
+      int blue;
+      int alpha;
+      //! Premultiplied color
+      QRgb color;
+    };
+    QVector<ItemColor> mItemColors;
+
+    /**
+     * Premultiplied colors of all the values of an integer data type, used by shadeBlock().
+     * It is built on the first call to shadeBlock() for a block of this data type.
+     */
+    QVector<QRgb> mValueColors;
+    Qgis::DataType mValueColorsDataType = Qgis::UnknownDataType;
+
     //! Do not render values out of range
     bool mClip = false;
+
+    //! Initializes the look up table and the item colors
+    void initLUT();
+
+    /**
+     * Returns the index of the first color ramp item equal or higher to \a value, or the index of
+     * the last item with \a overflow set to true if value is higher than the maximum value.
+     * The look up table must have been initialized.
+     */
+    int colorRampItemIndex( double value, bool &overflow ) const;
+
+    //! Returns the premultiplied color of \a value, or a transparent color if it cannot be shaded
+    QRgb shadeColor( double value ) const;
+
+    //! Returns the colors of the values from \a minimum to \a maximum of the integer \a dataType, building them if needed
+    const QRgb *valueColors( Qgis::DataType dataType, int minimum, int maximum );
+
+    //! Clears the colors of values after the items or the way they are shaded changed
+    void resetValueColors();
 };
 
 #endif
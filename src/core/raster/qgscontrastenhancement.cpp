@@ -29,6 +29,30 @@ class originally created circa 2004 by T.Sutton, Gary E.Sherman, Steve Halasz
 #include <QDomDocument>
 #include <QDomElement>
 
+///@cond PRIVATE
+namespace
+{
+  //! Minimum number of values enhanced at once to build the block lookup table of 16 bit data types
+  const qgssize MIN_BLOCK_LOOKUP_TABLE_COUNT = 65536;
+
+  //! Looks up a span of values of type T from \a block in \a table, indexed by value, and sets no data to -1
+  template <typename T>
+  void lookupValues( QgsRasterBlock *block, qgssize offset, qgssize count, const int *table, int *output )
+  {
+    const T *values = reinterpret_cast< const T * >( block->bits( offset ) );
+    if ( !block->hasNoData() )
+    {
+      for ( qgssize i = 0; i < count; ++i )
+        output[i] = table[ values[i] ];
+      return;
+    }
+
+    for ( qgssize i = 0; i < count; ++i )
+      output[i] = block->isNoData( offset + i ) ? -1 : table[ values[i] ];
+  }
+}
+///@endcond
+
 QgsContrastEnhancement::QgsContrastEnhancement( Qgis::DataType dataType )
   : mRasterDataType( dataType )
 {
@@ -178,6 +202,58 @@ int QgsContrastEnhancement::enhanceContrast( double value )
   }
 }
 
+void QgsContrastEnhancement::enhanceContrastBlock( QgsRasterBlock *block, qgssize offset, qgssize count, int *output )
+{
+  const Qgis::DataType dataType = block->dataType();
+  const bool hasLookupTable = dataType == mRasterDataType
+                              && ( dataType == Qgis::Byte || dataType == Qgis::UInt16 || dataType == Qgis::Int16 );
+  // building the table for 16 bit data types is only worth it for large blocks
+  if ( !hasLookupTable || ( dataType != Qgis::Byte && mBlockLookupTableDirty && count < MIN_BLOCK_LOOKUP_TABLE_COUNT ) )
+  {
+    const bool hasNoData = block->hasNoData();
+    for ( qgssize i = 0; i < count; ++i )
+    {
+      const qgssize index = offset + i;
+      const double value = block->value( index );
+      if ( ( hasNoData && block->isNoData( index ) ) || !isValueInDisplayableRange( value ) )
+      {
+        output[i] = -1;
+        continue;
+      }
+      output[i] = enhanceContrast( value );
+    }
+    return;
+  }
+
+  if ( mBlockLookupTableDirty )
+  {
+    QgsDebugMsgLevel( "building block lookup table", 4 );
+    mBlockLookupTable.resize( static_cast< int >( mRasterDataTypeRange ) + 1 );
+    for ( int i = 0; i < mBlockLookupTable.size(); ++i )
+    {
+      const double value = static_cast< double >( i ) - mLookupTableOffset;
+      mBlockLookupTable[i] = isValueInDisplayableRange( value ) ? enhanceContrast( value ) : -1;
+    }
+    mBlockLookupTableDirty = false;
+  }
+
+  const int tableOffset = static_cast< int >( mLookupTableOffset );
+  switch ( dataType )
+  {
+    case Qgis::Byte:
+      lookupValues< quint8 >( block, offset, count, mBlockLookupTable.constData() + tableOffset, output );
+      break;
+    case Qgis::UInt16:
+      lookupValues< quint16 >( block, offset, count, mBlockLookupTable.constData() + tableOffset, output );
+      break;
+    case Qgis::Int16:
+      lookupValues< qint16 >( block, offset, count, mBlockLookupTable.constData() + tableOffset, output );
+      break;
+    default:
+      break;
+  }
+}
+
 bool QgsContrastEnhancement::generateLookupTable()
 {
   mEnhancementDirty = false;
@@ -237,6 +313,7 @@ void QgsContrastEnhancement::setContrastEnhancementAlgorithm( ContrastEnhancemen
   }
 
   mEnhancementDirty = true;
+  mBlockLookupTableDirty = true;
   mContrastEnhancementAlgorithm = algorithm;
 
   if ( generateTable )
@@ -253,6 +330,7 @@ void QgsContrastEnhancement::setContrastEnhancementFunction( QgsContrastEnhancem
   {
     mContrastEnhancementFunction.reset( function );
     mContrastEnhancementAlgorithm = UserDefinedEnhancement;
+    mBlockLookupTableDirty = true;
     generateLookupTable();
   }
 }
@@ -276,6 +354,7 @@ void QgsContrastEnhancement::setMaximumValue( double value, bool generateTable )
   }
 
   mEnhancementDirty = true;
+  mBlockLookupTableDirty = true;
 
   if ( generateTable )
   {
@@ -302,6 +381,7 @@ void QgsContrastEnhancement::setMinimumValue( double value, bool generateTable )
   }
 
   mEnhancementDirty = true;
+  mBlockLookupTableDirty = true;
 
   if ( generateTable )
   {
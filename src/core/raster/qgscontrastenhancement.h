@@ -26,9 +26,11 @@ class originally created circa 2004 by T.Sutton, Gary E.Sherman, Steve Halasz
 
 #include "qgis.h"
 #include "qgsraster.h"
+#include <QVector>
 #include <memory>
 
 class QgsContrastEnhancementFunction;
+class QgsRasterBlock;
 class QDomDocument;
 class QDomElement;
 class QString;
@@ -116,6 +118,20 @@ class CORE_EXPORT QgsContrastEnhancement
      */
     bool isValueInDisplayableRange( double value );
 
+    /**
+     * Applies the contrast enhancement to \a count values of a raster \a block, starting at the pixel
+     * index \a offset, and stores the results in the \a output buffer. Return values are 0 - 255, -1 means
+     * the pixel is no data or was clipped (i.e. isValueInDisplayableRange() returned false) and should not
+     * be displayed.
+     *
+     * For Byte, UInt16 and Int16 blocks of the data type of the contrast enhancement, the results are looked
+     * up in a table holding the results of all the values of the data type.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.2
+     */
+    void enhanceContrastBlock( QgsRasterBlock *block, qgssize offset, qgssize count, int *output ) SIP_SKIP;
+
     /**
      * Sets the contrast enhancement \a algorithm.
      *
@@ -179,6 +195,15 @@ class CORE_EXPORT QgsContrastEnhancement
     //! \brief Pointer to the lookup table
     int *mLookupTable = nullptr;
 
+    /**
+     * Results of enhanceContrastBlock() for all the values of the data type, -1 for clipped values.
+     * It is built on the first call to enhanceContrastBlock() after the enhancement changed.
+     */
+    QVector<int> mBlockLookupTable;
+
+    //! \brief Flag indicating if the block lookup table needs to be regenerated
+    bool mBlockLookupTableDirty = true;
+
     //! \brief User defineable minimum value for the band, used for enhanceContrasting
     double mMinimumValue;
 
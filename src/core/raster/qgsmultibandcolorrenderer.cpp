@@ -24,6 +24,40 @@
 #include <QImage>
 #include <QSet>
 
+///@cond PRIVATE
+namespace
+{
+  //! Stretches the values of a band \a block with \a contrastEnhancement, if both are set
+  void enhanceBand( QgsRasterBlock *block, QgsContrastEnhancement *contrastEnhancement, qgssize count, QVector< int > &values )
+  {
+    if ( !block || !contrastEnhancement )
+      return;
+
+    values.resize( static_cast< int >( count ) );
+    contrastEnhancement->enhanceContrastBlock( block, 0, count, values.data() );
+  }
+
+  /**
+   * Reads in \a value the value at \a index of a band \a block, or its stretched value if the band
+   * has stretched \a values. Returns false if the value is no data or clipped. Unset bands are 0.
+   */
+  bool bandValue( QgsRasterBlock *block, const QVector< int > &values, qgssize index, double &value )
+  {
+    if ( !block )
+      return true;
+
+    if ( !values.isEmpty() )
+    {
+      value = values.constData()[index];
+      return value >= 0;
+    }
+
+    value = block->value( index );
+    return !block->isNoData( index );
+  }
+}
+///@endcond
+
 QgsMultiBandColorRenderer::QgsMultiBandColorRenderer( QgsRasterInterface *input, int redBand, int greenBand, int blueBand,
     QgsContrastEnhancement *redEnhancement,
     QgsContrastEnhancement *greenEnhancement,
@@ -225,9 +259,22 @@ QgsRasterBlock *QgsMultiBandColorRenderer::block( int bandNo, QgsRectangle  cons
     return outputBlock.release();
   }
 
+  const qgssize count = ( qgssize )width * height;
+
+  // stretch each band at once, no data and clipped values are set to -1
+  QVector< int > redValues;
+  QVector< int > greenValues;
+  QVector< int > blueValues;
+  if ( !fastDraw )
+  {
+    enhanceBand( redBlock, mRedContrastEnhancement, count, redValues );
+    enhanceBand( greenBlock, mGreenContrastEnhancement, count, greenValues );
+    enhanceBand( blueBlock, mBlueContrastEnhancement, count, blueValues );
+  }
+
   QRgb myDefaultColor = NODATA_COLOR;
 
-  for ( qgssize i = 0; i < ( qgssize )width * height; i++ )
+  for ( qgssize i = 0; i < count; i++ )
   {
     if ( fastDraw ) //fast rendering if no transparency, stretching, color inversion, etc.
     {
@@ -247,54 +294,17 @@ QgsRasterBlock *QgsMultiBandColorRenderer::block( int bandNo, QgsRectangle  cons
       continue;
     }
 
-    bool isNoData = false;
     double redVal = 0;
     double greenVal = 0;
     double blueVal = 0;
-    if ( mRedBand > 0 )
-    {
-      redVal = redBlock->value( i );
-      if ( redBlock->isNoData( i ) ) isNoData = true;
-    }
-    if ( !isNoData && mGreenBand > 0 )
-    {
-      greenVal = greenBlock->value( i );
-      if ( greenBlock->isNoData( i ) ) isNoData = true;
-    }
-    if ( !isNoData && mBlueBand > 0 )
-    {
-      blueVal = blueBlock->value( i );
-      if ( blueBlock->isNoData( i ) ) isNoData = true;
-    }
-    if ( isNoData )
+    if ( !bandValue( redBlock, redValues, i, redVal )
+         || !bandValue( greenBlock, greenValues, i, greenVal )
+         || !bandValue( blueBlock, blueValues, i, blueVal ) )
     {
       outputBlock->setColor( i, myDefaultColor );
       continue;
     }
 
-    //apply default color if red, green or blue not in displayable range
-    if ( ( mRedContrastEnhancement && !mRedContrastEnhancement->isValueInDisplayableRange( redVal ) )
-         || ( mGreenContrastEnhancement && !mGreenContrastEnhancement->isValueInDisplayableRange( redVal ) )
-         || ( mBlueContrastEnhancement && !mBlueContrastEnhancement->isValueInDisplayableRange( redVal ) ) )
-    {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
-
-    //stretch color values
-    if ( mRedContrastEnhancement )
-    {
-      redVal = mRedContrastEnhancement->enhanceContrast( redVal );
-    }
-    if ( mGreenContrastEnhancement )
-    {
-      greenVal = mGreenContrastEnhancement->enhanceContrast( greenVal );
-    }
-    if ( mBlueContrastEnhancement )
-    {
-      blueVal = mBlueContrastEnhancement->enhanceContrast( blueVal );
-    }
-
     //opacity
     double currentOpacity = mOpacity;
     if ( mRasterTransparency )
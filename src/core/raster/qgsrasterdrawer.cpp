@@ -19,13 +19,158 @@
 #include "qgsrasterblock.h"
 #include "qgsrasterdrawer.h"
 #include "qgsrasterinterface.h"
+#include "qgsrasterresamplefilter.h"
 #include "qgsrasteriterator.h"
 #include "qgsrasterviewport.h"
 #include "qgsmaptopixel.h"
 #include "qgsrendercontext.h"
 #include <QImage>
+#include <QMutex>
 #include <QPainter>
 #include <QPrinter>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+///@cond PRIVATE
+namespace
+{
+  //! Minimum number of rows of the parts of a viewport rendered in parallel
+  const int MIN_PARALLEL_PART_ROWS = 256;
+
+  /**
+   * Number of rows read beyond the borders of a part and cropped after rendering it, so that
+   * renderers using the neighbours of each pixel, such as hillshades, render the rows along the
+   * borders as if the viewport was rendered at once
+   */
+  const int PARALLEL_PART_OVERLAP_ROWS = 2;
+
+  //! Part of a viewport
+  struct RasterPart
+  {
+    int columns = 0;
+    int rows = 0;
+    int topLeftColumn = 0;
+    int topLeftRow = 0;
+    QgsRectangle extent;
+    //! Number of rows read above the part
+    int overlapTop = 0;
+    //! Number of rows read below the part
+    int overlapBottom = 0;
+  };
+
+  //! Copy of the interfaces of a raster pipe, up to the last one, which can be used on another thread
+  class RasterInterfaceChain
+  {
+    public:
+      explicit RasterInterfaceChain( const QgsRasterInterface *last )
+      {
+        QList< const QgsRasterInterface * > interfaces;
+        for ( const QgsRasterInterface *ri = last; ri; ri = ri->input() )
+        {
+          interfaces.prepend( ri );
+        }
+
+        for ( const QgsRasterInterface *ri : qgis::as_const( interfaces ) )
+        {
+          std::unique_ptr< QgsRasterInterface > clone( ri->clone() );
+          if ( !clone || ( !mInterfaces.empty() && !clone->setInput( mInterfaces.back().get() ) ) )
+          {
+            mInterfaces.clear();
+            return;
+          }
+          mInterfaces.push_back( std::move( clone ) );
+        }
+      }
+
+      //! Returns the copy of the last interface, or nullptr if an interface could not be copied
+      QgsRasterInterface *last() const { return mInterfaces.empty() ? nullptr : mInterfaces.back().get(); }
+
+    private:
+      std::vector< std::unique_ptr< QgsRasterInterface > > mInterfaces;
+  };
+
+  //! State shared by the threads rendering the parts of a viewport, protected by its mutex
+  struct ParallelRenderState
+  {
+    QVector< RasterPart > parts;
+    //! Images of the parts rendered but not drawn yet
+    QVector< QImage > images;
+    QVector< bool > rendered;
+    int nextPart = 0;
+    int runningTasks = 0;
+    QgsRasterBlockFeedback *feedback = nullptr;
+    QMutex mutex;
+    //! Signaled when a part was rendered or a task finished
+    QWaitCondition changed;
+
+    //! Returns the index of the next part to render, or -1 if all parts are being rendered
+    int claimPart()
+    {
+      return nextPart < parts.size() ? nextPart++ : -1;
+    }
+
+    //! Renders the part \a index with the last interface of a pipe, can be called without locking
+    QImage renderPart( QgsRasterInterface *input, int index ) const
+    {
+      if ( feedback && feedback->isCanceled() )
+        return QImage();
+
+      const RasterPart &part = parts.at( index );
+      const double rowHeight = part.extent.height() / part.rows;
+      const QgsRectangle extent( part.extent.xMinimum(), part.extent.yMinimum() - part.overlapBottom * rowHeight,
+                                 part.extent.xMaximum(), part.extent.yMaximum() + part.overlapTop * rowHeight );
+      std::unique_ptr< QgsRasterBlock > block( input->block( 1, extent, part.columns, part.overlapTop + part.rows + part.overlapBottom, feedback ) );
+      if ( !block )
+      {
+        QgsDebugMsg( "Cannot get block" );
+        return QImage();
+      }
+      const QImage image = block->image();
+      return part.overlapTop || part.overlapBottom ? image.copy( 0, part.overlapTop, part.columns, part.rows ) : image;
+    }
+
+    void setRendered( int index, const QImage &image )
+    {
+      images[ index ] = image;
+      rendered[ index ] = true;
+      changed.wakeAll();
+    }
+  };
+
+  //! Renders parts of a viewport on a thread of the global thread pool, with its own copy of the pipe
+  class ParallelRenderTask : public QRunnable
+  {
+    public:
+      ParallelRenderTask( ParallelRenderState &state, std::unique_ptr< RasterInterfaceChain > chain )
+        : mState( state )
+        , mChain( std::move( chain ) )
+      {}
+
+      void run() override
+      {
+        QMutexLocker locker( &mState.mutex );
+        for ( int index = mState.claimPart(); index >= 0; index = mState.claimPart() )
+        {
+          locker.unlock();
+          QImage image = mState.renderPart( mChain->last(), index );
+          locker.relock();
+          mState.setRendered( index, image );
+        }
+        mState.runningTasks--;
+        mState.changed.wakeAll();
+      }
+
+    private:
+      ParallelRenderState &mState;
+      std::unique_ptr< RasterInterfaceChain > mChain;
+  };
+}
+///@endcond
 
 QgsRasterDrawer::QgsRasterDrawer( QgsRasterIterator *iterator ): mIterator( iterator )
 {
@@ -39,6 +184,11 @@ void QgsRasterDrawer::draw( QPainter *p, QgsRasterViewPort *viewPort, const QgsM
     return;
   }
 
+  if ( drawInParallel( p, viewPort, qgsMapToPixel, feedback ) )
+  {
+    return;
+  }
+
   // last pipe filter has only 1 band
   int bandNumber = 1;
   mIterator->startRasterRead( bandNumber, viewPort->mWidth, viewPort->mHeight, viewPort->mDrawnExtent, feedback );
@@ -64,54 +214,185 @@ void QgsRasterDrawer::draw( QPainter *p, QgsRasterViewPort *viewPort, const QgsM
       continue;
     }
 
-    QImage img = block->image();
+    drawPart( p, viewPort, block->image(), topLeftCol, topLeftRow, qgsMapToPixel, feedback );
 
-#ifndef QT_NO_PRINTER
-    // Because of bug in Acrobat Reader we must use "white" transparent color instead
-    // of "black" for PDF. See #9101.
-    QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
-    if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
+    delete block;
+
+    // OK this does not matter much anyway as the tile size quite big so most of the time
+    // there would be just one tile for the whole display area, but it won't hurt...
+    if ( feedback && feedback->isCanceled() )
+      break;
+  }
+}
+
+bool QgsRasterDrawer::drawInParallel( QPainter *p, QgsRasterViewPort *viewPort, const QgsMapToPixel *qgsMapToPixel, QgsRasterBlockFeedback *feedback )
+{
+  // previews are drawn with the pipe of the layer renderer while data is still being fetched
+  const int threadCount = QThreadPool::globalInstance()->maxThreadCount();
+  if ( threadCount < 2 || ( feedback && feedback->renderPartialOutput() ) || viewPort->mHeight < 2 * MIN_PARALLEL_PART_ROWS )
+  {
+    return false;
+  }
+
+  // remote providers are not read concurrently, they would only issue more requests at once to the same server
+  const QgsRasterInterface *source = mIterator->input() ? mIterator->input()->sourceInput() : nullptr;
+  if ( !source || !( source->capabilities() & QgsRasterInterface::ParallelReads ) )
+  {
+    return false;
+  }
+
+  // resampled pixels depend on source pixels farther from the strips than their overlap when zoomed in
+  for ( const QgsRasterInterface *ri = mIterator->input(); ri; ri = ri->input() )
+  {
+    const QgsRasterResampleFilter *resampleFilter = dynamic_cast< const QgsRasterResampleFilter * >( ri );
+    if ( resampleFilter && ( resampleFilter->zoomedInResampler() || resampleFilter->zoomedOutResampler() ) )
+    {
+      return false;
+    }
+  }
+
+  // split the viewport in strips, so that each thread can render at least one of them
+  const int partRows = std::max( MIN_PARALLEL_PART_ROWS, ( viewPort->mHeight + threadCount - 1 ) / threadCount );
+  if ( partRows < mIterator->maximumTileHeight() )
+  {
+    mIterator->setMaximumTileHeight( partRows );
+  }
+
+  ParallelRenderState state;
+  state.feedback = feedback;
+
+  int bandNumber = 1;
+  mIterator->startRasterRead( bandNumber, viewPort->mWidth, viewPort->mHeight, viewPort->mDrawnExtent, feedback );
+  RasterPart part;
+  while ( mIterator->next( bandNumber, part.columns, part.rows, part.topLeftColumn, part.topLeftRow, part.extent ) )
+  {
+    part.overlapTop = std::min( PARALLEL_PART_OVERLAP_ROWS, part.topLeftRow );
+    part.overlapBottom = std::min( PARALLEL_PART_OVERLAP_ROWS, viewPort->mHeight - part.topLeftRow - part.rows );
+    state.parts << part;
+  }
+  mIterator->stopRasterRead( bandNumber );
+
+  const int partCount = state.parts.size();
+  if ( partCount < 2 )
+  {
+    return false;
+  }
+
+  // the calling thread renders parts too, so that all parts get rendered even if no other thread is idle
+  RasterInterfaceChain chain( mIterator->input() );
+  if ( !chain.last() )
+  {
+    return false;
+  }
+
+  state.images.resize( partCount );
+  state.rendered.fill( false, partCount );
+
+  // only start tasks on idle threads: waiting for queued tasks could dead lock
+  // when all the threads of the pool are busy rendering other layers
+  for ( int i = 1; i < std::min( threadCount, partCount ); ++i )
+  {
+    std::unique_ptr< RasterInterfaceChain > workerChain = qgis::make_unique< RasterInterfaceChain >( mIterator->input() );
+    if ( !workerChain->last() )
+    {
+      break;
+    }
+
+    ParallelRenderTask *task = new ParallelRenderTask( state, std::move( workerChain ) );
+    state.mutex.lock();
+    state.runningTasks++;
+    state.mutex.unlock();
+    if ( !QThreadPool::globalInstance()->tryStart( task ) )
     {
-      QgsDebugMsgLevel( "PdfFormat", 4 );
+      delete task;
+      state.mutex.lock();
+      state.runningTasks--;
+      state.mutex.unlock();
+      break;
+    }
+  }
 
-      img = img.convertToFormat( QImage::Format_ARGB32 );
-      QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
-      QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
-      for ( int x = 0; x < img.width(); x++ )
+  // draw the parts in order as soon as they are rendered, rendering the next ones meanwhile
+  QMutexLocker locker( &state.mutex );
+  int drawnParts = 0;
+  while ( drawnParts < partCount )
+  {
+    if ( state.rendered.at( drawnParts ) )
+    {
+      const RasterPart &drawnPart = state.parts.at( drawnParts );
+      QImage image = state.images.at( drawnParts );
+      state.images[ drawnParts ] = QImage();
+      locker.unlock();
+      if ( !image.isNull() )
       {
-        for ( int y = 0; y < img.height(); y++ )
-        {
-          if ( img.pixel( x, y ) == transparentBlack )
-          {
-            img.setPixel( x, y, transparentWhite );
-          }
-        }
+        drawPart( p, viewPort, image, drawnPart.topLeftColumn, drawnPart.topLeftRow, qgsMapToPixel, feedback );
       }
+      locker.relock();
+      drawnParts++;
+      continue;
     }
-#endif
 
-    if ( feedback && feedback->renderPartialOutput() )
+    const int index = state.claimPart();
+    if ( index >= 0 )
     {
-      // there could have been partial preview written before
-      // so overwrite anything with the resulting image.
-      // (we are guaranteed to have a temporary image for this layer, see QgsMapRendererJob::needTemporaryImage)
-      p->setCompositionMode( QPainter::CompositionMode_Source );
+      locker.unlock();
+      QImage image = state.renderPart( chain.last(), index );
+      locker.relock();
+      state.setRendered( index, image );
+      continue;
     }
 
-    drawImage( p, viewPort, img, topLeftCol, topLeftRow, qgsMapToPixel );
+    state.changed.wait( &state.mutex );
+  }
 
-    delete block;
+  while ( state.runningTasks > 0 )
+  {
+    state.changed.wait( &state.mutex );
+  }
+
+  return true;
+}
+
+void QgsRasterDrawer::drawPart( QPainter *p, QgsRasterViewPort *viewPort, QImage img, int topLeftCol, int topLeftRow, const QgsMapToPixel *qgsMapToPixel, QgsRasterBlockFeedback *feedback ) const
+{
+#ifndef QT_NO_PRINTER
+  // Because of bug in Acrobat Reader we must use "white" transparent color instead
+  // of "black" for PDF. See #9101.
+  QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
+  if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
+  {
+    QgsDebugMsgLevel( "PdfFormat", 4 );
 
-    if ( feedback && feedback->renderPartialOutput() )
+    img = img.convertToFormat( QImage::Format_ARGB32 );
+    QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
+    QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
+    for ( int x = 0; x < img.width(); x++ )
     {
-      // go back to the default composition mode
-      p->setCompositionMode( QPainter::CompositionMode_SourceOver );
+      for ( int y = 0; y < img.height(); y++ )
+      {
+        if ( img.pixel( x, y ) == transparentBlack )
+        {
+          img.setPixel( x, y, transparentWhite );
+        }
+      }
     }
+  }
+#endif
 
-    // OK this does not matter much anyway as the tile size quite big so most of the time
-    // there would be just one tile for the whole display area, but it won't hurt...
-    if ( feedback && feedback->isCanceled() )
-      break;
+  if ( feedback && feedback->renderPartialOutput() )
+  {
+    // there could have been partial preview written before
+    // so overwrite anything with the resulting image.
+    // (we are guaranteed to have a temporary image for this layer, see QgsMapRendererJob::needTemporaryImage)
+    p->setCompositionMode( QPainter::CompositionMode_Source );
+  }
+
+  drawImage( p, viewPort, img, topLeftCol, topLeftRow, qgsMapToPixel );
+
+  if ( feedback && feedback->renderPartialOutput() )
+  {
+    // go back to the default composition mode
+    p->setCompositionMode( QPainter::CompositionMode_SourceOver );
   }
 }
 
@@ -33,6 +33,12 @@ class QgsRasterIterator;
 /**
  * \ingroup core
  * The drawing pipe for raster layers.
+ *
+ * Large viewports of providers with the ParallelReads capability are split in strips which are
+ * rendered concurrently on idle threads of the global thread pool, each thread using its own copy
+ * of the raster pipe, and drawn in order. The strips are read with a couple of overlapping rows,
+ * so that renderers using neighbouring pixels render them seamlessly. Pipes resampling their input
+ * are always drawn sequentially.
  */
 class CORE_EXPORT QgsRasterDrawer
 {
@@ -64,6 +70,15 @@ class CORE_EXPORT QgsRasterDrawer
 
   private:
     QgsRasterIterator *mIterator = nullptr;
+
+    /**
+     * Renders the parts of the viewport on several threads and draws them in order.
+     * \returns false if the viewport is not worth rendering in parallel, in which case nothing was drawn
+     */
+    bool drawInParallel( QPainter *p, QgsRasterViewPort *viewPort, const QgsMapToPixel *qgsMapToPixel, QgsRasterBlockFeedback *feedback );
+
+    //! Draws the image of a raster part, as returned by the last interface of the pipe
+    void drawPart( QPainter *p, QgsRasterViewPort *viewPort, QImage img, int topLeftCol, int topLeftRow, const QgsMapToPixel *qgsMapToPixel, QgsRasterBlockFeedback *feedback ) const;
 };
 
 #endif // QGSRASTERDRAWER_H
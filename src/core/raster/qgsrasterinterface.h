@@ -173,6 +173,7 @@ class CORE_EXPORT QgsRasterInterface
       IdentifyText     = 1 << 7, // WMS text
       IdentifyHtml     = 1 << 8, // WMS HTML
       IdentifyFeature  = 1 << 9, // WMS GML -> feature
+      ParallelReads    = 1 << 10, // blocks may be read concurrently by clones of the provider, which is worth it for local data but not for remote services. Since QGIS 3.2
     };
 
     QgsRasterInterface( QgsRasterInterface *input = nullptr );
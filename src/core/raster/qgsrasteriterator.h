@@ -16,6 +16,7 @@
 #define QGSRASTERITERATOR_H
 
 #include "qgis_core.h"
+#include "qgis_sip.h"
 #include "qgsrectangle.h"
 #include <QMap>
 
@@ -61,6 +62,21 @@ class CORE_EXPORT QgsRasterIterator
                              QgsRasterBlock **block,
                              int &topLeftCol, int &topLeftRow );
 
+    /**
+     * Fetches details of the next part of raster data, without reading the data itself. This
+     * allows callers to read the parts themselves, e.g. from other threads with their own copy
+     * of the input interfaces.
+     * \param bandNumber band to read
+     * \param nCols number of columns on output device
+     * \param nRows number of rows on output device
+     * \param topLeftCol top left column
+     * \param topLeftRow top left row
+     * \param blockExtent extent of the part
+     * \returns false if the last part was already returned
+     * \since QGIS 3.2
+     */
+    bool next( int bandNumber, int &nCols SIP_OUT, int &nRows SIP_OUT, int &topLeftCol SIP_OUT, int &topLeftRow SIP_OUT, QgsRectangle &blockExtent SIP_OUT );
+
     void stopRasterRead( int bandNumber );
 
     const QgsRasterInterface *input() const { return mInput; }
@@ -23,6 +23,42 @@
 #include "qgsexception.h"
 
 
+/// @cond PRIVATE
+
+/**
+ * Source cell indexes of the cells of a destination block, with everything they were calculated from:
+ * the CRSes and datum transforms, the precision, the source extent and size and the destination extent and size.
+ */
+struct QgsRasterProjector::ProjectionGrid
+{
+  QgsCoordinateReferenceSystem srcCrs;
+  QgsCoordinateReferenceSystem destCrs;
+  int srcDatumTransform = -1;
+  int destDatumTransform = -1;
+  QgsRasterProjector::Precision precision = QgsRasterProjector::Approximate;
+
+  //! Extent and size of the source provider, sizes are 0 if the provider does not know its size
+  QgsRectangle sourceExtent;
+  int sourceXSize = 0;
+  int sourceYSize = 0;
+
+  QgsRectangle extent;
+  int width = 0;
+  int height = 0;
+
+  QgsRectangle srcExtent;
+  int srcRows = 0;
+  int srcCols = 0;
+
+  //! Index in the source block of each destination cell, -1 for cells outside of the source
+  QVector< int > srcIndexes;
+};
+
+/// @endcond
+
+QList< std::shared_ptr< const QgsRasterProjector::ProjectionGrid > > QgsRasterProjector::sGrids;
+QMutex QgsRasterProjector::sGridsMutex;
+
 QgsRasterProjector::QgsRasterProjector()
   : QgsRasterInterface( nullptr )
 {
@@ -422,54 +458,28 @@ void ProjectorData::nextHelper()
   mHelperTopRow++;
 }
 
-bool ProjectorData::srcRowCol( int destRow, int destCol, int *srcRow, int *srcCol )
+void ProjectorData::srcRowCols( int destRow, int *srcRows, int *srcCols )
 {
   if ( mApproximate )
   {
-    return approximateSrcRowCol( destRow, destCol, srcRow, srcCol );
+    approximateSrcRowCols( destRow, srcRows, srcCols );
   }
   else
   {
-    return preciseSrcRowCol( destRow, destCol, srcRow, srcCol );
+    preciseSrcRowCols( destRow, srcRows, srcCols );
   }
 }
 
-bool ProjectorData::preciseSrcRowCol( int destRow, int destCol, int *srcRow, int *srcCol )
+inline bool ProjectorData::srcRowColForPoint( double x, double y, int *srcRow, int *srcCol ) const
 {
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QString( "theDestRow = %1" ).arg( destRow ), 5 );
-  QgsDebugMsgLevel( QString( "theDestRow = %1 mDestExtent.yMaximum() = %2 mDestYRes = %3" ).arg( destRow ).arg( mDestExtent.yMaximum() ).arg( mDestYRes ), 5 );
-#endif
-
-  // Get coordinate of center of destination cell
-  double x = mDestExtent.xMinimum() + ( destCol + 0.5 ) * mDestXRes;
-  double y = mDestExtent.yMaximum() - ( destRow + 0.5 ) * mDestYRes;
-  double z = 0;
-
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QString( "x = %1 y = %2" ).arg( x ).arg( y ), 5 );
-#endif
-
-  if ( mInverseCt.isValid() )
-  {
-    mInverseCt.transformInPlace( x, y, z );
-  }
-
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QString( "x = %1 y = %2" ).arg( x ).arg( y ), 5 );
-#endif
-
   if ( !mExtent.contains( QgsPointXY( x, y ) ) )
   {
     return false;
   }
-  // Get source row col
+
+  // TODO: check again cell selection (coor is in the middle)
   *srcRow = static_cast< int >( std::floor( ( mSrcExtent.yMaximum() - y ) / mSrcYRes ) );
   *srcCol = static_cast< int >( std::floor( ( x - mSrcExtent.xMinimum() ) / mSrcXRes ) );
-#ifdef QGISDEBUG
-  QgsDebugMsgLevel( QString( "mSrcExtent.yMinimum() = %1 mSrcExtent.yMaximum() = %2 mSrcYRes = %3" ).arg( mSrcExtent.yMinimum() ).arg( mSrcExtent.yMaximum() ).arg( mSrcYRes ), 5 );
-  QgsDebugMsgLevel( QString( "theSrcRow = %1 srcCol = %2" ).arg( *srcRow ).arg( *srcCol ), 5 );
-#endif
 
   // With epsg 32661 (Polar Stereographic) it was happening that *srcCol == mSrcCols
   // For now silently correct limits to avoid crashes
@@ -483,10 +493,58 @@ bool ProjectorData::preciseSrcRowCol( int destRow, int destCol, int *srcRow, int
   return true;
 }
 
-bool ProjectorData::approximateSrcRowCol( int destRow, int destCol, int *srcRow, int *srcCol )
+void ProjectorData::preciseSrcRowCols( int destRow, int *srcRows, int *srcCols )
+{
+  // Get coordinates of centers of destination cells
+  QVector< double > x( mDestCols );
+  QVector< double > y( mDestCols, mDestExtent.yMaximum() - ( destRow + 0.5 ) * mDestYRes );
+  QVector< double > z( mDestCols, 0.0 );
+  for ( int i = 0; i < mDestCols; ++i )
+  {
+    x[i] = mDestExtent.xMinimum() + ( i + 0.5 ) * mDestXRes;
+  }
+
+  // Transform the whole row at once, proj is much faster with arrays of points
+  QVector< bool > valid( mDestCols, true );
+  if ( mInverseCt.isValid() )
+  {
+    try
+    {
+      mInverseCt.transformCoords( mDestCols, x.data(), y.data(), z.data() );
+    }
+    catch ( QgsCsException & )
+    {
+      // Some of the points cannot be transformed, transform them one by one to find which ones
+      for ( int i = 0; i < mDestCols; ++i )
+      {
+        x[i] = mDestExtent.xMinimum() + ( i + 0.5 ) * mDestXRes;
+        y[i] = mDestExtent.yMaximum() - ( destRow + 0.5 ) * mDestYRes;
+        z[i] = 0.0;
+        try
+        {
+          mInverseCt.transformInPlace( x[i], y[i], z[i] );
+        }
+        catch ( QgsCsException & )
+        {
+          valid[i] = false;
+        }
+      }
+    }
+  }
+
+  for ( int i = 0; i < mDestCols; ++i )
+  {
+    if ( !valid.at( i ) || !srcRowColForPoint( x.at( i ), y.at( i ), srcRows + i, srcCols + i ) )
+    {
+      srcRows[i] = -1;
+      srcCols[i] = -1;
+    }
+  }
+}
+
+void ProjectorData::approximateSrcRowCols( int destRow, int *srcRows, int *srcCols )
 {
   int myMatrixRow = matrixRow( destRow );
-  int myMatrixCol = matrixCol( destCol );
 
   if ( myMatrixRow > mHelperTopRow )
   {
@@ -497,47 +555,31 @@ bool ProjectorData::approximateSrcRowCol( int destRow, int destCol, int *srcRow,
   double myDestY = mDestExtent.yMaximum() - ( destRow + 0.5 ) * mDestYRes;
 
   // See the schema in javax.media.jai.WarpGrid doc (but up side down)
-  // TODO: use some kind of cache of values which can be reused
-  double myDestXMin, myDestYMin, myDestXMax, myDestYMax;
+  // The interpolation factor between the helper rows is the same for all the cells of the row
+  double myDestX, myDestYMin, myDestYMax;
 
-  destPointOnCPMatrix( myMatrixRow + 1, myMatrixCol, &myDestXMin, &myDestYMin );
-  destPointOnCPMatrix( myMatrixRow, myMatrixCol + 1, &myDestXMax, &myDestYMax );
+  destPointOnCPMatrix( myMatrixRow + 1, 0, &myDestX, &myDestYMin );
+  destPointOnCPMatrix( myMatrixRow, 0, &myDestX, &myDestYMax );
 
   double yfrac = ( myDestY - myDestYMin ) / ( myDestYMax - myDestYMin );
 
-  QgsPointXY &myTop = pHelperTop[destCol];
-  QgsPointXY &myBot = pHelperBottom[destCol];
-
-  // Warning: this is very SLOW compared to the following code!:
-  //double mySrcX = myBot.x() + (myTop.x() - myBot.x()) * yfrac;
-  //double mySrcY = myBot.y() + (myTop.y() - myBot.y()) * yfrac;
-
-  double tx = myTop.x();
-  double ty = myTop.y();
-  double bx = myBot.x();
-  double by = myBot.y();
-  double mySrcX = bx + ( tx - bx ) * yfrac;
-  double mySrcY = by + ( ty - by ) * yfrac;
-
-  if ( !mExtent.contains( QgsPointXY( mySrcX, mySrcY ) ) )
+  const QgsPointXY *top = pHelperTop;
+  const QgsPointXY *bot = pHelperBottom;
+  for ( int i = 0; i < mDestCols; ++i )
   {
-    return false;
+    double tx = top[i].x();
+    double ty = top[i].y();
+    double bx = bot[i].x();
+    double by = bot[i].y();
+    double mySrcX = bx + ( tx - bx ) * yfrac;
+    double mySrcY = by + ( ty - by ) * yfrac;
+
+    if ( !srcRowColForPoint( mySrcX, mySrcY, srcRows + i, srcCols + i ) )
+    {
+      srcRows[i] = -1;
+      srcCols[i] = -1;
+    }
   }
-
-  // TODO: check again cell selection (coor is in the middle)
-
-  *srcRow = static_cast< int >( std::floor( ( mSrcExtent.yMaximum() - mySrcY ) / mSrcYRes ) );
-  *srcCol = static_cast< int >( std::floor( ( mySrcX - mSrcExtent.xMinimum() ) / mSrcXRes ) );
-
-  // For now silently correct limits to avoid crashes
-  // TODO: review
-  // should not happen
-  if ( *srcRow >= mSrcRows ) return false;
-  if ( *srcRow < 0 ) return false;
-  if ( *srcCol >= mSrcCols ) return false;
-  if ( *srcCol < 0 ) return false;
-
-  return true;
 }
 
 void ProjectorData::insertRows( const QgsCoordinateTransform &ct )
@@ -753,21 +795,13 @@ QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &exte
     return mInput->block( bandNo, extent, width, height, feedback );
   }
 
-  QgsCoordinateTransform inverseCt( mDestCRS, mSrcCRS, mDestDatumTransform, mSrcDatumTransform );
-
-  ProjectorData pd( extent, width, height, mInput, inverseCt, mPrecision );
-
-  QgsDebugMsgLevel( QString( "srcExtent:\n%1" ).arg( pd.srcExtent().toString() ), 4 );
-  QgsDebugMsgLevel( QString( "srcCols = %1 srcRows = %2" ).arg( pd.srcCols() ).arg( pd.srcRows() ), 4 );
-
-  // If we zoom out too much, projector srcRows / srcCols maybe 0, which can cause problems in providers
-  if ( pd.srcRows() <= 0 || pd.srcCols() <= 0 )
+  std::shared_ptr< const ProjectionGrid > grid = projectionGrid( extent, width, height, feedback );
+  if ( !grid )
   {
-    QgsDebugMsgLevel( "Zero srcRows or srcCols", 4 );
     return new QgsRasterBlock();
   }
 
-  std::unique_ptr< QgsRasterBlock > inputBlock( mInput->block( bandNo, pd.srcExtent(), pd.srcCols(), pd.srcRows(), feedback ) );
+  std::unique_ptr< QgsRasterBlock > inputBlock( mInput->block( bandNo, grid->srcExtent, grid->srcCols, grid->srcRows, feedback ) );
   if ( !inputBlock || inputBlock->isEmpty() )
   {
     QgsDebugMsg( "No raster data!" );
@@ -804,36 +838,34 @@ QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &exte
 
   outputBlock->setIsNoData();
 
-  int srcRow, srcCol;
+  const int *srcIndexes = grid->srcIndexes.constData();
   for ( int i = 0; i < height; ++i )
   {
     if ( feedback && feedback->isCanceled() )
       break;
     for ( int j = 0; j < width; ++j )
     {
-      bool inside = pd.srcRowCol( i, j, &srcRow, &srcCol );
-      if ( !inside ) continue; // we have everything set to no data
-
-      qgssize srcIndex = static_cast< qgssize >( srcRow ) * pd.srcCols() + srcCol;
+      qgssize destIndex = static_cast< qgssize >( i ) * width + j;
+      int srcIndex = srcIndexes[destIndex];
+      if ( srcIndex < 0 ) continue; // we have everything set to no data
 
       // isNoData() may be slow so we check doNoData first
-      if ( doNoData && inputBlock->isNoData( srcRow, srcCol ) )
+      if ( doNoData && inputBlock->isNoData( static_cast< qgssize >( srcIndex ) ) )
       {
         outputBlock->setIsNoData( i, j );
         continue;
       }
 
-      qgssize destIndex = static_cast< qgssize >( i ) * width + j;
-      char *srcBits = inputBlock->bits( srcIndex );
+      char *srcBits = inputBlock->bits( static_cast< qgssize >( srcIndex ) );
       char *destBits = outputBlock->bits( destIndex );
       if ( !srcBits )
       {
-        // QgsDebugMsg( QString( "Cannot get input block data: row = %1 col = %2" ).arg( i ).arg( j ) );
+        // QgsDebugMsg( QString( "Cannot get input block data: srcIndex = %1" ).arg( srcIndex ) );
         continue;
       }
       if ( !destBits )
       {
-        // QgsDebugMsg( QString( "Cannot set output block data: srcRow = %1 srcCol = %2" ).arg( srcRow ).arg( srcCol ) );
+        // QgsDebugMsg( QString( "Cannot set output block data: row = %1 col = %2" ).arg( i ).arg( j ) );
         continue;
       }
       memcpy( destBits, srcBits, pixelSize );
@@ -844,6 +876,113 @@ QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &exte
   return outputBlock.release();
 }
 
+std::shared_ptr< const QgsRasterProjector::ProjectionGrid > QgsRasterProjector::projectionGrid( const QgsRectangle &extent, int width, int height, QgsRasterBlockFeedback *feedback )
+{
+  // The grid only depends on the geometry of the source, not on the provider instance,
+  // so that the clones of the pipe of a layer share the grids
+  QgsRectangle sourceExtent;
+  int sourceXSize = 0;
+  int sourceYSize = 0;
+  QgsRasterDataProvider *provider = mInput ? dynamic_cast<QgsRasterDataProvider *>( mInput->sourceInput() ) : nullptr;
+  if ( provider )
+  {
+    sourceExtent = provider->extent();
+    if ( provider->capabilities() & QgsRasterDataProvider::Size )
+    {
+      sourceXSize = provider->xSize();
+      sourceYSize = provider->ySize();
+    }
+  }
+
+  // Blocks of the same extent are requested for each band and each time the same map or tile is rendered
+  {
+    QMutexLocker locker( &sGridsMutex );
+    for ( int i = 0; i < sGrids.size(); ++i )
+    {
+      std::shared_ptr< const ProjectionGrid > grid = sGrids.at( i );
+      if ( grid->width == width && grid->height == height && grid->extent == extent
+           && grid->sourceXSize == sourceXSize && grid->sourceYSize == sourceYSize && grid->sourceExtent == sourceExtent
+           && grid->precision == mPrecision && grid->srcDatumTransform == mSrcDatumTransform && grid->destDatumTransform == mDestDatumTransform
+           && grid->srcCrs == mSrcCRS && grid->destCrs == mDestCRS )
+      {
+        sGrids.move( i, 0 );
+        return grid;
+      }
+    }
+  }
+
+  QgsCoordinateTransform inverseCt( mDestCRS, mSrcCRS, mDestDatumTransform, mSrcDatumTransform );
+
+  ProjectorData pd( extent, width, height, mInput, inverseCt, mPrecision );
+
+  QgsDebugMsgLevel( QString( "srcExtent:\n%1" ).arg( pd.srcExtent().toString() ), 4 );
+  QgsDebugMsgLevel( QString( "srcCols = %1 srcRows = %2" ).arg( pd.srcCols() ).arg( pd.srcRows() ), 4 );
+
+  // If we zoom out too much, projector srcRows / srcCols maybe 0, which can cause problems in providers
+  if ( pd.srcRows() <= 0 || pd.srcCols() <= 0 )
+  {
+    QgsDebugMsgLevel( "Zero srcRows or srcCols", 4 );
+    return nullptr;
+  }
+  if ( static_cast< qgssize >( pd.srcRows() ) * pd.srcCols() > static_cast< qgssize >( std::numeric_limits< int >::max() ) )
+  {
+    QgsDebugMsg( "Too large source block" );
+    return nullptr;
+  }
+
+  std::shared_ptr< ProjectionGrid > grid = std::make_shared< ProjectionGrid >();
+  grid->srcCrs = mSrcCRS;
+  grid->destCrs = mDestCRS;
+  grid->srcDatumTransform = mSrcDatumTransform;
+  grid->destDatumTransform = mDestDatumTransform;
+  grid->precision = mPrecision;
+  grid->sourceExtent = sourceExtent;
+  grid->sourceXSize = sourceXSize;
+  grid->sourceYSize = sourceYSize;
+  grid->extent = extent;
+  grid->width = width;
+  grid->height = height;
+  grid->srcExtent = pd.srcExtent();
+  grid->srcRows = pd.srcRows();
+  grid->srcCols = pd.srcCols();
+  grid->srcIndexes.resize( width * height );
+
+  QVector< int > srcRows( width );
+  QVector< int > srcCols( width );
+  int *srcIndexes = grid->srcIndexes.data();
+  for ( int i = 0; i < height; ++i )
+  {
+    if ( feedback && feedback->isCanceled() )
+      return nullptr;
+
+    pd.srcRowCols( i, srcRows.data(), srcCols.data() );
+    int *rowIndexes = srcIndexes + static_cast< qgssize >( i ) * width;
+    for ( int j = 0; j < width; ++j )
+    {
+      rowIndexes[j] = srcRows.at( j ) < 0 ? -1 : srcRows.at( j ) * grid->srcCols + srcCols.at( j );
+    }
+  }
+
+  // Keep the grid if it is not too large, dropping the least recently used ones
+  int cachedCells = width * height;
+  if ( cachedCells <= MAX_CACHED_GRID_CELLS )
+  {
+    QMutexLocker locker( &sGridsMutex );
+    sGrids.prepend( grid );
+    for ( int i = 1; i < sGrids.size(); ++i )
+    {
+      cachedCells += sGrids.at( i )->width * sGrids.at( i )->height;
+      if ( i >= MAX_CACHED_GRIDS || cachedCells > MAX_CACHED_GRID_CELLS )
+      {
+        sGrids.erase( sGrids.begin() + i, sGrids.end() );
+        break;
+      }
+    }
+  }
+
+  return grid;
+}
+
 bool QgsRasterProjector::destExtentSize( const QgsRectangle &srcExtent, int srcXSize, int srcYSize,
     QgsRectangle &destExtent, int &destXSize, int &destYSize )
 {
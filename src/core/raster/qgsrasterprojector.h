@@ -27,6 +27,7 @@
 #include "qgis_sip.h"
 #include <QVector>
 #include <QList>
+#include <QMutex>
 
 #include "qgsrectangle.h"
 #include "qgscoordinatereferencesystem.h"
@@ -34,6 +35,7 @@
 #include "qgsrasterinterface.h"
 
 #include <cmath>
+#include <memory>
 
 class QgsPointXY;
 
@@ -112,6 +114,28 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
     //! Requested precision
     Precision mPrecision = Approximate;
 
+    struct ProjectionGrid;
+
+    //! Maximum number of cached projection grids
+    static const int MAX_CACHED_GRIDS = 32;
+
+    //! Maximum total number of cells of the cached projection grids
+    static const int MAX_CACHED_GRID_CELLS = 4 * 1024 * 1024;
+
+    /**
+     * Returns the source cell indexes of the cells of a destination block, from the cache
+     * if a block with the same extent and size was recently requested from any projector with the
+     * same CRSes, datum transforms, precision and source extent and size.
+     * Returns nullptr if nothing can be read from the source.
+     */
+    std::shared_ptr< const ProjectionGrid > projectionGrid( const QgsRectangle &extent, int width, int height, QgsRasterBlockFeedback *feedback );
+
+    //! Recently used projection grids of all the projectors, most recent first
+    static QList< std::shared_ptr< const ProjectionGrid > > sGrids;
+
+    //! Protects sGrids, projectors of clones of a pipe are used in different threads
+    static QMutex sGridsMutex;
+
 };
 
 
@@ -120,8 +144,8 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
 
 /**
  * Internal class for reprojection of rasters - either exact or approximate.
- * QgsRasterProjector creates it and then keeps calling srcRowCol() to get source pixel position
- * for every destination pixel position.
+ * QgsRasterProjector creates it and then keeps calling srcRowCols() to get source pixel positions
+ * for every destination row.
  */
 class ProjectorData
 {
@@ -134,11 +158,11 @@ class ProjectorData
     ProjectorData &operator=( const ProjectorData &other ) = delete;
 
     /**
-     * \brief Get source row and column indexes for current source extent and resolution
-        If source pixel is outside source extent srcRow and srcCol are left unchanged.
-        \returns true if inside source
+     * \brief Get source row and column indexes of all the cells of a destination row for current source extent and resolution
+        Indexes of the cells outside of the source extent are set to -1.
+        Rows must be requested in increasing order.
      */
-    bool srcRowCol( int destRow, int destCol, int *srcRow, int *srcCol );
+    void srcRowCols( int destRow, int *srcRows, int *srcCols );
 
     QgsRectangle srcExtent() const { return mSrcExtent; }
     int srcRows() const { return mSrcRows; }
@@ -153,11 +177,14 @@ class ProjectorData
     int matrixRow( int destRow );
     int matrixCol( int destCol );
 
-    //! \brief Get precise source row and column indexes for current source extent and resolution
-    inline bool preciseSrcRowCol( int destRow, int destCol, int *srcRow, int *srcCol );
+    //! \brief Get precise source row and column indexes of a destination row, transforming all its cells at once
+    void preciseSrcRowCols( int destRow, int *srcRows, int *srcCols );
+
+    //! \brief Get approximate source row and column indexes of a destination row, interpolated between helper rows
+    void approximateSrcRowCols( int destRow, int *srcRows, int *srcCols );
 
-    //! \brief Get approximate source row and column indexes for current source extent and resolution
-    inline bool approximateSrcRowCol( int destRow, int destCol, int *srcRow, int *srcCol );
+    //! \brief Get source row and column indexes of a point in source CRS, returns false if outside source
+    inline bool srcRowColForPoint( double x, double y, int *srcRow, int *srcCol ) const;
 
     //! \brief insert rows to matrix
     void insertRows( const QgsCoordinateTransform &ct );
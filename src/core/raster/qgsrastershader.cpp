@@ -25,6 +25,8 @@ email                : ersts@amnh.org
 #include <QDomDocument>
 #include <QDomElement>
 
+#include <algorithm>
+
 QgsRasterShader::QgsRasterShader( double minimumValue, double maximumValue )
   : mMinimumValue( minimumValue )
   , mMaximumValue( maximumValue )
@@ -53,6 +55,17 @@ bool QgsRasterShader::shade( double redValue, double greenValue, double blueValu
   return false;
 }
 
+void QgsRasterShader::shadeBlock( QgsRasterBlock *block, qgssize offset, qgssize count, QRgb *output )
+{
+  if ( mRasterShaderFunction )
+  {
+    mRasterShaderFunction->shadeBlock( block, offset, count, output );
+    return;
+  }
+
+  std::fill( output, output + count, qRgba( 0, 0, 0, 0 ) );
+}
+
 void QgsRasterShader::setRasterShaderFunction( QgsRasterShaderFunction *function )
 {
   QgsDebugMsgLevel( "called.", 4 );
@@ -22,9 +22,13 @@ email                : ersts@amnh.org
 
 #include "qgis_core.h"
 #include "qgis_sip.h"
+#include "qgis.h"
+
+#include <QColor>
 
 class QDomDocument;
 class QDomElement;
+class QgsRasterBlock;
 class QgsRasterShaderFunction;
 
 /**
@@ -108,6 +112,16 @@ class CORE_EXPORT QgsRasterShader
                 int *returnBlueValue SIP_OUT,
                 int *returnAlpha SIP_OUT );
 
+    /**
+     * Shades \a count values of a raster \a block, starting at the pixel index \a offset, into the
+     * \a output buffer as premultiplied ARGB32 colors. No data values and values which cannot be
+     * shaded are set to fully transparent colors.
+     * \see QgsRasterShaderFunction::shadeBlock()
+     * \note not available in Python bindings
+     * \since QGIS 3.2
+     */
+    void shadeBlock( QgsRasterBlock *block, qgssize offset, qgssize count, QRgb *output ) SIP_SKIP;
+
     /**
      * \brief A public method that allows the user to set their own shader \a function.
      * \note Raster shader takes ownership of the shader function instance
@@ -18,6 +18,7 @@ email                : ersts@amnh.org
 #include "qgslogger.h"
 
 #include "qgsrastershaderfunction.h"
+#include "qgsrasterblock.h"
 
 QgsRasterShaderFunction::QgsRasterShaderFunction( double minimumValue, double maximumValue )
   : mMaximumValue( maximumValue )
@@ -69,3 +70,30 @@ bool QgsRasterShaderFunction::shade( double redValue, double greenValue, double
 
   return false;
 }
+
+void QgsRasterShaderFunction::shadeBlock( QgsRasterBlock *block, qgssize offset, qgssize count, QRgb *output )
+{
+  const bool hasNoData = block->hasNoData();
+  int red, green, blue, alpha;
+  for ( qgssize i = 0; i < count; ++i )
+  {
+    const qgssize index = offset + i;
+    if ( ( hasNoData && block->isNoData( index ) ) || !shade( block->value( index ), &red, &green, &blue, &alpha ) )
+    {
+      output[i] = qRgba( 0, 0, 0, 0 );
+      continue;
+    }
+    output[i] = premultipliedColor( red, green, blue, alpha );
+  }
+}
+
+QRgb QgsRasterShaderFunction::premultipliedColor( int red, int green, int blue, int alpha )
+{
+  if ( alpha < 255 )
+  {
+    red *= ( alpha / 255.0 );
+    green *= ( alpha / 255.0 );
+    blue *= ( alpha / 255.0 );
+  }
+  return qRgba( red, green, blue, alpha );
+}
@@ -28,9 +28,12 @@ email                : ersts@amnh.org
 
 #include "qgis_core.h"
 #include "qgis_sip.h"
+#include "qgis.h"
 #include <QColor>
 #include <QPair>
 
+class QgsRasterBlock;
+
 class CORE_EXPORT QgsRasterShaderFunction
 {
 #ifdef SIP_RUN
@@ -102,6 +105,21 @@ class CORE_EXPORT QgsRasterShaderFunction
                         int *returnBlueValue SIP_OUT,
                         int *returnAlpha SIP_OUT );
 
+    /**
+     * Shades \a count values of a raster \a block, starting at the pixel index \a offset, into the
+     * \a output buffer as premultiplied ARGB32 colors, ready to be copied into a
+     * Qgis::ARGB32_Premultiplied block. No data values and values which cannot be shaded are
+     * set to fully transparent colors.
+     *
+     * The default implementation calls shade() for each value. Subclasses may override it with a
+     * faster implementation working on whole spans of values, which must give the same colors
+     * as shade().
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.2
+     */
+    virtual void shadeBlock( QgsRasterBlock *block, qgssize offset, qgssize count, QRgb *output ) SIP_SKIP;
+
     double minimumMaximumRange() const { return mMinimumMaximumRange; }
 
     /**
@@ -121,6 +139,15 @@ class CORE_EXPORT QgsRasterShaderFunction
     virtual void legendSymbologyItems( QList< QPair< QString, QColor > > &symbolItems SIP_OUT ) const { Q_UNUSED( symbolItems ); }
 
   protected:
+
+    /**
+     * Returns the premultiplied color for the components returned by shade(), with
+     * the color components scaled down by the alpha value.
+     * \note not available in Python bindings
+     * \since QGIS 3.2
+     */
+    static QRgb premultipliedColor( int red, int green, int blue, int alpha ) SIP_SKIP;
+
     //! \brief User defineable maximum value for the shading function
     double mMaximumValue;
 
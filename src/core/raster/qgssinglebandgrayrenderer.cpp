@@ -116,36 +116,50 @@ QgsRasterBlock *QgsSingleBandGrayRenderer::block( int bandNo, const QgsRectangle
     return outputBlock.release();
   }
 
+  const qgssize count = ( qgssize )width * height;
+
+  // stretch the whole block at once, no data and clipped values are set to -1
+  QVector< int > enhancedValues;
+  if ( mContrastEnhancement )
+  {
+    enhancedValues.resize( static_cast< int >( count ) );
+    mContrastEnhancement->enhanceContrastBlock( inputBlock.get(), 0, count, enhancedValues.data() );
+  }
+  const int *enhanced = enhancedValues.constData();
+
   QRgb myDefaultColor = NODATA_COLOR;
-  for ( qgssize i = 0; i < ( qgssize )width * height; i++ )
+  for ( qgssize i = 0; i < count; i++ )
   {
-    if ( inputBlock->isNoData( i ) )
+    double grayVal;
+    if ( mContrastEnhancement )
     {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
+      if ( enhanced[i] < 0 )
+      {
+        outputBlock->setColor( i, myDefaultColor );
+        continue;
+      }
+      grayVal = enhanced[i];
+    }
+    else
+    {
+      if ( inputBlock->isNoData( i ) )
+      {
+        outputBlock->setColor( i, myDefaultColor );
+        continue;
+      }
+      grayVal = inputBlock->value( i );
     }
-    double grayVal = inputBlock->value( i );
 
     double currentAlpha = mOpacity;
     if ( mRasterTransparency )
     {
-      currentAlpha = mRasterTransparency->alphaValue( grayVal, mOpacity * 255 ) / 255.0;
+      currentAlpha = mRasterTransparency->alphaValue( inputBlock->value( i ), mOpacity * 255 ) / 255.0;
     }
     if ( mAlphaBand > 0 )
     {
       currentAlpha *= alphaBlock->value( i ) / 255.0;
     }
 
-    if ( mContrastEnhancement )
-    {
-      if ( !mContrastEnhancement->isValueInDisplayableRange( grayVal ) )
-      {
-        outputBlock->setColor( i, myDefaultColor );
-        continue;
-      }
-      grayVal = mContrastEnhancement->enhanceContrast( grayVal );
-    }
-
     if ( mGradient == WhiteToBlack )
     {
       grayVal = 255 - grayVal;
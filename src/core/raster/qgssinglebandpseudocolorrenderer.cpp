@@ -233,49 +233,33 @@ QgsRasterBlock *QgsSingleBandPseudoColorRenderer::block( int bandNo, QgsRectangl
     return outputBlock.release();
   }
 
-  QRgb myDefaultColor = NODATA_COLOR;
+  // shade the whole block at once, output colors are premultiplied and transparent for no data
+  const qgssize count = ( qgssize )width * height;
+  QRgb *colors = reinterpret_cast< QRgb * >( outputBlock->bits() );
+  mShader->shadeBlock( inputBlock.get(), 0, count, colors );
 
-  for ( qgssize i = 0; i < ( qgssize )width * height; i++ )
+  if ( hasTransparency )
   {
-    if ( inputBlock->isNoData( i ) )
+    for ( qgssize i = 0; i < count; i++ )
     {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
-    double val = inputBlock->value( i );
-    int red, green, blue, alpha;
-    if ( !mShader->shade( val, &red, &green, &blue, &alpha ) )
-    {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
-
-    if ( alpha < 255 )
-    {
-      // Working with premultiplied colors, so multiply values by alpha
-      red *= ( alpha / 255.0 );
-      blue *= ( alpha / 255.0 );
-      green *= ( alpha / 255.0 );
-    }
+      const QRgb color = colors[i];
+      if ( qAlpha( color ) == 0 )
+      {
+        continue;
+      }
 
-    if ( !hasTransparency )
-    {
-      outputBlock->setColor( i, qRgba( red, green, blue, alpha ) );
-    }
-    else
-    {
       //opacity
       double currentOpacity = mOpacity;
       if ( mRasterTransparency )
       {
-        currentOpacity = mRasterTransparency->alphaValue( val, mOpacity * 255 ) / 255.0;
+        currentOpacity = mRasterTransparency->alphaValue( inputBlock->value( i ), mOpacity * 255 ) / 255.0;
       }
       if ( mAlphaBand > 0 )
       {
         currentOpacity *= alphaBlock->value( i ) / 255.0;
       }
 
-      outputBlock->setColor( i, qRgba( currentOpacity * red, currentOpacity * green, currentOpacity * blue, currentOpacity * alpha ) );
+      colors[i] = qRgba( currentOpacity * qRed( color ), currentOpacity * qGreen( color ), currentOpacity * qBlue( color ), currentOpacity * qAlpha( color ) );
     }
   }
 
@@ -422,6 +422,13 @@ void QgsMapCanvas::setCachingEnabled( bool enabled )
   if ( enabled )
   {
     mCache = new QgsMapRendererCache;
+
+    // optionally keep rendered layers as tiles too, so that panning or zooming back to visited views does not render them again
+    QgsSettings settings;
+    mCache->setTiledCachingEnabled( settings.value( QStringLiteral( "qgis/enable_tiled_render_caching" ), false ).toBool() );
+    mCache->setMemoryBudget( settings.value( QStringLiteral( "qgis/render_cache_memory_budget" ), 256 ).toLongLong() * 1024 * 1024 );
+    if ( settings.value( QStringLiteral( "qgis/render_cache_spill_to_disk" ), false ).toBool() )
+      mCache->setSpillDirectory( QDir::tempPath() );
   }
   else
   {
@@ -521,13 +521,22 @@ QgsDelimitedTextFeatureSource::QgsDelimitedTextFeatureSource( const QgsDelimited
   QUrl url = p->mFile->url();
 
   // make sure watcher not created when using iterator (e.g. for rendering, see issue #15558)
-  if ( url.hasQueryItem( QStringLiteral( "watchFile" ) ) )
+  bool watched = url.hasQueryItem( QStringLiteral( "watchFile" ) );
+  if ( watched )
   {
     url.removeQueryItem( QStringLiteral( "watchFile" ) );
   }
 
   mFile.reset( new QgsDelimitedTextFile() );
+  // the file may be changed by another program while the layer is open, so only
+  // the provider scan maps it
+  mFile->setUseMemoryMap( false );
   mFile->setFromUrl( url );
+  if ( ! watched )
+  {
+    // seek to records using the lines indexed when the provider scanned the file
+    mFile->setLineOffsets( p->mFile->lineOffsets() );
+  }
 
   mExpressionContext << QgsExpressionContextUtils::globalScope()
                      << QgsExpressionContextUtils::projectScope( QgsProject::instance() );
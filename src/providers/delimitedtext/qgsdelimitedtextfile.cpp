@@ -29,6 +29,8 @@
 #include <QRegExp>
 #include <QUrl>
 
+#include <cstring>
+
 
 QgsDelimitedTextFile::QgsDelimitedTextFile( const QString &url )
   : mFileName( QString() )
@@ -57,9 +59,14 @@ void QgsDelimitedTextFile::close()
   }
   if ( mFile )
   {
+    if ( mMappedData )
+      mFile->unmap( mMappedData );
     delete mFile;
     mFile = nullptr;
   }
+  mMappedData = nullptr;
+  mMappedSize = 0;
+  mCodec = nullptr;
   if ( mWatcher )
   {
     delete mWatcher;
@@ -86,11 +93,23 @@ bool QgsDelimitedTextFile::open()
     }
     if ( mFile )
     {
-      mStream = new QTextStream( mFile );
-      if ( ! mEncoding.isEmpty() )
+      mapFile();
+      if ( ! mMappedData )
       {
-        QTextCodec *codec = QTextCodec::codecForName( mEncoding.toLatin1() );
-        mStream->setCodec( codec );
+        // Like the mapped file, use the encoding given by a byte order mark.
+        // The encoding is set once, so that the stream can seek line offsets
+        // without detecting it again.
+        QTextCodec *codec = mEncoding.isEmpty() ? QTextCodec::codecForLocale() : QTextCodec::codecForName( mEncoding.toLatin1() );
+        QTextCodec *bomCodec = QTextCodec::codecForUtfText( mFile->peek( 4 ), nullptr );
+        if ( bomCodec )
+          codec = bomCodec;
+        mStream = new QTextStream( mFile );
+        if ( codec )
+        {
+          mStream->setCodec( codec );
+          mStream->setAutoDetectUnicode( false );
+        }
+        mCodec = codec;
       }
       if ( mUseWatcher )
       {
@@ -103,9 +122,117 @@ bool QgsDelimitedTextFile::open()
   return nullptr != mFile;
 }
 
+void QgsDelimitedTextFile::mapFile()
+{
+  // Watched files are expected to change, and reading a mapped file which has
+  // been truncated would crash
+  if ( mUseWatcher || ! mUseMemoryMap )
+    return;
+
+  QTextCodec *codec = mEncoding.isEmpty() ? QTextCodec::codecForLocale() : QTextCodec::codecForName( mEncoding.toLatin1() );
+  if ( ! codec )
+    return;
+
+  // Lines are split on line feed bytes, which must not be part of other characters
+  if ( codec->fromUnicode( QStringLiteral( "\r\n" ) ) != QByteArray( "\r\n" ) )
+    return;
+
+  const qint64 size = mFile->size();
+  if ( size <= 0 )
+    return;
+
+  uchar *data = mFile->map( 0, size );
+  if ( ! data )
+    return;
+
+  // Like QTextStream, use the encoding given by a byte order mark
+  qint64 start = 0;
+  const QByteArray head = QByteArray::fromRawData( reinterpret_cast< const char * >( data ), static_cast< int >( qMin< qint64 >( size, 4 ) ) );
+  QTextCodec *bomCodec = QTextCodec::codecForUtfText( head, nullptr );
+  if ( bomCodec )
+  {
+    if ( bomCodec->mibEnum() != 106 ) // UTF-16 or UTF-32
+    {
+      mFile->unmap( data );
+      return;
+    }
+    codec = bomCodec;
+    start = 3;
+  }
+
+  mMappedData = data;
+  mMappedSize = size;
+  mDataStart = start;
+  mPosition = start;
+  mCodec = codec;
+}
+
+void QgsDelimitedTextFile::unmapFile()
+{
+  if ( ! mMappedData )
+    return;
+
+  // Continue from the next line, with the encoding used so far
+  mStream = new QTextStream( mFile );
+  mStream->setCodec( mCodec );
+  mStream->setAutoDetectUnicode( false );
+  mStream->seek( mPosition );
+
+  mFile->unmap( mMappedData );
+  mMappedData = nullptr;
+  mMappedSize = 0;
+}
+
+void QgsDelimitedTextFile::rewindFile()
+{
+  if ( mMappedData )
+    mPosition = mDataStart;
+  else
+    mStream->seek( 0 );
+}
+
+bool QgsDelimitedTextFile::readLine( QString *buffer )
+{
+  if ( mMappedData )
+  {
+    if ( mPosition >= mMappedSize )
+      return false;
+
+    if ( mLineNumber % LINE_INDEX_STEP == 0 && mLineNumber / LINE_INDEX_STEP == mLineOffsets.size() )
+      mLineOffsets.append( mPosition );
+
+    const char *start = reinterpret_cast< const char * >( mMappedData ) + mPosition;
+    const char *end = static_cast< const char * >( memchr( start, '\n', static_cast< size_t >( mMappedSize - mPosition ) ) );
+    qint64 length = end ? end - start : mMappedSize - mPosition;
+    mPosition += end ? length + 1 : length;
+
+    if ( buffer )
+    {
+      if ( length > 0 && start[length - 1] == '\r' )
+        length--;
+      *buffer = mCodec->toUnicode( start, static_cast< int >( length ) );
+    }
+  }
+  else
+  {
+    if ( mStream->atEnd() )
+      return false;
+
+    QString line = mStream->readLine();
+    if ( line.isNull() )
+      return false;
+    if ( buffer )
+      *buffer = line;
+  }
+
+  mLineNumber++;
+  return true;
+}
+
 void QgsDelimitedTextFile::updateFile()
 {
   close();
+  mLineOffsets.clear();
   emit fileUpdated();
 }
 
@@ -113,6 +240,7 @@ void QgsDelimitedTextFile::updateFile()
 void QgsDelimitedTextFile::resetDefinition()
 {
   close();
+  mLineOffsets.clear();
   mFieldNames.clear();
   mMaxFieldCount = 0;
 }
@@ -308,6 +436,12 @@ void QgsDelimitedTextFile::setUseWatcher( bool useWatcher )
   mUseWatcher = useWatcher;
 }
 
+void QgsDelimitedTextFile::setUseMemoryMap( bool useMemoryMap )
+{
+  resetDefinition();
+  mUseMemoryMap = useMemoryMap;
+}
+
 QString QgsDelimitedTextFile::type()
 {
   if ( mType == DelimTypeWhitespace ) return QStringLiteral( "whitespace" );
@@ -537,7 +671,7 @@ QgsDelimitedTextFile::Status  QgsDelimitedTextFile::reset()
   if ( ! isValid() || ! open() ) return InvalidDefinition;
 
   // Reset the file pointer
-  mStream->seek( 0 );
+  rewindFile();
   mLineNumber = 0;
   mRecordNumber = -1;
   mRecordLineNumber = -1;
@@ -545,8 +679,7 @@ QgsDelimitedTextFile::Status  QgsDelimitedTextFile::reset()
   // Skip header lines
   for ( int i = mSkipLines; i-- > 0; )
   {
-    if ( mStream->readLine().isNull() ) return RecordEOF;
-    mLineNumber++;
+    if ( ! readLine( nullptr ) ) return RecordEOF;
   }
   // Read the column names
   Status result = RecordOk;
@@ -562,17 +695,14 @@ QgsDelimitedTextFile::Status  QgsDelimitedTextFile::reset()
 
 QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextLine( QString &buffer, bool skipBlank )
 {
-  if ( ! mStream )
+  if ( ! mFile )
   {
     Status status = reset();
     if ( status != RecordOk ) return status;
   }
 
-  while ( ! mStream->atEnd() )
+  while ( readLine( &buffer ) )
   {
-    buffer = mStream->readLine();
-    if ( buffer.isNull() ) break;
-    mLineNumber++;
     if ( skipBlank && buffer.isEmpty() ) continue;
     return RecordOk;
   }
@@ -583,17 +713,36 @@ QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextLine( QString &buffer, bo
 
 bool QgsDelimitedTextFile::setNextLineNumber( long nextLineNumber )
 {
-  if ( ! mStream ) return false;
-  if ( mLineNumber > nextLineNumber - 1 )
+  if ( ! mFile ) return false;
+
+  // Jump to the closest indexed line before the requested one, unless the
+  // current line is closer. A stream is only moved if its encoding is set.
+  long lineNumber = nextLineNumber - 1;
+  bool canSeek = mMappedData || ( mStream && ! mStream->autoDetectUnicode() );
+  if ( canSeek && lineNumber >= 0 && ! mLineOffsets.isEmpty() )
+  {
+    int index = qMin< long >( lineNumber / LINE_INDEX_STEP, mLineOffsets.size() - 1 );
+    long indexedLineNumber = static_cast< long >( index ) * LINE_INDEX_STEP;
+    if ( mLineNumber > lineNumber || mLineNumber < indexedLineNumber )
+    {
+      mRecordNumber = -1;
+      if ( mMappedData )
+        mPosition = mLineOffsets.at( index );
+      else
+        mStream->seek( mLineOffsets.at( index ) );
+      mLineNumber = indexedLineNumber;
+    }
+  }
+
+  if ( mLineNumber > lineNumber )
   {
     mRecordNumber = -1;
-    mStream->seek( 0 );
+    rewindFile();
     mLineNumber = 0;
   }
-  QString buffer;
-  while ( mLineNumber < nextLineNumber - 1 )
+  while ( mLineNumber < lineNumber )
   {
-    if ( nextLine( buffer, false ) != RecordOk ) return false;
+    if ( ! readLine( nullptr ) ) return false;
   }
   return true;
 
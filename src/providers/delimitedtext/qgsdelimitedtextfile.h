@@ -22,11 +22,13 @@
 #include <QRegExp>
 #include <QUrl>
 #include <QObject>
+#include <QVector>
 
 class QgsFeature;
 class QgsField;
 class QFile;
 class QFileSystemWatcher;
+class QTextCodec;
 class QTextStream;
 
 
@@ -65,6 +67,12 @@ class QTextStream;
 *   The field is ignored for csv and whitespace
 * - quoteChar, optional, a single character used for quoting plain fields
 * - escapeChar, optional, a single character used for escaping (may be the same as quoteChar)
+*
+* Files in an encoding where a line feed is a single byte (UTF-8, Latin-1, ...) are
+* memory mapped rather than read through a QTextStream, unless they are watched for
+* changes (see setUseMemoryMap()), until unmapFile() is called. The byte offsets of every
+* LINE_INDEX_STEP lines are then recorded as the file is read, so that setNextRecordId() can
+* seek to a record without reading the file from its start, whether it is mapped or not.
 */
 
 // Note: this has been implemented as a single class rather than a set of classes based
@@ -339,6 +347,32 @@ class QgsDelimitedTextFile : public QObject
 
     void setUseWatcher( bool useWatcher );
 
+    /**
+     * Set whether the file may be memory mapped. Files which may be changed
+     * by other programs while they are read should not be memory mapped.
+     * \param useMemoryMap True to allow memory mapping, false otherwise
+     */
+    void setUseMemoryMap( bool useMemoryMap );
+
+    /**
+     * Reads the rest of the file through a QTextStream if it is memory mapped. Reading
+     * a mapped file which has been truncated by another program would crash, so the
+     * file should only stay mapped while it is scanned.
+     */
+    void unmapFile();
+
+    /**
+     * Return the offsets of the lines of the file indexed while reading it
+     * (while memory mapped), to be shared with another instance reading the same file.
+     */
+    QVector<qint64> lineOffsets() const { return mLineOffsets; }
+
+    /**
+     * Set the offsets of the lines of the file, as returned by lineOffsets()
+     * for the same file.
+     */
+    void setLineOffsets( const QVector<qint64> &offsets ) { mLineOffsets = offsets; }
+
   signals:
 
     /**
@@ -367,6 +401,22 @@ class QgsDelimitedTextFile : public QObject
      */
     void close();
 
+    /**
+     * Memory maps the opened file if its encoding allows it
+     */
+    void mapFile();
+
+    /**
+     * Moves to the start of the file
+     */
+    void rewindFile();
+
+    /**
+     * Reads the next line of the file to \a buffer (unless it is null) and increments the line number.
+     * \returns false at the end of the file
+     */
+    bool readLine( QString *buffer );
+
     /**
      * Reset the status if the definition is changing (e.g., clear
      *  existing field names, etc...
@@ -403,8 +453,22 @@ class QgsDelimitedTextFile : public QObject
     QString mEncoding;
     QFile *mFile = nullptr;
     QTextStream *mStream = nullptr;
+
+    // Content of the file, when memory mapped instead of read by mStream
+    uchar *mMappedData = nullptr;
+    qint64 mMappedSize = 0;
+    // Offset of the first line, after any byte order mark
+    qint64 mDataStart = 0;
+    // Offset of the next line to read
+    qint64 mPosition = 0;
+    QTextCodec *mCodec = nullptr;
+
+    // Offsets of lines 1, LINE_INDEX_STEP + 1, 2 * LINE_INDEX_STEP + 1... of a mapped file
+    static const int LINE_INDEX_STEP = 32;
+    QVector<qint64> mLineOffsets;
     bool mUseWatcher = false;
     QFileSystemWatcher *mWatcher = nullptr;
+    bool mUseMemoryMap = true;
 
     // Parameters common to parsers
     bool mDefinitionValid = false;
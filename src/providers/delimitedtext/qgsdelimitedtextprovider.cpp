@@ -27,6 +27,8 @@
 #include <QRegExp>
 #include <QUrl>
 #include <QUrlQuery>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include "qgsapplication.h"
 #include "qgsdataprovider.h"
@@ -60,6 +62,134 @@ static const QString TEXT_PROVIDER_DESCRIPTION = QStringLiteral( "Delimited text
 
 static const int SUBSET_ID_THRESHOLD_FACTOR = 10;
 
+// Number of records evaluated at once when scanning the file
+
+static const int SCAN_BATCH_SIZE = 4096;
+
+namespace
+{
+
+  //! Record read when scanning the file, with its parsed geometry
+  struct ScannedRecord
+  {
+    long recordId = -1;
+    QStringList parts;
+    //! True if the record could not be split into fields
+    bool badFormat = false;
+    //! Warning about the record, reported in the order of the records
+    QString warning;
+    //! True if the geometry fields are empty
+    bool emptyGeometry = false;
+    //! Geometry parsed from the WKT field
+    QgsGeometry geometry;
+    bool wktHasPrefix = false;
+    //! Point parsed from the X and Y fields
+    QgsPointXY point;
+    bool pointOk = false;
+  };
+
+  //! Potential types of each column of a set of records
+  struct FieldTypes
+  {
+    QList<bool> isEmpty;
+    QList<bool> couldBeInt;
+    QList<bool> couldBeLongLong;
+    QList<bool> couldBeDouble;
+
+    //! Updates the potential types with the values of a record
+    void update( QStringList &parts, const QString &decimalPoint )
+    {
+      for ( int i = 0; i < parts.size(); i++ )
+      {
+
+        QString &value = parts[i];
+        // Ignore empty fields - spreadsheet generated CSV files often
+        // have random empty fields at the end of a row
+        if ( value.isEmpty() )
+          continue;
+
+        // Expand the columns to include this non empty field if necessary
+
+        while ( couldBeInt.size() <= i )
+        {
+          isEmpty.append( true );
+          couldBeInt.append( false );
+          couldBeLongLong.append( false );
+          couldBeDouble.append( false );
+        }
+
+        // If this column has been empty so far then initiallize it
+        // for possible types
+
+        if ( isEmpty[i] )
+        {
+          isEmpty[i] = false;
+          couldBeInt[i] = true;
+          couldBeLongLong[i] = true;
+          couldBeDouble[i] = true;
+        }
+
+        // Now test for still valid possible types for the field
+        // Types are possible until first record which cannot be parsed
+
+        if ( couldBeInt[i] )
+        {
+          value.toInt( &couldBeInt[i] );
+        }
+
+        if ( couldBeLongLong[i] && ! couldBeInt[i] )
+        {
+          value.toLongLong( &couldBeLongLong[i] );
+        }
+
+        if ( couldBeDouble[i] && ! couldBeLongLong[i] )
+        {
+          if ( ! decimalPoint.isEmpty() )
+          {
+            value.replace( decimalPoint, QLatin1String( "." ) );
+          }
+          value.toDouble( &couldBeDouble[i] );
+        }
+      }
+    }
+
+    //! Adds the potential types of the records of \a other, which follow these records
+    void merge( const FieldTypes &other )
+    {
+      for ( int i = 0; i < other.isEmpty.size(); i++ )
+      {
+        if ( other.isEmpty[i] )
+          continue;
+
+        while ( couldBeInt.size() <= i )
+        {
+          isEmpty.append( true );
+          couldBeInt.append( false );
+          couldBeLongLong.append( false );
+          couldBeDouble.append( false );
+        }
+
+        // A value which can be parsed as an integer can be parsed as a long long
+        // and a double too, so each type is possible if it is for both sets of records
+        if ( isEmpty[i] )
+        {
+          isEmpty[i] = false;
+          couldBeInt[i] = other.couldBeInt[i];
+          couldBeLongLong[i] = other.couldBeLongLong[i];
+          couldBeDouble[i] = other.couldBeDouble[i];
+        }
+        else
+        {
+          couldBeInt[i] = couldBeInt[i] && other.couldBeInt[i];
+          couldBeLongLong[i] = couldBeLongLong[i] && other.couldBeLongLong[i];
+          couldBeDouble[i] = couldBeDouble[i] && other.couldBeDouble[i];
+        }
+      }
+    }
+  };
+
+}
+
 QRegExp QgsDelimitedTextProvider::sWktPrefixRegexp( "^\\s*(?:\\d+\\s+|SRID\\=\\d+\\;)", Qt::CaseInsensitive );
 QRegExp QgsDelimitedTextProvider::sCrdDmsRegexp( "^\\s*(?:([-+nsew])\\s*)?(\\d{1,3})(?:[^0-9.]+([0-5]?\\d))?[^0-9.]+([0-5]?\\d(?:\\.\\d+)?)[^0-9.]*([-+nsew])?\\s*$", Qt::CaseInsensitive );
 
@@ -374,116 +504,174 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   mNumberFeatures = 0;
   mExtent = QgsRectangle();
 
-  QList<bool> isEmpty;
-  QList<bool> couldBeInt;
-  QList<bool> couldBeLongLong;
-  QList<bool> couldBeDouble;
+  FieldTypes fieldTypes;
   bool foundFirstGeometry = false;
 
-  while ( true )
+  // Records are read sequentially, as where a quoted record ends depends on the
+  // text before it, and evaluated in batches: their geometries are parsed in parallel,
+  // then checked and indexed in order, and the types of their fields are assessed in
+  // parallel.
+
+  const int threadCount = qMax( QThread::idealThreadCount(), 1 );
+  QVector<ScannedRecord> batch;
+  QVector<int> usedRecords;
+  QVector<FieldTypes> sliceTypes;
+  QVector<int> slices;
+  bool endOfFile = false;
+
+  while ( !endOfFile )
   {
-    QgsDelimitedTextFile::Status status = mFile->nextRecord( parts );
-    if ( status == QgsDelimitedTextFile::RecordEOF )
-      break;
-    if ( status != QgsDelimitedTextFile::RecordOk )
+    batch.clear();
+    while ( batch.size() < SCAN_BATCH_SIZE )
     {
-      nBadFormatRecords++;
-      recordInvalidLine( tr( "Invalid record format at line %1" ) );
-      continue;
+      QgsDelimitedTextFile::Status status = mFile->nextRecord( parts );
+      if ( status == QgsDelimitedTextFile::RecordEOF )
+      {
+        endOfFile = true;
+        break;
+      }
+      if ( status != QgsDelimitedTextFile::RecordOk )
+      {
+        ScannedRecord record;
+        record.recordId = mFile->recordId();
+        record.badFormat = true;
+        record.warning = tr( "Invalid record format at line %1" );
+        batch.append( record );
+        continue;
+      }
+      // Skip over empty records
+      if ( recordIsEmpty( parts ) )
+      {
+        nEmptyRecords++;
+        continue;
+      }
+
+      ScannedRecord record;
+      record.recordId = mFile->recordId();
+      record.parts = parts;
+      batch.append( record );
     }
-    // Skip over empty records
-    if ( recordIsEmpty( parts ) )
+
+    QtConcurrent::blockingMap( batch, [this]( ScannedRecord & record )
     {
-      nEmptyRecords++;
-      continue;
-    }
+      if ( record.badFormat )
+        return;
 
-    // Check geometries are valid
-    bool geomValid = true;
+      if ( mGeomRep == GeomAsWkt )
+      {
+        if ( mWktFieldIndex >= record.parts.size() || record.parts[mWktFieldIndex].isEmpty() )
+        {
+          record.emptyGeometry = true;
+        }
+        else
+        {
+          QString sWkt = record.parts[mWktFieldIndex];
+          record.wktHasPrefix = sWkt.indexOf( sWktPrefixRegexp ) >= 0;
+          record.geometry = geomFromWkt( sWkt, record.wktHasPrefix );
+          if ( record.geometry.isNull() )
+            record.warning = tr( "Invalid WKT at line %1" );
+        }
+      }
+      else if ( mGeomRep == GeomAsXy )
+      {
+        QString sX = mXFieldIndex < record.parts.size() ? record.parts[mXFieldIndex] : QString();
+        QString sY = mYFieldIndex < record.parts.size() ? record.parts[mYFieldIndex] : QString();
+        if ( sX.isEmpty() && sY.isEmpty() )
+          record.emptyGeometry = true;
+        else if ( !pointFromXY( sX, sY, record.point, mDecimalPoint, mXyDms ) )
+          record.warning = tr( "Invalid X or Y fields at line %1" );
+        else
+          record.pointOk = true;
+      }
+    } );
 
-    if ( mGeomRep == GeomAsWkt )
+    usedRecords.clear();
+    for ( int recordIndex = 0; recordIndex < batch.size(); ++recordIndex )
     {
-      if ( mWktFieldIndex >= parts.size() || parts[mWktFieldIndex].isEmpty() )
+      const ScannedRecord &record = batch.at( recordIndex );
+
+      if ( record.badFormat )
       {
-        nEmptyGeometry++;
-        mNumberFeatures++;
+        nBadFormatRecords++;
+        recordInvalidLine( record.warning, record.recordId );
+        continue;
       }
-      else
-      {
-        // Get the wkt - confirm it is valid, get the type, and
-        // if compatible with the rest of file, add to the extents
 
-        QString sWkt = parts[mWktFieldIndex];
-        QgsGeometry geom;
-        if ( !mWktHasPrefix && sWkt.indexOf( sWktPrefixRegexp ) >= 0 )
-          mWktHasPrefix = true;
-        geom = geomFromWkt( sWkt, mWktHasPrefix );
+      // Check geometries are valid
+      bool geomValid = true;
 
-        if ( !geom.isNull() )
+      if ( mGeomRep == GeomAsWkt )
+      {
+        if ( record.emptyGeometry )
+        {
+          nEmptyGeometry++;
+          mNumberFeatures++;
+        }
+        else
         {
-          QgsWkbTypes::Type type = geom.wkbType();
-          if ( type != QgsWkbTypes::NoGeometry )
+          // Confirm the geometry is valid, get the type, and
+          // if compatible with the rest of file, add to the extents
+
+          if ( record.wktHasPrefix )
+            mWktHasPrefix = true;
+          const QgsGeometry &geom = record.geometry;
+
+          if ( !geom.isNull() )
           {
-            if ( mGeometryType == QgsWkbTypes::UnknownGeometry || geom.type() == mGeometryType )
+            QgsWkbTypes::Type type = geom.wkbType();
+            if ( type != QgsWkbTypes::NoGeometry )
             {
-              mGeometryType = geom.type();
-              if ( !foundFirstGeometry )
+              if ( mGeometryType == QgsWkbTypes::UnknownGeometry || geom.type() == mGeometryType )
               {
-                mNumberFeatures++;
-                mWkbType = type;
-                mExtent = geom.boundingBox();
-                foundFirstGeometry = true;
-              }
-              else
-              {
-                mNumberFeatures++;
-                if ( geom.isMultipart() )
+                mGeometryType = geom.type();
+                if ( !foundFirstGeometry )
+                {
+                  mNumberFeatures++;
                   mWkbType = type;
-                QgsRectangle bbox( geom.boundingBox() );
-                mExtent.combineExtentWith( bbox );
+                  mExtent = geom.boundingBox();
+                  foundFirstGeometry = true;
+                }
+                else
+                {
+                  mNumberFeatures++;
+                  if ( geom.isMultipart() )
+                    mWkbType = type;
+                  QgsRectangle bbox( geom.boundingBox() );
+                  mExtent.combineExtentWith( bbox );
+                }
+                if ( buildSpatialIndex )
+                {
+                  QgsFeature f;
+                  f.setId( record.recordId );
+                  f.setGeometry( geom );
+                  mSpatialIndex->insertFeature( f );
+                }
               }
-              if ( buildSpatialIndex )
+              else
               {
-                QgsFeature f;
-                f.setId( mFile->recordId() );
-                f.setGeometry( geom );
-                mSpatialIndex->insertFeature( f );
+                nIncompatibleGeometry++;
+                geomValid = false;
               }
             }
-            else
-            {
-              nIncompatibleGeometry++;
-              geomValid = false;
-            }
           }
-        }
-        else
-        {
-          geomValid = false;
-          nInvalidGeometry++;
-          recordInvalidLine( tr( "Invalid WKT at line %1" ) );
+          else
+          {
+            geomValid = false;
+            nInvalidGeometry++;
+            recordInvalidLine( record.warning, record.recordId );
+          }
         }
       }
-    }
-    else if ( mGeomRep == GeomAsXy )
-    {
-      // Get the x and y values, first checking to make sure they
-      // aren't null.
-
-      QString sX = mXFieldIndex < parts.size() ? parts[mXFieldIndex] : QString();
-      QString sY = mYFieldIndex < parts.size() ? parts[mYFieldIndex] : QString();
-      if ( sX.isEmpty() && sY.isEmpty() )
+      else if ( mGeomRep == GeomAsXy )
       {
-        nEmptyGeometry++;
-        mNumberFeatures++;
-      }
-      else
-      {
-        QgsPointXY pt;
-        bool ok = pointFromXY( sX, sY, pt, mDecimalPoint, mXyDms );
-
-        if ( ok )
+        if ( record.emptyGeometry )
+        {
+          nEmptyGeometry++;
+          mNumberFeatures++;
+        }
+        else if ( record.pointOk )
         {
+          const QgsPointXY &pt = record.point;
           if ( foundFirstGeometry )
           {
             mExtent.combineExtentWith( pt.x(), pt.y() );
@@ -500,7 +688,7 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
           if ( buildSpatialIndex && std::isfinite( pt.x() ) && std::isfinite( pt.y() ) )
           {
             QgsFeature f;
-            f.setId( mFile->recordId() );
+            f.setId( record.recordId );
             f.setGeometry( QgsGeometry::fromPointXY( pt ) );
             mSpatialIndex->insertFeature( f );
           }
@@ -509,79 +697,54 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
         {
           geomValid = false;
           nInvalidGeometry++;
-          recordInvalidLine( tr( "Invalid X or Y fields at line %1" ) );
+          recordInvalidLine( record.warning, record.recordId );
         }
       }
-    }
-    else
-    {
-      mWkbType = QgsWkbTypes::NoGeometry;
-      mNumberFeatures++;
-    }
-
-    if ( !geomValid )
-      continue;
-
-    if ( buildSubsetIndex )
-      mSubsetIndex.append( mFile->recordId() );
-
-
-    // If we are going to use this record, then assess the potential types of each column
-
-    for ( int i = 0; i < parts.size(); i++ )
-    {
+      else
+      {
+        mWkbType = QgsWkbTypes::NoGeometry;
+        mNumberFeatures++;
+      }
 
-      QString &value = parts[i];
-      // Ignore empty fields - spreadsheet generated CSV files often
-      // have random empty fields at the end of a row
-      if ( value.isEmpty() )
+      if ( !geomValid )
         continue;
 
-      // Expand the columns to include this non empty field if necessary
+      if ( buildSubsetIndex )
+        mSubsetIndex.append( record.recordId );
 
-      while ( couldBeInt.size() <= i )
-      {
-        isEmpty.append( true );
-        couldBeInt.append( false );
-        couldBeLongLong.append( false );
-        couldBeDouble.append( false );
-      }
-
-      // If this column has been empty so far then initiallize it
-      // for possible types
+      usedRecords.append( recordIndex );
+    }
 
-      if ( isEmpty[i] )
-      {
-        isEmpty[i] = false;
-        couldBeInt[i] = true;
-        couldBeLongLong[i] = true;
-        couldBeDouble[i] = true;
-      }
+    if ( usedRecords.isEmpty() )
+      continue;
 
-      // Now test for still valid possible types for the field
-      // Types are possible until first record which cannot be parsed
+    // If we are going to use the records, then assess the potential types of each column,
+    // each thread taking a slice of the records
 
-      if ( couldBeInt[i] )
-      {
-        value.toInt( &couldBeInt[i] );
-      }
+    const int sliceSize = ( usedRecords.size() + threadCount - 1 ) / threadCount;
+    const int sliceCount = ( usedRecords.size() + sliceSize - 1 ) / sliceSize;
+    sliceTypes = QVector<FieldTypes>( sliceCount );
+    slices.clear();
+    for ( int slice = 0; slice < sliceCount; ++slice )
+      slices.append( slice );
 
-      if ( couldBeLongLong[i] && ! couldBeInt[i] )
-      {
-        value.toLongLong( &couldBeLongLong[i] );
-      }
+    ScannedRecord *records = batch.data();
+    FieldTypes *types = sliceTypes.data();
+    QtConcurrent::blockingMap( slices, [this, records, types, &usedRecords, sliceSize]( int slice )
+    {
+      const int end = qMin( ( slice + 1 ) * sliceSize, usedRecords.size() );
+      for ( int i = slice * sliceSize; i < end; ++i )
+        types[slice].update( records[usedRecords.at( i )].parts, mDecimalPoint );
+    } );
 
-      if ( couldBeDouble[i] && ! couldBeLongLong[i] )
-      {
-        if ( ! mDecimalPoint.isEmpty() )
-        {
-          value.replace( mDecimalPoint, QLatin1String( "." ) );
-        }
-        value.toDouble( &couldBeDouble[i] );
-      }
-    }
+    for ( const FieldTypes &types : qgis::as_const( sliceTypes ) )
+      fieldTypes.merge( types );
   }
 
+  // the file may be changed by another program once scanned, reading it
+  // further through the memory map could then crash
+  mFile->unmapFile();
+
   // Now create the attribute fields.  Field types are integer by preference,
   // failing that double, failing that text.
 
@@ -621,19 +784,19 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
         typeName = QStringLiteral( "double" );
       }
     }
-    else if ( i < couldBeInt.size() )
+    else if ( i < fieldTypes.couldBeInt.size() )
     {
-      if ( couldBeInt[i] )
+      if ( fieldTypes.couldBeInt[i] )
       {
         fieldType = QVariant::Int;
         typeName = QStringLiteral( "integer" );
       }
-      else if ( couldBeLongLong[i] )
+      else if ( fieldTypes.couldBeLongLong[i] )
       {
         fieldType = QVariant::LongLong;
         typeName = QStringLiteral( "longlong" );
       }
-      else if ( couldBeDouble[i] )
+      else if ( fieldTypes.couldBeDouble[i] )
       {
         fieldType = QVariant::Double;
         typeName = QStringLiteral( "double" );
@@ -904,11 +1067,11 @@ bool QgsDelimitedTextProvider::recordIsEmpty( QStringList &record )
   return true;
 }
 
-void QgsDelimitedTextProvider::recordInvalidLine( const QString &message )
+void QgsDelimitedTextProvider::recordInvalidLine( const QString &message, long recordId )
 {
   if ( mInvalidLines.size() < mMaxInvalidLines )
   {
-    mInvalidLines.append( message.arg( mFile->recordId() ) );
+    mInvalidLines.append( message.arg( recordId ) );
   }
   else
   {
@@ -200,7 +200,7 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
     void resetCachedSubset() const;
     void resetIndexes() const;
     void clearInvalidLines() const;
-    void recordInvalidLine( const QString &message );
+    void recordInvalidLine( const QString &message, long recordId );
     void reportErrors( const QStringList &messages = QStringList(), bool showDialog = false ) const;
     static bool recordIsEmpty( QStringList &record );
     void setUriParameter( const QString &parameter, const QString &value );
@@ -83,6 +83,36 @@ const int MIN_THRESHOLD_FOR_CACHE_CLEANUP = 10;
 // file descriptors.
 const int MAX_CACHE_SIZE = 50;
 
+// Whether a single dataset should be used by the provider and its clones, as the
+// JP2OPENJPEG driver might consume too much memory on large datasets
+static bool useSingleDataset( GDALDatasetH dataset )
+{
+  return ( dataset && GDALGetDatasetDriver( dataset ) == GDALGetDriverByName( "JP2OPENJPEG" ) ) ||
+         CSLTestBoolean( CPLGetConfigOption( "QGIS_GDAL_FORCE_USE_SAME_DATASET", "FALSE" ) );
+}
+
+// Scale of a GDAL band, 1 if it has none
+static double gdalBandScale( GDALRasterBandH band )
+{
+  int bGotScale;
+  double myScale = GDALGetRasterScale( band, &bGotScale );
+  if ( bGotScale )
+    return myScale;
+  else
+    return 1.0;
+}
+
+// Offset of a GDAL band, 0 if it has none
+static double gdalBandOffset( GDALRasterBandH band )
+{
+  int bGotOffset;
+  double myOffset = GDALGetRasterOffset( band, &bGotOffset );
+  if ( bGotOffset )
+    return myOffset;
+  else
+    return 0.0;
+}
+
 struct QgsGdalProgress
 {
   int type;
@@ -196,12 +226,7 @@ QgsGdalProvider::QgsGdalProvider( const QgsGdalProvider &other )
   : QgsRasterDataProvider( other.dataSourceUri() )
   , mUpdate( false )
 {
-  // The JP2OPENJPEG driver might consume too much memory on large datasets
-  // so make sure to really use a single one.
-  bool forceUseSameDataset =
-    ( other.mGdalBaseDataset &&
-      GDALGetDatasetDriver( other.mGdalBaseDataset ) == GDALGetDriverByName( "JP2OPENJPEG" ) ) ||
-    CSLTestBoolean( CPLGetConfigOption( "QGIS_GDAL_FORCE_USE_SAME_DATASET", "FALSE" ) );
+  bool forceUseSameDataset = useSingleDataset( other.mGdalBaseDataset );
 
   if ( forceUseSameDataset )
   {
@@ -417,6 +442,131 @@ void QgsGdalProvider::closeCachedGdalHandlesFor( QgsGdalProvider *provider )
   }
 }
 
+/**
+ * Dataset handles used by a single read.
+ *
+ * The handles of the provider are used if no other thread is using them. Otherwise, for
+ * read-only providers with their own handles, handles are taken from the dataset cache of the
+ * parent provider, or opened if the cache has none, so that reads of the same provider from
+ * several threads proceed concurrently. They are put back in the cache, which is bounded,
+ * at the end of the read, so that they are reused by the next concurrent reads of the
+ * provider and of its clones.
+ */
+class QgsGdalProvider::DatasetLease
+{
+  public:
+
+    explicit DatasetLease( QgsGdalProvider *provider )
+      : mProvider( provider )
+    {
+      // providers created with an error have no mutex
+      if ( provider->mpMutex && !provider->mpMutex->tryLock() )
+      {
+        if ( provider->mCanReadConcurrently.loadAcquire() )
+        {
+          // the metadata read by the caller must not change while mpMutex is not locked
+          provider->mMetadataLock.lockForRead();
+          if ( provider->mCanReadConcurrently.loadAcquire() && leaseDatasets() )
+            return;
+          provider->mMetadataLock.unlock();
+        }
+        provider->mpMutex->lock();
+      }
+      mLocked = true;
+
+      if ( !provider->initIfNeeded() )
+        return;
+      mDataset = provider->mGdalDataset;
+
+      if ( !provider->mCanReadConcurrently.loadAcquire() && !provider->mUpdate && provider->mpParent &&
+           !useSingleDataset( provider->mGdalBaseDataset ) )
+      {
+        provider->mIsWarpedVrt = provider->mGdalDataset != provider->mGdalBaseDataset;
+        provider->mCanReadConcurrently.storeRelease( 1 );
+      }
+    }
+
+    ~DatasetLease()
+    {
+      if ( mLocked )
+      {
+        if ( mProvider->mpMutex )
+          mProvider->mpMutex->unlock();
+        return;
+      }
+
+      mProvider->mMetadataLock.unlock();
+
+      {
+        QMutexLocker locker( &gGdaProviderMutex );
+        QgsGdalProvider *parent = *mProvider->mpParent;
+        if ( parent && cacheGdalHandlesForLaterReuse( parent, mBaseDataset, mDataset ) )
+          return;
+      }
+      if ( mBaseDataset )
+      {
+        GDALDereferenceDataset( mBaseDataset );
+      }
+      if ( mDataset )
+      {
+        GDALClose( mDataset );
+      }
+    }
+
+    DatasetLease( const DatasetLease &other ) = delete;
+    DatasetLease &operator=( const DatasetLease &other ) = delete;
+
+    //! Returns the dataset to read from, or nullptr if the provider is not valid
+    GDALDatasetH dataset() const { return mDataset; }
+
+  private:
+
+    //! Takes handles from the dataset cache or opens new ones
+    bool leaseDatasets()
+    {
+      {
+        QMutexLocker locker( &gGdaProviderMutex );
+        QgsGdalProvider *parent = *mProvider->mpParent;
+        if ( parent && getCachedGdalHandles( parent, mBaseDataset, mDataset ) )
+          return true;
+      }
+      QgsDebugMsgLevel( "opening new dataset for concurrent read", 5 );
+      return mProvider->openDatasetHandles( mBaseDataset, mDataset );
+    }
+
+    QgsGdalProvider *mProvider = nullptr;
+    //! True if the handles of the provider are used, with its mutex locked, otherwise mMetadataLock is locked for reading
+    bool mLocked = false;
+    GDALDatasetH mBaseDataset = nullptr;
+    GDALDatasetH mDataset = nullptr;
+};
+
+bool QgsGdalProvider::openDatasetHandles( GDALDatasetH &gdalBaseDataset, GDALDatasetH &gdalDataset ) const
+{
+  gdalBaseDataset = gdalOpen( dataSourceUri().toUtf8().constData(), GA_ReadOnly );
+  if ( !gdalBaseDataset )
+  {
+    gdalDataset = nullptr;
+    return false;
+  }
+
+  if ( !mIsWarpedVrt )
+  {
+    gdalDataset = gdalBaseDataset;
+    GDALReferenceDataset( gdalDataset );
+    return true;
+  }
+
+  gdalDataset = GDALAutoCreateWarpedVRT( gdalBaseDataset, nullptr, nullptr,
+                                         GRA_NearestNeighbour, 0.2, nullptr );
+  if ( !gdalDataset )
+  {
+    GDALClose( gdalBaseDataset );
+    gdalBaseDataset = nullptr;
+    return false;
+  }
+  return true;
+}
 
 QgsGdalProvider::~QgsGdalProvider()
 {
@@ -467,6 +617,7 @@ void QgsGdalProvider::closeDataset()
     return;
   }
   mValid = false;
+  disableConcurrentReads();
 
   GDALDereferenceDataset( mGdalBaseDataset );
   mGdalBaseDataset = nullptr;
@@ -475,6 +626,12 @@ void QgsGdalProvider::closeDataset()
   mGdalDataset = nullptr;
 }
 
+void QgsGdalProvider::disableConcurrentReads()
+{
+  QWriteLocker locker( &mMetadataLock );
+  mCanReadConcurrently.storeRelease( 0 );
+}
+
 QString QgsGdalProvider::htmlMetadata()
 {
   QMutexLocker locker( mpMutex );
@@ -584,8 +741,10 @@ QString QgsGdalProvider::htmlMetadata()
 
 QgsRasterBlock *QgsGdalProvider::block( int bandNo, const QgsRectangle &extent, int width, int height, QgsRasterBlockFeedback *feedback )
 {
+  // taken first, the lease also guards the data type and extent read below
+  DatasetLease lease( this );
   QgsRasterBlock *block = new QgsRasterBlock( dataType( bandNo ), width, height );
-  if ( !initIfNeeded() )
+  if ( !lease.dataset() )
     return block;
   if ( sourceHasNoDataValue( bandNo ) && useSourceNoDataValue( bandNo ) )
   {
@@ -602,17 +761,19 @@ QgsRasterBlock *QgsGdalProvider::block( int bandNo, const QgsRectangle &extent,
     QRect subRect = QgsRasterBlock::subRect( extent, width, height, mExtent );
     block->setIsNoDataExcept( subRect );
   }
-  readBlock( bandNo, extent, width, height, block->bits(), feedback );
+
+  readBlock( lease.dataset(), bandNo, extent, width, height, block->bits(), feedback );
   // apply scale and offset
-  block->applyScaleOffset( bandScale( bandNo ), bandOffset( bandNo ) );
+  GDALRasterBandH gdalBand = getBand( lease.dataset(), bandNo );
+  block->applyScaleOffset( gdalBandScale( gdalBand ), gdalBandOffset( gdalBand ) );
   block->applyNoDataValues( userNoDataValues( bandNo ) );
   return block;
 }
 
 void QgsGdalProvider::readBlock( int bandNo, int xBlock, int yBlock, void *block )
 {
-  QMutexLocker locker( mpMutex );
-  if ( !initIfNeeded() )
+  DatasetLease lease( this );
+  if ( !lease.dataset() )
     return;
 
   // TODO!!!: Check data alignment!!! May it happen that nearest value which
@@ -621,7 +782,7 @@ void QgsGdalProvider::readBlock( int bandNo, int xBlock, int yBlock, void *block
 
   //QgsDebugMsg( "yBlock = "  + QString::number( yBlock ) );
 
-  GDALRasterBandH myGdalBand = getBand( bandNo );
+  GDALRasterBandH myGdalBand = getBand( lease.dataset(), bandNo );
   //GDALReadBlock( myGdalBand, xBlock, yBlock, block );
 
   // We have to read with correct data type consistent with other readBlock functions
@@ -632,10 +793,15 @@ void QgsGdalProvider::readBlock( int bandNo, int xBlock, int yBlock, void *block
 
 void QgsGdalProvider::readBlock( int bandNo, QgsRectangle  const &extent, int pixelWidth, int pixelHeight, void *block, QgsRasterBlockFeedback *feedback )
 {
-  QMutexLocker locker( mpMutex );
-  if ( !initIfNeeded() )
+  DatasetLease lease( this );
+  if ( !lease.dataset() )
     return;
 
+  readBlock( lease.dataset(), bandNo, extent, pixelWidth, pixelHeight, block, feedback );
+}
+
+void QgsGdalProvider::readBlock( GDALDatasetH dataset, int bandNo, QgsRectangle  const &extent, int pixelWidth, int pixelHeight, void *block, QgsRasterBlockFeedback *feedback )
+{
   QgsDebugMsgLevel( "thePixelWidth = "  + QString::number( pixelWidth ), 5 );
   QgsDebugMsgLevel( "thePixelHeight = "  + QString::number( pixelHeight ), 5 );
   QgsDebugMsgLevel( "theExtent: " + extent.toString(), 5 );
@@ -803,7 +969,7 @@ void QgsGdalProvider::readBlock( int bandNo, QgsRectangle  const &extent, int pi
     QgsDebugMsgLevel( QString( "Couldn't allocate temporary buffer of %1 bytes" ).arg( dataSize * tmpWidth * tmpHeight ), 5 );
     return;
   }
-  GDALRasterBandH gdalBand = getBand( bandNo );
+  GDALRasterBandH gdalBand = getBand( dataset, bandNo );
   GDALDataType type = ( GDALDataType )mGdalDataType.at( bandNo - 1 );
   CPLErrorReset();
 
@@ -1282,6 +1448,15 @@ int QgsGdalProvider::capabilities() const
   {
     capability |= QgsRasterDataProvider::Size;
   }
+  // concurrent requests to remote services are throttled by the servers, and they are
+  // much slower than the rendering anyway: only read local files in parallel
+  static const QStringList sRemoteDrivers = QStringList() << QStringLiteral( "WMS" ) << QStringLiteral( "WCS" ) << QStringLiteral( "WMTS" ) << QStringLiteral( "PLMosaic" );
+  const QString path = dataSourceUri();
+  if ( !sRemoteDrivers.contains( name ) && !path.startsWith( QLatin1String( "/vsicurl" ) ) && !path.startsWith( QLatin1String( "/vsis3" ) )
+       && !path.startsWith( QLatin1String( "/vsigs" ) ) && !path.startsWith( QLatin1String( "/vsiaz" ) ) && !path.contains( QLatin1String( "://" ) ) )
+  {
+    capability |= QgsRasterDataProvider::ParallelReads;
+  }
   return capability;
 }
 
@@ -1347,13 +1522,7 @@ double QgsGdalProvider::bandScale( int bandNo ) const
   if ( !const_cast<QgsGdalProvider *>( this )->initIfNeeded() )
     return 1.0;
 
-  GDALRasterBandH myGdalBand = getBand( bandNo );
-  int bGotScale;
-  double myScale = GDALGetRasterScale( myGdalBand, &bGotScale );
-  if ( bGotScale )
-    return myScale;
-  else
-    return 1.0;
+  return gdalBandScale( getBand( bandNo ) );
 }
 
 double QgsGdalProvider::bandOffset( int bandNo ) const
@@ -1362,13 +1531,7 @@ double QgsGdalProvider::bandOffset( int bandNo ) const
   if ( !const_cast<QgsGdalProvider *>( this )->initIfNeeded() )
     return 0.0;
 
-  GDALRasterBandH myGdalBand = getBand( bandNo );
-  int bGotOffset;
-  double myOffset = GDALGetRasterOffset( myGdalBand, &bGotOffset );
-  if ( bGotOffset )
-    return myOffset;
-  else
-    return 0.0;
+  return gdalBandOffset( getBand( bandNo ) );
 }
 
 int QgsGdalProvider::bandCount() const
@@ -1700,6 +1863,8 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> &rasterPyr
                                         const QStringList &configOptions, QgsRasterBlockFeedback *feedback )
 {
   QMutexLocker locker( mpMutex );
+  // the dataset is reopened in update mode below
+  disableConcurrentReads();
 
   //TODO: Consider making rasterPyramidList modifyable by this method to indicate if the pyramid exists after build attempt
   //without requiring the user to rebuild the pyramid list to get the updated information
@@ -2982,6 +3147,7 @@ QGISEXTERN QgsGdalProvider *create(
 bool QgsGdalProvider::write( void *data, int band, int width, int height, int xOffset, int yOffset )
 {
   QMutexLocker locker( mpMutex );
+  disableConcurrentReads();
   if ( !initIfNeeded() )
     return false;
 
@@ -3260,10 +3426,15 @@ GDALRasterBandH QgsGdalProvider::getBand( int bandNo ) const
   if ( !const_cast<QgsGdalProvider *>( this )->initIfNeeded() )
     return nullptr;
 
-  if ( mMaskBandExposedAsAlpha && bandNo == GDALGetRasterCount( mGdalDataset ) + 1 )
-    return GDALGetMaskBand( GDALGetRasterBand( mGdalDataset, 1 ) );
+  return getBand( mGdalDataset, bandNo );
+}
+
+GDALRasterBandH QgsGdalProvider::getBand( GDALDatasetH dataset, int bandNo ) const
+{
+  if ( mMaskBandExposedAsAlpha && bandNo == GDALGetRasterCount( dataset ) + 1 )
+    return GDALGetMaskBand( GDALGetRasterBand( dataset, 1 ) );
   else
-    return GDALGetRasterBand( mGdalDataset, bandNo );
+    return GDALGetRasterBand( dataset, bandNo );
 }
 
 // pyramids resampling
@@ -27,6 +27,8 @@
 #include "qgscolorrampshader.h"
 #include "qgsrasterbandstats.h"
 
+#include <QAtomicInt>
+#include <QReadWriteLock>
 #include <QString>
 #include <QStringList>
 #include <QDomElement>
@@ -188,6 +190,21 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     // mutex to protect access to mGdalDataset among main and shared provider instances
     QMutex *mpMutex = nullptr;
 
+    // Reads which find mpMutex locked by another thread do not wait for it when
+    // the provider is read-only and has its own handles: they use handles from
+    // the dataset cache of the parent provider instead, see DatasetLease.
+    class DatasetLease;
+
+    // non zero once the provider is initialized and its reads can use other handles than its own
+    QAtomicInt mCanReadConcurrently;
+
+    // held for reading by the reads which do not lock mpMutex, and for writing (with mpMutex
+    // locked) before the metadata (data types, extent, size, ...) or the handles are changed
+    QReadWriteLock mMetadataLock;
+
+    // whether mGdalDataset is a warped VRT of mGdalBaseDataset, set before mCanReadConcurrently
+    bool mIsWarpedVrt = false;
+
     // pointer to a QgsGdalProvider* that is the parent. Note when *mpParent == this, we are the parent.
     QgsGdalProvider **mpParent = nullptr;
 
@@ -255,9 +272,24 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     //! Wrapper for GDALGetRasterBand() that takes into account mMaskBandExposedAsAlpha.
     GDALRasterBandH getBand( int bandNo ) const;
 
+    //! Returns the band \a bandNo of \a dataset, taking into account mMaskBandExposedAsAlpha.
+    GDALRasterBandH getBand( GDALDatasetH dataset, int bandNo ) const;
+
+    //! Reads a block of band \a bandNo from \a dataset, which is either mGdalDataset or a leased dataset.
+    void readBlock( GDALDatasetH dataset, int bandNo, QgsRectangle  const &extent, int pixelWidth, int pixelHeight, void *data, QgsRasterBlockFeedback *feedback );
+
+    //! Opens new read-only handles of the dataset of the provider, returns false on failure.
+    bool openDatasetHandles( GDALDatasetH &gdalBaseDataset, GDALDatasetH &gdalDataset ) const;
+
     //! \brief Close data set and release related data
     void closeDataset();
 
+    /**
+     * Waits for the reads running without mpMutex and makes the next reads lock it.
+     * Must be called with mpMutex locked, before the metadata or the handles are changed.
+     */
+    void disableConcurrentReads();
+
     //! Pair of GDAL base dataset and "real" dataset handles.
     struct DatasetPair
     {
@@ -2342,6 +2342,9 @@ void QgsOgrProvider::computeCapabilities()
     }
   }
 
+  // feature iterators only use their own dataset, or lock the shared one
+  ability |= ThreadAgnosticFeatureIterators;
+
   if ( updateModeActivated )
     leaveUpdateMode();
 
@@ -29,9 +29,12 @@
 #include "qgssettings.h"
 
 #include <QApplication>
+#include <QDateTime>
 #include <QThread>
 
 #include <climits>
+#include <cstring>
+#include <limits>
 
 // for htonl
 #ifdef Q_OS_WIN
@@ -1200,6 +1203,18 @@ PGresult *QgsPostgresConn::PQexecPrepared( const QString &stmtName, const QStrin
   return res;
 }
 
+int QgsPostgresConn::PQputCopyData( const QByteArray &buffer )
+{
+  Q_ASSERT( mConn );
+  return ::PQputCopyData( mConn, buffer.constData(), buffer.size() );
+}
+
+int QgsPostgresConn::PQputCopyEnd( const QString &errorMessage )
+{
+  Q_ASSERT( mConn );
+  return ::PQputCopyEnd( mConn, errorMessage.isNull() ? nullptr : errorMessage.toUtf8().constData() );
+}
+
 void QgsPostgresConn::PQfinish()
 {
   Q_ASSERT( mConn );
@@ -1380,6 +1395,174 @@ QString QgsPostgresConn::fieldExpression( const QgsField &fld, QString expr )
   }
 }
 
+QString QgsPostgresConn::binaryFieldExpression( const QgsField &fld )
+{
+  const QString &type = fld.typeName();
+  if ( type == QLatin1String( "int2" ) ||
+       type == QLatin1String( "int4" ) ||
+       type == QLatin1String( "int8" ) ||
+       type == QLatin1String( "float8" ) ||
+       type == QLatin1String( "bool" ) ||
+       type == QLatin1String( "date" ) )
+  {
+    return quotedIdentifier( fld.name() );
+  }
+
+  // timestamps are only decoded when stored as 64bit integers
+  if ( type == QLatin1String( "timestamp" ) )
+  {
+    const char *integerDateTimes = ::PQparameterStatus( mConn, "integer_datetimes" );
+    if ( integerDateTimes && qstrcmp( integerDateTimes, "on" ) == 0 )
+      return quotedIdentifier( fld.name() );
+  }
+
+  return fieldExpression( fld );
+}
+
+static quint16 binaryUInt16( const char *p, bool swapEndian )
+{
+  quint16 v;
+  memcpy( &v, p, sizeof( v ) );
+  return swapEndian ? ntohs( v ) : v;
+}
+
+static quint32 binaryUInt32( const char *p, bool swapEndian )
+{
+  quint32 v;
+  memcpy( &v, p, sizeof( v ) );
+  return swapEndian ? ntohl( v ) : v;
+}
+
+static quint64 binaryUInt64( const char *p, bool swapEndian )
+{
+  if ( swapEndian )
+  {
+    quint64 v = binaryUInt32( p, true );
+    v <<= 32;
+    return v | binaryUInt32( p + sizeof( quint32 ), true );
+  }
+
+  quint64 v;
+  memcpy( &v, p, sizeof( v ) );
+  return v;
+}
+
+bool QgsPostgresConn::getBinaryValue( QgsPostgresResult &queryResult, int row, int col, QVariant::Type type, QVariant &value )
+{
+  // type oids from pg_type.h
+  const int BOOLOID = 16;
+  const int INT8OID = 20;
+  const int INT2OID = 21;
+  const int INT4OID = 23;
+  const int FLOAT8OID = 701;
+  const int DATEOID = 1082;
+  const int TIMESTAMPOID = 1114;
+
+  const int oid = queryResult.PQftype( col );
+  switch ( oid )
+  {
+    case BOOLOID:
+    case INT8OID:
+    case INT2OID:
+    case INT4OID:
+    case FLOAT8OID:
+    case DATEOID:
+    case TIMESTAMPOID:
+      break;
+
+    default:
+      return false;
+  }
+
+  if ( queryResult.PQgetisnull( row, col ) )
+  {
+    value = QVariant( type );
+    return true;
+  }
+
+  const char *p = ::PQgetvalue( queryResult.result(), row, col );
+  const QDate epoch( 2000, 1, 1 );
+
+  switch ( oid )
+  {
+    case BOOLOID:
+      value = *p != 0;
+      break;
+
+    case INT2OID:
+      value = static_cast< int >( static_cast< qint16 >( binaryUInt16( p, mSwapEndian ) ) );
+      break;
+
+    case INT4OID:
+      value = static_cast< int >( static_cast< qint32 >( binaryUInt32( p, mSwapEndian ) ) );
+      break;
+
+    case INT8OID:
+      value = static_cast< qlonglong >( binaryUInt64( p, mSwapEndian ) );
+      break;
+
+    case FLOAT8OID:
+    {
+      const quint64 bits = binaryUInt64( p, mSwapEndian );
+      double number;
+      memcpy( &number, &bits, sizeof( number ) );
+      value = number;
+      break;
+    }
+
+    case DATEOID:
+    {
+      // days since 2000-01-01, infinity and -infinity are the int32 limits
+      const qint32 days = static_cast< qint32 >( binaryUInt32( p, mSwapEndian ) );
+      const QDate date = epoch.addDays( days );
+      if ( days == std::numeric_limits< qint32 >::max() || days == std::numeric_limits< qint32 >::min() ||
+           date.year() < 1 || date.year() > 9999 )
+        value = QVariant( type );
+      else
+        value = date;
+      break;
+    }
+
+    case TIMESTAMPOID:
+    {
+      // microseconds since 2000-01-01 00:00, infinity and -infinity are the int64 limits
+      const qint64 usecs = static_cast< qint64 >( binaryUInt64( p, mSwapEndian ) );
+      if ( usecs == std::numeric_limits< qint64 >::max() || usecs == std::numeric_limits< qint64 >::min() )
+      {
+        value = QVariant( type );
+        break;
+      }
+
+      const qint64 usecsPerDay = Q_INT64_C( 86400000000 );
+      qint64 days = usecs / usecsPerDay;
+      qint64 timeOfDay = usecs % usecsPerDay;
+      if ( timeOfDay < 0 )
+      {
+        timeOfDay += usecsPerDay;
+        days--;
+      }
+
+      const QDate date = epoch.addDays( days );
+      if ( date.year() < 1 || date.year() > 9999 )
+      {
+        value = QVariant( type );
+        break;
+      }
+
+      // round to milliseconds like when the text representation is parsed
+      const int msecs = qMin( qRound( ( timeOfDay % 1000000 ) / 1000.0 ), 999 );
+      const int secs = static_cast< int >( timeOfDay / 1000000 );
+      value = QDateTime( date, QTime( secs / 3600, ( secs / 60 ) % 60, secs % 60, msecs ) );
+      break;
+    }
+  }
+
+  if ( !value.isNull() && value.type() != type && !value.convert( type ) )
+    value = QVariant( type );
+
+  return true;
+}
+
 void QgsPostgresConn::deduceEndian()
 {
   // need to store the PostgreSQL endian format used in binary cursors
@@ -253,6 +253,8 @@ class QgsPostgresConn : public QObject
     PGresult *PQgetResult();
     PGresult *PQprepare( const QString &stmtName, const QString &query, int nParams, const Oid *paramTypes );
     PGresult *PQexecPrepared( const QString &stmtName, const QStringList &params );
+    int PQputCopyData( const QByteArray &buffer );
+    int PQputCopyEnd( const QString &errorMessage = QString() );
 
     bool begin();
     bool commit();
@@ -314,6 +316,22 @@ class QgsPostgresConn : public QObject
 
     QString fieldExpression( const QgsField &fld, QString expr = "%1" );
 
+    /**
+     * Returns the expression selecting the field \a fld in a binary cursor. Fields
+     * of types which can be decoded by getBinaryValue() are selected as they are,
+     * other fields are cast to text like with fieldExpression().
+     * \since QGIS 3.2
+     */
+    QString binaryFieldExpression( const QgsField &fld );
+
+    /**
+     * Decodes in \a value the binary representation of the column \a col of \a row,
+     * converted to \a type.
+     * \returns false if the column is not of a type decoded from its binary representation
+     * \since QGIS 3.2
+     */
+    bool getBinaryValue( QgsPostgresResult &queryResult, int row, int col, QVariant::Type type, QVariant &value );
+
     QString connInfo() const { return mConnInfo; }
 
     /**
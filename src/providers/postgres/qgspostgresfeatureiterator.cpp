@@ -636,7 +636,7 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString &whereClause, long
     if ( mSource->mPrimaryKeyAttrs.contains( idx ) )
       continue;
 
-    query += delim + mConn->fieldExpression( mSource->mFields.at( idx ) );
+    query += delim + mConn->binaryFieldExpression( mSource->mFields.at( idx ) );
   }
 
   query += " FROM " + mSource->mQuery;
@@ -813,7 +813,9 @@ void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, QgsPostgresResult
     return;
 
   const QgsField fld = mSource->mFields.at( idx );
-  QVariant v = QgsPostgresProvider::convertValue( fld.type(), fld.subType(), queryResult.PQgetvalue( row, col ) );
+  QVariant v;
+  if ( !mConn->getBinaryValue( queryResult, row, col, fld.type(), v ) )
+    v = QgsPostgresProvider::convertValue( fld.type(), fld.subType(), queryResult.PQgetvalue( row, col ) );
   feature.setAttribute( idx, v );
 
   col++;
@@ -1268,6 +1268,9 @@ bool QgsPostgresProvider::hasSufficientPermsAndCapabilities()
   // supports layer metadata
   mEnabledCapabilities |= QgsVectorDataProvider::ReadLayerMetadata;
 
+  // feature iterators only use their own connection
+  mEnabledCapabilities |= QgsVectorDataProvider::ThreadAgnosticFeatureIterators;
+
   if ( ( mEnabledCapabilities & QgsVectorDataProvider::ChangeGeometries ) &&
        ( mEnabledCapabilities & QgsVectorDataProvider::ChangeAttributeValues ) &&
        mSpatialColType != SctTopoGeometry )
@@ -1996,6 +1999,9 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist, Flags flags )
   if ( mIsQuery )
     return false;
 
+  if ( ( flags & QgsFeatureSink::FastInsert ) && canCopyFeatures() )
+    return copyFeatures( flist );
+
   QgsPostgresConn *conn = connectionRW();
   if ( !conn )
   {
@@ -2269,6 +2275,282 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist, Flags flags )
   return returnvalue;
 }
 
+bool QgsPostgresProvider::canCopyFeatures() const
+{
+  // geometries are sent as hex EWKB, which only geometry columns accept
+  if ( !mGeometryColumn.isNull() && ( mSpatialColType != SctGeometry || connectionRO()->majorVersion() < 2 ) )
+    return false;
+
+  // arrays and hstore values are only converted to literals by quotedValue()
+  for ( const QgsField &fld : mAttributeFields )
+  {
+    if ( fld.type() == QVariant::Map || fld.type() == QVariant::List || fld.type() == QVariant::StringList )
+      return false;
+  }
+
+  // views, even updatable ones, and foreign tables do not accept COPY FROM
+  const Relkind kind = relkind();
+  return kind == Relkind::OrdinaryTable || kind == Relkind::PartitionedTable;
+}
+
+// escapes a value for the text format of COPY
+static void appendCopyValue( QByteArray &data, const QString &value )
+{
+  if ( value.isNull() )
+  {
+    data += "\\N";
+    return;
+  }
+
+  const QByteArray utf8 = value.toUtf8();
+  for ( char c : utf8 )
+  {
+    switch ( c )
+    {
+      case '\\':
+        data += "\\\\";
+        break;
+      case '\t':
+        data += "\\t";
+        break;
+      case '\n':
+        data += "\\n";
+        break;
+      case '\r':
+        data += "\\r";
+        break;
+      default:
+        data += c;
+        break;
+    }
+  }
+}
+
+// evaluates a default value clause for several rows with a single query, volatile
+// defaults like nextval() are evaluated once per row
+static QStringList evaluateDefaultValues( QgsPostgresConn *conn, const QString &defaultValue, int count )
+{
+  QgsPostgresResult result( conn->PQexec( QStringLiteral( "SELECT %1 FROM generate_series(1,%2)" ).arg( defaultValue ).arg( count ) ) );
+  if ( result.PQresultStatus() != PGRES_TUPLES_OK || result.PQntuples() != count )
+    throw PGException( result );
+
+  QStringList values;
+  values.reserve( count );
+  for ( int row = 0; row < count; ++row )
+    values << result.PQgetvalue( row, 0 );
+  return values;
+}
+
+bool QgsPostgresProvider::copyFeatures( QgsFeatureList &flist )
+{
+  QgsPostgresConn *conn = connectionRW();
+  if ( !conn )
+  {
+    return false;
+  }
+  conn->lock();
+
+  bool returnvalue = true;
+
+  try
+  {
+    conn->begin();
+
+    // columns are chosen like the parameters of the INSERT statement of addFeatures()
+    QString columns;
+    QString delim;
+
+    if ( !mGeometryColumn.isNull() )
+    {
+      columns += quotedIdentifier( mGeometryColumn );
+      delim = ',';
+    }
+
+    QList<int> fieldId;
+    QStringList defaultValues;
+    // whether the value of the attribute is the same for all features
+    QList<bool> constant;
+
+    if ( mPrimaryKeyType == PktInt || mPrimaryKeyType == PktFidMap || mPrimaryKeyType == PktUint64 )
+    {
+      Q_FOREACH ( int idx, mPrimaryKeyAttrs )
+      {
+        columns += delim + quotedIdentifier( field( idx ).name() );
+        delim = ',';
+        fieldId << idx;
+        defaultValues << defaultValueClause( idx );
+        constant << false;
+      }
+    }
+
+    QgsAttributes attributevec = flist[0].attributes();
+
+    for ( int idx = 0; idx < attributevec.count(); ++idx )
+    {
+      QVariant v = attributevec.value( idx, QVariant( QVariant::Int ) ); // default to NULL for missing attributes
+      if ( fieldId.contains( idx ) )
+        continue;
+
+      if ( idx >= mAttributeFields.count() )
+        continue;
+
+      QString fieldname = mAttributeFields.at( idx ).name();
+      if ( fieldname.isEmpty() || fieldname == mGeometryColumn )
+        continue;
+
+      int i;
+      for ( i = 1; i < flist.size(); i++ )
+      {
+        QgsAttributes attrs2 = flist[i].attributes();
+        QVariant v2 = attrs2.value( idx, QVariant( QVariant::Int ) ); // default to NULL for missing attributes
+
+        if ( v2 != v )
+          break;
+      }
+
+      QString defVal = defaultValueClause( idx );
+
+      // the column default is used when all the features have the default value
+      if ( i == flist.size() && v == defVal && defVal.isNull() == v.isNull() )
+        continue;
+
+      columns += delim + quotedIdentifier( fieldname );
+      delim = ',';
+      fieldId << idx;
+      defaultValues << defVal;
+      constant << ( i == flist.size() );
+    }
+
+    const QString copy = QStringLiteral( "COPY %1(%2) FROM STDIN" ).arg( mQuery, columns );
+    QgsDebugMsg( QString( "copy features: %1" ).arg( copy ) );
+
+    const QByteArray srid = ( mRequestedSrid.isEmpty() ? mDetectedSrid : mRequestedSrid ).toUtf8();
+    const bool forceMulti = QgsWkbTypes::isMultiType( wkbType() );
+
+    // default values are queried on the same connection in a transaction, so each block of features
+    // is prepared before it is copied
+    const int blockSize = 10000;
+    for ( int start = 0; start < flist.size(); start += blockSize )
+    {
+      const int end = qMin( start + blockSize, flist.size() );
+
+      // the default values needed by the block are evaluated with one query per column
+      QVector< QStringList > blockDefaultValues( fieldId.size() );
+      QVector< int > nextDefaultValue( fieldId.size(), 0 );
+      for ( int i = 0; i < fieldId.size(); i++ )
+      {
+        if ( constant[i] || defaultValues[i].isNull() )
+          continue;
+
+        int count = 0;
+        for ( int f = start; f < end; ++f )
+        {
+          const QVariant value = flist[f].attributes().value( fieldId[i], QVariant( QVariant::Int ) );
+          if ( value.isNull() || value.toString() == defaultValues[i] )
+            ++count;
+        }
+        if ( count > 0 )
+          blockDefaultValues[i] = evaluateDefaultValues( conn, defaultValues[i], count );
+      }
+
+      QByteArray data;
+      for ( int f = start; f < end; ++f )
+      {
+        QgsFeature &feature = flist[f];
+        QgsAttributes attrs = feature.attributes();
+
+        QByteArray separator;
+        if ( !mGeometryColumn.isNull() )
+        {
+          QgsGeometry geom = feature.geometry();
+          if ( geom.isNull() )
+          {
+            data += "\\N";
+          }
+          else
+          {
+            QgsGeometry convertedGeom( convertToProviderType( geom ) );
+            if ( convertedGeom )
+              geom = convertedGeom;
+            if ( forceMulti )
+              geom.convertToMultiType();
+            data += "SRID=" + srid + ';' + geom.asWkb().toHex();
+          }
+          separator = "\t";
+        }
+
+        for ( int i = 0; i < fieldId.size(); i++ )
+        {
+          int attrIdx = fieldId[i];
+          QVariant value = attrIdx < attrs.length() ? attrs.at( attrIdx ) : QVariant( QVariant::Int );
+
+          QString v;
+          if ( constant[i] )
+          {
+            v = value.isNull() ? QString() : value.toString();
+          }
+          else if ( value.isNull() )
+          {
+            QgsField fld = field( attrIdx );
+            if ( !defaultValues[ i ].isNull() )
+              v = blockDefaultValues[i].at( nextDefaultValue[i]++ );
+            feature.setAttribute( attrIdx, convertValue( fld.type(), fld.subType(), v ) );
+          }
+          else
+          {
+            v = value.toString();
+            if ( v == defaultValues[ i ] && !defaultValues[ i ].isNull() )
+              v = blockDefaultValues[i].at( nextDefaultValue[i]++ );
+
+            if ( v != value.toString() )
+            {
+              QgsField fld = field( attrIdx );
+              feature.setAttribute( attrIdx, convertValue( fld.type(), fld.subType(), v ) );
+            }
+          }
+
+          data += separator;
+          appendCopyValue( data, v );
+          separator = "\t";
+        }
+        data += '\n';
+      }
+
+      QgsPostgresResult result( conn->PQexec( copy, false ) );
+      if ( result.PQresultStatus() != PGRES_COPY_IN )
+        throw PGException( result );
+
+      if ( conn->PQputCopyData( data ) == 1 )
+        conn->PQputCopyEnd();
+      else
+        conn->PQputCopyEnd( tr( "Sending features failed" ) );
+
+      // the status of the command follows the data, and the end of the results has to be read too
+      result = conn->PQgetResult();
+      while ( PGresult *next = conn->PQgetResult() )
+        ::PQclear( next );
+
+      if ( result.PQresultStatus() != PGRES_COMMAND_OK )
+        throw PGException( result );
+    }
+
+    returnvalue &= conn->commit();
+    if ( mTransaction )
+      mTransaction->dirtyLastSavePoint();
+
+    mShared->addFeaturesCounted( flist.size() );
+  }
+  catch ( PGException &e )
+  {
+    pushError( tr( "PostGIS error while adding features: %1" ).arg( e.errorMessage() ) );
+    conn->rollback();
+    returnvalue = false;
+  }
+
+  conn->unlock();
+  return returnvalue;
+}
+
 bool QgsPostgresProvider::deleteFeatures( const QgsFeatureIds &id )
 {
   bool returnvalue = true;
@@ -427,6 +427,18 @@ class QgsPostgresProvider : public QgsVectorDataProvider
 
     QString paramValue( const QString &fieldvalue, const QString &defaultValue ) const;
 
+    /**
+     * Returns true if features can be added with COPY instead of INSERT statements.
+     * COPY is much faster, but does not return the keys of the new features.
+     */
+    bool canCopyFeatures() const;
+
+    /**
+     * Adds features with COPY ... FROM STDIN, for addFeatures() when the keys of the new
+     * features are not needed.
+     */
+    bool copyFeatures( QgsFeatureList &flist );
+
     QgsPostgresConn *mConnectionRO = nullptr ; //! read-only database connection (initially)
     QgsPostgresConn *mConnectionRW = nullptr ; //! read-write database connection (on update)
 
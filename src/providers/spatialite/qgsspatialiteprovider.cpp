@@ -516,6 +516,8 @@ QgsSpatiaLiteProvider::QgsSpatiaLiteProvider( QString const &uri )
     return;
   }
   mEnabledCapabilities = mPrimaryKey.isEmpty() ? QgsVectorDataProvider::Capabilities() : ( QgsVectorDataProvider::SelectAtId );
+  // feature iterators only use their own statement
+  mEnabledCapabilities |= QgsVectorDataProvider::ThreadAgnosticFeatureIterators;
   if ( ( mTableBased || mViewBased ) &&  !mReadOnly )
   {
     // enabling editing only for Tables [excluding Views and VirtualShapes]
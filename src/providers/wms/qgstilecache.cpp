@@ -18,44 +18,191 @@
 #include "qgsnetworkaccessmanager.h"
 #include "qgsapplication.h"
 #include <QAbstractNetworkCache>
+#include <QAtomicInt>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QImage>
+#include <QMutex>
+#include <QUrl>
 
-QCache<QUrl, QImage> QgsTileCache::sTileCache( 256 );
-QMutex QgsTileCache::sTileCacheMutex;
+///@cond PRIVATE
+namespace
+{
+  //! Number of shards of the in-memory cache
+  const int SHARD_COUNT = 8;
+
+  //! Part of the in-memory cache, holding the tiles whose URL hash falls in it
+  struct Shard
+  {
+    //! 256 tiles in total
+    QCache<QUrl, QImage> cache { 256 / SHARD_COUNT };
+    //! mutex to protect the cache of the shard
+    QMutex mutex;
+  };
+
+  Shard *shards()
+  {
+    static Shard sShards[SHARD_COUNT];
+    return sShards;
+  }
+
+  Shard &shardForUrl( const QUrl &url )
+  {
+    return shards()[ qHash( url ) % SHARD_COUNT ];
+  }
+
+  //! Tiles being downloaded, with the time since their download started
+  QHash<QUrl, QElapsedTimer> sFetching;
+  //! mutex to protect the tiles being downloaded and the download counters
+  QMutex sFetchingMutex;
+
+  QAtomicInt sMemoryHits;
+  QAtomicInt sDiskHits;
+  QAtomicInt sMisses;
+  int sFetches = 0;
+  int sCoalescedFetches = 0;
+  qint64 sFetchTime = 0;
+}
+///@endcond
 
 
 void QgsTileCache::insertTile( const QUrl &url, const QImage &image )
 {
-  QMutexLocker locker( &sTileCacheMutex );
-  sTileCache.insert( url, new QImage( image ) );
+  Shard &shard = shardForUrl( url );
+  QMutexLocker locker( &shard.mutex );
+  shard.cache.insert( url, new QImage( image ) );
 }
 
-bool QgsTileCache::tile( const QUrl &url, QImage &image )
+bool QgsTileCache::tile( const QUrl &url, QImage &image, bool updateStatistics )
 {
-  QMutexLocker locker( &sTileCacheMutex );
-  bool success = false;
-  if ( QImage *i = sTileCache.object( url ) )
+  Shard &shard = shardForUrl( url );
   {
-    image = *i;
-    success = true;
+    QMutexLocker locker( &shard.mutex );
+    if ( QImage *i = shard.cache.object( url ) )
+    {
+      image = *i;
+      if ( updateStatistics )
+        sMemoryHits.ref();
+      return true;
+    }
   }
-  else if ( QgsNetworkAccessManager::instance()->cache()->metaData( url ).isValid() )
+
+  // read and decode the tile without holding the lock, it is much slower than a memory lookup
+  bool success = false;
+  QAbstractNetworkCache *diskCache = QgsNetworkAccessManager::instance()->cache();
+  if ( diskCache && diskCache->metaData( url ).isValid() )
   {
-    if ( QIODevice *data = QgsNetworkAccessManager::instance()->cache()->data( url ) )
+    if ( QIODevice *data = diskCache->data( url ) )
     {
       QByteArray imageData = data->readAll();
       delete data;
 
       image = QImage::fromData( imageData );
 
-      // cache it as well (mutex is already locked)
+      // cache it as well
       // Check for null because it could be a redirect (see: https://issues.qgis.org/issues/16427 )
       if ( ! image.isNull( ) )
       {
-        sTileCache.insert( url, new QImage( image ) );
+        insertTile( url, image );
         success = true;
       }
     }
   }
+
+  if ( !updateStatistics )
+    return success;
+
+  if ( success )
+    sDiskHits.ref();
+  else
+    sMisses.ref();
   return success;
 }
+
+int QgsTileCache::totalCost()
+{
+  int cost = 0;
+  for ( int i = 0; i < SHARD_COUNT; ++i )
+  {
+    Shard &shard = shards()[i];
+    QMutexLocker locker( &shard.mutex );
+    cost += shard.cache.totalCost();
+  }
+  return cost;
+}
+
+int QgsTileCache::maxCost()
+{
+  int cost = 0;
+  for ( int i = 0; i < SHARD_COUNT; ++i )
+  {
+    Shard &shard = shards()[i];
+    QMutexLocker locker( &shard.mutex );
+    cost += shard.cache.maxCost();
+  }
+  return cost;
+}
+
+bool QgsTileCache::startFetching( const QUrl &url )
+{
+  QMutexLocker locker( &sFetchingMutex );
+  if ( sFetching.contains( url ) )
+  {
+    sCoalescedFetches++;
+    return false;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  sFetching.insert( url, timer );
+  return true;
+}
+
+void QgsTileCache::finishFetching( const QUrl &url )
+{
+  {
+    QMutexLocker locker( &sFetchingMutex );
+    auto it = sFetching.find( url );
+    if ( it == sFetching.end() )
+      return;
+
+    sFetches++;
+    sFetchTime += it.value().elapsed();
+    sFetching.erase( it );
+  }
+
+  emit notifier()->tileFetched( url );
+}
+
+QgsTileFetchNotifier *QgsTileCache::notifier()
+{
+  static QgsTileFetchNotifier sNotifier;
+  return &sNotifier;
+}
+
+QgsTileCache::Statistics QgsTileCache::statistics()
+{
+  Statistics stats;
+  stats.memoryHits = sMemoryHits.load();
+  stats.diskHits = sDiskHits.load();
+  stats.misses = sMisses.load();
+
+  QMutexLocker locker( &sFetchingMutex );
+  stats.fetches = sFetches;
+  stats.coalescedFetches = sCoalescedFetches;
+  stats.fetchTime = sFetchTime;
+  return stats;
+}
+
+void QgsTileCache::resetStatistics()
+{
+  sMemoryHits.store( 0 );
+  sDiskHits.store( 0 );
+  sMisses.store( 0 );
+
+  QMutexLocker locker( &sFetchingMutex );
+  sFetches = 0;
+  sCoalescedFetches = 0;
+  sFetchTime = 0;
+}
@@ -17,43 +17,95 @@
 #define QGSTILECACHE_H
 
 
-#include <QCache>
-#include <QMutex>
+#include <QObject>
 
 class QImage;
 class QUrl;
 
+/**
+ * Emits a signal each time a tile download registered with QgsTileCache::startFetching() is finished,
+ * so that the downloads waiting for the same tile can use it.
+ */
+class QgsTileFetchNotifier : public QObject
+{
+    Q_OBJECT
+
+  signals:
+
+    //! Emitted when the download of the tile with given URL is finished, successfully or not
+    void tileFetched( const QUrl &url );
+};
+
 /**
  * A simple tile cache implementation. Tiles are cached according to their URL.
  * There is a small in-memory cache and a secondary caching in the local disk.
  * The in-memory cache is there to save CPU time otherwise wasted to read and
  * uncompress data saved on the disk.
  *
+ * The in-memory cache is split in shards with their own mutex, and tiles read from
+ * the disk are decoded without holding any lock, so that renderers in several threads
+ * can look up tiles at once.
+ *
+ * The cache also keeps track of the tiles being downloaded, so that a tile requested
+ * by several providers or map renderers at the same time is only downloaded once.
+ *
  * The class is thread safe (its methods can be called from any thread).
  */
 class QgsTileCache
 {
   public:
 
+    //! Counters of the tile cache, since the start of the application or the last resetStatistics()
+    struct Statistics
+    {
+      //! Number of tiles found in the in-memory cache
+      int memoryHits = 0;
+      //! Number of tiles found in the disk cache
+      int diskHits = 0;
+      //! Number of tiles found in none of the caches
+      int misses = 0;
+      //! Number of finished tile downloads
+      int fetches = 0;
+      //! Number of tile downloads avoided because the same tile was already being downloaded
+      int coalescedFetches = 0;
+      //! Total time of the finished tile downloads, in milliseconds
+      qint64 fetchTime = 0;
+    };
+
     //! Add a tile image with given URL to the cache
     static void insertTile( const QUrl &url, const QImage &image );
 
     /**
-     * Try to access a tile and load it into "image" argument
+     * Try to access a tile and load it into "image" argument.
+     * If \a updateStatistics is false, the lookup is not counted as a hit or a miss, e.g. when
+     * the tile was already looked up for the same draw.
      * \returns true if the tile exists in the cache
      */
-    static bool tile( const QUrl &url, QImage &image );
+    static bool tile( const QUrl &url, QImage &image, bool updateStatistics = true );
 
     //! how many tiles are stored in the in-memory cache
-    static int totalCost() { return sTileCache.totalCost(); }
+    static int totalCost();
     //! how many tiles can be stored in the in-memory cache
-    static int maxCost() { return sTileCache.maxCost(); }
+    static int maxCost();
+
+    /**
+     * Registers the download of the tile with given URL.
+     * \returns false if the tile is already being downloaded, in which case the caller should wait for
+     * the tileFetched() signal of notifier() and look the tile up in the cache instead of downloading it
+     */
+    static bool startFetching( const QUrl &url );
+
+    //! Unregisters the download of the tile with given URL and notifies the downloads waiting for it
+    static void finishFetching( const QUrl &url );
+
+    //! Returns the object notifying the end of tile downloads
+    static QgsTileFetchNotifier *notifier();
+
+    //! Returns the counters of the cache
+    static Statistics statistics();
 
-  private:
-    //! in-memory cache
-    static QCache<QUrl, QImage> sTileCache;
-    //! mutex to protect the in-memory cache
-    static QMutex sTileCacheMutex;
+    //! Resets the counters of the cache
+    static void resetStatistics();
 };
 
 #endif // QGSTILECACHE_H
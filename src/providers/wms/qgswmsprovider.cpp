@@ -859,6 +859,12 @@ QImage *QgsWmsProvider::draw( QgsRectangle const &viewExtent, int pixelWidth, in
     }
 
     QgsDebugMsg( QString( "TILE CACHE total: %1 / %2" ).arg( QgsTileCache::totalCost() ).arg( QgsTileCache::maxCost() ) );
+#ifdef QGISDEBUG
+    const QgsTileCache::Statistics tileStats = QgsTileCache::statistics();
+    QgsDebugMsgLevel( QString( "TILE CACHE hits: %1 memory, %2 disk; misses: %3; fetches: %4 (%5 ms), coalesced: %6" )
+                      .arg( tileStats.memoryHits ).arg( tileStats.diskHits ).arg( tileStats.misses )
+                      .arg( tileStats.fetches ).arg( tileStats.fetchTime ).arg( tileStats.coalescedFetches ), 2 );
+#endif
 
 #if 0
     const QgsWmsStatistics::Stat &stat = QgsWmsStatistics::statForUri( dataSourceUri() );
@@ -3740,6 +3746,10 @@ QgsWmsTiledImageDownloadHandler::QgsWmsTiledImageDownloadHandler( const QString
       return;
   }
 
+  // tiles already being downloaded by other handlers, possibly for other providers or
+  // in other threads, are not requested again: the handler waits for them instead
+  connect( QgsTileCache::notifier(), &QgsTileFetchNotifier::tileFetched, this, &QgsWmsTiledImageDownloadHandler::tileFetched, Qt::QueuedConnection );
+
   Q_FOREACH ( const QgsWmsProvider::TileRequest &r, requests )
   {
     QNetworkRequest request( r.url );
@@ -3751,6 +3761,14 @@ QgsWmsTiledImageDownloadHandler::QgsWmsTiledImageDownloadHandler( const QString
     request.setAttribute( static_cast<QNetworkRequest::Attribute>( TileRect ), r.rect );
     request.setAttribute( static_cast<QNetworkRequest::Attribute>( TileRetry ), 0 );
 
+    if ( !QgsTileCache::startFetching( r.url ) )
+    {
+      QgsDebugMsgLevel( QString( "waiting for tile being downloaded: %1" ).arg( r.url.toString() ), 3 );
+      mWaitingTiles.insert( r.url, request );
+      continue;
+    }
+    mFetchingUrls.insert( r.index, r.url );
+
     QNetworkReply *reply = QgsNetworkAccessManager::instance()->get( request );
     connect( reply, &QNetworkReply::finished, this, &QgsWmsTiledImageDownloadHandler::tileReplyFinished );
 
@@ -3760,6 +3778,12 @@ QgsWmsTiledImageDownloadHandler::QgsWmsTiledImageDownloadHandler( const QString
 
 QgsWmsTiledImageDownloadHandler::~QgsWmsTiledImageDownloadHandler()
 {
+  // do not let other handlers wait for tiles which will not be downloaded
+  Q_FOREACH ( const QUrl &url, mFetchingUrls )
+  {
+    QgsTileCache::finishFetching( url );
+  }
+
   delete mEventLoop;
 }
 
@@ -3768,11 +3792,86 @@ void QgsWmsTiledImageDownloadHandler::downloadBlocking()
   if ( mFeedback && mFeedback->isCanceled() )
     return; // nothing to do
 
+  if ( mReplies.isEmpty() && mWaitingTiles.isEmpty() )
+    return; // nothing to do
+
   mEventLoop->exec( QEventLoop::ExcludeUserInputEvents );
 
   Q_ASSERT( mReplies.isEmpty() );
 }
 
+void QgsWmsTiledImageDownloadHandler::drawTile( const QRectF &rect, const QImage &image )
+{
+  double cr = mViewExtent.width() / mImage->width();
+
+  QRectF dst( ( rect.left() - mViewExtent.xMinimum() ) / cr,
+              ( mViewExtent.yMaximum() - rect.bottom() ) / cr,
+              rect.width() / cr,
+              rect.height() / cr );
+
+  QPainter p( mImage );
+  if ( mSmoothPixmapTransform )
+    p.setRenderHint( QPainter::SmoothPixmapTransform, true );
+  p.drawImage( dst, image );
+}
+
+void QgsWmsTiledImageDownloadHandler::removeReply( QNetworkReply *reply )
+{
+  int tileNo = reply->request().attribute( static_cast<QNetworkRequest::Attribute>( TileIndex ) ).toInt();
+
+  mReplies.removeOne( reply );
+  reply->deleteLater();
+
+  if ( mFetchingUrls.contains( tileNo ) )
+  {
+    bool tileRequested = false;
+    Q_FOREACH ( QNetworkReply *other, mReplies )
+    {
+      if ( other->request().attribute( static_cast<QNetworkRequest::Attribute>( TileIndex ) ).toInt() == tileNo )
+      {
+        tileRequested = true;
+        break;
+      }
+    }
+    if ( !tileRequested )
+      QgsTileCache::finishFetching( mFetchingUrls.take( tileNo ) );
+  }
+
+  if ( mReplies.isEmpty() && mWaitingTiles.isEmpty() )
+    finish();
+}
+
+void QgsWmsTiledImageDownloadHandler::tileFetched( const QUrl &url )
+{
+  auto it = mWaitingTiles.find( url );
+  if ( it == mWaitingTiles.end() )
+    return;
+
+  QNetworkRequest request = it.value();
+  mWaitingTiles.erase( it );
+
+  // the tile was already counted as a miss when the draw looked it up
+  QImage image;
+  if ( QgsTileCache::tile( url, image, false ) )
+  {
+    drawTile( request.attribute( static_cast<QNetworkRequest::Attribute>( TileRect ) ).toRectF(), image );
+
+    if ( mFeedback )
+      mFeedback->onNewData();
+  }
+  else if ( !( mFeedback && mFeedback->isCanceled() ) )
+  {
+    // the other download failed or was canceled, try it ourselves
+    QgsDebugMsgLevel( QString( "downloading tile not fetched by other handler: %1" ).arg( url.toString() ), 3 );
+    QNetworkReply *reply = QgsNetworkAccessManager::instance()->get( request );
+    connect( reply, &QNetworkReply::finished, this, &QgsWmsTiledImageDownloadHandler::tileReplyFinished );
+    mReplies << reply;
+  }
+
+  if ( mReplies.isEmpty() && mWaitingTiles.isEmpty() )
+    finish();
+}
+
 
 void QgsWmsTiledImageDownloadHandler::tileReplyFinished()
 {
@@ -3866,12 +3965,7 @@ void QgsWmsTiledImageDownloadHandler::tileReplyFinished()
 
       QgsWmsProvider::showMessageBox( tr( "Tile request error" ), tr( "Status: %1\nReason phrase: %2" ).arg( status.toInt() ).arg( phrase.toString() ) );
 
-      mReplies.removeOne( reply );
-      reply->deleteLater();
-
-      if ( mReplies.isEmpty() )
-        finish();
-
+      removeReply( reply );
       return;
     }
 
@@ -3905,46 +3999,30 @@ void QgsWmsTiledImageDownloadHandler::tileReplyFinished()
 #endif
       }
 
-      mReplies.removeOne( reply );
-      reply->deleteLater();
-
-      if ( mReplies.isEmpty() )
-        finish();
-
+      removeReply( reply );
       return;
     }
 
     // only take results from current request number
     if ( mTileReqNo == tileReqNo )
     {
-      double cr = mViewExtent.width() / mImage->width();
-
-      QRectF dst( ( r.left() - mViewExtent.xMinimum() ) / cr,
-                  ( mViewExtent.yMaximum() - r.bottom() ) / cr,
-                  r.width() / cr,
-                  r.height() / cr );
-
       QgsDebugMsg( QString( "tile reply: length %1" ).arg( reply->bytesAvailable() ) );
 
       QImage myLocalImage = QImage::fromData( reply->readAll() );
 
       if ( !myLocalImage.isNull() )
       {
-        QPainter p( mImage );
-        if ( mSmoothPixmapTransform )
-          p.setRenderHint( QPainter::SmoothPixmapTransform, true );
-        p.drawImage( dst, myLocalImage );
+        drawTile( r, myLocalImage );
 #if 0
         myLocalImage.save( QString( "%1/%2-tile-%3.png" ).arg( QDir::tempPath() ).arg( mTileReqNo ).arg( tileNo ) );
-        p.drawRect( dst ); // show tile bounds
-        p.drawText( dst, Qt::AlignCenter, QString( "(%1)\n%2,%3\n%4,%5\n%6x%7" )
-                    .arg( tileNo )
-                    .arg( r.left() ).arg( r.bottom() )
-                    .arg( r.right() ).arg( r.top() )
-                    .arg( r.width() ).arg( r.height() ) );
 #endif
 
         QgsTileCache::insertTile( reply->url(), myLocalImage );
+        if ( mFetchingUrls.contains( tileNo ) && mFetchingUrls.value( tileNo ) != reply->url() )
+        {
+          // redirected, waiting handlers look the tile up with the original URL
+          QgsTileCache::insertTile( mFetchingUrls.value( tileNo ), myLocalImage );
+        }
 
         if ( mFeedback )
           mFeedback->onNewData();
@@ -3960,12 +4038,7 @@ void QgsWmsTiledImageDownloadHandler::tileReplyFinished()
       QgsDebugMsg( QString( "Reply too late [%1]" ).arg( reply->url().toString() ) );
     }
 
-    mReplies.removeOne( reply );
-    reply->deleteLater();
-
-    if ( mReplies.isEmpty() )
-      finish();
-
+    removeReply( reply );
   }
   else
   {
@@ -3983,11 +4056,7 @@ void QgsWmsTiledImageDownloadHandler::tileReplyFinished()
       }
     }
 
-    mReplies.removeOne( reply );
-    reply->deleteLater();
-
-    if ( mReplies.isEmpty() )
-      finish();
+    removeReply( reply );
   }
 
 #if 0
@@ -4003,11 +4072,15 @@ void QgsWmsTiledImageDownloadHandler::tileReplyFinished()
 void QgsWmsTiledImageDownloadHandler::canceled()
 {
   QgsDebugMsg( "Caught canceled() signal" );
+  mWaitingTiles.clear();
   Q_FOREACH ( QNetworkReply *reply, mReplies )
   {
     QgsDebugMsg( "Aborting tiled network request" );
     reply->abort();
   }
+
+  if ( mReplies.isEmpty() )
+    finish();
 }
 
 
@@ -507,6 +507,9 @@ class QgsWmsTiledImageDownloadHandler : public QObject
     void tileReplyFinished();
     void canceled();
 
+    //! Draws a tile downloaded by another handler, or downloads it if the other download failed
+    void tileFetched( const QUrl &url );
+
   protected:
 
     /**
@@ -520,6 +523,15 @@ class QgsWmsTiledImageDownloadHandler : public QObject
 
     void finish() { QMetaObject::invokeMethod( mEventLoop, "quit", Qt::QueuedConnection ); }
 
+    //! Draws a tile image of given rectangle in map coordinates
+    void drawTile( const QRectF &rect, const QImage &image );
+
+    /**
+     * Removes a finished reply, for which no new request was made. Unregisters the download
+     * of its tile if there is no other request for it, and finishes once all tiles are done.
+     */
+    void removeReply( QNetworkReply *reply );
+
     QString mProviderUri;
 
     QgsWmsAuthorization mAuth;
@@ -535,6 +547,12 @@ class QgsWmsTiledImageDownloadHandler : public QObject
     //! Running tile requests
     QList<QNetworkReply *> mReplies;
 
+    //! URLs of the tiles registered with QgsTileCache::startFetching(), by tile index
+    QHash<int, QUrl> mFetchingUrls;
+
+    //! Requests of the tiles being downloaded by other handlers, by URL
+    QHash<QUrl, QNetworkRequest> mWaitingTiles;
+
     QgsRasterBlockFeedback *mFeedback = nullptr;
 };
 
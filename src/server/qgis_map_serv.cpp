@@ -23,10 +23,15 @@
 #include "qgsserverlogger.h"
 #include "qgsfcgiserverresponse.h"
 #include "qgsfcgiserverrequest.h"
+#include "qgsserversettings.h"
 
 #include <fcgi_stdio.h>
+#include <fcgiapp.h>
 #include <cstdlib>
 
+#include <QMutex>
+#include <QThread>
+
 int fcgi_accept()
 {
 #ifdef Q_OS_WIN
@@ -39,6 +44,57 @@ int fcgi_accept()
 #endif
 }
 
+/**
+ * Worker thread accepting FastCGI requests on the shared listen socket
+ * and handling them with the process wide server instance.
+ */
+class QgsFcgiServerWorker : public QThread
+{
+  public:
+    explicit QgsFcgiServerWorker( QgsServer *server )
+      : mServer( server )
+    {}
+
+  protected:
+    void run() override
+    {
+      FCGX_Request fcgxRequest;
+      FCGX_InitRequest( &fcgxRequest, 0, 0 );
+
+      while ( true )
+      {
+        int rc;
+        {
+          // Some platforms require accept() calls to be serialized
+          QMutexLocker locker( &sAcceptMutex );
+          rc = FCGX_Accept_r( &fcgxRequest );
+        }
+        if ( rc < 0 )
+          break;
+
+        {
+          QgsFcgiServerRequest  request( &fcgxRequest );
+          QgsFcgiServerResponse response( request.method(), &fcgxRequest );
+          if ( ! request.hasError() )
+          {
+            mServer->handleRequest( request, response );
+          }
+          else
+          {
+            response.sendError( 400, "Bad request" );
+          }
+        }
+        FCGX_Finish_r( &fcgxRequest );
+      }
+    }
+
+  private:
+    QgsServer *mServer = nullptr;
+    static QMutex sAcceptMutex;
+};
+
+QMutex QgsFcgiServerWorker::sAcceptMutex;
+
 int main( int argc, char *argv[] )
 {
   // Test if the environ variable DISPLAY is defined
@@ -61,9 +117,57 @@ int main( int argc, char *argv[] )
   // since version 3.0 QgsServer now needs a qApp so initialize QgsApplication
   QgsApplication app( argc, argv, withDisplay, QString(), QStringLiteral( "server" ) );
   QgsServer server;
+
+  QgsServerSettings settings;
+  int workers = settings.workers();
+
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
   server.initPython();
 #endif
+  if ( workers > 1 && !server.canHandleConcurrentRequests() )
+  {
+    QgsMessageLog::logMessage( "Server plugins are loaded, requests are handled by a single worker.", "Server", Qgis::Warning );
+    workers = 1;
+  }
+
+  if ( workers > 1 && !FCGX_IsCGI() )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Starting %1 FastCGI workers" ).arg( workers ), "Server", Qgis::Info );
+
+    FCGX_Init();
+    QList<QgsFcgiServerWorker *> threads;
+    for ( int i = 0; i < workers; ++i )
+    {
+      QgsFcgiServerWorker *worker = new QgsFcgiServerWorker( &server );
+      // The main thread runs the event loop (file system watchers,
+      // logging) until all the workers are done
+      QObject::connect( worker, &QThread::finished, &app, [&threads]
+      {
+        for ( QgsFcgiServerWorker *w : qgis::as_const( threads ) )
+        {
+          if ( !w->isFinished() )
+            return;
+        }
+        QCoreApplication::quit();
+      } );
+      threads << worker;
+    }
+    for ( QgsFcgiServerWorker *worker : qgis::as_const( threads ) )
+    {
+      worker->start();
+    }
+
+    app.exec();
+
+    for ( QgsFcgiServerWorker *worker : qgis::as_const( threads ) )
+    {
+      worker->wait();
+    }
+    qDeleteAll( threads );
+    app.exitQgis();
+    return 0;
+  }
+
   // Starts FCGI loop
   while ( fcgi_accept() >= 0 )
   {
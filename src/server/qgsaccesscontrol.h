@@ -148,6 +148,12 @@ class SERVER_EXPORT QgsAccessControl : public QgsFeatureFilterProvider
      */
     void registerAccessControl( QgsAccessControlFilter *accessControl, int priority = 0 );
 
+    /**
+     * Returns true if no access control filter is registered.
+     * \since QGIS 3.2
+     */
+    bool isEmpty() const { return mPluginsAccessControls->isEmpty(); }
+
   private:
     QString resolveFilterFeatures( const QgsVectorLayer *layer ) const;
 
@@ -18,6 +18,7 @@
 #include "qgscapabilitiescache.h"
 #include "qgslogger.h"
 #include <QCoreApplication>
+#include <QThread>
 
 QgsCapabilitiesCache::QgsCapabilitiesCache()
 {
@@ -26,8 +27,12 @@ QgsCapabilitiesCache::QgsCapabilitiesCache()
 
 const QDomDocument *QgsCapabilitiesCache::searchCapabilitiesDocument( const QString &configFilePath, const QString &key )
 {
-  QCoreApplication::processEvents(); //get updates from file system watcher
+  if ( QThread::currentThread() == thread() )
+  {
+    QCoreApplication::processEvents(); //get updates from file system watcher
+  }
 
+  QMutexLocker locker( &mMutex );
   if ( mCachedCapabilities.contains( configFilePath ) && mCachedCapabilities[ configFilePath ].contains( key ) )
   {
     return &mCachedCapabilities[ configFilePath ][ key ];
@@ -40,17 +45,18 @@ const QDomDocument *QgsCapabilitiesCache::searchCapabilitiesDocument( const QStr
 
 void QgsCapabilitiesCache::insertCapabilitiesDocument( const QString &configFilePath, const QString &key, const QDomDocument *doc )
 {
+  QMutexLocker locker( &mMutex );
   if ( mCachedCapabilities.size() > 40 )
   {
     //remove another cache entry to avoid memory problems
     QHash<QString, QHash<QString, QDomDocument> >::iterator capIt = mCachedCapabilities.begin();
-    mFileSystemWatcher.removePath( capIt.key() );
+    updateWatchedPath( capIt.key(), false );
     mCachedCapabilities.erase( capIt );
   }
 
   if ( !mCachedCapabilities.contains( configFilePath ) )
   {
-    mFileSystemWatcher.addPath( configFilePath );
+    updateWatchedPath( configFilePath, true );
     mCachedCapabilities.insert( configFilePath, QHash<QString, QDomDocument>() );
   }
 
@@ -59,13 +65,39 @@ void QgsCapabilitiesCache::insertCapabilitiesDocument( const QString &configFile
 
 void QgsCapabilitiesCache::removeCapabilitiesDocument( const QString &path )
 {
+  QMutexLocker locker( &mMutex );
   mCachedCapabilities.remove( path );
-  mFileSystemWatcher.removePath( path );
+  updateWatchedPath( path, false );
 }
 
 void QgsCapabilitiesCache::removeChangedEntry( const QString &path )
 {
   QgsDebugMsg( "Remove capabilities cache entry because file changed" );
+  QMutexLocker locker( &mMutex );
   mCachedCapabilities.remove( path );
   mFileSystemWatcher.removePath( path );
 }
+
+void QgsCapabilitiesCache::updateWatchedPath( const QString &path, bool watch )
+{
+  // the file system watcher is not thread safe, calls from worker
+  // threads are queued to the thread owning the cache
+  if ( QThread::currentThread() == thread() )
+  {
+    watch ? watchPath( path ) : unwatchPath( path );
+  }
+  else
+  {
+    QMetaObject::invokeMethod( this, watch ? "watchPath" : "unwatchPath", Qt::QueuedConnection, Q_ARG( QString, path ) );
+  }
+}
+
+void QgsCapabilitiesCache::watchPath( const QString &path )
+{
+  mFileSystemWatcher.addPath( path );
+}
+
+void QgsCapabilitiesCache::unwatchPath( const QString &path )
+{
+  mFileSystemWatcher.removePath( path );
+}
@@ -21,6 +21,7 @@
 #include <QDomDocument>
 #include <QFileSystemWatcher>
 #include <QHash>
+#include <QMutex>
 #include <QObject>
 #include "qgis_server.h"
 
@@ -60,9 +61,21 @@ class SERVER_EXPORT QgsCapabilitiesCache : public QObject
     QHash< QString, QHash< QString, QDomDocument > > mCachedCapabilities;
     QFileSystemWatcher mFileSystemWatcher;
 
+    //! Guards the cached documents, which may be accessed by FastCGI worker threads
+    QMutex mMutex;
+
+    //! Adds or removes a watched path from the thread owning the file system watcher
+    void updateWatchedPath( const QString &path, bool watch );
+
   private slots:
     //! Removes changed entry from this cache
     void removeChangedEntry( const QString &path );
+
+    //! Starts watching a configuration file
+    void watchPath( const QString &path );
+
+    //! Stops watching a configuration file
+    void unwatchPath( const QString &path );
 };
 
 #endif // QGSCAPABILITIESCACHE_H
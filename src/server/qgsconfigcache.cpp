@@ -21,6 +21,8 @@
 #include "qgsproject.h"
 
 #include <QFile>
+#include <QFileInfo>
+#include <QThread>
 
 QgsConfigCache *QgsConfigCache::instance()
 {
@@ -52,6 +54,93 @@ const QgsProject *QgsConfigCache::project( const QString &path )
   return mProjectCache[ path ];
 }
 
+void QgsConfigCache::setMaxProjectInstances( int maxInstances )
+{
+  QMutexLocker locker( &mPoolMutex );
+  mMaxProjectInstances = maxInstances;
+  mProjectReleased.wakeAll();
+}
+
+QgsProject *QgsConfigCache::acquireProject( const QString &path )
+{
+  const QDateTime lastModified = QFileInfo( path ).lastModified();
+
+  {
+    QMutexLocker locker( &mPoolMutex );
+    Q_FOREVER
+    {
+      QList<PooledProject> &idle = mProjectPool[ path ];
+      while ( !idle.isEmpty() )
+      {
+        PooledProject pooled = idle.takeLast();
+        if ( pooled.lastModified != lastModified )
+        {
+          // the project file changed since this instance was read
+          delete pooled.project;
+          mProjectInstances[ path ]--;
+          continue;
+        }
+
+        mCheckedOutProjects.insert( pooled.project, pooled.lastModified );
+        locker.unlock();
+
+        // idle instances have no thread affinity, pull it to the worker
+        pooled.project->moveToThread( QThread::currentThread() );
+        return pooled.project;
+      }
+
+      if ( mMaxProjectInstances <= 0 || mProjectInstances.value( path ) < mMaxProjectInstances )
+        break;
+
+      // every allowed instance is busy: wait for one to be released
+      mProjectReleased.wait( &mPoolMutex );
+    }
+
+    // reserve the slot before reading so that concurrent workers honor the limit
+    mProjectInstances[ path ]++;
+  }
+
+  // read the project without holding the lock so that other workers can proceed
+  std::unique_ptr<QgsProject> prj( new QgsProject() );
+  const bool ok = prj->read( path );
+
+  QMutexLocker locker( &mPoolMutex );
+  if ( !ok )
+  {
+    mProjectInstances[ path ]--;
+    mProjectReleased.wakeOne();
+    return nullptr;
+  }
+
+  mCheckedOutProjects.insert( prj.get(), lastModified );
+  return prj.release();
+}
+
+void QgsConfigCache::releaseProject( const QString &path, QgsProject *project )
+{
+  if ( !project )
+    return;
+
+  PooledProject pooled;
+  pooled.project = project;
+
+  QMutexLocker locker( &mPoolMutex );
+  pooled.lastModified = mCheckedOutProjects.take( project );
+  if ( pooled.lastModified != QFileInfo( path ).lastModified() )
+  {
+    mProjectInstances[ path ]--;
+    mProjectReleased.wakeOne();
+    locker.unlock();
+    delete project;
+    return;
+  }
+
+  // detach from the worker thread so that any worker can pull it later
+  project->moveToThread( nullptr );
+  mProjectPool[ path ].append( pooled );
+  mProjectReleased.wakeOne();
+}
+
 QDomDocument *QgsConfigCache::xmlDocument( const QString &filePath )
 {
   //first open file
@@ -95,10 +184,23 @@ void QgsConfigCache::removeChangedEntry( const QString &path )
 {
   mProjectCache.remove( path );
 
+  {
+    QMutexLocker locker( &mPoolMutex );
+    const QList<PooledProject> idle = mProjectPool.take( path );
+    for ( const PooledProject &pooled : idle )
+    {
+      delete pooled.project;
+    }
+    mProjectInstances[ path ] -= idle.size();
+    mProjectReleased.wakeAll();
+  }
+
   //xml document must be removed last, as other config cache destructors may require it
   mXmlDocumentCache.remove( path );
 
   mFileSystemWatcher.removePath( path );
+
+  emit projectRemoved( path );
 }
 
 
@@ -21,9 +21,13 @@
 #include "qgsconfig.h"
 
 #include <QCache>
+#include <QDateTime>
 #include <QFileSystemWatcher>
+#include <QHash>
 #include <QMap>
+#include <QMutex>
 #include <QObject>
+#include <QWaitCondition>
 #include <QDomDocument>
 
 #include "qgis_server.h"
@@ -48,6 +52,52 @@ class SERVER_EXPORT QgsConfigCache : public QObject
      */
     const QgsProject *project( const QString &path );
 
+    /**
+     * Checks out a project for the exclusive use of the calling thread.
+     *
+     * This is used by FastCGI worker threads: server requests temporarily
+     * modify layer styles and filters, so a project instance cannot be used
+     * by two requests at the same time. Released instances are kept in a pool
+     * and handed to the next request, a new instance is only read if all the
+     * instances of \a path are in use. Instances read before the project file
+     * was last modified are discarded.
+     *
+     * Each instance is a complete copy of the project with its layers and
+     * providers, so the memory used for \a path grows with the number of
+     * requests served concurrently. Use setMaxProjectInstances() to bound it:
+     * once the limit is reached, the call blocks until another worker releases
+     * an instance.
+     *
+     * Every successful call must be balanced by releaseProject().
+     * \param path the filename of the QGIS project
+     * \returns the project or nullptr if an error happened
+     * \since QGIS 3.2
+     */
+    QgsProject *acquireProject( const QString &path ) SIP_SKIP;
+
+    /**
+     * Returns a \a project checked out with acquireProject() to the pool.
+     * \since QGIS 3.2
+     */
+    void releaseProject( const QString &path, QgsProject *project ) SIP_SKIP;
+
+    /**
+     * Sets the maximum number of instances of each project read by
+     * acquireProject(). A value of 0 or less means no limit, i.e. one
+     * instance per concurrently served request.
+     * \since QGIS 3.2
+     */
+    void setMaxProjectInstances( int maxInstances ) SIP_SKIP;
+
+  signals:
+
+    /**
+     * Emitted when the cached data of the project at \a path is removed,
+     * either because the file changed or on explicit request.
+     * \since QGIS 3.2
+     */
+    void projectRemoved( const QString &path );
+
   private:
     QgsConfigCache() SIP_FORCE;
 
@@ -60,6 +110,31 @@ class SERVER_EXPORT QgsConfigCache : public QObject
     QCache<QString, QDomDocument> mXmlDocumentCache;
     QCache<QString, QgsProject> mProjectCache;
 
+    //! Project instance available in the worker pool
+    struct PooledProject
+    {
+      QgsProject *project = nullptr;
+      QDateTime lastModified;
+    };
+
+    //! Guards the worker project pool
+    QMutex mPoolMutex;
+
+    //! Idle project instances by project path
+    QHash<QString, QList<PooledProject> > mProjectPool;
+
+    //! File modification time of checked out project instances
+    QHash<QgsProject *, QDateTime> mCheckedOutProjects;
+
+    //! Number of live (idle and checked out) instances by project path
+    QHash<QString, int> mProjectInstances;
+
+    //! Maximum number of instances of each project, 0 for no limit
+    int mMaxProjectInstances = 0;
+
+    //! Signaled when an instance is released or a slot becomes free
+    QWaitCondition mProjectReleased;
+
   private slots:
     //! Removes changed entry from this cache
     void removeChangedEntry( const QString &path );
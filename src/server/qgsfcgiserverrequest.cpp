@@ -23,11 +23,15 @@
 #include "qgsserverlogger.h"
 #include "qgsmessagelog.h"
 #include <fcgi_stdio.h>
+#include <fcgiapp.h>
+
+#include <algorithm>
 
 #include <QDebug>
 
 
-QgsFcgiServerRequest::QgsFcgiServerRequest()
+QgsFcgiServerRequest::QgsFcgiServerRequest( FCGX_Request *fcgxRequest )
+  : mFcgxRequest( fcgxRequest )
 {
   mHasError  = false;
 
@@ -35,10 +39,10 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
 
   // Get the REQUEST_URI from the environment
   QUrl url;
-  QString uri = getenv( "REQUEST_URI" );
+  QString uri = param( "REQUEST_URI" );
   if ( uri.isEmpty() )
   {
-    uri = getenv( "SCRIPT_NAME" );
+    uri = param( "SCRIPT_NAME" );
   }
 
   url.setUrl( uri );
@@ -46,13 +50,13 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   // Check if host is defined
   if ( url.host().isEmpty() )
   {
-    url.setHost( getenv( "SERVER_NAME" ) );
+    url.setHost( param( "SERVER_NAME" ) );
   }
 
   // Port ?
   if ( url.port( -1 ) == -1 )
   {
-    QString portString = getenv( "SERVER_PORT" );
+    QString portString = param( "SERVER_PORT" );
     if ( !portString.isEmpty() )
     {
       bool portOk;
@@ -67,7 +71,7 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   // scheme
   if ( url.scheme().isEmpty() )
   {
-    QString( getenv( "HTTPS" ) ).compare( QLatin1String( "on" ), Qt::CaseInsensitive ) == 0
+    QString( param( "HTTPS" ) ).compare( QLatin1String( "on" ), Qt::CaseInsensitive ) == 0
     ? url.setScheme( QStringLiteral( "https" ) )
     : url.setScheme( QStringLiteral( "http" ) );
   }
@@ -75,7 +79,7 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   // XXX OGC paremetrs are passed with the query string
   // we override the query string url in case it is
   // defined independently of REQUEST_URI
-  const char *qs = getenv( "QUERY_STRING" );
+  const char *qs = param( "QUERY_STRING" );
   if ( qs )
   {
     url.setQuery( qs );
@@ -88,7 +92,7 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   QgsServerRequest::Method method = GetMethod;
 
   // Get method
-  const char *me = getenv( "REQUEST_METHOD" );
+  const char *me = param( "REQUEST_METHOD" );
 
   if ( me )
   {
@@ -127,6 +131,15 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   }
 }
 
+const char *QgsFcgiServerRequest::param( const char *name ) const
+{
+  if ( mFcgxRequest )
+  {
+    return FCGX_GetParam( name, mFcgxRequest->envp );
+  }
+  return getenv( name );
+}
+
 QByteArray QgsFcgiServerRequest::data() const
 {
   return mData;
@@ -136,7 +149,7 @@ QByteArray QgsFcgiServerRequest::data() const
 void QgsFcgiServerRequest::readData()
 {
   // Check if we have CONTENT_LENGTH defined
-  const char *lengthstr = getenv( "CONTENT_LENGTH" );
+  const char *lengthstr = param( "CONTENT_LENGTH" );
   if ( lengthstr )
   {
 #ifdef QGISDEBUG
@@ -146,10 +159,19 @@ void QgsFcgiServerRequest::readData()
     int length = QString( lengthstr ).toInt( &success );
     if ( success )
     {
-      // XXX This not efficiont at all  !!
-      for ( int i = 0; i < length; ++i )
+      if ( mFcgxRequest )
+      {
+        mData.resize( length );
+        int read = FCGX_GetStr( mData.data(), length, mFcgxRequest->in );
+        mData.truncate( std::max( read, 0 ) );
+      }
+      else
       {
-        mData.append( getchar() );
+        // XXX This not efficiont at all  !!
+        for ( int i = 0; i < length; ++i )
+        {
+          mData.append( getchar() );
+        }
       }
     }
     else
@@ -168,48 +190,48 @@ void QgsFcgiServerRequest::readData()
 void QgsFcgiServerRequest::printRequestInfos()
 {
   QgsMessageLog::logMessage( QStringLiteral( "******************** New request ***************" ), QStringLiteral( "Server" ), Qgis::Info );
-  if ( getenv( "REMOTE_ADDR" ) )
+  if ( param( "REMOTE_ADDR" ) )
   {
-    QgsMessageLog::logMessage( "REMOTE_ADDR: " + QString( getenv( "REMOTE_ADDR" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "REMOTE_ADDR: " + QString( param( "REMOTE_ADDR" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "REMOTE_HOST" ) )
+  if ( param( "REMOTE_HOST" ) )
   {
-    QgsMessageLog::logMessage( "REMOTE_HOST: " + QString( getenv( "REMOTE_HOST" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "REMOTE_HOST: " + QString( param( "REMOTE_HOST" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "REMOTE_USER" ) )
+  if ( param( "REMOTE_USER" ) )
   {
-    QgsMessageLog::logMessage( "REMOTE_USER: " + QString( getenv( "REMOTE_USER" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "REMOTE_USER: " + QString( param( "REMOTE_USER" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "REMOTE_IDENT" ) )
+  if ( param( "REMOTE_IDENT" ) )
   {
-    QgsMessageLog::logMessage( "REMOTE_IDENT: " + QString( getenv( "REMOTE_IDENT" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "REMOTE_IDENT: " + QString( param( "REMOTE_IDENT" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "CONTENT_TYPE" ) )
+  if ( param( "CONTENT_TYPE" ) )
   {
-    QgsMessageLog::logMessage( "CONTENT_TYPE: " + QString( getenv( "CONTENT_TYPE" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "CONTENT_TYPE: " + QString( param( "CONTENT_TYPE" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "AUTH_TYPE" ) )
+  if ( param( "AUTH_TYPE" ) )
   {
-    QgsMessageLog::logMessage( "AUTH_TYPE: " + QString( getenv( "AUTH_TYPE" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "AUTH_TYPE: " + QString( param( "AUTH_TYPE" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "HTTP_USER_AGENT" ) )
+  if ( param( "HTTP_USER_AGENT" ) )
   {
-    QgsMessageLog::logMessage( "HTTP_USER_AGENT: " + QString( getenv( "HTTP_USER_AGENT" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "HTTP_USER_AGENT: " + QString( param( "HTTP_USER_AGENT" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "HTTP_PROXY" ) )
+  if ( param( "HTTP_PROXY" ) )
   {
-    QgsMessageLog::logMessage( "HTTP_PROXY: " + QString( getenv( "HTTP_PROXY" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "HTTP_PROXY: " + QString( param( "HTTP_PROXY" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "HTTPS_PROXY" ) )
+  if ( param( "HTTPS_PROXY" ) )
   {
-    QgsMessageLog::logMessage( "HTTPS_PROXY: " + QString( getenv( "HTTPS_PROXY" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "HTTPS_PROXY: " + QString( param( "HTTPS_PROXY" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "NO_PROXY" ) )
+  if ( param( "NO_PROXY" ) )
   {
-    QgsMessageLog::logMessage( "NO_PROXY: " + QString( getenv( "NO_PROXY" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "NO_PROXY: " + QString( param( "NO_PROXY" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
-  if ( getenv( "HTTP_AUTHORIZATION" ) )
+  if ( param( "HTTP_AUTHORIZATION" ) )
   {
-    QgsMessageLog::logMessage( "HTTP_AUTHORIZATION: " + QString( getenv( "HTTP_AUTHORIZATION" ) ), QStringLiteral( "Server" ), Qgis::Info );
+    QgsMessageLog::logMessage( "HTTP_AUTHORIZATION: " + QString( param( "HTTP_AUTHORIZATION" ) ), QStringLiteral( "Server" ), Qgis::Info );
   }
 }
@@ -26,6 +26,8 @@
 
 #include <QBuffer>
 
+struct FCGX_Request;
+
 /**
  * \ingroup server
  * QgsFcgiServerResquest
@@ -34,7 +36,14 @@
 class SERVER_EXPORT QgsFcgiServerRequest: public QgsServerRequest
 {
   public:
-    QgsFcgiServerRequest();
+
+    /**
+     * Constructor.
+     * \param fcgxRequest a request accepted with FCGX_Accept_r() by a worker
+     * thread, or nullptr to read the request from the process environment
+     * and stdin set up by FCGI_Accept()
+     */
+    QgsFcgiServerRequest( FCGX_Request *fcgxRequest = nullptr );
 
     QByteArray data() const override;
 
@@ -46,11 +55,16 @@ class SERVER_EXPORT QgsFcgiServerRequest: public QgsServerRequest
   private:
     void readData();
 
+    // Returns the value of a CGI parameter, either from the
+    // FCGX request or from the environment
+    const char *param( const char *name ) const;
+
     // Log request info: print debug infos
     // about the request
     void printRequestInfos();
 
 
+    FCGX_Request *mFcgxRequest = nullptr;
     QByteArray mData;
     bool       mHasError;
 };
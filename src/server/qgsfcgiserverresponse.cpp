@@ -23,6 +23,7 @@
 #include "qgsserverlogger.h"
 #include "qgsmessagelog.h"
 #include <fcgi_stdio.h>
+#include <fcgiapp.h>
 
 #include <QDebug>
 
@@ -30,8 +31,9 @@
 // QgsFcgiServerResponse
 //
 
-QgsFcgiServerResponse::QgsFcgiServerResponse( QgsServerRequest::Method method )
-  : mMethod( method )
+QgsFcgiServerResponse::QgsFcgiServerResponse( QgsServerRequest::Method method, FCGX_Request *fcgxRequest )
+  : mFcgxRequest( fcgxRequest )
+  , mMethod( method )
 {
   mBuffer.open( QIODevice::ReadWrite );
   setDefaultHeaders();
@@ -109,15 +111,17 @@ void QgsFcgiServerResponse::flush()
   if ( ! mHeadersSent )
   {
     // Send all headers
+    QByteArray headers;
     QMap<QString, QString>::const_iterator it;
     for ( it = mHeaders.constBegin(); it != mHeaders.constEnd(); ++it )
     {
-      fputs( it.key().toUtf8(), FCGI_stdout );
-      fputs( ": ", FCGI_stdout );
-      fputs( it.value().toUtf8(), FCGI_stdout );
-      fputs( "\n", FCGI_stdout );
+      headers.append( it.key().toUtf8() );
+      headers.append( ": " );
+      headers.append( it.value().toUtf8() );
+      headers.append( '\n' );
     }
-    fputs( "\n", FCGI_stdout );
+    headers.append( '\n' );
+    writeOut( headers.constData(), headers.size() );
     mHeadersSent = true;
   }
 
@@ -131,11 +135,9 @@ void QgsFcgiServerResponse::flush()
   else if ( mBuffer.bytesAvailable() > 0 )
   {
     QByteArray &ba = mBuffer.buffer();
-    size_t count   = fwrite( ( void * )ba.data(), ba.size(), 1, FCGI_stdout );
+    writeOut( ba.constData(), ba.size() );
 #ifdef QGISDEBUG
-    qDebug() << QStringLiteral( "Sent %1 blocks of %2 bytes" ).arg( count ).arg( ba.size() );
-#else
-    Q_UNUSED( count );
+    qDebug() << QStringLiteral( "Sent %1 bytes" ).arg( ba.size() );
 #endif
     // Reset the internal buffer
     ba.clear();
@@ -143,6 +145,19 @@ void QgsFcgiServerResponse::flush()
 }
 
 
+void QgsFcgiServerResponse::writeOut( const char *data, int length )
+{
+  if ( mFcgxRequest )
+  {
+    FCGX_PutStr( data, length, mFcgxRequest->out );
+  }
+  else
+  {
+    fwrite( data, length, 1, FCGI_stdout );
+  }
+}
+
+
 void QgsFcgiServerResponse::clear()
 {
   mHeaders.clear();
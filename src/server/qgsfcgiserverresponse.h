@@ -27,6 +27,8 @@
 
 #include <QBuffer>
 
+struct FCGX_Request;
+
 /**
  * \ingroup server
  * QgsFcgiServerResponse
@@ -36,7 +38,15 @@ class SERVER_EXPORT QgsFcgiServerResponse: public QgsServerResponse
 {
   public:
 
-    QgsFcgiServerResponse( QgsServerRequest::Method method = QgsServerRequest::GetMethod );
+
+    /**
+     * Constructor.
+     * \param method the request method
+     * \param fcgxRequest a request accepted with FCGX_Accept_r() by a worker
+     * thread, or nullptr to write the response to the stdout stream
+     * set up by FCGI_Accept()
+     */
+    QgsFcgiServerResponse( QgsServerRequest::Method method = QgsServerRequest::GetMethod, FCGX_Request *fcgxRequest = nullptr );
 
     void setHeader( const QString &key, const QString &value ) override;
 
@@ -72,6 +82,10 @@ class SERVER_EXPORT QgsFcgiServerResponse: public QgsServerResponse
     void setDefaultHeaders();
 
   private:
+    //! Writes raw bytes to the fcgi output stream
+    void writeOut( const char *data, int length );
+
+    FCGX_Request *mFcgxRequest = nullptr;
     QMap<QString, QString> mHeaders;
     QBuffer mBuffer;
     bool mFinished    = false;
@@ -44,6 +44,7 @@
 #include <QImage>
 #include <QSettings>
 #include <QDateTime>
+#include <QThread>
 
 // TODO: remove, it's only needed by a single debug message
 #include <fcgi_stdio.h>
@@ -74,6 +75,7 @@ QgsServer::QgsServer()
   }
   init();
   mConfigCache = QgsConfigCache::instance();
+  mConfigCache->setMaxProjectInstances( sSettings.projectInstances() );
 }
 
 QString &QgsServer::serverName()
@@ -266,7 +268,13 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
   Qgis::MessageLevel logLevel = QgsServerLogger::instance()->logLevel();
   QTime time; //used for measuring request time if loglevel < 1
 
-  qApp->processEvents();
+  // Requests handled by FastCGI worker threads must not process
+  // events of the main thread, which runs its own event loop
+  const bool workerThread = QThread::currentThread() != qApp->thread();
+  if ( !workerThread )
+  {
+    qApp->processEvents();
+  }
 
   if ( logLevel == Qgis::Info )
   {
@@ -297,6 +305,10 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
   // Call  requestReady() method (if enabled)
   responseDecorator.start();
 
+  // Project checked out from the worker pool, if any
+  QString checkedOutPath;
+  QgsProject *checkedOutProject = nullptr;
+
   // Plugins may have set exceptions
   if ( !requestHandler.exceptionRaised() )
   {
@@ -311,7 +323,17 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
         QString configFilePath = configPath( *sConfigFilePath, parameterMap );
 
         // load the project if needed and not empty
-        project = mConfigCache->project( configFilePath );
+        if ( workerThread )
+        {
+          // worker threads need an instance for their exclusive use
+          checkedOutProject = mConfigCache->acquireProject( configFilePath );
+          checkedOutPath = configFilePath;
+          project = checkedOutProject;
+        }
+        else
+        {
+          project = mConfigCache->project( configFilePath );
+        }
         if ( ! project )
         {
           throw QgsServerException( QStringLiteral( "Project file error" ) );
@@ -371,6 +393,11 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
   // Terminate the response
   responseDecorator.finish();
 
+  if ( checkedOutProject )
+  {
+    mConfigCache->releaseProject( checkedOutPath, checkedOutProject );
+  }
+
   // We are done using requestHandler in plugins, make sure we don't access
   // to a deleted request handler from Python bindings
   sServerInterface->clearRequestHandler();
@@ -382,6 +409,22 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
 }
 
 
+bool QgsServer::canHandleConcurrentRequests() const
+{
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+  if ( !QgsServerPlugins::serverPlugins().isEmpty() )
+    return false;
+
+  if ( !sServerInterface->filters().isEmpty() )
+    return false;
+
+  if ( sServerInterface->accessControls() && !sServerInterface->accessControls()->isEmpty() )
+    return false;
+#endif
+
+  return !sServiceRegistry->hasExternalServices();
+}
+
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
 void QgsServer::initPython()
 {
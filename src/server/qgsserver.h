@@ -85,6 +85,17 @@ class SERVER_EXPORT QgsServer
     //! Returns a pointer to the server interface
     QgsServerInterfaceImpl SIP_PYALTERNATIVETYPE( QgsServerInterface ) *serverInterface() { return sServerInterface; }
 
+    /**
+     * Returns true if requests can be handled concurrently by several threads.
+     *
+     * This is not the case once Python plugins are loaded, or server filters, access control
+     * filters or services other than the native ones are registered: they share the state of
+     * the server interface and the Python interpreter and are not thread safe.
+     *
+     * \since QGIS 3.2
+     */
+    bool canHandleConcurrentRequests() const;
+
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
 
     /**
@@ -25,6 +25,8 @@
 #include "qgsserverinterface.h"
 #include "qgscapabilitiescache.h"
 
+#include <QThreadStorage>
+
 /**
  * QgsServerInterface
  * Class defining interfaces exposed by QGIS Server and
@@ -49,7 +51,7 @@ class QgsServerInterfaceImpl : public QgsServerInterface
     void clearRequestHandler() override;
     QgsCapabilitiesCache *capabilitiesCache() override { return mCapabilitiesCache; }
     //! Return the QgsRequestHandler, to be used only in server plugins
-    QgsRequestHandler  *requestHandler() override { return mRequestHandler; }
+    QgsRequestHandler  *requestHandler() override { return mRequestState.localData().requestHandler; }
     void registerFilter( QgsServerFilter *filter, int priority = 0 ) override;
     QgsServerFiltersMap filters() override { return mFilters; }
     //! Register an access control filter
@@ -62,7 +64,7 @@ class QgsServerInterfaceImpl : public QgsServerInterface
      */
     QgsAccessControl *accessControls() const override { return mAccessControls; }
     QString getEnv( const QString &name ) const override;
-    QString configFilePath() override { return mConfigFilePath; }
+    QString configFilePath() override { return mRequestState.localData().configFilePath; }
     void setConfigFilePath( const QString &configFilePath ) override;
     void setFilters( QgsServerFiltersMap *filters ) override;
     void removeConfigCacheEntry( const QString &path ) override;
@@ -73,11 +75,20 @@ class QgsServerInterfaceImpl : public QgsServerInterface
 
   private:
 
-    QString mConfigFilePath;
+    /**
+     * State of the request currently handled. It is stored per thread
+     * so that FastCGI workers can handle requests concurrently.
+     */
+    struct RequestState
+    {
+      QgsRequestHandler *requestHandler = nullptr;
+      QString configFilePath;
+    };
+
+    QThreadStorage<RequestState> mRequestState;
     QgsServerFiltersMap mFilters;
     QgsAccessControl *mAccessControls = nullptr;
     QgsCapabilitiesCache *mCapabilitiesCache = nullptr;
-    QgsRequestHandler *mRequestHandler = nullptr;
     QgsServiceRegistry *mServiceRegistry = nullptr;
     QgsServerSettings *mServerSettings = nullptr;
 };
@@ -22,6 +22,7 @@
 #include <QSettings>
 
 #include <iostream>
+#include <algorithm>
 
 QgsServerSettings::QgsServerSettings()
 {
@@ -130,6 +131,72 @@ void QgsServerSettings::initSettings()
                                QVariant()
                              };
   mSettings[ sCacheSize.envVar ] = sCacheSize;
+
+  // fcgi workers
+  const Setting sWorkers = { QgsServerSettingsEnv::QGIS_SERVER_WORKERS,
+                             QgsServerSettingsEnv::DEFAULT_VALUE,
+                             "Number of worker threads accepting FastCGI requests",
+                             "/qgis/server_workers",
+                             QVariant::Int,
+                             QVariant( 1 ),
+                             QVariant()
+                           };
+  mSettings[ sWorkers.envVar ] = sWorkers;
+
+  // project instances shared by the fcgi workers
+  const Setting sProjectInstances = { QgsServerSettingsEnv::QGIS_SERVER_PROJECT_INSTANCES,
+                                      QgsServerSettingsEnv::DEFAULT_VALUE,
+                                      "Maximum number of instances of each project read by the FastCGI workers (0 for one per busy worker)",
+                                      "/qgis/server_project_instances",
+                                      QVariant::Int,
+                                      QVariant( 0 ),
+                                      QVariant()
+                                    };
+  mSettings[ sProjectInstances.envVar ] = sProjectInstances;
+
+  // wms metatile size
+  const Setting sMetatileSize = { QgsServerSettingsEnv::QGIS_SERVER_WMS_METATILE_SIZE,
+                                  QgsServerSettingsEnv::DEFAULT_VALUE,
+                                  "Number of tiles along each side of metatiles rendered for tile aligned GetMap requests",
+                                  "/qgis/wms_metatile_size",
+                                  QVariant::Int,
+                                  QVariant( 0 ),
+                                  QVariant()
+                                };
+  mSettings[ sMetatileSize.envVar ] = sMetatileSize;
+
+  // wms tile cache size
+  const Setting sTileCacheSize = { QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_SIZE,
+                                   QgsServerSettingsEnv::DEFAULT_VALUE,
+                                   "Specify the memory size of the WMS tile cache",
+                                   "/cache/wms_tile_size",
+                                   QVariant::LongLong,
+                                   QVariant( 64 * 1024 * 1024 ),
+                                   QVariant()
+                                 };
+  mSettings[ sTileCacheSize.envVar ] = sTileCacheSize;
+
+  // wms tile cache directory
+  const Setting sTileCacheDir = { QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY,
+                                  QgsServerSettingsEnv::DEFAULT_VALUE,
+                                  "Specify the directory of the on-disk WMS tile cache",
+                                  "/cache/wms_tile_directory",
+                                  QVariant::String,
+                                  QVariant( "" ),
+                                  QVariant()
+                                };
+  mSettings[ sTileCacheDir.envVar ] = sTileCacheDir;
+
+  // wms tile cache directory size
+  const Setting sTileCacheDirSize = { QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY_SIZE,
+                                      QgsServerSettingsEnv::DEFAULT_VALUE,
+                                      "Specify the size limit of the on-disk WMS tile cache (0 for no limit)",
+                                      "/cache/wms_tile_directory_size",
+                                      QVariant::LongLong,
+                                      QVariant( 1024 * 1024 * 1024 ),
+                                      QVariant()
+                                    };
+  mSettings[ sTileCacheDirSize.envVar ] = sTileCacheDirSize;
 }
 
 void QgsServerSettings::load()
@@ -305,3 +372,33 @@ QString QgsServerSettings::cacheDirectory() const
 {
   return value( QgsServerSettingsEnv::QGIS_SERVER_CACHE_DIRECTORY ).toString();
 }
+
+int QgsServerSettings::workers() const
+{
+  return std::max( 1, value( QgsServerSettingsEnv::QGIS_SERVER_WORKERS ).toInt() );
+}
+
+int QgsServerSettings::projectInstances() const
+{
+  return std::max( 0, value( QgsServerSettingsEnv::QGIS_SERVER_PROJECT_INSTANCES ).toInt() );
+}
+
+int QgsServerSettings::wmsMetatileSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_METATILE_SIZE ).toInt();
+}
+
+qint64 QgsServerSettings::wmsTileCacheSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_SIZE ).toLongLong();
+}
+
+QString QgsServerSettings::wmsTileCacheDirectory() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY ).toString();
+}
+
+qint64 QgsServerSettings::wmsTileCacheDirectorySize() const
+{
+  return std::max< qint64 >( 0, value( QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY_SIZE ).toLongLong() );
+}
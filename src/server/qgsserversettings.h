@@ -56,7 +56,13 @@ class SERVER_EXPORT QgsServerSettingsEnv : public QObject
       QGIS_PROJECT_FILE,
       MAX_CACHE_LAYERS,
       QGIS_SERVER_CACHE_DIRECTORY,
-      QGIS_SERVER_CACHE_SIZE
+      QGIS_SERVER_CACHE_SIZE,
+      QGIS_SERVER_WORKERS,
+      QGIS_SERVER_WMS_METATILE_SIZE,
+      QGIS_SERVER_WMS_TILE_CACHE_SIZE,
+      QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY,
+      QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY_SIZE,
+      QGIS_SERVER_PROJECT_INSTANCES
     };
     Q_ENUM( EnvVar )
 };
@@ -157,6 +163,54 @@ class SERVER_EXPORT QgsServerSettings
       */
     QString cacheDirectory() const;
 
+    /**
+     * Returns the number of FastCGI worker threads accepting requests
+     * concurrently in the server process.
+     * \returns the number of workers, 1 meaning the classic serial loop.
+     * \since QGIS 3.2
+     */
+    int workers() const;
+
+    /**
+     * Returns the maximum number of instances of each project read by the
+     * FastCGI workers. Every instance is a full copy of the project, so this
+     * bounds the memory used by a project when several workers serve it
+     * concurrently; workers wait for a free instance once it is reached.
+     * \returns the number of instances, 0 meaning one instance per busy worker.
+     * \since QGIS 3.2
+     */
+    int projectInstances() const;
+
+    /**
+     * Returns the number of tiles along each side of the metatiles rendered
+     * for tile aligned WMS GetMap requests.
+     * \returns the metatile size, 0 or 1 if metatiling is disabled.
+     * \since QGIS 3.2
+     */
+    int wmsMetatileSize() const;
+
+    /**
+     * Returns the memory budget of the WMS tile cache.
+     * \returns the cache size in bytes.
+     * \since QGIS 3.2
+     */
+    qint64 wmsTileCacheSize() const;
+
+    /**
+     * Returns the directory of the on-disk WMS tile cache.
+     * \returns the directory or an empty string if tiles are only cached in memory.
+     * \since QGIS 3.2
+     */
+    QString wmsTileCacheDirectory() const;
+
+    /**
+     * Returns the size limit of the on-disk WMS tile cache. The oldest
+     * tiles are removed once it is exceeded.
+     * \returns the size in bytes, 0 meaning no limit.
+     * \since QGIS 3.2
+     */
+    qint64 wmsTileCacheDirectorySize() const;
+
   private:
     void initSettings();
     QVariant value( QgsServerSettingsEnv::EnvVar envVar ) const;
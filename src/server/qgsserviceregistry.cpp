@@ -226,6 +226,7 @@ int QgsServiceRegistry::unregisterService( const QString &name, const QString &v
 void QgsServiceRegistry::init( const QString &nativeModulePath, QgsServerInterface *serverIface )
 {
   mNativeLoader.loadModules( nativeModulePath, *this, serverIface );
+  mNativeServices = QSet<QString>::fromList( mServices.keys() );
 }
 
 void QgsServiceRegistry::cleanUp()
@@ -233,7 +234,18 @@ void QgsServiceRegistry::cleanUp()
   // Release all services
   mVersions.clear();
   mServices.clear();
+  mNativeServices.clear();
   mNativeLoader.unloadModules();
 }
 
+bool QgsServiceRegistry::hasExternalServices() const
+{
+  for ( ServiceTable::const_iterator it = mServices.constBegin(); it != mServices.constEnd(); ++it )
+  {
+    if ( !mNativeServices.contains( it.key() ) )
+      return true;
+  }
+  return false;
+}
+
 
@@ -23,6 +23,7 @@
 #include "qgis.h"
 
 #include <QHash>
+#include <QSet>
 #include <QString>
 
 #include "qgsservicenativeloader.h"
@@ -101,6 +102,13 @@ class SERVER_EXPORT QgsServiceRegistry
      */
     void cleanUp();
 
+    /**
+     * Returns true if services other than the ones of the native modules loaded by init()
+     * are registered, e.g. by Python plugins.
+     * \since QGIS 3.2
+     */
+    bool hasExternalServices() const;
+
   private:
     // XXX consider using QMap because of the few numbers of
     // elements to handle
@@ -111,6 +119,9 @@ class SERVER_EXPORT QgsServiceRegistry
 
     ServiceTable mServices;
     VersionTable mVersions;
+
+    //! Keys of the services registered by the native modules
+    QSet<QString> mNativeServices;
 };
 
 #endif
@@ -27,6 +27,7 @@
 #include "qgsmaplayer.h"
 #include "qgsfeatureiterator.h"
 #include "qgscoordinatereferencesystem.h"
+#include "qgscoordinatetransform.h"
 #include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 #include "qgsfilterrestorer.h"
@@ -37,6 +38,7 @@
 #include "qgswfsgetfeature.h"
 
 #include <QStringList>
+#include <QTextStream>
 
 namespace QgsWfs
 {
@@ -58,30 +60,47 @@ namespace QgsWfs
       const QString &geometryName;
 
       const QgsCoordinateReferenceSystem &outputCrs;
+
+      const QgsCoordinateTransform &transform;
     };
 
-    QString createFeatureGeoJSON( QgsFeature *feat, const createFeatureParams &params );
+    //! Size of the chunks of features streamed to the client
+    const qint64 STREAMING_CHUNK_SIZE = 64 * 1024;
+
+    /**
+     * State of a GetFeature request. It is passed through the writer functions,
+     * as concurrent requests must not share it.
+     */
+    struct getFeatureState
+    {
+      QgsWfsParameters wfsParameters;
+
+      //! GeoJSON exporter
+      QgsJsonExporter jsonExporter;
+
+      //! Document owning the GML nodes, which are discarded after each feature
+      QDomDocument gmlDocument;
+
+      //! Serialized features not yet written to the response
+      QByteArray featureBuffer;
+    };
 
-    QDomElement createFeatureGML2( QgsFeature *feat, QDomDocument &doc, const createFeatureParams &params );
+    QString createFeatureGeoJSON( getFeatureState &state, QgsFeature *feat, const createFeatureParams &params );
 
-    QDomElement createFeatureGML3( QgsFeature *feat, QDomDocument &doc, const createFeatureParams &params );
+    void writeFeatureGML( getFeatureState &state, QgsFeature *feat, QgsWfsParameters::Format format, const createFeatureParams &params );
 
     void hitGetFeature( const QgsServerRequest &request, QgsServerResponse &response, const QgsProject *project,
-                        QgsWfsParameters::Format format, int numberOfFeatures, const QStringList &typeNames );
+                        const QgsWfsParameters &wfsParameters, QgsWfsParameters::Format format, int numberOfFeatures,
+                        const QStringList &typeNames );
 
     void startGetFeature( const QgsServerRequest &request, QgsServerResponse &response, const QgsProject *project,
-                          QgsWfsParameters::Format format, int prec, QgsCoordinateReferenceSystem &crs,
-                          QgsRectangle *rect, const QStringList &typeNames );
+                          const QgsWfsParameters &wfsParameters, QgsWfsParameters::Format format, int prec,
+                          QgsCoordinateReferenceSystem &crs, QgsRectangle *rect, const QStringList &typeNames );
 
-    void setGetFeature( QgsServerResponse &response, QgsWfsParameters::Format format, QgsFeature *feat, int featIdx,
-                        const createFeatureParams &params );
+    void setGetFeature( getFeatureState &state, QgsServerResponse &response, QgsWfsParameters::Format format, QgsFeature *feat,
+                        int featIdx, const createFeatureParams &params );
 
-    void endGetFeature( QgsServerResponse &response, QgsWfsParameters::Format format );
-
-    QgsServerRequest::Parameters mRequestParameters;
-    QgsWfsParameters mWfsParameters;
-    /* GeoJSON Exporter */
-    QgsJsonExporter mJsonExporter;
+    void endGetFeature( getFeatureState &state, QgsServerResponse &response, QgsWfsParameters::Format format );
   }
 
   void writeGetFeature( QgsServerInterface *serverIface, const QgsProject *project,
@@ -90,22 +109,23 @@ namespace QgsWfs
   {
     Q_UNUSED( version );
 
-    mRequestParameters = request.parameters();
-    mWfsParameters = QgsWfsParameters( mRequestParameters );
-    mWfsParameters.dump();
+    const QgsServerRequest::Parameters parameters = request.parameters();
+    getFeatureState state;
+    state.wfsParameters = QgsWfsParameters( parameters );
+    state.wfsParameters.dump();
     getFeatureRequest aRequest;
 
     QDomDocument doc;
     QString errorMsg;
 
-    if ( doc.setContent( mRequestParameters.value( QStringLiteral( "REQUEST_BODY" ) ), true, &errorMsg ) )
+    if ( doc.setContent( parameters.value( QStringLiteral( "REQUEST_BODY" ) ), true, &errorMsg ) )
     {
       QDomElement docElem = doc.documentElement();
-      aRequest = parseGetFeatureRequestBody( docElem );
+      aRequest = parseGetFeatureRequestBody( docElem, state.wfsParameters );
     }
     else
     {
-      aRequest = parseGetFeatureParameters();
+      aRequest = parseGetFeatureParameters( parameters, state.wfsParameters );
     }
 
     // store typeName
@@ -362,7 +382,7 @@ namespace QgsWfs
       // Iterate through features
       QgsFeatureIterator fit = vlayer->getFeatures( featureRequest );
 
-      if ( mWfsParameters.resultType() == QgsWfsParameters::ResultType::HITS )
+      if ( state.wfsParameters.resultType() == QgsWfsParameters::ResultType::HITS )
       {
         while ( fit.nextFeature( feature ) && ( aRequest.maxFeatures == -1 || sentFeatures < aRequest.maxFeatures ) )
         {
@@ -375,22 +395,31 @@ namespace QgsWfs
       }
       else
       {
+        // create the transform once per layer rather than for each feature
+        const QgsCoordinateTransform transform( layerCrs, outputCrs, project );
         const createFeatureParams cfp = { layerPrecision,
                                           layerCrs,
                                           attrIndexes,
                                           typeName,
                                           withGeom,
                                           geometryName,
-                                          outputCrs
+                                          outputCrs,
+                                          transform
                                         };
+        if ( aRequest.outputFormat == QgsWfsParameters::Format::GeoJSON )
+        {
+          state.jsonExporter.setSourceCrs( layerCrs );
+          state.jsonExporter.setIncludeAttributes( !attrIndexes.isEmpty() );
+          state.jsonExporter.setAttributes( attrIndexes );
+        }
         while ( fit.nextFeature( feature ) && ( aRequest.maxFeatures == -1 || sentFeatures < aRequest.maxFeatures ) )
         {
           if ( iteratedFeatures == aRequest.startIndex )
-            startGetFeature( request, response, project, aRequest.outputFormat, requestPrecision, requestCrs, &requestRect, typeNameList );
+            startGetFeature( request, response, project, state.wfsParameters, aRequest.outputFormat, requestPrecision, requestCrs, &requestRect, typeNameList );
 
           if ( iteratedFeatures >= aRequest.startIndex )
           {
-            setGetFeature( response, aRequest.outputFormat, &feature, sentFeatures, cfp );
+            setGetFeature( state, response, aRequest.outputFormat, &feature, sentFeatures, cfp );
             ++sentFeatures;
           }
           ++iteratedFeatures;
@@ -403,33 +432,33 @@ namespace QgsWfs
     filterRestorer.reset();
 #endif
 
-    if ( mWfsParameters.resultType() == QgsWfsParameters::ResultType::HITS )
+    if ( state.wfsParameters.resultType() == QgsWfsParameters::ResultType::HITS )
     {
-      hitGetFeature( request, response, project, aRequest.outputFormat, sentFeatures, typeNameList );
+      hitGetFeature( request, response, project, state.wfsParameters, aRequest.outputFormat, sentFeatures, typeNameList );
     }
     else
     {
       // End of GetFeature
       if ( iteratedFeatures <= aRequest.startIndex )
-        startGetFeature( request, response, project, aRequest.outputFormat, requestPrecision, requestCrs, &requestRect, typeNameList );
-      endGetFeature( response, aRequest.outputFormat );
+        startGetFeature( request, response, project, state.wfsParameters, aRequest.outputFormat, requestPrecision, requestCrs, &requestRect, typeNameList );
+      endGetFeature( state, response, aRequest.outputFormat );
     }
 
   }
 
-  getFeatureRequest parseGetFeatureParameters()
+  getFeatureRequest parseGetFeatureParameters( const QgsServerRequest::Parameters &parameters, const QgsWfsParameters &wfsParameters )
   {
     getFeatureRequest request;
-    request.maxFeatures = mWfsParameters.maxFeaturesAsInt();;
-    request.startIndex = mWfsParameters.startIndexAsInt();
-    request.outputFormat = mWfsParameters.outputFormat();
+    request.maxFeatures = wfsParameters.maxFeaturesAsInt();;
+    request.startIndex = wfsParameters.startIndexAsInt();
+    request.outputFormat = wfsParameters.outputFormat();
 
     // Verifying parameters mutually exclusive
-    QStringList fidList = mWfsParameters.featureIds();
+    QStringList fidList = wfsParameters.featureIds();
     bool paramContainsFeatureIds = !fidList.isEmpty();
-    QStringList filterList = mWfsParameters.filters();
+    QStringList filterList = wfsParameters.filters();
     bool paramContainsFilters = !filterList.isEmpty();
-    QString bbox = mWfsParameters.bbox();
+    QString bbox = wfsParameters.bbox();
     bool paramContainsBbox = !bbox.isEmpty();
     if ( ( paramContainsFeatureIds
            && ( paramContainsFilters || paramContainsBbox ) )
@@ -443,10 +472,10 @@ namespace QgsWfs
     }
 
     // Get and split PROPERTYNAME parameter
-    QStringList propertyNameList = mWfsParameters.propertyNames();
+    QStringList propertyNameList = wfsParameters.propertyNames();
 
     // Manage extra parameter GeometryName
-    request.geometryName = mWfsParameters.geometryNameAsString().toUpper();
+    request.geometryName = wfsParameters.geometryNameAsString().toUpper();
 
     QStringList typeNameList;
     // parse FEATUREID
@@ -525,7 +554,7 @@ namespace QgsWfs
 
         getFeatureQuery query;
         query.typeName = typeName;
-        query.srsName = mWfsParameters.srsName();
+        query.srsName = wfsParameters.srsName();
 
         // Parse PropertyName
         if ( propertyName != QStringLiteral( "*" ) )
@@ -565,12 +594,12 @@ namespace QgsWfs
       return request;
     }
 
-    if ( !mRequestParameters.contains( QStringLiteral( "TYPENAME" ) ) )
+    if ( !parameters.contains( QStringLiteral( "TYPENAME" ) ) )
     {
       throw QgsRequestNotWellFormedException( QStringLiteral( "TYPENAME is mandatory except if FEATUREID is used" ) );
     }
 
-    typeNameList = mWfsParameters.typeNames();
+    typeNameList = wfsParameters.typeNames();
     // Verifying the 1:1 mapping between TYPENAME and PROPERTYNAME
     if ( !propertyNameList.isEmpty() && typeNameList.size() != propertyNameList.size() )
     {
@@ -600,7 +629,7 @@ namespace QgsWfs
 
       getFeatureQuery query;
       query.typeName = typeName;
-      query.srsName = mWfsParameters.srsName();
+      query.srsName = wfsParameters.srsName();
 
       // Parse PropertyName
       if ( propertyName != QStringLiteral( "*" ) )
@@ -639,7 +668,7 @@ namespace QgsWfs
     }
 
     // Manage extra parameter exp_filter
-    QStringList expFilterList = mWfsParameters.expFilters();
+    QStringList expFilterList = wfsParameters.expFilters();
     if ( !expFilterList.isEmpty() )
     {
       // Verifying the 1:1 mapping between TYPENAME and EXP_FILTER but without exception
@@ -685,16 +714,16 @@ namespace QgsWfs
     {
 
       // get bbox extent
-      QgsRectangle extent = mWfsParameters.bboxAsRectangle();
+      QgsRectangle extent = wfsParameters.bboxAsRectangle();
 
       // handle WFS 1.1.0 optional CRS
-      if ( mWfsParameters.bbox().split( ',' ).size() == 5 && ! mWfsParameters.srsName().isEmpty() )
+      if ( wfsParameters.bbox().split( ',' ).size() == 5 && ! wfsParameters.srsName().isEmpty() )
       {
-        QString crs( mWfsParameters.bbox().split( ',' )[4] );
-        if ( crs != mWfsParameters.srsName() )
+        QString crs( wfsParameters.bbox().split( ',' )[4] );
+        if ( crs != wfsParameters.srsName() )
         {
           QgsCoordinateReferenceSystem sourceCrs( crs );
-          QgsCoordinateReferenceSystem destinationCrs( mWfsParameters.srsName() );
+          QgsCoordinateReferenceSystem destinationCrs( wfsParameters.srsName() );
           if ( sourceCrs.isValid() && destinationCrs.isValid( ) )
           {
             QgsGeometry extentGeom = QgsGeometry::fromRect( extent );
@@ -761,7 +790,7 @@ namespace QgsWfs
       return request;
     }
 
-    QStringList sortByList = mWfsParameters.sortBy();
+    QStringList sortByList = wfsParameters.sortBy();
     if ( !sortByList.isEmpty() && request.queries.size() == sortByList.size() )
     {
       // add order by to feature request
@@ -805,12 +834,12 @@ namespace QgsWfs
     return request;
   }
 
-  getFeatureRequest parseGetFeatureRequestBody( QDomElement &docElem )
+  getFeatureRequest parseGetFeatureRequestBody( QDomElement &docElem, const QgsWfsParameters &wfsParameters )
   {
     getFeatureRequest request;
-    request.maxFeatures = mWfsParameters.maxFeaturesAsInt();;
-    request.startIndex = mWfsParameters.startIndexAsInt();
-    request.outputFormat = mWfsParameters.outputFormat();
+    request.maxFeatures = wfsParameters.maxFeaturesAsInt();;
+    request.startIndex = wfsParameters.startIndexAsInt();
+    request.outputFormat = wfsParameters.outputFormat();
 
     QDomNodeList queryNodes = docElem.elementsByTagName( QStringLiteral( "Query" ) );
     QDomElement queryElem;
@@ -931,8 +960,9 @@ namespace QgsWfs
   namespace
   {
 
-    void hitGetFeature( const QgsServerRequest &request, QgsServerResponse &response, const QgsProject *project, QgsWfsParameters::Format format,
-                        int numberOfFeatures, const QStringList &typeNames )
+    void hitGetFeature( const QgsServerRequest &request, QgsServerResponse &response, const QgsProject *project,
+                        const QgsWfsParameters &wfsParameters, QgsWfsParameters::Format format, int numberOfFeatures,
+                        const QStringList &typeNames )
     {
       QDateTime now = QDateTime::currentDateTime();
       QString fcString;
@@ -960,9 +990,9 @@ namespace QgsWfs
         QUrlQuery query( mapUrl );
         query.addQueryItem( QStringLiteral( "SERVICE" ), QStringLiteral( "WFS" ) );
         //Set version
-        if ( mWfsParameters.version().isEmpty() )
+        if ( wfsParameters.version().isEmpty() )
           query.addQueryItem( QStringLiteral( "VERSION" ), implementationVersion() );
-        else if ( mWfsParameters.versionAsNumber() >= QgsProjectVersion( 1, 1, 0 ) )
+        else if ( wfsParameters.versionAsNumber() >= QgsProjectVersion( 1, 1, 0 ) )
           query.addQueryItem( QStringLiteral( "VERSION" ), QStringLiteral( "1.1.0" ) );
         else
           query.addQueryItem( QStringLiteral( "VERSION" ), QStringLiteral( "1.0.0" ) );
@@ -982,7 +1012,7 @@ namespace QgsWfs
 
         query.addQueryItem( QStringLiteral( "REQUEST" ), QStringLiteral( "DescribeFeatureType" ) );
         query.addQueryItem( QStringLiteral( "TYPENAME" ), typeNames.join( ',' ) );
-        if ( mWfsParameters.versionAsNumber() >= QgsProjectVersion( 1, 1, 0 ) )
+        if ( wfsParameters.versionAsNumber() >= QgsProjectVersion( 1, 1, 0 ) )
         {
           if ( format == QgsWfsParameters::Format::GML2 )
             query.addQueryItem( QStringLiteral( "OUTPUTFORMAT" ), QStringLiteral( "text/xml; subtype=gml/2.1.2" ) );
@@ -1016,8 +1046,9 @@ namespace QgsWfs
       response.flush();
     }
 
-    void startGetFeature( const QgsServerRequest &request, QgsServerResponse &response, const QgsProject *project, QgsWfsParameters::Format format,
-                          int prec, QgsCoordinateReferenceSystem &crs, QgsRectangle *rect, const QStringList &typeNames )
+    void startGetFeature( const QgsServerRequest &request, QgsServerResponse &response, const QgsProject *project,
+                          const QgsWfsParameters &wfsParameters, QgsWfsParameters::Format format, int prec,
+                          QgsCoordinateReferenceSystem &crs, QgsRectangle *rect, const QStringList &typeNames )
     {
       QString fcString;
 
@@ -1066,9 +1097,9 @@ namespace QgsWfs
         QUrlQuery query( mapUrl );
         query.addQueryItem( QStringLiteral( "SERVICE" ), QStringLiteral( "WFS" ) );
         //Set version
-        if ( mWfsParameters.version().isEmpty() )
+        if ( wfsParameters.version().isEmpty() )
           query.addQueryItem( QStringLiteral( "VERSION" ), implementationVersion() );
-        else if ( mWfsParameters.versionAsNumber() >= QgsProjectVersion( 1, 1, 0 ) )
+        else if ( wfsParameters.versionAsNumber() >= QgsProjectVersion( 1, 1, 0 ) )
           query.addQueryItem( QStringLiteral( "VERSION" ), QStringLiteral( "1.1.0" ) );
         else
           query.addQueryItem( QStringLiteral( "VERSION" ), QStringLiteral( "1.0.0" ) );
@@ -1088,7 +1119,7 @@ namespace QgsWfs
 
         query.addQueryItem( QStringLiteral( "REQUEST" ), QStringLiteral( "DescribeFeatureType" ) );
         query.addQueryItem( QStringLiteral( "TYPENAME" ), typeNames.join( ',' ) );
-        if ( mWfsParameters.versionAsNumber() >= QgsProjectVersion( 1, 1, 0 ) )
+        if ( wfsParameters.versionAsNumber() >= QgsProjectVersion( 1, 1, 0 ) )
         {
           if ( format == QgsWfsParameters::Format::GML2 )
             query.addQueryItem( QStringLiteral( "OUTPUTFORMAT" ), QStringLiteral( "text/xml; subtype=gml/2.1.2" ) );
@@ -1150,51 +1181,42 @@ namespace QgsWfs
       }
     }
 
-    void setGetFeature( QgsServerResponse &response, QgsWfsParameters::Format format, QgsFeature *feat, int featIdx,
-                        const createFeatureParams &params )
+    void setGetFeature( getFeatureState &state, QgsServerResponse &response, QgsWfsParameters::Format format, QgsFeature *feat,
+                        int featIdx, const createFeatureParams &params )
     {
       if ( !feat->isValid() )
         return;
 
       if ( format == QgsWfsParameters::Format::GeoJSON )
       {
-        QString fcString;
-        if ( featIdx == 0 )
-          fcString += QLatin1String( "  " );
-        else
-          fcString += QLatin1String( " ," );
-        mJsonExporter.setSourceCrs( params.crs );
-        mJsonExporter.setIncludeGeometry( false );
-        mJsonExporter.setIncludeAttributes( !params.attributeIndexes.isEmpty() );
-        mJsonExporter.setAttributes( params.attributeIndexes );
-        fcString += createFeatureGeoJSON( feat, params );
-        fcString += QLatin1String( "\n" );
-
-        response.write( fcString.toUtf8() );
+        state.featureBuffer.append( featIdx == 0 ? "  " : " ," );
+        state.jsonExporter.setIncludeGeometry( false );
+        state.featureBuffer.append( createFeatureGeoJSON( state, feat, params ).toUtf8() );
+        state.featureBuffer.append( '\n' );
       }
       else
       {
-        QDomDocument gmlDoc;
-        QDomElement featureElement;
-        if ( format == QgsWfsParameters::Format::GML3 )
-        {
-          featureElement = createFeatureGML3( feat, gmlDoc, params );
-          gmlDoc.appendChild( featureElement );
-        }
-        else
-        {
-          featureElement = createFeatureGML2( feat, gmlDoc, params );
-          gmlDoc.appendChild( featureElement );
-        }
-        response.write( gmlDoc.toByteArray() );
+        writeFeatureGML( state, feat, format, params );
       }
 
-      // Stream partial content
-      response.flush();
+      // Stream partial content by chunks, so that memory use does
+      // not depend on the number of features
+      if ( state.featureBuffer.size() >= STREAMING_CHUNK_SIZE )
+      {
+        response.write( state.featureBuffer );
+        response.flush();
+        state.featureBuffer.clear();
+      }
     }
 
-    void endGetFeature( QgsServerResponse &response, QgsWfsParameters::Format format )
+    void endGetFeature( getFeatureState &state, QgsServerResponse &response, QgsWfsParameters::Format format )
     {
+      if ( !state.featureBuffer.isEmpty() )
+      {
+        response.write( state.featureBuffer );
+        state.featureBuffer.clear();
+      }
+
       QString fcString;
       if ( format == QgsWfsParameters::Format::GeoJSON )
       {
@@ -1209,7 +1231,7 @@ namespace QgsWfs
     }
 
 
-    QString createFeatureGeoJSON( QgsFeature *feat, const createFeatureParams &params )
+    QString createFeatureGeoJSON( getFeatureState &state, QgsFeature *feat, const createFeatureParams &params )
     {
       QString id = QStringLiteral( "%1.%2" ).arg( params.typeName, FID_TO_STRING( feat->id() ) );
       //QgsJsonExporter force transform geometry to ESPG:4326
@@ -1221,7 +1243,7 @@ namespace QgsWfs
       QgsGeometry geom = feat->geometry();
       if ( !geom.isNull() && params.withGeom && params.geometryName != QLatin1String( "NONE" ) )
       {
-        mJsonExporter.setIncludeGeometry( true );
+        state.jsonExporter.setIncludeGeometry( true );
         if ( params.geometryName == QLatin1String( "EXTENT" ) )
         {
           QgsRectangle box = geom.boundingBox();
@@ -1233,116 +1255,108 @@ namespace QgsWfs
         }
       }
 
-      return mJsonExporter.exportFeature( f, QVariantMap(), id );
+      return state.jsonExporter.exportFeature( f, QVariantMap(), id );
     }
 
 
-    QDomElement createFeatureGML2( QgsFeature *feat, QDomDocument &doc, const createFeatureParams &params )
+    /**
+     * Escapes a value like QDom does when serializing a text node or, if \a attribute
+     * is true, an attribute value.
+     */
+    QByteArray escapedXml( const QString &value, bool attribute )
     {
-      //gml:FeatureMember
-      QDomElement featureElement = doc.createElement( QStringLiteral( "gml:featureMember" )/*wfs:FeatureMember*/ );
-
-      //qgs:%TYPENAME%
-      QDomElement typeNameElement = doc.createElement( "qgs:" + params.typeName /*qgs:%TYPENAME%*/ );
-      typeNameElement.setAttribute( QStringLiteral( "fid" ), params.typeName + "." + QString::number( feat->id() ) );
-      featureElement.appendChild( typeNameElement );
-
-      //add geometry column (as gml)
-      QgsGeometry geom = feat->geometry();
-      if ( geom && params.withGeom && params.geometryName != QLatin1String( "NONE" ) )
+      QString escaped;
+      escaped.reserve( value.size() );
+      for ( int i = 0; i < value.size(); ++i )
       {
-        int prec = params.precision;
-        QgsCoordinateReferenceSystem crs = params.crs;
-        Q_NOWARN_DEPRECATED_PUSH
-        QgsCoordinateTransform mTransform( crs, params.outputCrs );
-        Q_NOWARN_DEPRECATED_POP
-        try
-        {
-          QgsGeometry transformed = geom;
-          if ( transformed.transform( mTransform ) == 0 )
-          {
-            geom = transformed;
-            crs = params.outputCrs;
-            if ( crs.isGeographic() && !params.crs.isGeographic() )
-              prec = std::min( params.precision + 3, 6 );
-          }
-        }
-        catch ( QgsCsException &cse )
-        {
-          Q_UNUSED( cse );
-        }
-
-        QDomElement geomElem = doc.createElement( QStringLiteral( "qgs:geometry" ) );
-        QDomElement gmlElem;
-        if ( params.geometryName == QLatin1String( "EXTENT" ) )
-        {
-          QgsGeometry bbox = QgsGeometry::fromRect( geom.boundingBox() );
-          gmlElem = QgsOgcUtils::geometryToGML( bbox, doc, prec );
-        }
-        else if ( params.geometryName == QLatin1String( "CENTROID" ) )
-        {
-          QgsGeometry centroid = geom.centroid();
-          gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, prec );
-        }
+        const QChar c = value.at( i );
+        if ( c == '<' )
+          escaped += QLatin1String( "&lt;" );
+        else if ( c == '&' )
+          escaped += QLatin1String( "&amp;" );
+        else if ( c == '>' && i >= 2 && value.at( i - 1 ) == ']' && value.at( i - 2 ) == ']' )
+          escaped += QLatin1String( "&gt;" );
+        else if ( c == '\r' )
+          escaped += QLatin1String( "&#xd;" );
+        else if ( attribute && c == '"' )
+          escaped += QLatin1String( "&quot;" );
+        else if ( attribute && c == '\n' )
+          escaped += QLatin1String( "&#xa;" );
+        else if ( attribute && c == '\t' )
+          escaped += QLatin1String( "&#x9;" );
         else
-        {
-          const QgsAbstractGeometry *abstractGeom = geom.constGet();
-          if ( abstractGeom )
-          {
-            gmlElem = abstractGeom->asGml2( doc, prec, "http://www.opengis.net/gml" );
-          }
-        }
-
-        if ( !gmlElem.isNull() )
-        {
-          QgsRectangle box = geom.boundingBox();
-          QDomElement bbElem = doc.createElement( QStringLiteral( "gml:boundedBy" ) );
-          QDomElement boxElem = QgsOgcUtils::rectangleToGMLBox( &box, doc, prec );
-
-          if ( crs.isValid() )
-          {
-            boxElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
-            gmlElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
-          }
-
-          bbElem.appendChild( boxElem );
-          typeNameElement.appendChild( bbElem );
+          escaped += c;
+      }
+      return escaped.toUtf8();
+    }
 
-          geomElem.appendChild( gmlElem );
-          typeNameElement.appendChild( geomElem );
-        }
+    /**
+     * Applies the invalid data policy of QDom to the name of an element, as the output
+     * used to be built with QDom. Returns an empty string if the element would be null.
+     */
+    QString fixedXmlName( QDomDocument &doc, const QString &name )
+    {
+      bool simple = !name.isEmpty();
+      for ( int i = 0; i < name.size() && simple; ++i )
+      {
+        const ushort u = name.at( i ).unicode();
+        simple = ( u >= 'a' && u <= 'z' ) || ( u >= 'A' && u <= 'Z' ) || u == '_' || u == ':'
+                 || ( i > 0 && ( ( u >= '0' && u <= '9' ) || u == '-' || u == '.' ) );
       }
+      if ( simple )
+        return name;
 
-      //read all attribute values from the feature
-      QgsAttributes featureAttributes = feat->attributes();
-      QgsFields fields = feat->fields();
-      for ( int i = 0; i < params.attributeIndexes.count(); ++i )
+      return doc.createElement( name ).tagName();
+    }
+
+    /**
+     * Applies the invalid data policy of QDom to the content of a text node, as the output
+     * used to be built with QDom. Returns false if the node would be null.
+     */
+    bool fixedCharData( QDomDocument &doc, const QString &value, QString &fixed )
+    {
+      for ( int i = 0; i < value.size(); ++i )
       {
-        int idx = params.attributeIndexes[i];
-        if ( idx >= fields.count() )
+        const ushort u = value.at( i ).unicode();
+        if ( ( u < 0x20 && u != '\t' && u != '\n' && u != '\r' ) || ( u >= 0xd800 && u <= 0xdfff ) || u == 0xfffe || u == 0xffff )
         {
-          continue;
+          const QDomText text = doc.createTextNode( value );
+          fixed = text.data();
+          return !text.isNull();
         }
-        QString attributeName = fields.at( idx ).name();
-
-        QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( ' ', '_' ).replace( cleanTagNameRegExp, QLatin1String( "" ) ) );
-        QDomText fieldText = doc.createTextNode( featureAttributes[idx].toString() );
-        fieldElem.appendChild( fieldText );
-        typeNameElement.appendChild( fieldElem );
       }
+      fixed = value;
+      return true;
+    }
 
-      return featureElement;
+    void writeGmlElement( QByteArray &out, const QDomElement &element, int indent )
+    {
+      QString gml;
+      QTextStream stream( &gml );
+      stream << QString( indent, ' ' );
+      element.save( stream, 1 );
+      stream.flush();
+      out.append( gml.toUtf8() );
     }
 
-    QDomElement createFeatureGML3( QgsFeature *feat, QDomDocument &doc, const createFeatureParams &params )
+    void writeFeatureGML( getFeatureState &state, QgsFeature *feat, QgsWfsParameters::Format format, const createFeatureParams &params )
     {
+      QByteArray &out = state.featureBuffer;
+      const bool gml3 = format == QgsWfsParameters::Format::GML3;
+      const QByteArray typeName = fixedXmlName( state.gmlDocument, QStringLiteral( "qgs:" ) + params.typeName ).toUtf8();
+      if ( typeName.isEmpty() )
+      {
+        out.append( "<gml:featureMember/>\n" );
+        return;
+      }
+
       //gml:FeatureMember
-      QDomElement featureElement = doc.createElement( QStringLiteral( "gml:featureMember" )/*wfs:FeatureMember*/ );
+      out.append( "<gml:featureMember>\n" );
 
       //qgs:%TYPENAME%
-      QDomElement typeNameElement = doc.createElement( "qgs:" + params.typeName /*qgs:%TYPENAME%*/ );
-      typeNameElement.setAttribute( QStringLiteral( "gml:id" ), params.typeName + "." + QString::number( feat->id() ) );
-      featureElement.appendChild( typeNameElement );
+      out.append( " <" ).append( typeName );
+      out.append( gml3 ? " gml:id=\"" : " fid=\"" );
+      out.append( escapedXml( params.typeName + "." + QString::number( feat->id() ), true ) ).append( "\">\n" );
 
       //add geometry column (as gml)
       QgsGeometry geom = feat->geometry();
@@ -1350,13 +1364,10 @@ namespace QgsWfs
       {
         int prec = params.precision;
         QgsCoordinateReferenceSystem crs = params.crs;
-        Q_NOWARN_DEPRECATED_PUSH
-        QgsCoordinateTransform mTransform( crs, params.outputCrs );
-        Q_NOWARN_DEPRECATED_POP
         try
         {
           QgsGeometry transformed = geom;
-          if ( transformed.transform( mTransform ) == 0 )
+          if ( transformed.transform( params.transform ) == 0 )
           {
             geom = transformed;
             crs = params.outputCrs;
@@ -1369,32 +1380,36 @@ namespace QgsWfs
           Q_UNUSED( cse );
         }
 
-        QDomElement geomElem = doc.createElement( QStringLiteral( "qgs:geometry" ) );
+        // only the geometry is built as a DOM fragment, its nodes
+        // are released once the feature is serialized
         QDomElement gmlElem;
         if ( params.geometryName == QLatin1String( "EXTENT" ) )
         {
           QgsGeometry bbox = QgsGeometry::fromRect( geom.boundingBox() );
-          gmlElem = QgsOgcUtils::geometryToGML( bbox, doc, QStringLiteral( "GML3" ), prec );
+          gmlElem = gml3 ? QgsOgcUtils::geometryToGML( bbox, state.gmlDocument, QStringLiteral( "GML3" ), prec )
+                    : QgsOgcUtils::geometryToGML( bbox, state.gmlDocument, prec );
         }
         else if ( params.geometryName == QLatin1String( "CENTROID" ) )
         {
           QgsGeometry centroid = geom.centroid();
-          gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, QStringLiteral( "GML3" ), prec );
+          gmlElem = gml3 ? QgsOgcUtils::geometryToGML( centroid, state.gmlDocument, QStringLiteral( "GML3" ), prec )
+                    : QgsOgcUtils::geometryToGML( centroid, state.gmlDocument, prec );
         }
         else
         {
           const QgsAbstractGeometry *abstractGeom = geom.constGet();
           if ( abstractGeom )
           {
-            gmlElem = abstractGeom->asGml3( doc, prec, "http://www.opengis.net/gml" );
+            gmlElem = gml3 ? abstractGeom->asGml3( state.gmlDocument, prec, "http://www.opengis.net/gml" )
+                      : abstractGeom->asGml2( state.gmlDocument, prec, "http://www.opengis.net/gml" );
           }
         }
 
         if ( !gmlElem.isNull() )
         {
           QgsRectangle box = geom.boundingBox();
-          QDomElement bbElem = doc.createElement( QStringLiteral( "gml:boundedBy" ) );
-          QDomElement boxElem = QgsOgcUtils::rectangleToGMLEnvelope( &box, doc, prec );
+          QDomElement boxElem = gml3 ? QgsOgcUtils::rectangleToGMLEnvelope( &box, state.gmlDocument, prec )
+                                : QgsOgcUtils::rectangleToGMLBox( &box, state.gmlDocument, prec );
 
           if ( crs.isValid() )
           {
@@ -1402,17 +1417,19 @@ namespace QgsWfs
             gmlElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
           }
 
-          bbElem.appendChild( boxElem );
-          typeNameElement.appendChild( bbElem );
+          out.append( "  <gml:boundedBy>\n" );
+          writeGmlElement( out, boxElem, 3 );
+          out.append( "  </gml:boundedBy>\n" );
 
-          geomElem.appendChild( gmlElem );
-          typeNameElement.appendChild( geomElem );
+          out.append( "  <qgs:geometry>\n" );
+          writeGmlElement( out, gmlElem, 3 );
+          out.append( "  </qgs:geometry>\n" );
         }
       }
 
       //read all attribute values from the feature
-      QgsAttributes featureAttributes = feat->attributes();
-      QgsFields fields = feat->fields();
+      const QgsAttributes featureAttributes = feat->attributes();
+      const QgsFields fields = feat->fields();
       for ( int i = 0; i < params.attributeIndexes.count(); ++i )
       {
         int idx = params.attributeIndexes[i];
@@ -1421,19 +1438,27 @@ namespace QgsWfs
           continue;
         }
         QString attributeName = fields.at( idx ).name();
+        const QByteArray tagName = fixedXmlName( state.gmlDocument, "qgs:" + attributeName.replace( ' ', '_' ).replace( cleanTagNameRegExp, QLatin1String( "" ) ) ).toUtf8();
+        if ( tagName.isEmpty() )
+          continue;
 
-        QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( ' ', '_' ).replace( cleanTagNameRegExp, QLatin1String( "" ) ) );
-        QDomText fieldText = doc.createTextNode( featureAttributes[idx].toString() );
-        fieldElem.appendChild( fieldText );
-        typeNameElement.appendChild( fieldElem );
+        QString value;
+        if ( fixedCharData( state.gmlDocument, featureAttributes[idx].toString(), value ) )
+        {
+          out.append( "  <" ).append( tagName ).append( '>' );
+          out.append( escapedXml( value, false ) );
+          out.append( "</" ).append( tagName ).append( ">\n" );
+        }
+        else
+        {
+          out.append( "  <" ).append( tagName ).append( "/>\n" );
+        }
       }
 
-      return featureElement;
+      out.append( " </" ).append( typeName ).append( ">\n" );
+      out.append( "</gml:featureMember>\n" );
     }
 
-
-
-
   } // namespace
 
 } // samespace QgsWfs
@@ -63,12 +63,12 @@ namespace QgsWfs
   /**
    * Transform RequestBody root element to getFeatureRequest
    */
-  getFeatureRequest parseGetFeatureRequestBody( QDomElement &docElem );
+  getFeatureRequest parseGetFeatureRequestBody( QDomElement &docElem, const QgsWfsParameters &wfsParameters );
 
   /**
    * Transform parameters to getFeatureRequest
    */
-  getFeatureRequest parseGetFeatureParameters();
+  getFeatureRequest parseGetFeatureParameters( const QgsServerRequest::Parameters &parameters, const QgsWfsParameters &wfsParameters );
 
   /**
    * Output WFS  GetFeature response
@@ -488,7 +488,8 @@ namespace QgsWms
     mRequestParameters = parameters;
 
     const QMetaEnum metaEnum( QMetaEnum::fromType<ParameterName>() );
-    static QRegExp composerParamRegExp( QStringLiteral( "^MAP\\d+:" ) );
+    // QRegExp keeps matching state, it must not be shared by concurrent requests
+    const QRegExp composerParamRegExp( QStringLiteral( "^MAP\\d+:" ) );
 
     foreach ( QString key, parameters.keys() )
     {
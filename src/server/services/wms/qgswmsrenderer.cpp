@@ -54,6 +54,7 @@
 #include "qgsaccesscontrol.h"
 #include "qgsfeaturerequest.h"
 #include "qgsmaprendererjobproxy.h"
+#include "qgswmstilecache.h"
 #include "qgswmsserviceexception.h"
 #include "qgsserverprojectutils.h"
 #include "qgsgui.h"
@@ -76,6 +77,7 @@
 #include <QTemporaryFile>
 #include <QTextStream>
 #include <QDir>
+#include <QFileInfo>
 
 //for printing
 #include "qgslayoutmanager.h"
@@ -700,12 +702,46 @@ namespace QgsWms
     // add highlight layers above others
     layers = layers << highlightLayers( mWmsParameters.highlightLayersParameters() );
 
+    // tile aligned requests are rendered as metatiles and cached. The cache is
+    // only looked up once the read permissions of the layers are checked, and
+    // its keys include the cache keys of the access control plugins
+    Metatile metatile;
+    const bool metatiling = !hitTest && metatileForRequest( metatile );
+    std::unique_ptr<QgsWmsTileCache::MetatileRendering> metatileRendering;
+    if ( metatiling )
+    {
+      QgsWmsTileCache *cache = QgsWmsTileCache::instance( mSettings );
+      const QString key = metatile.keys.at( metatile.row * metatile.size + metatile.column );
+      QImage tile;
+      if ( cache->tile( mProject->fileName(), key, tile ) )
+      {
+        return new QImage( tile );
+      }
+
+      // wait for concurrent requests rendering the same metatile, which may have cached the tile
+      metatileRendering.reset( new QgsWmsTileCache::MetatileRendering( cache, mProject->fileName(), metatile.key ) );
+      if ( cache->tile( mProject->fileName(), key, tile ) )
+      {
+        return new QImage( tile );
+      }
+    }
+
     // create the output image and the painter
     std::unique_ptr<QPainter> painter;
     std::unique_ptr<QImage> image( createImage() );
 
+    // render the whole metatile instead of the requested tile
+    if ( metatiling )
+    {
+      image.reset( createImage( image->width() * metatile.size, image->height() * metatile.size, false ) );
+    }
+
     // configure map settings (background, DPI, ...)
     configureMapSettings( image.get(), mapSettings );
+    if ( metatiling )
+    {
+      mapSettings.setExtent( metatile.extent );
+    }
 
     // add layers to map settings (revert order for the rendering)
     std::reverse( layers.begin(), layers.end() );
@@ -720,6 +756,23 @@ namespace QgsWms
     // painting is terminated
     painter->end();
 
+    if ( metatiling )
+    {
+      // slice the metatile and cache all its tiles
+      const int tileWidth = image->width() / metatile.size;
+      const int tileHeight = image->height() / metatile.size;
+      QgsWmsTileCache *cache = QgsWmsTileCache::instance( mSettings );
+      for ( int row = 0; row < metatile.size; ++row )
+      {
+        for ( int column = 0; column < metatile.size; ++column )
+        {
+          cache->insertTile( mProject->fileName(), metatile.keys.at( row * metatile.size + column ),
+                             image->copy( column * tileWidth, row * tileHeight, tileWidth, tileHeight ) );
+        }
+      }
+      return new QImage( image->copy( metatile.column * tileWidth, metatile.row * tileHeight, tileWidth, tileHeight ) );
+    }
+
     // scale output image if necessary (required by WMS spec)
     QImage *scaledImage = scaleImage( image.get() );
     if ( scaledImage )
@@ -729,6 +782,88 @@ namespace QgsWms
     return image.release();
   }
 
+  bool QgsRenderer::metatileForRequest( Metatile &metatile ) const
+  {
+    const int size = mSettings.wmsMetatileSize();
+    if ( size <= 1 || mWmsParameters.bbox().isEmpty() )
+      return false;
+
+    // only requests whose output depends on the project and the layers
+    // styles may be cached
+    if ( !mWmsParameters.sld().isEmpty()
+         || !mWmsParameters.filters().isEmpty()
+         || !mWmsParameters.selections().isEmpty()
+         || !mWmsParameters.opacities().isEmpty()
+         || !mWmsParameters.highlightGeom().isEmpty() )
+      return false;
+
+    const QgsWmsParameters::Format format = mWmsParameters.format();
+    if ( format != QgsWmsParameters::PNG && format != QgsWmsParameters::JPG )
+      return false;
+
+    QStringList keyList;
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+    if ( mAccessControl && !mAccessControl->fillCacheKey( keyList ) )
+      return false;
+#endif
+
+    // the requested image must not be rescaled
+    std::unique_ptr<QImage> image( createImage() );
+    if ( image->width() != mWmsParameters.widthAsInt() || image->height() != mWmsParameters.heightAsInt() )
+      return false;
+
+    QgsMapSettings mapSettings;
+    configureMapSettings( image.get(), mapSettings );
+    const QgsRectangle extent = mapSettings.extent();
+
+    // the request must fit in a grid of tiles with the same size
+    // and the CRS origin as a corner
+    const double tileWidth = extent.width();
+    const double tileHeight = extent.height();
+    const double column = extent.xMinimum() / tileWidth;
+    const double row = -extent.yMaximum() / tileHeight;
+    if ( !qgsDoubleNear( column, std::round( column ), 1E-6 ) || !qgsDoubleNear( row, std::round( row ), 1E-6 ) )
+      return false;
+
+    const qlonglong tileColumn = std::llround( column );
+    const qlonglong tileRow = std::llround( row );
+    const qlonglong metatileColumn = static_cast< qlonglong >( std::floor( static_cast< double >( tileColumn ) / size ) ) * size;
+    const qlonglong metatileRow = static_cast< qlonglong >( std::floor( static_cast< double >( tileRow ) / size ) ) * size;
+
+    metatile.size = size;
+    metatile.column = static_cast< int >( tileColumn - metatileColumn );
+    metatile.row = static_cast< int >( tileRow - metatileRow );
+    metatile.extent = QgsRectangle( metatileColumn * tileWidth, -( metatileRow + size ) * tileHeight,
+                                    ( metatileColumn + size ) * tileWidth, -metatileRow * tileHeight );
+
+    // everything defining the rendered image except the tile position
+    QFileInfo projectFileInfo( mProject->fileName() );
+    keyList << projectFileInfo.lastModified().toString( Qt::ISODate )
+            << mWmsParameters.allLayersNickname().join( ',' )
+            << mWmsParameters.allStyles().join( ',' )
+            << mapSettings.destinationCrs().authid()
+            << mWmsParameters.formatAsString()
+            << mWmsParameters.transparent()
+            << mWmsParameters.backgroundColor()
+            << mWmsParameters.dpi()
+            << QString::number( image->width() )
+            << QString::number( image->height() )
+            << QString::number( tileWidth, 'g', 10 )
+            << QString::number( tileHeight, 'g', 10 );
+    const QString baseKey = keyList.join( '|' );
+
+    metatile.key = QStringLiteral( "%1|%2|%3|%4" ).arg( baseKey ).arg( metatileColumn ).arg( metatileRow ).arg( size );
+    metatile.keys.clear();
+    for ( qlonglong r = metatileRow; r < metatileRow + size; ++r )
+    {
+      for ( qlonglong c = metatileColumn; c < metatileColumn + size; ++c )
+      {
+        metatile.keys << QStringLiteral( "%1|%2|%3" ).arg( baseKey ).arg( c ).arg( r );
+      }
+    }
+    return true;
+  }
+
   QgsDxfExport QgsRenderer::getDxf( const QMap<QString, QString> &options )
   {
     QgsDxfExport dxf;
@@ -283,6 +283,30 @@ namespace QgsWms
       //! Creates external WMS layer. Caller takes ownership
       QgsMapLayer *createExternalWMSLayer( const QString &externalLayerId ) const;
 
+      //! Metatile rendered in place of a tile aligned GetMap request
+      struct Metatile
+      {
+        //! Map extent of the metatile
+        QgsRectangle extent;
+        //! Number of tiles along each side
+        int size = 0;
+        //! Column of the requested tile, from the left
+        int column = 0;
+        //! Row of the requested tile, from the top
+        int row = 0;
+        //! Key identifying the metatile among concurrent renderings
+        QString key;
+        //! Tile cache keys of the tiles, row by row from the top left tile
+        QStringList keys;
+      };
+
+      /**
+       * Computes the metatile containing the requested map. Returns false if
+       * metatiling is disabled or if the request is not a tile aligned request
+       * which may be cached.
+       */
+      bool metatileForRequest( Metatile &metatile ) const;
+
       void removeTemporaryLayers();
 
     private:
@@ -0,0 +1,289 @@
+/***************************************************************************
+                              qgswmstilecache.cpp
+                              -------------------
+  begin                : April 2018
+  copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgswmstilecache.h"
+#include "qgsconfigcache.h"
+#include "qgsmessagelog.h"
+#include "qgsserversettings.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <limits>
+
+namespace QgsWms
+{
+  namespace
+  {
+    QString hashed( const QString &value )
+    {
+      return QString::fromLatin1( QCryptographicHash::hash( value.toUtf8(), QCryptographicHash::Md5 ).toHex() );
+    }
+  }
+
+  //
+  // QgsWmsMemoryTileStore
+  //
+
+  QgsWmsMemoryTileStore::QgsWmsMemoryTileStore( qint64 maxSize )
+  {
+    mTiles.setMaxCost( static_cast< int >( std::min< qint64 >( maxSize / 1024, std::numeric_limits<int>::max() ) ) );
+  }
+
+  bool QgsWmsMemoryTileStore::tile( const QString &projectPath, const QString &key, QImage &image )
+  {
+    QMutexLocker locker( &mMutex );
+    QImage *cached = mTiles.object( projectPath + '\n' + key );
+    if ( !cached )
+      return false;
+
+    image = *cached;
+    return true;
+  }
+
+  void QgsWmsMemoryTileStore::insertTile( const QString &projectPath, const QString &key, const QImage &image )
+  {
+    const int cost = std::max( 1, image.byteCount() / 1024 );
+    QMutexLocker locker( &mMutex );
+    mTiles.insert( projectPath + '\n' + key, new QImage( image ), cost );
+  }
+
+  void QgsWmsMemoryTileStore::removeProject( const QString &projectPath )
+  {
+    const QString prefix = projectPath + '\n';
+    QMutexLocker locker( &mMutex );
+    const QList<QString> keys = mTiles.keys();
+    for ( const QString &key : keys )
+    {
+      if ( key.startsWith( prefix ) )
+        mTiles.remove( key );
+    }
+  }
+
+  //
+  // QgsWmsDiskTileStore
+  //
+
+  QgsWmsDiskTileStore::QgsWmsDiskTileStore( const QString &directory, qint64 maxSize )
+    : mDirectory( directory )
+    , mMaxSize( maxSize )
+  {
+    if ( mMaxSize <= 0 )
+      return;
+
+    // tiles left by a previous run count in the limit
+    const QFileInfoList files = tileFiles();
+    for ( const QFileInfo &file : files )
+    {
+      mSize += file.size();
+    }
+    if ( mSize > mMaxSize )
+      evictTiles();
+  }
+
+  bool QgsWmsDiskTileStore::tile( const QString &projectPath, const QString &key, QImage &image )
+  {
+    const QString path = tilePath( projectPath, key );
+    if ( !QFileInfo::exists( path ) )
+      return false;
+
+    return image.load( path, "PNG" );
+  }
+
+  void QgsWmsDiskTileStore::insertTile( const QString &projectPath, const QString &key, const QImage &image )
+  {
+    if ( !QDir().mkpath( projectDirectory( projectPath ) ) )
+    {
+      QgsMessageLog::logMessage( QStringLiteral( "Cannot create tile cache directory %1" ).arg( projectDirectory( projectPath ) ), QStringLiteral( "Server" ), Qgis::Warning );
+      return;
+    }
+
+    // write to a temporary file first so that concurrent readers
+    // never see a partially written tile
+    QSaveFile file( tilePath( projectPath, key ) );
+    if ( !file.open( QIODevice::WriteOnly ) || !image.save( &file, "PNG" ) || !file.commit() )
+    {
+      QgsMessageLog::logMessage( QStringLiteral( "Cannot write tile %1" ).arg( file.fileName() ), QStringLiteral( "Server" ), Qgis::Warning );
+      return;
+    }
+
+    if ( mMaxSize <= 0 )
+      return;
+
+    QMutexLocker locker( &mMutex );
+    mSize += QFileInfo( file.fileName() ).size();
+    if ( mSize > mMaxSize )
+      evictTiles();
+  }
+
+  void QgsWmsDiskTileStore::removeProject( const QString &projectPath )
+  {
+    QDir( projectDirectory( projectPath ) ).removeRecursively();
+
+    if ( mMaxSize <= 0 )
+      return;
+
+    QMutexLocker locker( &mMutex );
+    mSize = 0;
+    const QFileInfoList files = tileFiles();
+    for ( const QFileInfo &file : files )
+    {
+      mSize += file.size();
+    }
+  }
+
+  QFileInfoList QgsWmsDiskTileStore::tileFiles() const
+  {
+    QFileInfoList files;
+    QDirIterator it( mDirectory, QStringList() << QStringLiteral( "*.png" ), QDir::Files, QDirIterator::Subdirectories );
+    while ( it.hasNext() )
+    {
+      it.next();
+      files << it.fileInfo();
+    }
+    return files;
+  }
+
+  void QgsWmsDiskTileStore::evictTiles()
+  {
+    // the size is recomputed from the files, as replaced tiles are counted
+    // twice and other server processes may share the directory
+    QFileInfoList files = tileFiles();
+    std::sort( files.begin(), files.end(), []( const QFileInfo & a, const QFileInfo & b )
+    {
+      return a.lastModified() < b.lastModified();
+    } );
+
+    mSize = 0;
+    for ( const QFileInfo &file : qgis::as_const( files ) )
+    {
+      mSize += file.size();
+    }
+
+    // leave some room so that the files are not listed again for the next tiles
+    const qint64 targetSize = mMaxSize / 10 * 9;
+    for ( const QFileInfo &file : qgis::as_const( files ) )
+    {
+      if ( mSize <= targetSize )
+        break;
+
+      if ( QFile::remove( file.filePath() ) )
+        mSize -= file.size();
+    }
+  }
+
+  QString QgsWmsDiskTileStore::projectDirectory( const QString &projectPath ) const
+  {
+    return mDirectory + QDir::separator() + hashed( projectPath );
+  }
+
+  QString QgsWmsDiskTileStore::tilePath( const QString &projectPath, const QString &key ) const
+  {
+    return projectDirectory( projectPath ) + QDir::separator() + hashed( key ) + QStringLiteral( ".png" );
+  }
+
+  //
+  // QgsWmsTileCache::MetatileRendering
+  //
+
+  QgsWmsTileCache::MetatileRendering::MetatileRendering( QgsWmsTileCache *cache, const QString &projectPath, const QString &key )
+    : mCache( cache )
+    , mKey( projectPath + '\n' + key )
+  {
+    QMutexLocker locker( &mCache->mRenderingMutex );
+    while ( mCache->mRendering.contains( mKey ) )
+    {
+      mCache->mRenderingFinished.wait( &mCache->mRenderingMutex );
+    }
+    mCache->mRendering.insert( mKey );
+  }
+
+  QgsWmsTileCache::MetatileRendering::~MetatileRendering()
+  {
+    QMutexLocker locker( &mCache->mRenderingMutex );
+    mCache->mRendering.remove( mKey );
+    mCache->mRenderingFinished.wakeAll();
+  }
+
+  //
+  // QgsWmsTileCache
+  //
+
+  QgsWmsTileCache *QgsWmsTileCache::instance( const QgsServerSettings &settings )
+  {
+    static QgsWmsTileCache *sInstance = nullptr;
+    static QMutex sMutex;
+
+    QMutexLocker locker( &sMutex );
+    if ( !sInstance )
+    {
+      sInstance = new QgsWmsTileCache();
+      sInstance->addStore( new QgsWmsMemoryTileStore( settings.wmsTileCacheSize() ) );
+      if ( !settings.wmsTileCacheDirectory().isEmpty() )
+      {
+        sInstance->addStore( new QgsWmsDiskTileStore( settings.wmsTileCacheDirectory(), settings.wmsTileCacheDirectorySize() ) );
+      }
+
+      QObject::connect( QgsConfigCache::instance(), &QgsConfigCache::projectRemoved, [ = ]( const QString & path )
+      {
+        sInstance->removeProject( path );
+      } );
+    }
+    return sInstance;
+  }
+
+  void QgsWmsTileCache::addStore( QgsWmsTileStore *store )
+  {
+    mStores.emplace_back( store );
+  }
+
+  bool QgsWmsTileCache::tile( const QString &projectPath, const QString &key, QImage &image )
+  {
+    for ( size_t i = 0; i < mStores.size(); ++i )
+    {
+      if ( mStores[i]->tile( projectPath, key, image ) )
+      {
+        for ( size_t j = 0; j < i; ++j )
+        {
+          mStores[j]->insertTile( projectPath, key, image );
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void QgsWmsTileCache::insertTile( const QString &projectPath, const QString &key, const QImage &image )
+  {
+    for ( const std::unique_ptr< QgsWmsTileStore > &store : mStores )
+    {
+      store->insertTile( projectPath, key, image );
+    }
+  }
+
+  void QgsWmsTileCache::removeProject( const QString &projectPath )
+  {
+    for ( const std::unique_ptr< QgsWmsTileStore > &store : mStores )
+    {
+      store->removeProject( projectPath );
+    }
+  }
+
+} // namespace QgsWms
@@ -0,0 +1,224 @@
+/***************************************************************************
+                              qgswmstilecache.h
+                              -----------------
+  begin                : April 2018
+  copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSWMSTILECACHE_H
+#define QGSWMSTILECACHE_H
+
+#include <QCache>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QWaitCondition>
+
+#include <memory>
+#include <vector>
+
+class QgsServerSettings;
+
+namespace QgsWms
+{
+
+  /**
+   * \ingroup server
+   * Interface for stores of rendered WMS tiles.
+   *
+   * Tiles are identified by the path of the project they were rendered
+   * from and a key describing the request. Implementations must be thread safe.
+   * \since QGIS 3.2
+   */
+  class QgsWmsTileStore
+  {
+    public:
+
+      virtual ~QgsWmsTileStore() = default;
+
+      /**
+       * Fetches a tile.
+       * \param projectPath path of the project the tile was rendered from
+       * \param key key of the tile
+       * \param image out: the tile image
+       * \returns true if the tile was found in the store
+       */
+      virtual bool tile( const QString &projectPath, const QString &key, QImage &image ) = 0;
+
+      /**
+       * Stores a tile.
+       * \param projectPath path of the project the tile was rendered from
+       * \param key key of the tile
+       * \param image the tile image
+       */
+      virtual void insertTile( const QString &projectPath, const QString &key, const QImage &image ) = 0;
+
+      /**
+       * Removes all the tiles rendered from a project.
+       */
+      virtual void removeProject( const QString &projectPath ) = 0;
+  };
+
+  /**
+   * \ingroup server
+   * In memory tile store evicting the least recently used tiles when
+   * its memory budget is exceeded.
+   * \since QGIS 3.2
+   */
+  class QgsWmsMemoryTileStore : public QgsWmsTileStore
+  {
+    public:
+
+      /**
+       * Constructor.
+       * \param maxSize memory budget in bytes
+       */
+      explicit QgsWmsMemoryTileStore( qint64 maxSize );
+
+      bool tile( const QString &projectPath, const QString &key, QImage &image ) override;
+      void insertTile( const QString &projectPath, const QString &key, const QImage &image ) override;
+      void removeProject( const QString &projectPath ) override;
+
+    private:
+      QMutex mMutex;
+      //! Tiles by project path and key, the cost is the image size in kB
+      QCache<QString, QImage> mTiles;
+  };
+
+  /**
+   * \ingroup server
+   * On disk tile store. Tiles are written as PNG files in one
+   * subdirectory per project.
+   *
+   * When the files exceed the size limit of the store, the oldest
+   * tiles are removed until the files fit in 90% of the limit.
+   * \since QGIS 3.2
+   */
+  class QgsWmsDiskTileStore : public QgsWmsTileStore
+  {
+    public:
+
+      /**
+       * Constructor.
+       * \param directory the root directory of the store
+       * \param maxSize size limit of the tile files in bytes, 0 for no limit
+       */
+      QgsWmsDiskTileStore( const QString &directory, qint64 maxSize );
+
+      bool tile( const QString &projectPath, const QString &key, QImage &image ) override;
+      void insertTile( const QString &projectPath, const QString &key, const QImage &image ) override;
+      void removeProject( const QString &projectPath ) override;
+
+    private:
+      //! Returns the directory holding the tiles of a project
+      QString projectDirectory( const QString &projectPath ) const;
+
+      //! Returns the file path of a tile
+      QString tilePath( const QString &projectPath, const QString &key ) const;
+
+      //! Returns the tile files of all the projects
+      QFileInfoList tileFiles() const;
+
+      //! Removes the oldest tiles until the files fit in the size limit
+      void evictTiles();
+
+      QString mDirectory;
+      qint64 mMaxSize = 0;
+
+      //! Guards mSize
+      QMutex mMutex;
+      //! Estimated size of the tile files, recomputed from the files on eviction
+      qint64 mSize = 0;
+  };
+
+  /**
+   * \ingroup server
+   * Cache of rendered WMS tiles, looking up a chain of stores from the
+   * fastest to the slowest one.
+   *
+   * Tiles of a project are removed when the configuration cache
+   * reports that the project changed.
+   * \since QGIS 3.2
+   */
+  class QgsWmsTileCache
+  {
+    public:
+
+      /**
+       * Registers the rendering of a metatile for the lifetime of the object, so
+       * that concurrent requests for tiles of the same metatile wait for it
+       * instead of rendering it again.
+       */
+      class MetatileRendering
+      {
+        public:
+
+          /**
+           * Constructor. Waits until no other request renders the metatile
+           * with the given \a key, then registers the rendering.
+           */
+          MetatileRendering( QgsWmsTileCache *cache, const QString &projectPath, const QString &key );
+          ~MetatileRendering();
+
+          MetatileRendering( const MetatileRendering &other ) = delete;
+          MetatileRendering &operator=( const MetatileRendering &other ) = delete;
+
+        private:
+          QgsWmsTileCache *mCache = nullptr;
+          QString mKey;
+      };
+
+      /**
+       * Returns the cache instance, which is created on first call according
+       * to the \a settings.
+       */
+      static QgsWmsTileCache *instance( const QgsServerSettings &settings );
+
+      /**
+       * Adds a store at the end of the chain. Takes ownership of the store.
+       */
+      void addStore( QgsWmsTileStore *store );
+
+      /**
+       * Fetches a tile. A tile found in a slow store is copied
+       * to the faster ones.
+       * \returns true if the tile was found
+       */
+      bool tile( const QString &projectPath, const QString &key, QImage &image );
+
+      /**
+       * Stores a tile in all the stores.
+       */
+      void insertTile( const QString &projectPath, const QString &key, const QImage &image );
+
+      /**
+       * Removes all the tiles rendered from a project.
+       */
+      void removeProject( const QString &projectPath );
+
+    private:
+      QgsWmsTileCache() = default;
+
+      std::vector< std::unique_ptr< QgsWmsTileStore > > mStores;
+
+      QMutex mRenderingMutex;
+      //! Signaled when the rendering of a metatile is finished
+      QWaitCondition mRenderingFinished;
+      //! Project paths and keys of the metatiles being rendered
+      QSet<QString> mRendering;
+  };
+
+} // namespace QgsWms
+
+#endif
@@ -25,6 +25,9 @@ Email                : nyall dot dawson at gmail dot com
 #include "qgsgraphbuilder.h"
 #include "qgsgraph.h"
 #include "qgsgraphanalyzer.h"
+#include "qgsgraphrouter.h"
+
+#include <QtConcurrentMap>
 
 class TestQgsNetworkAnalysis : public QObject
 {
@@ -40,11 +43,14 @@ class TestQgsNetworkAnalysis : public QObject
     void testGraph();
     void testBuild();
     void testBuildTolerance();
+    void testBuildMatchesReference();
     void dijkkjkjkskkjsktra();
     void testRouteFail();
+    void testRouter();
 
   private:
     std::unique_ptr< QgsVectorLayer > buildNetwork();
+    std::unique_ptr< QgsVectorLayer > buildGridNetwork( int size, double tolerance );
 
 
 };
@@ -280,6 +286,217 @@ void TestQgsNetworkAnalysis::testBuildTolerance()
   QCOMPARE( graph->edge( 4 ).toVertex(), 3 );
 }
 
+/**
+ * Builds a graph the way QgsVectorLayerDirector did before it used spatial indexes:
+ * every vertex is compared to all the vertices already added, and every segment
+ * to all the additional points. Costs are distances, and the direction is read
+ * from the second field.
+ */
+static void buildReferenceGraph( QgsVectorLayer *network, QgsGraphBuilderInterface *builder,
+                                 const QVector< QgsPointXY > &additionalPoints, QVector< QgsPointXY > &snappedPoints )
+{
+  struct TiePoint
+  {
+    QgsFeatureId featureId = 0;
+    QgsPointXY firstPoint;
+    QgsPointXY lastPoint;
+    QgsPointXY tiedPoint;
+    double length = std::numeric_limits< double >::max();
+  };
+
+  const double tolerance = std::max( builder->topologyTolerance(), 1e-10 );
+  QVector< QgsPointXY > vertices;
+  auto findVertex = [&vertices, tolerance]( const QgsPointXY & point )->int
+  {
+    for ( int i = 0; i < vertices.count(); ++i )
+    {
+      if ( std::fabs( vertices.at( i ).x() - point.x() ) <= tolerance && std::fabs( vertices.at( i ).y() - point.y() ) <= tolerance )
+        return i;
+    }
+    return -1;
+  };
+  auto snapToVertex = [&vertices, &findVertex]( const QgsPointXY & point )->QgsPointXY
+  {
+    const int idx = findVertex( point );
+    if ( idx >= 0 )
+      return vertices.at( idx );
+    vertices << point;
+    return point;
+  };
+
+  snappedPoints = QVector< QgsPointXY >( additionalPoints.size() );
+  QVector< TiePoint > tiePoints( additionalPoints.size() );
+
+  QgsFeature feature;
+  QgsFeatureIterator fit = network->getFeatures();
+  while ( fit.nextFeature( feature ) )
+  {
+    const QgsPolylineXY line = feature.geometry().asPolyline();
+    for ( int v = 0; v < line.count(); ++v )
+    {
+      const QgsPointXY pt2 = snapToVertex( line.at( v ) );
+      if ( v == 0 )
+        continue;
+
+      const QgsPointXY pt1 = vertices.at( findVertex( line.at( v - 1 ) ) );
+      for ( int i = 0; i < additionalPoints.count(); ++i )
+      {
+        QgsPointXY snapped;
+        const double dist = additionalPoints.at( i ).sqrDistToSegment( pt1.x(), pt1.y(), pt2.x(), pt2.y(), snapped );
+        if ( dist < tiePoints.at( i ).length )
+        {
+          tiePoints[ i ].featureId = feature.id();
+          tiePoints[ i ].firstPoint = pt1;
+          tiePoints[ i ].lastPoint = pt2;
+          tiePoints[ i ].tiedPoint = snapped;
+          tiePoints[ i ].length = dist;
+        }
+      }
+    }
+  }
+
+  for ( int i = 0; i < tiePoints.count(); ++i )
+  {
+    snappedPoints[ i ] = snapToVertex( tiePoints.at( i ).tiedPoint );
+    tiePoints[ i ].tiedPoint = snappedPoints.at( i );
+  }
+
+  for ( int i = 0; i < vertices.count(); ++i )
+    builder->addVertex( i, vertices.at( i ) );
+
+  fit = network->getFeatures();
+  while ( fit.nextFeature( feature ) )
+  {
+    const QString direction = feature.attribute( 1 ).toString();
+    const QgsPolylineXY line = feature.geometry().asPolyline();
+    for ( int v = 1; v < line.count(); ++v )
+    {
+      const QgsPointXY pt1 = vertices.at( findVertex( line.at( v - 1 ) ) );
+      const QgsPointXY pt2 = vertices.at( findVertex( line.at( v ) ) );
+
+      QMap< double, QgsPointXY > pointsOnArc;
+      pointsOnArc[ 0.0 ] = pt1;
+      pointsOnArc[ pt1.sqrDist( pt2 ) ] = pt2;
+      for ( const TiePoint &tiePoint : qgis::as_const( tiePoints ) )
+      {
+        if ( tiePoint.featureId == feature.id() && tiePoint.firstPoint == pt1 && tiePoint.lastPoint == pt2 )
+          pointsOnArc[ pt1.sqrDist( tiePoint.tiedPoint ) ] = tiePoint.tiedPoint;
+      }
+
+      int idx1 = -1;
+      for ( auto it = pointsOnArc.constBegin(); it != pointsOnArc.constEnd(); ++it )
+      {
+        const int idx2 = findVertex( it.value() );
+        if ( idx1 >= 0 && vertices.at( idx1 ) != vertices.at( idx2 ) )
+        {
+          const double distance = builder->distanceArea()->measureLine( vertices.at( idx1 ), vertices.at( idx2 ) );
+          if ( direction != QLatin1String( "b" ) )
+            builder->addEdge( idx1, vertices.at( idx1 ), idx2, vertices.at( idx2 ), QVector< QVariant >() << distance );
+          if ( direction != QLatin1String( "f" ) )
+            builder->addEdge( idx2, vertices.at( idx2 ), idx1, vertices.at( idx1 ), QVector< QVariant >() << distance );
+        }
+        idx1 = idx2;
+      }
+    }
+  }
+}
+
+std::unique_ptr<QgsVectorLayer> TestQgsNetworkAnalysis::buildGridNetwork( int size, double tolerance )
+{
+  std::unique_ptr< QgsVectorLayer > l = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "LineString?crs=epsg:3857&field=cost:int&field=direction:string" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+
+  // deterministic jitter, smaller than half the tolerance so that the ends of
+  // lines meeting at a grid node are always merged into a single vertex
+  unsigned int seed = 1;
+  auto jitter = [&seed, tolerance]()->double
+  {
+    seed = seed * 1103515245 + 12345;
+    return ( static_cast< double >( ( seed >> 16 ) & 0x7fff ) / 0x7fff - 0.5 ) * tolerance * 0.8;
+  };
+  auto node = [&jitter]( int x, int y )
+  {
+    const double dx = jitter();
+    const double dy = jitter();
+    return QgsPointXY( x * 100 + dx, y * 100 + dy );
+  };
+
+  const QStringList directions = QStringList() << QString() << QStringLiteral( "f" ) << QStringLiteral( "b" );
+  QgsFeatureList flist;
+  for ( int x = 0; x < size; ++x )
+  {
+    for ( int y = 0; y < size; ++y )
+    {
+      for ( int horizontal = 0; horizontal < 2; ++horizontal )
+      {
+        if ( ( horizontal && x == size - 1 ) || ( !horizontal && y == size - 1 ) )
+          continue;
+
+        QgsPolylineXY line;
+        line << node( x, y );
+        // some lines have an intermediate vertex
+        if ( ( x + y ) % 3 == 0 )
+          line << ( horizontal ? QgsPointXY( x * 100 + 50, y * 100 + 10 ) : QgsPointXY( x * 100 + 10, y * 100 + 50 ) );
+        line << ( horizontal ? node( x + 1, y ) : node( x, y + 1 ) );
+
+        QgsFeature f;
+        f.setGeometry( QgsGeometry::fromPolylineXY( line ) );
+        f.setAttributes( QgsAttributes() << 1 << directions.at( ( x * 7 + y * 3 + horizontal ) % 3 ) );
+        flist << f;
+      }
+    }
+  }
+  l->dataProvider()->addFeatures( flist );
+  return l;
+}
+
+void TestQgsNetworkAnalysis::testBuildMatchesReference()
+{
+  const int size = 15;
+  const double tolerance = 1;
+  std::unique_ptr<QgsVectorLayer> network = buildGridNetwork( size, tolerance );
+
+  // additional points in distinct grid cells, away from the grid nodes
+  QVector< QgsPointXY > additionalPoints;
+  for ( int i = 0; i < 40; ++i )
+  {
+    const int x = ( i * 7 ) % ( size - 1 );
+    const int y = ( i * 11 + i / ( size - 1 ) ) % ( size - 1 );
+    additionalPoints << QgsPointXY( x * 100 + 30 + ( i * 37 ) % 41, y * 100 + 25 + ( i * 53 ) % 47 );
+  }
+
+  for ( double builderTolerance : QList< double >() << 0 << tolerance )
+  {
+    std::unique_ptr< QgsVectorLayerDirector > director = qgis::make_unique< QgsVectorLayerDirector > ( network.get(),
+        1, QStringLiteral( "f" ), QStringLiteral( "b" ), QString(), QgsVectorLayerDirector::DirectionBoth );
+    director->addStrategy( new QgsNetworkDistanceStrategy() );
+    QgsGraphBuilder builder( network->sourceCrs(), true, builderTolerance );
+    QVector<QgsPointXY > snapped;
+    director->makeGraph( &builder, additionalPoints, snapped );
+    std::unique_ptr< QgsGraph > graph( builder.graph() );
+
+    QgsGraphBuilder referenceBuilder( network->sourceCrs(), true, builderTolerance );
+    QVector<QgsPointXY > referenceSnapped;
+    buildReferenceGraph( network.get(), &referenceBuilder, additionalPoints, referenceSnapped );
+    std::unique_ptr< QgsGraph > reference( referenceBuilder.graph() );
+
+    QCOMPARE( snapped, referenceSnapped );
+    QCOMPARE( graph->vertexCount(), reference->vertexCount() );
+    for ( int i = 0; i < graph->vertexCount(); ++i )
+    {
+      QCOMPARE( graph->vertex( i ).point(), reference->vertex( i ).point() );
+      QCOMPARE( graph->vertex( i ).outgoingEdges(), reference->vertex( i ).outgoingEdges() );
+      QCOMPARE( graph->vertex( i ).incomingEdges(), reference->vertex( i ).incomingEdges() );
+    }
+    QCOMPARE( graph->edgeCount(), reference->edgeCount() );
+    for ( int i = 0; i < graph->edgeCount(); ++i )
+    {
+      QCOMPARE( graph->edge( i ).fromVertex(), reference->edge( i ).fromVertex() );
+      QCOMPARE( graph->edge( i ).toVertex(), reference->edge( i ).toVertex() );
+      QGSCOMPARENEAR( graph->edge( i ).cost( 0 ).toDouble(), reference->edge( i ).cost( 0 ).toDouble(), 1e-6 );
+    }
+  }
+}
+
 void TestQgsNetworkAnalysis::dijkkjkjkskkjsktra()
 {
   std::unique_ptr<QgsVectorLayer> network = buildNetwork();
@@ -518,6 +735,145 @@ void TestQgsNetworkAnalysis::testRouteFail()
 }
 
 
+void TestQgsNetworkAnalysis::testRouter()
+{
+  // grid graph with varying costs, in both directions, with a few parallel edges
+  const int size = 15;
+  QgsGraph graph;
+  for ( int y = 0; y < size; ++y )
+    for ( int x = 0; x < size; ++x )
+      graph.addVertex( QgsPointXY( x, y ) );
+
+  qint64 seed = 1;
+  auto nextCost = [&seed]()
+  {
+    seed = ( seed * 1103515245LL + 12345 ) % 2147483648LL;
+    return static_cast< int >( 1 + ( seed >> 16 ) % 10 );
+  };
+  for ( int y = 0; y < size; ++y )
+  {
+    for ( int x = 0; x < size; ++x )
+    {
+      const int vertex = y * size + x;
+      if ( x + 1 < size )
+      {
+        graph.addEdge( vertex, vertex + 1, QVector< QVariant >() << nextCost() );
+        graph.addEdge( vertex + 1, vertex, QVector< QVariant >() << nextCost() );
+      }
+      if ( y + 1 < size )
+      {
+        graph.addEdge( vertex, vertex + size, QVector< QVariant >() << nextCost() );
+        if ( x % 3 )
+          graph.addEdge( vertex + size, vertex, QVector< QVariant >() << nextCost() );
+      }
+      if ( x % 4 == 0 && x + 1 < size )
+        graph.addEdge( vertex, vertex + 1, QVector< QVariant >() << nextCost() );
+    }
+  }
+
+  QgsGraphRouter router( &graph, 0 );
+  QVERIFY( !router.isPrepared() );
+  QCOMPARE( router.shortcutCount(), 0 );
+
+  // invalid vertices
+  QVERIFY( std::isinf( router.shortestPath( -1, 0 ) ) );
+  QVERIFY( std::isinf( router.shortestPath( 0, graph.vertexCount() ) ) );
+  QCOMPARE( router.shortestPath( 3, 3 ), 0.0 );
+
+  auto checkPaths = [&graph]( const QgsGraphRouter & router )
+  {
+    for ( int from = 0; from < graph.vertexCount(); from += 7 )
+    {
+      QVector< double > expected;
+      QgsGraphAnalyzer::dijkstra( &graph, from, 0, nullptr, &expected );
+      for ( int to = 0; to < graph.vertexCount(); to += 3 )
+      {
+        QVector< int > edges;
+        const double cost = router.shortestPath( from, to, &edges );
+        QCOMPARE( cost, expected.at( to ) );
+
+        // edges must form a connected path with the same cost
+        int vertex = from;
+        double total = 0;
+        for ( int edge : qgis::as_const( edges ) )
+        {
+          QCOMPARE( graph.edge( edge ).fromVertex(), vertex );
+          vertex = graph.edge( edge ).toVertex();
+          total += graph.edge( edge ).cost( 0 ).toDouble();
+        }
+        QCOMPARE( vertex, to );
+        QCOMPARE( total, cost );
+      }
+    }
+  };
+
+  // bidirectional search
+  checkPaths( router );
+
+  // concurrent queries reusing the search buffers of the router
+  struct Query
+  {
+    int to;
+    double cost;
+  };
+  std::vector< Query > queries;
+  for ( int i = 0; i < 200; ++i )
+    queries.push_back( Query{ ( i * 37 ) % graph.vertexCount(), -1 } );
+  QtConcurrent::blockingMap( queries, [&router]( Query & query ) { query.cost = router.shortestPath( 5, query.to ); } );
+  QVector< double > fromFive;
+  QgsGraphAnalyzer::dijkstra( &graph, 5, 0, nullptr, &fromFive );
+  for ( const Query &query : queries )
+    QCOMPARE( query.cost, fromFive.at( query.to ) );
+
+  // contraction hierarchy
+  router.prepare();
+  QVERIFY( router.isPrepared() );
+  checkPaths( router );
+
+  // saved and reloaded hierarchy
+  const QString hierarchyPath = QDir::tempPath() + "/router_hierarchy.bin";
+  QVERIFY( router.writeHierarchy( hierarchyPath ) );
+  QgsGraphRouter reloaded( &graph, 0 );
+  QVERIFY( reloaded.readHierarchy( hierarchyPath ) );
+  QVERIFY( reloaded.isPrepared() );
+  QCOMPARE( reloaded.shortcutCount(), router.shortcutCount() );
+  checkPaths( reloaded );
+
+  // hierarchy built for another graph
+  QgsGraph other;
+  other.addVertex( QgsPointXY( 0, 0 ) );
+  QgsGraphRouter otherRouter( &other, 0 );
+  QVERIFY( !otherRouter.readHierarchy( hierarchyPath ) );
+  QVERIFY( !otherRouter.isPrepared() );
+  QFile::remove( hierarchyPath );
+
+  // cost matrix
+  const QVector< int > sources = QVector< int >() << 0 << 17 << 224 << -1;
+  const QVector< int > targets = QVector< int >() << 5 << 0 << 112 << 224;
+  const QVector< QVector< double > > matrix = router.costMatrix( sources, targets );
+  QCOMPARE( matrix.size(), sources.size() );
+  for ( int i = 0; i < sources.size(); ++i )
+  {
+    QCOMPARE( matrix.at( i ).size(), targets.size() );
+    for ( int j = 0; j < targets.size(); ++j )
+    {
+      if ( sources.at( i ) < 0 )
+        QVERIFY( std::isinf( matrix.at( i ).at( j ) ) );
+      else
+        QCOMPARE( matrix.at( i ).at( j ), router.shortestPath( sources.at( i ), targets.at( j ) ) );
+    }
+  }
+
+  // unreachable vertex
+  const int isolated = graph.addVertex( QgsPointXY( -10, -10 ) );
+  QgsGraphRouter isolatedRouter( &graph, 0 );
+  QVERIFY( std::isinf( isolatedRouter.shortestPath( 0, isolated ) ) );
+  isolatedRouter.prepare();
+  QVector< int > edges;
+  QVERIFY( std::isinf( isolatedRouter.shortestPath( isolated, 0, &edges ) ) );
+  QVERIFY( edges.isEmpty() );
+}
+
 
 QGSTEST_MAIN( TestQgsNetworkAnalysis )
 #include "testqgsnetworkanalysis.moc"
@@ -0,0 +1,172 @@
+/***************************************************************************
+  testqgsninecellfilter.cpp
+  -------------------------
+Date                 : April 2018
+Copyright            : (C) 2018 by QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsninecellfilter.h"
+#include "qgsslopefilter.h"
+#include "qgsaspectfilter.h"
+#include "qgshillshadefilter.h"
+#include "qgsruggednessfilter.h"
+#include "qgstotalcurvaturefilter.h"
+#include "qgsogrutils.h"
+
+#include <QTemporaryDir>
+#include <cmath>
+#include <vector>
+
+class TestQgsNineCellFilter : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init() {} // will be called before each testfunction is executed.
+    void cleanup() {} // will be called after every testfunction.
+
+    void tiledMatchesCellByCell_data();
+    void tiledMatchesCellByCell(); // compare the tiled output with the filter applied to each cell of the whole raster
+
+  private:
+    std::unique_ptr< QgsNineCellFilter > createFilter( const QString &name, const QString &outputFile ) const;
+    std::vector< float > readRaster( const QString &fileName, int padding, float paddingValue ) const;
+
+    QTemporaryDir mTempDir;
+    QString mInputFile;
+};
+
+// large enough to be processed in several tiles
+static const int WIDTH = 1100;
+static const int HEIGHT = 2000;
+static const float NODATA = -9999;
+
+void TestQgsNineCellFilter::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  // a smooth surface with some bumps and nodata cells
+  mInputFile = mTempDir.filePath( QStringLiteral( "dem.tif" ) );
+  GDALDriverH driver = GDALGetDriverByName( "GTiff" );
+  gdal::dataset_unique_ptr dataset( GDALCreate( driver, mInputFile.toUtf8().constData(), WIDTH, HEIGHT, 1, GDT_Float32, nullptr ) );
+  QVERIFY( dataset );
+  double geoTransform[6] = { 100000, 10, 0, 200000, 0, -10 };
+  GDALSetGeoTransform( dataset.get(), geoTransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset.get(), 1 );
+  GDALSetRasterNoDataValue( band, NODATA );
+
+  std::vector< float > line( WIDTH );
+  for ( int y = 0; y < HEIGHT; ++y )
+  {
+    for ( int x = 0; x < WIDTH; ++x )
+    {
+      if ( ( x * 13 + y * 7 ) % 101 == 0 )
+        line[x] = NODATA;
+      else
+        line[x] = std::sin( x / 37.0 ) * 100 + std::cos( y / 53.0 ) * 80 + ( x * y ) % 17;
+    }
+    QCOMPARE( GDALRasterIO( band, GF_Write, 0, y, WIDTH, 1, line.data(), WIDTH, 1, GDT_Float32, 0, 0 ), CE_None );
+  }
+}
+
+void TestQgsNineCellFilter::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+std::unique_ptr< QgsNineCellFilter > TestQgsNineCellFilter::createFilter( const QString &name, const QString &outputFile ) const
+{
+  std::unique_ptr< QgsNineCellFilter > filter;
+  if ( name == QLatin1String( "slope" ) )
+    filter.reset( new QgsSlopeFilter( mInputFile, outputFile, QStringLiteral( "GTiff" ) ) );
+  else if ( name == QLatin1String( "aspect" ) )
+    filter.reset( new QgsAspectFilter( mInputFile, outputFile, QStringLiteral( "GTiff" ) ) );
+  else if ( name == QLatin1String( "hillshade" ) )
+    filter.reset( new QgsHillshadeFilter( mInputFile, outputFile, QStringLiteral( "GTiff" ), 300, 40 ) );
+  else if ( name == QLatin1String( "ruggedness" ) )
+    filter.reset( new QgsRuggednessFilter( mInputFile, outputFile, QStringLiteral( "GTiff" ) ) );
+  else if ( name == QLatin1String( "totalcurvature" ) )
+    filter.reset( new QgsTotalCurvatureFilter( mInputFile, outputFile, QStringLiteral( "GTiff" ) ) );
+
+  filter->setCellSizeX( 10 );
+  filter->setCellSizeY( 10 );
+  filter->setZFactor( 1.5 );
+  return filter;
+}
+
+std::vector< float > TestQgsNineCellFilter::readRaster( const QString &fileName, int padding, float paddingValue ) const
+{
+  const int lineSize = WIDTH + 2 * padding;
+  std::vector< float > values( static_cast< size_t >( lineSize ) * ( HEIGHT + 2 * padding ), paddingValue );
+  gdal::dataset_unique_ptr dataset( GDALOpen( fileName.toUtf8().constData(), GA_ReadOnly ) );
+  if ( !dataset || GDALGetRasterXSize( dataset.get() ) != WIDTH || GDALGetRasterYSize( dataset.get() ) != HEIGHT )
+    return std::vector< float >();
+
+  if ( GDALRasterIO( GDALGetRasterBand( dataset.get(), 1 ), GF_Read, 0, 0, WIDTH, HEIGHT, values.data() + padding * lineSize + padding,
+                     WIDTH, HEIGHT, GDT_Float32, 0, sizeof( float ) * lineSize ) != CE_None )
+    return std::vector< float >();
+
+  return values;
+}
+
+void TestQgsNineCellFilter::tiledMatchesCellByCell_data()
+{
+  QTest::addColumn< QString >( "filterName" );
+  QTest::addColumn< bool >( "sequential" );
+
+  for ( const QString &name : QStringList() << QStringLiteral( "slope" ) << QStringLiteral( "aspect" ) << QStringLiteral( "hillshade" )
+        << QStringLiteral( "ruggedness" ) << QStringLiteral( "totalcurvature" ) )
+  {
+    QTest::newRow( name.toUtf8().constData() ) << name << false;
+    QTest::newRow( ( name + QStringLiteral( " sequential" ) ).toUtf8().constData() ) << name << true;
+  }
+}
+
+void TestQgsNineCellFilter::tiledMatchesCellByCell()
+{
+  QFETCH( QString, filterName );
+  QFETCH( bool, sequential );
+
+  const QString outputFile = mTempDir.filePath( filterName + ( sequential ? QStringLiteral( "_sequential.tif" ) : QStringLiteral( ".tif" ) ) );
+  std::unique_ptr< QgsNineCellFilter > filter = createFilter( filterName, outputFile );
+  filter->setSequentialProcessing( sequential );
+  QCOMPARE( filter->processRaster(), 0 );
+
+  const std::vector< float > output = readRaster( outputFile, 0, 0 );
+  QCOMPARE( output.size(), static_cast< size_t >( WIDTH ) * HEIGHT );
+
+  // apply the filter to each cell of the whole raster, with nodata values outside of it
+  std::vector< float > input = readRaster( mInputFile, 1, static_cast< float >( filter->inputNodataValue() ) );
+  QVERIFY( !input.empty() );
+  const int lineSize = WIDTH + 2;
+  for ( int y = 0; y < HEIGHT; ++y )
+  {
+    for ( int x = 0; x < WIDTH; ++x )
+    {
+      float *c = input.data() + ( y + 1 ) * lineSize + x + 1;
+      const float expected = filter->processNineCellWindow( c - lineSize - 1, c - lineSize, c - lineSize + 1,
+                             c - 1, c, c + 1,
+                             c + lineSize - 1, c + lineSize, c + lineSize + 1 );
+      const float value = output[ static_cast< size_t >( y ) * WIDTH + x ];
+      if ( !qgsDoubleNear( value, expected, 0.0001 ) )
+      {
+        QFAIL( QStringLiteral( "Cell %1,%2: %3 instead of %4" ).arg( x ).arg( y ).arg( value ).arg( expected ).toUtf8().constData() );
+      }
+    }
+  }
+}
+
+QGSTEST_MAIN( TestQgsNineCellFilter )
+#include "testqgsninecellfilter.moc"
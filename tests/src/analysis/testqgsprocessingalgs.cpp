@@ -24,6 +24,9 @@
 #include "qgsprocessingmodelalgorithm.h"
 #include "qgsnativealgorithms.h"
 #include "qgsalgorithmimportphotos.h"
+#include "qgsvectorlayer.h"
+
+#include <QThreadPool>
 
 class TestQgsProcessingAlgs: public QObject
 {
@@ -38,6 +41,7 @@ class TestQgsProcessingAlgs: public QObject
     void renameLayerAlg();
     void loadLayerAlg();
     void parseGeoTags();
+    void parallelFeatureProcessing();
 
   private:
 
@@ -354,5 +358,57 @@ void TestQgsProcessingAlgs::parseGeoTags()
 }
 
 
+void TestQgsProcessingAlgs::parallelFeatureProcessing()
+{
+  const QgsProcessingAlgorithm *translate( QgsApplication::processingRegistry()->algorithmById( QStringLiteral( "native:translategeometry" ) ) );
+  QVERIFY( translate );
+  QVERIFY( translate->flags() & QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing );
+
+  std::unique_ptr< QgsVectorLayer > layer = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "Point?crs=epsg:4326&field=id:integer" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer->isValid() );
+  QgsFeatureList features;
+  for ( int i = 0; i < 5000; ++i )
+  {
+    QgsFeature f( layer->fields() );
+    f.setAttribute( 0, i );
+    f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( i, 0 ) ) );
+    features << f;
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  // make sure several workers are used, even on single core machines
+  const int prevThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 4 );
+
+  std::unique_ptr< QgsProcessingContext > context = qgis::make_unique< QgsProcessingContext >();
+  QgsProcessingFeedback feedback;
+
+  QVariantMap parameters;
+  parameters.insert( QStringLiteral( "INPUT" ), QVariant::fromValue( layer.get() ) );
+  // data defined value, evaluated against each worker's own expression context
+  parameters.insert( QStringLiteral( "DELTA_Y" ), QgsProperty::fromExpression( QStringLiteral( "\"id\" * 2" ) ) );
+  parameters.insert( QStringLiteral( "OUTPUT" ), QStringLiteral( "memory:" ) );
+  bool ok = false;
+  QVariantMap results = translate->run( parameters, *context, &feedback, &ok );
+  QThreadPool::globalInstance()->setMaxThreadCount( prevThreadCount );
+  QVERIFY( ok );
+
+  QgsVectorLayer *output = qobject_cast< QgsVectorLayer * >( context->getMapLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) );
+  QVERIFY( output );
+  QCOMPARE( output->featureCount(), 5000L );
+
+  // features must be output in the input order
+  QgsFeatureIterator it = output->getFeatures();
+  QgsFeature f;
+  int expected = 0;
+  while ( it.nextFeature( f ) )
+  {
+    QCOMPARE( f.attribute( 0 ).toInt(), expected );
+    QCOMPARE( f.geometry().asPoint(), QgsPointXY( expected, expected * 2 ) );
+    expected++;
+  }
+  QCOMPARE( expected, 5000 );
+}
+
 QGSTEST_MAIN( TestQgsProcessingAlgs )
 #include "testqgsprocessingalgs.moc"
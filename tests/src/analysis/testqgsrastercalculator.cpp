@@ -53,6 +53,7 @@ class TestQgsRasterCalculator : public QObject
 
     void calcWithLayers();
     void calcWithReprojectedLayers();
+    void calcTiled(); // test calculation spanning several tiles
 
   private:
 
@@ -528,5 +529,54 @@ void TestQgsRasterCalculator::calcWithReprojectedLayers()
   delete block;
 }
 
+void TestQgsRasterCalculator::calcTiled()
+{
+  QgsRasterCalculatorEntry entry1;
+  entry1.bandNumber = 1;
+  entry1.raster = mpLandsatRasterLayer;
+  entry1.ref = QStringLiteral( "landsat@1" );
+
+  QgsRasterCalculatorEntry entry2;
+  entry2.bandNumber = 2;
+  entry2.raster = mpLandsatRasterLayer;
+  entry2.ref = QStringLiteral( "landsat@2" );
+
+  QVector<QgsRasterCalculatorEntry> entries;
+  entries << entry1 << entry2;
+
+  // each input pixel covers 4x4 output pixels, so that no output pixel lies on an input pixel edge
+  QgsRectangle extent = mpLandsatRasterLayer->extent();
+  int width = mpLandsatRasterLayer->width();
+  int height = mpLandsatRasterLayer->height();
+
+  QTemporaryFile tmpFile;
+  tmpFile.open(); // fileName is no avialable until open
+  QString tmpName = tmpFile.fileName();
+  tmpFile.close();
+
+  QgsRasterCalculator rc( QStringLiteral( "( \"landsat@1\" * 2 - \"landsat@2\" ) / 4 + 10 ^ 2 - sqrt( 16 )" ),
+                          tmpName,
+                          QStringLiteral( "GTiff" ),
+                          extent, mpLandsatRasterLayer->crs(), width * 4, height * 4, entries );
+  QCOMPARE( rc.processCalculation(), 0 );
+
+  std::unique_ptr< QgsRasterBlock > band1( mpLandsatRasterLayer->dataProvider()->block( 1, extent, width, height ) );
+  std::unique_ptr< QgsRasterBlock > band2( mpLandsatRasterLayer->dataProvider()->block( 2, extent, width, height ) );
+
+  //open output file and check results
+  std::unique_ptr< QgsRasterLayer > result = qgis::make_unique< QgsRasterLayer >( tmpName, QStringLiteral( "result" ) );
+  QCOMPARE( result->width(), width * 4 );
+  QCOMPARE( result->height(), height * 4 );
+  std::unique_ptr< QgsRasterBlock > block( result->dataProvider()->block( 1, extent, width * 4, height * 4 ) );
+  for ( int row = 0; row < height * 4; ++row )
+  {
+    for ( int col = 0; col < width * 4; ++col )
+    {
+      double expected = ( band1->value( row / 4, col / 4 ) * 2 - band2->value( row / 4, col / 4 ) ) / 4 + 96;
+      QGSCOMPARENEAR( block->value( row, col ), expected, 0.0001 );
+    }
+  }
+}
+
 QGSTEST_MAIN( TestQgsRasterCalculator )
 #include "testqgsrastercalculator.moc"
@@ -14,6 +14,8 @@
  ***************************************************************************/
 
 #include <QDir>
+#include <QFile>
+#include <QTextStream>
 #include "qgstest.h"
 
 #include "qgsapplication.h"
@@ -22,6 +24,9 @@
 #include "qgsrasterlayer.h"
 #include "qgszonalstatistics.h"
 #include "qgsproject.h"
+#include "qgsgeometryengine.h"
+#include "qgsrasterdataprovider.h"
+#include "qgsrasterblock.h"
 
 /**
  * \ingroup UnitTests
@@ -38,6 +43,8 @@ class TestQgsZonalStatistics : public QObject
     void cleanup() {}
 
     void testStatistics();
+    void testPercentiles();
+    void testCellCentersOnEdges();
 
   private:
     QgsVectorLayer *mVectorLayer = nullptr;
@@ -182,5 +189,96 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "myqgis2__4" ).toDouble(), 0.13888888888889 );
 }
 
+void TestQgsZonalStatistics::testPercentiles()
+{
+  QgsZonalStatistics zs( mVectorLayer, mRasterLayer, QStringLiteral( "pc_" ), 1, QgsZonalStatistics::Percentiles );
+  QCOMPARE( zs.percentiles(), QList< double >() << 25 << 75 );
+  zs.setPercentiles( QList< double >() << 25 << 40 << 50 );
+  QCOMPARE( zs.calculateStatistics( nullptr ), 0 );
+
+  QgsFeature f;
+  QgsFeatureRequest request;
+  request.setFilterFid( 0 );
+  bool fetched = mVectorLayer->getFeatures( request ).nextFeature( f );
+  QVERIFY( fetched );
+  QCOMPARE( f.attribute( "pc_p25" ).toDouble(), 0.0 );
+  QCOMPARE( f.attribute( "pc_p40" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "pc_p50" ).toDouble(), 1.0 );
+
+  request.setFilterFid( 1 );
+  fetched = mVectorLayer->getFeatures( request ).nextFeature( f );
+  QVERIFY( fetched );
+  QCOMPARE( f.attribute( "pc_p25" ).toDouble(), 0.0 );
+  QCOMPARE( f.attribute( "pc_p40" ).toDouble(), 0.2 );
+  QCOMPARE( f.attribute( "pc_p50" ).toDouble(), 1.0 );
+}
+
+void TestQgsZonalStatistics::testCellCentersOnEdges()
+{
+  // 10x10 raster of unit cells with distinct values, whose centers lie on the edges and vertices of the polygons
+  const QString rasterPath = QDir::tempPath() + "/zonal_edges.asc";
+  QFile rasterFile( rasterPath );
+  QVERIFY( rasterFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+  QTextStream stream( &rasterFile );
+  stream << "ncols 10\nnrows 10\nxllcorner 0\nyllcorner 0\ncellsize 1\nNODATA_value -9999\n";
+  for ( int row = 0; row < 10; ++row )
+  {
+    for ( int column = 0; column < 10; ++column )
+      stream << row * 10 + column << ' ';
+    stream << '\n';
+  }
+  rasterFile.close();
+  QgsRasterLayer rasterLayer( rasterPath, QStringLiteral( "raster" ), QStringLiteral( "gdal" ) );
+  QVERIFY( rasterLayer.isValid() );
+
+  QgsVectorLayer vectorLayer( QStringLiteral( "Polygon?field=id:integer" ), QStringLiteral( "poly" ), QStringLiteral( "memory" ) );
+  const QStringList wkts = QStringList()
+                           // horizontal and vertical edges, at the bottom, top and within the polygon
+                           << QStringLiteral( "Polygon((1.5 1.5, 7.5 1.5, 7.5 4.5, 4.5 4.5, 4.5 7.5, 1.5 7.5, 1.5 1.5))" )
+                           // vertices on cell centers, diagonal edges through cell centers
+                           << QStringLiteral( "Polygon((5.5 0.5, 9.5 4.5, 5.5 8.5, 1.5 4.5, 5.5 0.5))" )
+                           // hole with horizontal edges
+                           << QStringLiteral( "Polygon((0.5 0.5, 9.5 0.5, 9.5 9.5, 0.5 9.5, 0.5 0.5),(3.5 3.5, 6.5 3.5, 6.5 6.5, 3.5 6.5, 3.5 3.5))" );
+  QgsFeatureList features;
+  for ( int i = 0; i < wkts.size(); ++i )
+  {
+    QgsFeature f( vectorLayer.fields() );
+    f.setAttributes( QgsAttributes() << i );
+    f.setGeometry( QgsGeometry::fromWkt( wkts.at( i ) ) );
+    features << f;
+  }
+  QVERIFY( vectorLayer.dataProvider()->addFeatures( features ) );
+
+  QgsZonalStatistics zs( &vectorLayer, &rasterLayer, QStringLiteral( "e_" ), 1, QgsZonalStatistics::Count | QgsZonalStatistics::Sum );
+  QCOMPARE( zs.calculateStatistics( nullptr ), 0 );
+
+  // the values of the cells whose center is contained by the polygon, as tested by GEOS
+  std::unique_ptr< QgsRasterBlock > block( rasterLayer.dataProvider()->block( 1, rasterLayer.extent(), 10, 10 ) );
+  QgsFeature f;
+  QgsFeatureIterator it = vectorLayer.getFeatures();
+  while ( it.nextFeature( f ) )
+  {
+    std::unique_ptr< QgsGeometryEngine > engine( QgsGeometry::createGeometryEngine( f.geometry().constGet() ) );
+    engine->prepareGeometry();
+    int count = 0;
+    double sum = 0;
+    for ( int row = 0; row < 10; ++row )
+    {
+      for ( int column = 0; column < 10; ++column )
+      {
+        const QgsPoint center( column + 0.5, 9.5 - row );
+        if ( engine->contains( &center ) )
+        {
+          count++;
+          sum += block->value( row, column );
+        }
+      }
+    }
+    QVERIFY( count > 1 );
+    QCOMPARE( f.attribute( "e_count" ).toDouble(), static_cast< double >( count ) );
+    QCOMPARE( f.attribute( "e_sum" ).toDouble(), sum );
+  }
+}
+
 QGSTEST_MAIN( TestQgsZonalStatistics )
 #include "testqgszonalstatistics.moc"
@@ -1353,6 +1353,295 @@ class TestQgsExpression: public QObject
       QCOMPARE( res2.type(), QVariant::Invalid );
     }
 
+    void bytecode_evaluation_data()
+    {
+      QTest::addColumn<QString>( "string" );
+
+      QTest::newRow( "int arithmetic" ) << "\"i\" + \"j\" * 2 - 1";
+      QTest::newRow( "mixed arithmetic" ) << "\"i\" * \"d\" - \"d\" / 2";
+      QTest::newRow( "division" ) << "\"i\" / \"j\"";
+      QTest::newRow( "modulo" ) << "\"i\" % \"j\"";
+      QTest::newRow( "double modulo" ) << "\"d\" % \"i\"";
+      QTest::newRow( "integer division" ) << "\"d\" // \"j\"";
+      QTest::newRow( "power" ) << "\"i\" ^ 2 + \"d\" ^ \"j\"";
+      QTest::newRow( "unary minus" ) << "-\"i\" + -\"d\"";
+      QTest::newRow( "unary minus string" ) << "-\"s\"";
+      QTest::newRow( "comparison" ) << "\"i\" > \"d\"";
+      QTest::newRow( "equality" ) << "\"i\" = \"j\" OR \"d\" <> 2.5";
+      QTest::newRow( "range" ) << "\"i\" >= 0 AND \"d\" < 10 AND NOT \"j\" <= -1";
+      QTest::newRow( "logic on numbers" ) << "\"i\" AND \"d\" OR NOT \"j\"";
+      QTest::newRow( "is" ) << "\"i\" IS \"j\"";
+      QTest::newRow( "is not null" ) << "\"d\" IS NOT NULL AND \"s\" IS NULL";
+      QTest::newRow( "string comparison" ) << "\"s\" = 'abc'";
+      QTest::newRow( "string ordering" ) << "\"s\" < 'abd' OR \"s\" >= '12'";
+      QTest::newRow( "numeric string comparison" ) << "\"s\" > '9' AND \"s\" <> '12.0'";
+      QTest::newRow( "string is" ) << "\"s\" IS 'abc' OR \"s\" IS NOT ''";
+      QTest::newRow( "string and number comparison" ) << "\"s\" > \"i\"";
+      QTest::newRow( "string plus" ) << "\"s\" + \"s\"";
+      QTest::newRow( "string plus number" ) << "\"s\" + \"i\"";
+      QTest::newRow( "concat" ) << "\"s\" || \"i\" || 'x'";
+      QTest::newRow( "like" ) << "\"s\" LIKE 'a%' AND \"i\" > 0";
+      QTest::newRow( "function" ) << "abs( \"i\" - \"j\" ) < 2";
+      QTest::newRow( "function error" ) << "to_int( \"s\" ) + 1";
+      QTest::newRow( "in" ) << "\"i\" IN (1, 2, 3) OR \"d\" > 3";
+      QTest::newRow( "static" ) << "\"i\" + ( 2 * 3 + 1 )";
+      QTest::newRow( "case" ) << "CASE WHEN \"i\" > \"j\" THEN \"i\" WHEN \"d\" > 1 THEN 'x' || \"s\" END";
+      QTest::newRow( "case else" ) << "CASE WHEN \"s\" THEN 1 WHEN \"d\" THEN 2 ELSE \"i\" * 3 END";
+      QTest::newRow( "unknown column" ) << "\"x\" + 1";
+      QTest::newRow( "in strings" ) << "\"s\" IN ('abc', 'a', 'x')";
+      QTest::newRow( "not in with null" ) << "\"i\" NOT IN (3, NULL, 1.0)";
+      QTest::newRow( "in numeric strings" ) << "\"s\" IN (12, 'abc')";
+      QTest::newRow( "in mixed" ) << "\"i\" IN ('3', 'a', 0)";
+      QTest::newRow( "in non constant" ) << "\"d\" IN (\"i\", 2.5)";
+      QTest::newRow( "ilike" ) << "\"s\" ILIKE 'A_C' OR \"i\" NOT LIKE '%5'";
+      QTest::newRow( "regexp" ) << "\"s\" ~ '^[0-9]+$'";
+      QTest::newRow( "math functions" ) << "sqrt( abs( \"d\" ) ) + floor( \"i\" / 2 ) - ceil( cos( radians( \"j\" ) ) )";
+      QTest::newRow( "logarithms" ) << "ln( \"i\" ) + log10( \"d\" )";
+      QTest::newRow( "math function on string" ) << "exp( \"s\" )";
+    }
+
+    void bytecode_evaluation()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "i" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "j" ), QVariant::LongLong ) );
+      fields.append( QgsField( QStringLiteral( "d" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "s" ), QVariant::String ) );
+
+      QList< QgsAttributes > attributes;
+      attributes << ( QgsAttributes() << 3 << qlonglong( 2 ) << 2.5 << "abc" )
+                 << ( QgsAttributes() << 0 << qlonglong( 0 ) << 0.0 << "" )
+                 << ( QgsAttributes() << -5 << qlonglong( 7 ) << -1.5 << "12" )
+                 << ( QgsAttributes() << 1 << qlonglong( -1 ) << std::numeric_limits< double >::infinity() << "a" )
+                 << ( QgsAttributes() << QVariant() << QVariant( QVariant::LongLong ) << QVariant( QVariant::Double ) << QVariant( QVariant::String ) )
+                 << ( QgsAttributes() << QVariant( QVariant::Int ) << qlonglong( 4 ) << 4.0 << QVariant() );
+
+      QgsFeature f( fields );
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( f, fields );
+
+      // compare the prepared expressions evaluated from bytecode and from the tree
+      QgsExpression::setBytecodeEnabled( false );
+      QgsExpression treeExp( string );
+      treeExp.prepare( &context );
+      QgsExpression::setBytecodeEnabled( true );
+      QgsExpression bytecodeExp( string );
+      bytecodeExp.prepare( &context );
+
+      for ( const QgsAttributes &featureAttributes : qgis::as_const( attributes ) )
+      {
+        f.setAttributes( featureAttributes );
+        context.setFeature( f );
+
+        QVariant expected = treeExp.evaluate( &context );
+        QVariant result = bytecodeExp.evaluate( &context );
+        QCOMPARE( result.type(), expected.type() );
+        QCOMPARE( result.isNull(), expected.isNull() );
+        QCOMPARE( result.toString(), expected.toString() );
+        QCOMPARE( bytecodeExp.hasEvalError(), treeExp.hasEvalError() );
+        QCOMPARE( bytecodeExp.evalErrorString(), treeExp.evalErrorString() );
+      }
+    }
+
+    void bytecode_evaluation_without_feature_data()
+    {
+      bytecode_evaluation_data();
+      QTest::newRow( "is null" ) << "\"i\" IS NULL";
+    }
+
+    void bytecode_evaluation_without_feature()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "i" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "j" ), QVariant::LongLong ) );
+      fields.append( QgsField( QStringLiteral( "d" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "s" ), QVariant::String ) );
+
+      // columns are resolved from the fields of the context, which has no feature
+      QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+      scope->setFields( fields );
+      QgsExpressionContext context;
+      context.appendScope( scope );
+
+      QgsExpression::setBytecodeEnabled( false );
+      QgsExpression treeExp( string );
+      treeExp.prepare( &context );
+      QgsExpression::setBytecodeEnabled( true );
+      QgsExpression bytecodeExp( string );
+      bytecodeExp.prepare( &context );
+
+      QVariant expected = treeExp.evaluate( &context );
+      QVariant result = bytecodeExp.evaluate( &context );
+      QCOMPARE( result.type(), expected.type() );
+      QCOMPARE( result.isNull(), expected.isNull() );
+      QCOMPARE( result.toString(), expected.toString() );
+      QCOMPARE( bytecodeExp.hasEvalError(), treeExp.hasEvalError() );
+      QCOMPARE( bytecodeExp.evalErrorString(), treeExp.evalErrorString() );
+
+      // same without any context
+      expected = treeExp.evaluate();
+      result = bytecodeExp.evaluate();
+      QCOMPARE( result.type(), expected.type() );
+      QCOMPARE( result.isNull(), expected.isNull() );
+      QCOMPARE( result.toString(), expected.toString() );
+      QCOMPARE( bytecodeExp.hasEvalError(), treeExp.hasEvalError() );
+      QCOMPARE( bytecodeExp.evalErrorString(), treeExp.evalErrorString() );
+    }
+
+    void block_evaluation_data()
+    {
+      bytecode_evaluation_data();
+    }
+
+    void block_evaluation()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "i" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "j" ), QVariant::LongLong ) );
+      fields.append( QgsField( QStringLiteral( "d" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "s" ), QVariant::String ) );
+
+      QList< QgsAttributes > attributes;
+      attributes << ( QgsAttributes() << 3 << qlonglong( 2 ) << 2.5 << "abc" )
+                 << ( QgsAttributes() << 0 << qlonglong( 0 ) << 0.0 << "" )
+                 << ( QgsAttributes() << -5 << qlonglong( 7 ) << -1.5 << "12" )
+                 << ( QgsAttributes() << 1 << qlonglong( -1 ) << std::numeric_limits< double >::infinity() << "a" )
+                 << ( QgsAttributes() << QVariant() << QVariant( QVariant::LongLong ) << QVariant( QVariant::Double ) << QVariant( QVariant::String ) )
+                 << ( QgsAttributes() << QVariant( QVariant::Int ) << qlonglong( 4 ) << 4.0 << QVariant() );
+
+      QgsFeatureList features;
+      for ( const QgsAttributes &featureAttributes : qgis::as_const( attributes ) )
+      {
+        QgsFeature f( fields, features.size() );
+        f.setAttributes( featureAttributes );
+        features << f;
+      }
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( features.at( 0 ), fields );
+      QgsExpression exp( string );
+      exp.prepare( &context );
+
+      // compare with features evaluated one by one
+      QVariantList expected;
+      QString expectedError;
+      for ( const QgsFeature &f : qgis::as_const( features ) )
+      {
+        context.setFeature( f );
+        expected << exp.evaluate( &context );
+        if ( expectedError.isNull() )
+          expectedError = exp.evalErrorString();
+      }
+
+      const QVariantList results = exp.evaluateFeatures( features, &context );
+      QCOMPARE( results.size(), expected.size() );
+      for ( int i = 0; i < results.size(); ++i )
+      {
+        QCOMPARE( results.at( i ).type(), expected.at( i ).type() );
+        QCOMPARE( results.at( i ).isNull(), expected.at( i ).isNull() );
+        QCOMPARE( results.at( i ).toString(), expected.at( i ).toString() );
+      }
+      QCOMPARE( exp.evalErrorString(), expectedError );
+
+      const QBitArray selection = exp.filterFeatures( features, &context );
+      QCOMPARE( selection.size(), expected.size() );
+      for ( int i = 0; i < selection.size(); ++i )
+        QCOMPARE( selection.testBit( i ), expected.at( i ).toBool() );
+      QCOMPARE( exp.evalErrorString(), expectedError );
+    }
+
+    void benchmark_evaluation_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "bytecode" );
+
+      const QStringList expressions = QStringList()
+                                      << QStringLiteral( "\"population\" > 10000 AND \"population\" <= 50000" )
+                                      << QStringLiteral( "\"area\" * 2.5 / ( \"population\" + 1 )" )
+                                      << QStringLiteral( "CASE WHEN \"population\" > 40000 THEN 3 WHEN \"population\" > 20000 THEN 2 ELSE 1 END" )
+                                      << QStringLiteral( "\"name\" = 'city 12' OR \"area\" < 10" )
+                                      << QStringLiteral( "sqrt( \"area\" ) * 2 + \"population\" / 1000" )
+                                      << QStringLiteral( "\"name\" LIKE 'city 1%' OR \"population\" IN (61, 122, 183)" );
+      for ( const QString &expression : expressions )
+      {
+        QTest::newRow( QStringLiteral( "%1 (tree)" ).arg( expression ).toUtf8().constData() ) << expression << false;
+        QTest::newRow( QStringLiteral( "%1 (bytecode)" ).arg( expression ).toUtf8().constData() ) << expression << true;
+      }
+    }
+
+    void benchmark_evaluation()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, bytecode );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "population" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "area" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "name" ), QVariant::String ) );
+
+      QList< QgsFeature > features;
+      for ( int i = 0; i < 1000; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttributes( QgsAttributes() << i * 61 << i * 0.75 << QStringLiteral( "city %1" ).arg( i ) );
+        features << f;
+      }
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( features.at( 0 ), fields );
+      QgsExpression::setBytecodeEnabled( bytecode );
+      QgsExpression exp( string );
+      exp.prepare( &context );
+      QgsExpression::setBytecodeEnabled( true );
+
+      QBENCHMARK
+      {
+        for ( const QgsFeature &f : qgis::as_const( features ) )
+        {
+          context.setFeature( f );
+          exp.evaluate( &context );
+        }
+      }
+    }
+
+    void benchmark_block_evaluation_data()
+    {
+      benchmark_evaluation_data();
+    }
+
+    void benchmark_block_evaluation()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, bytecode );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "population" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "area" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "name" ), QVariant::String ) );
+
+      QgsFeatureList features;
+      for ( int i = 0; i < 1000; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttributes( QgsAttributes() << i * 61 << i * 0.75 << QStringLiteral( "city %1" ).arg( i ) );
+        features << f;
+      }
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( features.at( 0 ), fields );
+      QgsExpression::setBytecodeEnabled( bytecode );
+      QgsExpression exp( string );
+      exp.prepare( &context );
+      QgsExpression::setBytecodeEnabled( true );
+
+      QBENCHMARK
+      {
+        exp.evaluateFeatures( features, &context );
+      }
+    }
+
     void eval_feature_id()
     {
       QgsFeature f( 100 );
@@ -19,6 +19,7 @@
 #include <qgslabelingengine.h>
 #include <qgsproject.h>
 #include <qgsmaprenderersequentialjob.h>
+#include <qgsmaprendererparalleljob.h>
 #include <qgsreadwritecontext.h>
 #include <qgsrulebasedlabeling.h>
 #include <qgsvectorlayer.h>
@@ -29,6 +30,8 @@
 #include "qgsfontutils.h"
 #include "qgsnullsymbolrenderer.h"
 
+#include <QThreadPool>
+
 class TestQgsLabelingEngine : public QObject
 {
     Q_OBJECT
@@ -51,6 +54,8 @@ class TestQgsLabelingEngine : public QObject
     void testRegisterFeatureUnprojectible();
     void testRotateHidePartial();
     void testParallelLabelSmallFeature();
+    void testSolveConcurrently();
+    void testExtractLayersConcurrently();
 
   private:
     QgsVectorLayer *vl = nullptr;
@@ -768,5 +773,194 @@ void TestQgsLabelingEngine::testParallelLabelSmallFeature()
   //  QVERIFY( imageCheck( "label_rotate_hide_partial", img, 20 ) );
 }
 
+static QList<QgsLabelPosition> renderLabels( const QList<QgsMapLayer *> &layers, bool solveConcurrently, bool renderInParallel = false )
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setDestinationCrs( layers.at( 0 )->crs() );
+  mapSettings.setOutputSize( QSize( 2000, 1300 ) );
+  mapSettings.setExtent( QgsRectangle( 0, 0, 2000, 1300 ) );
+  mapSettings.setLayers( layers );
+  mapSettings.setOutputDpi( 96 );
+
+  QgsLabelingEngineSettings engineSettings = mapSettings.labelingEngineSettings();
+  engineSettings.setFlag( QgsLabelingEngineSettings::UsePartialCandidates, false );
+  engineSettings.setFlag( QgsLabelingEngineSettings::DrawLabelRectOnly, true );
+  engineSettings.setFlag( QgsLabelingEngineSettings::SolveConcurrently, solveConcurrently );
+  mapSettings.setLabelingEngineSettings( engineSettings );
+
+  std::unique_ptr< QgsMapRendererQImageJob > job;
+  if ( renderInParallel )
+    job.reset( new QgsMapRendererParallelJob( mapSettings ) );
+  else
+    job.reset( new QgsMapRendererSequentialJob( mapSettings ) );
+  job->start();
+  job->waitForFinished();
+
+  std::unique_ptr< QgsLabelingResults > results( job->takeLabelingResults() );
+  return results ? results->labelsWithinRect( mapSettings.extent() ) : QList<QgsLabelPosition>();
+}
+
+static QMap< QString, QgsRectangle > labelRectsByFeature( const QList<QgsLabelPosition> &labels )
+{
+  QMap< QString, QgsRectangle > rects;
+  for ( const QgsLabelPosition &label : labels )
+    rects.insert( QStringLiteral( "%1:%2" ).arg( label.layerID ).arg( label.featureId ), label.labelRect );
+  return rects;
+}
+
+void TestQgsLabelingEngine::testSolveConcurrently()
+{
+  // rows of conflicting labels, far enough from each other to be solved as independent problems
+  QgsPalLayerSettings settings;
+  setDefaultLabelParams( settings );
+  QgsTextFormat format = settings.format();
+  format.setSize( 10 );
+  format.setSizeUnit( QgsUnitTypes::RenderPixels );
+  settings.setFormat( format );
+  settings.fieldName = QStringLiteral( "'label'" );
+  settings.isExpression = true;
+  settings.placement = QgsPalLayerSettings::AroundPoint;
+
+  std::unique_ptr< QgsVectorLayer> vl( new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857&field=id:integer" ), QStringLiteral( "vl" ), QStringLiteral( "memory" ) ) );
+  vl->setRenderer( new QgsNullSymbolRenderer() );
+  QgsFeatureList features;
+  for ( int row = 0; row < 20; ++row )
+  {
+    for ( int column = 0; column < 70; ++column )
+    {
+      QgsFeature f( vl->fields() );
+      f.setAttributes( QgsAttributes() << row * 70 + column );
+      f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 100 + column * 25, 50 + row * 60 ) ) );
+      features << f;
+    }
+  }
+  QVERIFY( vl->dataProvider()->addFeatures( features ) );
+  vl->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+  vl->setLabelsEnabled( true );
+
+  // solving the whole problem is the default, and gives the same result each time
+  const QList<QgsMapLayer *> layers = QList<QgsMapLayer *>() << vl.get();
+  const QMap< QString, QgsRectangle > whole = labelRectsByFeature( renderLabels( layers, false ) );
+  QVERIFY( !whole.isEmpty() );
+  QCOMPARE( labelRectsByFeature( renderLabels( layers, false ) ), whole );
+
+  // solving the rows concurrently labels the same features, without overlapping labels
+  const QList<QgsLabelPosition> concurrentLabels = renderLabels( layers, true );
+  const QMap< QString, QgsRectangle > concurrent = labelRectsByFeature( concurrentLabels );
+  QCOMPARE( concurrent.keys(), whole.keys() );
+  // the placement differs from the whole problem, but not from one run to the next
+  QCOMPARE( labelRectsByFeature( renderLabels( layers, true ) ), concurrent );
+  for ( int i = 0; i < concurrentLabels.count(); ++i )
+  {
+    for ( int j = i + 1; j < concurrentLabels.count(); ++j )
+    {
+      const QgsRectangle overlap = concurrentLabels.at( i ).labelRect.intersect( &concurrentLabels.at( j ).labelRect );
+      QVERIFY2( overlap.isEmpty() || qgsDoubleNear( overlap.area(), 0.0, 0.001 ),
+                QStringLiteral( "Labels of features %1 and %2 overlap" ).arg( concurrentLabels.at( i ).featureId ).arg( concurrentLabels.at( j ).featureId ).toUtf8().constData() );
+    }
+  }
+
+  // the flag is stored in projects
+  QgsProject project;
+  QgsLabelingEngineSettings engineSettings;
+  engineSettings.readSettingsFromProject( &project );
+  QVERIFY( !engineSettings.testFlag( QgsLabelingEngineSettings::SolveConcurrently ) );
+  engineSettings.setFlag( QgsLabelingEngineSettings::SolveConcurrently, true );
+  engineSettings.writeSettingsToProject( &project );
+  QgsLabelingEngineSettings readSettings;
+  readSettings.readSettingsFromProject( &project );
+  QVERIFY( readSettings.testFlag( QgsLabelingEngineSettings::SolveConcurrently ) );
+  engineSettings.setFlag( QgsLabelingEngineSettings::SolveConcurrently, false );
+  engineSettings.writeSettingsToProject( &project );
+  readSettings.readSettingsFromProject( &project );
+  QVERIFY( !readSettings.testFlag( QgsLabelingEngineSettings::SolveConcurrently ) );
+}
+
+void TestQgsLabelingEngine::testExtractLayersConcurrently()
+{
+  // candidates of the layers are generated concurrently, the labels must not depend on how the layers were scheduled
+  QgsPalLayerSettings settings;
+  setDefaultLabelParams( settings );
+  QgsTextFormat format = settings.format();
+  format.setSize( 10 );
+  format.setSizeUnit( QgsUnitTypes::RenderPixels );
+  settings.setFormat( format );
+  settings.fieldName = QStringLiteral( "'label ' || \"id\"" );
+  settings.isExpression = true;
+
+  std::vector< std::unique_ptr< QgsVectorLayer > > layers;
+  QList<QgsMapLayer *> mapLayers;
+  for ( int i = 0; i < 6; ++i )
+  {
+    const QString type = i % 3 == 0 ? QStringLiteral( "Point" ) : ( i % 3 == 1 ? QStringLiteral( "LineString" ) : QStringLiteral( "Polygon" ) );
+    std::unique_ptr< QgsVectorLayer > vl( new QgsVectorLayer( type + QStringLiteral( "?crs=epsg:3857&field=id:integer" ), QStringLiteral( "vl%1" ).arg( i ), QStringLiteral( "memory" ) ) );
+    vl->setRenderer( new QgsNullSymbolRenderer() );
+
+    QgsFeatureList features;
+    for ( int j = 0; j < 150; ++j )
+    {
+      // spread the features of all layers over the same area, so that they conflict with each other
+      const double x = 50 + ( j * 37 + i * 101 ) % 1900;
+      const double y = 50 + ( j * 53 + i * 71 ) % 1200;
+      QgsGeometry geometry;
+      if ( i % 3 == 0 )
+        geometry = QgsGeometry::fromPointXY( QgsPointXY( x, y ) );
+      else if ( i % 3 == 1 )
+        geometry = QgsGeometry::fromWkt( QStringLiteral( "LineString(%1 %2, %3 %4, %5 %6)" ).arg( x ).arg( y ).arg( x + 60 ).arg( y + 10 ).arg( x + 120 ).arg( y - 20 ) );
+      else
+        geometry = QgsGeometry::fromWkt( QStringLiteral( "Polygon((%1 %2, %3 %2, %3 %4, %1 %4, %1 %2),(%5 %6, %7 %6, %7 %8, %5 %8, %5 %6))" )
+                                         .arg( x ).arg( y ).arg( x + 80 ).arg( y + 50 ).arg( x + 20 ).arg( y + 10 ).arg( x + 60 ).arg( y + 40 ) );
+
+      QgsFeature f( vl->fields() );
+      f.setAttributes( QgsAttributes() << j );
+      f.setGeometry( geometry );
+      features << f;
+    }
+    QVERIFY( vl->dataProvider()->addFeatures( features ) );
+
+    settings.placement = i % 3 == 0 ? QgsPalLayerSettings::AroundPoint : ( i % 3 == 1 ? QgsPalLayerSettings::Line : QgsPalLayerSettings::Horizontal );
+    settings.obstacle = true;
+    vl->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+    vl->setLabelsEnabled( true );
+
+    mapLayers << vl.get();
+    layers.push_back( std::move( vl ) );
+  }
+
+  const QMap< QString, QgsRectangle > labels = labelRectsByFeature( renderLabels( mapLayers, false ) );
+  QVERIFY( !labels.isEmpty() );
+
+  // a single thread of the pool takes part in the extraction
+  QThreadPool *pool = QThreadPool::globalInstance();
+  const int maxThreadCount = pool->maxThreadCount();
+  pool->setMaxThreadCount( 1 );
+  const QMap< QString, QgsRectangle > singleThreadLabels = labelRectsByFeature( renderLabels( mapLayers, false ) );
+  pool->setMaxThreadCount( maxThreadCount );
+
+  QCOMPARE( singleThreadLabels, labels );
+  QCOMPARE( labelRectsByFeature( renderLabels( mapLayers, false ) ), labels );
+
+  // candidates are generated as soon as each layer is rendered, while layers are rendered concurrently
+  QCOMPARE( labelRectsByFeature( renderLabels( mapLayers, false, true ) ), labels );
+  pool->setMaxThreadCount( 1 );
+  const QMap< QString, QgsRectangle > singleThreadParallelLabels = labelRectsByFeature( renderLabels( mapLayers, false, true ) );
+  pool->setMaxThreadCount( maxThreadCount );
+  QCOMPARE( singleThreadParallelLabels, labels );
+
+  // candidates of the layers of a canceled rendering are generated in the background, and dropped
+  for ( int i = 0; i < 5; ++i )
+  {
+    QgsMapSettings mapSettings;
+    mapSettings.setDestinationCrs( mapLayers.at( 0 )->crs() );
+    mapSettings.setOutputSize( QSize( 2000, 1300 ) );
+    mapSettings.setExtent( QgsRectangle( 0, 0, 2000, 1300 ) );
+    mapSettings.setLayers( mapLayers );
+    QgsMapRendererParallelJob job( mapSettings );
+    job.start();
+    QTest::qSleep( i * 20 );
+    job.cancel();
+  }
+}
+
 QGSTEST_MAIN( TestQgsLabelingEngine )
 #include "testqgslabelingengine.moc"
@@ -0,0 +1,114 @@
+/***************************************************************************
+  testqgspackedspatialindex.cpp
+  --------------------------------------
+  Date                 : April 2018
+  Copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include <QObject>
+#include <QString>
+
+#include "qgsapplication.h"
+#include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
+#include "qgspackedspatialindex.h"
+#include "qgsspatialindex.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+#include <algorithm>
+#include <memory>
+
+class TestQgsPackedSpatialIndex : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+
+    void initTestCase()
+    {
+      QgsApplication::init();
+      QgsApplication::initQgis();
+    }
+    void cleanupTestCase()
+    {
+      QgsApplication::exitQgis();
+    }
+
+    void testEmpty()
+    {
+      QgsPackedSpatialIndex index;
+      QVERIFY( index.isEmpty() );
+      QCOMPARE( index.count(), 0 );
+      QVERIFY( index.extent().isNull() );
+      QVERIFY( index.intersects( QgsRectangle( -10, -10, 10, 10 ) ).isEmpty() );
+    }
+
+    void testSingle()
+    {
+      QgsPackedSpatialIndex index( QList< QgsFeatureId >() << 5, QList< QgsRectangle >() << QgsRectangle( 1, 2, 3, 4 ) );
+      QCOMPARE( index.count(), 1 );
+      QCOMPARE( index.extent(), QgsRectangle( 1, 2, 3, 4 ) );
+      QCOMPARE( index.intersects( QgsRectangle( 0, 0, 1, 2 ) ), QList< QgsFeatureId >() << 5 );
+      QVERIFY( index.intersects( QgsRectangle( 0, 0, 0.5, 0.5 ) ).isEmpty() );
+    }
+
+    void testQuery()
+    {
+      // grid of polygons, with a few features without geometry
+      std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "Polygon" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsFeatureList features;
+      for ( int i = 0; i < 10000; ++i )
+      {
+        QgsFeature f;
+        if ( i % 100 != 0 )
+        {
+          const double x = i % 100;
+          const double y = i / 100;
+          f.setGeometry( QgsGeometry::fromRect( QgsRectangle( x, y, x + 0.5 + ( i % 3 ), y + 0.5 ) ) );
+        }
+        features << f;
+      }
+      QVERIFY( vl->dataProvider()->addFeatures( features ) );
+
+      QgsPackedSpatialIndex index( *vl->dataProvider() );
+      QCOMPARE( index.count(), 9900 );
+      QCOMPARE( index.extent(), QgsRectangle( 1, 0, 101.5, 99.5 ) );
+
+      QgsSpatialIndex reference( *vl->dataProvider() );
+      const QList< QgsRectangle > queries = QList< QgsRectangle >()
+                                            << QgsRectangle( -10, -10, 200, 200 )
+                                            << QgsRectangle( 10.2, 20.2, 10.3, 20.3 )
+                                            << QgsRectangle( 15, 15, 40, 22 )
+                                            << QgsRectangle( 0, 0, 1, 1 )
+                                            << QgsRectangle( 150, 150, 160, 160 );
+      for ( const QgsRectangle &rect : queries )
+      {
+        QList< QgsFeatureId > ids = index.intersects( rect );
+        QList< QgsFeatureId > expected = reference.intersects( rect );
+        std::sort( ids.begin(), ids.end() );
+        std::sort( expected.begin(), expected.end() );
+        QCOMPARE( ids, expected );
+      }
+
+      // results are appended to the buffer
+      QVector< QgsFeatureId > buffer;
+      buffer << -1;
+      QCOMPARE( index.intersects( QgsRectangle( 10.2, 20.2, 10.3, 20.3 ), buffer ), 1 );
+      QCOMPARE( buffer.size(), 2 );
+      QCOMPARE( buffer.at( 0 ), QgsFeatureId( -1 ) );
+      QCOMPARE( index.intersects( QgsRectangle( 150, 150, 160, 160 ), buffer ), 0 );
+      QCOMPARE( buffer.size(), 2 );
+    }
+};
+
+QGSTEST_MAIN( TestQgsPackedSpatialIndex )
+#include "testqgspackedspatialindex.moc"
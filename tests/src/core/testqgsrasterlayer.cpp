@@ -22,6 +22,9 @@
 #include <QPainter>
 #include <QTime>
 #include <QDesktopServices>
+#include <QThreadPool>
+#include <QFile>
+#include <QTextStream>
 
 #include "cpl_conv.h"
 #include "gdal.h"
@@ -39,7 +42,13 @@
 #include <qgscolorramp.h>
 #include <qgscptcityarchive.h>
 #include "qgscolorrampshader.h"
+#include "qgsrasterblock.h"
 #include "qgsrasterdataprovider.h"
+#include "qgshillshaderenderer.h"
+#include "qgsrasterdrawer.h"
+#include "qgsrasteriterator.h"
+#include "qgsrasterprojector.h"
+#include "qgsrasterviewport.h"
 #include "qgsrastershader.h"
 #include "qgsrastertransparency.h"
 
@@ -85,6 +94,10 @@ class TestQgsRasterLayer : public QObject
     void setRenderer();
     void regression992(); //test for issue #992 - GeoJP2 images improperly displayed as all black
     void testRefreshRendererIfNeeded();
+    void shadeBlock();
+    void enhanceContrastBlock();
+    void parallelDraw();
+    void projectorGrid();
 
 
   private:
@@ -720,5 +733,261 @@ void TestQgsRasterLayer::testRefreshRendererIfNeeded()
   QGSCOMPARENOTNEAR( initMinVal, newMinVal, 1e-5 );
 }
 
+void TestQgsRasterLayer::shadeBlock()
+{
+  // shading a block must give the same colors as shading each value
+  QList<QgsColorRampShader::ColorRampItem> items;
+  items << QgsColorRampShader::ColorRampItem( -10, QColor( 255, 0, 0 ) )
+        << QgsColorRampShader::ColorRampItem( 5, QColor( 0, 255, 0, 128 ) )
+        << QgsColorRampShader::ColorRampItem( 20, QColor( 0, 0, 255 ) )
+        << QgsColorRampShader::ColorRampItem( 100, QColor( 255, 255, 0, 50 ) );
+
+  // large enough to use the colors of all values for 16 bit blocks
+  const int size = 300;
+  const int count = size * size;
+  const QList< Qgis::DataType > dataTypes = QList< Qgis::DataType >() << Qgis::Byte << Qgis::UInt16 << Qgis::Int16
+      << Qgis::Int32 << Qgis::Float32 << Qgis::Float64;
+  for ( Qgis::DataType dataType : dataTypes )
+  {
+    QgsRasterBlock block( dataType, size, size );
+    const bool isSigned = dataType != Qgis::Byte && dataType != Qgis::UInt16;
+    const bool isFloat = dataType == Qgis::Float32 || dataType == Qgis::Float64;
+    for ( int i = 0; i < count; ++i )
+    {
+      block.setValue( i, ( isSigned ? -20.0 : 0.0 ) + i % 140 + ( isFloat ? 0.25 * ( i % 4 ) : 0.0 ) );
+    }
+    block.setNoDataValue( 7 );
+
+    const QList< QgsColorRampShader::Type > types = QList< QgsColorRampShader::Type >() << QgsColorRampShader::Interpolated
+        << QgsColorRampShader::Discrete << QgsColorRampShader::Exact;
+    for ( QgsColorRampShader::Type type : types )
+    {
+      for ( bool clip : { false, true } )
+      {
+        QgsColorRampShader shader;
+        shader.setColorRampItemList( items );
+        shader.setColorRampType( type );
+        shader.setClip( clip );
+
+        QVector< QRgb > colors( count );
+        shader.shadeBlock( &block, 0, count, colors.data() );
+        // a small span, which does not use the colors of all values
+        QVector< QRgb > spanColors( 100 );
+        shader.shadeBlock( &block, 1000, 100, spanColors.data() );
+
+        for ( int i = 0; i < count; ++i )
+        {
+          QRgb expected = qRgba( 0, 0, 0, 0 );
+          int red, green, blue, alpha;
+          if ( !block.isNoData( i ) && shader.shade( block.value( i ), &red, &green, &blue, &alpha ) )
+          {
+            if ( alpha < 255 )
+            {
+              red *= ( alpha / 255.0 );
+              green *= ( alpha / 255.0 );
+              blue *= ( alpha / 255.0 );
+            }
+            expected = qRgba( red, green, blue, alpha );
+          }
+          QCOMPARE( colors.at( i ), expected );
+          if ( i >= 1000 && i < 1100 )
+            QCOMPARE( spanColors.at( i - 1000 ), expected );
+        }
+      }
+    }
+  }
+}
+
+void TestQgsRasterLayer::enhanceContrastBlock()
+{
+  // enhancing a block must give the same values as enhancing each value
+  const int size = 300;
+  const int count = size * size;
+  const QList< Qgis::DataType > dataTypes = QList< Qgis::DataType >() << Qgis::Byte << Qgis::UInt16 << Qgis::Int16 << Qgis::Float32;
+  for ( Qgis::DataType dataType : dataTypes )
+  {
+    QgsRasterBlock block( dataType, size, size );
+    for ( int i = 0; i < count; ++i )
+    {
+      block.setValue( i, i % 250 );
+    }
+    block.setNoDataValue( 7 );
+
+    const QList< QgsContrastEnhancement::ContrastEnhancementAlgorithm > algorithms = QList< QgsContrastEnhancement::ContrastEnhancementAlgorithm >()
+        << QgsContrastEnhancement::NoEnhancement << QgsContrastEnhancement::StretchToMinimumMaximum
+        << QgsContrastEnhancement::StretchAndClipToMinimumMaximum << QgsContrastEnhancement::ClipToMinimumMaximum;
+    for ( QgsContrastEnhancement::ContrastEnhancementAlgorithm algorithm : algorithms )
+    {
+      QgsContrastEnhancement enhancement( dataType );
+      enhancement.setContrastEnhancementAlgorithm( algorithm, false );
+      enhancement.setMinimumValue( 20, false );
+      enhancement.setMaximumValue( 200 );
+
+      QVector< int > values( count );
+      enhancement.enhanceContrastBlock( &block, 0, count, values.data() );
+      QVector< int > spanValues( 100 );
+      enhancement.enhanceContrastBlock( &block, 1000, 100, spanValues.data() );
+
+      for ( int i = 0; i < count; ++i )
+      {
+        const double value = block.value( i );
+        const int expected = block.isNoData( i ) || !enhancement.isValueInDisplayableRange( value ) ? -1 : enhancement.enhanceContrast( value );
+        QCOMPARE( values.at( i ), expected );
+        if ( i >= 1000 && i < 1100 )
+          QCOMPARE( spanValues.at( i - 1000 ), expected );
+      }
+    }
+  }
+}
+
+void TestQgsRasterLayer::parallelDraw()
+{
+  // parts rendered on several threads must be drawn like parts rendered one after the other
+  const int size = 1024;
+  QgsRasterViewPort viewPort;
+  viewPort.mTopLeftPoint = QgsPointXY( 0, 0 );
+  viewPort.mBottomRightPoint = QgsPointXY( size, size );
+  viewPort.mWidth = size;
+  viewPort.mHeight = size;
+  viewPort.mDrawnExtent = mpLandsatRasterLayer->extent();
+  QgsMapToPixel mapToPixel;
+
+  auto draw = [&]( int threadCount )
+  {
+    QThreadPool::globalInstance()->setMaxThreadCount( threadCount );
+    QImage image( size, size, QImage::Format_ARGB32_Premultiplied );
+    image.fill( 0 );
+    QPainter painter( &image );
+    QgsRasterIterator iterator( mpLandsatRasterLayer->pipe()->last() );
+    iterator.setMaximumTileHeight( 256 );
+    QgsRasterDrawer drawer( &iterator );
+    drawer.draw( &painter, &viewPort, &mapToPixel );
+    painter.end();
+    return image;
+  };
+
+  // local files are read in parallel
+  QVERIFY( mpLandsatRasterLayer->dataProvider()->capabilities() & QgsRasterInterface::ParallelReads );
+
+  const int maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+  const QImage sequentialImage = draw( 1 );
+  const QImage parallelImage = draw( 4 );
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreadCount );
+
+  QVERIFY( !sequentialImage.isNull() );
+  QCOMPARE( parallelImage, sequentialImage );
+
+  // hillshades use the neighbours of each pixel, strips rendered in parallel must not show seams
+  // compared to the viewport rendered as a single block. The viewport zooms in 4 times on the
+  // raster, so that the strips sample the same source pixels as the single block
+  const int hillshadeSize = 800;
+  viewPort.mBottomRightPoint = QgsPointXY( hillshadeSize, hillshadeSize );
+  viewPort.mWidth = hillshadeSize;
+  viewPort.mHeight = hillshadeSize;
+  QgsHillshadeRenderer hillshade( mpLandsatRasterLayer->dataProvider(), 1, 315, 45 );
+  auto drawHillshade = [&]( int threadCount )
+  {
+    QThreadPool::globalInstance()->setMaxThreadCount( threadCount );
+    QImage image( hillshadeSize, hillshadeSize, QImage::Format_ARGB32_Premultiplied );
+    image.fill( 0 );
+    QPainter painter( &image );
+    QgsRasterIterator iterator( &hillshade );
+    QgsRasterDrawer drawer( &iterator );
+    drawer.draw( &painter, &viewPort, &mapToPixel );
+    painter.end();
+    return image;
+  };
+
+  const QImage singleBlockImage = drawHillshade( 1 );
+  const QImage parallelHillshadeImage = drawHillshade( 4 );
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreadCount );
+
+  QVERIFY( !singleBlockImage.isNull() );
+  QCOMPARE( parallelHillshadeImage, singleBlockImage );
+}
+
+void TestQgsRasterLayer::projectorGrid()
+{
+  // 100x100 raster of 0.1 degree cells, whose values are row * 100 + column, so that the source
+  // cell projected to each destination cell can be checked independently of the projection grids
+  const QString rasterPath = QDir::tempPath() + "/projector_grid.asc";
+  QFile rasterFile( rasterPath );
+  QVERIFY( rasterFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+  QTextStream stream( &rasterFile );
+  stream << "ncols 100\nnrows 100\nxllcorner 10\nyllcorner 40\ncellsize 0.1\nNODATA_value -9999\n";
+  for ( int row = 0; row < 100; ++row )
+  {
+    for ( int column = 0; column < 100; ++column )
+      stream << row * 100 + column << ' ';
+    stream << '\n';
+  }
+  rasterFile.close();
+  QgsRasterLayer layer( rasterPath, QStringLiteral( "grid" ), QStringLiteral( "gdal" ) );
+  QVERIFY( layer.isValid() );
+
+  const QgsCoordinateReferenceSystem srcCrs( QStringLiteral( "EPSG:4326" ) );
+  const QgsCoordinateReferenceSystem destCrs( QStringLiteral( "EPSG:3857" ) );
+  const QgsCoordinateTransform ct( srcCrs, destCrs );
+  // destination cells are smaller than the source cells, so that blocks are read at the source resolution
+  const int width = 300;
+  const int height = 200;
+
+  auto readBlock = [&]( QgsRasterProjector & projector, const QgsRectangle & extent, int bandNo )
+  {
+    return std::unique_ptr< QgsRasterBlock >( projector.block( bandNo, extent, width, height ) );
+  };
+
+  QgsRasterProjector projector;
+  projector.setInput( layer.dataProvider() );
+  projector.setCrs( srcCrs, destCrs );
+
+  // each precision projects a distinct extent, so that its first block is computed with a new grid
+  QList< QPair< QgsRasterProjector::Precision, QgsRectangle > > cases;
+  cases << qMakePair( QgsRasterProjector::Approximate, QgsRectangle( 12, 42, 17, 47 ) )
+        << qMakePair( QgsRasterProjector::Exact, QgsRectangle( 13.05, 42.55, 18.05, 47.55 ) );
+  for ( const auto &precisionCase : qgis::as_const( cases ) )
+  {
+    projector.setPrecision( precisionCase.first );
+    const QgsRectangle extent = ct.transformBoundingBox( precisionCase.second );
+    std::unique_ptr< QgsRasterBlock > block = readBlock( projector, extent, 1 );
+    QVERIFY( block && !block->isEmpty() );
+
+    // the value of each destination cell must be the one of the source cell containing its center,
+    // or of a neighbouring cell for the approximate grid
+    const double xRes = extent.width() / width;
+    const double yRes = extent.height() / height;
+    int mismatches = 0;
+    for ( int row = 0; row < height; ++row )
+    {
+      for ( int column = 0; column < width; ++column )
+      {
+        const QgsPointXY center = ct.transform( QgsPointXY( extent.xMinimum() + ( column + 0.5 ) * xRes, extent.yMaximum() - ( row + 0.5 ) * yRes ),
+                                                QgsCoordinateTransform::ReverseTransform );
+        const int srcRow = static_cast< int >( std::floor( ( 50 - center.y() ) / 0.1 ) );
+        const int srcColumn = static_cast< int >( std::floor( ( center.x() - 10 ) / 0.1 ) );
+        QVERIFY( !block->isNoData( row, column ) );
+        const int value = static_cast< int >( block->value( row, column ) );
+        const int rowDistance = std::abs( value / 100 - srcRow );
+        const int columnDistance = std::abs( value % 100 - srcColumn );
+        QVERIFY2( rowDistance <= 1 && columnDistance <= 1,
+                  QStringLiteral( "Cell %1,%2 has the value of source cell %3,%4 instead of %5,%6" ).arg( row ).arg( column )
+                  .arg( value / 100 ).arg( value % 100 ).arg( srcRow ).arg( srcColumn ).toUtf8().constData() );
+        if ( rowDistance || columnDistance )
+          mismatches++;
+      }
+    }
+    // centers rounded differently than by the test transform lie on the borders of source cells
+    if ( precisionCase.first == QgsRasterProjector::Exact )
+      QVERIFY( mismatches * 1000 <= width * height );
+
+    // blocks read with the cached grid, which is shared by the clones of the projector, are the same
+    std::unique_ptr< QgsRasterProjector > clone( projector.clone() );
+    std::unique_ptr< QgsRasterInterface > provider( layer.dataProvider()->clone() );
+    clone->setInput( provider.get() );
+    QCOMPARE( readBlock( *clone, extent, 1 )->data(), block->data() );
+    QCOMPARE( readBlock( projector, extent, 1 )->data(), block->data() );
+  }
+}
+
 QGSTEST_MAIN( TestQgsRasterLayer )
 #include "testqgsrasterlayer.moc"
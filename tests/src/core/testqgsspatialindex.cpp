@@ -16,6 +16,9 @@
 #include "qgstest.h"
 #include <QObject>
 #include <QString>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QTemporaryDir>
 
 #include <qgsapplication.h>
 #include "qgsfeatureiterator.h"
@@ -136,6 +139,60 @@ class TestQgsSpatialIndex : public QObject
       QVERIFY( fids[0] == 1 );
     }
 
+    void testSaveLoad()
+    {
+      QTemporaryDir dir;
+      QVERIFY( dir.isValid() );
+      const QString path = dir.filePath( QStringLiteral( "points" ) );
+      const QDateTime timestamp( QDate( 2018, 4, 1 ), QTime( 12, 0 ) );
+
+      QgsVectorLayer *vl = new QgsVectorLayer( QStringLiteral( "Point" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      vl->dataProvider()->addFeatures( _pointFeatures() );
+
+      // bulk load into files
+      {
+        QgsSpatialIndex index( vl->getFeatures(), path, timestamp, 4 );
+        QList<QgsFeatureId> fids = index.intersects( QgsRectangle( 0, 0, 10, 10 ) );
+        QCOMPARE( fids.count(), 1 );
+      }
+      QVERIFY( QFileInfo::exists( path + QStringLiteral( ".idx" ) ) );
+      QVERIFY( QFileInfo::exists( path + QStringLiteral( ".dat" ) ) );
+      delete vl;
+
+      // stale or missing files are not loaded
+      QgsSpatialIndex index;
+      QVERIFY( !index.load( path, timestamp, 5 ) );
+      QVERIFY( !index.load( path, timestamp.addSecs( 1 ), 4 ) );
+      QVERIFY( !index.load( dir.filePath( QStringLiteral( "missing" ) ), timestamp, 4 ) );
+      QVERIFY( index.intersects( QgsRectangle( -10, -10, 10, 10 ) ).isEmpty() );
+
+      QVERIFY( index.load( path, timestamp, 4 ) );
+      QList<QgsFeatureId> fids = index.intersects( QgsRectangle( -10, -10, 0, 10 ) );
+      QCOMPARE( fids.count(), 2 );
+      QVERIFY( fids.contains( 2 ) );
+      QVERIFY( fids.contains( 3 ) );
+      QCOMPARE( index.nearestNeighbor( QgsPointXY( 2, -2 ), 1 ), QList<QgsFeatureId>() << 4 );
+
+      // save a copy of an index built in memory
+      QgsSpatialIndex memoryIndex;
+      memoryIndex.insertFeature( 1, QgsRectangle( 2, 3, 2, 3 ) );
+      memoryIndex.insertFeature( 2, QgsRectangle( 12, 13, 12, 13 ) );
+      const QString path2 = dir.filePath( QStringLiteral( "manual" ) );
+      QVERIFY( memoryIndex.save( path2, QDateTime(), 2 ) );
+
+      QgsSpatialIndex index2;
+      QVERIFY( index2.load( path2, QDateTime(), 2 ) );
+      QCOMPARE( index2.intersects( QgsRectangle( 1, 2, 3, 4 ) ), QList<QgsFeatureId>() << 1 );
+
+      // changes are written to the files, which become stale
+      QVERIFY( index2.insertFeature( 3, QgsRectangle( 1, 2, 1, 2 ) ) );
+      QCOMPARE( index2.intersects( QgsRectangle( 1, 2, 3, 4 ) ).count(), 2 );
+      index2 = QgsSpatialIndex();
+      QgsSpatialIndex index3;
+      QVERIFY( !index3.load( path2, QDateTime(), 2 ) );
+      QVERIFY( !index3.load( path2, QDateTime(), 3 ) );
+    }
+
     void benchmarkIntersect()
     {
       // add 50K features to the index
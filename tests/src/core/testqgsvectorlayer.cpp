@@ -28,6 +28,7 @@
 #include <qgsvectorlayer.h>
 #include <qgsvectorlayerutils.h>
 #include "qgsfeatureiterator.h"
+#include "qgsfeedback.h"
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 #include <qgsproject.h>
@@ -99,6 +100,7 @@ class TestQgsVectorLayer : public QObject
     void maximumValue();
     void isSpatial();
     void testAddTopologicalPoints();
+    void prefetchFeatures();
 };
 
 void TestQgsVectorLayer::initTestCase()
@@ -332,6 +334,80 @@ void TestQgsVectorLayer::isSpatial()
   QVERIFY( !mpNonSpatialLayer->isSpatial() );
 }
 
+void TestQgsVectorLayer::prefetchFeatures()
+{
+  std::unique_ptr< QgsVectorLayer > layer = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "Point?field=col1:integer" ), QStringLiteral( "layer" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer->isValid() );
+
+  // more features than the prefetch queue can hold
+  QgsFeatureList features;
+  for ( int i = 0; i < 5000; ++i )
+  {
+    QgsFeature f( layer->fields() );
+    f.setAttribute( 0, i );
+    f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( i, i ) ) );
+    features << f;
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  // collects the values of at most max features, or all features if max is -1
+  auto collect = []( QgsFeatureIterator & it, int max )
+  {
+    QList< int > values;
+    QgsFeature f;
+    while ( ( max < 0 || values.size() < max ) && it.nextFeature( f ) )
+      values << f.attribute( 0 ).toInt();
+    return values;
+  };
+
+  const QgsFeatureRequest request = QgsFeatureRequest().setFilterExpression( QStringLiteral( "col1 % 3 <> 1" ) );
+  QgsFeatureIterator it = layer->getFeatures( request );
+  const QList< int > expected = collect( it, -1 );
+  QCOMPARE( expected.size(), 3333 );
+
+  QgsFeatureRequest prefetchRequest = request;
+  prefetchRequest.setFlags( QgsFeatureRequest::PrefetchFeatures );
+  it = layer->getFeatures( prefetchRequest );
+  QVERIFY( it.isValid() );
+  QCOMPARE( collect( it, -1 ), expected );
+  QVERIFY( it.isClosed() );
+
+  // rewind in the middle of the iteration
+  it = layer->getFeatures( prefetchRequest );
+  QCOMPARE( collect( it, 1000 ), expected.mid( 0, 1000 ) );
+  QVERIFY( it.rewind() );
+  QCOMPARE( collect( it, -1 ), expected );
+
+  // limit
+  it = layer->getFeatures( QgsFeatureRequest( prefetchRequest ).setLimit( 700 ) );
+  QCOMPARE( collect( it, -1 ), expected.mid( 0, 700 ) );
+
+  // close while the background thread is fetching
+  it = layer->getFeatures( prefetchRequest );
+  QCOMPARE( collect( it, 10 ), expected.mid( 0, 10 ) );
+  QVERIFY( it.close() );
+  QgsFeature f;
+  QVERIFY( !it.nextFeature( f ) );
+
+  // a canceled request stops at the end of the current batch, without waiting for the next one
+  QgsFeedback feedback;
+  it = layer->getFeatures( prefetchRequest );
+  it.setInterruptionChecker( &feedback );
+  QCOMPARE( collect( it, 10 ), expected.mid( 0, 10 ) );
+  feedback.cancel();
+  QVERIFY( collect( it, -1 ).size() < 512 );
+
+  // features of the edit buffer are still returned
+  QVERIFY( layer->startEditing() );
+  QgsFeature added( layer->fields() );
+  added.setAttribute( 0, 5000 );
+  added.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 5000, 5000 ) ) );
+  QVERIFY( layer->addFeature( added ) );
+  it = layer->getFeatures( prefetchRequest );
+  QCOMPARE( collect( it, -1 ).size(), expected.size() + 1 );
+  layer->rollBack();
+}
+
 void TestQgsVectorLayer::testAddTopologicalPoints()
 {
   // create a simple linestring layer
@@ -22,12 +22,15 @@
 #include <QApplication>
 #include <QFileInfo>
 #include <QDir>
+#include <QRunnable>
+#include <QThreadPool>
 
 //qgis includes...
 #include <qgis.h>
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 #include <qgsrasterdataprovider.h>
+#include <qgsrasterblock.h>
 #include <qgsrectangle.h>
 
 /**
@@ -50,6 +53,7 @@ class TestQgsGdalProvider : public QObject
     void invalidNoDataInSourceIgnored();
     void isRepresentableValue();
     void mask();
+    void concurrentReads();
 
   private:
     QString mTestDataDir;
@@ -221,5 +225,60 @@ void TestQgsGdalProvider::mask()
   delete provider;
 }
 
+void TestQgsGdalProvider::concurrentReads()
+{
+  QString raster = QStringLiteral( TEST_DATA_DIR ) + "/landsat.tif";
+  std::unique_ptr< QgsRasterDataProvider > rp( dynamic_cast< QgsRasterDataProvider * >( QgsProviderRegistry::instance()->createProvider( QStringLiteral( "gdal" ), raster ) ) );
+  QVERIFY( rp );
+  QVERIFY( rp->isValid() );
+  std::unique_ptr< QgsRasterDataProvider > clone( rp->clone() );
+
+  const QgsRectangle extent = rp->extent();
+  const int width = 300;
+  const int height = 300;
+  std::unique_ptr< QgsRasterBlock > expected( rp->block( 1, extent, width, height ) );
+  QVERIFY( expected && !expected->isEmpty() );
+
+  // reads of the same provider and of its clone from several threads at once must not interfere
+  class ReadTask : public QRunnable
+  {
+    public:
+      ReadTask( QgsRasterDataProvider *provider, const QgsRectangle &extent, int width, int height, QByteArray &result )
+        : mProvider( provider )
+        , mExtent( extent )
+        , mWidth( width )
+        , mHeight( height )
+        , mResult( result )
+      {}
+
+      void run() override
+      {
+        std::unique_ptr< QgsRasterBlock > block( mProvider->block( 1, mExtent, mWidth, mHeight ) );
+        mResult = block->data();
+      }
+
+    private:
+      QgsRasterDataProvider *mProvider = nullptr;
+      QgsRectangle mExtent;
+      int mWidth;
+      int mHeight;
+      QByteArray &mResult;
+  };
+
+  QThreadPool pool;
+  pool.setMaxThreadCount( 4 );
+  QVector< QByteArray > results( 16 );
+  for ( int i = 0; i < results.size(); ++i )
+  {
+    pool.start( new ReadTask( i % 2 ? clone.get() : rp.get(), extent, width, height, results[i] ) );
+  }
+  pool.waitForDone();
+
+  for ( const QByteArray &result : qgis::as_const( results ) )
+  {
+    QCOMPARE( result, expected->data() );
+  }
+}
+
 QGSTEST_MAIN( TestQgsGdalProvider )
 #include "testqgsgdalprovider.moc"
@@ -0,0 +1,129 @@
+/***************************************************************************
+    testqgstilecache.cpp
+    ---------------------
+    begin                : April 2018
+    copyright            : (C) 2018 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QImage>
+#include <QObject>
+#include <QSignalSpy>
+#include <QUrl>
+#include "qgstest.h"
+#include <qgstilecache.h>
+#include <qgsapplication.h>
+
+/**
+ * \ingroup UnitTests
+ * This is a unit test for the tile cache of the WMS provider.
+ */
+class TestQgsTileCache: public QObject
+{
+    Q_OBJECT
+  private slots:
+
+    void initTestCase()
+    {
+      // init QGIS's paths - true means that all path will be inited from prefix
+      QgsApplication::init();
+      QgsApplication::initQgis();
+    }
+
+    //runs after all tests
+    void cleanupTestCase()
+    {
+      QgsApplication::exitQgis();
+    }
+
+    void init()
+    {
+      QgsTileCache::resetStatistics();
+    }
+
+    void insertAndLookUp()
+    {
+      QImage image( 16, 16, QImage::Format_ARGB32 );
+      image.fill( Qt::red );
+
+      const QUrl url( QStringLiteral( "http://localhost/tiles/insertAndLookUp/1/2/3.png" ) );
+      QgsTileCache::insertTile( url, image );
+
+      QImage cached;
+      QVERIFY( QgsTileCache::tile( url, cached ) );
+      QCOMPARE( cached, image );
+
+      // tile neither in the memory cache nor in the disk cache
+      QVERIFY( !QgsTileCache::tile( QUrl( QStringLiteral( "http://localhost/tiles/insertAndLookUp/1/2/4.png" ) ), cached ) );
+
+      const QgsTileCache::Statistics stats = QgsTileCache::statistics();
+      QCOMPARE( stats.memoryHits, 1 );
+      QCOMPARE( stats.misses, 1 );
+      QCOMPARE( stats.diskHits, 0 );
+
+      QgsTileCache::resetStatistics();
+      QCOMPARE( QgsTileCache::statistics().memoryHits, 0 );
+      QCOMPARE( QgsTileCache::statistics().misses, 0 );
+
+      // lookups which do not update the statistics
+      QVERIFY( QgsTileCache::tile( url, cached, false ) );
+      QVERIFY( !QgsTileCache::tile( QUrl( QStringLiteral( "http://localhost/tiles/insertAndLookUp/1/2/4.png" ) ), cached, false ) );
+      QCOMPARE( QgsTileCache::statistics().memoryHits, 0 );
+      QCOMPARE( QgsTileCache::statistics().misses, 0 );
+    }
+
+    void manyTiles()
+    {
+      // tiles spread over the shards of the cache, the oldest ones get evicted
+      QImage image( 4, 4, QImage::Format_ARGB32 );
+      image.fill( Qt::blue );
+      for ( int i = 0; i < 1000; ++i )
+        QgsTileCache::insertTile( QUrl( QStringLiteral( "http://localhost/tiles/manyTiles/%1.png" ).arg( i ) ), image );
+
+      QVERIFY( QgsTileCache::totalCost() > 0 );
+      QVERIFY( QgsTileCache::totalCost() <= QgsTileCache::maxCost() );
+
+      QImage cached;
+      QVERIFY( QgsTileCache::tile( QUrl( QStringLiteral( "http://localhost/tiles/manyTiles/999.png" ) ), cached ) );
+    }
+
+    void coalesceFetches()
+    {
+      const QUrl url( QStringLiteral( "http://localhost/tiles/coalesceFetches/1/2/3.png" ) );
+      QSignalSpy spy( QgsTileCache::notifier(), &QgsTileFetchNotifier::tileFetched );
+
+      QVERIFY( QgsTileCache::startFetching( url ) );
+      // same tile requested again while in flight
+      QVERIFY( !QgsTileCache::startFetching( url ) );
+      // other tiles are not affected
+      const QUrl otherUrl( QStringLiteral( "http://localhost/tiles/coalesceFetches/1/2/4.png" ) );
+      QVERIFY( QgsTileCache::startFetching( otherUrl ) );
+
+      QgsTileCache::finishFetching( url );
+      QCOMPARE( spy.count(), 1 );
+      QCOMPARE( spy.at( 0 ).at( 0 ).toUrl(), url );
+
+      // the tile can be fetched again once the previous download is finished
+      QVERIFY( QgsTileCache::startFetching( url ) );
+      QgsTileCache::finishFetching( url );
+      QgsTileCache::finishFetching( otherUrl );
+      QCOMPARE( spy.count(), 3 );
+
+      const QgsTileCache::Statistics stats = QgsTileCache::statistics();
+      QCOMPARE( stats.fetches, 3 );
+      QCOMPARE( stats.coalescedFetches, 1 );
+      QVERIFY( stats.fetchTime >= 0 );
+
+      // unregistered URLs are ignored
+      QgsTileCache::finishFetching( QUrl( QStringLiteral( "http://localhost/tiles/coalesceFetches/unknown.png" ) ) );
+      QCOMPARE( QgsTileCache::statistics().fetches, 3 );
+    }
+};
+
+QGSTEST_MAIN( TestQgsTileCache )
+#include "testqgstilecache.moc"
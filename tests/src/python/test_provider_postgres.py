@@ -40,7 +40,8 @@ from qgis.core import (
     QgsCoordinateReferenceSystem,
     QgsProject,
     QgsWkbTypes,
-    QgsGeometry
+    QgsGeometry,
+    QgsFeatureSink
 )
 from qgis.gui import QgsGui, QgsAttributeForm
 from qgis.PyQt.QtCore import QDate, QTime, QDateTime, QVariant, QDir, QObject
@@ -1105,6 +1106,101 @@ class TestPyQgsPostgresProvider(unittest.TestCase, ProviderTestCase):
         self.assertEqual(g.childCount(), 1)
         self.assertTrue(g.childGeometry(0).vertexCount() > 3)
 
+    def testCopyFeatures(self):
+        """Features added with the FastInsert flag are copied, with default values of their null attributes"""
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.copy_features')
+        self.execSQLCommand('CREATE TABLE qgis_test.copy_features(pk SERIAL NOT NULL PRIMARY KEY, cnt integer, val float8, '
+                            'name text, day date, flag boolean DEFAULT true, geom public.geometry(Point, 4326))')
+
+        vl = QgsVectorLayer(self.dbconn + ' sslmode=disable key=\'pk\' srid=4326 type=POINT table="qgis_test"."copy_features" (geom) sql=', 'test', 'postgres')
+        self.assertTrue(vl.isValid())
+
+        # more features than copied in a block
+        features = []
+        for i in range(10050):
+            f = QgsFeature(vl.fields())
+            f.setAttributes([NULL, i, i / 3.0, 'line\t{}\n\\'.format(i), QDate(1999, 12, 1).addDays(i), NULL])
+            f.setGeometry(QgsGeometry.fromWkt('Point({} {})'.format(i % 360 - 180, i % 180 - 90)))
+            features.append(f)
+        features[2]['name'] = NULL
+        # a column which is not null for some features is copied, with its default value for the others
+        features[0]['flag'] = False
+        features[3].setGeometry(QgsGeometry())
+
+        r, features = vl.dataProvider().addFeatures(features, QgsFeatureSink.FastInsert)
+        self.assertTrue(r)
+
+        # the keys of the features are taken from the sequence, without gaps
+        keys = [f['pk'] for f in features]
+        self.assertEqual(len(set(keys)), len(features))
+        self.assertEqual(keys, list(range(keys[0], keys[0] + len(features))))
+        self.assertEqual([f['flag'] for f in features[:3]], [False, True, True])
+
+        cur = self.con.cursor()
+        cur.execute("SELECT last_value FROM qgis_test.copy_features_pk_seq")
+        self.assertEqual(cur.fetchone()[0], keys[-1])
+        cur.execute("SELECT pk, cnt, val, name, day, flag, ST_AsText(geom) FROM qgis_test.copy_features ORDER BY pk")
+        rows = cur.fetchall()
+        cur.close()
+        self.assertEqual(len(rows), len(features))
+        self.assertEqual([r[0] for r in rows], keys)
+        self.assertEqual(rows[0][1:], (0, 0.0, 'line\t0\n\\', QDate(1999, 12, 1).toPyDate(), False, 'POINT(-180 -90)'))
+        self.assertTrue(rows[1][5])
+        self.assertEqual(rows[1][2], 1 / 3.0)
+        self.assertIsNone(rows[2][3])
+        self.assertIsNone(rows[3][6])
+        self.assertEqual(rows[-1][1], 10049)
+
+    def testCopyFeaturesView(self):
+        """Features added with the FastInsert flag to a view are inserted"""
+        self.execSQLCommand('DROP VIEW IF EXISTS qgis_test.copy_features_view')
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.copy_features_view_table')
+        self.execSQLCommand('CREATE TABLE qgis_test.copy_features_view_table(pk SERIAL NOT NULL PRIMARY KEY, name text, '
+                            'geom public.geometry(Point, 4326))')
+        self.execSQLCommand('CREATE VIEW qgis_test.copy_features_view AS SELECT * FROM qgis_test.copy_features_view_table')
+
+        vl = QgsVectorLayer(self.dbconn + ' sslmode=disable key=\'pk\' srid=4326 type=POINT table="qgis_test"."copy_features_view" (geom) sql=', 'test', 'postgres')
+        self.assertTrue(vl.isValid())
+
+        features = []
+        for i in range(3):
+            f = QgsFeature(vl.fields())
+            f.setAttributes([i + 1, 'name {}'.format(i)])
+            f.setGeometry(QgsGeometry.fromWkt('Point({} {})'.format(i, i)))
+            features.append(f)
+
+        r, features = vl.dataProvider().addFeatures(features, QgsFeatureSink.FastInsert)
+        self.assertTrue(r)
+
+        cur = self.con.cursor()
+        cur.execute("SELECT pk, name, ST_AsText(geom) FROM qgis_test.copy_features_view_table ORDER BY pk")
+        rows = cur.fetchall()
+        cur.close()
+        self.assertEqual(rows, [(1, 'name 0', 'POINT(0 0)'), (2, 'name 1', 'POINT(1 1)'), (3, 'name 2', 'POINT(2 2)')])
+
+    def testBinaryValues(self):
+        """Values decoded from their binary representation"""
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.binary_values')
+        self.execSQLCommand('CREATE TABLE qgis_test.binary_values(pk integer NOT NULL PRIMARY KEY, small int2, big int8, '
+                            'val float8, flag boolean, day date, moment timestamp)')
+        self.execSQLCommand("INSERT INTO qgis_test.binary_values VALUES "
+                            "(1, -32768, -9223372036854775807, 0.1, true, '1999-12-31', '1999-12-31 23:59:59.123'), "
+                            "(2, 32767, 9223372036854775807, -1e300, false, '2000-01-01', '2000-01-01 00:00:00'), "
+                            "(3, 0, 1, 1.0/3, true, '2018-04-20', '2018-04-20 12:34:56.789'), "
+                            "(4, NULL, NULL, NULL, NULL, NULL, NULL)")
+
+        vl = QgsVectorLayer(self.dbconn + ' sslmode=disable key=\'pk\' table="qgis_test"."binary_values" sql=', 'test', 'postgres')
+        self.assertTrue(vl.isValid())
+
+        values = {f['pk']: f.attributes()[1:] for f in vl.getFeatures()}
+        self.assertEqual(values[1], [-32768, -9223372036854775807, 0.1, True, QDate(1999, 12, 31),
+                                     QDateTime(QDate(1999, 12, 31), QTime(23, 59, 59, 123))])
+        self.assertEqual(values[2], [32767, 9223372036854775807, -1e300, False, QDate(2000, 1, 1),
+                                     QDateTime(QDate(2000, 1, 1), QTime(0, 0, 0))])
+        self.assertEqual(values[3], [0, 1, 1.0 / 3, True, QDate(2018, 4, 20),
+                                     QDateTime(QDate(2018, 4, 20), QTime(12, 34, 56, 789))])
+        self.assertEqual(values[4], [NULL] * 6)
+
 
 class TestPyQgsPostgresProviderCompoundKey(unittest.TestCase, ProviderTestCase):
 
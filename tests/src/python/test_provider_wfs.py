@@ -21,7 +21,7 @@ import shutil
 # Needed on Qt 5 so that the serialization of XML is consistent among all executions
 os.environ['QT_HASH_SEED'] = '1'
 
-from qgis.PyQt.QtCore import QCoreApplication, Qt, QObject, QDateTime
+from qgis.PyQt.QtCore import QCoreApplication, Qt, QObject, QDateTime, QSize
 
 from qgis.core import (
     QgsWkbTypes,
@@ -33,7 +33,9 @@ from qgis.core import (
     QgsVectorDataProvider,
     QgsFeatureRequest,
     QgsApplication,
-    QgsSettings
+    QgsSettings,
+    QgsMapSettings,
+    QgsMapRendererParallelJob
 )
 from qgis.testing import (start_app,
                           unittest
@@ -420,6 +422,26 @@ class TestPyQgsWFSProvider(unittest.TestCase, ProviderTestCase):
         """N/A for WFS provider"""
         pass
 
+    def testPrefetchFeatures(self):
+        """WFS feature iterators wait for their downloader with an event loop, so their features are not prefetched"""
+        self.assertFalse(self.source.capabilities() & QgsVectorDataProvider.ThreadAgnosticFeatureIterators)
+
+        expected = sorted([f['pk'] for f in self.vl.getFeatures()])
+        request = QgsFeatureRequest()
+        request.setFlags(QgsFeatureRequest.PrefetchFeatures)
+        self.assertEqual(sorted([f['pk'] for f in self.vl.getFeatures(request)]), expected)
+
+        # the renderer requests prefetching, which must not deadlock
+        settings = QgsMapSettings()
+        settings.setLayers([self.vl])
+        settings.setDestinationCrs(self.vl.crs())
+        settings.setExtent(self.vl.extent())
+        settings.setOutputSize(QSize(100, 100))
+        job = QgsMapRendererParallelJob(settings)
+        job.start()
+        job.waitForFinished()
+        self.assertFalse(job.errors())
+
     def testInconsistentUri(self):
         """Test a URI with a typename that doesn't match a type of the capabilities"""
 
@@ -805,6 +805,125 @@ class TestQgsDelimitedTextProviderOther(unittest.TestCase):
         requests = None
         self.runTest(filename, requests, **params)
 
+    def test_041_large_file(self):
+        # File read in several batches, with a byte order mark, CRLF line endings
+        # and a quoted field spanning lines
+        (filehandle, filename) = tempfile.mkstemp(suffix='.csv')
+        if os.name == "nt":
+            filename = filename.replace("\\", "/")
+        with os.fdopen(filehandle, "wb") as f:
+            f.write(b'\xef\xbb\xbfid,name,value,x,y\r\n')
+            f.write('1,"caf\u00e9\r\nau lait",1,0,0\r\n'.encode('utf-8'))
+            for i in range(2, 10001):
+                # only the last records have a decimal value
+                value = '{}.5'.format(i) if i > 9000 else str(i)
+                f.write('{},name {},{},{},{}\r\n'.format(i, i, value, i, -i).encode('utf-8'))
+
+        url = MyUrl.fromLocalFile(filename)
+        url.addQueryItem('type', 'csv')
+        url.addQueryItem('xField', 'x')
+        url.addQueryItem('yField', 'y')
+        url.addQueryItem('spatialIndex', 'Y')
+        layer = QgsVectorLayer(url.toString(), 'test', 'delimitedtext')
+        self.assertTrue(layer.isValid())
+        self.assertEqual(layer.featureCount(), 10000)
+        self.assertEqual(layer.extent(), QgsRectangle(0, -10000, 10000, 0))
+        self.assertEqual([f.typeName() for f in layer.fields()], ['integer', 'text', 'double', 'integer', 'integer'])
+
+        # records are read by id in any order, ids being line numbers
+        for i in (10000, 3, 9001, 2, 5000, 5001, 4999):
+            f = layer.getFeature(i + 2)
+            self.assertEqual(f['id'], i)
+            self.assertEqual(f['name'], 'name {}'.format(i))
+            self.assertEqual(f.geometry().asPoint().x(), i)
+        f = layer.getFeature(2)
+        self.assertEqual(f['name'], 'caf\u00e9\nau lait')
+
+        ids = [f['id'] for f in layer.getFeatures(QgsFeatureRequest(QgsRectangle(4000.5, -6000.5, 6000.5, -4000.5)))]
+        self.assertEqual(sorted(ids), list(range(4001, 6001)))
+
+    def test_042_warnings_order(self):
+        # Warnings about records are reported in the order of the lines, whether
+        # they are found when splitting the records or when parsing their geometry
+        (filehandle, filename) = tempfile.mkstemp(suffix='.csv')
+        if os.name == "nt":
+            filename = filename.replace("\\", "/")
+        with os.fdopen(filehandle, "w") as f:
+            f.write('id,wkt\n')
+            f.write('1,POINT(1 1)\n')
+            f.write('2,POINT(nonsense)\n')
+            f.write('3,POINT(3 3)\n')
+            f.write('4,"never ending field\n')
+
+        url = MyUrl.fromLocalFile(filename)
+        url.addQueryItem('type', 'csv')
+        url.addQueryItem('wktField', 'wkt')
+        with MessageLogger('DelimitedText') as logger:
+            layer = QgsVectorLayer(url.toString(), 'test', 'delimitedtext')
+            self.assertTrue(layer.isValid())
+            self.assertEqual(layer.featureCount(), 2)
+        invalidLines = [msg for msg in logger.messages() if msg.startswith('Invalid ')]
+        self.assertEqual(invalidLines, ['Invalid WKT at line 3', 'Invalid record format at line 5'])
+
+    def test_043_file_changed_after_scan(self):
+        # Features are read after the scan without the memory map, which would not
+        # survive the file being truncated
+        (filehandle, filename) = tempfile.mkstemp(suffix='.csv')
+        if os.name == "nt":
+            filename = filename.replace("\\", "/")
+        with os.fdopen(filehandle, "w") as f:
+            f.write('id,x,y\n')
+            for i in range(1, 1001):
+                f.write('{},{},{}\n'.format(i, i, i))
+
+        url = MyUrl.fromLocalFile(filename)
+        url.addQueryItem('type', 'csv')
+        url.addQueryItem('xField', 'x')
+        url.addQueryItem('yField', 'y')
+        layer = QgsVectorLayer(url.toString(), 'test', 'delimitedtext')
+        self.assertTrue(layer.isValid())
+        self.assertEqual(layer.featureCount(), 1000)
+
+        with open(filename, "w") as f:
+            f.write('id,x,y\n')
+            f.write('1,1,1\n')
+
+        self.assertEqual([f['id'] for f in layer.getFeatures()], [1])
+        self.assertFalse(layer.getFeature(900).isValid())
+
+    def test_044_seek_to_record(self):
+        # Features requested by id are read from the offset of the closest line
+        # recorded by the scan, rather than by reading all the lines before them
+        (filehandle, filename) = tempfile.mkstemp(suffix='.csv')
+        if os.name == "nt":
+            filename = filename.replace("\\", "/")
+        with os.fdopen(filehandle, "wb") as f:
+            f.write(b'\xef\xbb\xbfid,x,y\n')
+            for i in range(1, 10001):
+                f.write('{},{},{}\n'.format(i, i, i).encode('utf-8'))
+
+        url = MyUrl.fromLocalFile(filename)
+        url.addQueryItem('type', 'csv')
+        url.addQueryItem('xField', 'x')
+        url.addQueryItem('yField', 'y')
+        layer = QgsVectorLayer(url.toString(), 'test', 'delimitedtext')
+        self.assertTrue(layer.isValid())
+        self.assertEqual(layer.featureCount(), 10000)
+
+        # join the first lines of the file without changing its size, so that reading
+        # the file from its start would number the following lines differently
+        with open(filename, "r+b") as f:
+            head = f.read(1000)
+            f.seek(0)
+            f.write(head[:20] + head[20:].replace(b'\n', b' '))
+
+        request = QgsFeatureRequest()
+        request.setFilterFid(5001)
+        features = [f for f in layer.getFeatures(request)]
+        self.assertEqual(len(features), 1)
+        self.assertEqual(features[0]['id'], 5000)
+        self.assertEqual(features[0].geometry().asPoint().x(), 5000)
+
 
 if __name__ == '__main__':
     unittest.main()
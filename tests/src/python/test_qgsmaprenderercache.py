@@ -15,12 +15,20 @@ __revision__ = '$Format:%H$'
 import qgis  # NOQA
 
 from qgis.core import (QgsMapRendererCache,
+                       QgsMapRendererSequentialJob,
+                       QgsMapSettings,
                        QgsRectangle,
                        QgsVectorLayer,
-                       QgsProject)
+                       QgsProject,
+                       QgsHeatmapRenderer,
+                       QgsMarkerSymbol,
+                       QgsFillSymbol,
+                       QgsLineSymbol,
+                       QgsCentroidFillSymbolLayer,
+                       QgsSingleSymbolRenderer)
 from qgis.testing import start_app, unittest
-from qgis.PyQt.QtCore import QCoreApplication
-from qgis.PyQt.QtGui import QImage
+from qgis.PyQt.QtCore import QCoreApplication, QSize, QTemporaryDir, Qt
+from qgis.PyQt.QtGui import QImage, QPainter
 from time import sleep
 start_app()
 
@@ -266,6 +274,195 @@ class TestQgsMapRendererCache(unittest.TestCase):
         # cache should be cleared
         self.assertFalse(cache.hasCacheImage('l1'))
 
+    def tiledSettings(self, extent, size):
+        settings = QgsMapSettings()
+        settings.setOutputSize(QSize(size, size))
+        settings.setExtent(extent)
+        return settings
+
+    def testTiles(self):
+        cache = QgsMapRendererCache()
+        cache.setTileSize(128)
+        settings = self.tiledSettings(QgsRectangle(0, 0, 512, 512), 512)
+
+        im = QImage(512, 512, settings.outputImageFormat())
+        im.fill(Qt.transparent)
+        painter = QPainter(im)
+        painter.fillRect(100, 150, 200, 250, Qt.red)
+        painter.fillRect(200, 50, 250, 300, Qt.blue)
+        painter.end()
+
+        # tiled caching is disabled by default
+        self.assertFalse(cache.tiledCachingEnabled())
+        cache.setCacheTiles('layer', settings, im)
+        self.assertFalse(cache.hasCacheTiles('layer'))
+
+        cache.setTiledCachingEnabled(True)
+        cache.setCacheTiles('layer', settings, im)
+        self.assertTrue(cache.hasCacheTiles('layer'))
+        self.assertFalse(cache.hasCacheTiles('other'))
+        # tiles along the image edges are not cached
+        self.assertTrue(cache.cacheTilesImage('layer', settings).isNull())
+
+        # pan to a view covered by cached tiles
+        panned = self.tiledSettings(QgsRectangle(128, 128, 384, 384), 256)
+        self.assertEqual(cache.cacheTilesImage('layer', panned), im.copy(128, 128, 256, 256))
+        panned = self.tiledSettings(QgsRectangle(150, 160, 350, 360), 200)
+        self.assertEqual(cache.cacheTilesImage('layer', panned), im.copy(150, 152, 200, 200))
+        self.assertTrue(cache.cacheTilesImage('other', panned).isNull())
+
+        # changing the extent does not clear tiles
+        self.assertFalse(cache.init(panned.visibleExtent(), 1000))
+        self.assertTrue(cache.hasCacheTiles('layer'))
+
+        # not aligned on pixels
+        self.assertTrue(cache.cacheTilesImage('layer', self.tiledSettings(QgsRectangle(150.5, 160, 350.5, 360), 200)).isNull())
+        # different scale
+        self.assertTrue(cache.cacheTilesImage('layer', self.tiledSettings(QgsRectangle(150, 160, 350, 360), 100)).isNull())
+
+        cache.clearCacheTiles('layer')
+        self.assertFalse(cache.hasCacheTiles('layer'))
+        self.assertTrue(cache.cacheTilesImage('layer', panned).isNull())
+
+        # grids without tiles are removed, the next view stored at that scale anchors a new one
+        shifted = self.tiledSettings(QgsRectangle(0.5, 0, 512.5, 512), 512)
+        cache.setCacheTiles('layer', shifted, im)
+        self.assertEqual(cache.cacheTilesImage('layer', self.tiledSettings(QgsRectangle(128.5, 128, 384.5, 384), 256)), im.copy(128, 128, 256, 256))
+        cache.clearCacheTiles('layer')
+
+        cache.setCacheTiles('layer', settings, im)
+        self.assertTrue(cache.hasCacheTiles('layer'))
+        cache.clear()
+        self.assertFalse(cache.hasCacheTiles('layer'))
+        self.assertEqual(cache.tileMemoryUsage(), 0)
+
+    def testTilesRequestRepaint(self):
+        layer = QgsVectorLayer("Point?field=fldtxt:string",
+                               "layer", "memory")
+        cache = QgsMapRendererCache()
+        cache.setTiledCachingEnabled(True)
+        settings = self.tiledSettings(QgsRectangle(0, 0, 1024, 1024), 1024)
+        im = QImage(1024, 1024, settings.outputImageFormat())
+        im.fill(Qt.red)
+        cache.setCacheTiles('xxx', settings, im, [layer])
+        cache.setCacheTiles('nolayer', settings, im)
+        self.assertTrue(cache.hasCacheTiles('xxx'))
+
+        layer.triggerRepaint()
+        self.assertFalse(cache.hasCacheTiles('xxx'))
+        self.assertTrue(cache.hasCacheTiles('nolayer'))
+
+    def testTilesMemoryBudget(self):
+        cache = QgsMapRendererCache()
+        cache.setTiledCachingEnabled(True)
+        cache.setTileSize(128)
+        settings = self.tiledSettings(QgsRectangle(0, 0, 1024, 1024), 1024)
+        im = QImage(1024, 1024, settings.outputImageFormat())
+        im.fill(Qt.transparent)
+        painter = QPainter(im)
+        painter.fillRect(300, 200, 500, 400, Qt.green)
+        painter.end()
+        panned = self.tiledSettings(QgsRectangle(128, 128, 896, 896), 768)
+
+        # no spill directory - tiles above the budget are dropped
+        cache.setCacheTiles('layer', settings, im)
+        self.assertEqual(cache.tileMemoryUsage(), 36 * 128 * 128 * 4)
+        cache.setMemoryBudget(10 * 128 * 128 * 4)
+        self.assertLessEqual(cache.tileMemoryUsage(), 10 * 128 * 128 * 4)
+        self.assertTrue(cache.cacheTilesImage('layer', panned).isNull())
+
+        # spilled tiles are read back
+        temp_dir = QTemporaryDir()
+        self.assertTrue(cache.setSpillDirectory(temp_dir.path()))
+        self.assertTrue(cache.spillDirectory().startswith(temp_dir.path()))
+        cache.setCacheTiles('layer', settings, im)
+        self.assertLessEqual(cache.tileMemoryUsage(), 10 * 128 * 128 * 4)
+        self.assertEqual(cache.cacheTilesImage('layer', panned), im.copy(128, 128, 768, 768))
+        self.assertLessEqual(cache.tileMemoryUsage(), 10 * 128 * 128 * 4)
+
+    def testTilesMargin(self):
+        cache = QgsMapRendererCache()
+        cache.setTiledCachingEnabled(True)
+        cache.setTileSize(128)
+        settings = self.tiledSettings(QgsRectangle(0, 0, 512, 512), 512)
+        im = QImage(512, 512, settings.outputImageFormat())
+        im.fill(Qt.red)
+
+        cache.setCacheTiles('layer', settings, im, [], 0)
+        self.assertEqual(cache.cacheTilesImage('layer', settings), im)
+
+        cache.clearCacheTiles('layer')
+        cache.setCacheTiles('layer', settings, im, [], 64)
+        self.assertTrue(cache.cacheTilesImage('layer', settings).isNull())
+        panned = self.tiledSettings(QgsRectangle(128, 128, 384, 384), 256)
+        self.assertEqual(cache.cacheTilesImage('layer', panned), im.copy(128, 128, 256, 256))
+
+        cache.clearCacheTiles('layer')
+        cache.setCacheTiles('layer', settings, im, [], 130)
+        self.assertFalse(cache.hasCacheTiles('layer'))
+
+    def renderTiled(self, layer, cache):
+        settings = self.tiledSettings(QgsRectangle(0, 0, 512, 512), 512)
+        settings.setLayers([layer])
+        job = QgsMapRendererSequentialJob(settings)
+        job.setCache(cache)
+        job.start()
+        job.waitForFinished()
+
+    def testJobTileMargins(self):
+        """Tiles are not cached closer to the view edges than the size of the symbols"""
+        layer = QgsVectorLayer("Point?field=fldtxt:string", "layer", "memory")
+        panned = self.tiledSettings(QgsRectangle(64, 64, 448, 448), 384)
+
+        cache = QgsMapRendererCache()
+        cache.setTiledCachingEnabled(True)
+        cache.setTileSize(64)
+        layer.setRenderer(QgsSingleSymbolRenderer(QgsMarkerSymbol.createSimple({'size': '2'})))
+        self.renderTiled(layer, cache)
+        self.assertTrue(cache.hasCacheTiles(layer.id()))
+        self.assertFalse(cache.cacheTilesImage(layer.id(), panned).isNull())
+
+        cache = QgsMapRendererCache()
+        cache.setTiledCachingEnabled(True)
+        cache.setTileSize(64)
+        layer.setRenderer(QgsSingleSymbolRenderer(QgsMarkerSymbol.createSimple({'size': '60'})))
+        self.renderTiled(layer, cache)
+        self.assertTrue(cache.hasCacheTiles(layer.id()))
+        self.assertTrue(cache.cacheTilesImage(layer.id(), panned).isNull())
+
+    def testJobExtentDependentRenderers(self):
+        """Renderers depending on the view extent are not tiled"""
+        layer = QgsVectorLayer("Point?field=fldtxt:string", "layer", "memory")
+        cache = QgsMapRendererCache()
+        cache.setTiledCachingEnabled(True)
+        cache.setTileSize(64)
+        layer.setRenderer(QgsHeatmapRenderer())
+        self.renderTiled(layer, cache)
+        self.assertFalse(cache.hasCacheTiles(layer.id()))
+
+    def testJobExtentDependentSymbolLayers(self):
+        """Symbol layers depending on the view extent are not tiled"""
+        def isTiled(layer, symbol):
+            cache = QgsMapRendererCache()
+            cache.setTiledCachingEnabled(True)
+            cache.setTileSize(64)
+            layer.setRenderer(QgsSingleSymbolRenderer(symbol))
+            self.renderTiled(layer, cache)
+            return cache.hasCacheTiles(layer.id())
+
+        polygons = QgsVectorLayer("Polygon?field=fldtxt:string", "layer", "memory")
+        self.assertTrue(isTiled(polygons, QgsFillSymbol.createSimple({'color': '255,0,0'})))
+        self.assertFalse(isTiled(polygons, QgsFillSymbol.createSimple({'style': 'b_diagonal'})))
+        self.assertFalse(isTiled(polygons, QgsFillSymbol.createSimple({'outline_style': 'dash'})))
+        centroid = QgsFillSymbol()
+        centroid.changeSymbolLayer(0, QgsCentroidFillSymbolLayer())
+        self.assertFalse(isTiled(polygons, centroid))
+
+        lines = QgsVectorLayer("LineString?field=fldtxt:string", "layer", "memory")
+        self.assertTrue(isTiled(lines, QgsLineSymbol.createSimple({'line_style': 'solid'})))
+        self.assertFalse(isTiled(lines, QgsLineSymbol.createSimple({'line_style': 'dash'})))
+        self.assertFalse(isTiled(lines, QgsLineSymbol.createSimple({'use_custom_dash': '1'})))
+
 
 if __name__ == '__main__':
     unittest.main()
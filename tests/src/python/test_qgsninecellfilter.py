@@ -0,0 +1,75 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for Python subclasses of QgsNineCellFilter.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'QGIS project'
+__date__ = '16/04/2018'
+__copyright__ = 'Copyright 2018, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import qgis  # NOQA
+
+import os
+import tempfile
+import shutil
+
+from osgeo import gdal
+from qgis.analysis import QgsSlopeFilter
+
+from qgis.testing import start_app, unittest
+
+start_app()
+
+
+class ConstantSlopeFilter(QgsSlopeFilter):
+
+    def processNineCellWindow(self, x11, x21, x31, x12, x22, x32, x13, x23, x33):
+        return 42
+
+
+class TestQgsNineCellFilter(unittest.TestCase):
+
+    def setUp(self):
+        self.tempDir = tempfile.mkdtemp()
+        self.inputFile = os.path.join(self.tempDir, 'dem.tif')
+        ds = gdal.GetDriverByName('GTiff').Create(self.inputFile, 50, 40, 1, gdal.GDT_Float32)
+        ds.SetGeoTransform([0, 10, 0, 400, 0, -10])
+        band = ds.GetRasterBand(1)
+        band.SetNoDataValue(-9999)
+        band.WriteRaster(0, 0, 50, 40, bytes(50 * 40 * 4))
+        ds = None
+
+    def tearDown(self):
+        shutil.rmtree(self.tempDir, True)
+
+    def checkOutput(self, outputFile, expected):
+        ds = gdal.Open(outputFile)
+        values = ds.GetRasterBand(1).ReadAsArray()
+        self.assertEqual(values.shape, (40, 50))
+        self.assertTrue((values == expected).all())
+
+    def testPythonSubclass(self):
+        """A reimplemented processNineCellWindow() is used, without deadlocking"""
+        outputFile = os.path.join(self.tempDir, 'subclass.tif')
+        f = ConstantSlopeFilter(self.inputFile, outputFile, 'GTiff')
+        f.setCellSizeX(10)
+        f.setCellSizeY(10)
+        self.assertEqual(f.processRaster(), 0)
+        self.checkOutput(outputFile, 42)
+
+    def testFilter(self):
+        outputFile = os.path.join(self.tempDir, 'slope.tif')
+        f = QgsSlopeFilter(self.inputFile, outputFile, 'GTiff')
+        f.setCellSizeX(10)
+        f.setCellSizeY(10)
+        self.assertEqual(f.processRaster(), 0)
+        self.checkOutput(outputFile, 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
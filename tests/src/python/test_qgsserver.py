@@ -34,6 +34,7 @@ import os
 os.environ['QT_HASH_SEED'] = '1'
 
 import re
+import threading
 import urllib.request
 import urllib.parse
 import urllib.error
@@ -316,6 +317,32 @@ class TestQgsServer(QgsServerTestBase):
         self.assertEqual(response.headers(), {'Content-Length': '54', 'Content-Type': 'text/xml; charset=utf-8'})
         self.assertEqual(response.statusCode(), 500)
 
+    def test_concurrent_requests(self):
+        """Test requests handled by other threads than the main one, like FastCGI workers"""
+        self.assertTrue(self.server.canHandleConcurrentRequests())
+
+        project = os.path.join(self.testdata_path, "test_project_wfs.qgs")
+        queries = ['?MAP=%s&SERVICE=WMS&VERSION=1.3.0&REQUEST=GetCapabilities' % urllib.parse.quote(project),
+                   '?MAP=%s&SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=testlayer' % urllib.parse.quote(project)]
+        expected = [self._execute_request(qs) for qs in queries]
+
+        results = {}
+
+        def run(worker):
+            for i in range(5):
+                for qs in queries:
+                    results[(worker, i, qs)] = self._execute_request(qs)
+
+        workers = [threading.Thread(target=run, args=(worker,)) for worker in range(4)]
+        for worker in workers:
+            worker.start()
+        for worker in workers:
+            worker.join()
+
+        self.assertEqual(len(results), 4 * 5 * len(queries))
+        for (worker, i, qs), result in results.items():
+            self.assertEqual(result, expected[queries.index(qs)], "request %s failed in worker %d" % (qs, worker))
+
     def test_api(self):
         """Using an empty query string (returns an XML exception)
         we are going to test if headers and body are returned correctly"""
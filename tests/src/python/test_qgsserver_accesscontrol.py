@@ -207,6 +207,10 @@ class TestQgsServerAccessControl(unittest.TestCase):
     def tearDown(self):
         copyfile(os.path.join(self.testdata_path, "_helloworld.db"), os.path.join(self.testdata_path, "helloworld.db"))
 
+    def test_concurrent_requests(self):
+        # access control filters are not thread safe
+        self.assertFalse(self._server.canHandleConcurrentRequests())
+
 # # WMS # # WMS # # WMS # #
 
     def test_wms_getcapabilities(self):
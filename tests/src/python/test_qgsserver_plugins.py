@@ -77,10 +77,13 @@ class TestQgsServerPlugins(QgsServerTestBase):
                     request.appendBody('Hello from SimpleServer!'.encode('utf-8'))
 
         serverIface = self.server.serverInterface()
+        self.assertTrue(self.server.canHandleConcurrentRequests())
         filter = SimpleHelloFilter(serverIface)
         serverIface.registerFilter(filter, 100)
         # Get registered filters
         self.assertEqual(filter, serverIface.filters()[100][0])
+        # Python filters are not thread safe
+        self.assertFalse(self.server.canHandleConcurrentRequests())
 
         # global to be modified inside plugin filters
         globals()['status_code'] = 0
@@ -107,7 +107,9 @@ class TestServices(unittest.TestCase):
 
         myserv = MyService("TEST", "1.0", "Hello world")
 
+        self.assertFalse(reg.hasExternalServices())
         reg.registerService(myserv)
+        self.assertTrue(reg.hasExternalServices())
 
         # Retrieve service
         request = QgsServerRequest("http://DoStufff", QgsServerRequest.GetMethod)
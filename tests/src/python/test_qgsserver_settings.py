@@ -133,6 +133,56 @@ class TestQgsServerSettings(unittest.TestCase):
         self.assertEqual(self.settings.cacheDirectory(), "/tmp/fake")
         os.environ.pop(env)
 
+    def test_env_workers(self):
+        env = "QGIS_SERVER_WORKERS"
+
+        self.assertEqual(self.settings.workers(), 1)
+
+        os.environ[env] = "4"
+        self.settings.load()
+        self.assertEqual(self.settings.workers(), 4)
+        os.environ.pop(env)
+
+        os.environ[env] = "0"
+        self.settings.load()
+        self.assertEqual(self.settings.workers(), 1)
+        os.environ.pop(env)
+
+    def test_env_project_instances(self):
+        env = "QGIS_SERVER_PROJECT_INSTANCES"
+
+        self.assertEqual(self.settings.projectInstances(), 0)
+
+        os.environ[env] = "2"
+        self.settings.load()
+        self.assertEqual(self.settings.projectInstances(), 2)
+        os.environ.pop(env)
+
+        os.environ[env] = "-3"
+        self.settings.load()
+        self.assertEqual(self.settings.projectInstances(), 0)
+        os.environ.pop(env)
+
+    def test_env_wms_tile_cache(self):
+        self.assertEqual(self.settings.wmsMetatileSize(), 0)
+        self.assertEqual(self.settings.wmsTileCacheSize(), 64 * 1024 * 1024)
+        self.assertEqual(self.settings.wmsTileCacheDirectory(), "")
+        self.assertEqual(self.settings.wmsTileCacheDirectorySize(), 1024 * 1024 * 1024)
+
+        os.environ["QGIS_SERVER_WMS_METATILE_SIZE"] = "4"
+        os.environ["QGIS_SERVER_WMS_TILE_CACHE_SIZE"] = "1024"
+        os.environ["QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY"] = "/tmp/tiles"
+        os.environ["QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY_SIZE"] = "4096"
+        self.settings.load()
+        self.assertEqual(self.settings.wmsMetatileSize(), 4)
+        self.assertEqual(self.settings.wmsTileCacheSize(), 1024)
+        self.assertEqual(self.settings.wmsTileCacheDirectory(), "/tmp/tiles")
+        self.assertEqual(self.settings.wmsTileCacheDirectorySize(), 4096)
+        os.environ.pop("QGIS_SERVER_WMS_METATILE_SIZE")
+        os.environ.pop("QGIS_SERVER_WMS_TILE_CACHE_SIZE")
+        os.environ.pop("QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY")
+        os.environ.pop("QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY_SIZE")
+
     def test_priority(self):
         env = "QGIS_OPTIONS_PATH"
         dpath = "conf0"
@@ -22,14 +22,18 @@ import os
 os.environ['QT_HASH_SEED'] = '1'
 
 import re
+import json
 import urllib.request
 import urllib.parse
 import urllib.error
+import xml.etree.ElementTree as ET
 
 from qgis.server import QgsServerRequest
+from qgis.core import QgsProject, QgsVectorLayer, QgsFeature, QgsGeometry, QgsPointXY
 
 from qgis.testing import unittest
 from qgis.PyQt.QtCore import QSize
+from qgis.PyQt.QtXml import QDomDocument
 
 import osgeo.gdal  # NOQA
 
@@ -39,6 +43,9 @@ from test_qgsserver import QgsServerTestBase
 RE_STRIP_UNCHECKABLE = b'MAP=[^"]+|Content-Length: \d+|timeStamp="[^"]+"'
 RE_ATTRIBUTES = b'[^>\s]+=[^>\s]+'
 
+GML_NAMESPACE = '{http://www.opengis.net/gml}'
+QGS_NAMESPACE = '{http://www.qgis.org/gml}'
+
 
 class TestQgsServerWFS(QgsServerTestBase):
 
@@ -117,6 +124,97 @@ class TestQgsServerWFS(QgsServerTestBase):
         for id, req in tests:
             self.wfs_getfeature_compare(id, req)
 
+    def test_getfeature_gml3(self):
+        """GML3 output is the same as when features were serialized with QDom"""
+        self.wfs_getfeature_compare('gml3', 'GetFeature&TYPENAME=testlayer&OUTPUTFORMAT=GML3')
+
+    def test_getfeature_geojson(self):
+        project = self.testdata_path + "test_project_wfs.qgs"
+        assert os.path.exists(project), "Project file not found: " + project
+
+        query_string = '?MAP=%s&SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=testlayer&OUTPUTFORMAT=GeoJSON' % urllib.parse.quote(project)
+        header, body = self._execute_request(query_string)
+        self.assert_headers(header, body)
+
+        reference_path = self.testdata_path + 'wfs_getfeature_geojson.txt'
+        self.store_reference(reference_path, header + body)
+        with open(reference_path, 'rb') as f:
+            expected_header, expected_body = f.read().split(b'\n\n', 1)
+
+        # whitespace between the members is not significant
+        self.assertEqual(re.sub(RE_STRIP_UNCHECKABLE, b'', header).strip(), expected_header.strip())
+        self.assertEqual(json.loads(body.decode('utf-8')), json.loads(expected_body.decode('utf-8')))
+
+    def memory_project(self, names):
+        """Returns a project publishing a WFS point layer with a feature for each of the names"""
+        layer = QgsVectorLayer('Point?crs=epsg:4326&field=id:integer&field=name:string', 'points', 'memory')
+        features = []
+        for i, name in enumerate(names):
+            feature = QgsFeature(layer.fields())
+            feature.setAttributes([i, name])
+            feature.setGeometry(QgsGeometry.fromPointXY(QgsPointXY(i % 360 - 180, i % 180 - 90)))
+            features.append(feature)
+        self.assertTrue(layer.dataProvider().addFeatures(features)[0])
+
+        project = QgsProject()
+        project.addMapLayer(layer)
+        project.writeEntry('WFSLayers', '/', [layer.id()])
+        return project
+
+    def getfeature_names(self, project, outputformat, extra_query_string=''):
+        """Returns the names of the features of a GetFeature response, checking that it is well formed"""
+        query_string = '?SERVICE=WFS&VERSION=1.1.0&REQUEST=GetFeature&TYPENAME=points&OUTPUTFORMAT=%s%s' % (outputformat, extra_query_string)
+        header, body = self._execute_request_project(query_string, project)
+        self.assert_headers(header, body)
+
+        if outputformat == 'GeoJSON':
+            return [feature['properties']['name'] for feature in json.loads(body.decode('utf-8'))['features']], body
+
+        members = ET.fromstring(body).findall(GML_NAMESPACE + 'featureMember')
+        return [member.find(QGS_NAMESPACE + 'points').find(QGS_NAMESPACE + 'name').text for member in members], body
+
+    def test_getfeature_chunks(self):
+        """Responses larger than a streaming chunk are complete"""
+        names = ['feature %d %s' % (i, 'x' * 100) for i in range(2000)]
+        project = self.memory_project(names)
+
+        for outputformat in ('GML2', 'GML3', 'GeoJSON'):
+            response_names, body = self.getfeature_names(project, outputformat)
+            self.assertGreater(len(body), 64 * 1024)
+            self.assertEqual(response_names, names, outputformat)
+
+    def test_getfeature_empty(self):
+        """Responses without features are well formed"""
+        project = self.memory_project(['one', 'two'])
+
+        for outputformat in ('GML2', 'GML3', 'GeoJSON'):
+            response_names, body = self.getfeature_names(project, outputformat, '&EXP_FILTER=' + urllib.parse.quote('"id" < 0'))
+            self.assertEqual(response_names, [], outputformat)
+
+            response_names, body = self.getfeature_names(project, outputformat, '&STARTINDEX=5')
+            self.assertEqual(response_names, [], outputformat)
+
+    def test_getfeature_escaping(self):
+        """Attribute values are escaped like QDom escapes text nodes"""
+        names = ['<tag>', 'a & b', 'quote " and \' apostrophe', ']]> end', 'tab\tnew\nline', 'carriage\rreturn', 'unicode èé↓']
+        project = self.memory_project(names)
+
+        for outputformat in ('GML2', 'GML3', 'GeoJSON'):
+            response_names, body = self.getfeature_names(project, outputformat)
+            self.assertEqual(response_names, names, outputformat)
+
+            if outputformat == 'GeoJSON':
+                continue
+
+            # compare the serialized values with the previous QDom based serialization
+            doc = QDomDocument()
+            for name, serialized in zip(names, re.findall('<qgs:name>(.*?)</qgs:name>', body.decode('utf-8'), re.S)):
+                element = doc.createElement('qgs:name')
+                element.appendChild(doc.createTextNode(name))
+                expected = QDomDocument()
+                expected.appendChild(expected.importNode(element, True))
+                self.assertEqual('<qgs:name>%s</qgs:name>' % serialized, expected.toString(-1).strip(), outputformat)
+
     def test_wfs_getcapabilities_100_url(self):
         """Check that URL in GetCapabilities response is complete"""
         # empty url in project
@@ -0,0 +1,143 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsServer WMS GetMap metatiles and tile cache.
+
+From build dir, run: ctest -R PyQgsServerWMSMetatile -V
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+"""
+__author__ = 'QGIS project'
+__date__ = '16/04/2018'
+__copyright__ = 'Copyright 2018, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import tempfile
+
+# Settings are read when the first server is created
+TILE_CACHE_DIRECTORY = tempfile.mkdtemp()
+os.environ['QGIS_SERVER_WMS_METATILE_SIZE'] = '2'
+os.environ['QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY'] = TILE_CACHE_DIRECTORY
+
+import urllib.parse
+
+from qgis.testing import unittest
+from qgis.PyQt.QtGui import QImage, qRed, qGreen, qBlue, qAlpha
+from qgis.server import QgsAccessControlFilter
+
+import osgeo.gdal  # NOQA
+
+from test_qgsserver import QgsServerTestBase
+
+
+class ToggledAccessControl(QgsAccessControlFilter):
+
+    """Denies the read access to the Country layer when restricted, with the same cache key in both cases"""
+
+    restricted = False
+
+    def layerPermissions(self, layer):
+        rights = QgsAccessControlFilter.LayerPermissions()
+        rights.canRead = not (self.restricted and layer.name() == "Country")
+        return rights
+
+    def cacheKey(self):
+        return "toggled"
+
+
+class TestQgsServerWMSMetatile(QgsServerTestBase):
+
+    """QGIS Server WMS Tests for metatiled GetMap requests"""
+
+    # tiles of 2500 km in EPSG:3857, with the CRS origin as a corner
+    TILE_SIZE = 2500000
+
+    def setUp(self):
+        super().setUp()
+        if not hasattr(TestQgsServerWMSMetatile, 'access_control'):
+            serverIface = self.server.serverInterface()
+            TestQgsServerWMSMetatile.access_control = ToggledAccessControl(serverIface)
+            serverIface.registerAccessControl(TestQgsServerWMSMetatile.access_control, 100)
+        self.access_control.restricted = False
+
+    def tile_query(self, column, row, extra=None):
+        params = {
+            "MAP": urllib.parse.quote(self.projectPath),
+            "SERVICE": "WMS",
+            "VERSION": "1.1.1",
+            "REQUEST": "GetMap",
+            "LAYERS": "Country",
+            "STYLES": "",
+            "FORMAT": "image/png",
+            "BBOX": "%d,%d,%d,%d" % (column * self.TILE_SIZE, -(row + 1) * self.TILE_SIZE,
+                                     (column + 1) * self.TILE_SIZE, -row * self.TILE_SIZE),
+            "HEIGHT": "256",
+            "WIDTH": "256",
+            "SRS": "EPSG:3857"
+        }
+        if extra:
+            params.update(extra)
+        return "?" + "&".join(["%s=%s" % i for i in params.items()])
+
+    def tile_image(self, column, row, extra=None):
+        r, h = self._result(self._execute_request(self.tile_query(column, row, extra)))
+        self.assertEqual(h.get("Content-Type"), "image/png", r)
+        image = QImage.fromData(r, "PNG")
+        self.assertFalse(image.isNull())
+        return r, image
+
+    def assertImagesSimilar(self, image, expected, msg):
+        """Images may only differ by antialiasing"""
+        self.assertEqual(image.size(), expected.size(), msg)
+        different = 0
+        for y in range(image.height()):
+            for x in range(image.width()):
+                p = image.pixel(x, y)
+                e = expected.pixel(x, y)
+                if max(abs(qRed(p) - qRed(e)), abs(qGreen(p) - qGreen(e)), abs(qBlue(p) - qBlue(e)), abs(qAlpha(p) - qAlpha(e))) > 32:
+                    different += 1
+        self.assertLessEqual(different, image.width() * image.height() // 100, msg)
+
+    def test_metatile_slices(self):
+        """Tiles sliced from a metatile match tiles rendered alone"""
+        # the four tiles of the metatile spanning columns 0-1 and rows -2 to -1
+        for column, row in ((1, -2), (0, -2), (0, -1), (1, -1)):
+            body, tile = self.tile_image(column, row)
+            # opacities disable metatiling, a full opacity does not change the rendering
+            _, expected = self.tile_image(column, row, {"OPACITIES": "255"})
+            self.assertImagesSimilar(tile, expected, "tile %d,%d differs" % (column, row))
+
+            # the tile is now served from the cache
+            cached, _ = self.tile_image(column, row)
+            self.assertEqual(cached, body)
+
+        # the tiles are stored in the disk cache, in a directory for the project
+        directories = os.listdir(TILE_CACHE_DIRECTORY)
+        self.assertEqual(len(directories), 1)
+        self.assertGreaterEqual(self.cached_tiles_count(), 4)
+
+    def cached_tiles_count(self):
+        return sum(len(files) for _, _, files in os.walk(TILE_CACHE_DIRECTORY))
+
+    def test_not_aligned(self):
+        """Requests which are not tile aligned are not cached"""
+        count = self.cached_tiles_count()
+        self.tile_image(0, 0, {"BBOX": "1000,1000,%d,%d" % (self.TILE_SIZE + 1000, self.TILE_SIZE + 1000)})
+        self.assertEqual(self.cached_tiles_count(), count)
+
+    def test_permissions_checked_before_cache(self):
+        """Cached tiles are not served to requests which may not read the layers"""
+        self.tile_image(2, 2)
+
+        self.access_control.restricted = True
+        r, h = self._result(self._execute_request(self.tile_query(2, 2)))
+        self.assertNotEqual(h.get("Content-Type"), "image/png")
+        self.assertTrue(b"You are not allowed to access to the layer" in r, r)
+
+
+if __name__ == '__main__':
+    unittest.main()
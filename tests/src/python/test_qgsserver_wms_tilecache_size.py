@@ -0,0 +1,81 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for the size limit of the QgsServer WMS on-disk tile cache.
+
+From build dir, run: ctest -R PyQgsServerWMSTileCacheSize -V
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+"""
+__author__ = 'QGIS project'
+__date__ = '16/04/2018'
+__copyright__ = 'Copyright 2018, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import tempfile
+
+# Settings are read when the first server is created
+TILE_CACHE_DIRECTORY = tempfile.mkdtemp()
+TILE_CACHE_DIRECTORY_SIZE = 16 * 1024
+os.environ['QGIS_SERVER_WMS_METATILE_SIZE'] = '2'
+os.environ['QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY'] = TILE_CACHE_DIRECTORY
+os.environ['QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY_SIZE'] = str(TILE_CACHE_DIRECTORY_SIZE)
+
+import urllib.parse
+
+from qgis.testing import unittest
+
+import osgeo.gdal  # NOQA
+
+from test_qgsserver import QgsServerTestBase
+
+
+class TestQgsServerWMSTileCacheSize(QgsServerTestBase):
+
+    """QGIS Server WMS Tests for the size limit of the on-disk tile cache"""
+
+    # tiles of 2500 km in EPSG:3857, with the CRS origin as a corner
+    TILE_SIZE = 2500000
+
+    def tile_query(self, column, row):
+        params = {
+            "MAP": urllib.parse.quote(self.projectPath),
+            "SERVICE": "WMS",
+            "VERSION": "1.1.1",
+            "REQUEST": "GetMap",
+            "LAYERS": "Country",
+            "STYLES": "",
+            "FORMAT": "image/png",
+            "BBOX": "%d,%d,%d,%d" % (column * self.TILE_SIZE, -(row + 1) * self.TILE_SIZE,
+                                     (column + 1) * self.TILE_SIZE, -row * self.TILE_SIZE),
+            "HEIGHT": "256",
+            "WIDTH": "256",
+            "SRS": "EPSG:3857"
+        }
+        return "?" + "&".join(["%s=%s" % i for i in params.items()])
+
+    def cached_tiles(self):
+        return [os.path.join(root, f) for root, _, files in os.walk(TILE_CACHE_DIRECTORY) for f in files]
+
+    def test_size_limit(self):
+        """The oldest tiles are removed when the files exceed the size limit"""
+        written_count = 0
+        for column in range(-4, 4):
+            for row in range(-4, 4):
+                r, h = self._result(self._execute_request(self.tile_query(column, row)))
+                self.assertEqual(h.get("Content-Type"), "image/png", r)
+                written_count += 1
+
+                # the files never exceed the limit once a tile is stored
+                self.assertLessEqual(sum(os.path.getsize(f) for f in self.cached_tiles()), TILE_CACHE_DIRECTORY_SIZE)
+
+        # the store was filled past its limit: some tiles were removed
+        self.assertLess(len(self.cached_tiles()), written_count)
+
+
+if __name__ == '__main__':
+    unittest.main()
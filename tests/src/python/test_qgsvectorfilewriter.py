@@ -20,6 +20,7 @@ import qgis  # NOQA
 from qgis.core import (QgsVectorLayer,
                        QgsFeature,
                        QgsField,
+                       QgsFields,
                        QgsGeometry,
                        QgsPointXY,
                        QgsCoordinateReferenceSystem,
@@ -764,6 +765,87 @@ class TestQgsVectorFileWriter(unittest.TestCase):
 
         gdal.Unlink(filename)
 
+    def testWriteBufferedFeatureErrors(self):
+        """Tests that write errors of buffered features are reported once they are flushed."""
+
+        fields = QgsFields()
+        fields.append(QgsField('id', QVariant.Int))
+
+        def duplicated_feature(i):
+            # ids larger than an int are written as the fid, so this one fails the second time
+            f = QgsFeature(fields, 2 ** 33)
+            f.setAttributes([i])
+            f.setGeometry(QgsGeometry.fromPointXY(QgsPointXY(i, i)))
+            return f
+
+        # features are written as soon as they are added by default
+        filename = '/vsimem/unbuffered_errors.gpkg'
+        writer = QgsVectorFileWriter(filename, 'UTF-8', fields, QgsWkbTypes.Point, QgsCoordinateReferenceSystem('EPSG:4326'), 'GPKG')
+        self.assertEqual(writer.featureBufferSize(), 0)
+        self.assertTrue(writer.addFeature(duplicated_feature(0)))
+        self.assertFalse(writer.addFeature(duplicated_feature(1)))
+        self.assertEqual(writer.hasError(), QgsVectorFileWriter.ErrFeatureWriteFailed)
+        self.assertEqual(writer.writtenFeatureCount(), 1)
+        del writer
+        gdal.Unlink(filename)
+
+        # buffered features only fail when flushed
+        filename = '/vsimem/buffered_errors.gpkg'
+        writer = QgsVectorFileWriter(filename, 'UTF-8', fields, QgsWkbTypes.Point, QgsCoordinateReferenceSystem('EPSG:4326'), 'GPKG')
+        writer.setFeatureBufferSize(10)
+        self.assertTrue(writer.addFeature(duplicated_feature(0)))
+        self.assertTrue(writer.addFeature(duplicated_feature(1)))
+        self.assertEqual(writer.hasError(), QgsVectorFileWriter.NoError)
+        self.assertFalse(writer.flushBuffer())
+        self.assertEqual(writer.hasError(), QgsVectorFileWriter.ErrFeatureWriteFailed)
+        self.assertTrue(writer.errorMessage())
+        self.assertEqual(writer.writtenFeatureCount(), 1)
+        del writer
+        gdal.Unlink(filename)
+
+    def testWriteBatchedFeatures(self):
+        """Tests writing features in batches and several transactions to a GeoPackage."""
+
+        fields = QgsFields()
+        fields.append(QgsField('id', QVariant.Int))
+        filename = '/vsimem/batched.gpkg'
+        writer = QgsVectorFileWriter(filename, 'UTF-8', fields, QgsWkbTypes.Point, QgsCoordinateReferenceSystem('EPSG:4326'), 'GPKG')
+        self.assertEqual(writer.hasError(), QgsVectorFileWriter.NoError)
+        writer.setTransactionSize(700)
+        self.assertEqual(writer.transactionSize(), 700)
+        writer.setFeatureBufferSize(1000)
+        self.assertEqual(writer.featureBufferSize(), 1000)
+
+        features = []
+        for i in range(2500):
+            f = QgsFeature(fields)
+            f.setAttributes([i])
+            f.setGeometry(QgsGeometry.fromPointXY(QgsPointXY(i, i)))
+            features.append(f)
+        res, features = writer.addFeatures(features)
+        self.assertTrue(res)
+        # the last features are still buffered
+        self.assertEqual(writer.writtenFeatureCount(), 2000)
+        self.assertTrue(writer.flushBuffer())
+        self.assertEqual(writer.writtenFeatureCount(), 2500)
+        self.assertGreaterEqual(writer.writeTime(), 0)
+        del writer
+
+        ds = ogr.Open(filename)
+        lyr = ds.GetLayer(0)
+        self.assertEqual(lyr.GetFeatureCount(), 2500)
+        # features are written in the order they were added
+        self.assertEqual([f['id'] for f in lyr], list(range(2500)))
+
+        # the spatial index is created once all the features are written
+        sql_lyr = ds.ExecuteSQL('SELECT COUNT(*) FROM "rtree_%s_%s"' % (lyr.GetName(), lyr.GetGeometryColumn()))
+        self.assertEqual(sql_lyr.GetNextFeature().GetField(0), 2500)
+        ds.ReleaseResultSet(sql_lyr)
+        del lyr
+        del ds
+
+        gdal.Unlink(filename)
+
     def testSupportedFiltersAndFormat(self):
         # test with formats in recommended order
         formats = QgsVectorFileWriter.supportedFiltersAndFormats(QgsVectorFileWriter.SortRecommended)